@@ -7,14 +7,7 @@ _G["count"] = function(T)
 end
 
 _G["cast"] = function (c, T)
-	if _G["__ptr_lookup"][T.__classname][c.__ptr] ~= nil then
-		return _G["__ptr_lookup"][T.__classname][c.__ptr]
-	else
-		_G["__ptr_lookup"][T.__classname][c.__ptr] = T("__skip_ptr__")
-		_G["__ptr_lookup"][T.__classname][c.__ptr].__ptr = c.__ptr
-		return _G["__ptr_lookup"][T.__classname][c.__ptr]
-	end
-
+	return Polycore.__wrapObject(T.__classname, c.__ptr)
 end
 
 function __is_table_kind_of(T,c)
@@ -42,39 +35,27 @@ end
 
 __core__services__instance = Polycore.CoreServices_getInstance()
 
-Polycore.__ptr_lookup = {}
-
 Services = {}
 
-Services.Core = Core("__skip_ptr__")
-Services.Core.__ptr = Polycore.CoreServices_getCore(Polycore.CoreServices_getInstance())
+Services.Core = Polycore.CoreServices_getCore(__core__services__instance)
 
-Services.Renderer = Renderer("__skip_ptr__")
-Services.Renderer.__ptr = Polycore.CoreServices_getRenderer(Polycore.CoreServices_getInstance())
+Services.Renderer = Polycore.CoreServices_getRenderer(__core__services__instance)
 
-Services.MaterialManager = MaterialManager("__skip_ptr__")
-Services.MaterialManager.__ptr = Polycore.CoreServices_getMaterialManager(Polycore.CoreServices_getInstance())
+Services.MaterialManager = Polycore.CoreServices_getMaterialManager(__core__services__instance)
 
-Services.ScreenManager = ScreenManager("__skip_ptr__")
-Services.ScreenManager.__ptr = Polycore.CoreServices_getScreenManager(Polycore.CoreServices_getInstance())
+Services.ScreenManager = Polycore.CoreServices_getScreenManager(__core__services__instance)
 
-Services.SceneManager = SceneManager("__skip_ptr__")
-Services.SceneManager.__ptr = Polycore.CoreServices_getSceneManager(Polycore.CoreServices_getInstance())
+Services.SceneManager = Polycore.CoreServices_getSceneManager(__core__services__instance)
 
-Services.TimerManager = TimerManager("__skip_ptr__")
-Services.TimerManager.__ptr = Polycore.CoreServices_getTimerManager(Polycore.CoreServices_getInstance())
+Services.TimerManager = Polycore.CoreServices_getTimerManager(__core__services__instance)
 
-Services.TweenManager = TweenManager("__skip_ptr__")
-Services.TweenManager.__ptr = Polycore.CoreServices_getTweenManager(Polycore.CoreServices_getInstance())
+Services.TweenManager = Polycore.CoreServices_getTweenManager(__core__services__instance)
 
-Services.ResourceManager = ResourceManager("__skip_ptr__")
-Services.ResourceManager.__ptr = Polycore.CoreServices_getResourceManager(Polycore.CoreServices_getInstance())
+Services.ResourceManager = Polycore.CoreServices_getResourceManager(__core__services__instance)
 
-Services.SoundManager = SoundManager("__skip_ptr__")
-Services.SoundManager.__ptr = Polycore.CoreServices_getSoundManager(Polycore.CoreServices_getInstance())
+Services.SoundManager = Polycore.CoreServices_getSoundManager(__core__services__instance)
 
-Services.FontManager = FontManager("__skip_ptr__")
-Services.FontManager.__ptr = Polycore.CoreServices_getFontManager(Polycore.CoreServices_getInstance())
+Services.FontManager = Polycore.CoreServices_getFontManager(__core__services__instance)
 
 function delete(c)
 	c:__delete()
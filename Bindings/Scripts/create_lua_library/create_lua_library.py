@@ -15,32 +15,326 @@ def mkdir_p(path): # Same effect as mkdir -p, create dir and all necessary paren
 			pass
 		else: raise
 
-def template_returnPtrLookupArray(prefix, className, ptr):
-	out = ""
-	out += "%sfor i=1,count(%s) do\n" % (prefix, ptr)
-	out += "%s\tif _G[\"__ptr_lookup\"][%s][%s[i]] ~= nil then\n" % (prefix, className, ptr)
-	out += "%s\t\t%s[i] = _G[\"__ptr_lookup\"][%s][%s[i]]\n" % (prefix, ptr, className, ptr)
-	out += "%s\telse\n" % (prefix)
-	out += "%s\t\t_G[\"__ptr_lookup\"][%s][%s[i]] = _G[%s](\"__skip_ptr__\")\n" % (prefix, className, ptr, className)
-	out += "%s\t\t_G[\"__ptr_lookup\"][%s][%s[i]].__ptr = %s[i]\n" % (prefix, className, ptr, ptr)
-	out += "%s\t\t%s[i] = _G[\"__ptr_lookup\"][%s][%s[i]]\n" % (prefix, ptr, className, ptr)
-	out += "%s\tend\n" % (prefix)
-	out += "%send\n" % (prefix)
-	out += "%sreturn %s\n" % (prefix,ptr)
-	return out
-
-# Note we expect className to be a valid string
-def template_returnPtrLookup(prefix, className, ptr):
-	out = ""
-	out += "%sif _G[\"__ptr_lookup\"][%s][%s] ~= nil then\n" % (prefix, className, ptr)
-	out += "%s\treturn _G[\"__ptr_lookup\"][%s][%s]\n" % (prefix, className, ptr)
-	out += "%selse\n" % (prefix)
-	out += "%s\t_G[\"__ptr_lookup\"][%s][%s] = _G[%s](\"__skip_ptr__\")\n" % (prefix, className, ptr, className)
-	out += "%s\t_G[\"__ptr_lookup\"][%s][%s].__ptr = %s\n" % (prefix, className, ptr, ptr)
-	out += "%s\treturn _G[\"__ptr_lookup\"][%s][%s]\n" % (prefix, className, ptr)
-	out += "%send\n" % (prefix)
-	return out
-	
+# C++ helpers shared by all generated wrappers. Objects are handed to Lua as wrapper tables whose
+# __ptr field is a full userdata handle. Handles are unique per pointer, so wrappers compare equal
+# and can be found again from C++. Value types (Vector3, Color...) returned by value are handed to
+# Lua as a single userdata that holds the value inline and looks its methods up in the Lua class,
+# so returning one doesn't build a wrapper table or allocate a C++ object.
+def template_objectRuntime():
+	return """#ifndef POLYCODE_LUA_OBJECT_RUNTIME
+#define POLYCODE_LUA_OBJECT_RUNTIME
+
+#define POLYCODE_LUA_HANDLES "__polycode_handles"
+#define POLYCODE_LUA_OBJECTS "__polycode_objects"
+#define POLYCODE_LUA_REGISTERED "__polycode_registered"
+
+namespace Polycode {
+
+struct LuaObjectHandle {
+	void *ptr;
+	bool isValue;
+};
+
+// values are stored right after the handle, at an offset that keeps doubles aligned
+static const size_t LUA_VALUE_OFFSET = 16;
+
+static void luaGetRegistryTable(lua_State *L, const char *name, const char *mode) {
+	lua_getfield(L, LUA_REGISTRYINDEX, name);
+	if(lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		if(mode) {
+			lua_createtable(L, 0, 1);
+			lua_pushstring(L, mode);
+			lua_setfield(L, -2, "__mode");
+			lua_setmetatable(L, -2);
+		}
+		lua_pushvalue(L, -1);
+		lua_setfield(L, LUA_REGISTRYINDEX, name);
+	}
+}
+
+static void *luaToObject(lua_State *L, int idx) {
+	switch(lua_type(L, idx)) {
+		case LUA_TUSERDATA:
+			return ((LuaObjectHandle*)lua_touserdata(L, idx))->ptr;
+		case LUA_TLIGHTUSERDATA:
+			return lua_touserdata(L, idx);
+		case LUA_TTABLE: {
+			void *ptr = NULL;
+			lua_pushliteral(L, "__ptr");
+			lua_rawget(L, idx > 0 ? idx : idx - 1);
+			if(lua_type(L, -1) == LUA_TUSERDATA) {
+				ptr = ((LuaObjectHandle*)lua_touserdata(L, -1))->ptr;
+			} else if(lua_type(L, -1) == LUA_TLIGHTUSERDATA) {
+				ptr = lua_touserdata(L, -1);
+			}
+			lua_pop(L, 1);
+			return ptr;
+		}
+	}
+	return NULL;
+}
+
+static bool luaIsObject(lua_State *L, int idx) {
+	int type = lua_type(L, idx);
+	return type == LUA_TUSERDATA || type == LUA_TLIGHTUSERDATA || type == LUA_TTABLE;
+}
+
+static void *luaCheckObject(lua_State *L, int idx) {
+	void *ptr = luaToObject(L, idx);
+	if(!ptr) {
+		luaL_argerror(L, idx, "object expected");
+	}
+	return ptr;
+}
+
+static bool luaIsValue(lua_State *L, int idx) {
+	return lua_type(L, idx) == LUA_TUSERDATA && ((LuaObjectHandle*)lua_touserdata(L, idx))->isValue;
+}
+
+static int luaHandleToString(lua_State *L) {
+	lua_getmetatable(L, 1);
+	lua_getfield(L, -1, "__classname");
+	lua_pushfstring(L, "%s: %p", lua_tostring(L, -1), ((LuaObjectHandle*)lua_touserdata(L, 1))->ptr);
+	return 1;
+}
+
+// Pushes the Lua class of the value at idx, which the value's metatable caches along with the class's base class.
+static void luaPushValueClass(lua_State *L, int idx) {
+	lua_getmetatable(L, idx);
+	lua_getfield(L, -1, "__class");
+	if(lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_getfield(L, -1, "__classname");
+		lua_gettable(L, LUA_GLOBALSINDEX);
+		if(lua_istable(L, -1)) {
+			lua_pushvalue(L, -1);
+			lua_setfield(L, -3, "__class");
+			lua_getfield(L, -1, "__baseclass");
+			lua_setfield(L, -3, "__baseclass");
+		}
+	}
+	lua_remove(L, -2);
+}
+
+// __index of values. Methods come straight from the Lua class and members from its __getvar, which reads them through self.__ptr, the value itself.
+static int luaValueIndex(lua_State *L) {
+	const char *key = lua_tostring(L, 2);
+	if(key && strcmp(key, "__ptr") == 0) {
+		lua_settop(L, 1);
+		return 1;
+	}
+	luaPushValueClass(L, 1);
+	if(!lua_istable(L, -1))
+		return 0;
+	lua_pushvalue(L, 2);
+	lua_rawget(L, -2);
+	if(!lua_isnil(L, -1))
+		return 1;
+	lua_pop(L, 1);
+	lua_pushliteral(L, "__getvar");
+	lua_rawget(L, -2);
+	if(!lua_isfunction(L, -1))
+		return 0;
+	lua_pushvalue(L, 1);
+	lua_pushvalue(L, 2);
+	lua_call(L, 2, 1);
+	return 1;
+}
+
+// __newindex of values. Values can't hold fields of their own, so only members the class's __setvar knows can be set.
+static int luaValueNewIndex(lua_State *L) {
+	luaPushValueClass(L, 1);
+	if(lua_istable(L, -1)) {
+		lua_pushliteral(L, "__setvar");
+		lua_rawget(L, -2);
+		if(lua_isfunction(L, -1)) {
+			lua_pushvalue(L, 1);
+			lua_pushvalue(L, 2);
+			lua_pushvalue(L, 3);
+			lua_call(L, 3, 1);
+			if(lua_toboolean(L, -1))
+				return 0;
+		}
+	}
+	lua_getmetatable(L, 1);
+	lua_getfield(L, -1, "__classname");
+	return luaL_error(L, "can't set field '%s' of a %s value", lua_tostring(L, 2), lua_tostring(L, -1));
+}
+
+// Pushes the metatable of a class's handles, creating it the first time.
+static void luaPushHandleMetatable(lua_State *L, const char *className, bool isValue, lua_CFunction gc) {
+	char name[128];
+	strcpy(name, isValue ? "Polycode.Value." : "Polycode.");
+	strncat(name, className, sizeof(name) - strlen(name) - 1);
+	if(luaL_newmetatable(L, name)) {
+		lua_pushstring(L, className);
+		lua_setfield(L, -2, "__classname");
+		lua_pushcfunction(L, luaHandleToString);
+		lua_setfield(L, -2, "__tostring");
+		if(gc) {
+			lua_pushcfunction(L, gc);
+			lua_setfield(L, -2, "__gc");
+		}
+		if(isValue) {
+			lua_pushcfunction(L, luaValueIndex);
+			lua_setfield(L, -2, "__index");
+			lua_pushcfunction(L, luaValueNewIndex);
+			lua_setfield(L, -2, "__newindex");
+		}
+	}
+}
+
+// Pushes the handle of a pointer. Handles are kept in a weak table, so a pointer gets the same handle for as long as Lua references it.
+static void luaPushHandle(lua_State *L, void *ptr, const char *className) {
+	luaGetRegistryTable(L, POLYCODE_LUA_HANDLES, "v");
+	lua_pushlightuserdata(L, ptr);
+	lua_rawget(L, -2);
+	if(lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		LuaObjectHandle *handle = (LuaObjectHandle*)lua_newuserdata(L, sizeof(LuaObjectHandle));
+		handle->ptr = ptr;
+		handle->isValue = false;
+		luaPushHandleMetatable(L, className, false, NULL);
+		lua_setmetatable(L, -2);
+		lua_pushlightuserdata(L, ptr);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+	}
+	lua_remove(L, -2);
+}
+
+// Detaches the handle of an object that is about to be deleted, so that wrappers still referencing it can't reach the deleted object and a new object at the same address gets a new handle. A wrapper registered for the object from Lua is let go.
+static void luaReleaseHandle(lua_State *L, void *ptr) {
+	luaGetRegistryTable(L, POLYCODE_LUA_REGISTERED, NULL);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushnil(L);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+
+	luaGetRegistryTable(L, POLYCODE_LUA_HANDLES, "v");
+	lua_pushlightuserdata(L, ptr);
+	lua_rawget(L, -2);
+	if(lua_type(L, -1) == LUA_TUSERDATA) {
+		((LuaObjectHandle*)lua_touserdata(L, -1))->ptr = NULL;
+	}
+	lua_pop(L, 1);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushnil(L);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+}
+
+// Replaces the handle on top of the stack with a new wrapper of the given Lua class.
+static void luaWrapHandle(lua_State *L, const char *className) {
+	lua_createtable(L, 0, 2);
+	lua_pushvalue(L, -2);
+	lua_setfield(L, -2, "__ptr");
+	lua_getfield(L, LUA_GLOBALSINDEX, className);
+	if(lua_istable(L, -1)) {
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -3, "__prototype");
+		lua_setmetatable(L, -2);
+	} else {
+		lua_pop(L, 1);
+	}
+	lua_remove(L, -2);
+}
+
+// Pushes the wrapper cache of a class, creating it the first time. The cache only holds its wrappers weakly, so wrappers that scripts no longer reference are collected, except for wrappers registered from Lua, which POLYCODE_LUA_REGISTERED keeps until their object is deleted.
+static void luaGetWrapperCache(lua_State *L, const char *className) {
+	luaGetRegistryTable(L, POLYCODE_LUA_OBJECTS, NULL);
+	lua_getfield(L, -1, className);
+	if(lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_createtable(L, 0, 1);
+		lua_pushliteral(L, "v");
+		lua_setfield(L, -2, "__mode");
+		lua_setmetatable(L, -2);
+		lua_pushvalue(L, -1);
+		lua_setfield(L, -3, className);
+	}
+	lua_remove(L, -2);
+}
+
+// Pushes the wrapper table of an object. Wrappers are cached per class, so while a script holds on to a wrapper, the same table (including any fields the script added to it) is returned for the object. Wrappers whose object was deleted from Lua are replaced.
+static void luaPushObject(lua_State *L, void *ptr, const char *className) {
+	if(!ptr) {
+		lua_pushnil(L);
+		return;
+	}
+	luaGetWrapperCache(L, className);
+	lua_pushlightuserdata(L, ptr);
+	lua_rawget(L, -2);
+	if(lua_isnil(L, -1) || luaToObject(L, -1) != ptr) {
+		lua_pop(L, 1);
+		luaPushHandle(L, ptr, className);
+		luaWrapHandle(L, className);
+		lua_pushlightuserdata(L, ptr);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+	}
+	lua_remove(L, -2);
+}
+
+template<class T> static int luaValueGC(lua_State *L) {
+	((T*)((LuaObjectHandle*)lua_touserdata(L, 1))->ptr)->~T();
+	return 0;
+}
+
+// Pushes a copy of a value as a userdata holding it inline, without a wrapper table. The copy is owned by Lua and destroyed when collected.
+template<class T> static void luaPushValue(lua_State *L, const T &value, const char *className) {
+	LuaObjectHandle *handle = (LuaObjectHandle*)lua_newuserdata(L, LUA_VALUE_OFFSET + sizeof(T));
+	handle->ptr = new ((char*)handle + LUA_VALUE_OFFSET) T(value);
+	handle->isValue = true;
+	luaPushHandleMetatable(L, className, true, luaValueGC<T>);
+	lua_setmetatable(L, -2);
+}
+
+// Lua: __wrapObject(className, object) returns the cached wrapper of an object as the given class.
+static int luaWrapObject(lua_State *L) {
+	luaPushObject(L, luaToObject(L, 2), luaL_checkstring(L, 1));
+	return 1;
+}
+
+// Lua: __registerObject(className, wrapper) makes a wrapper created in Lua the one returned for its object. The wrapper may be an instance of a Lua subclass with fields of its own, so it is kept until the object is deleted even if the script drops it.
+static int luaRegisterObject(lua_State *L) {
+	const char *className = luaL_checkstring(L, 1);
+	void *ptr = luaCheckObject(L, 2);
+	luaGetWrapperCache(L, className);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushvalue(L, 2);
+	lua_rawset(L, -3);
+	luaGetRegistryTable(L, POLYCODE_LUA_REGISTERED, NULL);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushvalue(L, 2);
+	lua_rawset(L, -3);
+	return 0;
+}
+
+// Lua: __unregisterObject(className, object) forgets the cached wrapper of an object.
+static int luaUnregisterObject(lua_State *L) {
+	const char *className = luaL_checkstring(L, 1);
+	void *ptr = luaToObject(L, 2);
+	luaGetWrapperCache(L, className);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushnil(L);
+	lua_rawset(L, -3);
+	luaGetRegistryTable(L, POLYCODE_LUA_REGISTERED, NULL);
+	lua_pushlightuserdata(L, ptr);
+	lua_pushnil(L);
+	lua_rawset(L, -3);
+	return 0;
+}
+
+} // namespace Polycode
+
+#endif // POLYCODE_LUA_OBJECT_RUNTIME
+
+"""
+
 def template_quote(str):
 	return "\"%s\"" % str;
 
@@ -74,9 +368,13 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 	cppRegisterOut += "using namespace Polycode;\n\n"
 	cppRegisterOut += "int luaopen_%s(lua_State *L) {\n" % (prefix)
 	if prefix != "Polycode":
-		cppRegisterOut += "CoreServices *inst = (CoreServices*)lua_topointer(L, 1);\n"
+		cppRegisterOut += "CoreServices *inst = (CoreServices*)luaToObject(L, 1);\n"
 		cppRegisterOut += "CoreServices::setInstance(inst);\n"
 	cppRegisterOut += "\tstatic const struct luaL_reg %sLib [] = {" % (libSmallName)
+	if prefix == "Polycode":
+		cppRegisterOut += "\t\t{\"__wrapObject\", luaWrapObject},\n"
+		cppRegisterOut += "\t\t{\"__registerObject\", luaRegisterObject},\n"
+		cppRegisterOut += "\t\t{\"__unregisterObject\", luaUnregisterObject},\n"
 	
 	wrappersHeaderOut += "#pragma once\n\n"
 
@@ -86,6 +384,8 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 	wrappersHeaderOut += "#include \"lualib.h\"\n"
 	wrappersHeaderOut += "#include \"lauxlib.h\"\n"
 	wrappersHeaderOut += "} // extern \"C\" \n\n"
+	wrappersHeaderOut += "#include <new>\n"
+	wrappersHeaderOut += "#include <string.h>\n"
 
 	# Get list of headers to create bindings from
 	inputPathIsDir = os.path.isdir(inputPath)
@@ -101,12 +401,13 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 		if inputPathIsDir:
 			fileName = "%s/%s" % (inputPath, fileName)
 		head, tail = os.path.split(fileName)
-		ignore = ["PolyGLSLProgram", "PolyGLSLShader", "PolyGLSLShaderModule", "PolyWinCore", "PolyCocoaCore", "PolyAGLCore", "PolySDLCore", "Poly_iPhone", "PolyGLES1Renderer", "PolyGLRenderer", "tinyxml", "tinystr", "OpenGLCubemap", "PolyiPhoneCore", "PolyGLES1Texture", "PolyGLTexture", "PolyGLVertexBuffer", "PolyThreaded", "PolyGLHeaders", "GLee", "PolyPeer", "PolySocket", "PolyClient", "PolyServer", "PolyServerWorld"]
+		ignore = ["PolyGLSLProgram", "PolyGLSLShader", "PolyGLSLShaderModule", "PolyWinCore", "PolyCocoaCore", "PolyAGLCore", "PolySDLCore", "Poly_iPhone", "PolyGLES1Renderer", "PolyGLRenderer", "tinyxml", "tinystr", "PolyXMLReader", "OpenGLCubemap", "PolyiPhoneCore", "PolyGLES1Texture", "PolyGLTexture", "PolyGLVertexBuffer", "PolyThreaded", "PolyJobPool", "PolyGLHeaders", "GLee", "PolyPeer", "PolySocket", "PolyClient", "PolyServer", "PolyServerWorld"]
 		if tail.split(".")[1] == "h" and tail.split(".")[0] not in ignore:
 			filteredFiles.append(fileName)
 			wrappersHeaderOut += "#include \"%s\"\n" % (tail)
 
 	wrappersHeaderOut += "\nusing namespace std;\n\n"
+	wrappersHeaderOut += template_objectRuntime()
 	wrappersHeaderOut += "\nnamespace Polycode {\n\n"
 	
 	# Special case: If we are building the Polycode library itself, inject the LuaEventHandler class.
@@ -120,7 +421,8 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 		wrappersHeaderOut += "		lua_getfield(L, LUA_GLOBALSINDEX, \"EventHandler\" );\n"
 		wrappersHeaderOut += "		lua_getfield(L, -1, \"__handleEvent\");\n"
 		wrappersHeaderOut += "		lua_rawgeti( L, LUA_REGISTRYINDEX, wrapperIndex );\n"
-		wrappersHeaderOut += "		lua_pushlightuserdata(L, e);\n"
+		wrappersHeaderOut += "		luaPushHandle(L, e, \"Event\");\n"
+		wrappersHeaderOut += "		luaWrapHandle(L, \"Event\");\n"
 #		wrappersHeaderOut += "		lua_getfield (L, LUA_GLOBALSINDEX, \"__customError\");\n"
 #		wrappersHeaderOut += "		int errH = lua_gettop(L);\n"
 #		wrappersHeaderOut += "		lua_pcall(L, 2, 0, errH);\n"
@@ -184,6 +486,8 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 					continue # FIXME: Remove this, move any non-compileable classes into ignore_classes
 
 				parsed_methods = [] # Def: List of discovered methods
+				# Calling these classes from Lua builds a value held inline in a userdata instead of a wrapped C++ object. Lua subclasses still construct through Class:Class().
+				valueClasses = ["Vector2", "Vector3", "Color", "Quaternion"]
 				ignore_methods = ["readByte32", "readByte16", "getCustomEntitiesByType", "Core", "Renderer", "Shader", "Texture", "handleEvent", "secondaryHandler", "getSTLString"]
 				luaClassBindingOut += "\n\n"
 
@@ -231,17 +535,15 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							
 						# If type is a class
 						else:
-							luaClassBindingOut += "\t\tlocal retVal = %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
-							luaClassBindingOut += template_returnPtrLookup("\t\t", template_quote(pp["type"]), "retVal")
+							luaClassBindingOut += "\t\treturn %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
 
 						# Generate C++ side of binding:
 						if not ((ckey == "ScreenParticleEmitter" or ckey == "SceneParticleEmitter") and pp["name"] == "emitter"): #SPEC
 							cppRegisterOut += "\t\t{\"%s_get_%s\", %s_%s_get_%s},\n" % (ckey, pp["name"], libName, ckey, pp["name"])
 							wrappersHeaderOut += "static int %s_%s_get_%s(lua_State *L) {\n" % (libName, ckey, pp["name"])
-							wrappersHeaderOut += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-							wrappersHeaderOut += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+							wrappersHeaderOut += "\t%s *inst = (%s*)luaCheckObject(L, 1);\n" % (ckey, ckey)
 
-							outfunc = "lua_pushlightuserdata"
+							outfunc = "luaPushObject"
 							retFunc = ""
 							if pp["type"] == "Number":
 								outfunc = "lua_pushnumber"
@@ -256,7 +558,8 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							if pp["type"] == "Number" or  pp["type"] == "String" or pp["type"] == "int" or pp["type"] == "bool":
 								wrappersHeaderOut += "\t%s(L, inst->%s%s);\n" % (outfunc, pp["name"], retFunc)
 							else:
-								wrappersHeaderOut += "\t%s(L, &inst->%s%s);\n" % (outfunc, pp["name"], retFunc)
+								# Members are returned by reference, so that setting their fields changes the object.
+								wrappersHeaderOut += "\t%s(L, &inst->%s, \"%s\");\n" % (outfunc, pp["name"], pp["type"])
 							wrappersHeaderOut += "\treturn 1;\n"
 							wrappersHeaderOut += "}\n\n"
 						
@@ -290,8 +593,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 							cppRegisterOut += "\t\t{\"%s_set_%s\", %s_%s_set_%s},\n" % (ckey, pp["name"], libName, ckey, pp["name"])
 							wrappersHeaderOut += "static int %s_%s_set_%s(lua_State *L) {\n" % (libName, ckey, pp["name"])
-							wrappersHeaderOut += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-							wrappersHeaderOut += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+							wrappersHeaderOut += "\t%s *inst = (%s*)luaCheckObject(L, 1);\n" % (ckey, ckey)
 
 							outfunc = "lua_topointer"
 							if pp["type"] == "Number":
@@ -348,6 +650,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 					if pm["name"] == ckey: # It's a constructor
 						cppRegisterOut += "\t\t{\"%s\", %s_%s},\n" % (ckey, libName, ckey)
 						wrappersHeaderOut += "static int %s_%s(lua_State *L) {\n" % (libName, ckey)
+						ctorParamStart = len(wrappersHeaderOut) # Def: Where the constructor's parameter parsing starts, reused by value constructors
 						idx = 1 # Def: Current stack depth (TODO: Figure out, is this correct?)
 					else: # It's not a constructor
 						cppRegisterOut += "\t\t{\"%s_%s\", %s_%s_%s},\n" % (ckey, pm["name"], libName, ckey, pm["name"])
@@ -355,8 +658,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 						# Skip static methods (TODO: Figure out, why is this being done here?). # FIXME
 						if pm["rtnType"].find("static ") == -1:
-							wrappersHeaderOut += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-							wrappersHeaderOut += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+							wrappersHeaderOut += "\t%s *inst = (%s*)luaCheckObject(L, 1);\n" % (ckey, ckey)
 							idx = 2
 						else:
 							idx = 1
@@ -377,14 +679,15 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 							param["name"] = param["name"].replace("end", "_end").replace("repeat", "_repeat")
 							if"type" in param:
-								luatype = "LUA_TLIGHTUSERDATA"
-								checkfunc = "lua_islightuserdata"
+								# Objects are read from their handle, values such as Vector3 are copied straight out of it.
+								luatype = None
+								checkfunc = "luaIsObject"
 								if param["type"].find("*") > -1:
-									luafunc = "(%s)lua_topointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "(%s)luaCheckObject" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
 								elif param["type"].find("&") > -1:
-									luafunc = "*(%s*)lua_topointer" % (param["type"].replace("const", "").replace("&", "").replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "*(%s*)luaCheckObject" % (param["type"].replace("const", "").replace("&", "").replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
 								else:
-									luafunc = "*(%s*)lua_topointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "*(%s*)luaCheckObject" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
 								lend = ".__ptr"
 								if param["type"] == "int" or param["type"] == "unsigned int" or param["type"] == "short":
 									luafunc = "lua_tointeger"
@@ -410,7 +713,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								param["type"] = param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle")
 
 								if "defaltValue" in param:
-									if checkfunc != "lua_islightuserdata" or (checkfunc == "lua_islightuserdata" and param["defaltValue"] == "NULL"):
+									if checkfunc != "luaIsObject" or (checkfunc == "luaIsObject" and param["defaltValue"] == "NULL"):
 										#param["defaltValue"] = param["defaltValue"].replace(" 0f", ".0f")
 										param["defaltValue"] = param["defaltValue"].replace(": :", "::")
 										#param["defaltValue"] = param["defaltValue"].replace("0 ", "0.")
@@ -423,13 +726,15 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 										wrappersHeaderOut += "\t\t%s = %s;\n" % (param["name"], param["defaltValue"])
 										wrappersHeaderOut += "\t}\n"
 									else:
-										wrappersHeaderOut += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
+										if luatype:
+											wrappersHeaderOut += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
 										if param["type"] == "String":
 											wrappersHeaderOut += "\t%s %s = String(%s(L, %d));\n" % (param["type"], param["name"], luafunc, idx)
 										else:
 											wrappersHeaderOut += "\t%s %s = %s(L, %d);\n" % (param["type"], param["name"], luafunc, idx)
 								else:
-									wrappersHeaderOut += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
+									if luatype:
+										wrappersHeaderOut += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
 									if param["type"] == "String":
 										wrappersHeaderOut += "\t%s %s = String(%s(L, %d));\n" % (param["type"], param["name"], luafunc, idx)
 									else:
@@ -441,13 +746,14 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 						# Generate C++-side method call / generate return value
 						if pm["name"] == ckey: # If constructor
+							ctorParamCode = wrappersHeaderOut[ctorParamStart:]
 							if ckey == "EventHandler": # See LuaEventHandler above
 								wrappersHeaderOut += "\tLuaEventHandler *inst = new LuaEventHandler();\n"
 								wrappersHeaderOut += "\tinst->wrapperIndex = luaL_ref(L, LUA_REGISTRYINDEX );\n"
 								wrappersHeaderOut += "\tinst->L = L;\n"
 							else:
 								wrappersHeaderOut += "\t%s *inst = new %s(%s);\n" % (ckey, ckey, ", ".join(paramlist))
-							wrappersHeaderOut += "\tlua_pushlightuserdata(L, (void*)inst);\n"
+							wrappersHeaderOut += "\tluaPushHandle(L, (void*)inst, \"%s\");\n" % (ckey)
 							wrappersHeaderOut += "\treturn 1;\n"
 						else: #If non-constructor
 							if pm["rtnType"].find("static ") == -1: # If non-static
@@ -455,6 +761,9 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							else: # If static (FIXME: Why doesn't this work?)
 								call = "%s::%s(%s)" % (ckey, pm["name"], ", ".join(paramlist))
 
+							# Def: Lua class name of a returned object
+							retClassName = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "").replace("*","").replace(" ", "").replace("Polycode::", "")
+
 							#check if returning a template
 							if pm["rtnType"].find("<") > -1:
 								#if returning a vector, convert to lua table
@@ -465,10 +774,12 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 										wrappersHeaderOut += "\tstd::vector<%s> retVector = %s;\n" % (vectorReturnClass,call)
 										wrappersHeaderOut += "\tlua_newtable(L);\n"
 										wrappersHeaderOut += "\tfor(int i=0; i < retVector.size(); i++) {\n"
-										wrappersHeaderOut += "\t\tlua_pushlightuserdata(L, (void*)retVector[i]);\n"
+										wrappersHeaderOut += "\t\tluaPushObject(L, (void*)retVector[i], \"%s\");\n" % (vectorReturnClass.replace("*", ""))
 										wrappersHeaderOut += "\t\tlua_rawseti(L, -2, i+1);\n"
 										wrappersHeaderOut += "\t}\n"
 										wrappersHeaderOut += "\treturn 1;\n"
+								if not vectorReturn:
+									wrappersHeaderOut += "\treturn 0;\n"
 							# else If void-typed:
 							elif pm["rtnType"] == "void" or pm["rtnType"] == "static void" or pm["rtnType"] == "virtual void" or pm["rtnType"] == "inline void":
 								wrappersHeaderOut += "\t%s;\n" % (call)
@@ -478,7 +789,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								wrappersHeaderOut += "\treturn 0;\n" # 0 arguments returned
 							else: # If there is a return value:
 								# What type is the return value? Default to pointer
-								outfunc = "lua_pushlightuserdata"
+								outfunc = "luaPushObject"
 								retFunc = ""
 								basicType = False
 								vectorReturn = False
@@ -498,33 +809,31 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 								if pm["rtnType"].find("*") > -1: # Returned var is definitely a pointer.
 									wrappersHeaderOut += "\tvoid *ptrRetVal = (void*)%s%s;\n" % (call, retFunc)
-									wrappersHeaderOut += "\tif(ptrRetVal == NULL) {\n"
-									wrappersHeaderOut += "\t\tlua_pushnil(L);\n"
-									wrappersHeaderOut += "\t} else {\n"
-									wrappersHeaderOut += "\t\t%s(L, ptrRetVal);\n" % (outfunc)
-									wrappersHeaderOut += "\t}\n"
+									wrappersHeaderOut += "\t%s(L, ptrRetVal, \"%s\");\n" % (outfunc, retClassName)
 								elif basicType == True: # Returned var has been flagged as a recognized primitive type
 									wrappersHeaderOut += "\t%s(L, %s%s);\n" % (outfunc, call, retFunc)
-								else: # Some static object is being returned. Convert it to a pointer, then return that.
-									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "")
+								else: # An object is being returned by value. Copy it into a handle owned by Lua.
+									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "").strip()
 									if className == "Polygon": # Deal with potential windows.h conflict
 										className = "Polycode::Polygon"
 									if className == "Rectangle":
 										className = "Polycode::Rectangle"
 									if className == "Polycode : : Rectangle":
 										className = "Polycode::Rectangle"
-									wrappersHeaderOut += "\t%s *retInst = new %s();\n" % (className, className)
-									wrappersHeaderOut += "\t*retInst = %s;\n" % (call)
-									wrappersHeaderOut += "\t%s(L, retInst);\n" % (outfunc)
+									wrappersHeaderOut += "\tluaPushValue<%s>(L, %s, \"%s\");\n" % (className, call, retClassName)
 								wrappersHeaderOut += "\treturn 1;\n"
 					wrappersHeaderOut += "}\n\n" # Close out C++ generation
 
+					if pm["name"] == ckey and ckey in valueClasses and not rawMethod: # Value constructor, parsing the same parameters
+						cppRegisterOut += "\t\t{\"%s_value\", %s_%s_value},\n" % (ckey, libName, ckey)
+						wrappersHeaderOut += "static int %s_%s_value(lua_State *L) {\n" % (libName, ckey)
+						wrappersHeaderOut += ctorParamCode
+						wrappersHeaderOut += "\tluaPushValue<%s>(L, %s(%s), \"%s\");\n" % (ckey, ckey, ", ".join(paramlist), ckey)
+						wrappersHeaderOut += "\treturn 1;\n"
+						wrappersHeaderOut += "}\n\n"
+
 					# Now generate the Lua side method.
-					if rawMethod:
-						luaClassBindingOut += "function %s:%s(...)\n" % (ckey, pm["name"])
-						luaClassBindingOut += "\treturn %s.%s_%s(self.__ptr, ...)\n" % (libName, ckey, pm["name"])
-						luaClassBindingOut += "end\n"
-					elif pm["name"] == ckey: # Constructors
+					if pm["name"] == ckey: # Constructors
 						luaClassBindingOut += "function %s:%s(...)\n" % (ckey, ckey)
 						luaClassBindingOut += "\tlocal arg = {...}\n"
 						if inherits:
@@ -534,47 +843,20 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							luaClassBindingOut += "\t\t\treturn\n"
 							luaClassBindingOut += "\t\tend\n"
 							luaClassBindingOut += "\tend\n"
-						luaClassBindingOut += "\tfor k,v in pairs(arg) do\n"
-						luaClassBindingOut += "\t\tif type(v) == \"table\" then\n"
-						luaClassBindingOut += "\t\t\tif v.__ptr ~= nil then\n"
-						luaClassBindingOut += "\t\t\t\targ[k] = v.__ptr\n"
-						luaClassBindingOut += "\t\t\tend\n"
-						luaClassBindingOut += "\t\tend\n"
-						luaClassBindingOut += "\tend\n"
 						luaClassBindingOut += "\tif self.__ptr == nil and arg[1] ~= \"__skip_ptr__\" then\n"
 						if ckey == "EventHandler": # See LuaEventHandler above
 							luaClassBindingOut += "\t\tself.__ptr = %s.%s(self)\n" % (libName, ckey)
 						else:
 							luaClassBindingOut += "\t\tself.__ptr = %s.%s(unpack(arg))\n" % (libName, ckey)
-						luaClassBindingOut += "\t\t_G[\"__ptr_lookup\"].%s[self.__ptr] = self\n" % (ckey)
+						luaClassBindingOut += "\t\tPolycore.__registerObject(\"%s\", self)\n" % (ckey)
 						luaClassBindingOut += "\tend\n"
 						luaClassBindingOut += "end\n\n"
-					else: # Non-constructors.						
-						if pm["rtnType"].find("static ") == -1: # Non-static method
-							luaClassBindingOut += "function %s:%s(%s)\n" % (ckey, pm["name"], ", ".join(paramlist))						
-							if len(lparamlist):
-								luaClassBindingOut += "\tlocal retVal = %s.%s_%s(self.__ptr, %s)\n" % (libName, ckey, pm["name"], ", ".join(lparamlist))
-							else:
-								luaClassBindingOut += "\tlocal retVal =  %s.%s_%s(self.__ptr)\n" % (libName, ckey, pm["name"])
-						else: # Static method
-							luaClassBindingOut += "function %s.%s(%s)\n" % (ckey, pm["name"], ", ".join(paramlist))
-							if len(lparamlist):
-								luaClassBindingOut += "\tlocal retVal = %s.%s_%s(%s)\n" % (libName, ckey, pm["name"], ", ".join(lparamlist))
-							else:
-								luaClassBindingOut += "\tlocal retVal =  %s.%s_%s()\n" % (libName, ckey, pm["name"])
-
-						if not voidRet: # Was there a return value?
-							if basicType == True: # Yes, a primitive
-								luaClassBindingOut += "\treturn retVal\n"
-							else: # Yes, a pointer was returned
-								luaClassBindingOut += "\tif retVal == nil then return nil end\n"
-								if vectorReturn == True:
-									className = vectorReturnClass.replace("*", "")
-									luaClassBindingOut += template_returnPtrLookupArray("\t",template_quote(className),"retVal")
-								else:
-									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "").replace("*","").replace(" ", "")
-									luaClassBindingOut += template_returnPtrLookup("\t",template_quote(className),"retVal")
-						luaClassBindingOut += "end\n\n" # Close out Lua generation
+						if ckey in valueClasses and not rawMethod:
+							luaClassBindingOut += "getmetatable(%s).__call = function(c, ...)\n" % (ckey)
+							luaClassBindingOut += "\treturn %s.%s_value(...)\n" % (libName, ckey)
+							luaClassBindingOut += "end\n\n"
+					else: # Non-constructors. The C++ wrappers take the wrapper tables and return wrappers themselves, so they are called directly.
+						luaClassBindingOut += "%s.%s = %s.%s_%s\n\n" % (ckey, pm["name"], libName, ckey, pm["name"])
 
 					parsed_methods.append(pm["name"]) # Method parse success
 
@@ -583,34 +865,31 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 				# Delete method (C++ side)
 				cppRegisterOut += "\t\t{\"delete_%s\", %s_delete_%s},\n" % (ckey, libName, ckey)
 				wrappersHeaderOut += "static int %s_delete_%s(lua_State *L) {\n" % (libName, ckey)
-				wrappersHeaderOut += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-				wrappersHeaderOut += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+				wrappersHeaderOut += "\tif(luaIsValue(L, 1)) {\n"
+				wrappersHeaderOut += "\t\treturn 0;\n"
+				wrappersHeaderOut += "\t}\n"
+				wrappersHeaderOut += "\t%s *inst = (%s*)luaCheckObject(L, 1);\n" % (ckey, ckey)
+				wrappersHeaderOut += "\tluaReleaseHandle(L, inst);\n"
 				wrappersHeaderOut += "\tdelete inst;\n"
 				wrappersHeaderOut += "\treturn 0;\n"
 				wrappersHeaderOut += "}\n\n"
 
 				
 				luaClassBindingOut += "\n\n"
-				luaClassBindingOut += "if not _G[\"__ptr_lookup\"] then _G[\"__ptr_lookup\"] = {} end\n"
-				luaClassBindingOut += "_G[\"__ptr_lookup\"].%s = {}\n\n" % (ckey)
-				
 				# Delete method (Lua side)
 				luaClassBindingOut += "function %s:__delete()\n" % (ckey)
-				luaClassBindingOut += "\t_G[\"__ptr_lookup\"].%s[self.__ptr] = nil\n" % (ckey)
+				luaClassBindingOut += "\tPolycore.__unregisterObject(\"%s\", self.__ptr)\n" % (ckey)
 				luaClassBindingOut += "\t%s.delete_%s(self.__ptr)\n" % (libName, ckey)
 				luaClassBindingOut += "end\n"
 				if ckey == "EventHandler": # See LuaEventHandler above
 					luaClassBindingOut += "\n\n"
 					luaClassBindingOut += "function EventHandler:__handleEvent(event)\n"
-					luaClassBindingOut += "\tevt = _G[\"Event\"](\"__skip_ptr__\")\n"
-					luaClassBindingOut += "\tevt.__ptr = event\n"
-					luaClassBindingOut += "\tself:handleEvent(evt)\n"
-					#luaClassBindingOut += "\tself:handleEvent(event)\n"
+					luaClassBindingOut += "\tself:handleEvent(event)\n"
 					luaClassBindingOut += "end\n\n"
 					
 					# Let's use this opportunity to put in some other "generated" utility functions.
 					luaClassBindingOut += "function __ptrToTable(className, ptr)\n"
-					luaClassBindingOut += template_returnPtrLookup("\t","className","ptr")
+					luaClassBindingOut += "\treturn Polycore.__wrapObject(className, ptr)\n"
 					luaClassBindingOut += "end\n\n"
 					
 				# Add class to lua index file
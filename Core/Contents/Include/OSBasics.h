@@ -47,17 +47,55 @@ class _PolyExport OSFileEntry {
 		static const int TYPE_FOLDER = 1;
 };
 
+/**
+* Read only view of a whole file in memory. Loose files are memory mapped, files inside archives are read into a buffer with a single read. Loaders can parse the data in place.
+*/
+class _PolyExport OSFileMapping {
+public:
+	OSFileMapping();
+	
+	/**
+	* Contents of the file. Valid until the mapping is released with OSBasics::unmapFile().
+	*/
+	const char *data;
+	
+	/**
+	* Size of the file in bytes.
+	*/
+	size_t size;
+	
+	int mappingType;
+	
+	static const int TYPE_BUFFER = 0;
+	static const int TYPE_MEMORY_MAP = 1;
+	
+#ifdef _WINDOWS
+	void *fileHandle;
+	void *mappingHandle;
+#endif
+};
+
 class _PolyExport OSFILE {
 public:
-	OSFILE(){}
+	OSFILE();
 	
 	void debugDump();
 	
 	int fileType;
 	FILE *file;	
 	PHYSFS_File *physFSFile;
+	
+	OSFileMapping *mapping;
+	size_t mappingPosition;
+	
+	/**
+	* Holds the data returned by OSBasics::readInPlace() for files that aren't mapped.
+	*/
+	std::vector<char> inPlaceBuffer;
+	
 	static const int TYPE_FILE = 0;
 	static const int TYPE_ARCHIVE_FILE = 1;	
+	static const int TYPE_MAPPED_FILE = 2;
 };
 
 class _PolyExport OSBasics {
@@ -69,6 +107,45 @@ class _PolyExport OSBasics {
 		static size_t write( const void * ptr, size_t size, size_t count, OSFILE * stream );
 		static int seek(OSFILE * stream, long int offset, int origin );
 		static long tell(OSFILE * stream);
+		
+		/**
+		* Opens a file for reading through a whole file mapping, so small reads are served from memory instead of going to stdio or PhysFS every time. Falls back to a regular open() if the file can't be mapped.
+		* @param filename Path of the file.
+		*/
+		static OSFILE *openMapped(const Polycode::String& filename);
+		
+		/**
+		* Returns the mapping behind a file opened with openMapped(), or NULL if the file isn't mapped. The data is valid until the file is closed.
+		*/
+		static OSFileMapping *getMapping(OSFILE *file);
+		
+		/**
+		* Reads the next size bytes of a file and returns a pointer to them. For files opened with openMapped() the pointer points into the mapping, so loaders can parse the data in place without copying it. Other files are read into a buffer owned by the file, which stays valid until the next readInPlace() call.
+		* @param stream File to read from.
+		* @param size Number of bytes to read.
+		* @return Pointer to the data, or NULL if fewer than size bytes are left.
+		*/
+		static const char *readInPlace(OSFILE *stream, size_t size);
+		
+		/**
+		* Maps a whole file into memory.
+		* @param filename Path of the file, checked in the PhysFS search path first like open().
+		* @return The mapping, or NULL if the file doesn't exist. Release it with unmapFile().
+		*/
+		static OSFileMapping *mapFile(const Polycode::String& filename);
+		static void unmapFile(OSFileMapping *mapping);
+		
+		/**
+		* Returns when a file was last modified, in seconds since the epoch.
+		* @param filename Path of the file, checked in the PhysFS search path first like open().
+		* @return The modification time, or -1 if the file doesn't exist.
+		*/
+		static long getModificationTime(const Polycode::String& filename);
+		
+		/**
+		* Size of the read ahead buffer used for files read from archives.
+		*/
+		static const int ARCHIVE_READ_AHEAD_SIZE = 65536;
 	
 		static std::vector<OSFileEntry> parsePhysFSFolder(const Polycode::String& pathString, bool showHidden);
 		static std::vector<OSFileEntry> parseFolder(const Polycode::String& pathString, bool showHidden);
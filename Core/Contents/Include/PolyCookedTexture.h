@@ -0,0 +1,117 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+
+class OSFileMapping;
+
+namespace Polycode {
+
+	class Image;
+
+	/**
+	* Texture preprocessed into the .ptex format: raw pixels with a complete, already filtered mipmap chain and optionally premultiplied alpha. A cooked texture is loaded with a single file mapping and its levels can be uploaded directly, skipping PNG decoding and mipmap generation at runtime. MaterialManager::createTextureFromFile() uses a .ptex file next to the requested image if there is one.
+	*/
+	class _PolyExport CookedTexture {
+		public:
+			CookedTexture();
+			~CookedTexture();
+
+			/**
+			* Loads a cooked texture. The pixel data stays mapped until the object is destroyed.
+			* @param fileName Path of the .ptex file.
+			* @return True if the file exists and is a valid cooked texture.
+			*/
+			bool loadFromFile(const String& fileName);
+
+			/**
+			* Writes an image as a cooked texture.
+			* @param image Image to cook. Must be IMAGE_RGBA or IMAGE_RGB. If premultiply is true, the image's alpha is premultiplied in place.
+			* @param fileName Path of the .ptex file to write.
+			* @param sourceHash Hash of the source file, stored so tools can tell when the cooked file is out of date.
+			* @param premultiply If true, premultiplies alpha before generating the mipmaps.
+			* @param createMipmaps If true, stores the full mipmap chain.
+			* @return True if the file was written.
+			*/
+			static bool cookImage(Image *image, const String& fileName, unsigned long long sourceHash, bool premultiply, bool createMipmaps = true);
+
+			/**
+			* Returns the path of the cooked texture for an image file, which is the same path with a .ptex extension.
+			*/
+			static String getCookedPath(const String& fileName);
+
+			/**
+			* Returns a 64 bit FNV-1a hash of a file's contents, or 0 if the file can't be read.
+			*/
+			static unsigned long long hashFile(const String& fileName);
+			static unsigned long long hashData(const char *data, size_t size);
+
+			unsigned int getWidth() const { return width; }
+			unsigned int getHeight() const { return height; }
+
+			/**
+			* Returns the Image type of the pixel data.
+			*/
+			int getType() const { return type; }
+
+			bool isPremultiplied() const { return (flags & FLAG_PREMULTIPLIED) != 0; }
+			unsigned long long getSourceHash() const { return sourceHash; }
+
+			/**
+			* Returns the number of mipmap levels, including the full size level.
+			*/
+			unsigned int getNumLevels() const { return numLevels; }
+
+			/**
+			* Returns the pixels of a mipmap level.
+			* @param level Mipmap level, 0 being the full size image.
+			*/
+			char *getLevelData(unsigned int level) const;
+			unsigned int getLevelWidth(unsigned int level) const;
+			unsigned int getLevelHeight(unsigned int level) const;
+
+			static const unsigned int VERSION = 2;
+			static const unsigned int HEADER_SIZE = 40;
+			static const unsigned int FLAG_PREMULTIPLIED = 1;
+
+		protected:
+
+			static unsigned int getPixelSize(int type);
+			static size_t getLevelSize(unsigned int width, unsigned int height, int type, unsigned int level);
+
+			/**
+			* Returns where a level starts in the file. The offset of level numLevels is the size of the whole file.
+			*/
+			static size_t getLevelOffset(unsigned int width, unsigned int height, int type, unsigned int level);
+
+			OSFileMapping *mapping;
+
+			unsigned int width;
+			unsigned int height;
+			int type;
+			unsigned int numLevels;
+			unsigned int flags;
+			unsigned long long sourceHash;
+	};
+}
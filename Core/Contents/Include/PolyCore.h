@@ -43,6 +43,7 @@ long getThreadID();
 namespace Polycode {
 
 	class Renderer;
+	class JobPool;
 
 	class _PolyExport CoreMutex {
 	public:
@@ -76,6 +77,20 @@ namespace Polycode {
 			int yearDay;
 	};	
 
+	/**
+	* Receives the time the core would otherwise spend sleeping between frames. Use it for deferrable work, such as garbage collection, that should not add to the frame time. Set it with Core::setIdleHandler().
+	*/
+	class _PolyExport CoreIdleHandler {
+		public:
+			virtual ~CoreIdleHandler() {}
+			
+			/**
+			* Called once per frame, right before the core sleeps until the next frame. Any time spent in here is taken off the sleep.
+			* @param idleTime Time left until the next frame in milliseconds. 0 if the frame ran over.
+			*/
+			virtual void handleIdle(unsigned int idleTime) = 0;
+	};
+
 	/**
 	* The main core of the framework. The core deals with system-level functions, such as window initialization and OS interaction. Each platform has its own implementation of this base class. NOTE: SOME OF THE FUNCTIONALITY IN THE CORE IS NOT FULLY IMPLEMENTED!!
 	*/
@@ -141,6 +156,13 @@ namespace Polycode {
 		* @return Newly created mutex.
 		*/				
 		virtual CoreMutex *createMutex() = 0;
+
+		/**
+		* Returns the job pool shared by everything that runs work in the background. The pool's threads are started the first time this is called and are stopped when the core is deleted. Call it from the main thread.
+		* @return The shared job pool.
+		* @see JobPool
+		*/
+		POLYIGNORE JobPool *getJobPool();
 		
 		/**
 		* Copies the specified string to system clipboard.
@@ -280,6 +302,12 @@ namespace Polycode {
 		
 		void doSleep();
 		
+		/**
+		* Sets the handler that gets to use the idle time at the end of every frame.
+		* @param handler New idle handler, or NULL to remove it.
+		*/
+		void setIdleHandler(CoreIdleHandler *handler);
+		
 		/**
 		* Launches the default browser and directs it to specified URL
 		* @param url URL to launch.
@@ -314,12 +342,12 @@ namespace Polycode {
 		virtual String executeExternalCommand(String command) = 0;
 		
 		/**
-		* Returns the default working path of the application.
+		* Returns the default working path of the application. This is the resources folder of the application bundle on Mac OS X and the working directory the application was started in everywhere else.
 		*/
 		String getDefaultWorkingDirectory();
 		
 		/**
-		* Returns the default working path of the application.
+		* Returns the home folder of the user running the application.
 		*/
 		String getUserHomeDirectory();	
 		
@@ -365,9 +393,11 @@ namespace Polycode {
 		bool mouseEnabled;
 		
 		unsigned int lastSleepFrameTicks;
+		CoreIdleHandler *idleHandler;
 		
 		std::vector<Threaded*> threads;
 		CoreMutex *threadedEventMutex;
+		JobPool *jobPool;
 		
 		int xRes;
 		int yRes;	
@@ -32,6 +32,8 @@
 namespace Polycode {
 
 	class Renderer;
+	class Material;
+	class Texture;
 
 	class _PolyExport EntityProp {
 	public:
@@ -77,6 +79,16 @@ namespace Polycode {
 			virtual void transformAndRender();		
 
 			void renderChildren();					
+
+			/**
+			* Returns the material this entity renders with, or NULL if it does not use one. Scenes use this to group entities by render state before submitting them.
+			*/
+			virtual Material *getRenderMaterial() { return NULL; }
+			
+			/**
+			* Returns the texture this entity renders with, or NULL if it does not use one.
+			*/
+			virtual Texture *getRenderTexture() { return NULL; }
 		
 		
 			// ----------------------------------------------------------------------------------------------------------------
@@ -647,6 +659,11 @@ namespace Polycode {
 			std::vector<String> tags;
 		
 			void checkTransformSetters();
+			
+			/**
+			* Returns the entity's scissor box, constrained to the scissor box of its parent if it has one.
+			*/
+			Polycode::Rectangle clipScissorBox(bool parentScissorEnabled, const Polycode::Rectangle &oldScissorBox) const;
 		
 			void *userData;
 		
@@ -61,6 +61,12 @@ namespace Polycode {
 			void setDispatcher(EventDispatcher *dispatcher);
 			const String& getEventType() const;
 			
+			/**
+			* Events are allocated from a shared pool, since many are created and deleted every frame.
+			*/
+			static void *operator new(size_t size);
+			static void operator delete(void *ptr);
+			
 			static const int COMPLETE_EVENT = 0;
 			static const int CHANGE_EVENT = 1;
 			static const int CANCEL_EVENT = 2;			
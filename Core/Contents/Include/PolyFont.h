@@ -24,12 +24,28 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "ft2build.h"
 #include "PolyString.h"
+#include <map>
 
 #include FT_FREETYPE_H
+#include FT_GLYPH_H
 
 namespace Polycode {
 	
 	class String;
+	
+	/**
+	* A loaded glyph cached by a Font.
+	*/
+	class FontGlyph {
+		public:
+			FT_Glyph glyph;
+			FT_UInt glyphIndex;
+			
+			/**
+			* Horizontal advance in pixels.
+			*/
+			int advance;
+	};
 
 	class _PolyExport Font {
 		public:
@@ -43,9 +59,20 @@ namespace Polycode {
 			String getFontName();			
 			String getFontPath();
 			
+			/**
+			* Returns the glyph for a character at a pixel size, loading it the first time it is asked for. Glyphs are owned by the font and shared by every label that uses it, so they must not be freed or modified.
+			* @param charCode Character code.
+			* @param size Pixel size.
+			* @param antiAliasMode Label::ANTIALIAS_FULL or Label::ANTIALIAS_NONE, which load glyphs with different hinting.
+			* @return The glyph, or NULL if it could not be loaded.
+			*/
+			POLYIGNORE FontGlyph *getCachedGlyph(FT_ULong charCode, int size, int antiAliasMode);
+			
 			bool loaded;
 		protected:
 		
+			std::map<unsigned long long, FontGlyph*> glyphCache;
+		
 			String fileName;
 			String fontName;
 		
@@ -107,6 +107,7 @@ namespace Polycode {
 		
 		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
 		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type = Image::IMAGE_RGBA);
+		Texture *createTextureWithMipmaps(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int type = Image::IMAGE_RGBA);
 		void destroyTexture(Texture *texture);		
 		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
 		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer);
@@ -119,6 +120,7 @@ namespace Polycode {
 		void unbindFramebuffers();
 		
 		void cullFrontFaces(bool val);
+		void setDitherFade(Number amount, bool inverted);
 				
 		void pushRenderDataArray(RenderDataArray *array);
 		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
@@ -136,7 +138,6 @@ namespace Polycode {
 		
 		void setLineSmooth(bool val);		
 		
-		void loadIdentity();
 		void setClearColor(Number r, Number g, Number b);
 		
 		void setTexture(Texture *texture);		
@@ -144,10 +145,6 @@ namespace Polycode {
 		Image *renderScreenToImage();
 		void clearScreen();	
 		
-		void translate2D(Number x, Number y);
-		void rotate2D(Number angle);
-		void scale2D(Vector2 *scale);
-		
 		void enableScissor(bool val);
 		void setScissorBox(Polycode::Rectangle box);		
 		
@@ -165,15 +162,6 @@ namespace Polycode {
 		void enableFog(bool enable);
 		void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth);		
 				
-		void translate3D(Vector3 *position);
-		void translate3D(Number x, Number y, Number z);
-		void scale3D(Vector3 *scale);
-		
-		Matrix4 getProjectionMatrix();
-		Matrix4 getModelviewMatrix();		
-		void setModelviewMatrix(Matrix4 m);	
-		void multModelviewMatrix(Matrix4 m);
-		
 		void enableDepthTest(bool val);
 		void enableDepthWrite(bool val);
 				
@@ -184,9 +172,6 @@ namespace Polycode {
 		
 		void drawScreenQuad(Number qx, Number qy);
 				
-		void pushMatrix();
-		void popMatrix();		
-		
 		Vector3 Unproject(Number x, Number y);
 		
 		void setDepthFunction(int depthFunction);
@@ -196,14 +181,41 @@ namespace Polycode {
 		
 	protected:
 
+		/**
+		* Forgets all shadowed GL state, forcing the next state setters to reach GL. Called whenever GL state may have been changed behind the renderer's back.
+		*/
+		void invalidateStateCache();
+		
+		/**
+		* Forgets the shadowed texture unit, texture binding and blending mode. Called after a shader module has bound its own textures and blend state.
+		*/
+		void invalidateTextureCache();
+		
+		void setCachedCapability(GLenum capability, int *cachedValue, bool val);
+		void setActiveTextureUnit(int unit);
+		
+		/**
+		* Loads the renderer's projection and modelview matrices into GL if they changed since the last upload. Called right before anything is drawn.
+		*/
+		void uploadMatrices();
 		
 		Number nearPlane;
 		Number farPlane;
 		
 		int verticesToDraw;
 		
-		GLdouble sceneProjectionMatrix[16];
-		GLdouble sceneProjectionMatrixOrtho[16];	
+		// shadowed GL state, -1 means unknown
+		int cachedDepthTest;
+		int cachedDepthWrite;
+		int cachedAlphaTest;
+		int cachedBackfaceCulling;
+		int cachedTexturing;
+		int cachedBlendingMode;
+		int cachedActiveTexture;
+		int cachedDitherFade;
+		
+		bool cachedVertexColorValid;
+		GLfloat cachedVertexColor[4];
 		
 	};
 }
@@ -39,13 +39,13 @@ namespace Polycode {
 			Resource* createProgramFromFile(const String& extension, const String& fullPath);
 			void reloadPrograms();
 			String getShaderType();
-			Shader *createShader(TiXmlNode *node);
+			Shader *createShader(XMLReader *reader);
 			bool applyShaderMaterial(Renderer *renderer, Material *material, ShaderBinding *localOptions, unsigned int shaderIndex);	
 			void clearShader();
 		
 	protected:
 
-		GLSLProgramParam addParamToProgram(GLSLProgram *program,TiXmlNode *node);		
+		GLSLProgramParam addParamToProgram(GLSLProgram *program, XMLReader *reader);		
 		void recreateGLSLProgram(GLSLProgram *prog, const String& fileName, int type);
 		GLSLProgram *createGLSLProgram(const String& fileName, int type);
 		void updateGLSLParam(Renderer *renderer, GLSLShader *glslShader, GLSLProgramParam &param, ShaderBinding *materialOptions, ShaderBinding *localOptions);			
@@ -47,6 +47,11 @@ namespace Polycode {
 		public:
 			OpenGLTexture(unsigned int width, unsigned int height);
 			OpenGLTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int filteringMode, int type);
+			
+			/**
+			* Creates a mipmapped texture from a prebuilt mipmap chain. The levels are uploaded straight from levelData instead of being generated and aren't kept, so a later recreateFromImageData() generates them again.
+			*/
+			OpenGLTexture(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int filteringMode, int type);
 			virtual ~OpenGLTexture();
 			
 			void recreateFromImageData();
@@ -60,6 +65,10 @@ namespace Polycode {
 			
 		private:
 			
+			void setGLFormat(int type);
+			void createGLTexture(char **levelData, unsigned int numLevels);
+			void uploadMipmaps(char **levelData, unsigned int numLevels);
+			
 			bool glTextureLoaded;
 			GLenum glTextureType;
 			GLuint glTextureFormat;
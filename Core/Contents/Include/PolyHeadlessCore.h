@@ -0,0 +1,120 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyCore.h"
+#include <vector>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace Polycode {
+
+	class RecordingRenderer;
+
+	class _PolyExport HeadlessCoreMutex : public CoreMutex {
+	public:
+#ifdef _WINDOWS
+		HANDLE winMutex;
+#else
+		pthread_mutex_t pMutex;
+#endif
+	};
+
+	/**
+	* Core that runs without a window, input devices or a graphics context. It renders through a RecordingRenderer and advances a simulated clock by a fixed step on every Update, so the same number of frames always produces the same sequence of elapsed times. Use it to run scenes in benchmarks and tests on machines without a GPU.
+	*/
+	class _PolyExport HeadlessCore : public Core {
+
+	public:
+
+		/**
+		* Constructor.
+		* @param xRes Horizontal resolution of the simulated screen.
+		* @param yRes Vertical resolution of the simulated screen.
+		* @param frameRate Simulated frame rate. Each call to Update advances the clock by 1000/frameRate milliseconds.
+		*/
+		HeadlessCore(int xRes, int yRes, int frameRate=60);
+		virtual ~HeadlessCore();
+
+		/**
+		* Advances the simulated clock by one time step and runs a full update and render cycle. Does not sleep.
+		*/
+		bool Update();
+
+		/**
+		* Returns the simulated time in milliseconds.
+		*/
+		unsigned int getTicks();
+
+		/**
+		* Sets the amount of simulated time each Update advances the clock by.
+		* @param msecs Time step in milliseconds.
+		*/
+		void setTimeStep(unsigned int msecs);
+
+		/**
+		* Returns the simulated time step in milliseconds.
+		*/
+		unsigned int getTimeStep() const { return timeStep; }
+
+		/**
+		* Advances the simulated clock without running an update.
+		* @param msecs Time to advance the clock by in milliseconds.
+		*/
+		void advanceTime(unsigned int msecs);
+
+		/**
+		* Returns the recording renderer the core renders through.
+		*/
+		RecordingRenderer *getRecordingRenderer();
+
+		void setCursor(int cursorType);
+		void createThread(Threaded *target);
+		void lockMutex(CoreMutex *mutex);
+		void unlockMutex(CoreMutex *mutex);
+		CoreMutex *createMutex();
+		void copyStringToClipboard(const String& str);
+		String getClipboardString();
+		std::vector<Rectangle> getVideoModes();
+		void createFolder(const String& folderPath);
+		void copyDiskItem(const String& itemPath, const String& destItemPath);
+		void moveDiskItem(const String& itemPath, const String& destItemPath);
+		void removeDiskItem(const String& itemPath);
+		String openFolderPicker();
+		std::vector<String> openFilePicker(std::vector<CoreFileExtension> extensions, bool allowMultiple);
+		void setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel);
+		void resizeTo(int xRes, int yRes);
+		void openURL(String url);
+		String executeExternalCommand(String command);
+
+	protected:
+
+		unsigned int simulatedTicks;
+		unsigned int timeStep;
+		String clipboardString;
+	};
+}
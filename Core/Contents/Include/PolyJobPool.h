@@ -0,0 +1,125 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include <vector>
+#include <deque>
+
+namespace Polycode {
+
+	class JobGroup;
+	class JobPoolPlatformData;
+
+	/**
+	* A piece of work that runs on a JobPool thread. Subclass it and implement run().
+	*/
+	class _PolyExport Job {
+		public:
+			Job();
+			virtual ~Job();
+
+			/**
+			* Implement this method with the work the job does.
+			*/
+			virtual void run() = 0;
+
+			/**
+			* Returns the group the job was added with, or NULL. Jobs can add more jobs to their own group, which keeps JobPool::wait() waiting for those too.
+			*/
+			JobGroup *getGroup() const { return group; }
+
+		protected:
+			friend class JobPool;
+			JobGroup *group;
+	};
+
+	/**
+	* Counts the jobs that were added to a JobPool together, so that the caller can wait for all of them with JobPool::wait().
+	*/
+	class _PolyExport JobGroup {
+		public:
+			JobGroup() : pendingJobs(0) {}
+
+		protected:
+			friend class JobPool;
+			int pendingJobs;
+	};
+
+	/**
+	* A fixed set of threads that run jobs. Core owns one pool that is shared by everything that needs work done in the background, see Core::getJobPool(). The threads sleep until a job is added, and are stopped and joined when the pool is deleted. Jobs that haven't started by then are deleted without running.
+	*/
+	class _PolyExport JobPool {
+		public:
+			/**
+			* Starts the pool's threads.
+			* @param numThreads Number of threads to start.
+			*/
+			JobPool(int numThreads);
+
+			/**
+			* Lets running jobs finish, stops and joins the threads and deletes the jobs that haven't run.
+			*/
+			~JobPool();
+
+			/**
+			* Queues a job. The pool takes ownership of the job and deletes it once it has run.
+			* @param job Job to run.
+			* @param group Group to count the job in, or NULL if nothing waits for it.
+			*/
+			void addJob(Job *job, JobGroup *group = NULL);
+
+			/**
+			* Returns once every job in a group has run. The calling thread runs queued jobs of the group itself while it waits.
+			* @param group Group to wait for.
+			*/
+			void wait(JobGroup *group);
+
+			/**
+			* Runs a set of jobs and returns once they have all run.
+			* @param jobs Jobs to run. The pool deletes them.
+			*/
+			void runJobs(const std::vector<Job*> &jobs);
+
+			int getNumThreads() const;
+
+			/**
+			* Runs jobs until the pool is stopped. The pool's threads call this.
+			*/
+			void runThread();
+
+			/**
+			* Returns the number of processors available to the process.
+			*/
+			static int getProcessorCount();
+
+		protected:
+
+			Job *takeJob(JobGroup *group);
+			void runJob(Job *job);
+
+			std::deque<Job*> jobs;
+			bool stopping;
+			JobPoolPlatformData *platformData;
+	};
+
+}
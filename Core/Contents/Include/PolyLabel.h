@@ -42,6 +42,11 @@ namespace Polycode {
 			FT_Vector *positions;	
 			FT_UInt num_glyphs;
 			
+			/**
+			* Number of glyphs the glyph and position buffers can hold. The buffers are only reallocated when a longer string is cached.
+			*/
+			unsigned int capacity;
+			
 			int trailingAdvance;
 	};
 
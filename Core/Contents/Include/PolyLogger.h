@@ -22,15 +22,195 @@ THE SOFTWARE.
 
 #pragma once
 #include "PolyGlobals.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+/**
+* Messages below this level are compiled out of the POLY_LOG macros. Defaults to Logger::LEVEL_DEBUG, so everything is compiled in.
+*/
+#ifndef POLYCODE_MIN_LOG_LEVEL
+	#define POLYCODE_MIN_LOG_LEVEL 0
+#endif
+
+/**
+* Logs a printf style message at the given level. The arguments are not evaluated if the level is filtered out.
+*/
+#define POLY_LOG(level, ...) do { if((level) >= POLYCODE_MIN_LOG_LEVEL && Polycode::Logger::isLevelEnabled(level)) Polycode::Logger::logMessage(level, __VA_ARGS__); } while(0)
+
+/**
+* Like POLY_LOG, but each call site logs at most maxPerSecond messages a second. Suppressed messages are counted and reported with the next message that gets through.
+*/
+#define POLY_LOG_LIMITED(level, maxPerSecond, ...) do { if((level) >= POLYCODE_MIN_LOG_LEVEL && Polycode::Logger::isLevelEnabled(level)) { static Polycode::LogRateLimiter __polyLogLimiter(maxPerSecond); if(__polyLogLimiter.allow(level)) Polycode::Logger::logMessage(level, __VA_ARGS__); } } while(0)
+
+#define POLY_LOG_DEBUG(...) POLY_LOG(Polycode::Logger::LEVEL_DEBUG, __VA_ARGS__)
+#define POLY_LOG_INFO(...) POLY_LOG(Polycode::Logger::LEVEL_INFO, __VA_ARGS__)
+#define POLY_LOG_WARNING(...) POLY_LOG(Polycode::Logger::LEVEL_WARNING, __VA_ARGS__)
+#define POLY_LOG_ERROR(...) POLY_LOG(Polycode::Logger::LEVEL_ERROR, __VA_ARGS__)
 
 namespace Polycode {
 
+	/**
+	* A key and value pair attached to a structured log message. The value is formatted when the field is created, so fields can be built from temporaries.
+	*/
+	class _PolyExport LogField {
+		public:
+			LogField(const char *key, const char *value);
+			LogField(const char *key, int value);
+			LogField(const char *key, unsigned int value);
+			LogField(const char *key, Number value);
+			LogField(const char *key, const void *value);
+
+			static const int MAX_VALUE_LENGTH = 128;
+
+			const char *key;
+			POLYIGNORE char value[MAX_VALUE_LENGTH];
+	};
+
+	/**
+	* Limits how many messages a single call site can log per second. Used by POLY_LOG_LIMITED.
+	*/
+	class _PolyExport LogRateLimiter {
+		public:
+			LogRateLimiter(unsigned int maxPerSecond);
+
+			/**
+			* Returns true if a message may be logged now. If messages were suppressed since the last one that got through, logs how many.
+			* @param level Level to report suppressed messages at.
+			*/
+			bool allow(int level);
+
+		protected:
+			unsigned int maxPerSecond;
+			unsigned long long windowStart;
+			unsigned int count;
+			unsigned int suppressed;
+	};
+
+	/**
+	* A formatted message waiting in the logger's ring buffer.
+	*/
+	class _PolyExport LogEntry {
+		public:
+			static const int MAX_MESSAGE_LENGTH = 512;
+
+			volatile long sequence;
+			int level;
+			unsigned int length;
+			char message[MAX_MESSAGE_LENGTH];
+	};
+
+	/**
+	* Leveled logger. Messages are formatted on the calling thread into a lock free ring buffer and written out by a background thread, so logging never waits on stderr or the log file. If the ring buffer is full, messages are dropped and the number of dropped messages is reported once there is room again.
+	*/
 	class _PolyExport Logger {
 		public:
 			Logger(){}
 			~Logger(){}
 
+			/**
+			* Logs a printf style message at DEFAULT_LEVEL.
+			*/
 			static void log(const char *format, ...);
 			static void logw(const char *str);
+
+			/**
+			* Logs a printf style message at the given level. Prefer the POLY_LOG macros, which skip formatting the arguments when the level is filtered out.
+			* @param level One of the LEVEL_ constants.
+			* @param format printf style format string.
+			*/
+			static void logMessage(int level, const char *format, ...);
+			POLYIGNORE static void logMessageV(int level, const char *format, va_list args);
+
+			/**
+			* Logs a message followed by a list of fields, formatted as key=value pairs.
+			* @param level One of the LEVEL_ constants.
+			* @param message Message to log.
+			* @param fields Array of fields.
+			* @param numFields Number of fields in the array.
+			*/
+			static void logFields(int level, const char *message, const LogField *fields, unsigned int numFields);
+
+			/**
+			* Sets the lowest level that is logged. Defaults to LEVEL_INFO.
+			*/
+			static void setLogLevel(int level);
+			static int getLogLevel() { return logLevel; }
+
+			static bool isLevelEnabled(int level) { return level >= logLevel; }
+
+			/**
+			* If disabled, messages are written synchronously on the calling thread. Enabled by default.
+			*/
+			static void setAsync(bool val);
+
+			/**
+			* Also writes all messages to a file.
+			* @param fileName Path of the log file, or NULL to stop writing to a file.
+			*/
+			static void setLogFile(const char *fileName);
+
+			/**
+			* Enables or disables writing messages to stderr. Enabled by default.
+			*/
+			static void setLogToStderr(bool val);
+
+			/**
+			* Writes out every queued message before returning.
+			*/
+			static void flush();
+
+			/**
+			* Flushes and stops the writer thread. Called automatically at exit.
+			*/
+			static void shutdown();
+
+			/**
+			* Returns the number of messages dropped because the ring buffer was full.
+			*/
+			static unsigned int getDroppedMessageCount() { return droppedMessages; }
+
+			static const char *getLevelName(int level);
+
+			static const int LEVEL_DEBUG = 0;
+			static const int LEVEL_INFO = 1;
+			static const int LEVEL_WARNING = 2;
+			static const int LEVEL_ERROR = 3;
+			static const int LEVEL_NONE = 4;
+
+			/**
+			* Level of messages logged with log().
+			*/
+			static const int DEFAULT_LEVEL = LEVEL_INFO;
+
+			/**
+			* Number of messages the ring buffer holds. Must be a power of two.
+			*/
+			static const int QUEUE_SIZE = 2048;
+
+		protected:
+
+			static bool enqueue(int level, const char *format, va_list args);
+			static void writeMessage(int level, const char *message, unsigned int length);
+			static bool drainQueue();
+			static void startWriter();
+
+#ifdef _WINDOWS
+			static unsigned long __stdcall writerThreadFunc(void *data);
+#else
+			static void *writerThreadFunc(void *data);
+#endif
+
+			static int logLevel;
+			static bool async;
+			static bool logToStderr;
+			static FILE *logFile;
+
+			static LogEntry *entries;
+			static volatile long enqueuePosition;
+			static long dequeuePosition;
+			static volatile long consumerLock;
+			static volatile long writerState;
+			static volatile long droppedMessages;
+			static unsigned int reportedDroppedMessages;
 	};
 }
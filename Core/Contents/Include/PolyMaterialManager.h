@@ -26,8 +26,6 @@ THE SOFTWARE.
 #include "PolyObject.h"
 #include <vector>
 
-class TiXmlNode;
-
 namespace Polycode {
 	
 	class Cubemap;
@@ -37,6 +35,7 @@ namespace Polycode {
 	class SceneRenderTexture;
 	class Shader;
 	class String;
+	class XMLReader;
 	
 	/**
 	* Manages loading and reloading of materials, textures and shaders. This class should be only accessed from the CoreServices singleton.
@@ -56,6 +55,13 @@ namespace Polycode {
 			Texture *createNewTexture(int width, int height, bool clamp=false, bool createMipmaps = true, int type=Image::IMAGE_RGBA);
 			Texture *createTextureFromImage(Image *image, bool clamp=false, bool createMipmaps = true);
 			Texture *createTextureFromFile(const String& fileName, bool clamp=false, bool createMipmaps = true);
+			
+			/**
+			* Creates a texture from a cooked .ptex file, uploading its prebuilt mipmap chain.
+			* @param fileName Path of the .ptex file.
+			* @return The new texture, or NULL if the file doesn't exist, is invalid or doesn't match premultiplyAlphaOnLoad.
+			*/
+			Texture *createTextureFromCookedFile(const String& fileName, bool clamp=false, bool createMipmaps = true);
 			void deleteTexture(Texture *texture);
 		
 			void reloadTextures();
@@ -70,19 +76,36 @@ namespace Polycode {
 			
 			// cubemaps
 		
-			Cubemap *cubemapFromXMLNode(TiXmlNode *node);
+			/**
+			* Creates a cubemap from a cubemap element. The reader must be on the start of the element and is left at its end.
+			*/
+			Cubemap *cubemapFromXMLNode(XMLReader *reader);
 		
 			// materials
-			Material *materialFromXMLNode(TiXmlNode *node);
+			
+			/**
+			* Creates a material from a material element. The reader must be on the start of the element and is left at its end.
+			*/
+			Material *materialFromXMLNode(XMLReader *reader);
 			
 			Material *createMaterial(String materialName, String shaderName);
 			
-			Shader *setShaderFromXMLNode(TiXmlNode *node);
-			Shader *createShaderFromXMLNode(TiXmlNode *node);
+			Shader *setShaderFromXMLNode(XMLReader *reader);
+			
+			/**
+			* Creates a shader from a shader element with the shader module that handles its type. The reader must be on the start of the element.
+			*/
+			Shader *createShaderFromXMLNode(XMLReader *reader);
 			
 			void registerShader(Shader *shader);
 		
 			std::vector<Material*> loadMaterialsFromFile(String fileName);
+			
+			/**
+			* Creates the materials in the materials element of a material file.
+			* @param reader Reader for the file. It is rewound before reading.
+			*/
+			std::vector<Material*> loadMaterials(XMLReader *reader);
 		
 			void addMaterial(Material *material);
 		
@@ -90,6 +113,11 @@ namespace Polycode {
 			Shader *getShaderByIndex(unsigned int index);
 		
 			bool premultiplyAlphaOnLoad;
+			
+			/**
+			* If true, which is the default, createTextureFromFile() loads the cooked .ptex version of an image when there is one.
+			*/
+			bool useCookedTextures;
 		
 		private:
 			std::vector<Texture*> textures;
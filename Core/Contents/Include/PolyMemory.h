@@ -0,0 +1,256 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+#include <new>
+
+namespace Polycode {
+
+	class MemoryPool;
+
+	/**
+	* Allocation statistics for a single memory tag.
+	*/
+	class _PolyExport MemoryStats {
+		public:
+			MemoryStats();
+
+			/**
+			* Resets the counters, but not the number of live allocations.
+			*/
+			void reset();
+
+			String tag;
+
+			/**
+			* Number of allocations served.
+			*/
+			unsigned int allocations;
+
+			/**
+			* Number of allocations released.
+			*/
+			unsigned int releases;
+
+			/**
+			* Number of allocations currently alive.
+			*/
+			unsigned int liveAllocations;
+
+			/**
+			* Highest number of allocations that were alive at the same time.
+			*/
+			unsigned int peakLiveAllocations;
+
+			/**
+			* Number of times memory had to be requested from the system allocator.
+			*/
+			unsigned int systemAllocations;
+
+			/**
+			* Number of bytes currently requested from the system allocator.
+			*/
+			size_t bytesReserved;
+	};
+
+	/**
+	* Header placed in front of every block handed out by a MemoryPool, so that a block can be released without knowing which pool it came from.
+	*/
+	class _PolyExport MemoryBlockHeader {
+		public:
+			/**
+			* Pool the block belongs to, or NULL if it was allocated with malloc because pooling was disabled or the size was too large.
+			*/
+			MemoryPool *pool;
+			MemoryStats *stats;
+	};
+
+	/**
+	* Free list pool of fixed size blocks. Blocks are carved out of larger chunks, and released blocks are kept on a free list and reused, so once a pool has warmed up, allocating from it never calls the system allocator. Pools are thread safe.
+	*/
+	class _PolyExport MemoryPool {
+		public:
+			/**
+			* Constructor.
+			* @param tag Name the pool's statistics are reported under.
+			* @param blockSize Size of each block in bytes.
+			* @param blocksPerChunk Number of blocks to allocate at a time when the pool runs out.
+			*/
+			MemoryPool(const String& tag, size_t blockSize, unsigned int blocksPerChunk = 64);
+			~MemoryPool();
+
+			/**
+			* Returns a block of getBlockSize() bytes.
+			*/
+			void *allocate();
+
+			/**
+			* Releases a block allocated by any MemoryPool or PoolAllocator.
+			* @param ptr Block to release. May be NULL.
+			*/
+			static void release(void *ptr);
+
+			/**
+			* Allocates a block from the system allocator that can still be passed to release().
+			*/
+			static void *allocateUnpooled(size_t size, MemoryStats *stats);
+
+			size_t getBlockSize() const { return blockSize; }
+			const MemoryStats &getStats() const { return stats; }
+			MemoryStats *getStatsPointer() { return &stats; }
+
+			/**
+			* Enables or disables pooling for all pools. When disabled, every allocation goes straight to malloc, which is useful to measure what the pools save.
+			*/
+			static void setPoolingEnabled(bool val);
+			static bool isPoolingEnabled();
+
+			/**
+			* Returns the number of existing pools.
+			*/
+			static unsigned int getNumPools();
+
+			/**
+			* Returns an existing pool.
+			* @param index Index of the pool.
+			*/
+			static MemoryPool *getPool(unsigned int index);
+
+			/**
+			* Returns the total number of system allocator calls made by all pools since their stats were last reset.
+			*/
+			static unsigned int getTotalSystemAllocations();
+
+			/**
+			* Resets the statistics of all pools.
+			*/
+			static void resetAllStats();
+
+		protected:
+
+			void grow();
+
+			size_t blockSize;
+			size_t slotSize;
+			unsigned int blocksPerChunk;
+
+			void *freeList;
+			std::vector<char*> chunks;
+			volatile long spinLock;
+
+			MemoryStats stats;
+	};
+
+	/**
+	* Allocator for objects of varying sizes that share a tag, such as all Event subclasses. Sizes are rounded up to one of a few size classes, each backed by its own MemoryPool. Sizes above the largest class are allocated with malloc.
+	*/
+	class _PolyExport PoolAllocator {
+		public:
+			/**
+			* Constructor.
+			* @param tag Tag the size class pools are reported under.
+			*/
+			PoolAllocator(const String& tag);
+			~PoolAllocator();
+
+			void *allocate(size_t size);
+			void release(void *ptr) { MemoryPool::release(ptr); }
+
+			static const int SIZE_CLASS_STEP = 32;
+			static const int NUM_SIZE_CLASSES = 16;
+
+		protected:
+			String tag;
+			MemoryPool *pools[NUM_SIZE_CLASSES];
+			MemoryStats oversizedStats;
+			volatile long spinLock;
+	};
+
+	/**
+	* Linear allocator for temporaries that only live until the end of the frame. Allocating bumps a pointer, and everything is released at once by reset(). Chunks are kept between frames, so after the first few frames the arena doesn't call the system allocator at all. The arena is not thread safe and destructors are never called, so only use it for plain data.
+	*/
+	class _PolyExport FrameArena {
+		public:
+			/**
+			* Constructor.
+			* @param chunkSize Size of each chunk of memory the arena allocates.
+			*/
+			FrameArena(size_t chunkSize = 262144);
+			~FrameArena();
+
+			/**
+			* Allocates memory that stays valid until the next reset().
+			* @param size Number of bytes.
+			* @param alignment Alignment of the returned pointer. Must be a power of two.
+			*/
+			void *allocate(size_t size, size_t alignment = 16);
+
+			/**
+			* Allocates and default constructs an array of objects that stays valid until the next reset(). The objects are never destroyed.
+			* @param count Number of objects.
+			*/
+			template<class T> T *allocateArray(unsigned int count) {
+				T *ptr = (T*)allocate(sizeof(T) * count);
+				for(unsigned int i=0; i < count; i++) {
+					new (&ptr[i]) T();
+				}
+				return ptr;
+			}
+
+			/**
+			* Releases everything allocated from the arena.
+			*/
+			void reset();
+
+			/**
+			* Returns the number of bytes allocated since the last reset.
+			*/
+			size_t getBytesUsed() const { return bytesUsed; }
+
+			/**
+			* Returns the highest number of bytes allocated between two resets.
+			*/
+			size_t getPeakBytesUsed() const { return peakBytesUsed; }
+
+			const MemoryStats &getStats() const { return stats; }
+
+			/**
+			* Returns the arena that Core resets at the beginning of every frame. Only use it from the main thread.
+			*/
+			static FrameArena *getFrameArena();
+
+		protected:
+			size_t chunkSize;
+			std::vector<char*> chunks;
+			std::vector<char*> oversizedAllocations;
+			unsigned int currentChunk;
+			size_t chunkOffset;
+
+			size_t bytesUsed;
+			size_t peakBytesUsed;
+
+			MemoryStats stats;
+	};
+}
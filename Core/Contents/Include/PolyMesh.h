@@ -109,6 +109,54 @@ namespace Polycode {
 		float x;
 		float y;
 	} Vector2_struct;
+
+	/**
+	* Header of the chunked binary mesh format (version 2). The header is followed by a single data block of dataSize bytes holding the index buffer and the attribute streams. Every stream starts at a 16 byte aligned offset from the start of the data block, so the block can be read or mapped in one piece and used in place. Offsets of streams that are not present are 0.
+	*
+	* If lodCount is not 0, the data block is followed by lodCount lower detail versions of the mesh, from the most to the least detailed. Each is a MeshFileLODInfo followed by a complete mesh header and data block.
+	*/
+	typedef struct {
+		char magic[4];
+		unsigned int version;
+		unsigned int meshType;
+		unsigned int flags;
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		unsigned int dataSize;
+		unsigned int lodCount;
+		
+		unsigned int indexOffset;
+		unsigned int positionOffset;
+		unsigned int normalOffset;
+		unsigned int colorOffset;
+		unsigned int texCoordOffset;
+		unsigned int tangentOffset;
+		unsigned int boneIndexOffset;
+		unsigned int boneWeightOffset;
+	} MeshFileHeader;
+	
+	typedef struct {
+		float geometricError;
+		unsigned int triangleCount;
+		unsigned int reserved[2];
+	} MeshFileLODInfo;
+	
+	class Mesh;
+	
+	/**
+	* A lower detail version of a mesh, as stored in a mesh file.
+	*/
+	class _PolyExport MeshLOD {
+		public:
+			MeshLOD() : mesh(NULL), geometricError(0) {}
+			
+			Mesh *mesh;
+			
+			/**
+			* Largest distance, in the mesh's units, between the simplified surface and the full detail one.
+			*/
+			Number geometricError;
+	};
 	
 	/**
 	* A polygonal mesh. The mesh is assembled from Polygon instances, which in turn contain Vertex instances. This structure is provided for convenience and when the mesh is rendered, it is cached into vertex arrays with no notions of separate polygons. When data in the mesh changes, arrayDirtyMap must be set to true for the appropriate array types (color, position, normal, etc). Available types are defined in RenderDataArray.
@@ -155,9 +203,40 @@ namespace Polycode {
 			*/			
 			void saveToFile(const String& fileName);
 
+			/**
+			* Loads mesh data from an open file. Both the chunked mesh format and the legacy per-vertex format are supported.
+			* @param inFile File to read from, positioned at the start of the mesh data.
+			*/
 			void loadFromFile(OSFILE *inFile);
+			
+			/**
+			* Writes the mesh to an open file in the chunked mesh format. Identical vertices are shared through the index buffer and bone weights are stored normalized, with at most MESH_FILE_MAX_BONES influences per vertex.
+			* @param outFile File to write to.
+			*/
 			void saveToFile(OSFILE *outFile);
 			
+			/**
+			* Writes the mesh to an open file in the chunked mesh format, followed by lower detail versions of it.
+			* @param outFile File to write to.
+			* @param lods Lower detail versions of the mesh, from the most to the least detailed.
+			*/
+			void saveToFile(OSFILE *outFile, const std::vector<MeshLOD> &lods);
+			
+			/**
+			* Loads the lower detail versions stored in a mesh file. The full detail mesh is skipped without being loaded.
+			* @param fileName Path to mesh file.
+			* @return The lower detail meshes, from the most to the least detailed. The caller owns the meshes. Files without lower detail versions return an empty list.
+			*/
+			static POLYIGNORE std::vector<MeshLOD> loadLODs(const String& fileName);
+			
+			/**
+			* Loads mesh data from a chunked mesh data block that is already in memory. The block is only read from, so it can point into a mapped file.
+			* @param header Mesh file header.
+			* @param data Data block following the header, at least header.dataSize bytes long.
+			* @return True if the data block was valid, false otherwise.
+			*/
+			bool loadFromBuffer(const MeshFileHeader &header, const char *data);
+			
 			/**
 			* Returns the number of polygons in the mesh.
 			* @return Number of polygons in the mesh.
@@ -264,19 +343,26 @@ namespace Polycode {
 			Number getRadius();
 			
 			/**
-			* Recalculates the mesh normals
+			* Recalculates the mesh normals. Flat normals give every polygon its own copy of the vertices it shares with others in a loaded mesh.
 			* @param smooth If true, will use smooth normals.
 			* @param smoothAngle If smooth, this parameter sets the angle tolerance for the approximation function.
 			*/
 			void calculateNormals(bool smooth=true, Number smoothAngle=90.0);	
 
 			/**
-			* Recalculates the tangent space vector for all vertices.
+			* Recalculates the tangent space vector for all vertices. Tangents are computed per polygon, so every polygon first gets its own copy of the vertices it shares with others in a loaded mesh.
 			*/ 
 			void calculateTangents();
 			
 			std::vector<Polygon*> getConnectedFaces(Vertex *v);
 			
+			/**
+			* Fills a vector with the polygons that share a vertex, reusing the vector's storage.
+			* @param v Vertex to find the polygons for.
+			* @param connectedFaces Vector to fill. It is cleared first.
+			*/
+			void getConnectedFaces(Vertex *v, std::vector<Polygon*> &connectedFaces);
+			
 			/**
 			* Returns the mesh type.
 			*/ 
@@ -334,6 +420,22 @@ namespace Polycode {
 			*/									
 			static const int LINE_STRIP_MESH = 6;
 			
+			/**
+			* Current version of the chunked mesh file format.
+			*/
+			static const unsigned int MESH_FILE_VERSION = 2;
+			
+			/**
+			* Maximum number of bone influences per vertex stored in the chunked mesh file format.
+			*/
+			static const int MESH_FILE_MAX_BONES = 4;
+			
+			static const unsigned int MESH_FILE_HAS_NORMALS = 1;
+			static const unsigned int MESH_FILE_HAS_COLORS = 2;
+			static const unsigned int MESH_FILE_HAS_TEXCOORDS = 4;
+			static const unsigned int MESH_FILE_HAS_TANGENTS = 8;
+			static const unsigned int MESH_FILE_HAS_BONES = 16;
+			
 		
 		
 			/**
@@ -354,10 +456,24 @@ namespace Polycode {
 			bool useVertexColors;
 		
 		protected:
+		
+		void loadFromLegacyFile(OSFILE *inFile, unsigned int meshType);
+		void writeMeshBlock(OSFILE *outFile, unsigned int lodCount);
+		void setRenderDataArrayFromStream(int arrayType, int size, const float *stream, const unsigned int *indices, unsigned int indexCount);
+		
+		/**
+		* Gives every polygon that shares vertices from a loaded vertex block its own copies, restoring the per-polygon vertices meshes had before indexed loading. Per-face recalculations need this, or the last face to touch a shared vertex would win.
+		*/
+		void splitSharedVertices();
 					
 		VertexBuffer *vertexBuffer;
 		bool meshHasVertexBuffer;
 		int meshType;
 		std::vector <Polygon*> polygons;
+		
+		/**
+		* Vertices shared by the polygons of loaded meshes, one block per loadFromBuffer() call.
+		*/
+		std::vector<Vertex*> vertexBlocks;
 	};
 }
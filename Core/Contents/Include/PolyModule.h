@@ -11,8 +11,6 @@
 #include "PolyString.h"
 #include "PolyGlobals.h"
 
-class TiXmlNode;
-
 namespace Polycode {
 	
 	class Material;
@@ -20,6 +18,7 @@ namespace Polycode {
 	class Shader;
 	class ShaderBinding;
 	class Resource;
+	class XMLReader;
 	
 	class _PolyExport PolycodeModule {
 	public:
@@ -48,7 +47,11 @@ namespace Polycode {
 		virtual bool acceptsExtension(const String& extension) = 0;
 		virtual Resource* createProgramFromFile(const String& extension, const String& fullPath) = 0;
 		virtual String getShaderType() = 0;
-		virtual Shader *createShader(TiXmlNode *node) = 0;
+		
+		/**
+		* Creates a shader from a shader element of a material file. The reader is on the start of the element.
+		*/
+		virtual Shader *createShader(XMLReader *reader) = 0;
 	
 		virtual bool applyShaderMaterial(Renderer *renderer, Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) = 0;
 		bool hasShader(Shader *shader) { for(int i=0; i < shaders.size(); i++) { if(shaders[i] == shader){ return true; } } return false; }	
@@ -24,11 +24,50 @@
 #include "PolyGlobals.h"
 #include "PolyString.h"
 #include "OSBasics.h"
+#include <map>
+#include <string.h>
 
 class TiXmlElement;
 
 namespace Polycode {
 
+	/**
+	* Header of the binary object format (version 2). The header is followed by entryCount ObjectFileEntry records, stringCount ObjectFileString records and stringDataSize bytes of string data. Names and string values are stored once in the string table and referenced by index, string 0 is always the empty string.
+	*/
+	typedef struct {
+		char magic[4];
+		unsigned int version;
+		unsigned int entryCount;
+		unsigned int stringCount;
+		unsigned int stringDataSize;
+		unsigned int reserved;
+	} ObjectFileHeader;
+	
+	/**
+	* A single entry of a binary object file. Entries are stored breadth first starting with the root, so the children of an entry are the childCount records starting at firstChild. Which member of the value union is used depends on the type: numberValue for FLOAT_ENTRY, intValue for INT_ENTRY and BOOL_ENTRY and stringIndex for STRING_ENTRY.
+	*/
+	typedef struct {
+		unsigned int nameIndex;
+		int type;
+		unsigned int firstChild;
+		unsigned int childCount;
+		union {
+			double numberValue;
+			int intValue;
+			unsigned int stringIndex;
+		};
+	} ObjectFileEntry;
+	
+	typedef struct {
+		unsigned int offset;
+		unsigned int length;
+	} ObjectFileString;
+	
+	typedef struct {
+		unsigned int hash;
+		unsigned int position;
+	} ObjectEntryKey;
+
 	/**
 	* Single entry in an Object. Object entries can be accessed as dictionaries or arrays.
 	*/
@@ -202,9 +241,31 @@ namespace Polycode {
 		* @param key Lookup key to return value for.
 		* @return Object entry corresponding to the string value or NULL if one doesn't exist.
 		*/
-		inline ObjectEntry *operator [] ( const String& key) { for(int i=0; i < children.size(); i++) { if(children[i]->name == key) { return children[i]; } } return NULL; }
+		inline ObjectEntry *operator [] ( const String& key) { return getChild(key.c_str(), key.length()); }
+		
+		/**
+		* Accesses an object entry by a string lookup without creating a String for the key.
+		* @param key Lookup key to return value for.
+		* @return Object entry corresponding to the string value or NULL if one doesn't exist.
+		*/
+		inline ObjectEntry *operator [] ( const char *key) { return getChild(key, strlen(key)); }
+		
+		/**
+		* Returns the first child with the given name, or NULL if there isn't one. Entries with at least KEY_INDEX_THRESHOLD children find it through a hashed index of their children's names, which is built on the first lookup and rebuilt when the number of children changes. Call invalidateKeyIndex() after renaming or replacing children in place.
+		*/
+		POLYIGNORE ObjectEntry *getChild(const char *key, size_t keyLength);
+		
+		void invalidateKeyIndex();
+		
+		static const int KEY_INDEX_THRESHOLD = 8;
 		
 		std::vector<ObjectEntry*> children;
+		
+	protected:
+	
+		void buildKeyIndex();
+		
+		std::vector<ObjectEntryKey> keyIndex;
 	};
 	
 	/**
@@ -246,11 +307,18 @@ namespace Polycode {
 		void saveToBinary(const String& fileName);
 
 		/**
-		* Loads data from a binary file into the object. 
+		* Loads data from a binary file into the object. Reads both the current format and the older PBOF one.
 		* @param fileName Path to the binary file to load.
 		* @return Returns true is succesful, false if otherwise.
 		*/		
 		bool loadFromBinary(const String& fileName);
+		
+		/**
+		* Loads data from a binary or an XML file, whichever the file turns out to be.
+		* @param fileName Path to the file to load.
+		* @return Returns true is succesful, false if otherwise.
+		*/
+		bool loadFromFile(const String& fileName);
 
 		
 		void createFromXMLElement(TiXmlElement *element, ObjectEntry *entry);
@@ -269,8 +337,15 @@ namespace Polycode {
 			~BinaryObjectReader();			
 			
 			bool success;				
+			static const unsigned int OBJECT_FILE_VERSION = 2;
+			
 		protected:
 		
+			/**
+			* Builds the object from a version 2 file in one pass over its data.
+			*/
+			bool readBuffer(const char *data, size_t size);
+		
 			bool parseEntryFromFile(ObjectEntry *entry);
 			String getKeyByIndex(unsigned int index);
 			
@@ -282,23 +357,23 @@ namespace Polycode {
 
 	};
 		
+	/**
+	* Writes an object in the version 2 binary format.
+	*/
 	class _PolyExport BinaryObjectWriter {
 		public:
 			BinaryObjectWriter(Object *object);
 			~BinaryObjectWriter();
 			
-			void parseKeysFromObjectEntry(ObjectEntry *entry);
-			void writeEntryToFile(ObjectEntry *entry);
-			
-			unsigned int addKey(const String &key);			
-			unsigned int getKeyIndex(const String &key);
-			
 			bool writeToFile(const String& fileName);			
 			
 		protected:
-			OSFILE *outFile;
-			int numEntriesWritten;
-			std::vector<String> keys;			
+		
+			unsigned int addString(const String &str);
+			
+			std::map<std::string, unsigned int> stringIndices;
+			std::vector<ObjectFileString> strings;
+			std::string stringData;
 			Object *object;
 	};
 
@@ -39,6 +39,9 @@ namespace Polycode {
 			
 			void createSceneParticle(int particleType, Material *material, Mesh *particleMesh);
 			void createScreenParticle(int particleType, Texture *texture, Mesh *particleMesh);
+			
+			static void *operator new(size_t size);
+			static void operator delete(void *ptr);
 		
 			Entity *particleBody;						
 			
@@ -84,7 +84,11 @@ namespace Polycode {
 			virtual void handlePacket(Packet *packet, PeerConnection *connection){};
 			virtual void handlePeerConnection(PeerConnection *connection){};
 		
+			/**
+			* Creates a packet from the packet pool. Release it with releasePacket().
+			*/
 			Packet *createPacket(const Address &target, char *data, unsigned int size, unsigned short type);
+			static void releasePacket(Packet *packet);
 
 			void sendData(const Address &target, char *data, unsigned int size, unsigned short type);
 			void sendReliableData(const Address &target, char *data, unsigned int size, unsigned short type);
@@ -82,7 +82,7 @@ namespace Polycode {
 			void addVertex(Vertex *vertex);
 
 			/**
-			* Removes and deletes the vertex at specified index. 
+			* Removes the vertex at specified index, and deletes it if the polygon owns its vertices.
 			* @param index to remove vertex at.
 			*/
 			void removeVertex(int index);
@@ -122,6 +122,11 @@ namespace Polycode {
 			* If true, will use vertex normals, if false will use the polygon normal.
 			*/
 			bool useVertexNormals;
+
+			/**
+			* If true, the polygon deletes its vertices when it is deleted or they are removed. Meshes loaded from mesh files share vertices between polygons and set this to false.
+			*/
+			bool ownsVertices;
 		
 			/**
 			* Flips the texture coordinate vertically.
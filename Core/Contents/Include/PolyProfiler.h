@@ -0,0 +1,254 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+
+#define POLY_PROFILE_CONCAT_(a, b) a##b
+#define POLY_PROFILE_CONCAT(a, b) POLY_PROFILE_CONCAT_(a, b)
+
+#ifdef POLYCODE_DISABLE_PROFILER
+	#define POLY_PROFILE_ZONE(name)
+	#define POLY_PROFILE_COUNT(counter, amount)
+#else
+	/**
+	* Profiles the rest of the enclosing scope as a zone with the given name. The name must be a string literal or otherwise outlive the profiler.
+	*/
+	#define POLY_PROFILE_ZONE(name) Polycode::ProfilerZone POLY_PROFILE_CONCAT(__polyProfilerZone, __LINE__)(name)
+
+	/**
+	* Adds to one of the per frame profiler counters.
+	*/
+	#define POLY_PROFILE_COUNT(counter, amount) Polycode::Profiler::addCount(counter, amount)
+#endif
+
+namespace Polycode {
+
+	/**
+	* A single timed zone recorded by the profiler. Times are in microseconds since the profiler was first used.
+	*/
+	class _PolyExport ProfilerEvent {
+		public:
+			const char *name;
+			unsigned long long startTime;
+			unsigned long long endTime;
+			unsigned int depth;
+			unsigned int frame;
+	};
+
+	/**
+	* Ring buffer of profiler events owned by a single thread. Only the owning thread writes to it, so recording a zone never takes a lock.
+	*/
+	class _PolyExport ProfilerThreadBuffer {
+		public:
+			ProfilerThreadBuffer(unsigned int threadIndex);
+			~ProfilerThreadBuffer();
+
+			static const unsigned int EVENTS_PER_THREAD = 4096;
+
+			POLYIGNORE ProfilerEvent events[EVENTS_PER_THREAD];
+
+			/**
+			* Total number of events ever started on this thread. The next event goes into events[writeIndex % EVENTS_PER_THREAD].
+			*/
+			volatile unsigned int writeIndex;
+			unsigned int depth;
+			unsigned int threadIndex;
+	};
+
+	/**
+	* Time spent in a named zone during one frame.
+	*/
+	class _PolyExport ProfilerZoneStats {
+		public:
+			const char *name;
+
+			/**
+			* Number of times the zone was entered during the frame.
+			*/
+			unsigned int callCount;
+
+			/**
+			* Total time spent in the zone in milliseconds, including nested zones.
+			*/
+			Number totalTime;
+
+			/**
+			* Time spent in the zone in milliseconds, excluding nested zones.
+			*/
+			Number selfTime;
+	};
+
+	/**
+	* Aggregated profiler results for a single frame.
+	*/
+	class _PolyExport ProfilerFrameStats {
+		public:
+			ProfilerFrameStats();
+
+			unsigned int frame;
+
+			/**
+			* Frame time in milliseconds, from Profiler::beginFrame() to Profiler::endFrame().
+			*/
+			Number frameTime;
+
+			std::vector<ProfilerZoneStats> zones;
+
+			/**
+			* Counter values for the frame, indexed by the Profiler::COUNTER_ constants.
+			*/
+			unsigned int counters[5];
+	};
+
+	/**
+	* Built in hierarchical frame profiler. Zones are recorded with the POLY_PROFILE_ZONE macro into lock free per thread ring buffers, aggregated per frame on the main thread and can be exported as a Chrome trace (open it in chrome://tracing). When the profiler is disabled, which is the default, a zone costs a single branch. Define POLYCODE_DISABLE_PROFILER to compile the zones out entirely.
+	*/
+	class _PolyExport Profiler {
+		public:
+
+			/**
+			* Enables or disables profiling.
+			*/
+			static void setEnabled(bool val);
+			static bool isEnabled() { return enabled; }
+
+			/**
+			* Starts a new frame. Called by Core at the beginning of every update. The thread that calls this is treated as the main thread for the per frame aggregates.
+			*/
+			static void beginFrame();
+
+			/**
+			* Ends the current frame and aggregates its zones and counters. Called by Core at the end of every update.
+			*/
+			static void endFrame();
+
+			/**
+			* Returns the aggregated results of the last finished frame.
+			*/
+			static const ProfilerFrameStats &getLastFrameStats() { return lastFrameStats; }
+
+			/**
+			* Adds to a per frame counter.
+			* @param counter One of the COUNTER_ constants.
+			* @param amount Amount to add.
+			*/
+			static void addCount(int counter, unsigned int amount) {
+				if(enabled)
+					counters[counter] += amount;
+			}
+
+			/**
+			* Sets a per frame counter.
+			* @param counter One of the COUNTER_ constants.
+			* @param value New counter value.
+			*/
+			static void setCount(int counter, unsigned int value) {
+				if(enabled)
+					counters[counter] = value;
+			}
+
+			/**
+			* Writes every event still in the ring buffers, along with the per frame counters, as Chrome trace event JSON.
+			* @param fileName Path of the file to write.
+			* @return True if the file was written.
+			*/
+			static bool exportChromeTrace(const String& fileName);
+
+			/**
+			* Returns the profiler clock in microseconds.
+			*/
+			static unsigned long long getTime();
+
+			static unsigned int beginZone(const char *name);
+			static void endZone(unsigned int eventIndex);
+
+			/**
+			* Records a zone that was measured rather than scoped, such as a sample from the script profiler. The zone is nested in the zone currently open on the calling thread.
+			* @param name Name of the zone. Must outlive the profiler.
+			* @param startTime Start of the zone, from getTime().
+			* @param endTime End of the zone, from getTime().
+			* @return Index of the event, which can be passed to extendZone().
+			*/
+			static unsigned int addZone(const char *name, unsigned long long startTime, unsigned long long endTime);
+
+			/**
+			* Moves the end of a zone recorded with addZone().
+			*/
+			static void extendZone(unsigned int eventIndex, unsigned long long endTime);
+
+			static const int COUNTER_ENTITIES_VISITED = 0;
+			static const int COUNTER_DRAW_CALLS = 1;
+			static const int COUNTER_VERTICES = 2;
+			static const int COUNTER_EVENTS_DISPATCHED = 3;
+			static const int COUNTER_ALLOCATIONS = 4;
+			static const int NUM_COUNTERS = 5;
+
+			static const int MAX_THREADS = 32;
+			static const int FRAME_HISTORY_SIZE = 256;
+
+		protected:
+
+			static ProfilerThreadBuffer *getThreadBuffer();
+			static void aggregateFrame(unsigned long long frameEndTime);
+
+			static bool enabled;
+			static bool frameActive;
+			static unsigned int frame;
+			static unsigned long long frameStartTime;
+			static unsigned int frameStartIndex;
+			static ProfilerThreadBuffer *mainThreadBuffer;
+
+			static unsigned int counters[NUM_COUNTERS];
+			static ProfilerFrameStats lastFrameStats;
+
+			static unsigned long long counterHistoryTimes[FRAME_HISTORY_SIZE];
+			static unsigned int counterHistory[FRAME_HISTORY_SIZE][NUM_COUNTERS];
+			static unsigned int counterHistoryCount;
+
+			static ProfilerThreadBuffer *threadBuffers[MAX_THREADS];
+			static volatile long numThreadBuffers;
+	};
+
+	/**
+	* Records a profiler zone for its lifetime. Use the POLY_PROFILE_ZONE macro instead of creating these directly.
+	*/
+	class _PolyExport ProfilerZone {
+		public:
+			ProfilerZone(const char *name) {
+				active = Profiler::isEnabled();
+				if(active)
+					eventIndex = Profiler::beginZone(name);
+			}
+
+			~ProfilerZone() {
+				if(active)
+					Profiler::endZone(eventIndex);
+			}
+
+		protected:
+			bool active;
+			unsigned int eventIndex;
+	};
+}
@@ -0,0 +1,277 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+#include "PolyMesh.h"
+#include <vector>
+
+namespace Polycode {
+
+	class RecordingRenderer;
+
+	/**
+	* A single command recorded by the RecordingRenderer.
+	*/
+	class _PolyExport RenderCommand {
+		public:
+			RenderCommand();
+
+			/**
+			* Command type. One of the COMMAND_ constants.
+			*/
+			int type;
+
+			/**
+			* For draw commands, the mesh type that was drawn. For state commands, the state that was changed (one of the RecordingRenderer::STATE_ constants).
+			*/
+			int param;
+
+			/**
+			* For draw commands, the number of vertices drawn. For state commands, the new value of the state. For texture uploads, the number of bytes uploaded. For sprite batches, the number of meshes in the batch.
+			*/
+			int value;
+
+			/**
+			* Texture, material or vertex buffer the command refers to, if any.
+			*/
+			const void *target;
+
+			static const int COMMAND_DRAW_ARRAYS = 0;
+			static const int COMMAND_DRAW_VERTEX_BUFFER = 1;
+			static const int COMMAND_SET_STATE = 2;
+			static const int COMMAND_BIND_TEXTURE = 3;
+			static const int COMMAND_UPLOAD_TEXTURE = 4;
+			static const int COMMAND_APPLY_MATERIAL = 5;
+			static const int COMMAND_CLEAR = 6;
+
+			/**
+			* Recorded after the draw call of a batch drawn by a ScreenSpriteBatcher.
+			*/
+			static const int COMMAND_SPRITE_BATCH = 7;
+	};
+
+	/**
+	* Texture created by the RecordingRenderer. Keeps its pixel data in memory and reports uploads to the renderer.
+	*/
+	class _PolyExport RecordingTexture : public Texture {
+		public:
+			RecordingTexture(RecordingRenderer *renderer, unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA);
+			virtual ~RecordingTexture();
+
+			void setTextureData(char *data);
+			void recreateFromImageData();
+
+		protected:
+			RecordingRenderer *renderer;
+	};
+
+	/**
+	* Vertex buffer created by the RecordingRenderer. Only keeps track of the vertex count.
+	*/
+	class _PolyExport RecordingVertexBuffer : public VertexBuffer {
+		public:
+			RecordingVertexBuffer(Mesh *mesh);
+			virtual ~RecordingVertexBuffer();
+	};
+
+	/**
+	* Renderer that doesn't need a graphics context. It uses the CPU side matrix stacks of the base Renderer, and every draw call, render state change and texture upload is recorded into a command stream that can be inspected after a frame. Render state is shadowed the same way OpenGLRenderer shadows it, so only changes that would have reached the graphics API are recorded. Use it together with HeadlessCore to run and benchmark scenes without a GPU or a window. If recording is disabled, it acts as a null renderer and only keeps the counters.
+	*/
+	class _PolyExport RecordingRenderer : public Renderer {
+
+	public:
+
+		RecordingRenderer();
+		virtual ~RecordingRenderer();
+
+		void Resize(int xRes, int yRes);
+
+		void BeginRender();
+		void EndRender();
+
+		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
+		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA);
+		void destroyTexture(Texture *texture);
+		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer);
+
+		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
+		void bindFrameBufferTexture(Texture *texture);
+		void unbindFramebuffers();
+
+		Image *renderScreenToImage();
+		void resetViewport();
+
+		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f, bool centered = false);
+		void _setOrthoMode(Number orthoSizeX, Number orthoSizeY);
+		void setPerspectiveMode();
+
+		void setTexture(Texture *texture);
+		void enableBackfaceCulling(bool val);
+
+		void setClearColor(Number r, Number g, Number b);
+		void clearScreen();
+
+		void setVertexColor(Number r, Number g, Number b, Number a);
+
+		void pushRenderDataArray(RenderDataArray *array);
+		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
+		RenderDataArray *createRenderDataArray(int arrayType);
+		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
+		void drawArrays(int drawType);
+
+		void setLineSmooth(bool val);
+		void setLineSize(Number lineSize);
+
+		void enableLighting(bool enable);
+
+		void enableFog(bool enable);
+		void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth);
+
+		void setBlendingMode(int blendingMode);
+
+		void applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex);
+		void clearShader();
+
+		void setDepthFunction(int depthFunction);
+
+		void createVertexBufferForMesh(Mesh *mesh);
+		void drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer);
+
+		void enableDepthTest(bool val);
+		void enableDepthWrite(bool val);
+
+		void setClippingPlanes(Number nearPlane_, Number farPlane_);
+
+		void enableAlphaTest(bool val);
+
+		void clearBuffer(bool colorBuffer, bool depthBuffer);
+		void drawToColorBuffer(bool val);
+
+		void drawScreenQuad(Number qx, Number qy);
+
+		void cullFrontFaces(bool val);
+		void setDitherFade(Number amount, bool inverted);
+
+		Vector3 projectRayFrom2DCoordinate(Number x, Number y);
+		Vector3 Unproject(Number x, Number y);
+
+		/**
+		* Enables or disables command recording. Counters are kept either way.
+		* @param val If true, commands are recorded.
+		*/
+		void setRecording(bool val);
+
+		/**
+		* Returns true if commands are being recorded.
+		*/
+		bool isRecording() const { return recording; }
+
+		/**
+		* Returns the number of commands recorded since the beginning of the current frame.
+		*/
+		int getNumCommands() const { return commands.size(); }
+
+		/**
+		* Returns a recorded command.
+		* @param index Index of the command to return.
+		*/
+		const RenderCommand &getCommand(int index) const { return commands[index]; }
+
+		/**
+		* Returns the number of recorded commands of a specific type.
+		* @param type Command type. One of the RenderCommand::COMMAND_ constants.
+		*/
+		int getNumCommandsOfType(int type) const;
+
+		/**
+		* Clears the recorded command stream. This is done automatically in BeginRender.
+		*/
+		void clearCommands();
+
+		/**
+		* Returns the number of vertices drawn since the last call to resetRenderStats().
+		*/
+		unsigned int getVerticesDrawn() const { return verticesDrawn; }
+		
+		/**
+		* Returns the number of triangles drawn since the last call to resetRenderStats(). Quads count as two triangles, and lines and points aren't counted.
+		*/
+		unsigned int getTrianglesDrawn() const { return trianglesDrawn; }
+
+		/**
+		* Returns the number of texture uploads since the last call to resetRenderStats().
+		*/
+		unsigned int getTextureUploadCount() const { return textureUploadCount; }
+
+		/**
+		* Records a texture upload. Called by RecordingTexture.
+		* @param texture Texture that was uploaded.
+		* @param numBytes Size of the uploaded data.
+		*/
+		void recordTextureUpload(Texture *texture, int numBytes);
+		
+		void recordSpriteBatch(unsigned int numMeshes);
+		void resetRenderStats();
+
+		static const int STATE_DEPTH_TEST = 0;
+		static const int STATE_DEPTH_WRITE = 1;
+		static const int STATE_ALPHA_TEST = 2;
+		static const int STATE_BACKFACE_CULLING = 3;
+		static const int STATE_BLENDING_MODE = 4;
+		static const int STATE_TEXTURING = 5;
+		static const int STATE_VERTEX_COLOR = 6;
+		static const int STATE_DEPTH_FUNCTION = 7;
+		static const int STATE_CULL_FRONT_FACES = 8;
+		static const int STATE_FOG = 9;
+		static const int STATE_LINE_SMOOTH = 10;
+		static const int STATE_COLOR_BUFFER = 11;
+		
+		/**
+		* Dither fade coverage in sixteenths, plus 32 for the inverted pattern. 16 means the fade is off.
+		*/
+		static const int STATE_DITHER_FADE = 12;
+		static const int NUM_STATES = 13;
+
+	protected:
+
+		void recordCommand(int type, int param, int value, const void *target);
+		void setState(int state, int value);
+		void recordDraw(int commandType, int drawType, int vertexCount, const void *target);
+		void invalidateStateCache();
+
+		bool recording;
+		std::vector<RenderCommand> commands;
+
+		int cachedStates[NUM_STATES];
+
+		Number nearPlane;
+		Number farPlane;
+
+		int verticesToDraw;
+		unsigned int verticesDrawn;
+		unsigned int trianglesDrawn;
+		unsigned int textureUploadCount;
+	};
+}
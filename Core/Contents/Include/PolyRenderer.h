@@ -61,6 +61,16 @@ namespace Polycode {
 			int lightImportance;
 	};
 
+	/**
+	* An entry on the renderer's matrix stacks. It keeps the single precision copy of the matrix that is uploaded to the graphics API, so popping the stack restores it without converting the matrix again.
+	*/
+	class _PolyExport RenderMatrixStackEntry {
+		public:
+			Matrix4 matrix;
+			float uploadMatrix[16];
+			bool uploadMatrixValid;
+	};
+
 	class _PolyExport LightSorter {
 		public:
 			Vector3 basePosition;
@@ -89,6 +99,17 @@ namespace Polycode {
 		
 		virtual Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) = 0;		
 		virtual Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA) = 0;
+		
+		/**
+		* Creates a mipmapped texture from an already generated mipmap chain, such as the levels of a CookedTexture. By default, only the first level is used and the renderer generates the rest.
+		* @param width Width of the first level.
+		* @param height Height of the first level.
+		* @param levelData Pixel data of each level. Every level is half the size of the previous one, down to 1x1.
+		* @param numLevels Number of levels.
+		* @param clamp If true, the texture is clamped at the edges.
+		* @param type Image type of the pixel data.
+		*/
+		virtual Texture *createTextureWithMipmaps(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int type=Image::IMAGE_RGBA);
 		virtual void destroyTexture(Texture *texture) = 0;
 		virtual void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer) = 0;
 		
@@ -99,11 +120,16 @@ namespace Polycode {
 		virtual Image *renderScreenToImage() = 0;
 		
 		void setFOV(Number fov);		
+		
+		/**
+		* Returns the vertical field of view of the perspective projection in degrees.
+		*/
+		Number getFOV();
 		void setViewportSize(int w, int h);
 		void setViewportSizeAndFOV(int w, int h, Number fov);
 		virtual void resetViewport() = 0;
 				
-		virtual void loadIdentity() = 0;		
+		virtual void loadIdentity();
 		virtual void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f, bool centered = false) = 0;
 		virtual void _setOrthoMode(Number orthoSizeX, Number orthoSizeY) = 0;
 		virtual void setPerspectiveMode() = 0;
@@ -118,9 +144,9 @@ namespace Polycode {
 		
 		virtual void clearScreen() = 0;
 		
-		virtual void translate2D(Number x, Number y) = 0;
-		virtual void rotate2D(Number angle) = 0;
-		virtual void scale2D(Vector2 *scale) = 0;
+		virtual void translate2D(Number x, Number y);
+		virtual void rotate2D(Number angle);
+		virtual void scale2D(Vector2 *scale);
 			
 		
 		virtual void setVertexColor(Number r, Number g, Number b, Number a) = 0;
@@ -133,12 +159,12 @@ namespace Polycode {
 		virtual void setRenderArrayData(RenderDataArray *array, Number *arrayData) = 0;
 		virtual void drawArrays(int drawType) = 0;
 		
-		virtual void translate3D(Vector3 *position) = 0;
-		virtual void translate3D(Number x, Number y, Number z) = 0;
-		virtual void scale3D(Vector3 *scale) = 0;
+		virtual void translate3D(Vector3 *position);
+		virtual void translate3D(Number x, Number y, Number z);
+		virtual void scale3D(Vector3 *scale);
 		
-		virtual void pushMatrix() = 0;
-		virtual void popMatrix() = 0;
+		virtual void pushMatrix();
+		virtual void popMatrix();
 		
 		virtual void setLineSmooth(bool val) = 0;
 		virtual void setLineSize(Number lineSize) = 0;
@@ -148,8 +174,43 @@ namespace Polycode {
 		virtual void enableFog(bool enable) = 0;
 		virtual void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth) = 0;
 				
-		virtual void multModelviewMatrix(Matrix4 m) = 0;
-		virtual void setModelviewMatrix(Matrix4 m) = 0;
+		virtual void multModelviewMatrix(Matrix4 m);
+		virtual void setModelviewMatrix(Matrix4 m);
+		
+		/**
+		* Replaces the current projection matrix.
+		* @param m New projection matrix.
+		*/
+		void setProjectionMatrix(const Matrix4 &m);
+		
+		/**
+		* Saves the current projection matrix on the projection stack.
+		*/
+		void pushProjectionMatrix();
+		
+		/**
+		* Restores the projection matrix saved by the last call to pushProjectionMatrix().
+		*/
+		void popProjectionMatrix();
+		
+		/**
+		* Returns the projection matrix that was active the last time the renderer switched to perspective mode. Used for picking.
+		*/
+		Matrix4 getSceneProjectionMatrix() const { return sceneProjectionMatrix; }
+		
+		/**
+		* Builds the same perspective projection matrix as gluPerspective.
+		* @param fov Vertical field of view in degrees.
+		* @param aspect Width to height ratio of the viewport.
+		* @param nearPlane Distance to the near clipping plane.
+		* @param farPlane Distance to the far clipping plane.
+		*/
+		static Matrix4 createPerspectiveMatrix(Number fov, Number aspect, Number nearPlane, Number farPlane);
+		
+		/**
+		* Builds the same orthographic projection matrix as glOrtho.
+		*/
+		static Matrix4 createOrthoMatrix(Number left, Number right, Number bottom, Number top, Number nearPlane, Number farPlane);
 		
 		void setCurrentModelMatrix(Matrix4 m) { currentModelMatrix = m; }
 		Matrix4 getCurrentModelMatrix() { return currentModelMatrix; }
@@ -203,6 +264,25 @@ namespace Polycode {
 		
 		virtual void cullFrontFaces(bool val) = 0;
 		
+		/**
+		* Draws only part of the pixels of the following primitives, in an ordered dither pattern, to fade geometry in or out without blending or sorting. A fade of some amount and an inverted fade of one minus that amount cover complementary pixels, so they can be used to cross-fade between two versions of a mesh. Renderers without support for it draw every pixel.
+		* @param amount Fraction of the pixels to draw, from 0 to 1. Pass 1 to draw every pixel again.
+		* @param inverted If true, uses the complementary pattern.
+		*/
+		virtual void setDitherFade(Number amount, bool inverted);
+		
+		/**
+		* Sets the view that levels of detail are selected for while the current scene renders. Called by Scene::Render() before its entities are drawn.
+		* @param cameraPosition Position of the camera in world space.
+		* @param projectionScale Number of pixels a unit covers at a distance of one from a perspective camera, or at any distance from an orthographic one. 0 disables selection.
+		* @param orthographic True if the camera is orthographic, in which case distance doesn't matter.
+		*/
+		void setLODView(const Vector3 &cameraPosition, Number projectionScale, bool orthographic);
+		
+		const Vector3& getLODCameraPosition() const { return lodCameraPosition; }
+		Number getLODProjectionScale() const { return lodProjectionScale; }
+		bool getLODOrthographic() const { return lodOrthographic; }
+		
 		void clearLights();
 		void addLight(int lightImportance, Vector3 position, Vector3 direction, int type, Color color, Color specularColor, Number constantAttenuation, Number linearAttenuation, Number quadraticAttenuation, Number intensity, Number spotlightCutoff, Number spotlightExponent, bool shadowsEnabled, Matrix4 *textureMatrix, Texture *shadowMapTexture);
 		
@@ -226,8 +306,15 @@ namespace Polycode {
 		
 		virtual bool test2DCoordinateInPolygon(Number x, Number y, Polygon *poly, const Matrix4 &matrix, bool ortho, bool testBackfacing, bool billboardMode, bool reverseDirection = false, Matrix4 *adjustMatrix = NULL);
 		
-		virtual Matrix4 getProjectionMatrix() = 0;
-		virtual Matrix4 getModelviewMatrix() = 0;
+		/**
+		* Returns the current projection matrix. The renderer keeps its own copy, so this never reads back from the graphics API.
+		*/
+		virtual Matrix4 getProjectionMatrix();
+		
+		/**
+		* Returns the current modelview matrix. The renderer keeps its own copy, so this never reads back from the graphics API.
+		*/
+		virtual Matrix4 getModelviewMatrix();
 		
 		static const int RENDER_MODE_NORMAL = 0;
 		static const int RENDER_MODE_WIREFRAME = 1;
@@ -267,10 +354,72 @@ namespace Polycode {
 		std::vector<LightInfo> getAreaLights() { return areaLights; }
 		std::vector<LightInfo> getSpotLights() { return spotLights;	}
 		
+		/**
+		* Returns the number of draw calls issued since the last call to resetRenderStats().
+		*/
+		unsigned int getDrawCallCount() const { return drawCallCount; }
+		
+		/**
+		* Returns the number of render state changes that reached the graphics API since the last call to resetRenderStats(). State changes that were skipped because the state was already set are not counted.
+		*/
+		unsigned int getStateChangeCount() const { return stateChangeCount; }
+		
+		/**
+		* Returns the number of sprite batches drawn since the last call to resetRenderStats().
+		*/
+		unsigned int getSpriteBatchCount() const { return spriteBatchCount; }
+		
+		/**
+		* Returns the number of meshes drawn as part of sprite batches since the last call to resetRenderStats().
+		*/
+		unsigned int getBatchedMeshCount() const { return batchedMeshCount; }
+		
+		/**
+		* Counts a batch drawn by a ScreenSpriteBatcher. Called right after the batch's draw call.
+		* @param numMeshes Number of meshes in the batch.
+		*/
+		virtual void recordSpriteBatch(unsigned int numMeshes);
+		
+		/**
+		* Resets the draw call, state change and sprite batch counters.
+		*/
+		virtual void resetRenderStats();
+		
 		bool doClearBuffer;
 				
 	protected:	
 	
+		Vector3 unprojectPoint(Number x, Number y, Number z, const Matrix4 &modelview, const Matrix4 &projection);
+	
+		Matrix4 modelviewMatrix;
+		Matrix4 projectionMatrix;
+		Matrix4 sceneProjectionMatrix;
+		std::vector<RenderMatrixStackEntry> modelviewStack;
+		std::vector<RenderMatrixStackEntry> projectionStack;
+		
+		/**
+		* Returns the modelview matrix in single precision for uploading, converting it only if it changed since the last call.
+		*/
+		const float *getModelviewUploadMatrix();
+		
+		/**
+		* Returns the projection matrix in single precision for uploading, converting it only if it changed since the last call.
+		*/
+		const float *getProjectionUploadMatrix();
+		
+		float modelviewUploadMatrix[16];
+		float projectionUploadMatrix[16];
+		bool modelviewUploadMatrixValid;
+		bool projectionUploadMatrixValid;
+		
+		bool modelviewMatrixDirty;
+		bool projectionMatrixDirty;
+	
+		unsigned int drawCallCount;
+		unsigned int stateChangeCount;
+		unsigned int spriteBatchCount;
+		unsigned int batchedMeshCount;
+	
 		bool scissorEnabled;
 		
 		Polycode::Rectangle scissorBox;
@@ -296,6 +445,10 @@ namespace Polycode {
 		int renderMode;
 		
 		Matrix4 cameraMatrix;
+		
+		Vector3 lodCameraPosition;
+		Number lodProjectionScale;
+		bool lodOrthographic;
 	
 		PolycodeShaderModule* currentShaderModule;
 		std::vector <PolycodeShaderModule*> shaderModules;
@@ -49,6 +49,11 @@ namespace Polycode {
 			void setResourcePath(const String& path);
 			const String& getResourcePath() const;
 
+			/**
+			* Returns a number that identifies this resource for as long as it exists, assigned when it is created. Scenes use it to group draws that share a shader, material or texture without looking the resource up.
+			*/
+			unsigned int getResourceID() const { return resourceID; }
+
 			static const int RESOURCE_TEXTURE = 0;
 			static const int RESOURCE_MATERIAL = 1;
 			static const int RESOURCE_SHADER = 2;
@@ -63,6 +68,9 @@ namespace Polycode {
 			int type;
 			String resourcePath;
 			String name;
+			unsigned int resourceID;
+			
+			static unsigned int nextResourceID;
 	
 					
 	};
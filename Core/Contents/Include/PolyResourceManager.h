@@ -30,6 +30,7 @@ namespace Polycode {
 	class Resource;
 	class PolycodeShaderModule;
 	class String;
+	class XMLReader;
 
 	/**
 	* Manages loading and unloading of resources from directories and archives. Should only be accessed via the CoreServices singleton. 
@@ -87,6 +88,17 @@ namespace Polycode {
 		
 			void addShaderModule(PolycodeShaderModule *module);
 		
+		protected:
+		
+			/**
+			* Opens every material file in a directory and reads them all in parallel on the core's job pool with XMLFileParser. Files that can't be read are logged and left out.
+			*/
+			std::vector<XMLReader*> readMaterialFiles(const String& dirPath, bool recursive);
+			void findMaterialFiles(const String& dirPath, bool recursive, std::vector<XMLReader*> *readers);
+			
+			void parseShaders(XMLReader *reader);
+			void parseCubemaps(XMLReader *reader);
+			void parseMaterials(XMLReader *reader);
 		
 		private:
 			std::vector <Resource*> resources;
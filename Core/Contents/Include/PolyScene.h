@@ -37,6 +37,74 @@ namespace Polycode {
 	class SceneEntity;
 	class SceneLight;
 	class SceneMesh;
+	class Mesh;
+	
+	/**
+	* Render queue record for a top level scene entity. The sort key packs the render pass, blending mode, shader, material, texture and camera distance so that sorting the queue groups entities by render state.
+	*/
+	class _PolyExport RenderQueueEntry {
+		public:
+			bool operator<(const RenderQueueEntry &other) const { return sortKey < other.sortKey; }
+			
+			unsigned long long sortKey;
+			SceneEntity *entity;
+	};
+	
+	/**
+	* Header of the binary scene format (version 1). The header is followed by the mesh blocks of the scene, each a complete chunked mesh (a MeshFileHeader and its data block) starting at a 16 byte aligned offset, and then by the tables: meshCount SceneFileMesh records, objectCount SceneFileObject records, propCount SceneFileProp records and stringCount SceneFileString records, followed by stringDataSize bytes of string data. All offsets are from the start of the file.
+	*
+	* Objects that use the same mesh reference the same mesh block, so the mesh is only stored and decoded once. Strings are stored once in the string table and referenced by index, string 0 is always the empty string.
+	*/
+	typedef struct {
+		char magic[4];
+		unsigned int version;
+		unsigned int flags;
+		float clearColor[3];
+		float ambientColor[3];
+		unsigned int meshCount;
+		unsigned int meshTableOffset;
+		unsigned int objectCount;
+		unsigned int objectTableOffset;
+		unsigned int propCount;
+		unsigned int propTableOffset;
+		unsigned int stringCount;
+		unsigned int stringTableOffset;
+		unsigned int stringDataSize;
+	} SceneFileHeader;
+	
+	/**
+	* Location of a mesh block in a binary scene file.
+	*/
+	typedef struct {
+		unsigned int offset;
+		unsigned int size;
+	} SceneFileMesh;
+	
+	/**
+	* An object in a binary scene file. meshIndex, materialIndex, color and lightmapIndex are only used by ENTITY_MESH objects and entityTypeIndex only by ENTITY_ENTITY objects. The properties of the object are the propCount records starting at firstProp. The rotation is stored as w, x, y, z.
+	*/
+	typedef struct {
+		unsigned int type;
+		float position[3];
+		float rotation[4];
+		float color[4];
+		unsigned int meshIndex;
+		unsigned int materialIndex;
+		unsigned int lightmapIndex;
+		unsigned int entityTypeIndex;
+		unsigned int firstProp;
+		unsigned int propCount;
+	} SceneFileObject;
+	
+	typedef struct {
+		unsigned int nameIndex;
+		unsigned int valueIndex;
+	} SceneFileProp;
+	
+	typedef struct {
+		unsigned int offset;
+		unsigned int length;
+	} SceneFileString;
 	
 	/**
 	* 3D rendering container. The Scene class is the main container for all 3D rendering in Polycode. Scenes are automatically rendered and need only be instantiated to immediately add themselves to the rendering pipeline. A Scene is created with a camera automatically.
@@ -134,7 +202,15 @@ namespace Polycode {
 		void Render(Camera *targetCamera = NULL);
 		void RenderDepthOnly(Camera *targetCamera);
 		
+		/**
+		* Reads a string stored as its length followed by its characters. Reading stops at the end of the file, so a corrupt length can't make it read or allocate more than the file holds.
+		*/
 		static String readString(OSFILE *inFile);
+		
+		/**
+		* Loads a scene file. Files in the binary scene format written by saveScene() are loaded by decoding their meshes on the core's job pool, while the entities are created on the calling thread. Files in the older format are read one object at a time.
+		* @param fileName Path to the scene file.
+		*/
 		void loadScene(const String& fileName);
 		void generateLightmaps(Number lightMapRes, Number lightMapQuality, int numRadPasses);
 		
@@ -154,6 +230,11 @@ namespace Polycode {
 		
 		void writeEntityMatrix(SceneEntity *entity, OSFILE *outFile);
 		void writeString(const String& str, OSFILE *outFile);
+		
+		/**
+		* Saves the static geometry and custom entities of the scene in the binary scene format. Scene meshes that share a Mesh share its mesh block in the file.
+		* @param fileName Path to the file to save to.
+		*/
 		void saveScene(const String& fileName);
 		
 		int getNumStaticGeometry();
@@ -173,6 +254,9 @@ namespace Polycode {
 		static const unsigned int ENTITY_ENTITY = 3;
 		static const unsigned int ENTITY_COLLMESH = 4;
 		
+		static const unsigned int SCENE_FILE_VERSION = 1;
+		static const unsigned int SCENE_FILE_HAS_LIGHTMAPS = 1;
+		
 		/**
 		* Scene clear color
 		*/ 
@@ -203,8 +287,25 @@ namespace Polycode {
 		*/
 		bool ownsChildren;
 		
+		/**
+		* If set to true (default), visible top level entities are sorted by render state before they are drawn. Opaque entities are grouped by blending mode, shader, material and texture and drawn front to back, entities that don't write depth or are translucent are drawn back to front after them, and entities that don't depth test are drawn last in the order they were added. Set to false to draw entities in the order they were added.
+		*/
+		bool sortRenderQueue;
+		
+		static const int RENDER_PASS_OPAQUE = 0;
+		static const int RENDER_PASS_BLENDED = 1;
+		static const int RENDER_PASS_OVERLAY = 2;
+		
 	protected:
 		
+		void readLegacyScene(OSFILE *inFile);
+		bool readSceneBuffer(const char *data, size_t size);
+		void finishLoadedEntity(SceneEntity *entity, unsigned int objectType, const Number *position, const Number *rotation);
+		
+		unsigned long long getRenderSortKey(SceneEntity *entity, const Vector3 &cameraPosition, unsigned int submissionIndex);
+		
+		std::vector<RenderQueueEntry> renderQueue;
+		
 		bool hasLightmaps;
 		
 		std::vector <SceneLight*> lights;
@@ -212,6 +313,11 @@ namespace Polycode {
 		std::vector <SceneMesh*> collisionGeometry;
 		std::vector <SceneEntity*> customEntities;
 		
+		/**
+		* Meshes loaded from a scene file that are used by more than one scene mesh. The scene meshes don't own them, they are deleted with the scene.
+		*/
+		std::vector <Mesh*> sharedMeshes;
+		
 		
 		bool isSceneVirtual;
 		
@@ -24,6 +24,7 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "PolySceneEntity.h"
 #include "PolyShader.h"
+#include "PolyMesh.h"
 
 namespace Polycode {
 
@@ -34,12 +35,14 @@ namespace Polycode {
 	
 	/**
 	* 3D polygonal mesh instance. The SceneMesh is the base for all polygonal 3d geometry. It can have simple textures or complex materials applied to it.
+	*
+	* A scene mesh can also be a group of levels of detail. Every level has a geometric error, and each time the mesh is rendered, it picks the least detailed level whose error would be smaller than lodErrorThreshold pixels on screen. Mesh files written with levels of detail load them automatically.
 	*/
 	class _PolyExport SceneMesh : public SceneEntity {
 		public:
 		
 			/**
-			* Construct a scene mesh from a mesh file.
+			* Construct a scene mesh from a mesh file. Levels of detail stored in the file are loaded too.
 			* @param fileName Path to mesh file to load.
 			*/
 			SceneMesh(const String& fileName);
@@ -81,6 +84,9 @@ namespace Polycode {
 			*/							
 			Material *getMaterial();
 			
+			Material *getRenderMaterial() { return material; }
+			Texture *getRenderTexture() { return texture; }
+			
 			/**
 			* Loads a simple texture from a file name and applies it to the mesh.
 			* @param fileName Filename to load the mesh from.
@@ -122,6 +128,50 @@ namespace Polycode {
 			* @param mesh Set a new mesh to render.
 			*/															
 			void setMesh(Mesh *mesh);
+			
+			/**
+			* Adds a lower level of detail. Levels must be added from the most to the least detailed. If ownsMesh is true, the level's mesh is deleted with the scene mesh.
+			* @param mesh Mesh to render at this level. It should have the same bounds as the full detail mesh.
+			* @param geometricError Largest distance between this level's surface and the full detail one, in the mesh's units.
+			*/
+			void addLODLevel(Mesh *mesh, Number geometricError);
+			
+			/**
+			* Returns the number of levels of detail, including the full detail mesh.
+			*/
+			int getNumLODLevels();
+			
+			/**
+			* Returns the mesh rendered at a level of detail.
+			* @param level Level of detail. 0 is the full detail mesh.
+			*/
+			Mesh *getLODMesh(int level);
+			
+			/**
+			* Returns the level of detail that is currently rendered.
+			*/
+			int getCurrentLOD();
+			
+			/**
+			* Forces a level of detail instead of selecting it by screen size.
+			* @param level Level of detail to render, or -1 to select it automatically again.
+			*/
+			void setForcedLOD(int level);
+			
+			/**
+			* Selects the level of detail to render with. Called from Render() with the view the renderer got from the scene, so nested scene meshes select theirs too.
+			* @param cameraPosition Position of the camera in world space.
+			* @param projectionScale Number of pixels a unit covers at a distance of one from a perspective camera, or at any distance from an orthographic one.
+			* @param orthographic True if the camera is orthographic, in which case distance doesn't matter.
+			*/
+			void updateLOD(const Vector3 &cameraPosition, Number projectionScale, bool orthographic);
+			
+			/**
+			* Sets a global multiplier for the projected error of every level of detail. Values above 1 switch to lower detail closer to the camera, which is useful to scale detail to slower hardware.
+			* @param bias New bias. Defaults to 1.
+			*/
+			static void setLODBias(Number bias);
+			static Number getLODBias();
 		
 			/**
 			* Sets a skeleton from an existing skeleton instance.
@@ -158,9 +208,36 @@ namespace Polycode {
 			* If true, will delete its Skeleton upon destruction. (defaults to true)
 			*/ 			
 			bool ownsSkeleton;
+			
+			/**
+			* Largest error, in pixels, the rendered level of detail may have on screen. Defaults to 1.
+			*/
+			Number lodErrorThreshold;
+			
+			/**
+			* How far, as a fraction of lodErrorThreshold, the projected error has to go past the threshold before the level changes, so that meshes near a threshold don't switch every frame. Defaults to 0.25.
+			*/
+			Number lodHysteresis;
+			
+			/**
+			* Duration in seconds of the dithered cross-fade between levels of detail. Defaults to 0, which switches levels immediately.
+			*/
+			Number lodFadeTime;
 		
 		protected:
 		
+			void bindSkeleton(Mesh *targetMesh);
+			void drawMesh(Mesh *targetMesh);
+			void drawMeshLocally(Mesh *targetMesh);
+			
+			std::vector<MeshLOD> lodLevels;
+			int currentLOD;
+			int forcedLOD;
+			int fadingLOD;
+			Number lodFade;
+			
+			static Number lodBias;
+			
 			bool useVertexBuffer;
 			Mesh *mesh;
 			Texture *texture;
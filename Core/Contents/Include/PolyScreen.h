@@ -35,6 +35,7 @@ namespace Polycode {
 	class Material;
 	class Texture;
 	class ShaderBinding;
+	class ScreenSpriteBatcher;
 
 	/**
 	* 2D rendering base. The Screen is the container for all 2D rendering in Polycode. Screens are automatically rendered and need only be instantiated to immediately add themselves to the rendering pipeline. Each screen has a root entity.
@@ -105,6 +106,18 @@ namespace Polycode {
 		bool hasFilterShader() const;
 		void drawFilter();
 		
+		/**
+		* Enables or disables sprite batching. When enabled, the screen's meshes are transformed on the CPU and drawn in as few draw calls as possible, only starting a new batch when the texture or a render state changes. Entities that override Render() without overriding ScreenEntity::canBatch() and ScreenEntity::renderToBatch() won't be drawn correctly. Defaults to false.
+		* @param val If true, the screen is drawn with sprite batching.
+		*/
+		void setSpriteBatching(bool val);
+		bool getSpriteBatching() const { return spriteBatcher != NULL; }
+		
+		/**
+		* Returns the number of batches the screen was drawn with the last time it was rendered, or 0 if sprite batching is disabled.
+		*/
+		unsigned int getNumSpriteBatches() const;
+		
 		bool usesNormalizedCoordinates() const { return useNormalizedCoordinates; }
 		Number getYCoordinateSize() const { return yCoordinateSize; }
 				
@@ -150,5 +163,7 @@ namespace Polycode {
 		Texture *originalSceneTexture;				
 		std::vector<ShaderBinding*> localShaderOptions;
 		bool _hasFilterShader;
+		
+		ScreenSpriteBatcher *spriteBatcher;
 	};
 }
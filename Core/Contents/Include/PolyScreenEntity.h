@@ -33,6 +33,8 @@ THE SOFTWARE.
 
 namespace Polycode {
 
+	class ScreenSpriteBatcher;
+
 	class _PolyExport MouseEventResult {
 		public:
 			bool hit;
@@ -119,6 +121,23 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		Matrix4 buildPositionMatrix();
 		void adjustMatrixForChildren();
 		
+		/**
+		* Adds the entity and its children to a sprite batch. This is what a Screen with sprite batching enabled calls instead of transformAndRender(). Entities that can't be batched are rendered normally, together with their children.
+		* @param batcher Batcher to add the entity to.
+		*/
+		void transformAndBatch(ScreenSpriteBatcher *batcher);
+		
+		/**
+		* Returns true if renderToBatch() draws the same thing as Render(). A plain ScreenEntity draws nothing, so it can be batched. If you subclass ScreenEntity and override Render(), override this and renderToBatch() as well, or return false so that the entity is rendered normally.
+		*/
+		virtual bool canBatch() { return true; }
+		
+		/**
+		* Adds what Render() would draw to a sprite batch. The batcher's matrix, color and render states are already set up for the entity.
+		* @param batcher Batcher to add to.
+		*/
+		virtual void renderToBatch(ScreenSpriteBatcher *batcher) {}
+		
 		/**
 		* Returns the width of the screen entity.
 		* @return Height of the screen entity.
@@ -209,6 +228,11 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 
 	protected:
 	
+		/**
+		* Returns the offset adjustMatrixForChildren() translates the children by.
+		*/
+		Vector2 getChildrenOffset() const;
+	
 		bool focusable;
 		bool focusChildren;
 		
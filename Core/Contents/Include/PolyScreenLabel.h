@@ -70,6 +70,8 @@ namespace Polycode {
 			Label *getLabel() const;
 			
 			void Render();
+			void renderToBatch(ScreenSpriteBatcher *batcher);
+			
 			bool positionAtBaseline;
 			
 		protected:
@@ -55,6 +55,7 @@ namespace Polycode {
 
 			void Update();
 			void Render();
+			bool canBatch() { return false; }
 			
 			/**
 			* Sets the line width.
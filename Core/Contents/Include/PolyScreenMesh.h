@@ -55,6 +55,9 @@ namespace Polycode {
 			
 			void Render();
 			
+			bool canBatch();
+			void renderToBatch(ScreenSpriteBatcher *batcher);
+			
 			/**
 			* Returns the mesh for this screen mesh.
 			* @return The mesh.
@@ -46,6 +46,11 @@ namespace Polycode {
 						
 			virtual ~ScreenShape();
 			void Render();
+			
+			/**
+			* Shapes with a stroke can't be batched, since the stroke is drawn as lines.
+			*/
+			bool canBatch();
 
 			/**
 			* Sets the color of the shape stroke if it's enabled.
@@ -0,0 +1,155 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyColor.h"
+#include "PolyRectangle.h"
+#include <vector>
+
+namespace Polycode {
+
+	class Entity;
+	class Mesh;
+	class Renderer;
+	class RenderDataArray;
+	class Texture;
+	class Vertex;
+
+	/**
+	* Draws the entities of a Screen in as few draw calls as possible. Instead of setting up the renderer for every entity, the batcher is walked through the screen tree with ScreenEntity::transformAndBatch(), transforms each mesh's vertices on the CPU and appends them to shared vertex, color and texture coordinate arrays. A batch is only drawn when the texture, blending mode, scissor box or another render state changes, so paint order is the same as when the entities are rendered one by one. Entities that can't be batched are rendered normally in between batches.
+	*/
+	class _PolyExport ScreenSpriteBatcher {
+		public:
+			ScreenSpriteBatcher();
+			~ScreenSpriteBatcher();
+
+			/**
+			* Starts batching. The renderer's current modelview matrix is used as the base for everything batched.
+			* @param renderer Renderer to draw with.
+			*/
+			void begin(Renderer *renderer);
+
+			/**
+			* Draws what is left in the current batch and restores the renderer's scissor state.
+			*/
+			void end();
+
+			void pushMatrix();
+			void popMatrix();
+
+			/**
+			* Multiplies the current matrix by a transform, in the same order Renderer::multModelviewMatrix() does.
+			*/
+			void multMatrix(const Matrix4 &m);
+			void translate2D(Number x, Number y);
+			const Matrix4 &getMatrix() const { return matrix; }
+
+			/**
+			* Sets the color vertices without their own colors are batched with.
+			*/
+			void setColor(const Color &color);
+
+			/**
+			* Sets the render states the following meshes are batched with.
+			*/
+			void setRenderState(int blendingMode, bool depthTest, bool depthWrite, bool alphaTest, bool backfaceCulled);
+
+			void setScissor(bool enabled, const Polycode::Rectangle &box);
+			bool isScissorEnabled() const { return scissorEnabled; }
+			Polycode::Rectangle getScissorBox() const { return scissorBox; }
+
+			/**
+			* Returns true if the mesh is of a type the batcher can draw.
+			*/
+			static bool canBatchMesh(Mesh *mesh);
+
+			/**
+			* Appends a mesh, transformed by the current matrix, to the current batch, starting a new batch if the texture or render state changed.
+			* @param mesh Mesh to add. Must be one that canBatchMesh() accepts.
+			* @param texture Texture to draw the mesh with, or NULL.
+			*/
+			void addMesh(Mesh *mesh, Texture *texture);
+
+			/**
+			* Draws the current batch and then renders an entity and its children normally, relative to the current matrix.
+			*/
+			void renderEntity(Entity *entity);
+
+			/**
+			* Draws the current batch.
+			*/
+			void flush();
+
+			/**
+			* Returns the number of batches drawn since begin().
+			*/
+			unsigned int getNumBatches() const { return numBatches; }
+
+		protected:
+
+			void reserveVertices(int count);
+			void addVertex(Vertex *vertex, bool useVertexColor);
+			void applyScissor();
+
+			Renderer *renderer;
+
+			Matrix4 matrix;
+			std::vector<Matrix4> matrixStack;
+			Color color;
+
+			Texture *texture;
+			int blendingMode;
+			bool depthTest;
+			bool depthWrite;
+			bool alphaTest;
+			bool backfaceCulled;
+			bool scissorEnabled;
+			Polycode::Rectangle scissorBox;
+
+			/**
+			* Render state of the batch being built, which may differ from the states set since.
+			*/
+			int batchBlendingMode;
+			bool batchDepthTest;
+			bool batchDepthWrite;
+			bool batchAlphaTest;
+			bool batchBackfaceCulled;
+			bool batchScissorEnabled;
+			Polycode::Rectangle batchScissorBox;
+			Texture *batchTexture;
+
+			bool rendererScissorEnabled;
+			Polycode::Rectangle rendererScissorBox;
+
+			std::vector<Vertex*> meshVertices;
+
+			RenderDataArray *vertexArray;
+			RenderDataArray *colorArray;
+			RenderDataArray *texCoordArray;
+			int numVertices;
+			int vertexCapacity;
+			unsigned int numBatchedMeshes;
+			unsigned int numBatches;
+	};
+}
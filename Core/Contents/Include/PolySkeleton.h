@@ -34,18 +34,20 @@ namespace Polycode {
 	
 	class BezierCurve;
 	class Bone;
-	class QuaternionTween;
-	class BezierPathTween;
+	class Skeleton;
 	
+	/**
+	* Animation curves for a single bone, as loaded from an animation file. The curves are only used to bake the owning SkeletonAnimation into sampled keyframes and are not evaluated during playback.
+	*/
 	class _PolyExport BoneTrack {
 		public:
 			BoneTrack(Bone *bone, Number length);
 			~BoneTrack();
-			void Play(bool once=false);
-			void Stop();
-			void Update();
-		
-			void setSpeed(Number speed);
+			
+			/**
+			* Returns the bone animated by this track.
+			*/
+			Bone *getTargetBone() const { return targetBone; }
 			
 			BezierCurve *scaleX;
 			BezierCurve *scaleY;
@@ -58,37 +60,78 @@ namespace Polycode {
 			BezierCurve *LocY;
 			BezierCurve *LocZ;
 			
-			Vector3 LocXVec;
-			Vector3 LocYVec;
-			Vector3 LocZVec;						
-
-			Vector3 ScaleXVec;
-			Vector3 ScaleYVec;
-			Vector3 ScaleZVec;						
-		
-		
-			Quaternion boneQuat;
-			QuaternionTween *quatTween;
-			
-			Vector3 QuatWVec;
-			Vector3 QuatXVec;
-			Vector3 QuatYVec;			
-			Vector3 QuatZVec;		
-		
-			
 		protected:
 		
 			Number length;
-		
-			bool initialized;
-		
 			Bone *targetBone;
-			std::vector <BezierPathTween*> pathTweens;
+	};
+	
+	/**
+	* Local transforms for every bone of a skeleton. Each transform component is kept in its own array, indexed by bone, so that sampling and blending run over all bones in flat loops.
+	*/
+	class _PolyExport SkeletonPose {
+		public:
+			SkeletonPose();
+			~SkeletonPose();
+			
+			/**
+			* Resizes the pose and resets every bone to the identity transform.
+			* @param numBones Number of bones in the pose.
+			*/
+			void setNumBones(unsigned int numBones);
+			
+			/**
+			* Returns the number of bones in the pose.
+			*/
+			unsigned int getNumBones() const;
+			
+			/**
+			* Sets the local transform of a bone.
+			*/
+			void setBoneTransform(unsigned int index, const Vector3 &position, const Quaternion &rotation, const Vector3 &scale);
+			
+			/**
+			* Returns the local transform matrix of a bone.
+			* @param index Bone index.
+			*/
+			Matrix4 getBoneMatrix(unsigned int index) const;
+			
+			/**
+			* Resets the pose to zero so that weighted poses can be accumulated into it with addWeightedPose().
+			*/
+			void clearForBlending();
+			
+			/**
+			* Accumulates another pose into this one. Rotations are summed along the shortest path relative to the accumulated rotation.
+			* @param pose Pose to add. Must have the same number of bones.
+			* @param weight Weight of the pose.
+			*/
+			void addWeightedPose(const SkeletonPose &pose, Number weight);
+			
+			/**
+			* Finishes a weighted accumulation by renormalizing rotations and dividing positions and scales by the accumulated weight.
+			*/
+			void normalizeBlend();
+			
+			std::vector<float> rotationX;
+			std::vector<float> rotationY;
+			std::vector<float> rotationZ;
+			std::vector<float> rotationW;
+			std::vector<float> positionX;
+			std::vector<float> positionY;
+			std::vector<float> positionZ;
+			std::vector<float> scaleX;
+			std::vector<float> scaleY;
+			std::vector<float> scaleZ;
+			
+		protected:
 		
+			unsigned int numBones;
+			Number blendWeight;
 	};
 
 	/**
-	* Skeleton animation.
+	* Skeleton animation. The animation curves are baked into keyframes sampled at a fixed rate when the animation is loaded. Rotations are stored as quantized quaternions. During playback all bones are sampled in one pass, and several animations can be blended or cross-faded on the same skeleton.
 	*/ 
 	class _PolyExport SkeletonAnimation {
 		public:
@@ -107,6 +150,20 @@ namespace Polycode {
 			*/
 			const String& getName() const;
 			
+			/**
+			* Bakes the bone tracks into sampled keyframes for the bones of a skeleton. Bones without a track keep the skeleton's bind pose.
+			* @param skeleton Skeleton the animation is played on.
+			* @param frameRate Number of keyframes per second.
+			*/
+			void bake(Skeleton *skeleton, Number frameRate = SkeletonAnimation::DEFAULT_FRAME_RATE);
+			
+			/**
+			* Samples all bones of the animation at the specified time.
+			* @param time Time in seconds.
+			* @param pose Pose to write to. It is resized to the number of baked bones.
+			*/
+			void samplePose(Number time, SkeletonPose *pose) const;
+			
 			/**
 			* Plays the animation.
 			*/
@@ -115,7 +172,12 @@ namespace Polycode {
 			* Stops the animation.
 			*/			
 			void Stop();
-			void Update();
+			
+			/**
+			* Advances the playback time and blend weight.
+			* @param elapsed Elapsed time in seconds.
+			*/
+			void Update(Number elapsed);
 
 			/**
 			* Sets the animation multiplier speed.
@@ -123,11 +185,66 @@ namespace Polycode {
 			*/					
 			void setSpeed(Number speed);
 			
+			/**
+			* Fades the blend weight of the animation to a new value.
+			* @param weight Target weight.
+			* @param fadeTime Time in seconds to reach the target weight. If 0, the weight is set immediately.
+			*/
+			void fadeToWeight(Number weight, Number fadeTime);
+			
+			/**
+			* Returns the current blend weight.
+			*/
+			Number getWeight() const;
+			
+			/**
+			* Returns true if the animation is playing or still fading out.
+			*/
+			bool isPlaying() const;
+			
+			/**
+			* Returns the current playback time in seconds.
+			*/
+			Number getTime() const;
+			
+			/**
+			* Returns the duration of the animation in seconds.
+			*/
+			Number getDuration() const;
+			
+			/**
+			* Default keyframe rate used when baking.
+			*/
+			static const int DEFAULT_FRAME_RATE = 30;
+			
 		protected:
 			
 			String name;
 			Number duration;
 			std::vector<BoneTrack*> boneTracks;
+			
+			Number time;
+			Number speed;
+			Number weight;
+			Number targetWeight;
+			Number fadeRate;
+			bool playing;
+			bool playOnce;
+			
+			Number frameRate;
+			unsigned int numFrames;
+			unsigned int numBones;
+			
+			std::vector<short> keyRotationX;
+			std::vector<short> keyRotationY;
+			std::vector<short> keyRotationZ;
+			std::vector<short> keyRotationW;
+			std::vector<float> keyPositionX;
+			std::vector<float> keyPositionY;
+			std::vector<float> keyPositionZ;
+			std::vector<float> keyScaleX;
+			std::vector<float> keyScaleY;
+			std::vector<float> keyScaleZ;
 	};
 
 	/**
@@ -160,6 +277,30 @@ namespace Polycode {
 						
 			void playAnimationByIndex(int index, bool once = false);		
 			
+			/**
+			* Fades out all playing animations and fades in a new one over the specified time.
+			* @param animName Name of animation to play.
+			* @param fadeTime Cross-fade time in seconds.
+			* @param once If true, will only play the animation once.
+			*/
+			void crossFadeAnimation(const String& animName, Number fadeTime, bool once = false);
+			
+			/**
+			* Plays an animation on top of the already playing ones, blended with the specified weight. Where the weights of all playing animations add up to less than 1, the bind pose makes up the rest.
+			* @param animName Name of animation to play.
+			* @param weight Blend weight of the animation.
+			* @param fadeTime Time in seconds to fade to the weight.
+			* @param once If true, will only play the animation once.
+			*/
+			void blendAnimation(const String& animName, Number weight, Number fadeTime = 0.0, bool once = false);
+			
+			/**
+			* Stops an animation.
+			* @param animName Name of animation to stop.
+			* @param fadeTime Time in seconds to fade the animation out.
+			*/
+			void stopAnimation(const String& animName, Number fadeTime = 0.0);
+			
 			/**
 			* Loads in a new animation from a file and adds it to the skeleton.
 			* @param name Name of the new animation.
@@ -210,14 +351,46 @@ namespace Polycode {
 			* Returns the current animation.
 			*/
 			SkeletonAnimation *getCurrentAnimation() const { return currentAnimation; }
+			
+			/**
+			* Returns the index of a bone in the skeleton, or -1 if the bone is not part of it.
+			* @param bone Bone to look up.
+			*/
+			int getBoneIndex(Bone *bone) const;
+			
+			/**
+			* Returns the bind pose of the skeleton as loaded from the skeleton file.
+			*/
+			const SkeletonPose &getBindPose() const { return bindPose; }
+			
+			/**
+			* Returns the model space matrix of a bone, as computed by the last animation update.
+			* @param index Bone index.
+			*/
+			const Matrix4 &getBoneModelMatrix(int index) const { return boneModelMatrices[index]; }
+			
+			/**
+			* Applies a pose to the bones of the skeleton and computes the model space bone matrices.
+			* @param pose Pose to apply.
+			*/
+			void applyPose(const SkeletonPose &pose);
 		
 		protected:
 		
+			void startAnimation(SkeletonAnimation *anim, Number weight, Number fadeTime, bool once);
+		
 			SceneEntity *bonesEntity;
 		
 			SkeletonAnimation *currentAnimation;
 			std::vector<Bone*> bones;
 			std::vector<SkeletonAnimation*> animations;
+			std::vector<SkeletonAnimation*> playingAnimations;
+			
+			std::vector<int> boneEvaluationOrder;
+			std::vector<Matrix4> boneModelMatrices;
+			SkeletonPose bindPose;
+			SkeletonPose animationPose;
+			SkeletonPose blendedPose;
 	};
 
 }
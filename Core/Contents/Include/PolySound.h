@@ -41,6 +41,8 @@
 namespace Polycode {
 	
 	class String;
+	class SoundStreamDecoder;
+	class SoundManager;
 
 	/**
 	* Loads and plays a sound. This class can load and play an OGG or WAV sound file.
@@ -51,8 +53,9 @@ namespace Polycode {
 		/**
 		* Constructor.
 		* @param fileName Path to an OGG or WAV file to load.
+		* @param streaming If true, the sound is decoded a little at a time on a background thread while it plays, instead of all at once when it is loaded. Use this for music and other long sounds.
 		*/ 
-		Sound(const String& fileName);
+		Sound(const String& fileName, bool streaming = false);
 		Sound(const char *data, int size, int channels = 1, ALsizei freq = 44100, int bps = 16);
 		virtual ~Sound();
 		
@@ -142,9 +145,141 @@ namespace Polycode {
 		void soundCheck(bool result, const String& err);
 		static unsigned long readByte32(const unsigned char buffer[4]);		
 		static unsigned short readByte16(const unsigned char buffer[2]);
+		
+		/**
+		* Returns true if the sound is streamed rather than loaded into memory at once.
+		*/
+		bool isStreaming() const { return streamDecoder != NULL; }
+		
+		/**
+		* Unqueues the buffers OpenAL has finished playing and refills them. Called by the SoundStreamer thread with its lock held.
+		*/
+		void updateStream();
+		
+		/**
+		* Number of OpenAL buffers queued on a streaming sound.
+		*/
+		static const int NUM_STREAM_BUFFERS = 4;
+		
+		/**
+		* Size of each streaming buffer in bytes.
+		*/
+		static const int STREAM_BUFFER_SIZE = 32768;
+		
+		/**
+		* Sets the priority of the sound. When there are more sounds playing than the SoundManager has voices, sounds with a higher priority get a voice first, and sounds with the same priority are ranked by how loud they are at the listener. Defaults to 0.
+		* @param priority New priority.
+		*/
+		void setPriority(int priority);
+		int getPriority() const;
+		
+		/**
+		* Returns true if the sound currently has an OpenAL source. A playing sound without one is virtual: it keeps track of its playback time, but isn't heard until the SoundManager gives it a voice.
+		*/
+		bool hasVoice() const;
+		
+		/**
+		* Returns true if the sound plays on a voice from the SoundManager's pool. Streaming sounds keep their own source instead.
+		*/
+		bool usesVoicePool() const { return soundBuffer != AL_NONE && !streamDecoder; }
+		
+		/**
+		* Returns how loud the sound is at the listener, from 0 to its volume, following the linear clamped distance model the SoundManager sets up.
+		* @param listenerPosition Position of the listener.
+		*/
+		Number getAudibility(const Vector3& listenerPosition) const;
+		
+		/**
+		* Plays the sound on a voice from the SoundManager's pool, starting from where its virtual playback has got to. Called by the SoundManager.
+		*/
+		void assignVoice(ALuint voice);
+		
+		/**
+		* Takes the voice away from the sound, remembering its playback time so that it keeps playing virtually. Called by the SoundManager.
+		* @return The voice the sound was using, or 0 if it had none.
+		*/
+		ALuint releaseVoice();
+		
+		/**
+		* Tells the sound that the SoundManager it registered with is being deleted, so that it doesn't unregister from it when it is unloaded later. Called by the SoundManager.
+		*/
+		void detachSoundManager();
+		
+		/**
+		* Advances the playback time of a virtual sound. Called by the SoundManager.
+		* @param elapsed Elapsed time in seconds.
+		*/
+		void updateVirtualTime(Number elapsed);
+		
+		/**
+		* Notices when a sound playing on a voice has finished, and returns whether it is still playing.
+		*/
+		bool updatePlaying();
+		
+		/**
+		* Sends a position, velocity or direction changed since the last call to OpenAL. Called by the SoundManager once a frame, so that moving a sound several times in a frame only costs one update.
+		*/
+		void flushSourcePosition();
 
 	protected:
 	
+		void initProperties();
+		void unload();
+		void updateBufferInfo();
+		void applySourceProperties();
+		void applySourcePosition();
+		
+		/**
+		* Buffer of a sound loaded into memory, or AL_NONE for streaming sounds.
+		*/
+		ALuint soundBuffer;
+		int soundFrequency;
+		Number soundDuration;
+		
+		Vector3 soundPosition;
+		Vector3 soundVelocity;
+		Vector3 soundDirection;
+		bool positionDirty;
+		
+		bool looping;
+		bool playing;
+		
+		/**
+		* Playback time in seconds, kept up to date while the sound has no voice.
+		*/
+		Number virtualTime;
+		int priority;
+	
+		bool loadStream(const String& fileName);
+		void releaseStream();
+		void startStream(long sample);
+		void stopStream();
+		bool fillStreamBuffer(int index);
+		long getStreamSample();
+		
+		bool streaming;
+		SoundStreamDecoder *streamDecoder;
+		ALuint streamBuffers[NUM_STREAM_BUFFERS];
+		long streamBufferSamples[NUM_STREAM_BUFFERS];
+		ALenum streamFormat;
+		char *streamData;
+		
+		/**
+		* True while the stream should be playing. The source itself stops whenever its queue runs dry.
+		*/
+		bool streamActive;
+		bool streamLooping;
+		
+		/**
+		* Sample offset in the file of the first buffer in the queue.
+		*/
+		long streamQueueStart;
+		
+		/**
+		* Sample offset playback starts from when the stream is not active.
+		*/
+		long streamPosition;
+	
 		Number referenceDistance;
 		Number maxDistance;
 			
@@ -154,6 +289,11 @@ namespace Polycode {
 		String fileName;
 		
 		bool soundLoaded;
+		
+		/**
+		* The SoundManager the sound is registered with, or NULL once it has been deleted.
+		*/
+		SoundManager *soundManager;
 	
 		bool isPositional;
 		ALuint soundSource;
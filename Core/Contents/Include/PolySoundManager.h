@@ -26,29 +26,92 @@
 
 #include "al.h"
 #include "alc.h"
+#include <vector>
 
 namespace Polycode {
 	
+	class Sound;
+	class SoundStreamer;
+	
 	/**
-	* Controls global sound settings.
+	* Controls global sound settings. The sound manager also owns a fixed pool of OpenAL sources, called voices, that sounds loaded into memory play on. When more sounds are playing than there are voices, the ones with the highest priority and the loudest at the listener get a voice and the rest play virtually: they keep track of their playback time without being heard, and pick up where they would have been once they get a voice again.
 	*/
 	class _PolyExport SoundManager {
 	public:
 		SoundManager();
 		~SoundManager();
 		
+		/**
+		* Sets the position of the listener. Like sound positions, it is sent to OpenAL once per frame in Update().
+		*/
 		void setListenerPosition(Vector3 position);
 		void setListenerOrientation(Vector3 orientation, Vector3 upVector);	
 		void initAL();
 		
+		/**
+		* Hands out voices, keeps virtual sounds' playback time up to date and sends changed listener and sound positions to OpenAL. Called by CoreServices every frame.
+		* @param elapsed Elapsed time in milliseconds.
+		*/
+		void Update(int elapsed);
+		
+		/**
+		* Sets the maximum number of sounds that can be heard at the same time. It is capped by the number of sources OpenAL could create.
+		* @param maxVoices New maximum number of voices.
+		*/
+		void setMaxVoices(int maxVoices);
+		int getMaxVoices() const;
+		
+		/**
+		* Returns the number of sounds that are playing without a voice.
+		*/
+		int getNumVirtualSounds() const;
+		
+		/**
+		* Adds a sound to the sounds the manager keeps track of. Called by Sound when it is loaded.
+		*/
+		void registerSound(Sound *sound);
+		
+		/**
+		* Removes a sound and returns its voice to the pool. Called by Sound when it is unloaded.
+		*/
+		void unregisterSound(Sound *sound);
+		
+		/**
+		* Gives a sound that just started playing a voice, if one is free. Otherwise it plays virtually until the next Update() decides whether it is audible enough to take a voice from another sound.
+		*/
+		void requestVoice(Sound *sound);
+		
+		static const int DEFAULT_MAX_VOICES = 32;
+		
 		/**
 		* Sets the global sound volume.
 		*/ 
 		void setGlobalVolume(Number globalVolume);
 		
+		/**
+		* Returns the thread that streams sounds, starting it the first time it is needed.
+		*/
+		SoundStreamer *getSoundStreamer();
 		
 	protected:
 		
+		void assignVoices();
+		void flushListener();
+		
+		SoundStreamer *soundStreamer;
+		
+		std::vector<Sound*> sounds;
+		std::vector<Sound*> playingSounds;
+		std::vector<ALuint> voices;
+		std::vector<ALuint> freeVoices;
+		int maxVoices;
+		int numVirtualSounds;
+		
+		Vector3 listenerPosition;
+		Vector3 listenerOrientation;
+		Vector3 listenerUp;
+		bool listenerDirty;
+		
 		ALCdevice* device;
 		ALCcontext* context;		
 	};
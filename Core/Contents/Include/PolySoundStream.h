@@ -0,0 +1,153 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyThreaded.h"
+#include <vector>
+
+class OSFILE;
+
+namespace Polycode {
+
+	class Sound;
+	class CoreMutex;
+
+	/**
+	* Decodes a sound file a piece at a time, so that it can be played without decoding it all into memory first. Decoders always output 16 bit or 8 bit interleaved PCM.
+	*/
+	class _PolyExport SoundStreamDecoder {
+		public:
+			virtual ~SoundStreamDecoder();
+
+			/**
+			* Opens a file and reads its format.
+			* @param fileName Path of the file.
+			* @return True if the file can be decoded.
+			*/
+			virtual bool open(const String& fileName) = 0;
+
+			/**
+			* Decodes the next samples into a buffer.
+			* @param buffer Buffer to decode into.
+			* @param size Size of the buffer in bytes.
+			* @return Number of bytes decoded, 0 at the end of the stream.
+			*/
+			virtual long decode(char *buffer, long size) = 0;
+
+			/**
+			* Moves decoding to a sample offset, without decoding anything before it.
+			* @param sample Offset in samples per channel.
+			* @return True if the seek succeeded.
+			*/
+			virtual bool seek(long sample) = 0;
+
+			int getChannels() const { return channels; }
+			int getFrequency() const { return frequency; }
+			int getBitsPerSample() const { return bitsPerSample; }
+
+			/**
+			* Returns the length of the stream in samples per channel.
+			*/
+			long getSampleLength() const { return sampleLength; }
+
+			/**
+			* Returns the size of one sample for all channels in bytes.
+			*/
+			int getFrameSize() const { return channels * (bitsPerSample / 8); }
+
+			/**
+			* Creates a decoder for a file based on its extension. Returns NULL if the format is not supported or the file cannot be opened.
+			*/
+			static SoundStreamDecoder *createDecoder(const String& fileName);
+
+		protected:
+			SoundStreamDecoder();
+
+			int channels;
+			int frequency;
+			int bitsPerSample;
+			long sampleLength;
+	};
+
+	/**
+	* Streams an OGG Vorbis file.
+	*/
+	class _PolyExport OGGStreamDecoder : public SoundStreamDecoder {
+		public:
+			OGGStreamDecoder();
+			virtual ~OGGStreamDecoder();
+
+			bool open(const String& fileName);
+			long decode(char *buffer, long size);
+			bool seek(long sample);
+
+		protected:
+			void *oggFile;
+	};
+
+	/**
+	* Streams the PCM data chunk of a WAV file.
+	*/
+	class _PolyExport WAVStreamDecoder : public SoundStreamDecoder {
+		public:
+			WAVStreamDecoder();
+			virtual ~WAVStreamDecoder();
+
+			bool open(const String& fileName);
+			long decode(char *buffer, long size);
+			bool seek(long sample);
+
+		protected:
+			OSFILE *file;
+			long dataOffset;
+			long dataSize;
+			long dataPosition;
+	};
+
+	/**
+	* Background thread that keeps the buffer queues of all streaming sounds filled. It is created by the SoundManager when the first streaming sound is loaded. Sounds take its lock whenever they change their stream from the main thread.
+	*/
+	class _PolyExport SoundStreamer : public Threaded {
+		public:
+			SoundStreamer();
+			virtual ~SoundStreamer();
+
+			void addSound(Sound *sound);
+			void removeSound(Sound *sound);
+
+			void lock();
+			void unlock();
+
+			void updateThread();
+
+			/**
+			* Time the thread sleeps between refills in milliseconds. The buffer queue of a streaming sound has to last longer than this.
+			*/
+			static const int UPDATE_INTERVAL = 10;
+
+		protected:
+			std::vector<Sound*> sounds;
+			CoreMutex *streamMutex;
+	};
+}
@@ -0,0 +1,223 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+
+class OSFileMapping;
+
+namespace Polycode {
+
+	/**
+	* A range of characters in the document an XMLReader is reading. Views point straight into the document and are only valid while the reader is alive.
+	*/
+	class _PolyExport XMLStringView {
+		public:
+			XMLStringView() : data(NULL), length(0), hasReferences(false) {}
+			XMLStringView(const char *data, unsigned int length, bool hasReferences) : data(data), length(length), hasReferences(hasReferences) {}
+
+			bool operator == (const char *str) const;
+			bool operator != (const char *str) const { return !(*this == str); }
+
+			bool isEmpty() const { return length == 0; }
+
+			/**
+			* Returns the characters as a String, with entity and character references replaced.
+			*/
+			String toString() const;
+
+			int toInt() const;
+			Number toNumber() const;
+
+			const char *data;
+			unsigned int length;
+
+			/**
+			* True if the range contains entity or character references that toString() has to replace.
+			*/
+			bool hasReferences;
+	};
+
+	class _PolyExport XMLAttribute {
+		public:
+			XMLStringView name;
+			XMLStringView value;
+	};
+
+	class _PolyExport XMLToken {
+		public:
+			int type;
+			int depth;
+			XMLStringView name;
+			XMLStringView text;
+			unsigned int firstAttribute;
+			unsigned int numAttributes;
+	};
+
+	/**
+	* Streaming pull parser for XML. The reader walks the document one token at a time with next() and returns names, attribute values and text as views into the document, so reading doesn't allocate anything per element. Loaders use nextChild() to walk the children of an element and build their objects as they go instead of loading a whole TinyXML document first.
+	*
+	* Documents can also be read to the end up front with readAll(), which keeps every token so the document can be walked again with rewind(). XMLFileParser does this for several files at once on the core's job pool.
+	*
+	* The reader handles elements, attributes, text, CDATA sections and the predefined and numeric character references. Comments, processing instructions and DOCTYPE declarations are skipped. Whitespace around text is trimmed and text that is only whitespace is skipped.
+	*/
+	class _PolyExport XMLReader {
+		public:
+			/**
+			* Creates a reader for a document in memory. The data is not copied and has to stay valid while the reader is used.
+			*/
+			XMLReader(const char *data, size_t size);
+
+			/**
+			* Creates a reader without a document. Use openFile() to read a file.
+			*/
+			XMLReader();
+			~XMLReader();
+
+			/**
+			* Maps a file and starts reading it from the beginning.
+			* @param fileName Path to the file.
+			* @return True if the file could be mapped.
+			*/
+			bool openFile(const String& fileName);
+
+			/**
+			* Moves to the next token.
+			* @return Type of the token, one of the token type constants.
+			*/
+			int next();
+
+			/**
+			* Moves to the next child element of an element, skipping any text and anything nested deeper. Call it in a loop with the depth of the parent element, which is 0 for the root element of the document.
+			* @param parentDepth Depth of the parent element.
+			* @return True if the reader is on the start of a child element, false once the parent element or the document ends.
+			*/
+			bool nextChild(int parentDepth);
+
+			/**
+			* Reads the text of the element the reader is on and moves to the end of the element.
+			* @return The first text inside the element, or an empty view if it has none.
+			*/
+			XMLStringView readText();
+
+			/**
+			* Moves to the end of the element the reader is on.
+			*/
+			void skipElement();
+
+			/**
+			* Reads the rest of the document and keeps every token, so that the document can be read again after rewind(). The reader stays on the token it was on.
+			*/
+			void readAll();
+
+			/**
+			* Starts reading the document from the beginning again.
+			*/
+			void rewind();
+
+			/**
+			* Returns the type of the current token.
+			*/
+			int getType() const;
+
+			/**
+			* Returns the depth of the current token. The root element is at depth 1, and the start and end of an element, as well as text directly inside it, have the element's depth.
+			*/
+			int getDepth() const;
+
+			/**
+			* Returns the name of the element the current token starts or ends.
+			*/
+			XMLStringView getName() const;
+
+			/**
+			* Returns the text of a TEXT token.
+			*/
+			XMLStringView getText() const;
+
+			/**
+			* Returns the value of an attribute of the element the reader is on.
+			* @param name Name of the attribute.
+			* @return Value of the attribute, or an empty view if the element doesn't have it.
+			*/
+			XMLStringView getAttribute(const char *name) const;
+			bool hasAttribute(const char *name) const;
+
+			unsigned int getNumAttributes() const;
+			XMLStringView getAttributeName(unsigned int index) const;
+			XMLStringView getAttributeValue(unsigned int index) const;
+
+			/**
+			* Returns true if the document was found to be malformed. Call readAll() first to check the whole document.
+			*/
+			bool hasError() const { return errorDescription != ""; }
+			String getErrorDescription() const { return errorDescription; }
+
+			String getFileName() const { return fileName; }
+
+			static const int ELEMENT_START = 0;
+			static const int ELEMENT_END = 1;
+			static const int TEXT = 2;
+			static const int DOCUMENT_END = 3;
+			static const int DOCUMENT_ERROR = 4;
+
+		protected:
+
+			void init(const char *data, size_t size);
+			void parseToken();
+			void setError(const char *description);
+			bool startsWith(const char *str) const;
+			bool findSequence(const char *str, size_t *found) const;
+			void skipWhitespace();
+			XMLStringView parseName();
+			const XMLToken *getToken() const;
+
+			const char *data;
+			size_t size;
+			size_t position;
+			int depth;
+			bool keepTokens;
+
+			std::vector<XMLToken> tokens;
+			std::vector<XMLAttribute> attributes;
+			std::vector<XMLStringView> openElements;
+			int tokenIndex;
+
+			OSFileMapping *mapping;
+			String fileName;
+			String errorDescription;
+	};
+
+	/**
+	* Reads several XML documents in parallel. Every reader is read to the end with readAll() on the core's shared job pool, after which the documents can be walked with rewind() on the calling thread.
+	*/
+	class _PolyExport XMLFileParser {
+		public:
+			/**
+			* Reads every document to the end and returns once they are all read. The calling thread reads documents too while it waits.
+			*/
+			static void readAll(const std::vector<XMLReader*> &readers);
+	};
+
+}
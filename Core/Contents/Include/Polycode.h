@@ -59,6 +59,7 @@
 #include "PolyFontManager.h"
 #include "PolyScreenImage.h"
 #include "PolyScreenSprite.h"
+#include "PolyScreenSpriteBatcher.h"
 #include "PolyScreenLabel.h"
 #include "PolyScreenCurve.h"
 #include "PolyScreenEntityInstance.h"
@@ -85,8 +86,10 @@
 #include "PolyScreenEvent.h"
 #include "PolyResource.h"
 #include "PolyThreaded.h"
+#include "PolyJobPool.h"
 #include "PolySound.h"
 #include "PolySoundManager.h"
+#include "PolySoundStream.h"
 #include "PolySceneSound.h"
 #include "PolyScreenSound.h"
 #include "PolyClient.h"
@@ -94,6 +97,12 @@
 #include "PolyServer.h"
 #include "PolyServerWorld.h"
 #include "PolySocket.h"
+#include "PolyRecordingRenderer.h"
+#include "PolyHeadlessCore.h"
+#include "PolyProfiler.h"
+#include "PolyMemory.h"
+#include "PolyCookedTexture.h"
+#include "PolyXMLReader.h"
 
 #ifdef _WINDOWS
 #include "PolyWinCore.h"
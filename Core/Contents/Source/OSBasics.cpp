@@ -25,10 +25,16 @@
 	#include <windows.h>
 #else
 	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
 	#include <sys/types.h>
 	#include <sys/stat.h>
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <vector>
 #include <string>
 #include "physfs.h"
@@ -99,6 +105,140 @@ void OSFileEntry::init(const Polycode::String& path, const Polycode::String& nam
 }
 
 
+OSFILE::OSFILE() {
+	fileType = TYPE_FILE;
+	file = NULL;
+	physFSFile = NULL;
+	mapping = NULL;
+	mappingPosition = 0;
+}
+
+OSFileMapping::OSFileMapping() {
+	data = NULL;
+	size = 0;
+	mappingType = TYPE_BUFFER;
+#ifdef _WINDOWS
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#endif
+}
+
+static OSFileMapping *mapNativeFile(const char *path) {
+#ifdef _WINDOWS
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE)
+		return NULL;
+	
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(fileHandle, &fileSize)) {
+		CloseHandle(fileHandle);
+		return NULL;
+	}
+	
+	OSFileMapping *mapping = new OSFileMapping();
+	if(fileSize.QuadPart == 0) {
+		CloseHandle(fileHandle);
+		return mapping;
+	}
+	
+	HANDLE mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	void *data = NULL;
+	if(mappingHandle)
+		data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if(!data) {
+		if(mappingHandle)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		delete mapping;
+		return NULL;
+	}
+	
+	mapping->data = (const char*)data;
+	mapping->size = (size_t)fileSize.QuadPart;
+	mapping->mappingType = OSFileMapping::TYPE_MEMORY_MAP;
+	mapping->fileHandle = fileHandle;
+	mapping->mappingHandle = mappingHandle;
+	return mapping;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0)
+		return NULL;
+	
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+		::close(fd);
+		return NULL;
+	}
+	
+	OSFileMapping *mapping = new OSFileMapping();
+	if(fileStat.st_size == 0) {
+		::close(fd);
+		return mapping;
+	}
+	
+	void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	::close(fd);
+	if(data == MAP_FAILED) {
+		delete mapping;
+		return NULL;
+	}
+	madvise(data, fileStat.st_size, MADV_WILLNEED);
+	
+	mapping->data = (const char*)data;
+	mapping->size = fileStat.st_size;
+	mapping->mappingType = OSFileMapping::TYPE_MEMORY_MAP;
+	return mapping;
+#endif
+}
+
+static OSFileMapping *readArchiveFile(const char *path) {
+	PHYSFS_File *file = PHYSFS_openRead(path);
+	if(!file)
+		return NULL;
+	
+	OSFileMapping *mapping = new OSFileMapping();
+	PHYSFS_sint64 length = PHYSFS_fileLength(file);
+	if(length > 0) {
+		char *buffer = (char*)malloc(length);
+		if(!buffer || PHYSFS_read(file, buffer, 1, (PHYSFS_uint32)length) != length) {
+			free(buffer);
+			delete mapping;
+			PHYSFS_close(file);
+			return NULL;
+		}
+		mapping->data = buffer;
+		mapping->size = length;
+	}
+	PHYSFS_close(file);
+	return mapping;
+}
+
+static OSFileMapping *readNativeFile(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if(!file)
+		return NULL;
+	
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	
+	OSFileMapping *mapping = new OSFileMapping();
+	if(length > 0) {
+		char *buffer = (char*)malloc(length);
+		if(!buffer || fread(buffer, 1, length, file) != (size_t)length) {
+			free(buffer);
+			delete mapping;
+			fclose(file);
+			return NULL;
+		}
+		mapping->data = buffer;
+		mapping->size = length;
+	}
+	fclose(file);
+	return mapping;
+}
+
 void OSFILE::debugDump() {
 	long tellval = OSBasics::tell(this);
 	OSBasics::seek(this, 0, SEEK_SET);
@@ -135,6 +275,8 @@ OSFILE *OSBasics::open(const String& filename, const String& opts) {
 					printf("Error opening file from archive (%s)\n", filename.c_str());
 					return NULL;		
 				}
+				// PhysFS reads are unbuffered by default, which makes small reads from compressed archives very slow
+				PHYSFS_setBuffer(retFile->physFSFile, ARCHIVE_READ_AHEAD_SIZE);
 			}
 			return retFile;
 		}
@@ -153,6 +295,115 @@ OSFILE *OSBasics::open(const String& filename, const String& opts) {
 	return NULL;
 }
 
+OSFileMapping *OSBasics::mapFile(const String& filename) {
+	if(PHYSFS_exists(filename.c_str())) {
+		if(PHYSFS_isDirectory(filename.c_str()))
+			return NULL;
+		
+		// files in a plain directory on the search path can still be memory mapped
+		const char *realDir = PHYSFS_getRealDir(filename.c_str());
+		if(realDir && isFolder(realDir)) {
+			String realPath = String(realDir) + "/" + filename;
+			OSFileMapping *mapping = mapNativeFile(realPath.c_str());
+			if(mapping)
+				return mapping;
+		}
+		return readArchiveFile(filename.c_str());
+	}
+	
+	OSFileMapping *mapping = mapNativeFile(filename.c_str());
+	if(!mapping)
+		mapping = readNativeFile(filename.c_str());
+	return mapping;
+}
+
+void OSBasics::unmapFile(OSFileMapping *mapping) {
+	if(!mapping)
+		return;
+	
+	switch(mapping->mappingType) {
+		case OSFileMapping::TYPE_BUFFER:
+			free((void*)mapping->data);
+		break;
+		case OSFileMapping::TYPE_MEMORY_MAP:
+#ifdef _WINDOWS
+			UnmapViewOfFile(mapping->data);
+			CloseHandle(mapping->mappingHandle);
+			CloseHandle(mapping->fileHandle);
+#else
+			munmap((void*)mapping->data, mapping->size);
+#endif
+		break;
+	}
+	delete mapping;
+}
+
+OSFILE *OSBasics::openMapped(const String& filename) {
+	OSFileMapping *mapping = mapFile(filename);
+	if(!mapping)
+		return open(filename, "rb");
+	
+	OSFILE *retFile = new OSFILE;
+	retFile->fileType = OSFILE::TYPE_MAPPED_FILE;
+	retFile->mapping = mapping;
+	retFile->mappingPosition = 0;
+	return retFile;
+}
+
+OSFileMapping *OSBasics::getMapping(OSFILE *file) {
+	if(file->fileType == OSFILE::TYPE_MAPPED_FILE)
+		return file->mapping;
+	return NULL;
+}
+
+long OSBasics::getModificationTime(const String& filename) {
+	if(PHYSFS_exists(filename.c_str())) {
+		PHYSFS_sint64 modificationTime = PHYSFS_getLastModTime(filename.c_str());
+		if(modificationTime >= 0)
+			return modificationTime;
+	}
+	
+#ifdef _WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &attributes))
+		return -1;
+	ULARGE_INTEGER writeTime;
+	writeTime.LowPart = attributes.ftLastWriteTime.dwLowDateTime;
+	writeTime.HighPart = attributes.ftLastWriteTime.dwHighDateTime;
+	// FILETIME counts 100 nanosecond intervals since 1601
+	return (long)((writeTime.QuadPart - 116444736000000000ULL) / 10000000ULL);
+#else
+	struct stat fileStat;
+	if(stat(filename.c_str(), &fileStat) != 0)
+		return -1;
+	return fileStat.st_mtime;
+#endif
+}
+
+const char *OSBasics::readInPlace(OSFILE *stream, size_t size) {
+	if(stream->fileType == OSFILE::TYPE_MAPPED_FILE) {
+		if(size > stream->mapping->size - stream->mappingPosition)
+			return NULL;
+		const char *data = stream->mapping->data + stream->mappingPosition;
+		stream->mappingPosition += size;
+		return data;
+	}
+	
+	// a size read from a corrupt file must not turn into a huge allocation
+	long position = tell(stream);
+	if(position < 0 || seek(stream, 0, SEEK_END) != 0)
+		return NULL;
+	long end = tell(stream);
+	seek(stream, position, SEEK_SET);
+	if(end < position || size > (size_t)(end - position))
+		return NULL;
+	
+	stream->inPlaceBuffer.resize(size > 0 ? size : 1);
+	if(size > 0 && read(&stream->inPlaceBuffer[0], 1, size, stream) != size)
+		return NULL;
+	return &stream->inPlaceBuffer[0];
+}
+
 int OSBasics::close(OSFILE *file) {
 	int result = 0;
 	switch(file->fileType) {
@@ -162,6 +413,9 @@ int OSBasics::close(OSFILE *file) {
 		case OSFILE::TYPE_ARCHIVE_FILE:
 			result = PHYSFS_close(file->physFSFile);
 			break;			
+		case OSFILE::TYPE_MAPPED_FILE:
+			unmapFile(file->mapping);
+			break;
 	}
 	delete file;
 	return result;
@@ -175,6 +429,9 @@ long OSBasics::tell(OSFILE * stream) {
 		case OSFILE::TYPE_ARCHIVE_FILE:
 			return PHYSFS_tell(stream->physFSFile);
 			break;			
+		case OSFILE::TYPE_MAPPED_FILE:
+			return stream->mappingPosition;
+			break;
 	}
 	return 0;
 }
@@ -187,6 +444,17 @@ size_t OSBasics::read( void * ptr, size_t size, size_t count, OSFILE * stream )
 		case OSFILE::TYPE_ARCHIVE_FILE:
 			return PHYSFS_read(stream->physFSFile, ptr, size, count);
 		break;			
+		case OSFILE::TYPE_MAPPED_FILE: {
+			if(size == 0)
+				return 0;
+			size_t available = (stream->mapping->size - stream->mappingPosition) / size;
+			if(count > available)
+				count = available;
+			memcpy(ptr, stream->mapping->data + stream->mappingPosition, size * count);
+			stream->mappingPosition += size * count;
+			return count;
+		}
+		break;
 	}
 	return 0;
 }
@@ -225,6 +493,18 @@ int OSBasics::seek(OSFILE * stream, long int offset, int origin ) {
 				break;
 			}
 			break;			
+		case OSFILE::TYPE_MAPPED_FILE: {
+			long newPosition = offset;
+			if(origin == SEEK_CUR)
+				newPosition += stream->mappingPosition;
+			else if(origin == SEEK_END)
+				newPosition += stream->mapping->size;
+			if(newPosition < 0 || newPosition > (long)stream->mapping->size)
+				return -1;
+			stream->mappingPosition = newPosition;
+			return 0;
+		}
+		break;
 	}
 	return 0;	
 }
@@ -20,6 +20,7 @@
  THE SOFTWARE.
 */
 #include "PolyConfig.h"
+#include "PolyXMLReader.h"
 #include "tinyxml.h"
 
 using namespace Polycode;
@@ -33,31 +34,30 @@ Config::~Config() {
 }
 
 void Config::loadConfig(const String& configNamespace, const String& fileName) {
-	TiXmlDocument doc(fileName.c_str());
+	XMLReader reader;
 	
 	Logger::log("Loading config: %s\n", fileName.c_str());
 	
-	if(!doc.LoadFile()) {
+	if(!reader.openFile(fileName) || !reader.nextChild(0)) {
 		Logger::log("Error loading config file...\n");
-		Logger::log("Error: %s\n", doc.ErrorDesc());
+		Logger::log("Error: %s\n", reader.getErrorDescription().c_str());
 		return;
 	}
 	
-	TiXmlElement *rootElement = doc.RootElement();
-	
-	TiXmlNode *pChild;
+	int rootDepth = reader.getDepth();
 	ConfigEntry *entry;
-	for(pChild = rootElement->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-		TiXmlElement *pChildElement = pChild->ToElement();
-		if (!pChildElement) continue; // Skip comment nodes
-		
-		entry = getEntry(configNamespace, pChild->Value());
-		entry->stringVal = pChildElement->GetText();		
-		entry->numVal = atof(pChildElement->GetText());
+	while(reader.nextChild(rootDepth)) {
+		entry = getEntry(configNamespace, reader.getName().toString());
+		XMLStringView text = reader.readText();
+		entry->stringVal = text.toString();		
+		entry->numVal = text.toNumber();
 		entry->isString = true;
 		entry->configNamespace = configNamespace;
 	}
 	
+	if(reader.hasError()) {
+		Logger::log("Error: %s\n", reader.getErrorDescription().c_str());
+	}
 }
 
 void Config::saveConfig(const String& configNamespace, const String& fileName) {
@@ -0,0 +1,227 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyCookedTexture.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Polycode;
+
+static const char PTEX_MAGIC[4] = {'P', 'T', 'E', 'X'};
+
+// halves an image with a 2x2 box filter, clamping at the edges of odd sized levels
+static void downsampleLevel(const unsigned char *src, unsigned int srcWidth, unsigned int srcHeight, unsigned char *dst, unsigned int dstWidth, unsigned int dstHeight, unsigned int pixelSize) {
+	unsigned int srcPitch = srcWidth * pixelSize;
+	for(unsigned int y=0; y < dstHeight; y++) {
+		const unsigned char *row0 = src + ((y*2 < srcHeight ? y*2 : srcHeight-1) * srcPitch);
+		const unsigned char *row1 = src + ((y*2+1 < srcHeight ? y*2+1 : srcHeight-1) * srcPitch);
+		unsigned char *dstRow = dst + (y * dstWidth * pixelSize);
+
+		if(srcWidth == dstWidth * 2) {
+			// common case, kept free of branches so the compiler can vectorize it
+			for(unsigned int i=0; i < dstWidth * pixelSize; i++) {
+				unsigned int x = (i / pixelSize) * 2 * pixelSize + (i % pixelSize);
+				dstRow[i] = (row0[x] + row0[x+pixelSize] + row1[x] + row1[x+pixelSize] + 2) >> 2;
+			}
+		} else {
+			for(unsigned int x=0; x < dstWidth; x++) {
+				unsigned int x0 = (x*2 < srcWidth ? x*2 : srcWidth-1) * pixelSize;
+				unsigned int x1 = (x*2+1 < srcWidth ? x*2+1 : srcWidth-1) * pixelSize;
+				for(unsigned int c=0; c < pixelSize; c++) {
+					dstRow[x*pixelSize+c] = (row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2;
+				}
+			}
+		}
+	}
+}
+
+static unsigned int getLevelDimension(unsigned int size, unsigned int level) {
+	size = size >> level;
+	return size > 0 ? size : 1;
+}
+
+CookedTexture::CookedTexture() {
+	mapping = NULL;
+	width = 0;
+	height = 0;
+	type = Image::IMAGE_RGBA;
+	numLevels = 0;
+	flags = 0;
+	sourceHash = 0;
+}
+
+CookedTexture::~CookedTexture() {
+	OSBasics::unmapFile(mapping);
+}
+
+unsigned int CookedTexture::getPixelSize(int type) {
+	switch(type) {
+		case Image::IMAGE_RGB:
+			return 3;
+		case Image::IMAGE_RGBA:
+			return 4;
+	}
+	return 0;
+}
+
+size_t CookedTexture::getLevelSize(unsigned int width, unsigned int height, int type, unsigned int level) {
+	return (size_t)getLevelDimension(width, level) * getLevelDimension(height, level) * getPixelSize(type);
+}
+
+size_t CookedTexture::getLevelOffset(unsigned int width, unsigned int height, int type, unsigned int level) {
+	// every level starts 16 byte aligned, padded after the end of the level before it
+	size_t offset = (HEADER_SIZE + 15) & ~((size_t)15);
+	for(unsigned int i=0; i < level; i++) {
+		offset = (offset + getLevelSize(width, height, type, i) + 15) & ~((size_t)15);
+	}
+	return offset;
+}
+
+char *CookedTexture::getLevelData(unsigned int level) const {
+	if(!mapping || level >= numLevels)
+		return NULL;
+	return (char*)mapping->data + getLevelOffset(width, height, type, level);
+}
+
+unsigned int CookedTexture::getLevelWidth(unsigned int level) const {
+	return getLevelDimension(width, level);
+}
+
+unsigned int CookedTexture::getLevelHeight(unsigned int level) const {
+	return getLevelDimension(height, level);
+}
+
+bool CookedTexture::loadFromFile(const String& fileName) {
+	OSBasics::unmapFile(mapping);
+	mapping = OSBasics::mapFile(fileName);
+	if(!mapping)
+		return false;
+
+	unsigned int header[8];
+	if(mapping->size >= HEADER_SIZE) {
+		memcpy(header, mapping->data, sizeof(header));
+		memcpy(&sourceHash, mapping->data + sizeof(header), sizeof(sourceHash));
+	}
+
+	if(mapping->size < HEADER_SIZE || memcmp(mapping->data, PTEX_MAGIC, 4) != 0 || header[1] != VERSION) {
+		Logger::log("Invalid cooked texture %s\n", fileName.c_str());
+		OSBasics::unmapFile(mapping);
+		mapping = NULL;
+		return false;
+	}
+
+	type = header[2];
+	width = header[3];
+	height = header[4];
+	numLevels = header[5];
+	flags = header[6];
+
+	if(getPixelSize(type) == 0 || width == 0 || height == 0 || numLevels == 0 || numLevels > 32 || getLevelOffset(width, height, type, numLevels) > mapping->size) {
+		Logger::log("Invalid cooked texture %s\n", fileName.c_str());
+		OSBasics::unmapFile(mapping);
+		mapping = NULL;
+		numLevels = 0;
+		return false;
+	}
+	return true;
+}
+
+bool CookedTexture::cookImage(Image *image, const String& fileName, unsigned long long sourceHash, bool premultiply, bool createMipmaps) {
+	int type = image->getType();
+	unsigned int pixelSize = getPixelSize(type);
+	if(!image->getPixels() || pixelSize == 0) {
+		Logger::log("Unable to cook %s, only RGB and RGBA images with pixel data can be cooked\n", fileName.c_str());
+		return false;
+	}
+
+	unsigned int width = image->getWidth();
+	unsigned int height = image->getHeight();
+	unsigned int flags = 0;
+	if(premultiply && type == Image::IMAGE_RGBA) {
+		image->premultiplyAlpha();
+		flags |= FLAG_PREMULTIPLIED;
+	}
+
+	unsigned int numLevels = 1;
+	if(createMipmaps) {
+		while(getLevelDimension(width, numLevels-1) > 1 || getLevelDimension(height, numLevels-1) > 1) {
+			numLevels++;
+		}
+	}
+
+	size_t fileSize = getLevelOffset(width, height, type, numLevels);
+	char *data = (char*)malloc(fileSize);
+	if(!data)
+		return false;
+	memset(data, 0, fileSize);
+
+	unsigned int header[8] = {0, VERSION, (unsigned int)type, width, height, numLevels, flags, 0};
+	memcpy(data, header, sizeof(header));
+	memcpy(data, PTEX_MAGIC, 4);
+	memcpy(data + sizeof(header), &sourceHash, sizeof(sourceHash));
+
+	memcpy(data + getLevelOffset(width, height, type, 0), image->getPixels(), width * height * pixelSize);
+	for(unsigned int i=1; i < numLevels; i++) {
+		downsampleLevel((unsigned char*)data + getLevelOffset(width, height, type, i-1), getLevelDimension(width, i-1), getLevelDimension(height, i-1), (unsigned char*)data + getLevelOffset(width, height, type, i), getLevelDimension(width, i), getLevelDimension(height, i), pixelSize);
+	}
+
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file) {
+		Logger::log("Unable to write cooked texture %s\n", fileName.c_str());
+		free(data);
+		return false;
+	}
+	bool written = (fwrite(data, 1, fileSize, file) == fileSize);
+	fclose(file);
+	free(data);
+	return written;
+}
+
+String CookedTexture::getCookedPath(const String& fileName) {
+	size_t extensionStart = fileName.rfind(".");
+	size_t folderStart = fileName.rfind("/");
+	if(extensionStart == std::string::npos || (folderStart != std::string::npos && extensionStart < folderStart))
+		return fileName + ".ptex";
+	return fileName.substr(0, extensionStart) + ".ptex";
+}
+
+unsigned long long CookedTexture::hashData(const char *data, size_t size) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for(size_t i=0; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+unsigned long long CookedTexture::hashFile(const String& fileName) {
+	OSFileMapping *fileMapping = OSBasics::mapFile(fileName);
+	if(!fileMapping)
+		return 0;
+	unsigned long long hash = hashData(fileMapping->data, fileMapping->size);
+	OSBasics::unmapFile(fileMapping);
+	return hash;
+}
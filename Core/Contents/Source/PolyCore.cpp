@@ -23,13 +23,20 @@
 #include "PolyCore.h"
 #include "PolyCoreInput.h"
 #include "PolyCoreServices.h"
+#include "PolyJobPool.h"
+#include "PolyMemory.h"
+#include "PolyProfiler.h"
+#include "PolyRenderer.h"
 
 #ifdef _WINDOWS
 #include <windows.h>
-
+#include <direct.h>
+#else
+#include <unistd.h>
 #endif
 
 #include <time.h>
+#include <stdlib.h>
 
 namespace Polycode {
 	
@@ -75,6 +82,22 @@ namespace Polycode {
 		
 		refreshInterval = 1000 / frameRate;		
 		threadedEventMutex = NULL;
+		jobPool = NULL;
+		idleHandler = NULL;
+		
+		// the Cocoa core replaces these with its bundle resources and the user's home folder
+		char workingDirectory[4096];
+#ifdef _WINDOWS
+		if(_getcwd(workingDirectory, sizeof(workingDirectory)))
+			defaultWorkingDirectory = workingDirectory;
+		const char *homeDirectory = getenv("USERPROFILE");
+#else
+		if(getcwd(workingDirectory, sizeof(workingDirectory)))
+			defaultWorkingDirectory = workingDirectory;
+		const char *homeDirectory = getenv("HOME");
+#endif
+		if(homeDirectory)
+			userHomeDirectory = homeDirectory;
 	}
 	
 	void Core::enableMouse(bool newval) {
@@ -99,6 +122,7 @@ namespace Polycode {
 	
 	Core::~Core() {
 		printf("Shutting down core");
+		delete jobPool;
 		delete services;
 	}
 	
@@ -171,6 +195,8 @@ namespace Polycode {
 	}
 							
 	void Core::updateCore() {
+		Profiler::beginFrame();
+		FrameArena::getFrameArena()->reset();
 		frames++;
 		frameTicks = getTicks();
 		elapsed = frameTicks - lastFrameTicks;
@@ -207,16 +233,34 @@ namespace Polycode {
 		
 		unlockMutex(threadedEventMutex);
 		}
+		
+		if(services->getRenderer())
+			Profiler::setCount(Profiler::COUNTER_DRAW_CALLS, services->getRenderer()->getDrawCallCount());
+		Profiler::endFrame();
+	}
+	
+	void Core::setIdleHandler(CoreIdleHandler *handler) {
+		idleHandler = handler;
 	}
 	
 	void Core::doSleep() {
 		unsigned int ticks = getTicks();
 		unsigned int ticksSinceLastFrame = ticks - lastSleepFrameTicks;
+		unsigned int idleTime = 0;
+		if(ticksSinceLastFrame <= refreshInterval)
+			idleTime = refreshInterval - ticksSinceLastFrame;
+		
+		if(idleHandler) {
+			idleHandler->handleIdle(idleTime);
+			unsigned int idleUsed = getTicks() - ticks;
+			idleTime = idleUsed < idleTime ? idleTime - idleUsed : 0;
+		}
+		
 		if(ticksSinceLastFrame <= refreshInterval)
 #ifdef _WINDOWS
-		Sleep((refreshInterval - ticksSinceLastFrame));
+		Sleep(idleTime);
 #else
-			usleep((refreshInterval - ticksSinceLastFrame) * 1000);
+			usleep(idleTime * 1000);
 #endif
 		lastSleepFrameTicks = ticks;
 	}
@@ -226,6 +270,17 @@ namespace Polycode {
 		return fps;
 	}
 	
+	JobPool *Core::getJobPool() {
+		if(!jobPool) {
+			int numThreads = JobPool::getProcessorCount() - 1;
+			if(numThreads < 2) {
+				numThreads = 2;
+			}
+			jobPool = new JobPool(numThreads);
+		}
+		return jobPool;
+	}
+
 	CoreServices *Core::getServices() {
 		return services;
 	}
@@ -26,6 +26,7 @@
 #include "PolyInputEvent.h"
 #include "PolyLogger.h"
 #include "PolyModule.h"
+#include "PolyProfiler.h"
 #include "PolyResourceManager.h"
 #include "PolyMaterialManager.h"
 #include "PolyRenderer.h"
@@ -206,14 +207,21 @@ Renderer *CoreServices::getRenderer() {
 }
 
 void CoreServices::Update(int elapsed) {
+	POLY_PROFILE_ZONE("CoreServices::Update");
 	
-	for(int i=0; i < updateModules.size(); i++) {
-		updateModules[i]->Update(elapsed);
+	{
+		POLY_PROFILE_ZONE("Update modules");
+		for(int i=0; i < updateModules.size(); i++) {
+			updateModules[i]->Update(elapsed);
+		}
 	}
 
 	timerManager->Update();
 	tweenManager->Update();
-	materialManager->Update(elapsed);
+	{
+		POLY_PROFILE_ZONE("MaterialManager::Update");
+		materialManager->Update(elapsed);
+	}
 		
 	if(drawScreensFirst) {
 		if(renderer->doClearBuffer)
@@ -232,7 +240,10 @@ void CoreServices::Update(int elapsed) {
 			renderer->clearScreen();		
 		sceneManager->Update();
 		screenManager->Update();	
-	}	
+	}
+	
+	// after the scenes, so sound and listener positions set by entities this frame go out together
+	soundManager->Update(elapsed);
 }
 
 SoundManager *CoreServices::getSoundManager() {
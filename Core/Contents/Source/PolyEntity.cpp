@@ -20,6 +20,7 @@
  THE SOFTWARE.
 */
 #include "PolyEntity.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 
 using namespace Polycode;
@@ -326,9 +327,37 @@ Matrix4 Entity::getConcatenatedRollMatrix() const {
 }
 
 
+Polycode::Rectangle Entity::clipScissorBox(bool parentScissorEnabled, const Polycode::Rectangle &oldScissorBox) const {
+	Polycode::Rectangle finalScrissorBox = scissorBox;		
+	
+	// make sure that our scissor box is constrained to the parent one if it exists
+	if(parentScissorEnabled) {
+		if(finalScrissorBox.x < oldScissorBox.x)
+			finalScrissorBox.x = oldScissorBox.x;
+		if(finalScrissorBox.x > oldScissorBox.x + oldScissorBox.w)
+			finalScrissorBox.x = oldScissorBox.x + oldScissorBox.w;
+
+			
+		if(finalScrissorBox.x+finalScrissorBox.w > oldScissorBox.x + oldScissorBox.w)
+			finalScrissorBox.w = oldScissorBox.x - finalScrissorBox.x;
+
+		if(finalScrissorBox.y < oldScissorBox.y)
+			finalScrissorBox.y = oldScissorBox.y;
+		if(finalScrissorBox.y > oldScissorBox.y + oldScissorBox.h)
+			finalScrissorBox.y = oldScissorBox.y + oldScissorBox.h;
+
+		if(finalScrissorBox.y+finalScrissorBox.h > oldScissorBox.y + oldScissorBox.h)
+			finalScrissorBox.h = oldScissorBox.y - finalScrissorBox.y;
+
+	}
+	return finalScrissorBox;
+}
+
 void Entity::transformAndRender() {
 	if(!renderer || !enabled)
 		return;
+	
+	POLY_PROFILE_COUNT(Profiler::COUNTER_ENTITIES_VISITED, 1);
 
 	if(depthOnly) {
 		renderer->drawToColorBuffer(false);
@@ -341,31 +370,7 @@ void Entity::transformAndRender() {
 		isScissorEnabled = renderer->isScissorEnabled();
 		oldScissorBox = renderer->getScissorBox();
 		renderer->enableScissor(true);
-		
-		Polycode::Rectangle finalScrissorBox = scissorBox;		
-		
-		// make sure that our scissor box is constrained to the parent one if it exists
-		if(isScissorEnabled) {
-			if(finalScrissorBox.x < oldScissorBox.x)
-				finalScrissorBox.x = oldScissorBox.x;
-			if(finalScrissorBox.x > oldScissorBox.x + oldScissorBox.w)
-				finalScrissorBox.x = oldScissorBox.x + oldScissorBox.w;
-
-				
-			if(finalScrissorBox.x+finalScrissorBox.w > oldScissorBox.x + oldScissorBox.w)
-				finalScrissorBox.w = oldScissorBox.x - finalScrissorBox.x;
-
-			if(finalScrissorBox.y < oldScissorBox.y)
-				finalScrissorBox.y = oldScissorBox.y;
-			if(finalScrissorBox.y > oldScissorBox.y + oldScissorBox.h)
-				finalScrissorBox.y = oldScissorBox.y + oldScissorBox.h;
-
-			if(finalScrissorBox.y+finalScrissorBox.h > oldScissorBox.y + oldScissorBox.h)
-				finalScrissorBox.h = oldScissorBox.y - finalScrissorBox.y;
-
-		}
-		
-		renderer->setScissorBox(finalScrissorBox);
+		renderer->setScissorBox(clipScissorBox(isScissorEnabled, oldScissorBox));
 	}
 		
 	renderer->pushMatrix();
@@ -21,6 +21,7 @@
 */
 
 #include "PolyEvent.h"
+#include "PolyMemory.h"
 
 namespace Polycode {
 	
@@ -38,6 +39,22 @@ namespace Polycode {
 		
 	}
 	
+	static PoolAllocator *getEventAllocator() {
+		static PoolAllocator *allocator = new PoolAllocator("Event");
+		return allocator;
+	}
+	
+	void *Event::operator new(size_t size) {
+		void *ptr = getEventAllocator()->allocate(size);
+		if(!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+	
+	void Event::operator delete(void *ptr) {
+		MemoryPool::release(ptr);
+	}
+	
 	const String& Event::getEventType() const {
 		return eventType;
 	}
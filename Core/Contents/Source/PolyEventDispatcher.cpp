@@ -22,6 +22,7 @@
 
 #include "PolyEventDispatcher.h"
 #include "PolyEvent.h"
+#include "PolyProfiler.h"
 
 namespace Polycode {
 	
@@ -64,6 +65,7 @@ namespace Polycode {
 	}
 	
 	void EventDispatcher::__dispatchEvent(Event *event, int eventCode) {
+		POLY_PROFILE_COUNT(Profiler::COUNTER_EVENTS_DISPATCHED, 1);
 		//		event->setDispatcher(dynamic_cast<void*>(this));
 		event->setDispatcher(this);
 		event->setEventCode(eventCode);
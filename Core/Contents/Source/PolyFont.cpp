@@ -74,6 +74,10 @@ bool Font::isValid() const {
 }
 
 Font::~Font() {
+	for(std::map<unsigned long long, FontGlyph*>::iterator it = glyphCache.begin(); it != glyphCache.end(); it++) {
+		FT_Done_Glyph(it->second->glyph);
+		delete it->second;
+	}
 	if(buffer) {
 		free(buffer);
 	}
@@ -82,3 +86,34 @@ Font::~Font() {
 FT_Face Font::getFace() {
 	return ftFace;
 }
+
+FontGlyph *Font::getCachedGlyph(FT_ULong charCode, int size, int antiAliasMode) {
+	unsigned long long key = ((unsigned long long)(charCode & 0xFFFFFFFF) << 32) | ((unsigned long long)(size & 0x7FFFFFFF) << 1) | (antiAliasMode == 0 ? 0 : 1);
+	std::map<unsigned long long, FontGlyph*>::iterator it = glyphCache.find(key);
+	if(it != glyphCache.end())
+		return it->second;
+	
+	FT_Set_Pixel_Sizes(ftFace, 0, size);
+	FT_UInt glyphIndex = FT_Get_Char_Index(ftFace, charCode);
+	
+	// 0 is Label::ANTIALIAS_FULL
+	FT_Error error;
+	if(antiAliasMode == 0) {
+		error = FT_Load_Glyph(ftFace, glyphIndex, FT_LOAD_TARGET_LIGHT);
+	} else {
+		error = FT_Load_Glyph(ftFace, glyphIndex, FT_LOAD_DEFAULT);
+	}
+	if(error)
+		return NULL;
+	
+	FT_Glyph glyph;
+	if(FT_Get_Glyph(ftFace->glyph, &glyph) != 0)
+		return NULL;
+	
+	FontGlyph *fontGlyph = new FontGlyph();
+	fontGlyph->glyph = glyph;
+	fontGlyph->glyphIndex = glyphIndex;
+	fontGlyph->advance = ftFace->glyph->advance.x >> 6;
+	glyphCache[key] = fontGlyph;
+	return fontGlyph;
+}
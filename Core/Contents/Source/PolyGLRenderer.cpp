@@ -33,6 +33,8 @@
 #include "PolyMesh.h"
 #include "PolyModule.h"
 #include "PolyPolygon.h"
+#include "PolyProfiler.h"
+#include <string.h>
 
 #if defined(_WINDOWS) && !defined(_MINGW)
 
@@ -88,6 +90,54 @@ OpenGLRenderer::OpenGLRenderer() : Renderer() {
 	verticesToDraw = 0;
 	
 	glDisable(GL_SCISSOR_TEST);
+	invalidateStateCache();
+}
+
+void OpenGLRenderer::invalidateStateCache() {
+	cachedDepthTest = -1;
+	cachedDepthWrite = -1;
+	cachedAlphaTest = -1;
+	cachedBackfaceCulling = -1;
+	cachedTexturing = -1;
+	cachedBlendingMode = -1;
+	cachedActiveTexture = -1;
+	cachedDitherFade = -1;
+	cachedVertexColorValid = false;
+	currentTexture = NULL;
+	modelviewMatrixDirty = true;
+	projectionMatrixDirty = true;
+}
+
+void OpenGLRenderer::uploadMatrices() {
+	if(projectionMatrixDirty) {
+		glMatrixMode(GL_PROJECTION);
+		glLoadMatrixf(getProjectionUploadMatrix());
+		glMatrixMode(GL_MODELVIEW);
+		projectionMatrixDirty = false;
+	}
+	if(modelviewMatrixDirty) {
+		glLoadMatrixf(getModelviewUploadMatrix());
+		modelviewMatrixDirty = false;
+	}
+}
+
+void OpenGLRenderer::setCachedCapability(GLenum capability, int *cachedValue, bool val) {
+	if(*cachedValue == (int)val)
+		return;
+	if(val)
+		glEnable(capability);
+	else
+		glDisable(capability);
+	*cachedValue = (int)val;
+	stateChangeCount++;
+}
+
+void OpenGLRenderer::setActiveTextureUnit(int unit) {
+	if(cachedActiveTexture == unit)
+		return;
+	glActiveTexture(GL_TEXTURE0+unit);
+	cachedActiveTexture = unit;
+	stateChangeCount++;
 }
 
 void OpenGLRenderer::setClippingPlanes(Number nearPlane_, Number farPlane_) {
@@ -145,13 +195,11 @@ void OpenGLRenderer::Resize(int xRes, int yRes) {
 	this->xRes = xRes;
 	this->yRes = yRes;
 	viewportWidth = xRes;
-	viewportHeight = xRes;
+	viewportHeight = yRes;
 	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 	glClearDepth(1.0f);
 	
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-	gluPerspective(fov,(GLfloat)xRes/(GLfloat)yRes,nearPlane,farPlane);
+	setProjectionMatrix(createPerspectiveMatrix(fov, (Number)xRes/(Number)yRes, nearPlane, farPlane));
 	glViewport(0, 0, xRes, yRes);
 	glScissor(0, 0, xRes, yRes);
 	
@@ -174,6 +222,7 @@ void OpenGLRenderer::Resize(int xRes, int yRes) {
 	glGetIntegerv(GL_MAX_DRAW_BUFFERS, &numBuffers);
 //	Logger::log("MAX_DRAW_BUFFERS: %d \n", numBuffers);
 	
+	invalidateStateCache();
 }
 
 void OpenGLRenderer::setDepthFunction(int depthFunction) {
@@ -188,12 +237,10 @@ void OpenGLRenderer::setDepthFunction(int depthFunction) {
 }
 
 void OpenGLRenderer::enableAlphaTest(bool val) {
-	if(val) {
+	if(val && cachedAlphaTest != 1) {
 		glAlphaFunc ( GL_GREATER, 0.01) ;
-		glEnable ( GL_ALPHA_TEST ) ;		
-	} else {
-		glDisable( GL_ALPHA_TEST ) ;
 	}
+	setCachedCapability(GL_ALPHA_TEST, &cachedAlphaTest, val);
 }
 
 void OpenGLRenderer::setLineSmooth(bool val) {
@@ -204,62 +251,22 @@ void OpenGLRenderer::setLineSmooth(bool val) {
 }
 
 void OpenGLRenderer::resetViewport() {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov,(GLfloat)viewportWidth/(GLfloat)viewportHeight,nearPlane,farPlane);	
+	setProjectionMatrix(createPerspectiveMatrix(fov, viewportWidth/viewportHeight, nearPlane, farPlane));
 	glViewport(0, 0, viewportWidth, viewportHeight);
 	glScissor(0, 0, viewportWidth, viewportHeight);
-	glMatrixMode(GL_MODELVIEW);	
-
 }
 
 Vector3 OpenGLRenderer::Unproject(Number x, Number y) {
-	Vector3 coords;
-	GLfloat wx, wy, wz;
-	GLdouble cx, cy, cz;
-	
-	GLdouble mv[16];
-	glGetDoublev( GL_MODELVIEW_MATRIX, mv );
-	
-	GLdouble proj[16];
-	glGetDoublev( GL_PROJECTION_MATRIX, proj );
-	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	wx = ( Number ) x;
-	wy = ( Number ) vp[3] - ( Number ) y;
-	glReadPixels( x, wy, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wz );
-	
-	gluUnProject( wx, wy, wz, mv, proj, vp, &cx, &cy, &cz );
-	
-	coords = Vector3( cx, cy, cz );
-	
-	return coords;
-	
+	// the depth value still has to come from GL, the matrices don't
+	GLfloat wz;
+	glReadPixels(x, viewportHeight - y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wz);
+	return unprojectPoint(x, y, wz, modelviewMatrix, projectionMatrix);
 }
 
 Vector3 OpenGLRenderer::projectRayFrom2DCoordinate(Number x, Number y) {
-	GLdouble nearPlane[3],farPlane[3];
-	
-	GLdouble mv[16];
-	Matrix4 camInverse = cameraMatrix.inverse();	
-	Matrix4 cmv;
-	cmv.identity();
-	cmv = cmv * camInverse;
-	
-	for(int i=0; i < 16; i++) {
-		mv[i] = cmv.ml[i];
-	}
-	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	gluUnProject(x, yRes - y, 0.0, mv, sceneProjectionMatrix, vp,  &nearPlane[0], &nearPlane[1], &nearPlane[2]);
-	gluUnProject(x, yRes - y, 1.0, mv, sceneProjectionMatrix, vp,  &farPlane[0], &farPlane[1], &farPlane[2]);
-	
-	Vector3 nearVec(nearPlane[0], nearPlane[1], nearPlane[2]);
-	Vector3 farVec(farPlane[0], farPlane[1], farPlane[2]);
+	Matrix4 camInverse = cameraMatrix.inverse();
+	Vector3 nearVec = unprojectPoint(x, y, 0.0, camInverse, sceneProjectionMatrix);
+	Vector3 farVec = unprojectPoint(x, y, 1.0, camInverse, sceneProjectionMatrix);
 		
 	Vector3 dirVec = (farVec) - (nearVec);	
 	dirVec.Normalize();
@@ -268,26 +275,18 @@ Vector3 OpenGLRenderer::projectRayFrom2DCoordinate(Number x, Number y) {
 }
 
 void OpenGLRenderer::enableDepthWrite(bool val) {
+	if(cachedDepthWrite == (int)val)
+		return;
 	if(val)
 		glDepthMask(GL_TRUE);
 	else
 		glDepthMask(GL_FALSE);	
+	cachedDepthWrite = (int)val;
+	stateChangeCount++;
 }
 
 void OpenGLRenderer::enableDepthTest(bool val) {
-	if(val)
-		glEnable(GL_DEPTH_TEST);
-	else
-		glDisable(GL_DEPTH_TEST);	
-}
-
-void OpenGLRenderer::setModelviewMatrix(Matrix4 m) {
-	glLoadMatrixd(m.ml);
-}
-
-void OpenGLRenderer::multModelviewMatrix(Matrix4 m) {
-//	glMatrixMode(GL_MODELVIEW);
-	glMultMatrixd(m.ml);
+	setCachedCapability(GL_DEPTH_TEST, &cachedDepthTest, val);
 }
 
 void OpenGLRenderer::enableLighting(bool enable) {
@@ -306,6 +305,7 @@ void OpenGLRenderer::createVertexBufferForMesh(Mesh *mesh) {
 void OpenGLRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer) {
 	OpenGLVertexBuffer *glVertexBuffer = (OpenGLVertexBuffer*)buffer;
 
+	uploadMatrices();
 	glEnableClientState(GL_VERTEX_ARRAY);		
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	glEnableClientState(GL_NORMAL_ARRAY);	
@@ -374,6 +374,8 @@ void OpenGLRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuff
 	}	
 	
 	glDrawArrays( mode, 0, buffer->getVertexCount() );
+	drawCallCount++;
+	POLY_PROFILE_COUNT(Profiler::COUNTER_VERTICES, buffer->getVertexCount());
 	
 	glDisableClientState( GL_VERTEX_ARRAY);	
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );		
@@ -408,6 +410,8 @@ void OpenGLRenderer::enableFog(bool enable) {
 }
 
 void OpenGLRenderer::setBlendingMode(int blendingMode) {
+	if(cachedBlendingMode == blendingMode)
+		return;
 	switch(blendingMode) {
 		case BLEND_MODE_NORMAL:
 				glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -429,18 +433,8 @@ void OpenGLRenderer::setBlendingMode(int blendingMode) {
 		break;
 	}
 	glEnable(GL_BLEND);
-}
-
-Matrix4 OpenGLRenderer::getProjectionMatrix() {
-	Number m[16];
-	glGetDoublev( GL_PROJECTION_MATRIX, m);
-	return Matrix4(m);
-}
-
-Matrix4 OpenGLRenderer::getModelviewMatrix() {
-	Number m[16];
-    glGetDoublev( GL_MODELVIEW_MATRIX, m);
-	return Matrix4(m);
+	cachedBlendingMode = blendingMode;
+	stateChangeCount++;
 }
 
 Image *OpenGLRenderer::renderScreenToImage() {
@@ -482,16 +476,11 @@ void OpenGLRenderer::_setOrthoMode(Number orthoSizeX, Number orthoSizeY) {
 	this->orthoSizeY = orthoSizeY;
 	
 	if(!orthoMode) {
-		glMatrixMode(GL_PROJECTION);
-		glPushMatrix();
-		glLoadIdentity();
-		glOrtho(-orthoSizeX*0.5,orthoSizeX*0.5,-orthoSizeY*0.5,orthoSizeY*0.5,-farPlane,farPlane);
+		pushProjectionMatrix();
+		setProjectionMatrix(createOrthoMatrix(-orthoSizeX*0.5,orthoSizeX*0.5,-orthoSizeY*0.5,orthoSizeY*0.5,-farPlane,farPlane));
 		orthoMode = true;
 	}
-	glGetDoublev( GL_PROJECTION_MATRIX, sceneProjectionMatrixOrtho);
-		
-	glMatrixMode(GL_MODELVIEW);	
-	glLoadIdentity();	
+	loadIdentity();	
 }
 
 void OpenGLRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
@@ -505,27 +494,22 @@ void OpenGLRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
 	setBlendingMode(BLEND_MODE_NORMAL);
 	if(!orthoMode) {
 		glDisable(GL_LIGHTING);
-		glMatrixMode(GL_PROJECTION);
 		glDisable(GL_CULL_FACE);
-		glPushMatrix();
-		glLoadIdentity();
+		cachedBackfaceCulling = 0;
+		pushProjectionMatrix();
 		
 		if(centered) {
-			glOrtho(-xSize*0.5,xSize*0.5,ySize*0.5,-ySize*0.5,-1.0f,1.0f);		
+			setProjectionMatrix(createOrthoMatrix(-xSize*0.5,xSize*0.5,ySize*0.5,-ySize*0.5,-1.0f,1.0f));
 		} else {
-			glOrtho(0.0f,xSize,ySize,0,-1.0f,1.0f);
+			setProjectionMatrix(createOrthoMatrix(0.0f,xSize,ySize,0,-1.0f,1.0f));
 		}
 		orthoMode = true;
 	}
-	glMatrixMode(GL_MODELVIEW);	
-	glLoadIdentity();
+	loadIdentity();
 }
 
 void OpenGLRenderer::enableBackfaceCulling(bool val) {
-	if(val)
-		glEnable(GL_CULL_FACE);
-	else
-		glDisable(GL_CULL_FACE);
+	setCachedCapability(GL_CULL_FACE, &cachedBackfaceCulling, val);
 }
 
 void OpenGLRenderer::setPerspectiveMode() {
@@ -535,14 +519,14 @@ void OpenGLRenderer::setPerspectiveMode() {
 		}
 		glEnable (GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
-		glMatrixMode( GL_PROJECTION );
-		glPopMatrix();
-		glMatrixMode( GL_MODELVIEW );
+		cachedDepthTest = 1;
+		cachedBackfaceCulling = 1;
+		popProjectionMatrix();
 		orthoMode = false;
 	}
-	glLoadIdentity();
+	loadIdentity();
 	
-	glGetDoublev( GL_PROJECTION_MATRIX, sceneProjectionMatrix);
+	sceneProjectionMatrix = projectionMatrix;
 	currentTexture = NULL;
 }
 
@@ -550,8 +534,9 @@ void OpenGLRenderer::BeginRender() {
 	if(doClearBuffer) {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	}
-	glLoadIdentity();
-	currentTexture = NULL;
+	resetRenderStats();
+	invalidateStateCache();
+	loadIdentity();
 }
 
 void OpenGLRenderer::setClearColor(Number r, Number g, Number b) {
@@ -559,18 +544,6 @@ void OpenGLRenderer::setClearColor(Number r, Number g, Number b) {
 	glClearColor(r,g,b,0.0f);
 }
 
-void OpenGLRenderer::translate3D(Vector3 *position) {
-	glTranslatef(position->x, position->y, position->z);
-}
-
-void OpenGLRenderer::translate3D(Number x, Number y, Number z) {
-	glTranslatef(x, y, z);
-}
-
-void OpenGLRenderer::scale3D(Vector3 *scale) {
-	glScalef(scale->x, scale->y, scale->z);
-}
-
 void OpenGLRenderer::bindFrameBufferTexture(Texture *texture) {
 	if(currentFrameBufferTexture) {
 		previousFrameBufferTexture = currentFrameBufferTexture;
@@ -682,6 +655,11 @@ Texture *OpenGLRenderer::createTexture(unsigned int width, unsigned int height,
 	return newTexture;
 }
 
+Texture *OpenGLRenderer::createTextureWithMipmaps(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int type) {
+	OpenGLTexture *newTexture = new OpenGLTexture(width, height, levelData, numLevels, clamp, textureFilteringMode, type);
+	return newTexture;
+}
+
 void OpenGLRenderer::destroyTexture(Texture *texture) {
 	OpenGLTexture *glTex = (OpenGLTexture*)texture;
 	delete glTex;
@@ -709,6 +687,42 @@ void OpenGLRenderer::cullFrontFaces(bool val) {
 	}
 }
 
+void OpenGLRenderer::setDitherFade(Number amount, bool inverted) {
+	int coverage = (int)(amount * 16.0 + 0.5);
+	if(coverage < 0)
+		coverage = 0;
+	if(coverage >= 16) {
+		if(cachedDitherFade != 16)
+			glDisable(GL_POLYGON_STIPPLE);
+		cachedDitherFade = 16;
+		return;
+	}
+	
+	int key = coverage + (inverted ? 32 : 0);
+	if(cachedDitherFade == key)
+		return;
+	
+	// 4x4 Bayer matrix tiled over the 32x32 stipple pattern
+	static const int bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+	GLubyte pattern[128];
+	for(int y=0; y < 32; y++) {
+		for(int b=0; b < 4; b++) {
+			GLubyte bits = 0;
+			for(int x=0; x < 8; x++) {
+				int threshold = bayer[y % 4][x % 4];
+				bool draw = inverted ? threshold >= 16 - coverage : threshold < coverage;
+				if(draw)
+					bits |= (0x80 >> x);
+			}
+			pattern[(y*4)+b] = bits;
+		}
+	}
+	glPolygonStipple(pattern);
+	if(cachedDitherFade < 0 || cachedDitherFade == 16)
+		glEnable(GL_POLYGON_STIPPLE);
+	cachedDitherFade = key;
+}
+
 void OpenGLRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
 	GLbitfield clearMask = 0;
 	
@@ -751,6 +765,8 @@ void OpenGLRenderer::applyMaterial(Material *material,  ShaderBinding *localOpti
 				PolycodeShaderModule *shaderModule = (PolycodeShaderModule*)material->shaderModule;
 				shaderModule->applyShaderMaterial(this, material, localOptions, shaderIndex);
 				currentShaderModule = shaderModule;
+				// the module binds textures and blending itself
+				invalidateTextureCache();
 			}
 		break;
 	}
@@ -774,37 +790,33 @@ void OpenGLRenderer::clearShader() {
 		currentShaderModule = NULL;
 	}
 	currentMaterial = NULL;
+	
+	invalidateTextureCache();
+}
+
+void OpenGLRenderer::invalidateTextureCache() {
+	cachedActiveTexture = -1;
+	cachedTexturing = -1;
+	currentTexture = NULL;
+	cachedBlendingMode = -1;
 }
 
 void OpenGLRenderer::setTexture(Texture *texture) {
 
-	if(texture == NULL) {
-		glActiveTexture(GL_TEXTURE0);		
-		glDisable(GL_TEXTURE_2D);
+	setActiveTextureUnit(0);
+	
+	if(texture == NULL || renderMode != RENDER_MODE_NORMAL) {
+		setCachedCapability(GL_TEXTURE_2D, &cachedTexturing, false);
 		return;
 	}
 	
-	if(renderMode == RENDER_MODE_NORMAL) {
-		glActiveTexture(GL_TEXTURE0);	
-		glEnable (GL_TEXTURE_2D);
-				
-		if(currentTexture != texture) {			
-			OpenGLTexture *glTexture = (OpenGLTexture*)texture;
-			glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
-		}
-	} else {
-		glDisable(GL_TEXTURE_2D);
+	setCachedCapability(GL_TEXTURE_2D, &cachedTexturing, true);
+	if(currentTexture != texture) {			
+		OpenGLTexture *glTexture = (OpenGLTexture*)texture;
+		glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
+		stateChangeCount++;
+		currentTexture = texture;
 	}
-	
-	currentTexture = texture;
-}
-
-void OpenGLRenderer::pushMatrix() {
-	glPushMatrix();
-}
-
-void OpenGLRenderer::popMatrix() {
-	glPopMatrix();
 }
 
 void OpenGLRenderer::pushRenderDataArray(RenderDataArray *array) {
@@ -980,6 +992,8 @@ void OpenGLRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayDat
 
 void OpenGLRenderer::drawArrays(int drawType) {
 	
+	uploadMatrices();
+	
 	GLenum mode = GL_TRIANGLES;
 	
 	switch(drawType) {
@@ -1025,6 +1039,8 @@ void OpenGLRenderer::drawArrays(int drawType) {
 	}
 	
 	glDrawArrays( mode, 0, verticesToDraw);	
+	drawCallCount++;
+	POLY_PROFILE_COUNT(Profiler::COUNTER_VERTICES, verticesToDraw);
 	
 	verticesToDraw = 0;
 		
@@ -1055,6 +1071,8 @@ void OpenGLRenderer::drawScreenQuad(Number qx, Number qy) {
 	Number xscale = qx/((Number)viewportWidth) * 2.0f;
 	Number yscale = qy/((Number)viewportHeight) * 2.0f;	
 
+	cachedVertexColorValid = false;
+	uploadMatrices();
 	glBegin(GL_QUADS);
 		glColor4f(1.0f,1.0f,1.0f,1.0f);
 
@@ -1073,26 +1091,14 @@ void OpenGLRenderer::drawScreenQuad(Number qx, Number qy) {
 	setPerspectiveMode();
 }
 
-
-void OpenGLRenderer::translate2D(Number x, Number y) {
-	glTranslatef(x, y, 0.0f);
-}
-
-void OpenGLRenderer::scale2D(Vector2 *scale) {
-	glScalef(scale->x, scale->y, 1.0f);
-}
-
-void OpenGLRenderer::loadIdentity() {
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-}
-
-void OpenGLRenderer::rotate2D(Number angle) {
-	glRotatef(angle, 0.0f, 0.0f, 1.0f);
-}
-
 void OpenGLRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
-	glColor4f(r,g,b,a);
+	GLfloat color[4] = {(GLfloat)r, (GLfloat)g, (GLfloat)b, (GLfloat)a};
+	if(cachedVertexColorValid && memcmp(color, cachedVertexColor, sizeof(color)) == 0)
+		return;
+	glColor4fv(color);
+	memcpy(cachedVertexColor, color, sizeof(color));
+	cachedVertexColorValid = true;
+	stateChangeCount++;
 }
 
 void OpenGLRenderer::EndRender() {
@@ -36,8 +36,8 @@ THE SOFTWARE.
 #include "PolyGLCubemap.h"
 #include "PolyMaterial.h"
 #include "PolyGLTexture.h"
-
-#include "tinyxml.h"
+#include "PolyLogger.h"
+#include "PolyXMLReader.h"
 
 using std::vector;
 
@@ -111,8 +111,7 @@ String GLSLShaderModule::getShaderType() {
 	return "glsl";
 }
 
-Shader *GLSLShaderModule::createShader(TiXmlNode *node) {
-	TiXmlNode* pChild, *pChild2, *pChild3;	
+Shader *GLSLShaderModule::createShader(XMLReader *reader) {
 	GLSLProgram *vp = NULL;
 	GLSLProgram *fp = NULL;
 	GLSLShader *retShader = NULL;
@@ -120,46 +119,45 @@ Shader *GLSLShaderModule::createShader(TiXmlNode *node) {
 	std::vector<String> expectedTextures;
 	std::vector<ProgramParam> expectedFragmentParams;	
 	std::vector<ProgramParam> expectedVertexParams;
-		
-	TiXmlElement *nodeElement = node->ToElement();
-	if (!nodeElement) return NULL; // Skip comment nodes
 	
-	for (pChild = node->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-		TiXmlElement *pChildElement = pChild->ToElement();
-		if (!pChildElement) continue; // Skip comment nodes
+	String shaderName = reader->getAttribute("name").toString();
 		
-		if(strcmp(pChild->Value(), "vp") == 0) {
-			vp = (GLSLProgram*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_PROGRAM, String(pChildElement->Attribute("source")));
+	int shaderDepth = reader->getDepth();
+	while(reader->nextChild(shaderDepth)) {
+		if(reader->getName() == "vp") {
+			vp = (GLSLProgram*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_PROGRAM, reader->getAttribute("source").toString());
 			if(vp) {
-				for (pChild2 = pChild->FirstChild(); pChild2 != 0; pChild2 = pChild2->NextSibling()) {
-					if(strcmp(pChild2->Value(), "params") == 0) {
-						for (pChild3 = pChild2->FirstChild(); pChild3 != 0; pChild3 = pChild3->NextSibling()) {
-							if(strcmp(pChild3->Value(), "param") == 0) {
-								expectedVertexParams.push_back(addParamToProgram(vp,pChild3));
+				int programDepth = reader->getDepth();
+				while(reader->nextChild(programDepth)) {
+					if(reader->getName() == "params") {
+						int paramsDepth = reader->getDepth();
+						while(reader->nextChild(paramsDepth)) {
+							if(reader->getName() == "param") {
+								expectedVertexParams.push_back(addParamToProgram(vp, reader));
 							}
 						}
 					}
 				}
 			}
 		}
-		if(strcmp(pChild->Value(), "fp") == 0) {
-			fp = (GLSLProgram*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_PROGRAM, String(pChildElement->Attribute("source")));
+		if(reader->getName() == "fp") {
+			fp = (GLSLProgram*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_PROGRAM, reader->getAttribute("source").toString());
 			if(fp) {
-				for (pChild2 = pChild->FirstChild(); pChild2 != 0; pChild2 = pChild2->NextSibling()) {
-					if(strcmp(pChild2->Value(), "params") == 0) {
-						for (pChild3 = pChild2->FirstChild(); pChild3 != 0; pChild3 = pChild3->NextSibling()) {
-							if(strcmp(pChild3->Value(), "param") == 0) {
-								expectedFragmentParams.push_back(addParamToProgram(fp,pChild3));	
+				int programDepth = reader->getDepth();
+				while(reader->nextChild(programDepth)) {
+					if(reader->getName() == "params") {
+						int paramsDepth = reader->getDepth();
+						while(reader->nextChild(paramsDepth)) {
+							if(reader->getName() == "param") {
+								expectedFragmentParams.push_back(addParamToProgram(fp, reader));	
 							}
 						}
 					}
-					if(strcmp(pChild2->Value(), "textures") == 0) {
-						for (pChild3 = pChild2->FirstChild(); pChild3 != 0; pChild3 = pChild3->NextSibling()) {
-							if(strcmp(pChild3->Value(), "texture") == 0) {
-								TiXmlElement *texNodeElement = pChild3->ToElement();
-								if (texNodeElement) {
-									expectedTextures.push_back(String(texNodeElement->Attribute("name")));
-								}
+					if(reader->getName() == "textures") {
+						int texturesDepth = reader->getDepth();
+						while(reader->nextChild(texturesDepth)) {
+							if(reader->getName() == "texture") {
+								expectedTextures.push_back(reader->getAttribute("name").toString());
 							}
 						}
 					}					
@@ -170,7 +168,7 @@ Shader *GLSLShaderModule::createShader(TiXmlNode *node) {
 	}
 	if(vp != NULL && fp != NULL) {
 		GLSLShader *cgShader = new GLSLShader(vp,fp);
-		cgShader->setName(String(nodeElement->Attribute("name")));
+		cgShader->setName(shaderName);
 		cgShader->expectedTextures = expectedTextures;
 		cgShader->expectedVertexParams = expectedVertexParams;
 		cgShader->expectedFragmentParams = expectedFragmentParams;				
@@ -460,7 +458,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 	return true;
 }
 
-GLSLProgramParam GLSLShaderModule::addParamToProgram(GLSLProgram *program,TiXmlNode *node) {
+GLSLProgramParam GLSLShaderModule::addParamToProgram(GLSLProgram *program, XMLReader *reader) {
 		bool isAuto = false;
 		int autoID = 0;
 		int paramType = GLSLProgramParam::PARAM_UNKNOWN;
@@ -468,20 +466,15 @@ GLSLProgramParam GLSLShaderModule::addParamToProgram(GLSLProgram *program,TiXmlN
 		void *minData = NULL;
 		void *maxData = NULL;
 		
-		TiXmlElement *nodeElement = node->ToElement();
-		if (!nodeElement) return; // Skip comment nodes
-
-		isAuto = false;
+		isAuto = (reader->getAttribute("auto") == "true");
 		
-		if(nodeElement->Attribute("auto")) {
-			if(strcmp(nodeElement->Attribute("auto"), "true") == 0) {
-				isAuto = true;
-			}
-		}
+		String name = reader->getAttribute("name").toString();
+		String type = reader->getAttribute("type").toString();
+		String defaultValue = reader->getAttribute("default").toString();
 		
-		GLSLProgramParam::createParamData(&paramType, nodeElement->Attribute("type"), nodeElement->Attribute("default"), nodeElement->Attribute("min"), nodeElement->Attribute("max"), &defaultData, &minData, &maxData);
+		GLSLProgramParam::createParamData(&paramType, type, defaultValue, reader->getAttribute("min").toString(), reader->getAttribute("max").toString(), &defaultData, &minData, &maxData);
 		
-		return program->addParam(nodeElement->Attribute("name"), nodeElement->Attribute("type"), nodeElement->Attribute("default"), isAuto, autoID, paramType, defaultData, minData, maxData);
+		return program->addParam(name, type, defaultValue, isAuto, autoID, paramType, defaultData, minData, maxData);
 }
 
 void GLSLShaderModule::reloadPrograms() {
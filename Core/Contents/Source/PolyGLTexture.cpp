@@ -36,7 +36,19 @@ OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char *text
 	this->filteringMode = filteringMode;
 	glTextureLoaded = false;
 	frameBufferID = FRAMEBUFFER_NULL;
-	
+	setGLFormat(type);
+	recreateFromImageData();
+}
+
+OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int filteringMode, int type) : Texture(width, height, levelData[0], clamp, numLevels > 1, type) {
+	this->filteringMode = filteringMode;
+	glTextureLoaded = false;
+	frameBufferID = FRAMEBUFFER_NULL;
+	setGLFormat(type);
+	createGLTexture(levelData, numLevels);
+}
+
+void OpenGLTexture::setGLFormat(int type) {
 	switch(type) {
 		case Image::IMAGE_RGB:
 			glTextureType = GL_RGB;
@@ -54,11 +66,27 @@ OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char *text
 			pixelType = GL_UNSIGNED_BYTE;	
 		break;
 	}
-		
-	recreateFromImageData();
+}
+
+void OpenGLTexture::uploadMipmaps(char **levelData, unsigned int numLevels) {
+	// RGB rows of odd sized levels aren't 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, pixelSize == 3 ? 1 : 4);
+	int levelWidth = width;
+	int levelHeight = height;
+	for(unsigned int i=0; i < numLevels; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, glTextureFormat, levelWidth, levelHeight, 0, glTextureType, pixelType, levelData[i]);
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
 void OpenGLTexture::recreateFromImageData() {
+	createGLTexture(NULL, 0);
+}
+
+void OpenGLTexture::createGLTexture(char **levelData, unsigned int numLevels) {
 	
 	Number anisotropy = CoreServices::getInstance()->getRenderer()->getAnisotropyAmount();
 	
@@ -86,7 +114,11 @@ void OpenGLTexture::recreateFromImageData() {
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 				if(textureData) {
-					gluBuild2DMipmaps(GL_TEXTURE_2D, glTextureFormat, width, height, glTextureType, pixelType, textureData );
+					if(numLevels > 1) {
+						uploadMipmaps(levelData, numLevels);
+					} else {
+						gluBuild2DMipmaps(GL_TEXTURE_2D, glTextureFormat, width, height, glTextureType, pixelType, textureData );
+					}
 				}
 			} else {
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
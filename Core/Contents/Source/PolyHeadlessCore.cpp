@@ -0,0 +1,221 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyHeadlessCore.h"
+#include "PolyRecordingRenderer.h"
+#include "PolyCoreServices.h"
+#include "PolyThreaded.h"
+#include "OSBasics.h"
+#include <stdio.h>
+
+using namespace Polycode;
+using std::vector;
+
+HeadlessCore::HeadlessCore(int xRes, int yRes, int frameRate) : Core(xRes, yRes, false, false, 0, 0, frameRate, -1) {
+	simulatedTicks = 0;
+	timeStep = refreshInterval;
+
+	renderer = new RecordingRenderer();
+	services->setRenderer(renderer);
+	renderer->Resize(xRes, yRes);
+}
+
+HeadlessCore::~HeadlessCore() {
+}
+
+RecordingRenderer *HeadlessCore::getRecordingRenderer() {
+	return (RecordingRenderer*)renderer;
+}
+
+bool HeadlessCore::Update() {
+	if(!running)
+		return false;
+
+	simulatedTicks += timeStep;
+
+	renderer->BeginRender();
+	updateCore();
+	renderer->EndRender();
+	return running;
+}
+
+unsigned int HeadlessCore::getTicks() {
+	return simulatedTicks;
+}
+
+void HeadlessCore::setTimeStep(unsigned int msecs) {
+	timeStep = msecs;
+}
+
+void HeadlessCore::advanceTime(unsigned int msecs) {
+	simulatedTicks += msecs;
+}
+
+void HeadlessCore::setCursor(int cursorType) {
+}
+
+#ifdef _WINDOWS
+
+DWORD WINAPI HeadlessLaunchThread(LPVOID data) {
+	Threaded *threaded = (Threaded*)data;
+	threaded->runThread();
+	return 1;
+}
+
+void HeadlessCore::createThread(Threaded *target) {
+	Core::createThread(target);
+	DWORD threadID;
+	CreateThread(NULL, 0, HeadlessLaunchThread, target, 0, &threadID);
+}
+
+void HeadlessCore::lockMutex(CoreMutex *mutex) {
+	WaitForSingleObject(((HeadlessCoreMutex*)mutex)->winMutex, INFINITE);
+}
+
+void HeadlessCore::unlockMutex(CoreMutex *mutex) {
+	ReleaseMutex(((HeadlessCoreMutex*)mutex)->winMutex);
+}
+
+CoreMutex *HeadlessCore::createMutex() {
+	HeadlessCoreMutex *mutex = new HeadlessCoreMutex();
+	mutex->winMutex = CreateMutex(NULL, FALSE, NULL);
+	return mutex;
+}
+
+String HeadlessCore::executeExternalCommand(String command) {
+	return "";
+}
+
+#else
+
+void *HeadlessLaunchThread(void *data) {
+	Threaded *threaded = (Threaded*)data;
+	threaded->runThread();
+	return NULL;
+}
+
+void HeadlessCore::createThread(Threaded *target) {
+	Core::createThread(target);
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, HeadlessLaunchThread, (void*)target) == 0) {
+		pthread_detach(thread);
+	}
+}
+
+void HeadlessCore::lockMutex(CoreMutex *mutex) {
+	pthread_mutex_lock(&((HeadlessCoreMutex*)mutex)->pMutex);
+}
+
+void HeadlessCore::unlockMutex(CoreMutex *mutex) {
+	pthread_mutex_unlock(&((HeadlessCoreMutex*)mutex)->pMutex);
+}
+
+CoreMutex *HeadlessCore::createMutex() {
+	HeadlessCoreMutex *mutex = new HeadlessCoreMutex();
+	pthread_mutex_init(&mutex->pMutex, NULL);
+	return mutex;
+}
+
+String HeadlessCore::executeExternalCommand(String command) {
+	FILE *fp = popen(command.c_str(), "r");
+	if(!fp) {
+		return "Unable to execute command";
+	}
+
+	char line[1024];
+	String retString;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		retString = retString + String(line);
+	}
+	pclose(fp);
+	return retString;
+}
+
+#endif
+
+void HeadlessCore::copyStringToClipboard(const String& str) {
+	clipboardString = str;
+}
+
+String HeadlessCore::getClipboardString() {
+	return clipboardString;
+}
+
+vector<Polycode::Rectangle> HeadlessCore::getVideoModes() {
+	vector<Polycode::Rectangle> retVector;
+	retVector.push_back(Polycode::Rectangle(0, 0, xRes, yRes));
+	return retVector;
+}
+
+void HeadlessCore::createFolder(const String& folderPath) {
+	OSBasics::createFolder(folderPath);
+}
+
+void HeadlessCore::copyDiskItem(const String& itemPath, const String& destItemPath) {
+	FILE *inFile = fopen(itemPath.c_str(), "rb");
+	if(!inFile)
+		return;
+	FILE *outFile = fopen(destItemPath.c_str(), "wb");
+	if(!outFile) {
+		fclose(inFile);
+		return;
+	}
+	char buffer[4096];
+	size_t numRead;
+	while((numRead = fread(buffer, 1, sizeof(buffer), inFile)) > 0) {
+		fwrite(buffer, 1, numRead, outFile);
+	}
+	fclose(outFile);
+	fclose(inFile);
+}
+
+void HeadlessCore::moveDiskItem(const String& itemPath, const String& destItemPath) {
+	rename(itemPath.c_str(), destItemPath.c_str());
+}
+
+void HeadlessCore::removeDiskItem(const String& itemPath) {
+	OSBasics::removeItem(itemPath);
+}
+
+String HeadlessCore::openFolderPicker() {
+	return "";
+}
+
+vector<String> HeadlessCore::openFilePicker(vector<CoreFileExtension> extensions, bool allowMultiple) {
+	return vector<String>();
+}
+
+void HeadlessCore::setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel) {
+	this->fullScreen = fullScreen;
+	this->aaLevel = aaLevel;
+	resizeTo(xRes, yRes);
+}
+
+void HeadlessCore::resizeTo(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	renderer->Resize(xRes, yRes);
+	dispatchEvent(new Event(), EVENT_CORE_RESIZE);
+}
+
+void HeadlessCore::openURL(String url) {
+}
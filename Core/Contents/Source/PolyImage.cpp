@@ -751,7 +751,7 @@ bool Image::loadPNG(const String& fileName) {
 	int i;
 	png_bytepp row_pointers = NULL;
 	
-	infile = OSBasics::open(fileName.c_str(), "rb");
+	infile = OSBasics::openMapped(fileName);
 	if (!infile) {
 		Logger::log("Error opening png file\n");	
 		return false;
@@ -0,0 +1,232 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyJobPool.h"
+
+#ifdef _WINDOWS
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+namespace Polycode {
+
+	class JobPoolPlatformData {
+		public:
+#ifdef _WINDOWS
+			CRITICAL_SECTION lock;
+			CONDITION_VARIABLE jobAdded;
+			CONDITION_VARIABLE jobFinished;
+			std::vector<HANDLE> threads;
+#else
+			pthread_mutex_t lock;
+			pthread_cond_t jobAdded;
+			pthread_cond_t jobFinished;
+			std::vector<pthread_t> threads;
+#endif
+	};
+
+}
+
+#ifdef _WINDOWS
+
+static DWORD WINAPI JobPoolThreadFunc(LPVOID data) {
+	((JobPool*)data)->runThread();
+	return 0;
+}
+
+#define LOCK_POOL(p) EnterCriticalSection(&(p)->lock)
+#define UNLOCK_POOL(p) LeaveCriticalSection(&(p)->lock)
+#define WAIT_POOL(p, cond) SleepConditionVariableCS(&(p)->cond, &(p)->lock, INFINITE)
+#define SIGNAL_POOL(p, cond) WakeConditionVariable(&(p)->cond)
+#define BROADCAST_POOL(p, cond) WakeAllConditionVariable(&(p)->cond)
+
+#else
+
+static void *JobPoolThreadFunc(void *data) {
+	((JobPool*)data)->runThread();
+	return NULL;
+}
+
+#define LOCK_POOL(p) pthread_mutex_lock(&(p)->lock)
+#define UNLOCK_POOL(p) pthread_mutex_unlock(&(p)->lock)
+#define WAIT_POOL(p, cond) pthread_cond_wait(&(p)->cond, &(p)->lock)
+#define SIGNAL_POOL(p, cond) pthread_cond_signal(&(p)->cond)
+#define BROADCAST_POOL(p, cond) pthread_cond_broadcast(&(p)->cond)
+
+#endif
+
+Job::Job() {
+	group = NULL;
+}
+
+Job::~Job() {
+
+}
+
+JobPool::JobPool(int numThreads) {
+	stopping = false;
+	platformData = new JobPoolPlatformData();
+
+#ifdef _WINDOWS
+	InitializeCriticalSection(&platformData->lock);
+	InitializeConditionVariable(&platformData->jobAdded);
+	InitializeConditionVariable(&platformData->jobFinished);
+	for(int i=0; i < numThreads; i++) {
+		HANDLE thread = CreateThread(NULL, 0, JobPoolThreadFunc, this, 0, NULL);
+		if(thread) {
+			platformData->threads.push_back(thread);
+		}
+	}
+#else
+	pthread_mutex_init(&platformData->lock, NULL);
+	pthread_cond_init(&platformData->jobAdded, NULL);
+	pthread_cond_init(&platformData->jobFinished, NULL);
+	for(int i=0; i < numThreads; i++) {
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, JobPoolThreadFunc, this) == 0) {
+			platformData->threads.push_back(thread);
+		}
+	}
+#endif
+}
+
+JobPool::~JobPool() {
+	LOCK_POOL(platformData);
+	stopping = true;
+	BROADCAST_POOL(platformData, jobAdded);
+	UNLOCK_POOL(platformData);
+
+	for(int i=0; i < platformData->threads.size(); i++) {
+#ifdef _WINDOWS
+		WaitForSingleObject(platformData->threads[i], INFINITE);
+		CloseHandle(platformData->threads[i]);
+#else
+		pthread_join(platformData->threads[i], NULL);
+#endif
+	}
+
+	for(int i=0; i < jobs.size(); i++) {
+		delete jobs[i];
+	}
+	jobs.clear();
+
+#ifdef _WINDOWS
+	DeleteCriticalSection(&platformData->lock);
+#else
+	pthread_cond_destroy(&platformData->jobFinished);
+	pthread_cond_destroy(&platformData->jobAdded);
+	pthread_mutex_destroy(&platformData->lock);
+#endif
+	delete platformData;
+}
+
+int JobPool::getNumThreads() const {
+	return platformData->threads.size();
+}
+
+int JobPool::getProcessorCount() {
+#ifdef _WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(count < 1) {
+		return 1;
+	}
+	return count;
+#endif
+}
+
+void JobPool::addJob(Job *job, JobGroup *group) {
+	job->group = group;
+	LOCK_POOL(platformData);
+	if(group) {
+		group->pendingJobs++;
+	}
+	jobs.push_back(job);
+	SIGNAL_POOL(platformData, jobAdded);
+	UNLOCK_POOL(platformData);
+}
+
+void JobPool::runJobs(const std::vector<Job*> &jobList) {
+	JobGroup group;
+	for(int i=0; i < jobList.size(); i++) {
+		addJob(jobList[i], &group);
+	}
+	wait(&group);
+}
+
+Job *JobPool::takeJob(JobGroup *group) {
+	for(std::deque<Job*>::iterator it = jobs.begin(); it != jobs.end(); it++) {
+		if(group == NULL || (*it)->group == group) {
+			Job *job = *it;
+			jobs.erase(it);
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void JobPool::runJob(Job *job) {
+	UNLOCK_POOL(platformData);
+	JobGroup *group = job->group;
+	job->run();
+	delete job;
+	LOCK_POOL(platformData);
+	if(group) {
+		group->pendingJobs--;
+		BROADCAST_POOL(platformData, jobFinished);
+	}
+}
+
+void JobPool::wait(JobGroup *group) {
+	LOCK_POOL(platformData);
+	while(group->pendingJobs > 0) {
+		Job *job = takeJob(group);
+		if(!job) {
+			WAIT_POOL(platformData, jobFinished);
+			continue;
+		}
+		runJob(job);
+	}
+	UNLOCK_POOL(platformData);
+}
+
+void JobPool::runThread() {
+	LOCK_POOL(platformData);
+	while(true) {
+		while(!stopping && jobs.empty()) {
+			WAIT_POOL(platformData, jobAdded);
+		}
+		if(stopping) {
+			break;
+		}
+		Job *job = takeJob(NULL);
+		runJob(job);
+	}
+	UNLOCK_POOL(platformData);
+}
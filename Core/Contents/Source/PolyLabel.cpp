@@ -31,12 +31,13 @@ GlyphData::GlyphData() {
 	glyphs = NULL;
 	positions = NULL;
 	num_glyphs = 0;	
+	capacity = 0;
 	trailingAdvance = 0;
 }
 
 GlyphData::~GlyphData() {
-	delete glyphs;
-	delete positions;
+	free(glyphs);
+	free(positions);
 }
 
 
@@ -199,79 +200,62 @@ Color Label::getColorForIndex(unsigned int index) {
 }
 
 void Label::precacheGlyphs(String text, GlyphData *glyphData) {
-	if(glyphData->glyphs)
-		free(glyphData->glyphs);
-	if(glyphData->positions)
-		free(glyphData->positions);
-		
 	int num_chars = text.length();
 		
-		
-	glyphData->glyphs = (FT_Glyph*) malloc(sizeof(FT_Glyph) * num_chars);
-	glyphData->positions = (FT_Vector*) malloc(sizeof(FT_Vector) * num_chars);
+	if((unsigned int)num_chars > glyphData->capacity) {
+		free(glyphData->glyphs);
+		free(glyphData->positions);
+		glyphData->glyphs = (FT_Glyph*) malloc(sizeof(FT_Glyph) * num_chars);
+		glyphData->positions = (FT_Vector*) malloc(sizeof(FT_Vector) * num_chars);
+		glyphData->capacity = num_chars;
+	}
 	memset(glyphData->positions, 0, sizeof(FT_Vector) * num_chars);
 	
 	FT_Face face = font->getFace();
-	FT_GlyphSlot  slot = face->glyph;
-	FT_UInt       glyph_index;
 	FT_Bool       use_kerning;
 	FT_UInt       previous;
 
-	FT_Error error;
-
 	int pen_x = 0;
 	int pen_y = 0;
 
 	glyphData->num_glyphs  = 0;
-	use_kerning = FT_HAS_KERNING(font->getFace());
+	glyphData->trailingAdvance = 0;
+	use_kerning = FT_HAS_KERNING(face);
 	previous    = 0;
 	
 	FT_Set_Pixel_Sizes(face, 0,  size);
 	
 	int advanceMultiplier;
+	FontGlyph *fontGlyph;
 	for(int n = 0; n < num_chars; n++ ) {
 		if(text[n] == '\t') {
-			glyph_index = FT_Get_Char_Index(face, ' ');		
+			fontGlyph = font->getCachedGlyph(' ', size, antiAliasMode);
 			advanceMultiplier = 4;			
 		} else {
-			glyph_index = FT_Get_Char_Index(face, (FT_ULong)text[n]);		
+			fontGlyph = font->getCachedGlyph((FT_ULong)text[n], size, antiAliasMode);
 			advanceMultiplier = 1;
 		}
-
 		
-		if(use_kerning && previous && glyph_index) {
+		if(!fontGlyph) {
+			continue;
+		}
+		
+		if(use_kerning && previous && fontGlyph->glyphIndex) {
 			FT_Vector delta;
-			FT_Get_Kerning( face, previous, glyph_index, FT_KERNING_DEFAULT, &delta);
+			FT_Get_Kerning( face, previous, fontGlyph->glyphIndex, FT_KERNING_DEFAULT, &delta);
 			pen_x += delta.x >> 6;
 		}
 
 		glyphData->positions[glyphData->num_glyphs].x = pen_x;
 		glyphData->positions[glyphData->num_glyphs].y = pen_y;
-
-		switch(antiAliasMode) {
-			case ANTIALIAS_FULL:
-				error = FT_Load_Glyph( face, glyph_index, FT_LOAD_TARGET_LIGHT);			
-			break;
-			default:
-				error = FT_Load_Glyph( face, glyph_index, FT_LOAD_DEFAULT);			
-			break;
-		}
-		
-		if (error) {
-			continue;
-		}
-		
-		error = FT_Get_Glyph( face->glyph, &glyphData->glyphs[glyphData->num_glyphs] );
-		if ( error ) {
-			continue;
-		}
+		glyphData->glyphs[glyphData->num_glyphs] = fontGlyph->glyph;
 		
 		if(n == num_chars-1 && (text[n] == ' ' || text[n] == '\t')) {
-			glyphData->trailingAdvance = (slot->advance.x >> 6) * advanceMultiplier;
+			glyphData->trailingAdvance = fontGlyph->advance * advanceMultiplier;
 		}
 
-		pen_x += (slot->advance.x >> 6) * advanceMultiplier;
-		previous = glyph_index;
+		pen_x += fontGlyph->advance * advanceMultiplier;
+		previous = fontGlyph->glyphIndex;
 		glyphData->num_glyphs++;
 		
 	}
@@ -373,7 +357,9 @@ void Label::renderGlyphs(GlyphData *glyphData) {
 					bit->left - xAdjustOffset,
 					height - bit->top + baseLineOffset, glyphColor);
 
-			FT_Done_Glyph( image );			
+			// glyphs belong to the font's cache, only free the bitmap made from them
+			if(image != glyphData->glyphs[n])
+				FT_Done_Glyph( image );			
 		}
 	}
 }
@@ -21,42 +21,409 @@
 */
 
 #include "PolyLogger.h"
-#include <stdio.h>
-#include <stdarg.h>
+#include "PolyProfiler.h"
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <iostream>
 
+#ifdef _WINDOWS
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+	#define vsnprintf _vsnprintf
+	#define snprintf _snprintf
+#endif
+
 using namespace Polycode;
 
+int Logger::logLevel = Logger::LEVEL_INFO;
+bool Logger::async = true;
+bool Logger::logToStderr = true;
+FILE *Logger::logFile = NULL;
+
+LogEntry *Logger::entries = NULL;
+volatile long Logger::enqueuePosition = 0;
+long Logger::dequeuePosition = 0;
+volatile long Logger::consumerLock = 0;
+volatile long Logger::writerState = 0;
+volatile long Logger::droppedMessages = 0;
+unsigned int Logger::reportedDroppedMessages = 0;
+
+static const long WRITER_STOPPED = 0;
+static const long WRITER_RUNNING = 1;
+static const long WRITER_SHUT_DOWN = 2;
+
+static volatile long queueInitState = 0;
+
+#ifdef _WINDOWS
+static HANDLE writerThread = NULL;
+#else
+static pthread_t writerThread;
+#endif
+
+static bool compareAndSwap(volatile long *value, long oldValue, long newValue) {
+#ifdef _WINDOWS
+	return InterlockedCompareExchange(value, newValue, oldValue) == oldValue;
+#else
+	return __sync_bool_compare_and_swap(value, oldValue, newValue);
+#endif
+}
+
+static void atomicIncrement(volatile long *value) {
+#ifdef _WINDOWS
+	InterlockedIncrement(value);
+#else
+	__sync_add_and_fetch(value, 1);
+#endif
+}
+
+static void memoryBarrier() {
+#ifdef _WINDOWS
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+static void sleepMilliseconds(unsigned int msecs) {
+#ifdef _WINDOWS
+	Sleep(msecs);
+#else
+	usleep(msecs * 1000);
+#endif
+}
+
+// distance between two positions in the ring buffer, safe across wrap around
+static long positionDifference(long a, long b) {
+	return (long)((unsigned long)a - (unsigned long)b);
+}
+
+static unsigned int formatMessage(char *buffer, unsigned int bufferSize, const char *format, va_list args) {
+	int length = vsnprintf(buffer, bufferSize, format, args);
+	if(length < 0 || length >= (int)bufferSize)
+		length = bufferSize - 1;
+	buffer[length] = '\0';
+	return length;
+}
+
+LogField::LogField(const char *key, const char *value) {
+	this->key = key;
+	strncpy(this->value, value ? value : "(null)", MAX_VALUE_LENGTH-1);
+	this->value[MAX_VALUE_LENGTH-1] = '\0';
+}
+
+LogField::LogField(const char *key, int value) {
+	this->key = key;
+	snprintf(this->value, MAX_VALUE_LENGTH, "%d", value);
+}
+
+LogField::LogField(const char *key, unsigned int value) {
+	this->key = key;
+	snprintf(this->value, MAX_VALUE_LENGTH, "%u", value);
+}
+
+LogField::LogField(const char *key, Number value) {
+	this->key = key;
+	snprintf(this->value, MAX_VALUE_LENGTH, "%f", value);
+}
+
+LogField::LogField(const char *key, const void *value) {
+	this->key = key;
+	snprintf(this->value, MAX_VALUE_LENGTH, "%p", value);
+}
+
+LogRateLimiter::LogRateLimiter(unsigned int maxPerSecond) {
+	this->maxPerSecond = maxPerSecond;
+	windowStart = 0;
+	count = 0;
+	suppressed = 0;
+}
+
+bool LogRateLimiter::allow(int level) {
+	// not synchronized, so the limit is approximate when several threads share a call site
+	unsigned long long now = Profiler::getTime();
+	if(count == 0 || now - windowStart >= 1000000) {
+		windowStart = now;
+		count = 0;
+	}
+
+	if(count >= maxPerSecond) {
+		suppressed++;
+		return false;
+	}
+	count++;
+
+	if(suppressed > 0) {
+		unsigned int numSuppressed = suppressed;
+		suppressed = 0;
+		Logger::logMessage(level, "(%u similar messages suppressed)\n", numSuppressed);
+	}
+	return true;
+}
+
 void Logger::logw(const char *str) {
 	std::wcout << str << std::endl;
 }
 
 void Logger::log(const char *format, ...) {
+	if(!isLevelEnabled(DEFAULT_LEVEL))
+		return;
 	va_list args;
+	va_start(args, format);
+	logMessageV(DEFAULT_LEVEL, format, args);
+	va_end(args);
+}
 
+void Logger::logMessage(int level, const char *format, ...) {
+	if(!isLevelEnabled(level))
+		return;
+	va_list args;
 	va_start(args, format);
-	vfprintf(stderr, format, args);
+	logMessageV(level, format, args);
 	va_end(args);
+}
+
+void Logger::logMessageV(int level, const char *format, va_list args) {
+	if(!isLevelEnabled(level))
+		return;
+
+	if(async && writerState != WRITER_SHUT_DOWN) {
+		if(writerState == WRITER_STOPPED)
+			startWriter();
+		if(writerState == WRITER_RUNNING) {
+			enqueue(level, format, args);
+			return;
+		}
+	}
+
+	char buffer[LogEntry::MAX_MESSAGE_LENGTH];
+	unsigned int length = formatMessage(buffer, LogEntry::MAX_MESSAGE_LENGTH, format, args);
+
+	// write anything still queued first, so messages stay in order
+	while(!compareAndSwap(&consumerLock, 0, 1)) {}
+	drainQueue();
+	writeMessage(level, buffer, length);
+	if(logToStderr)
+		fflush(stderr);
+	if(logFile)
+		fflush(logFile);
+	consumerLock = 0;
+}
+
+void Logger::logFields(int level, const char *message, const LogField *fields, unsigned int numFields) {
+	if(!isLevelEnabled(level))
+		return;
+
+	char buffer[LogEntry::MAX_MESSAGE_LENGTH];
+	unsigned int length = 0;
+	length += snprintf(buffer, LogEntry::MAX_MESSAGE_LENGTH, "%s", message);
+	for(unsigned int i=0; i < numFields && length < LogEntry::MAX_MESSAGE_LENGTH; i++) {
+		length += snprintf(buffer + length, LogEntry::MAX_MESSAGE_LENGTH - length, " %s=%s", fields[i].key, fields[i].value);
+	}
+	buffer[LogEntry::MAX_MESSAGE_LENGTH-1] = '\0';
+	logMessage(level, "%s", buffer);
+}
+
+void Logger::setLogLevel(int level) {
+	logLevel = level;
+}
+
+void Logger::setAsync(bool val) {
+	if(!val)
+		flush();
+	async = val;
+}
+
+void Logger::setLogFile(const char *fileName) {
+	while(!compareAndSwap(&consumerLock, 0, 1)) {}
+	drainQueue();
+	if(logFile)
+		fclose(logFile);
+	logFile = NULL;
+	if(fileName) {
+		logFile = fopen(fileName, "a");
+	}
+	consumerLock = 0;
+
+	if(fileName && !logFile)
+		logMessage(LEVEL_ERROR, "Unable to open log file %s\n", fileName);
+}
+
+void Logger::setLogToStderr(bool val) {
+	logToStderr = val;
+}
+
+const char *Logger::getLevelName(int level) {
+	switch(level) {
+		case LEVEL_DEBUG:
+			return "debug";
+		case LEVEL_INFO:
+			return "info";
+		case LEVEL_WARNING:
+			return "warning";
+		case LEVEL_ERROR:
+			return "error";
+	}
+	return "";
+}
+
+bool Logger::enqueue(int level, const char *format, va_list args) {
+	long position = enqueuePosition;
+	LogEntry *entry;
+	while(true) {
+		entry = &entries[position & (QUEUE_SIZE-1)];
+		long difference = positionDifference(entry->sequence, position);
+		if(difference == 0) {
+			if(compareAndSwap(&enqueuePosition, position, position+1))
+				break;
+			position = enqueuePosition;
+		} else if(difference < 0) {
+			// the writer has fallen a full buffer behind
+			atomicIncrement(&droppedMessages);
+			return false;
+		} else {
+			position = enqueuePosition;
+		}
+	}
+
+	entry->level = level;
+	entry->length = formatMessage(entry->message, LogEntry::MAX_MESSAGE_LENGTH, format, args);
+	memoryBarrier();
+	entry->sequence = position + 1;
+	return true;
+}
+
+void Logger::writeMessage(int level, const char *message, unsigned int length) {
+	bool newline = (length == 0 || message[length-1] != '\n');
+
+	if(logToStderr) {
+		if(level != DEFAULT_LEVEL)
+			fprintf(stderr, "[%s] ", getLevelName(level));
+		fwrite(message, 1, length, stderr);
+		if(newline)
+			fputc('\n', stderr);
+	}
+
+	if(logFile) {
+		if(level != DEFAULT_LEVEL)
+			fprintf(logFile, "[%s] ", getLevelName(level));
+		fwrite(message, 1, length, logFile);
+		if(newline)
+			fputc('\n', logFile);
+	}
 
 #ifdef MSVC
 #ifdef _DEBUG
-	
-	char buffer[4096];
-	va_start(args, format);
-	vsprintf(buffer, format, args);
-	va_end(args);
+	OutputDebugStringA(message);
+	if(newline)
+		OutputDebugStringA("\n");
+#endif
+#endif
+}
+
+bool Logger::drainQueue() {
+	if(!entries)
+		return false;
+
+	bool wroteMessages = false;
+	while(true) {
+		LogEntry *entry = &entries[dequeuePosition & (QUEUE_SIZE-1)];
+		if(positionDifference(entry->sequence, dequeuePosition+1) < 0)
+			break;
+		memoryBarrier();
+		writeMessage(entry->level, entry->message, entry->length);
+		memoryBarrier();
+		entry->sequence = dequeuePosition + QUEUE_SIZE;
+		dequeuePosition++;
+		wroteMessages = true;
+	}
+
+	unsigned int dropped = droppedMessages;
+	if(dropped != reportedDroppedMessages) {
+		char buffer[128];
+		unsigned int length = snprintf(buffer, sizeof(buffer), "%u log messages dropped, the log queue was full\n", dropped - reportedDroppedMessages);
+		writeMessage(LEVEL_WARNING, buffer, length);
+		reportedDroppedMessages = dropped;
+		wroteMessages = true;
+	}
+
+	if(wroteMessages) {
+		if(logToStderr)
+			fflush(stderr);
+		if(logFile)
+			fflush(logFile);
+	}
+	return wroteMessages;
+}
 
-	WCHAR wbuf[4096];
-	int i = 0;
-	while(buffer[i] != '\0') {
-		wbuf[i] = (WCHAR)buffer[i];
-		++i;
+void Logger::startWriter() {
+	if(compareAndSwap(&queueInitState, 0, 1)) {
+		entries = new LogEntry[QUEUE_SIZE];
+		for(int i=0; i < QUEUE_SIZE; i++) {
+			entries[i].sequence = i;
+		}
+		memoryBarrier();
+		queueInitState = 2;
+	} else {
+		while(queueInitState != 2) {}
+		return;
 	}
-	wbuf[i] = L'\0';
-	OutputDebugString(wbuf);
-	
+
+	// the writer thread exits as soon as it sees any other state, so set this before starting it
+	writerState = WRITER_RUNNING;
+
+	bool started;
+#ifdef _WINDOWS
+	DWORD threadID;
+	writerThread = CreateThread(NULL, 0, writerThreadFunc, NULL, 0, &threadID);
+	started = (writerThread != NULL);
+#else
+	started = (pthread_create(&writerThread, NULL, writerThreadFunc, NULL) == 0);
 #endif
+
+	if(started) {
+		atexit(Logger::shutdown);
+	} else {
+		writerState = WRITER_SHUT_DOWN;
+	}
+}
+
+#ifdef _WINDOWS
+unsigned long __stdcall Logger::writerThreadFunc(void *data) {
+#else
+void *Logger::writerThreadFunc(void *data) {
 #endif
+	while(writerState == WRITER_RUNNING) {
+		bool wroteMessages = false;
+		if(compareAndSwap(&consumerLock, 0, 1)) {
+			wroteMessages = drainQueue();
+			consumerLock = 0;
+		}
+		if(!wroteMessages)
+			sleepMilliseconds(2);
+	}
+	return 0;
+}
+
+void Logger::flush() {
+	while(!compareAndSwap(&consumerLock, 0, 1)) {}
+	drainQueue();
+	consumerLock = 0;
+}
 
+void Logger::shutdown() {
+	if(compareAndSwap(&writerState, WRITER_RUNNING, WRITER_SHUT_DOWN)) {
+#ifdef _WINDOWS
+		WaitForSingleObject(writerThread, INFINITE);
+		CloseHandle(writerThread);
+#else
+		pthread_join(writerThread, NULL);
+#endif
+	}
+	flush();
 }
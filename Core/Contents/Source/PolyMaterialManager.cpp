@@ -28,14 +28,16 @@
 #include "PolyRenderer.h"
 #include "PolyResourceManager.h"
 #include "PolyFixedShader.h"
-
-#include "tinyxml.h"
+#include "PolyCookedTexture.h"
+#include "PolyLogger.h"
+#include "PolyXMLReader.h"
 
 using namespace Polycode;
 using std::vector;
 
 MaterialManager::MaterialManager() {
 	premultiplyAlphaOnLoad = false;
+	useCookedTextures = true;
 }
 
 MaterialManager::~MaterialManager() {
@@ -89,6 +91,16 @@ Texture *MaterialManager::createTextureFromFile(const String& fileName, bool cla
 		return newTexture;
 	}
 	
+	// a cooked texture older than its image was cooked before the image was last edited
+	String cookedPath = CookedTexture::getCookedPath(fileName);
+	if(useCookedTextures && OSBasics::getModificationTime(fileName) <= OSBasics::getModificationTime(cookedPath)) {
+		newTexture = createTextureFromCookedFile(cookedPath, clamp, createMipmaps);
+		if(newTexture) {
+			newTexture->setResourcePath(fileName);
+			return newTexture;
+		}
+	}
+	
 	Image *image = new Image(fileName);
 	if(image->isLoaded()) {
 		if(premultiplyAlphaOnLoad) {
@@ -110,6 +122,34 @@ Texture *MaterialManager::createTextureFromFile(const String& fileName, bool cla
 	return newTexture;
 }
 
+Texture *MaterialManager::createTextureFromCookedFile(const String& fileName, bool clamp, bool createMipmaps) {
+	CookedTexture cookedTexture;
+	if(!cookedTexture.loadFromFile(fileName)) {
+		return NULL;
+	}
+	
+	// a texture cooked with different alpha handling would blend differently than the source image
+	if(cookedTexture.isPremultiplied() != premultiplyAlphaOnLoad) {
+		Logger::log("Ignoring %s, its alpha premultiplication doesn't match the material manager's.\n", fileName.c_str());
+		return NULL;
+	}
+	
+	unsigned int numLevels = createMipmaps ? cookedTexture.getNumLevels() : 1;
+	std::vector<char*> levelData;
+	for(unsigned int i=0; i < numLevels; i++) {
+		levelData.push_back(cookedTexture.getLevelData(i));
+	}
+	
+	Texture *newTexture;
+	if(numLevels > 1) {
+		newTexture = CoreServices::getInstance()->getRenderer()->createTextureWithMipmaps(cookedTexture.getWidth(), cookedTexture.getHeight(), &levelData[0], numLevels, clamp, cookedTexture.getType());
+	} else {
+		newTexture = CoreServices::getInstance()->getRenderer()->createTexture(cookedTexture.getWidth(), cookedTexture.getHeight(), levelData[0], clamp, createMipmaps, cookedTexture.getType());
+	}
+	textures.push_back(newTexture);
+	return newTexture;
+}
+
 Texture *MaterialManager::createFramebufferTexture(int width, int height, int type) {
 	Texture *newTexture = CoreServices::getInstance()->getRenderer()->createFramebufferTexture(width, height);
 	return newTexture;
@@ -163,42 +203,36 @@ Shader *MaterialManager::getShaderByIndex(unsigned int index) {
 		return NULL;
 }
 
-Shader *MaterialManager::createShaderFromXMLNode(TiXmlNode *node) {
-	TiXmlElement *nodeElement = node->ToElement();
-	if (!nodeElement) return NULL; // Skip comment nodes
-	
+Shader *MaterialManager::createShaderFromXMLNode(XMLReader *reader) {
 	Shader *retShader = NULL;
 	
-	if(nodeElement->Attribute("type")) {
-		String shaderType = nodeElement->Attribute("type");
-//		Logger::log("Attempting to create %s shader\n", shaderType.c_str());
-		for(int m=0; m < shaderModules.size(); m++) {
-			PolycodeShaderModule *shaderModule = shaderModules[m];
-			if(shaderModule->getShaderType() == shaderType) {
-				retShader = shaderModule->createShader(node);
-			}
-		}		
-	}
-
+	// the shader module reads on past the start of the element, so the attributes have to be read first
 	int numAreaLights = 0;
 	int numSpotLights = 0;
 		
-	if(nodeElement->Attribute("numAreaLights")) {
-		numAreaLights = atoi(nodeElement->Attribute("numAreaLights"));
+	if(reader->hasAttribute("numAreaLights")) {
+		numAreaLights = reader->getAttribute("numAreaLights").toInt();
 	}
-	if(nodeElement->Attribute("numSpotLights")) {
-		numSpotLights = atoi(nodeElement->Attribute("numSpotLights"));
+	if(reader->hasAttribute("numSpotLights")) {
+		numSpotLights = reader->getAttribute("numSpotLights").toInt();
 	}
 	
-	retShader->screenShader = false;
+	bool screenShader = (reader->getAttribute("screen") == "true");
 	
-	if(nodeElement->Attribute("screen")) {
-		if(String(nodeElement->Attribute("screen")) == "true") {
-			retShader->screenShader = true;
-		}
+	if(reader->hasAttribute("type")) {
+		String shaderType = reader->getAttribute("type").toString();
+//		Logger::log("Attempting to create %s shader\n", shaderType.c_str());
+		for(int m=0; m < shaderModules.size(); m++) {
+			PolycodeShaderModule *shaderModule = shaderModules[m];
+			if(shaderModule->getShaderType() == shaderType) {
+				retShader = shaderModule->createShader(reader);
+				break;
+			}
+		}		
 	}
 	
 	if(retShader) {
+		retShader->screenShader = screenShader;
 		retShader->numAreaLights = numAreaLights;
 		retShader->numSpotLights = numSpotLights;		
 	}	
@@ -206,19 +240,15 @@ Shader *MaterialManager::createShaderFromXMLNode(TiXmlNode *node) {
 	return retShader;
 }
 
-Shader *MaterialManager::setShaderFromXMLNode(TiXmlNode *node) {
-	TiXmlElement *nodeElement = node->ToElement();
-	if (!nodeElement) return NULL; // Skip comment nodes
-	
+Shader *MaterialManager::setShaderFromXMLNode(XMLReader *reader) {
 	Shader *retShader = NULL;
-	if(nodeElement->Attribute("type")) {
-		String shaderType = nodeElement->Attribute("type");
-		if(shaderType == "fixed") {
+	if(reader->hasAttribute("type")) {
+		if(reader->getAttribute("type") == "fixed") {
 			FixedShader *fShader =  new FixedShader();		
 			retShader = fShader;
 		}
 	} else {
-		retShader = (Shader*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_SHADER, nodeElement->Attribute("name"));
+		retShader = (Shader*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_SHADER, reader->getAttribute("name").toString());
 	}
 	return retShader;
 }
@@ -234,14 +264,11 @@ Shader *MaterialManager::setShaderFromXMLNode(TiXmlNode *node) {
 //			}
 
 
-Cubemap *MaterialManager::cubemapFromXMLNode(TiXmlNode *node) {
-	TiXmlElement *nodeElement = node->ToElement();
-	if (!nodeElement) return NULL; // Skip comment nodes
-	
+Cubemap *MaterialManager::cubemapFromXMLNode(XMLReader *reader) {
 	Cubemap *newCubemap = NULL;
 	
-	String name = nodeElement->Attribute("name");
-	String mapString = nodeElement->GetText();
+	String name = reader->getAttribute("name").toString();
+	String mapString = reader->readText().toString();
 	
 	vector<String> maps = mapString.split(",");	
 	if(maps.size() != 6) {
@@ -268,21 +295,41 @@ void MaterialManager::addMaterial(Material *material) {
 std::vector<Material*> MaterialManager::loadMaterialsFromFile(String fileName) {
 	std::vector<Material*> retVector;
 	
-	TiXmlDocument doc(fileName.c_str());
-	doc.LoadFile();
+	XMLReader reader;
+	if(!reader.openFile(fileName)) {
+		Logger::log("XML Error: %s\n", reader.getErrorDescription().c_str());
+		return retVector;
+	}
 	
-	if(doc.Error()) {
-		Logger::log("XML Error: %s\n", doc.ErrorDesc());
-	} else {
-		TiXmlElement *mElem = doc.RootElement()->FirstChildElement("materials");
-		if(mElem) {
-			TiXmlNode* pChild;					
-			for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-				Material *newMat = materialFromXMLNode(pChild);
+	// read the whole file first so a malformed file doesn't leave half of its materials loaded
+	reader.readAll();
+	if(reader.hasError()) {
+		Logger::log("XML Error: %s\n", reader.getErrorDescription().c_str());
+		return retVector;
+	}
+	
+	return loadMaterials(&reader);
+}
+
+std::vector<Material*> MaterialManager::loadMaterials(XMLReader *reader) {
+	std::vector<Material*> retVector;
+	
+	reader->rewind();
+	if(!reader->nextChild(0)) {
+		return retVector;
+	}
+	
+	int rootDepth = reader->getDepth();
+	while(reader->nextChild(rootDepth)) {
+		if(reader->getName() == "materials") {
+			int materialsDepth = reader->getDepth();
+			while(reader->nextChild(materialsDepth)) {
+				Material *newMat = materialFromXMLNode(reader);
 				if (newMat) {
 					retVector.push_back(newMat);
 				}
 			}
+			break;
 		}
 	}
 	
@@ -302,62 +349,52 @@ Material *MaterialManager::createMaterial(String materialName, String shaderName
 	return newMaterial;
 }
 
-Material *MaterialManager::materialFromXMLNode(TiXmlNode *node) {
-	TiXmlElement *nodeElement = node->ToElement();
-	if (!nodeElement) return NULL; // Skip comment nodes
-
-	String mname = nodeElement->Attribute("name");
-	TiXmlNode* pChild, *pChild2,*pChild3;
+Material *MaterialManager::materialFromXMLNode(XMLReader *reader) {
+	String mname = reader->getAttribute("name").toString();
 	Shader *materialShader;
 	ShaderBinding *newShaderBinding;
 	
 	vector<Shader*> materialShaders;
 	vector<ShaderBinding*> newShaderBindings;
 	vector<ShaderRenderTarget*> renderTargets;	
+	vector<RenderTargetBinding*> targetBindings;
+	vector<ShaderBinding*> targetBindingShaderBindings;
 
 	Material *newMaterial = new Material(mname);
 	
 	
-	if(nodeElement->Attribute("blendingMode")) {
-		newMaterial->blendingMode = atoi(nodeElement->Attribute("blendingMode"));
+	if(reader->hasAttribute("blendingMode")) {
+		newMaterial->blendingMode = reader->getAttribute("blendingMode").toInt();
 	}
 
-	for (pChild3 = node->FirstChild(); pChild3 != 0; pChild3 = pChild3->NextSibling()) {
-		TiXmlElement *pChild3Element = pChild3->ToElement();
-		if (!pChild3Element) continue; // Skip comment nodes
-
-		if(strcmp(pChild3->Value(), "rendertargets") == 0) {
+	int materialDepth = reader->getDepth();
+	while(reader->nextChild(materialDepth)) {
+		if(reader->getName() == "rendertargets") {
 			
-			if(pChild3Element->Attribute("type")) {
-				if(strcmp(pChild3Element->Attribute("type"), "rgba_fp16") == 0) {
-					newMaterial->fp16RenderTargets = true;
-				}			
+			if(reader->getAttribute("type") == "rgba_fp16") {
+				newMaterial->fp16RenderTargets = true;
 			}
 		
-			for (pChild = pChild3->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-				TiXmlElement *pChildElement = pChild->ToElement();
-				if (!pChildElement) continue; // Skip comment nodes
-
-				if(strcmp(pChild->Value(), "rendertarget") == 0) {
+			int targetsDepth = reader->getDepth();
+			while(reader->nextChild(targetsDepth)) {
+				if(reader->getName() == "rendertarget") {
 					ShaderRenderTarget *newTarget = new ShaderRenderTarget;
-					newTarget->id = pChildElement->Attribute("id");
+					newTarget->id = reader->getAttribute("id").toString();
 					newTarget->width = CoreServices::getInstance()->getRenderer()->getXRes();
 					newTarget->height = CoreServices::getInstance()->getRenderer()->getYRes();
 					newTarget->sizeMode = ShaderRenderTarget::SIZE_MODE_PIXELS;					
-					if(pChildElement->Attribute("width") && pChildElement->Attribute("height")) {
-						newTarget->width = atof(pChildElement->Attribute("width"));
-						newTarget->height = atof(pChildElement->Attribute("height"));	
-						if(pChildElement->Attribute("sizeMode")) {
-							if(strcmp(pChildElement->Attribute("sizeMode"), "normalized") == 0) {
-								if(newTarget->width > 1.0f)
-									newTarget->width = 1.0f;
-								if(newTarget->height > 1.0f)
-									newTarget->height = 1.0f;
-									
-								newTarget->width = ((Number)CoreServices::getInstance()->getRenderer()->getXRes()) * newTarget->width;
-								newTarget->height = ((Number)CoreServices::getInstance()->getRenderer()->getYRes()) * newTarget->height;
-							}						
-						}
+					if(reader->hasAttribute("width") && reader->hasAttribute("height")) {
+						newTarget->width = reader->getAttribute("width").toNumber();
+						newTarget->height = reader->getAttribute("height").toNumber();	
+						if(reader->getAttribute("sizeMode") == "normalized") {
+							if(newTarget->width > 1.0f)
+								newTarget->width = 1.0f;
+							if(newTarget->height > 1.0f)
+								newTarget->height = 1.0f;
+								
+							newTarget->width = ((Number)CoreServices::getInstance()->getRenderer()->getXRes()) * newTarget->width;
+							newTarget->height = ((Number)CoreServices::getInstance()->getRenderer()->getYRes()) * newTarget->height;
+						}						
 					}						
 //					Texture *newTexture = CoreServices::getInstance()->getMaterialManager()->createNewTexture(newTarget->width, newTarget->height, true);
 					Texture *newTexture, *temp;
@@ -370,98 +407,57 @@ Material *MaterialManager::materialFromXMLNode(TiXmlNode *node) {
 				}
 			}
 		}	
-	}
-	
-	for (pChild3 = node->FirstChild(); pChild3 != 0; pChild3 = pChild3->NextSibling()) {
-		TiXmlElement *pChild3Element = pChild3->ToElement();
-		if (!pChild3Element) continue; // Skip comment nodes
 		
-		if(strcmp(pChild3->Value(), "shader") == 0) {
-			materialShader = setShaderFromXMLNode(pChild3);
+		if(reader->getName() == "shader") {
+			materialShader = setShaderFromXMLNode(reader);
 			if(materialShader) {
 				newShaderBinding = materialShader->createBinding();
 				materialShaders.push_back(materialShader);
 				newShaderBindings.push_back(newShaderBinding);
-				for (pChild = pChild3->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-					TiXmlElement *pChildElement = pChild->ToElement();
-					if (!pChildElement) continue; // Skip comment nodes
-
-					if(strcmp(pChild->Value(), "params") == 0) {
-						for (pChild2 = pChild->FirstChild(); pChild2 != 0; pChild2 = pChild2->NextSibling()) {
-							TiXmlElement *pChild2Element = pChild2->ToElement();
-							if (!pChild2Element) continue; // Skip comment nodes
-
-							if(strcmp(pChild2->Value(), "param") == 0){
-								String pname =  pChild2Element->Attribute("name");
-								String ptype =  pChild2Element->Attribute("type");
-								String pvalue =  pChild2Element->Attribute("value");
+				int shaderDepth = reader->getDepth();
+				while(reader->nextChild(shaderDepth)) {
+					if(reader->getName() == "params") {
+						int paramsDepth = reader->getDepth();
+						while(reader->nextChild(paramsDepth)) {
+							if(reader->getName() == "param") {
+								String pname =  reader->getAttribute("name").toString();
+								String ptype =  reader->getAttribute("type").toString();
+								String pvalue =  reader->getAttribute("value").toString();
 								newShaderBinding->addParam(ptype, pname, pvalue);
 							}						
 						}
 					}
-					if(strcmp(pChild->Value(), "targettextures") == 0) {
-						for (pChild2 = pChild->FirstChild(); pChild2 != 0; pChild2 = pChild2->NextSibling()) {
-							TiXmlElement *pChild2Element = pChild2->ToElement();
-							if (!pChild2Element) continue; // Skip comment nodes
-
-							if(strcmp(pChild2->Value(), "targettexture") == 0){
+					if(reader->getName() == "targettextures") {
+						int targetTexturesDepth = reader->getDepth();
+						while(reader->nextChild(targetTexturesDepth)) {
+							if(reader->getName() == "targettexture") {
 							
 								RenderTargetBinding* newBinding = new RenderTargetBinding;
-								newBinding->id = pChild2Element->Attribute("id");
-								
-								newBinding->name = "";
-								if(pChild2Element->Attribute("name")) {
-									newBinding->name = pChild2Element->Attribute("name");
-								}
-								String mode = pChild2Element->Attribute("mode");
-								if(strcmp(mode.c_str(), "in") == 0) {
+								newBinding->id = reader->getAttribute("id").toString();
+								newBinding->name = reader->getAttribute("name").toString();
+								if(reader->getAttribute("mode") == "in") {
 									newBinding->mode = RenderTargetBinding::MODE_IN;
 								} else {
 									newBinding->mode = RenderTargetBinding::MODE_OUT;								
 								}
 																
 								newShaderBinding->addRenderTargetBinding(newBinding);
-								//Texture *texture =  (Texture*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_TEXTURE, newBinding->id);
-//								newBinding->texture = texture;
-								
-								for(int l=0; l < renderTargets.size(); l++) {
-									if(renderTargets[l]->id == newBinding->id) {
-										printf("Assigning texture to %s\n", newBinding->id.c_str());
-										newBinding->texture = renderTargets[l]->texture;
-										newBinding->width = renderTargets[l]->width;
-										newBinding->height = renderTargets[l]->height;
-									}
-								}
-								
-								if(newBinding->mode == RenderTargetBinding::MODE_IN) {
-									newShaderBinding->addTexture(newBinding->name, newBinding->texture);
-								}
+								targetBindings.push_back(newBinding);
+								targetBindingShaderBindings.push_back(newShaderBinding);
 							}						
 						}
 					}					
-					if(strcmp(pChild->Value(), "textures") == 0) {
-						for (pChild2 = pChild->FirstChild(); pChild2 != 0; pChild2 = pChild2->NextSibling()) {
-							TiXmlElement *pChild2Element = pChild2->ToElement();
-							if (!pChild2Element) continue; // Skip comment nodes
-
-							if(strcmp(pChild2->Value(), "texture") == 0){
-								String tname = "";
-								if(pChild2Element->Attribute("name")) {
-									tname =  pChild2Element->Attribute("name");
-								}
-								Texture *texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(pChild2Element->GetText());
+					if(reader->getName() == "textures") {
+						int texturesDepth = reader->getDepth();
+						while(reader->nextChild(texturesDepth)) {
+							if(reader->getName() == "texture") {
+								String tname = reader->getAttribute("name").toString();
+								Texture *texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(reader->readText().toString());
 								newShaderBinding->addTexture(tname,texture);
-//								newShaderBinding->addTexture(tname, (Texture*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_TEXTURE, pChild2Element->GetText()));
+							} else if(reader->getName() == "cubemap") {
+								String tname = reader->getAttribute("name").toString();
+								newShaderBinding->addCubemap(tname, (Cubemap*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_CUBEMAP, reader->readText().toString()));
 							}
-							
-							if(strcmp(pChild2->Value(), "cubemap") == 0){
-								String tname = "";
-								if(pChild2Element->Attribute("name")) {
-									tname =  pChild2Element->Attribute("name");
-								}
-								newShaderBinding->addCubemap(tname, (Cubemap*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_CUBEMAP, pChild2Element->GetText()));
-							}
-							
 						}
 					}
 				}
@@ -469,6 +465,22 @@ Material *MaterialManager::materialFromXMLNode(TiXmlNode *node) {
 		}
 	}
 	
+	// render targets can be declared after the shaders that use them, so target textures are bound once the whole material is read
+	for(int i=0; i < targetBindings.size(); i++) {
+		RenderTargetBinding *newBinding = targetBindings[i];
+		for(int l=0; l < renderTargets.size(); l++) {
+			if(renderTargets[l]->id == newBinding->id) {
+				printf("Assigning texture to %s\n", newBinding->id.c_str());
+				newBinding->texture = renderTargets[l]->texture;
+				newBinding->width = renderTargets[l]->width;
+				newBinding->height = renderTargets[l]->height;
+			}
+		}
+		
+		if(newBinding->mode == RenderTargetBinding::MODE_IN) {
+			targetBindingShaderBindings[i]->addTexture(newBinding->name, newBinding->texture);
+		}
+	}
 
 	for(int i=0; i< materialShaders.size(); i++) {
 		newMaterial->addShader(materialShaders[i],newShaderBindings[i]);
@@ -0,0 +1,333 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyMemory.h"
+#include <stdlib.h>
+
+#ifdef _WINDOWS
+	#include <windows.h>
+#endif
+
+using namespace Polycode;
+
+// blocks keep their header in front of them, padded so the block itself stays 16 byte aligned
+static const size_t HEADER_SIZE = 16;
+
+static bool poolingEnabled = true;
+static volatile long registryLock = 0;
+static volatile long unpooledStatsLock = 0;
+
+static void lockSpin(volatile long *lock) {
+#ifdef _WINDOWS
+	while(InterlockedExchange(lock, 1) != 0) {}
+#else
+	while(__sync_lock_test_and_set(lock, 1) != 0) {}
+#endif
+}
+
+static void unlockSpin(volatile long *lock) {
+#ifdef _WINDOWS
+	InterlockedExchange(lock, 0);
+#else
+	__sync_lock_release(lock);
+#endif
+}
+
+static std::vector<MemoryPool*> &getPoolRegistry() {
+	static std::vector<MemoryPool*> *registry = new std::vector<MemoryPool*>();
+	return *registry;
+}
+
+static void recordAllocation(MemoryStats *stats) {
+	stats->allocations++;
+	stats->liveAllocations++;
+	if(stats->liveAllocations > stats->peakLiveAllocations)
+		stats->peakLiveAllocations = stats->liveAllocations;
+}
+
+static void recordRelease(MemoryStats *stats) {
+	stats->releases++;
+	if(stats->liveAllocations > 0)
+		stats->liveAllocations--;
+}
+
+MemoryStats::MemoryStats() {
+	allocations = 0;
+	releases = 0;
+	liveAllocations = 0;
+	peakLiveAllocations = 0;
+	systemAllocations = 0;
+	bytesReserved = 0;
+}
+
+void MemoryStats::reset() {
+	allocations = 0;
+	releases = 0;
+	peakLiveAllocations = liveAllocations;
+	systemAllocations = 0;
+}
+
+MemoryPool::MemoryPool(const String& tag, size_t blockSize, unsigned int blocksPerChunk) {
+	this->blockSize = blockSize;
+	this->blocksPerChunk = blocksPerChunk > 0 ? blocksPerChunk : 1;
+	slotSize = HEADER_SIZE + ((blockSize + 15) & ~((size_t)15));
+	freeList = NULL;
+	spinLock = 0;
+	stats.tag = tag;
+
+	lockSpin(&registryLock);
+	getPoolRegistry().push_back(this);
+	unlockSpin(&registryLock);
+}
+
+MemoryPool::~MemoryPool() {
+	lockSpin(&registryLock);
+	std::vector<MemoryPool*> &registry = getPoolRegistry();
+	for(int i=0; i < registry.size(); i++) {
+		if(registry[i] == this) {
+			registry.erase(registry.begin()+i);
+			break;
+		}
+	}
+	unlockSpin(&registryLock);
+
+	for(int i=0; i < chunks.size(); i++) {
+		free(chunks[i]);
+	}
+}
+
+void MemoryPool::grow() {
+	char *chunk = (char*)malloc(slotSize * blocksPerChunk);
+	if(!chunk)
+		return;
+	chunks.push_back(chunk);
+	stats.systemAllocations++;
+	stats.bytesReserved += slotSize * blocksPerChunk;
+
+	for(unsigned int i=0; i < blocksPerChunk; i++) {
+		void *slot = chunk + (i * slotSize);
+		*(void**)slot = freeList;
+		freeList = slot;
+	}
+}
+
+void *MemoryPool::allocate() {
+	if(!poolingEnabled)
+		return allocateUnpooled(blockSize, &stats);
+
+	lockSpin(&spinLock);
+	if(!freeList)
+		grow();
+	void *slot = freeList;
+	if(!slot) {
+		unlockSpin(&spinLock);
+		return NULL;
+	}
+	freeList = *(void**)slot;
+	recordAllocation(&stats);
+	unlockSpin(&spinLock);
+
+	MemoryBlockHeader *header = (MemoryBlockHeader*)slot;
+	header->pool = this;
+	header->stats = &stats;
+	return (char*)slot + HEADER_SIZE;
+}
+
+void *MemoryPool::allocateUnpooled(size_t size, MemoryStats *stats) {
+	char *mem = (char*)malloc(HEADER_SIZE + size);
+	if(!mem)
+		return NULL;
+	MemoryBlockHeader *header = (MemoryBlockHeader*)mem;
+	header->pool = NULL;
+	header->stats = stats;
+	if(stats) {
+		lockSpin(&unpooledStatsLock);
+		recordAllocation(stats);
+		stats->systemAllocations++;
+		unlockSpin(&unpooledStatsLock);
+	}
+	return mem + HEADER_SIZE;
+}
+
+void MemoryPool::release(void *ptr) {
+	if(!ptr)
+		return;
+
+	MemoryBlockHeader *header = (MemoryBlockHeader*)((char*)ptr - HEADER_SIZE);
+	MemoryPool *pool = header->pool;
+	if(pool) {
+		lockSpin(&pool->spinLock);
+		recordRelease(&pool->stats);
+		*(void**)header = pool->freeList;
+		pool->freeList = header;
+		unlockSpin(&pool->spinLock);
+	} else {
+		if(header->stats) {
+			lockSpin(&unpooledStatsLock);
+			recordRelease(header->stats);
+			unlockSpin(&unpooledStatsLock);
+		}
+		free(header);
+	}
+}
+
+void MemoryPool::setPoolingEnabled(bool val) {
+	poolingEnabled = val;
+}
+
+bool MemoryPool::isPoolingEnabled() {
+	return poolingEnabled;
+}
+
+unsigned int MemoryPool::getNumPools() {
+	lockSpin(&registryLock);
+	unsigned int numPools = getPoolRegistry().size();
+	unlockSpin(&registryLock);
+	return numPools;
+}
+
+MemoryPool *MemoryPool::getPool(unsigned int index) {
+	MemoryPool *pool = NULL;
+	lockSpin(&registryLock);
+	if(index < getPoolRegistry().size())
+		pool = getPoolRegistry()[index];
+	unlockSpin(&registryLock);
+	return pool;
+}
+
+unsigned int MemoryPool::getTotalSystemAllocations() {
+	unsigned int total = 0;
+	lockSpin(&registryLock);
+	std::vector<MemoryPool*> &registry = getPoolRegistry();
+	for(int i=0; i < registry.size(); i++) {
+		total += registry[i]->stats.systemAllocations;
+	}
+	unlockSpin(&registryLock);
+	return total;
+}
+
+void MemoryPool::resetAllStats() {
+	lockSpin(&registryLock);
+	std::vector<MemoryPool*> &registry = getPoolRegistry();
+	for(int i=0; i < registry.size(); i++) {
+		lockSpin(&registry[i]->spinLock);
+		registry[i]->stats.reset();
+		unlockSpin(&registry[i]->spinLock);
+	}
+	unlockSpin(&registryLock);
+}
+
+PoolAllocator::PoolAllocator(const String& tag) {
+	this->tag = tag;
+	oversizedStats.tag = tag + "/oversized";
+	spinLock = 0;
+	for(int i=0; i < NUM_SIZE_CLASSES; i++) {
+		pools[i] = NULL;
+	}
+}
+
+PoolAllocator::~PoolAllocator() {
+	for(int i=0; i < NUM_SIZE_CLASSES; i++) {
+		delete pools[i];
+	}
+}
+
+void *PoolAllocator::allocate(size_t size) {
+	int sizeClass = size > 0 ? (int)((size - 1) / SIZE_CLASS_STEP) : 0;
+	if(sizeClass >= NUM_SIZE_CLASSES)
+		return MemoryPool::allocateUnpooled(size, &oversizedStats);
+
+	if(!pools[sizeClass]) {
+		lockSpin(&spinLock);
+		if(!pools[sizeClass]) {
+			int classSize = (sizeClass + 1) * SIZE_CLASS_STEP;
+			pools[sizeClass] = new MemoryPool(tag + "/" + String::IntToString(classSize), classSize);
+		}
+		unlockSpin(&spinLock);
+	}
+	return pools[sizeClass]->allocate();
+}
+
+FrameArena::FrameArena(size_t chunkSize) {
+	this->chunkSize = chunkSize;
+	currentChunk = 0;
+	chunkOffset = 0;
+	bytesUsed = 0;
+	peakBytesUsed = 0;
+	stats.tag = "FrameArena";
+}
+
+FrameArena::~FrameArena() {
+	reset();
+	for(int i=0; i < chunks.size(); i++) {
+		free(chunks[i]);
+	}
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+	recordAllocation(&stats);
+	bytesUsed += size;
+	if(bytesUsed > peakBytesUsed)
+		peakBytesUsed = bytesUsed;
+
+	if(size + alignment > chunkSize) {
+		char *mem = (char*)malloc(size + alignment);
+		oversizedAllocations.push_back(mem);
+		stats.systemAllocations++;
+		return (void*)(((size_t)mem + alignment - 1) & ~(alignment - 1));
+	}
+
+	while(true) {
+		if(currentChunk >= chunks.size()) {
+			chunks.push_back((char*)malloc(chunkSize));
+			stats.systemAllocations++;
+			stats.bytesReserved += chunkSize;
+			chunkOffset = 0;
+		}
+		char *base = chunks[currentChunk];
+		size_t offset = (((size_t)base + chunkOffset + alignment - 1) & ~(alignment - 1)) - (size_t)base;
+		if(offset + size <= chunkSize) {
+			chunkOffset = offset + size;
+			return base + offset;
+		}
+		currentChunk++;
+		chunkOffset = 0;
+	}
+}
+
+void FrameArena::reset() {
+	for(int i=0; i < oversizedAllocations.size(); i++) {
+		free(oversizedAllocations[i]);
+	}
+	oversizedAllocations.clear();
+
+	stats.releases += stats.liveAllocations;
+	stats.liveAllocations = 0;
+	currentChunk = 0;
+	chunkOffset = 0;
+	bytesUsed = 0;
+}
+
+FrameArena *FrameArena::getFrameArena() {
+	static FrameArena *frameArena = new FrameArena();
+	return frameArena;
+}
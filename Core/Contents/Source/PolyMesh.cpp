@@ -23,6 +23,9 @@
 #include "PolyMesh.h"
 #include "PolyLogger.h"
 #include "OSBasics.h"
+#include <map>
+#include <algorithm>
+#include <string.h>
 
 using std::min;
 using std::max;
@@ -66,6 +69,10 @@ namespace Polycode {
 			delete polygons[i];
 		}
 		polygons.clear();
+		for(int i=0; i < vertexBlocks.size(); i++) {
+			delete [] vertexBlocks[i];
+		}
+		vertexBlocks.clear();
 		if(vertexBuffer)
 			delete vertexBuffer;
 		vertexBuffer = NULL;
@@ -104,60 +111,414 @@ namespace Polycode {
 		return hRad;
 	}
 	
-	void Mesh::saveToFile(OSFILE *outFile) {				
-		unsigned int numFaces = polygons.size();
-
-		OSBasics::write(&meshType, sizeof(unsigned int), 1, outFile);		
-		OSBasics::write(&numFaces, sizeof(unsigned int), 1, outFile);
+	static const char MESH_FILE_MAGIC[4] = {'P','M','S','H'};
+	
+	typedef struct {
+		float position[3];
+		float normal[3];
+		float color[4];
+		float texCoord[2];
+		float tangent[3];
+		unsigned short boneIndices[Mesh::MESH_FILE_MAX_BONES];
+		float boneWeights[Mesh::MESH_FILE_MAX_BONES];
+	} MeshFileVertex;
+	
+	class MeshFileVertexCompare {
+		public:
+			bool operator() (const MeshFileVertex &v1, const MeshFileVertex &v2) const { return memcmp(&v1, &v2, sizeof(MeshFileVertex)) < 0; }
+	};
+	
+	class BoneAssignmentSorter {
+		public:
+			bool operator() (BoneAssignment *b1, BoneAssignment *b2) const { return b1->weight > b2->weight; }
+	};
+	
+	static unsigned int alignMeshStream(unsigned int offset) {
+		return (offset + 15) & ~15;
+	}
+	
+	static bool meshStreamInBounds(unsigned int offset, unsigned int count, unsigned int elementSize, unsigned int dataSize) {
+		if(offset > dataSize || elementSize == 0)
+			return false;
+		return count <= (dataSize - offset) / elementSize;
+	}
+	
+	void Mesh::saveToFile(OSFILE *outFile) {
+		writeMeshBlock(outFile, 0);
+	}
+	
+	void Mesh::saveToFile(OSFILE *outFile, const vector<MeshLOD> &lods) {
+		writeMeshBlock(outFile, lods.size());
+		for(int i=0; i < lods.size(); i++) {
+			MeshFileLODInfo info;
+			memset(&info, 0, sizeof(MeshFileLODInfo));
+			info.geometricError = lods[i].geometricError;
+			info.triangleCount = lods[i].mesh->getPolygonCount();
+			OSBasics::write(&info, sizeof(MeshFileLODInfo), 1, outFile);
+			lods[i].mesh->writeMeshBlock(outFile, 0);
+		}
+	}
+	
+	vector<MeshLOD> Mesh::loadLODs(const String& fileName) {
+		vector<MeshLOD> lods;
+		OSFILE *inFile = OSBasics::openMapped(fileName);
+		if(!inFile) {
+			Logger::log("Error opening mesh file %s", fileName.c_str());
+			return lods;
+		}
+		
+		MeshFileHeader header;
+		if(OSBasics::read(&header, sizeof(MeshFileHeader), 1, inFile) == 1 && memcmp(header.magic, MESH_FILE_MAGIC, 4) == 0 && header.version == MESH_FILE_VERSION) {
+			OSBasics::seek(inFile, header.dataSize, SEEK_CUR);
+			for(unsigned int i=0; i < header.lodCount; i++) {
+				MeshFileLODInfo info;
+				if(OSBasics::read(&info, sizeof(MeshFileLODInfo), 1, inFile) != 1)
+					break;
+				Mesh *mesh = new Mesh(TRI_MESH);
+				mesh->loadFromFile(inFile);
+				if(mesh->getPolygonCount() == 0) {
+					delete mesh;
+					break;
+				}
+				MeshLOD lod;
+				lod.mesh = mesh;
+				lod.geometricError = info.geometricError;
+				lods.push_back(lod);
+			}
+		}
+		OSBasics::close(inFile);
+		return lods;
+	}
+	
+	void Mesh::writeMeshBlock(OSFILE *outFile, unsigned int lodCount) {
+		vector<MeshFileVertex> vertices;
+		vector<unsigned int> indices;
+		std::map<MeshFileVertex, unsigned int, MeshFileVertexCompare> vertexMap;
+		
+		bool hasBones = false;
+		
 		for(int i=0; i < polygons.size(); i++) {
-			
-			Vector3_struct pos;
-			Vector3_struct nor;
-			Vector4_struct col;			
-			Vector2_struct tex;
-			
-			for(int j=0; j <  polygons[i]->getVertexCount(); j++) {
+			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+				Vertex *v = polygons[i]->getVertex(j);
 				
-				pos.x =  polygons[i]->getVertex(j)->x;
-				pos.y =  polygons[i]->getVertex(j)->y;
-				pos.z =  polygons[i]->getVertex(j)->z;
-
-				nor.x =  polygons[i]->getVertex(j)->normal.x;
-				nor.y =  polygons[i]->getVertex(j)->normal.y;
-				nor.z =  polygons[i]->getVertex(j)->normal.z;
-
-				col.x =  polygons[i]->getVertex(j)->vertexColor.r;
-				col.y =  polygons[i]->getVertex(j)->vertexColor.g;
-				col.z =  polygons[i]->getVertex(j)->vertexColor.b;
-				col.w =  polygons[i]->getVertex(j)->vertexColor.a;
+				MeshFileVertex fv;
+				memset(&fv, 0, sizeof(MeshFileVertex));
 				
-				tex.x = polygons[i]->getVertex(j)->getTexCoord().x;
-				tex.y = polygons[i]->getVertex(j)->getTexCoord().y;
+				fv.position[0] = v->x;
+				fv.position[1] = v->y;
+				fv.position[2] = v->z;
 				
-				OSBasics::write(&pos, sizeof(Vector3_struct), 1, outFile);
-				OSBasics::write(&nor, sizeof(Vector3_struct), 1, outFile);
-				OSBasics::write(&col, sizeof(Vector4_struct), 1, outFile);				
-				OSBasics::write(&tex, sizeof(Vector2_struct), 1, outFile);								
+				Vector3 normal = v->normal;
+				if(!polygons[i]->useVertexNormals) {
+					normal = polygons[i]->getFaceNormal();
+				}
+				fv.normal[0] = normal.x;
+				fv.normal[1] = normal.y;
+				fv.normal[2] = normal.z;
 				
-				unsigned int numBoneWeights = polygons[i]->getVertex(j)->getNumBoneAssignments();
-				OSBasics::write(&numBoneWeights, sizeof(unsigned int), 1, outFile);					
-				for(int b=0; b < numBoneWeights; b++) {
-					BoneAssignment *a = polygons[i]->getVertex(j)->getBoneAssignment(b);
-					unsigned int boneID = a->boneID;
-					float weight = a->weight;
-					OSBasics::write(&boneID, sizeof(unsigned int), 1, outFile);
-					OSBasics::write(&weight, sizeof(float), 1, outFile);												
+				fv.color[0] = v->vertexColor.r;
+				fv.color[1] = v->vertexColor.g;
+				fv.color[2] = v->vertexColor.b;
+				fv.color[3] = v->vertexColor.a;
+				
+				fv.texCoord[0] = v->getTexCoord().x;
+				fv.texCoord[1] = v->getTexCoord().y;
+				
+				fv.tangent[0] = v->tangent.x;
+				fv.tangent[1] = v->tangent.y;
+				fv.tangent[2] = v->tangent.z;
+				
+				vector<BoneAssignment*> assignments;
+				for(int b=0; b < v->getNumBoneAssignments(); b++) {
+					assignments.push_back(v->getBoneAssignment(b));
+				}
+				std::sort(assignments.begin(), assignments.end(), BoneAssignmentSorter());
+				
+				int numBones = assignments.size();
+				if(numBones > MESH_FILE_MAX_BONES)
+					numBones = MESH_FILE_MAX_BONES;
+				Number totalWeight = 0;
+				for(int b=0; b < numBones; b++) {
+					totalWeight += assignments[b]->weight;
+				}
+				for(int b=0; b < numBones; b++) {
+					fv.boneIndices[b] = assignments[b]->boneID;
+					if(totalWeight > 0)
+						fv.boneWeights[b] = assignments[b]->weight / totalWeight;
+					hasBones = true;
+				}
+				
+				std::map<MeshFileVertex, unsigned int, MeshFileVertexCompare>::iterator it = vertexMap.find(fv);
+				if(it != vertexMap.end()) {
+					indices.push_back(it->second);
+				} else {
+					unsigned int index = vertices.size();
+					vertexMap[fv] = index;
+					vertices.push_back(fv);
+					indices.push_back(index);
 				}
 			}
-			
 		}
+		
+		MeshFileHeader header;
+		memset(&header, 0, sizeof(MeshFileHeader));
+		memcpy(header.magic, MESH_FILE_MAGIC, 4);
+		header.version = MESH_FILE_VERSION;
+		header.meshType = meshType;
+		header.flags = MESH_FILE_HAS_NORMALS | MESH_FILE_HAS_COLORS | MESH_FILE_HAS_TEXCOORDS | MESH_FILE_HAS_TANGENTS;
+		if(hasBones)
+			header.flags |= MESH_FILE_HAS_BONES;
+		header.vertexCount = vertices.size();
+		header.indexCount = indices.size();
+		header.lodCount = lodCount;
+		
+		unsigned int offset = 0;
+		header.indexOffset = offset;
+		offset = alignMeshStream(offset + header.indexCount * sizeof(unsigned int));
+		header.positionOffset = offset;
+		offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * 3);
+		header.normalOffset = offset;
+		offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * 3);
+		header.colorOffset = offset;
+		offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * 4);
+		header.texCoordOffset = offset;
+		offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * 2);
+		header.tangentOffset = offset;
+		offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * 3);
+		if(hasBones) {
+			header.boneIndexOffset = offset;
+			offset = alignMeshStream(offset + header.vertexCount * sizeof(unsigned short) * MESH_FILE_MAX_BONES);
+			header.boneWeightOffset = offset;
+			offset = alignMeshStream(offset + header.vertexCount * sizeof(float) * MESH_FILE_MAX_BONES);
+		}
+		header.dataSize = offset;
+		
+		char *data = (char*)malloc(header.dataSize > 0 ? header.dataSize : 1);
+		memset(data, 0, header.dataSize);
+		
+		if(header.indexCount > 0)
+			memcpy(data + header.indexOffset, &indices[0], header.indexCount * sizeof(unsigned int));
+		
+		float *positions = (float*)(data + header.positionOffset);
+		float *normals = (float*)(data + header.normalOffset);
+		float *colors = (float*)(data + header.colorOffset);
+		float *texCoords = (float*)(data + header.texCoordOffset);
+		float *tangents = (float*)(data + header.tangentOffset);
+		
+		for(unsigned int i=0; i < header.vertexCount; i++) {
+			memcpy(positions + (i*3), vertices[i].position, sizeof(float) * 3);
+			memcpy(normals + (i*3), vertices[i].normal, sizeof(float) * 3);
+			memcpy(colors + (i*4), vertices[i].color, sizeof(float) * 4);
+			memcpy(texCoords + (i*2), vertices[i].texCoord, sizeof(float) * 2);
+			memcpy(tangents + (i*3), vertices[i].tangent, sizeof(float) * 3);
+			if(hasBones) {
+				memcpy(data + header.boneIndexOffset + (i * sizeof(unsigned short) * MESH_FILE_MAX_BONES), vertices[i].boneIndices, sizeof(unsigned short) * MESH_FILE_MAX_BONES);
+				memcpy(data + header.boneWeightOffset + (i * sizeof(float) * MESH_FILE_MAX_BONES), vertices[i].boneWeights, sizeof(float) * MESH_FILE_MAX_BONES);
+			}
+		}
+		
+		OSBasics::write(&header, sizeof(MeshFileHeader), 1, outFile);
+		OSBasics::write(data, 1, header.dataSize, outFile);
+		free(data);
 	}
-
 	
 	void Mesh::loadFromFile(OSFILE *inFile) {
-
-		unsigned int meshType;		
-		OSBasics::read(&meshType, sizeof(unsigned int), 1, inFile);				
+		char magic[4];
+		if(OSBasics::read(magic, 1, 4, inFile) != 4) {
+			Logger::log("Error reading mesh data\n");
+			return;
+		}
+		
+		if(memcmp(magic, MESH_FILE_MAGIC, 4) != 0) {
+			// files without the magic start with the mesh type of the legacy format
+			unsigned int legacyMeshType;
+			memcpy(&legacyMeshType, magic, sizeof(unsigned int));
+			loadFromLegacyFile(inFile, legacyMeshType);
+			return;
+		}
+		
+		MeshFileHeader header;
+		memcpy(header.magic, magic, 4);
+		if(OSBasics::read(((char*)&header) + 4, sizeof(MeshFileHeader) - 4, 1, inFile) != 1) {
+			Logger::log("Error reading mesh header\n");
+			return;
+		}
+		
+		if(header.version != MESH_FILE_VERSION) {
+			Logger::log("Unsupported mesh file version %d\n", header.version);
+			OSBasics::seek(inFile, header.dataSize, SEEK_CUR);
+			return;
+		}
+		
+		// mapped files are parsed straight out of the mapping
+		const char *data = OSBasics::readInPlace(inFile, header.dataSize);
+		if(!data) {
+			Logger::log("Error reading mesh data\n");
+			return;
+		}
+		loadFromBuffer(header, data);
+	}
+	
+	bool Mesh::loadFromBuffer(const MeshFileHeader &header, const char *data) {
+		if(memcmp(header.magic, MESH_FILE_MAGIC, 4) != 0 || header.version != MESH_FILE_VERSION) {
+			Logger::log("Invalid mesh header\n");
+			return false;
+		}
+		
+		int verticesPerFace;
+		switch(header.meshType) {
+			case TRI_MESH:
+				verticesPerFace = 3;
+			break;
+			case QUAD_MESH:
+				verticesPerFace = 4;
+			break;
+			default:
+				verticesPerFace = 1;
+			break;
+		}
+		
+		unsigned int vertexCount = header.vertexCount;
+		bool valid = meshStreamInBounds(header.indexOffset, header.indexCount, sizeof(unsigned int), header.dataSize) &&
+			meshStreamInBounds(header.positionOffset, vertexCount, sizeof(float) * 3, header.dataSize) &&
+			(header.indexCount % verticesPerFace) == 0;
+		if(header.flags & MESH_FILE_HAS_NORMALS)
+			valid = valid && meshStreamInBounds(header.normalOffset, vertexCount, sizeof(float) * 3, header.dataSize);
+		if(header.flags & MESH_FILE_HAS_COLORS)
+			valid = valid && meshStreamInBounds(header.colorOffset, vertexCount, sizeof(float) * 4, header.dataSize);
+		if(header.flags & MESH_FILE_HAS_TEXCOORDS)
+			valid = valid && meshStreamInBounds(header.texCoordOffset, vertexCount, sizeof(float) * 2, header.dataSize);
+		if(header.flags & MESH_FILE_HAS_TANGENTS)
+			valid = valid && meshStreamInBounds(header.tangentOffset, vertexCount, sizeof(float) * 3, header.dataSize);
+		if(header.flags & MESH_FILE_HAS_BONES) {
+			valid = valid && meshStreamInBounds(header.boneIndexOffset, vertexCount, sizeof(unsigned short) * MESH_FILE_MAX_BONES, header.dataSize) &&
+				meshStreamInBounds(header.boneWeightOffset, vertexCount, sizeof(float) * MESH_FILE_MAX_BONES, header.dataSize);
+		}
+		
+		const unsigned int *indices = (const unsigned int*)(data + header.indexOffset);
+		for(unsigned int i=0; valid && i < header.indexCount; i++) {
+			if(indices[i] >= vertexCount)
+				valid = false;
+		}
+		
+		if(!valid) {
+			Logger::log("Corrupt mesh data\n");
+			return false;
+		}
+		
+		setMeshType(header.meshType);
+		
+		const float *positions = (const float*)(data + header.positionOffset);
+		const float *normals = (header.flags & MESH_FILE_HAS_NORMALS) ? (const float*)(data + header.normalOffset) : NULL;
+		const float *colors = (header.flags & MESH_FILE_HAS_COLORS) ? (const float*)(data + header.colorOffset) : NULL;
+		const float *texCoords = (header.flags & MESH_FILE_HAS_TEXCOORDS) ? (const float*)(data + header.texCoordOffset) : NULL;
+		const float *tangents = (header.flags & MESH_FILE_HAS_TANGENTS) ? (const float*)(data + header.tangentOffset) : NULL;
+		const unsigned short *boneIndices = (header.flags & MESH_FILE_HAS_BONES) ? (const unsigned short*)(data + header.boneIndexOffset) : NULL;
+		const float *boneWeights = (header.flags & MESH_FILE_HAS_BONES) ? (const float*)(data + header.boneWeightOffset) : NULL;
+		
+		// every vertex in the file becomes one Vertex, shared by all the polygons that index it
+		Vertex *vertices = new Vertex[vertexCount];
+		vertexBlocks.push_back(vertices);
+		for(unsigned int i=0; i < vertexCount; i++) {
+			Vertex *vertex = &vertices[i];
+			const float *p = positions + (i*3);
+			vertex->set(p[0], p[1], p[2]);
+			vertex->restPosition.set(p[0], p[1], p[2]);
+			if(normals) {
+				const float *n = normals + (i*3);
+				vertex->setNormal(n[0], n[1], n[2]);
+				vertex->restNormal.set(n[0], n[1], n[2]);
+			}
+			if(colors) {
+				const float *c = colors + (i*4);
+				vertex->vertexColor.setColor(c[0], c[1], c[2], c[3]);
+			}
+			if(texCoords) {
+				vertex->setTexCoord(texCoords[i*2], texCoords[(i*2)+1]);
+			}
+			if(tangents) {
+				const float *t = tangents + (i*3);
+				vertex->tangent.set(t[0], t[1], t[2]);
+			}
+			if(boneIndices) {
+				for(int b=0; b < MESH_FILE_MAX_BONES; b++) {
+					Number weight = boneWeights[(i*MESH_FILE_MAX_BONES)+b];
+					if(weight > 0)
+						vertex->addBoneAssignment(boneIndices[(i*MESH_FILE_MAX_BONES)+b], weight);
+				}
+			}
+		}
+		
+		bool appending = polygons.size() > 0;
+		polygons.reserve(polygons.size() + (header.indexCount / verticesPerFace));
+		for(unsigned int i=0; i < header.indexCount; i += verticesPerFace) {
+			Polygon *poly = new Polygon();
+			poly->ownsVertices = false;
+			for(int j=0; j < verticesPerFace; j++) {
+				poly->addVertex(&vertices[indices[i+j]]);
+			}
+			polygons.push_back(poly);
+		}
+		
+		if(appending) {
+			// the streams only cover the new polygons, so the renderer rebuilds the arrays from all of them
+			arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;
+			arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+			arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;
+			arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
+			arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;
+			if(!tangents)
+				calculateTangents();
+			return true;
+		}
+		
+		// Fill the render arrays straight from the streams so the renderer does not have to rebuild them from the polygons.
+		setRenderDataArrayFromStream(RenderDataArray::VERTEX_DATA_ARRAY, 3, positions, indices, header.indexCount);
+		if(normals)
+			setRenderDataArrayFromStream(RenderDataArray::NORMAL_DATA_ARRAY, 3, normals, indices, header.indexCount);
+		else
+			arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+		if(colors)
+			setRenderDataArrayFromStream(RenderDataArray::COLOR_DATA_ARRAY, 4, colors, indices, header.indexCount);
+		else
+			arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;
+		if(texCoords)
+			setRenderDataArrayFromStream(RenderDataArray::TEXCOORD_DATA_ARRAY, 2, texCoords, indices, header.indexCount);
+		else
+			arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
+		if(tangents) {
+			setRenderDataArrayFromStream(RenderDataArray::TANGENT_DATA_ARRAY, 3, tangents, indices, header.indexCount);
+		} else {
+			calculateTangents();
+		}
+		
+		return true;
+	}
+	
+	void Mesh::setRenderDataArrayFromStream(int arrayType, int size, const float *stream, const unsigned int *indices, unsigned int indexCount) {
+		if(renderDataArrays[arrayType]) {
+			free(renderDataArrays[arrayType]->arrayPtr);
+			delete renderDataArrays[arrayType];
+		}
+		
+		RenderDataArray *newArray = new RenderDataArray();
+		newArray->arrayType = arrayType;
+		newArray->stride = 0;
+		newArray->size = size;
+		newArray->count = indexCount;
+		newArray->rendererData = NULL;
+		
+		float *buffer = (float*)malloc(indexCount * size * sizeof(float) + 1);
+		for(unsigned int i=0; i < indexCount; i++) {
+			memcpy(buffer + (i*size), stream + (indices[i]*size), size * sizeof(float));
+		}
+		newArray->arrayPtr = buffer;
+		
+		renderDataArrays[arrayType] = newArray;
+		arrayDirtyMap[arrayType] = false;
+	}
+	
+	void Mesh::loadFromLegacyFile(OSFILE *inFile, unsigned int meshType) {
 		setMeshType(meshType);
 		
 		int verticesPerFace;
@@ -173,37 +534,50 @@ namespace Polycode {
 			break;
 		}
 		
-		unsigned int numFaces;		
-		OSBasics::read(&numFaces, sizeof(unsigned int), 1, inFile);
+		const char *faceCount = OSBasics::readInPlace(inFile, sizeof(unsigned int));
+		if(!faceCount)
+			return;
+		unsigned int numFaces = *(const unsigned int*)faceCount;
 		
-		Vector3_struct pos;
-		Vector3_struct nor;
-		Vector4_struct col;			
-		Vector2_struct tex;
+		// position, normal, color, texture coordinate and bone weight count of one vertex
+		const size_t vertexRecordSize = (sizeof(Vector3_struct) * 2) + sizeof(Vector4_struct) + sizeof(Vector2_struct) + sizeof(unsigned int);
 		
 		for(int i=0; i < numFaces; i++) {	
 			Polygon *poly = new Polygon();			
 			
 			for(int j=0; j < verticesPerFace; j++) {
-				OSBasics::read(&pos, sizeof(Vector3_struct), 1, inFile);
-				OSBasics::read(&nor, sizeof(Vector3_struct), 1, inFile);
-				OSBasics::read(&col, sizeof(Vector4_struct), 1, inFile);						
-				OSBasics::read(&tex, sizeof(Vector2_struct), 1, inFile);						
+				const char *record = OSBasics::readInPlace(inFile, vertexRecordSize);
+				if(!record) {
+					delete poly;
+					Logger::log("Error reading mesh data\n");
+					return;
+				}
+				const Vector3_struct *pos = (const Vector3_struct*)record;
+				const Vector3_struct *nor = pos + 1;
+				const Vector4_struct *col = (const Vector4_struct*)(nor + 1);
+				const Vector2_struct *tex = (const Vector2_struct*)(col + 1);
+				unsigned int numBoneWeights = *(const unsigned int*)(tex + 1);
 				
-				Vertex *vertex = new Vertex(pos.x, pos.y, pos.z);
-				vertex->setNormal(nor.x,nor.y, nor.z);
-				vertex->restNormal.set(nor.x,nor.y, nor.z);
-				vertex->vertexColor.setColor(col.x,col.y, col.z, col.w);
-				vertex->setTexCoord(tex.x, tex.y);
+				Vertex *vertex = new Vertex(pos->x, pos->y, pos->z);
+				vertex->setNormal(nor->x,nor->y, nor->z);
+				vertex->restNormal.set(nor->x,nor->y, nor->z);
+				vertex->vertexColor.setColor(col->x,col->y, col->z, col->w);
+				vertex->setTexCoord(tex->x, tex->y);
 				
-				unsigned int numBoneWeights;
-				OSBasics::read(&numBoneWeights, sizeof(unsigned int), 1, inFile);								
+				// each weight is a bone id followed by the weight, and the count is checked against what is left of the file
+				const size_t weightSize = sizeof(unsigned int) + sizeof(float);
+				const char *weights = NULL;
+				if(numBoneWeights <= ((size_t)-1) / weightSize)
+					weights = OSBasics::readInPlace(inFile, numBoneWeights * weightSize);
+				if(!weights) {
+					delete vertex;
+					delete poly;
+					Logger::log("Corrupt mesh data\n");
+					return;
+				}
 				for(int b=0; b < numBoneWeights; b++) {
-					float weight;
-					unsigned int boneID;
-					OSBasics::read(&boneID, sizeof(unsigned int), 1, inFile);													
-					OSBasics::read(&weight, sizeof(float), 1, inFile);																		
-					vertex->addBoneAssignment(boneID, weight);
+					const char *weight = weights + (b * weightSize);
+					vertex->addBoneAssignment(*(const unsigned int*)weight, *(const float*)(weight + sizeof(unsigned int)));
 				}
 				
 				Number totalWeight = 0;				
@@ -236,6 +610,7 @@ namespace Polycode {
 		OSFILE *outFile = OSBasics::open(fileName, "wb");
 		if(!outFile) {
 			Logger::log("Error opening mesh file for saving: %s", fileName.c_str());
+			return;
 		}
 		saveToFile(outFile);
 		OSBasics::close(outFile);	
@@ -243,17 +618,13 @@ namespace Polycode {
 	}
 	
 	void Mesh::loadMesh(const String& fileName) {
-		OSFILE *inFile = OSBasics::open(fileName, "rb");
+		OSFILE *inFile = OSBasics::openMapped(fileName);
 		if(!inFile) {
 			Logger::log("Error opening mesh file %s", fileName.c_str());
+			return;
 		}
 		loadFromFile(inFile);
 		OSBasics::close(inFile);	
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
-		arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;		
 	}
 	
 	void Mesh::createVPlane(Number w, Number h) { 
@@ -724,22 +1095,52 @@ namespace Polycode {
 	
 	vector<Polygon*> Mesh::getConnectedFaces(Vertex *v) {
 		vector<Polygon*> retVec;	
+		getConnectedFaces(v, retVec);
+		return retVec;
+	}
+	
+	void Mesh::getConnectedFaces(Vertex *v, vector<Polygon*> &connectedFaces) {
+		connectedFaces.clear();
 		for(int i=0; i < polygons.size(); i++) {
-			bool pushed = false;		
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {		
 				Vertex *vn =  polygons[i]->getVertex(j);			
 				if(*vn == *v) {
-					if(!pushed) {
-						retVec.push_back(polygons[i]);
-						pushed = true;
-					}
+					connectedFaces.push_back(polygons[i]);
+					break;
 				}
 			}
 		}
-		return retVec;
+	}
+	
+	void Mesh::splitSharedVertices() {
+		if(vertexBlocks.size() == 0)
+			return;
+		
+		for(int i=0; i < polygons.size(); i++) {
+			Polygon *poly = polygons[i];
+			if(poly->ownsVertices)
+				continue;
+			std::vector<Vertex*> copies;
+			for(int j=0; j < poly->getVertexCount(); j++) {
+				copies.push_back(new Vertex(*poly->getVertex(j)));
+			}
+			while(poly->getVertexCount() > 0)
+				poly->removeVertex(0);
+			for(int j=0; j < copies.size(); j++) {
+				poly->addVertex(copies[j]);
+			}
+			poly->ownsVertices = true;
+		}
+		
+		for(int i=0; i < vertexBlocks.size(); i++) {
+			delete [] vertexBlocks[i];
+		}
+		vertexBlocks.clear();
 	}
 	
 	void Mesh::calculateTangents() {
+		// tangents are written per face, so every face needs its own corners
+		splitSharedVertices();
 		for(int i =0; i < polygons.size(); i++) {
 			polygons[i]->calculateTangent();
 		}		
@@ -766,17 +1167,20 @@ namespace Polycode {
 	}
 	
 	void Mesh::calculateNormals(bool smooth, Number smoothAngle) {
+		if(!smooth)
+			splitSharedVertices();
 		for(int i =0; i < polygons.size(); i++) {
 			polygons[i]->calculateNormal();
 		}	
 		
 		if(smooth) {
+			vector<Polygon*> connectedFaces;
 			for(int i=0; i < polygons.size(); i++) {
 				for(int j=0; j < polygons[i]->getVertexCount(); j++) {		
 					Vertex *v =  polygons[i]->getVertex(j);
 
 					Vector3 normal;		
-					vector<Polygon*> connectedFaces = getConnectedFaces(v);
+					getConnectedFaces(v, connectedFaces);
 					for(int k=0; k < connectedFaces.size(); k++) {					
 						normal += connectedFaces[k]->getFaceNormal();
 					}					
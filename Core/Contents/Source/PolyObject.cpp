@@ -26,14 +26,76 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 using namespace Polycode;
 
+static const char OBJECT_FILE_MAGIC[4] = {'P','O','B','J'};
+
+static unsigned int hashKey(const char *key, size_t keyLength) {
+	unsigned int hash = 2166136261u;
+	for(size_t i=0; i < keyLength; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool compareKeys(const ObjectEntryKey &a, const ObjectEntryKey &b) {
+	if(a.hash != b.hash)
+		return a.hash < b.hash;
+	return a.position < b.position;
+}
+
 void ObjectEntry::Clear() {
 	for(int i=0; i < children.size(); i++) {
 		children[i]->Clear();
 		delete children[i];
 	}
 	children.clear();
+	keyIndex.clear();
+}
+
+void ObjectEntry::invalidateKeyIndex() {
+	keyIndex.clear();
+}
+
+void ObjectEntry::buildKeyIndex() {
+	keyIndex.resize(children.size());
+	for(int i=0; i < children.size(); i++) {
+		keyIndex[i].hash = hashKey(children[i]->name.contents.data(), children[i]->name.contents.size());
+		keyIndex[i].position = i;
+	}
+	std::sort(keyIndex.begin(), keyIndex.end(), compareKeys);
+}
+
+ObjectEntry *ObjectEntry::getChild(const char *key, size_t keyLength) {
+	if(children.size() < KEY_INDEX_THRESHOLD) {
+		for(int i=0; i < children.size(); i++) {
+			const std::string &childName = children[i]->name.contents;
+			if(childName.size() == keyLength && memcmp(childName.data(), key, keyLength) == 0) {
+				return children[i];
+			}
+		}
+		return NULL;
+	}
+	
+	if(keyIndex.size() != children.size()) {
+		buildKeyIndex();
+	}
+	
+	// equal hashes are sorted by position, so the first name that matches is the first child with that name
+	ObjectEntryKey searchKey;
+	searchKey.hash = hashKey(key, keyLength);
+	searchKey.position = 0;
+	std::vector<ObjectEntryKey>::iterator it = std::lower_bound(keyIndex.begin(), keyIndex.end(), searchKey, compareKeys);
+	for(; it != keyIndex.end() && it->hash == searchKey.hash; it++) {
+		const std::string &childName = children[it->position]->name.contents;
+		if(childName.size() == keyLength && memcmp(childName.data(), key, keyLength) == 0) {
+			return children[it->position];
+		}
+	}
+	return NULL;
 }
 
 String ObjectEntry::getTypedName() const {
@@ -303,16 +365,134 @@ bool Object::loadFromBinary(const String& fileName) {
 	return success;
 }
 
+bool Object::loadFromFile(const String& fileName) {
+	OSFileMapping *mapping = OSBasics::mapFile(fileName);
+	if(!mapping) {
+		Logger::log("Error loading object file %s\n", fileName.c_str());
+		return false;
+	}
+	
+	if(mapping->size >= 4 && (memcmp(mapping->data, OBJECT_FILE_MAGIC, 4) == 0 || memcmp(mapping->data, "PBOF", 4) == 0)) {
+		OSBasics::unmapFile(mapping);
+		return loadFromBinary(fileName);
+	}
+	
+	String xmlString;
+	xmlString.contents.assign(mapping->data, mapping->size);
+	OSBasics::unmapFile(mapping);
+	return loadFromXMLString(xmlString);
+}
+
 BinaryObjectReader::BinaryObjectReader(const String& fileName, Object *object) {
 	this->object = object;
 	success = false;
-	inFile = OSBasics::open(fileName, "rb");
+	inFile = OSBasics::openMapped(fileName);
 	if(inFile) {
-		success = readFile();
+		char magic[4];
+		if(OSBasics::read(magic, 1, 4, inFile) == 4 && memcmp(magic, OBJECT_FILE_MAGIC, 4) == 0) {
+			OSFileMapping *mapping = OSBasics::getMapping(inFile);
+			if(mapping) {
+				success = readBuffer(mapping->data, mapping->size);
+			} else {
+				OSBasics::seek(inFile, 0, SEEK_END);
+				std::vector<char> buffer(OSBasics::tell(inFile));
+				OSBasics::seek(inFile, 0, SEEK_SET);
+				if(buffer.size() > 0 && OSBasics::read(&buffer[0], 1, buffer.size(), inFile) == buffer.size()) {
+					success = readBuffer(&buffer[0], buffer.size());
+				}
+			}
+		} else {
+			OSBasics::seek(inFile, 0, SEEK_SET);
+			success = readFile();
+		}
 		OSBasics::close(inFile);
 	}
 }
 
+bool BinaryObjectReader::readBuffer(const char *data, size_t size) {
+	ObjectFileHeader header;
+	if(size < sizeof(ObjectFileHeader)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(ObjectFileHeader));
+	if(header.version != OBJECT_FILE_VERSION || header.entryCount == 0 || header.stringCount == 0) {
+		return false;
+	}
+	if(header.entryCount > size / sizeof(ObjectFileEntry) || header.stringCount > size / sizeof(ObjectFileString)) {
+		return false;
+	}
+	
+	size_t entriesOffset = sizeof(ObjectFileHeader);
+	size_t stringsOffset = entriesOffset + (header.entryCount * sizeof(ObjectFileEntry));
+	size_t stringDataOffset = stringsOffset + (header.stringCount * sizeof(ObjectFileString));
+	if(stringDataOffset > size || header.stringDataSize > size - stringDataOffset) {
+		return false;
+	}
+	
+	std::vector<String> strings(header.stringCount);
+	for(unsigned int i=0; i < header.stringCount; i++) {
+		ObjectFileString fileString;
+		memcpy(&fileString, data + stringsOffset + (i * sizeof(ObjectFileString)), sizeof(ObjectFileString));
+		if(fileString.offset > header.stringDataSize || fileString.length > header.stringDataSize - fileString.offset) {
+			return false;
+		}
+		strings[i].contents.assign(data + stringDataOffset + fileString.offset, fileString.length);
+	}
+	
+	// children always come after their parent, so every entry has been created by the time it is filled in
+	std::vector<ObjectEntry*> entries(header.entryCount, (ObjectEntry*)NULL);
+	entries[0] = &object->root;
+	for(unsigned int i=0; i < header.entryCount; i++) {
+		ObjectFileEntry fileEntry;
+		memcpy(&fileEntry, data + entriesOffset + (i * sizeof(ObjectFileEntry)), sizeof(ObjectFileEntry));
+		
+		ObjectEntry *entry = entries[i];
+		if(!entry || fileEntry.nameIndex >= header.stringCount) {
+			return false;
+		}
+		entry->name = strings[fileEntry.nameIndex];
+		entry->type = fileEntry.type;
+		
+		switch(entry->type) {
+			case ObjectEntry::STRING_ENTRY:
+				if(fileEntry.stringIndex >= header.stringCount) {
+					return false;
+				}
+				entry->stringVal = strings[fileEntry.stringIndex];
+			break;
+			case ObjectEntry::FLOAT_ENTRY:
+				entry->NumberVal = fileEntry.numberValue;
+				entry->intVal = fileEntry.numberValue;
+			break;
+			case ObjectEntry::INT_ENTRY:
+				entry->intVal = fileEntry.intValue;
+				entry->NumberVal = fileEntry.intValue;
+			break;
+			case ObjectEntry::BOOL_ENTRY:
+				entry->boolVal = fileEntry.intValue != 0;
+				entry->intVal = fileEntry.intValue;
+				entry->NumberVal = fileEntry.intValue;
+			break;
+		}
+		
+		if(fileEntry.childCount > 0) {
+			if(fileEntry.firstChild <= i || fileEntry.firstChild > header.entryCount || fileEntry.childCount > header.entryCount - fileEntry.firstChild) {
+				return false;
+			}
+			entry->children.reserve(fileEntry.childCount);
+			for(unsigned int c=fileEntry.firstChild; c < fileEntry.firstChild + fileEntry.childCount; c++) {
+				if(entries[c]) {
+					return false;
+				}
+				entries[c] = new ObjectEntry();
+				entry->children.push_back(entries[c]);
+			}
+		}
+		entry->length = fileEntry.childCount;
+	}
+	return true;
+}
+
 String BinaryObjectReader::getKeyByIndex(unsigned int index) {
 	if(index < keys.size()) {
 		return keys[index];
@@ -434,117 +614,85 @@ void Object::saveToBinary(const String& fileName) {
 
 BinaryObjectWriter::BinaryObjectWriter(Object *object) {
 	this->object = object;
-	parseKeysFromObjectEntry(&object->root);
-}
-
-unsigned int BinaryObjectWriter::addKey(const String &key) {
-	for(int i=0; i < keys.size(); i++) {
-		if(keys[i] == key)
-			return i;
-	}
-	keys.push_back(key);
-	return keys.size()-1;
-}
-
-unsigned int BinaryObjectWriter::getKeyIndex(const String &key) {
-	for(int i=0; i < keys.size(); i++) {
-		if(keys[i] == key)
-			return i;
-	}
-	return 0;
-}
-			
-void BinaryObjectWriter::parseKeysFromObjectEntry(ObjectEntry *entry) {
-	addKey(entry->name);
-	for(int i=0; i < entry->children.size(); i++) {
-		parseKeysFromObjectEntry(entry->children[i]);		
-	}
+	addString("");
 }
 
 BinaryObjectWriter::~BinaryObjectWriter() {
 
 }
 
-void BinaryObjectWriter::writeEntryToFile(ObjectEntry *entry) {
-
-	uint16_t keyIndex = getKeyIndex(entry->name);
-	OSBasics::write(&keyIndex, sizeof(uint16_t), 1, outFile);
-
-	uint8_t type = (uint8_t)entry->type;
-	OSBasics::write(&type, sizeof(uint8_t), 1, outFile);
-	
-	uint32_t data32;
-	
-	switch(entry->type) {
-		case ObjectEntry::STRING_ENTRY:
-			data32 = entry->stringVal.length();
-			OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);
-			OSBasics::write(entry->stringVal.c_str(), 1, data32, outFile);
-		break;
-		case ObjectEntry::FLOAT_ENTRY:
-		{
-			float val = (float)entry->NumberVal;
-			OSBasics::write(&val, sizeof(uint32_t), 1, outFile);		
-		}
-		break;
-		case ObjectEntry::INT_ENTRY:
-		{
-			int32_t intval = (int32_t)entry->intVal;
-			OSBasics::write(&intval, sizeof(int32_t), 1, outFile);		
-		}
-		break;
-		case ObjectEntry::BOOL_ENTRY:
-			if(entry->boolVal) {
-				data32 = 1;
-			} else {
-				data32 = 0;			
-			}
-			OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);		
-		break;
-		default:
-			data32 = 0;
-			OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);			
-		break;
+unsigned int BinaryObjectWriter::addString(const String &str) {
+	std::map<std::string, unsigned int>::iterator it = stringIndices.find(str.contents);
+	if(it != stringIndices.end()) {
+		return it->second;
 	}
 	
-	data32 = entry->children.size();
-	OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);
+	ObjectFileString fileString;
+	fileString.offset = stringData.size();
+	fileString.length = str.contents.size();
+	stringData += str.contents;
 	
-	for(int i=0; i < entry->children.size(); i++) {
-		writeEntryToFile(entry->children[i]);
-	}	
-	
-	numEntriesWritten++;
+	unsigned int index = strings.size();
+	strings.push_back(fileString);
+	stringIndices[str.contents] = index;
+	return index;
 }
-			
-bool BinaryObjectWriter::writeToFile(const String& fileName) {
-	outFile = OSBasics::open(fileName, "wb");
-	
-	OSBasics::write("PBOF", 1, 4, outFile);
-
-	uint32_t data32 = keys.size();
-	OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);
 
-	for(int i=0; i < keys.size(); i++) {
-		uint16_t data16 = keys[i].length();
-		OSBasics::write(&data16, sizeof(uint16_t), 1, outFile);
-		OSBasics::write(keys[i].c_str(), 1, data16, outFile);
+bool BinaryObjectWriter::writeToFile(const String& fileName) {
+	// breadth first, so the children of every entry end up next to each other
+	std::vector<ObjectEntry*> order;
+	std::vector<ObjectFileEntry> entries;
+	order.push_back(&object->root);
+	for(size_t i=0; i < order.size(); i++) {
+		ObjectEntry *entry = order[i];
+		
+		ObjectFileEntry fileEntry;
+		memset(&fileEntry, 0, sizeof(ObjectFileEntry));
+		fileEntry.nameIndex = addString(entry->name);
+		fileEntry.type = entry->type;
+		fileEntry.childCount = entry->children.size();
+		if(fileEntry.childCount > 0) {
+			fileEntry.firstChild = order.size();
+			order.insert(order.end(), entry->children.begin(), entry->children.end());
+		}
+		
+		switch(entry->type) {
+			case ObjectEntry::STRING_ENTRY:
+				fileEntry.stringIndex = addString(entry->stringVal);
+			break;
+			case ObjectEntry::FLOAT_ENTRY:
+				fileEntry.numberValue = entry->NumberVal;
+			break;
+			case ObjectEntry::INT_ENTRY:
+				fileEntry.intValue = entry->intVal;
+			break;
+			case ObjectEntry::BOOL_ENTRY:
+				fileEntry.intValue = entry->boolVal ? 1 : 0;
+			break;
+		}
+		entries.push_back(fileEntry);
 	}
 	
-	size_t offset = OSBasics::tell(outFile);
-
-	numEntriesWritten = 0;
-	
-	data32 = 0;
-	OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);
-	
-	writeEntryToFile(&object->root);
-	
-	OSBasics::seek(outFile,  offset, SEEK_SET);
-	data32 = numEntriesWritten;
-	OSBasics::write(&data32, sizeof(uint32_t), 1, outFile);	
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	if(!outFile) {
+		Logger::log("Error writing object file %s\n", fileName.c_str());
+		return false;
+	}
 	
+	ObjectFileHeader header;
+	memcpy(header.magic, OBJECT_FILE_MAGIC, 4);
+	header.version = BinaryObjectReader::OBJECT_FILE_VERSION;
+	header.entryCount = entries.size();
+	header.stringCount = strings.size();
+	header.stringDataSize = stringData.size();
+	header.reserved = 0;
+	
+	OSBasics::write(&header, sizeof(ObjectFileHeader), 1, outFile);
+	OSBasics::write(&entries[0], sizeof(ObjectFileEntry), entries.size(), outFile);
+	OSBasics::write(&strings[0], sizeof(ObjectFileString), strings.size(), outFile);
+	if(stringData.size() > 0) {
+		OSBasics::write(stringData.data(), 1, stringData.size(), outFile);
+	}
 	OSBasics::close(outFile);
+	return true;
 }
-
-
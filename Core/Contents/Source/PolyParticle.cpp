@@ -25,11 +25,32 @@
 #include "PolyPolygon.h"
 #include "PolySceneMesh.h"
 #include "PolyScreenShape.h"
+#include "PolyMemory.h"
 
 using namespace Polycode;
 
 Mesh *Particle::billboardMesh = 0;
 
+static MemoryPool *getParticlePool() {
+	static MemoryPool *particlePool = new MemoryPool("Particle", sizeof(Particle), 256);
+	return particlePool;
+}
+
+void *Particle::operator new(size_t size) {
+	void *ptr;
+	if(size > getParticlePool()->getBlockSize())
+		ptr = MemoryPool::allocateUnpooled(size, getParticlePool()->getStatsPointer());
+	else
+		ptr = getParticlePool()->allocate();
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void Particle::operator delete(void *ptr) {
+	MemoryPool::release(ptr);
+}
+
 Particle::Particle(int particleType, bool isScreenParticle, Material *material, Texture *texture, Mesh *particleMesh) {
 	life = 0;
 	if(isScreenParticle) {
@@ -24,6 +24,7 @@
 #include "PolyCoreServices.h"
 #include "PolyParticle.h"
 #include "PolyPerlin.h"
+#include "PolyProfiler.h"
 #include "PolyResource.h"
 #include "PolyScene.h"
 #include "PolyScreen.h"
@@ -421,6 +422,7 @@ Particle *ParticleEmitter::getParticleAtIndex(unsigned int index) const {
 
 
 void ParticleEmitter::updateEmitter() {	
+	POLY_PROFILE_ZONE("ParticleEmitter::updateEmitter");
 	
 	Vector3 translationVector;
 	Number elapsed = timer->getElapsedf();
@@ -24,13 +24,19 @@ THE SOFTWARE.
 #include <string.h>
 #include "PolyCore.h"
 #include "PolyTimer.h"
+#include "PolyMemory.h"
 
 using namespace Polycode;
 
+static MemoryPool *getPacketPool() {
+	static MemoryPool *packetPool = new MemoryPool("Packet", sizeof(Packet), 16);
+	return packetPool;
+}
+
 void PeerConnection::ackPackets(unsigned int ack) {
 	for(int i=0; i < reliablePacketQueue.size(); i++) {
 		if(reliablePacketQueue[i].packet->header.sequence == ack) {
-			delete reliablePacketQueue[i].packet;
+			Peer::releasePacket(reliablePacketQueue[i].packet);
 			reliablePacketQueue.erase(reliablePacketQueue.begin()+i);
 		}
 	}
@@ -87,7 +93,7 @@ Packet *Peer::createPacket(const Address &target, char *data, unsigned int size,
 	PeerConnection *connection = getPeerConnection(target);
 	if(!connection)
 		connection = addPeerConnection(target);
-	Packet *packet = new Packet();
+	Packet *packet = (Packet*)getPacketPool()->allocate();
 	packet->header.sequence = connection->localSequence;
 	packet->header.headerHash = 20;
 	packet->header.reliableID = 0;	
@@ -132,7 +138,11 @@ void Peer::sendReliableDataToAll(char *data, unsigned int size, unsigned short t
 void Peer::sendData(const Address &target, char *data, unsigned int size, unsigned short type) {
 	Packet *packet = createPacket(target, data, size, type);
 	sendPacket(target, packet);
-	delete packet;
+	releasePacket(packet);
+}
+
+void Peer::releasePacket(Packet *packet) {
+	MemoryPool::release(packet);
 }
 
 void Peer::sendPacket(const Address &target, Packet *packet) {
@@ -31,12 +31,15 @@ namespace Polycode {
 
 Polygon::Polygon()  : useVertexNormals(false), vertexCount(0) {
 	useVertexNormals = true;	
+	ownsVertices = true;
 }
 
 Polygon::~Polygon() {
 	
-	for(int i=0; i < vertices.size(); i++) {	
-		delete vertices[i];
+	if(ownsVertices) {
+		for(int i=0; i < vertices.size(); i++) {	
+			delete vertices[i];
+		}
 	}
 	vertices.clear();
 }
@@ -91,7 +94,8 @@ Rectangle Polygon::getBounds2D() {
 void Polygon::removeVertex(int index) {
 	Vertex *vert = vertices[index];
 	vertices.erase(vertices.begin() + index);
-	delete vert;
+	if(ownsVertices)
+		delete vert;
 }
 
 void Polygon::setNormal(Vector3 normal) {
@@ -0,0 +1,357 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyProfiler.h"
+#include "PolyLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WINDOWS
+	#include <windows.h>
+	#define POLY_THREAD_LOCAL __declspec(thread)
+#else
+	#include <sys/time.h>
+	#define POLY_THREAD_LOCAL __thread
+#endif
+
+using namespace Polycode;
+
+static POLY_THREAD_LOCAL ProfilerThreadBuffer *localThreadBuffer = NULL;
+static POLY_THREAD_LOCAL bool localThreadRegistered = false;
+
+static const unsigned int INVALID_EVENT_INDEX = 0xffffffff;
+
+bool Profiler::enabled = false;
+bool Profiler::frameActive = false;
+unsigned int Profiler::frame = 0;
+unsigned long long Profiler::frameStartTime = 0;
+unsigned int Profiler::frameStartIndex = 0;
+ProfilerThreadBuffer *Profiler::mainThreadBuffer = NULL;
+unsigned int Profiler::counters[Profiler::NUM_COUNTERS];
+ProfilerFrameStats Profiler::lastFrameStats;
+unsigned long long Profiler::counterHistoryTimes[Profiler::FRAME_HISTORY_SIZE];
+unsigned int Profiler::counterHistory[Profiler::FRAME_HISTORY_SIZE][Profiler::NUM_COUNTERS];
+unsigned int Profiler::counterHistoryCount = 0;
+ProfilerThreadBuffer *Profiler::threadBuffers[Profiler::MAX_THREADS];
+volatile long Profiler::numThreadBuffers = 0;
+
+ProfilerThreadBuffer::ProfilerThreadBuffer(unsigned int threadIndex) {
+	this->threadIndex = threadIndex;
+	writeIndex = 0;
+	depth = 0;
+}
+
+ProfilerThreadBuffer::~ProfilerThreadBuffer() {
+}
+
+ProfilerFrameStats::ProfilerFrameStats() {
+	frame = 0;
+	frameTime = 0;
+	memset(counters, 0, sizeof(counters));
+}
+
+unsigned long long Profiler::getTime() {
+#ifdef _WINDOWS
+	static LARGE_INTEGER frequency;
+	static LARGE_INTEGER start;
+	if(frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&start);
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return ((now.QuadPart - start.QuadPart) * 1000000) / frequency.QuadPart;
+#else
+	static unsigned long long start = 0;
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	unsigned long long now = ((unsigned long long)tv.tv_sec * 1000000) + tv.tv_usec;
+	if(start == 0)
+		start = now;
+	return now - start;
+#endif
+}
+
+void Profiler::setEnabled(bool val) {
+	enabled = val;
+	if(!enabled)
+		frameActive = false;
+}
+
+ProfilerThreadBuffer *Profiler::getThreadBuffer() {
+	if(localThreadBuffer || localThreadRegistered)
+		return localThreadBuffer;
+
+	// claim a slot without locking, threads past MAX_THREADS are not profiled
+	localThreadRegistered = true;
+#ifdef _WINDOWS
+	long slot = InterlockedIncrement(&numThreadBuffers) - 1;
+#else
+	long slot = __sync_add_and_fetch(&numThreadBuffers, 1) - 1;
+#endif
+	if(slot >= MAX_THREADS) {
+		Logger::log("Profiler: too many threads, not profiling thread %d\n", (int)slot);
+		return NULL;
+	}
+	localThreadBuffer = new ProfilerThreadBuffer(slot);
+	threadBuffers[slot] = localThreadBuffer;
+	return localThreadBuffer;
+}
+
+unsigned int Profiler::beginZone(const char *name) {
+	ProfilerThreadBuffer *buffer = getThreadBuffer();
+	if(!buffer)
+		return INVALID_EVENT_INDEX;
+
+	unsigned int index = buffer->writeIndex;
+	ProfilerEvent *event = &buffer->events[index % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+	event->name = name;
+	event->startTime = getTime();
+	event->endTime = 0;
+	event->depth = buffer->depth++;
+	event->frame = frame;
+	buffer->writeIndex = index + 1;
+	return index;
+}
+
+void Profiler::endZone(unsigned int eventIndex) {
+	ProfilerThreadBuffer *buffer = localThreadBuffer;
+	if(!buffer || eventIndex == INVALID_EVENT_INDEX)
+		return;
+
+	buffer->depth--;
+	// the slot may already have been reused if the zone outlived a full ring
+	if(buffer->writeIndex - eventIndex <= ProfilerThreadBuffer::EVENTS_PER_THREAD) {
+		buffer->events[eventIndex % ProfilerThreadBuffer::EVENTS_PER_THREAD].endTime = getTime();
+	}
+}
+
+unsigned int Profiler::addZone(const char *name, unsigned long long startTime, unsigned long long endTime) {
+	ProfilerThreadBuffer *buffer = getThreadBuffer();
+	if(!buffer)
+		return INVALID_EVENT_INDEX;
+
+	unsigned int index = buffer->writeIndex;
+	ProfilerEvent *event = &buffer->events[index % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+	event->name = name;
+	event->startTime = startTime;
+	event->endTime = endTime;
+	event->depth = buffer->depth;
+	event->frame = frame;
+	buffer->writeIndex = index + 1;
+	return index;
+}
+
+void Profiler::extendZone(unsigned int eventIndex, unsigned long long endTime) {
+	ProfilerThreadBuffer *buffer = localThreadBuffer;
+	if(!buffer || eventIndex == INVALID_EVENT_INDEX)
+		return;
+
+	if(buffer->writeIndex - eventIndex <= ProfilerThreadBuffer::EVENTS_PER_THREAD) {
+		buffer->events[eventIndex % ProfilerThreadBuffer::EVENTS_PER_THREAD].endTime = endTime;
+	}
+}
+
+void Profiler::beginFrame() {
+	if(!enabled)
+		return;
+
+	mainThreadBuffer = getThreadBuffer();
+	frame++;
+	frameStartTime = getTime();
+	frameStartIndex = mainThreadBuffer ? mainThreadBuffer->writeIndex : 0;
+	memset(counters, 0, sizeof(counters));
+	frameActive = true;
+}
+
+void Profiler::endFrame() {
+	if(!enabled || !frameActive)
+		return;
+	frameActive = false;
+
+	unsigned long long now = getTime();
+	aggregateFrame(now);
+
+	unsigned int historyIndex = counterHistoryCount % FRAME_HISTORY_SIZE;
+	counterHistoryTimes[historyIndex] = now;
+	memcpy(counterHistory[historyIndex], counters, sizeof(counters));
+	counterHistoryCount++;
+}
+
+void Profiler::aggregateFrame(unsigned long long frameEndTime) {
+	lastFrameStats.frame = frame;
+	lastFrameStats.frameTime = (frameEndTime - frameStartTime) / 1000.0;
+	lastFrameStats.zones.clear();
+	memcpy(lastFrameStats.counters, counters, sizeof(counters));
+
+	if(!mainThreadBuffer)
+		return;
+
+	unsigned int endIndex = mainThreadBuffer->writeIndex;
+	unsigned int startIndex = frameStartIndex;
+	if(endIndex - startIndex > ProfilerThreadBuffer::EVENTS_PER_THREAD) {
+		Logger::log("Profiler: frame %d recorded more zones than fit in the ring buffer, dropping the oldest\n", frame);
+		startIndex = endIndex - ProfilerThreadBuffer::EVENTS_PER_THREAD;
+	}
+
+	// events are stored in the order they were entered, so a stack of the
+	// enclosing ones, kept by depth, is enough to find each event's parent
+	unsigned int count = endIndex - startIndex;
+	std::vector<unsigned long long> childTimes(count, 0);
+	std::vector<unsigned int> openEvents;
+
+	for(unsigned int i=startIndex; i != endIndex; i++) {
+		ProfilerEvent *event = &mainThreadBuffer->events[i % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+		if(event->endTime == 0)
+			continue;
+
+		while(openEvents.size() > 0) {
+			ProfilerEvent *parent = &mainThreadBuffer->events[openEvents[openEvents.size()-1] % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+			if(parent->depth < event->depth)
+				break;
+			openEvents.pop_back();
+		}
+		if(openEvents.size() > 0) {
+			childTimes[openEvents[openEvents.size()-1] - startIndex] += event->endTime - event->startTime;
+		}
+		openEvents.push_back(i);
+	}
+
+	for(unsigned int i=startIndex; i != endIndex; i++) {
+		ProfilerEvent *event = &mainThreadBuffer->events[i % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+		if(event->endTime == 0)
+			continue;
+
+		ProfilerZoneStats *stats = NULL;
+		for(int j=0; j < lastFrameStats.zones.size(); j++) {
+			if(lastFrameStats.zones[j].name == event->name || strcmp(lastFrameStats.zones[j].name, event->name) == 0) {
+				stats = &lastFrameStats.zones[j];
+				break;
+			}
+		}
+		if(!stats) {
+			ProfilerZoneStats newStats;
+			newStats.name = event->name;
+			newStats.callCount = 0;
+			newStats.totalTime = 0;
+			newStats.selfTime = 0;
+			lastFrameStats.zones.push_back(newStats);
+			stats = &lastFrameStats.zones[lastFrameStats.zones.size()-1];
+		}
+
+		unsigned long long duration = event->endTime - event->startTime;
+		stats->callCount++;
+		stats->totalTime += duration / 1000.0;
+		stats->selfTime += (duration - childTimes[i - startIndex]) / 1000.0;
+	}
+}
+
+static void writeTraceString(FILE *file, const char *str) {
+	fputc('"', file);
+	for(const char *c = str; *c; c++) {
+		if(*c == '"' || *c == '\\')
+			fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+bool Profiler::exportChromeTrace(const String& fileName) {
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file) {
+		Logger::log("Profiler: unable to open %s for writing\n", fileName.c_str());
+		return false;
+	}
+
+	static const char *counterNames[NUM_COUNTERS] = {"entities", "drawCalls", "vertices", "events", "allocations"};
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+
+	int numThreads = numThreadBuffers < MAX_THREADS ? (int)numThreadBuffers : MAX_THREADS;
+	for(int t=0; t < numThreads; t++) {
+		ProfilerThreadBuffer *buffer = threadBuffers[t];
+		if(!buffer)
+			continue;
+
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}", first ? "" : ",\n", buffer->threadIndex, buffer == mainThreadBuffer ? "Main" : "Thread", buffer->threadIndex);
+		first = false;
+
+		unsigned int endIndex = buffer->writeIndex;
+		unsigned int startIndex = endIndex > ProfilerThreadBuffer::EVENTS_PER_THREAD ? endIndex - ProfilerThreadBuffer::EVENTS_PER_THREAD : 0;
+		for(unsigned int i=startIndex; i != endIndex; i++) {
+			ProfilerEvent *event = &buffer->events[i % ProfilerThreadBuffer::EVENTS_PER_THREAD];
+			if(event->endTime == 0)
+				continue;
+			fprintf(file, ",\n{\"name\":");
+			writeTraceString(file, event->name);
+			fprintf(file, ",\"cat\":\"polycode\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%d}}", event->startTime, event->endTime - event->startTime, buffer->threadIndex, event->frame);
+		}
+	}
+
+	unsigned int historyStart = counterHistoryCount > FRAME_HISTORY_SIZE ? counterHistoryCount - FRAME_HISTORY_SIZE : 0;
+	for(unsigned int i=historyStart; i < counterHistoryCount; i++) {
+		unsigned int historyIndex = i % FRAME_HISTORY_SIZE;
+		fprintf(file, "%s{\"name\":\"frame counters\",\"ph\":\"C\",\"ts\":%llu,\"pid\":1,\"args\":{", first ? "" : ",\n", counterHistoryTimes[historyIndex]);
+		first = false;
+		for(int c=0; c < NUM_COUNTERS; c++) {
+			fprintf(file, "%s\"%s\":%u", c == 0 ? "" : ",", counterNames[c], counterHistory[historyIndex][c]);
+		}
+		fprintf(file, "}}");
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+#ifdef POLYCODE_PROFILE_ALLOCATIONS
+
+#include <new>
+
+// Counting every allocation needs a global operator new, so it is opt in.
+void *operator new(size_t size) {
+	Profiler::addCount(Profiler::COUNTER_ALLOCATIONS, 1);
+	void *ptr = malloc(size ? size : 1);
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	Profiler::addCount(Profiler::COUNTER_ALLOCATIONS, 1);
+	void *ptr = malloc(size ? size : 1);
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) throw() {
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw() {
+	free(ptr);
+}
+
+#endif
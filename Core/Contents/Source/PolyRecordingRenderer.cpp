@@ -0,0 +1,540 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyRecordingRenderer.h"
+#include "PolyCubemap.h"
+#include "PolyFixedShader.h"
+#include "PolyMaterial.h"
+#include "PolyModule.h"
+#include "PolyPolygon.h"
+#include "PolyProfiler.h"
+#include <stdlib.h>
+
+using namespace Polycode;
+
+RenderCommand::RenderCommand() : type(0), param(0), value(0), target(NULL) {
+}
+
+RecordingTexture::RecordingTexture(RecordingRenderer *renderer, unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) : Texture(width, height, textureData, clamp, createMipmaps, type) {
+	this->renderer = renderer;
+	recreateFromImageData();
+}
+
+RecordingTexture::~RecordingTexture() {
+}
+
+void RecordingTexture::setTextureData(char *data) {
+	memcpy(textureData, data, width*height*pixelSize);
+	renderer->recordTextureUpload(this, width*height*pixelSize);
+}
+
+void RecordingTexture::recreateFromImageData() {
+	renderer->recordTextureUpload(this, width*height*pixelSize);
+}
+
+RecordingVertexBuffer::RecordingVertexBuffer(Mesh *mesh) : VertexBuffer() {
+	meshType = mesh->getMeshType();
+	switch(meshType) {
+		case Mesh::QUAD_MESH:
+			verticesPerFace = 4;
+		break;
+		case Mesh::TRI_MESH:
+			verticesPerFace = 3;
+		break;
+		default:
+			verticesPerFace = 1;
+		break;
+	}
+
+	vertexCount = 0;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		vertexCount += mesh->getPolygon(i)->getVertexCount();
+	}
+}
+
+RecordingVertexBuffer::~RecordingVertexBuffer() {
+}
+
+RecordingRenderer::RecordingRenderer() : Renderer() {
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
+	verticesToDraw = 0;
+	verticesDrawn = 0;
+	trianglesDrawn = 0;
+	textureUploadCount = 0;
+	recording = true;
+	invalidateStateCache();
+}
+
+RecordingRenderer::~RecordingRenderer() {
+}
+
+void RecordingRenderer::setRecording(bool val) {
+	recording = val;
+}
+
+void RecordingRenderer::clearCommands() {
+	commands.clear();
+}
+
+int RecordingRenderer::getNumCommandsOfType(int type) const {
+	int count = 0;
+	for(int i=0; i < commands.size(); i++) {
+		if(commands[i].type == type)
+			count++;
+	}
+	return count;
+}
+
+void RecordingRenderer::resetRenderStats() {
+	Renderer::resetRenderStats();
+	verticesDrawn = 0;
+	trianglesDrawn = 0;
+	textureUploadCount = 0;
+}
+
+void RecordingRenderer::recordCommand(int type, int param, int value, const void *target) {
+	if(!recording)
+		return;
+	RenderCommand command;
+	command.type = type;
+	command.param = param;
+	command.value = value;
+	command.target = target;
+	commands.push_back(command);
+}
+
+void RecordingRenderer::setState(int state, int value) {
+	if(cachedStates[state] == value)
+		return;
+	cachedStates[state] = value;
+	stateChangeCount++;
+	recordCommand(RenderCommand::COMMAND_SET_STATE, state, value, NULL);
+}
+
+void RecordingRenderer::recordDraw(int commandType, int drawType, int vertexCount, const void *target) {
+	drawCallCount++;
+	verticesDrawn += vertexCount;
+	switch(drawType) {
+		case Mesh::TRI_MESH:
+			trianglesDrawn += vertexCount / 3;
+		break;
+		case Mesh::QUAD_MESH:
+			trianglesDrawn += (vertexCount / 4) * 2;
+		break;
+		case Mesh::TRIFAN_MESH:
+		case Mesh::TRISTRIP_MESH:
+			if(vertexCount > 2)
+				trianglesDrawn += vertexCount - 2;
+		break;
+	}
+	POLY_PROFILE_COUNT(Profiler::COUNTER_VERTICES, vertexCount);
+	recordCommand(commandType, drawType, vertexCount, target);
+}
+
+void RecordingRenderer::recordTextureUpload(Texture *texture, int numBytes) {
+	textureUploadCount++;
+	recordCommand(RenderCommand::COMMAND_UPLOAD_TEXTURE, 0, numBytes, texture);
+}
+
+void RecordingRenderer::recordSpriteBatch(unsigned int numMeshes) {
+	Renderer::recordSpriteBatch(numMeshes);
+	recordCommand(RenderCommand::COMMAND_SPRITE_BATCH, 0, numMeshes, NULL);
+}
+
+void RecordingRenderer::invalidateStateCache() {
+	for(int i=0; i < NUM_STATES; i++) {
+		cachedStates[i] = -1;
+	}
+	currentTexture = NULL;
+}
+
+void RecordingRenderer::Resize(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	viewportWidth = xRes;
+	viewportHeight = yRes;
+	resetViewport();
+	invalidateStateCache();
+}
+
+void RecordingRenderer::BeginRender() {
+	if(doClearBuffer) {
+		clearBuffer(true, true);
+	}
+	loadIdentity();
+	modelviewStack.clear();
+	resetRenderStats();
+	clearCommands();
+	invalidateStateCache();
+}
+
+void RecordingRenderer::EndRender() {
+}
+
+Cubemap *RecordingRenderer::createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) {
+	return new Cubemap(t0,t1,t2,t3,t4,t5);
+}
+
+Texture *RecordingRenderer::createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) {
+	return new RecordingTexture(this, width, height, textureData, clamp, createMipmaps, type);
+}
+
+void RecordingRenderer::destroyTexture(Texture *texture) {
+	if(currentTexture == texture)
+		currentTexture = NULL;
+	delete texture;
+}
+
+void RecordingRenderer::createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer) {
+	int type = floatingPointBuffer ? Image::IMAGE_FP16 : Image::IMAGE_RGBA;
+	if(colorBuffer) {
+		*colorBuffer = new RecordingTexture(this, width, height, NULL, true, false, type);
+	}
+	if(depthBuffer) {
+		*depthBuffer = new RecordingTexture(this, width, height, NULL, true, false, type);
+	}
+}
+
+Texture *RecordingRenderer::createFramebufferTexture(unsigned int width, unsigned int height) {
+	return new RecordingTexture(this, width, height, NULL, true, false);
+}
+
+void RecordingRenderer::bindFrameBufferTexture(Texture *texture) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	currentFrameBufferTexture = texture;
+}
+
+void RecordingRenderer::unbindFramebuffers() {
+	currentFrameBufferTexture = NULL;
+	if(previousFrameBufferTexture) {
+		bindFrameBufferTexture(previousFrameBufferTexture);
+		previousFrameBufferTexture = NULL;
+	}
+}
+
+Image *RecordingRenderer::renderScreenToImage() {
+	return new Image(xRes, yRes, Image::IMAGE_RGBA);
+}
+
+void RecordingRenderer::resetViewport() {
+	setProjectionMatrix(createPerspectiveMatrix(fov, viewportWidth/viewportHeight, nearPlane, farPlane));
+	sceneProjectionMatrix = projectionMatrix;
+}
+
+void RecordingRenderer::_setOrthoMode(Number orthoSizeX, Number orthoSizeY) {
+	this->orthoSizeX = orthoSizeX;
+	this->orthoSizeY = orthoSizeY;
+
+	if(!orthoMode) {
+		pushProjectionMatrix();
+		setProjectionMatrix(createOrthoMatrix(-orthoSizeX*0.5, orthoSizeX*0.5, -orthoSizeY*0.5, orthoSizeY*0.5, -farPlane, farPlane));
+		orthoMode = true;
+	}
+	loadIdentity();
+}
+
+void RecordingRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
+	if(xSize == 0)
+		xSize = xRes;
+
+	if(ySize == 0)
+		ySize = yRes;
+
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(!orthoMode) {
+		enableBackfaceCulling(false);
+		pushProjectionMatrix();
+		if(centered) {
+			setProjectionMatrix(createOrthoMatrix(-xSize*0.5, xSize*0.5, ySize*0.5, -ySize*0.5, -1.0, 1.0));
+		} else {
+			setProjectionMatrix(createOrthoMatrix(0.0, xSize, ySize, 0.0, -1.0, 1.0));
+		}
+		orthoMode = true;
+	}
+	loadIdentity();
+}
+
+void RecordingRenderer::setPerspectiveMode() {
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(orthoMode) {
+		enableDepthTest(true);
+		enableBackfaceCulling(true);
+		popProjectionMatrix();
+		orthoMode = false;
+	}
+	loadIdentity();
+	sceneProjectionMatrix = projectionMatrix;
+	currentTexture = NULL;
+}
+
+void RecordingRenderer::setTexture(Texture *texture) {
+	if(texture == NULL || renderMode != RENDER_MODE_NORMAL) {
+		setState(STATE_TEXTURING, 0);
+		return;
+	}
+
+	setState(STATE_TEXTURING, 1);
+	if(currentTexture != texture) {
+		currentTexture = texture;
+		stateChangeCount++;
+		recordCommand(RenderCommand::COMMAND_BIND_TEXTURE, 0, 0, texture);
+	}
+}
+
+void RecordingRenderer::enableBackfaceCulling(bool val) {
+	setState(STATE_BACKFACE_CULLING, val);
+}
+
+void RecordingRenderer::setClearColor(Number r, Number g, Number b) {
+	clearColor.setColor(r,g,b,1.0f);
+}
+
+void RecordingRenderer::clearScreen() {
+	clearBuffer(true, true);
+}
+
+void RecordingRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
+	// the packed 8 bit color is what gets compared and recorded
+	Color color(r,g,b,a);
+	setState(STATE_VERTEX_COLOR, (int)color.getUint());
+}
+
+void RecordingRenderer::pushRenderDataArray(RenderDataArray *array) {
+	if(array->arrayType == RenderDataArray::VERTEX_DATA_ARRAY) {
+		verticesToDraw = array->count;
+	}
+}
+
+RenderDataArray *RecordingRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+
+	int vertexCount = 0;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		vertexCount += mesh->getPolygon(i)->getVertexCount();
+	}
+
+	float *buffer = (float*)malloc(sizeof(float) * newArray->size * (vertexCount > 0 ? vertexCount : 1));
+	float *ptr = buffer;
+
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			switch(arrayType) {
+				case RenderDataArray::VERTEX_DATA_ARRAY:
+					*ptr++ = vertex->x;
+					*ptr++ = vertex->y;
+					*ptr++ = vertex->z;
+				break;
+				case RenderDataArray::COLOR_DATA_ARRAY:
+					*ptr++ = vertex->vertexColor.r;
+					*ptr++ = vertex->vertexColor.g;
+					*ptr++ = vertex->vertexColor.b;
+					*ptr++ = vertex->vertexColor.a;
+				break;
+				case RenderDataArray::NORMAL_DATA_ARRAY:
+				{
+					Vector3 normal = polygon->useVertexNormals ? vertex->normal : polygon->getFaceNormal();
+					*ptr++ = normal.x;
+					*ptr++ = normal.y;
+					*ptr++ = normal.z;
+				}
+				break;
+				case RenderDataArray::TANGENT_DATA_ARRAY:
+					*ptr++ = vertex->tangent.x;
+					*ptr++ = vertex->tangent.y;
+					*ptr++ = vertex->tangent.z;
+				break;
+				case RenderDataArray::TEXCOORD_DATA_ARRAY:
+					*ptr++ = vertex->getTexCoord().x;
+					*ptr++ = vertex->getTexCoord().y;
+				break;
+			}
+		}
+	}
+
+	free(newArray->arrayPtr);
+	newArray->arrayPtr = buffer;
+	newArray->count = vertexCount;
+	return newArray;
+}
+
+RenderDataArray *RecordingRenderer::createRenderDataArray(int arrayType) {
+	RenderDataArray *newArray = new RenderDataArray();
+	newArray->arrayType = arrayType;
+	newArray->arrayPtr = malloc(1);
+	newArray->stride = 0;
+	newArray->count = 0;
+
+	switch (arrayType) {
+		case RenderDataArray::COLOR_DATA_ARRAY:
+			newArray->size = 4;
+		break;
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			newArray->size = 2;
+		break;
+		default:
+			newArray->size = 3;
+		break;
+	}
+	return newArray;
+}
+
+void RecordingRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayData) {
+}
+
+void RecordingRenderer::drawArrays(int drawType) {
+	recordDraw(RenderCommand::COMMAND_DRAW_ARRAYS, drawType, verticesToDraw, NULL);
+	verticesToDraw = 0;
+}
+
+void RecordingRenderer::setLineSmooth(bool val) {
+	setState(STATE_LINE_SMOOTH, val);
+}
+
+void RecordingRenderer::setLineSize(Number lineSize) {
+}
+
+void RecordingRenderer::enableLighting(bool enable) {
+	lightingEnabled = enable;
+}
+
+void RecordingRenderer::enableFog(bool enable) {
+	setState(STATE_FOG, enable);
+}
+
+void RecordingRenderer::setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth) {
+}
+
+void RecordingRenderer::setBlendingMode(int blendingMode) {
+	setState(STATE_BLENDING_MODE, blendingMode);
+}
+
+void RecordingRenderer::applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) {
+	if(!material->getShader(shaderIndex) || !shadersEnabled) {
+		setTexture(NULL);
+		return;
+	}
+
+	switch(material->getShader(shaderIndex)->getType()) {
+		case Shader::FIXED_SHADER:
+			setTexture(((FixedShaderBinding*)material->getShaderBinding(shaderIndex))->getDiffuseTexture());
+		break;
+		case Shader::MODULE_SHADER:
+			if(currentMaterial != material) {
+				stateChangeCount++;
+				recordCommand(RenderCommand::COMMAND_APPLY_MATERIAL, shaderIndex, 0, material);
+			}
+			currentMaterial = material;
+		break;
+	}
+
+	setBlendingMode(material->blendingMode);
+}
+
+void RecordingRenderer::clearShader() {
+	setState(STATE_FOG, 0);
+	setState(STATE_TEXTURING, 0);
+	currentMaterial = NULL;
+	currentTexture = NULL;
+}
+
+void RecordingRenderer::setDepthFunction(int depthFunction) {
+	setState(STATE_DEPTH_FUNCTION, depthFunction);
+}
+
+void RecordingRenderer::createVertexBufferForMesh(Mesh *mesh) {
+	if(mesh->hasVertexBuffer())
+		delete mesh->getVertexBuffer();
+	mesh->setVertexBuffer(new RecordingVertexBuffer(mesh));
+}
+
+void RecordingRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer) {
+	recordDraw(RenderCommand::COMMAND_DRAW_VERTEX_BUFFER, buffer->meshType, buffer->getVertexCount(), buffer);
+}
+
+void RecordingRenderer::enableDepthTest(bool val) {
+	setState(STATE_DEPTH_TEST, val);
+}
+
+void RecordingRenderer::enableDepthWrite(bool val) {
+	setState(STATE_DEPTH_WRITE, val);
+}
+
+void RecordingRenderer::setClippingPlanes(Number nearPlane_, Number farPlane_) {
+	nearPlane = nearPlane_;
+	farPlane = farPlane_;
+	Resize(xRes, yRes);
+}
+
+void RecordingRenderer::enableAlphaTest(bool val) {
+	setState(STATE_ALPHA_TEST, val);
+}
+
+void RecordingRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
+	int mask = (colorBuffer ? 1 : 0) | (depthBuffer ? 2 : 0);
+	recordCommand(RenderCommand::COMMAND_CLEAR, mask, 0, NULL);
+}
+
+void RecordingRenderer::drawToColorBuffer(bool val) {
+	setState(STATE_COLOR_BUFFER, val);
+}
+
+void RecordingRenderer::drawScreenQuad(Number qx, Number qy) {
+	setOrthoMode();
+	setState(STATE_VERTEX_COLOR, -1);
+	recordDraw(RenderCommand::COMMAND_DRAW_ARRAYS, Mesh::QUAD_MESH, 4, NULL);
+	setPerspectiveMode();
+}
+
+void RecordingRenderer::cullFrontFaces(bool val) {
+	cullingFrontFaces = val;
+	setState(STATE_CULL_FRONT_FACES, val);
+}
+
+void RecordingRenderer::setDitherFade(Number amount, bool inverted) {
+	int coverage = (int)(amount * 16.0 + 0.5);
+	if(coverage < 0)
+		coverage = 0;
+	if(coverage >= 16)
+		setState(STATE_DITHER_FADE, 16);
+	else
+		setState(STATE_DITHER_FADE, coverage + (inverted ? 32 : 0));
+}
+
+Vector3 RecordingRenderer::projectRayFrom2DCoordinate(Number x, Number y) {
+	Matrix4 camInverse = cameraMatrix.inverse();
+	Vector3 nearVec = unprojectPoint(x, y, 0.0, camInverse, sceneProjectionMatrix);
+	Vector3 farVec = unprojectPoint(x, y, 1.0, camInverse, sceneProjectionMatrix);
+
+	Vector3 dirVec = farVec - nearVec;
+	dirVec.Normalize();
+	return dirVec;
+}
+
+Vector3 RecordingRenderer::Unproject(Number x, Number y) {
+	// there is no depth buffer to read back, so unproject onto the near plane
+	return unprojectPoint(x, y, 0.0, modelviewMatrix, projectionMatrix);
+}
@@ -22,12 +22,17 @@
 
 #include "PolyRenderer.h"
 #include "PolyMesh.h"
+#include "PolyQuaternion.h"
+#include <math.h>
+#include <string.h>
 
 using namespace Polycode;
 
 Renderer::Renderer() : currentTexture(NULL), xRes(0), yRes(0), renderMode(0), orthoMode(false), lightingEnabled(false), clearColor(0.2f, 0.2f, 0.2f, 0.0) {
 	anisotropy = 0;
 	textureFilteringMode = TEX_FILTERING_LINEAR;
+	lodProjectionScale = 0;
+	lodOrthographic = false;
 	currentMaterial = NULL;
 	numLights = 0;
 	exposureLevel = 1;
@@ -48,6 +53,18 @@ Renderer::Renderer() : currentTexture(NULL), xRes(0), yRes(0), renderMode(0), or
 	cullingFrontFaces = false;
 	scissorEnabled = false;
 	
+	drawCallCount = 0;
+	stateChangeCount = 0;
+	spriteBatchCount = 0;
+	batchedMeshCount = 0;
+	
+	modelviewMatrix.identity();
+	projectionMatrix.identity();
+	sceneProjectionMatrix.identity();
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+	projectionMatrixDirty = true;
+	projectionUploadMatrixValid = false;
 	
 	doClearBuffer = true;
 }
@@ -55,6 +72,184 @@ Renderer::Renderer() : currentTexture(NULL), xRes(0), yRes(0), renderMode(0), or
 Renderer::~Renderer() {
 }
 
+Texture *Renderer::createTextureWithMipmaps(unsigned int width, unsigned int height, char **levelData, unsigned int numLevels, bool clamp, int type) {
+	return createTexture(width, height, levelData[0], clamp, numLevels > 1, type);
+}
+
+void Renderer::resetRenderStats() {
+	drawCallCount = 0;
+	stateChangeCount = 0;
+	spriteBatchCount = 0;
+	batchedMeshCount = 0;
+}
+
+void Renderer::recordSpriteBatch(unsigned int numMeshes) {
+	spriteBatchCount++;
+	batchedMeshCount += numMeshes;
+}
+
+void Renderer::loadIdentity() {
+	modelviewMatrix.identity();
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+void Renderer::translate2D(Number x, Number y) {
+	translate3D(x, y, 0.0);
+}
+
+void Renderer::rotate2D(Number angle) {
+	Quaternion q;
+	q.createFromAxisAngle(0.0, 0.0, 1.0, angle);
+	modelviewMatrix = q.createMatrix() * modelviewMatrix;
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+void Renderer::scale2D(Vector2 *scale) {
+	Vector3 scale3D(scale->x, scale->y, 1.0);
+	this->scale3D(&scale3D);
+}
+
+void Renderer::translate3D(Vector3 *position) {
+	translate3D(position->x, position->y, position->z);
+}
+
+void Renderer::translate3D(Number x, Number y, Number z) {
+	// same as multiplying by a translation matrix, but only the last row changes
+	for(int i=0; i < 4; i++) {
+		modelviewMatrix.m[3][i] += x * modelviewMatrix.m[0][i] + y * modelviewMatrix.m[1][i] + z * modelviewMatrix.m[2][i];
+	}
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+void Renderer::scale3D(Vector3 *scale) {
+	for(int i=0; i < 4; i++) {
+		modelviewMatrix.m[0][i] *= scale->x;
+		modelviewMatrix.m[1][i] *= scale->y;
+		modelviewMatrix.m[2][i] *= scale->z;
+	}
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+void Renderer::pushMatrix() {
+	RenderMatrixStackEntry entry;
+	entry.matrix = modelviewMatrix;
+	entry.uploadMatrixValid = modelviewUploadMatrixValid;
+	if(modelviewUploadMatrixValid)
+		memcpy(entry.uploadMatrix, modelviewUploadMatrix, sizeof(modelviewUploadMatrix));
+	modelviewStack.push_back(entry);
+}
+
+void Renderer::popMatrix() {
+	if(modelviewStack.size() == 0)
+		return;
+	RenderMatrixStackEntry &entry = modelviewStack[modelviewStack.size()-1];
+	modelviewMatrix = entry.matrix;
+	modelviewUploadMatrixValid = entry.uploadMatrixValid;
+	if(entry.uploadMatrixValid)
+		memcpy(modelviewUploadMatrix, entry.uploadMatrix, sizeof(modelviewUploadMatrix));
+	modelviewStack.pop_back();
+	modelviewMatrixDirty = true;
+}
+
+void Renderer::multModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m * modelviewMatrix;
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+void Renderer::setModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m;
+	modelviewMatrixDirty = true;
+	modelviewUploadMatrixValid = false;
+}
+
+Matrix4 Renderer::getModelviewMatrix() {
+	return modelviewMatrix;
+}
+
+void Renderer::setProjectionMatrix(const Matrix4 &m) {
+	projectionMatrix = m;
+	projectionMatrixDirty = true;
+	projectionUploadMatrixValid = false;
+}
+
+void Renderer::pushProjectionMatrix() {
+	RenderMatrixStackEntry entry;
+	entry.matrix = projectionMatrix;
+	entry.uploadMatrixValid = projectionUploadMatrixValid;
+	if(projectionUploadMatrixValid)
+		memcpy(entry.uploadMatrix, projectionUploadMatrix, sizeof(projectionUploadMatrix));
+	projectionStack.push_back(entry);
+}
+
+void Renderer::popProjectionMatrix() {
+	if(projectionStack.size() == 0)
+		return;
+	RenderMatrixStackEntry &entry = projectionStack[projectionStack.size()-1];
+	projectionMatrix = entry.matrix;
+	projectionUploadMatrixValid = entry.uploadMatrixValid;
+	if(entry.uploadMatrixValid)
+		memcpy(projectionUploadMatrix, entry.uploadMatrix, sizeof(projectionUploadMatrix));
+	projectionStack.pop_back();
+	projectionMatrixDirty = true;
+}
+
+Matrix4 Renderer::getProjectionMatrix() {
+	return projectionMatrix;
+}
+
+const float *Renderer::getModelviewUploadMatrix() {
+	if(!modelviewUploadMatrixValid) {
+		for(int i=0; i < 16; i++) {
+			modelviewUploadMatrix[i] = modelviewMatrix.ml[i];
+		}
+		modelviewUploadMatrixValid = true;
+	}
+	return modelviewUploadMatrix;
+}
+
+const float *Renderer::getProjectionUploadMatrix() {
+	if(!projectionUploadMatrixValid) {
+		for(int i=0; i < 16; i++) {
+			projectionUploadMatrix[i] = projectionMatrix.ml[i];
+		}
+		projectionUploadMatrixValid = true;
+	}
+	return projectionUploadMatrix;
+}
+
+Matrix4 Renderer::createPerspectiveMatrix(Number fov, Number aspect, Number nearPlane, Number farPlane) {
+	Number f = 1.0/tan(fov * PI / 360.0);
+	return Matrix4(f/aspect, 0.0, 0.0, 0.0,
+					0.0, f, 0.0, 0.0,
+					0.0, 0.0, (farPlane+nearPlane)/(nearPlane-farPlane), -1.0,
+					0.0, 0.0, (2.0*farPlane*nearPlane)/(nearPlane-farPlane), 0.0);
+}
+
+Matrix4 Renderer::createOrthoMatrix(Number left, Number right, Number bottom, Number top, Number nearPlane, Number farPlane) {
+	return Matrix4(2.0/(right-left), 0.0, 0.0, 0.0,
+					0.0, 2.0/(top-bottom), 0.0, 0.0,
+					0.0, 0.0, -2.0/(farPlane-nearPlane), 0.0,
+					-(right+left)/(right-left), -(top+bottom)/(top-bottom), -(farPlane+nearPlane)/(farPlane-nearPlane), 1.0);
+}
+
+Vector3 Renderer::unprojectPoint(Number x, Number y, Number z, const Matrix4 &modelview, const Matrix4 &projection) {
+	// window coordinates to normalized device coordinates, then back through the inverse of modelview * projection
+	Number ndc[4] = { (2.0 * x / viewportWidth) - 1.0, 1.0 - (2.0 * y / viewportHeight), (2.0 * z) - 1.0, 1.0 };
+	Matrix4 inverse = (modelview * projection).inverse();
+	Number result[4];
+	for(int i=0; i < 4; i++) {
+		result[i] = ndc[0] * inverse.m[0][i] + ndc[1] * inverse.m[1][i] + ndc[2] * inverse.m[2][i] + ndc[3] * inverse.m[3][i];
+	}
+	if(result[3] == 0.0)
+		return Vector3();
+	return Vector3(result[0]/result[3], result[1]/result[3], result[2]/result[3]);
+}
+
 void Renderer::enableShaders(bool flag) {
 	shadersEnabled = flag;
 }
@@ -290,6 +485,15 @@ void Renderer::setCameraPosition(Vector3 pos) {
 	this->translate3D(&pos);
 }
 
+void Renderer::setDitherFade(Number amount, bool inverted) {
+}
+
+void Renderer::setLODView(const Vector3 &cameraPosition, Number projectionScale, bool orthographic) {
+	lodCameraPosition = cameraPosition;
+	lodProjectionScale = projectionScale;
+	lodOrthographic = orthographic;
+}
+
 void Renderer::enableScissor(bool val) {
 	scissorEnabled = val;
 }
@@ -406,6 +610,10 @@ void Renderer::setFOV(Number fov) {
 	resetViewport();
 }
 
+Number Renderer::getFOV() {
+	return fov;
+}
+
 void Renderer::setViewportSize(int w, int h) {
 	viewportWidth = w;
 	viewportHeight = h;
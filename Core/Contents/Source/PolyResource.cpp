@@ -24,8 +24,11 @@
 
 using namespace Polycode;
 
+unsigned int Resource::nextResourceID = 1;
+
 Resource::Resource(int type) {
 	this->type = type;
+	resourceID = nextResourceID++;
 }
 
 Resource::~Resource() {
@@ -33,7 +33,7 @@
 #include "OSBasics.h"
 
 #include "physfs.h"
-#include "tinyxml.h"
+#include "PolyXMLReader.h"
 
 using std::vector;
 using namespace Polycode;
@@ -51,38 +51,78 @@ ResourceManager::~ResourceManager() {
 		resources.clear();
 }
 
-void ResourceManager::parseShaders(const String& dirPath, bool recursive) {
+std::vector<XMLReader*> ResourceManager::readMaterialFiles(const String& dirPath, bool recursive) {
+	std::vector<XMLReader*> readers;
+	findMaterialFiles(dirPath, recursive, &readers);
+	if(readers.size() == 0) {
+		return readers;
+	}
+	
+	XMLFileParser::readAll(readers);
+	
+	std::vector<XMLReader*> validReaders;
+	for(int i=0; i < readers.size(); i++) {
+		if(readers[i]->hasError()) {
+			Logger::log("XML Error: %s\n", readers[i]->getErrorDescription().c_str());
+			delete readers[i];
+		} else {
+			validReaders.push_back(readers[i]);
+		}
+	}
+	return validReaders;
+}
+
+void ResourceManager::findMaterialFiles(const String& dirPath, bool recursive, std::vector<XMLReader*> *readers) {
 	vector<OSFileEntry> resourceDir;
 	resourceDir = OSBasics::parseFolder(dirPath, false);
 	
 	for(int i=0; i < resourceDir.size(); i++) {	
 		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
 			if(resourceDir[i].extension == "mat") {
-				Logger::log("Adding shaders from %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				TiXmlDocument doc(resourceDir[i].fullPath.c_str());
-				doc.LoadFile();
-				if(doc.Error()) {
-					Logger::log("XML Error: %s\n", doc.ErrorDesc());
+				XMLReader *reader = new XMLReader();
+				if(reader->openFile(resourceDir[i].fullPath)) {
+					readers->push_back(reader);
 				} else {
-					TiXmlElement *mElem = doc.RootElement()->FirstChildElement("shaders");
-					
-					if(mElem) {
-						TiXmlNode* pChild;					
-						for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {						
-							Shader *newShader = CoreServices::getInstance()->getMaterialManager()->createShaderFromXMLNode(pChild);
-							if(newShader != NULL) {
-								Logger::log("Adding shader %s\n", newShader->getName().c_str());
-								newShader->setResourceName(newShader->getName());
-								resources.push_back(newShader);
-								 CoreServices::getInstance()->getMaterialManager()->registerShader(newShader);
-							}
-						}
-					}
+					Logger::log("XML Error: %s\n", reader->getErrorDescription().c_str());
+					delete reader;
 				}
 			}
 		} else {
 			if(recursive)
-				parseShaders(dirPath+"/"+resourceDir[i].name, true);
+				findMaterialFiles(dirPath+"/"+resourceDir[i].name, true, readers);
+		}
+	}
+}
+
+void ResourceManager::parseShaders(const String& dirPath, bool recursive) {
+	std::vector<XMLReader*> readers = readMaterialFiles(dirPath, recursive);
+	for(int i=0; i < readers.size(); i++) {
+		parseShaders(readers[i]);
+		delete readers[i];
+	}
+}
+
+void ResourceManager::parseShaders(XMLReader *reader) {
+	Logger::log("Adding shaders from %s\n", reader->getFileName().c_str());
+	reader->rewind();
+	if(!reader->nextChild(0)) {
+		return;
+	}
+	
+	int rootDepth = reader->getDepth();
+	while(reader->nextChild(rootDepth)) {
+		if(reader->getName() == "shaders") {
+			int shadersDepth = reader->getDepth();
+			while(reader->nextChild(shadersDepth)) {
+				Shader *newShader = CoreServices::getInstance()->getMaterialManager()->createShaderFromXMLNode(reader);
+				if(newShader != NULL) {
+					Logger::log("Adding shader %s\n", newShader->getName().c_str());
+					newShader->setResourceName(newShader->getName());
+					resources.push_back(newShader);
+					 CoreServices::getInstance()->getMaterialManager()->registerShader(newShader);
+				}
+			}
+			break;
 		}
 	}
 }
@@ -115,59 +155,52 @@ void ResourceManager::parsePrograms(const String& dirPath, bool recursive) {
 }
 
 void ResourceManager::parseMaterials(const String& dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
-	
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "mat") {				
-				MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();			
-				std::vector<Material*> materials = materialManager->loadMaterialsFromFile(resourceDir[i].fullPath);
+	std::vector<XMLReader*> readers = readMaterialFiles(dirPath, recursive);
+	for(int i=0; i < readers.size(); i++) {
+		parseMaterials(readers[i]);
+		delete readers[i];
+	}
+}
 
-				for(int m=0; m < materials.size(); m++) {
-					materials[m]->setResourceName(materials[m]->getName());
-					resources.push_back(materials[m]);
-					materialManager->addMaterial(materials[m]);
-				}
-			}
-		} else {
-			if(recursive)
-				parseMaterials(dirPath+"/"+resourceDir[i].name, true);
-		}
+void ResourceManager::parseMaterials(XMLReader *reader) {
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();			
+	std::vector<Material*> materials = materialManager->loadMaterials(reader);
+
+	for(int m=0; m < materials.size(); m++) {
+		materials[m]->setResourceName(materials[m]->getName());
+		resources.push_back(materials[m]);
+		materialManager->addMaterial(materials[m]);
 	}
 }
 
 void ResourceManager::parseCubemaps(const String& dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
+	std::vector<XMLReader*> readers = readMaterialFiles(dirPath, recursive);
+	for(int i=0; i < readers.size(); i++) {
+		parseCubemaps(readers[i]);
+		delete readers[i];
+	}
+}
+
+void ResourceManager::parseCubemaps(XMLReader *reader) {
+	Logger::log("Adding cubemaps from %s\n", reader->getFileName().c_str());
+	reader->rewind();
+	if(!reader->nextChild(0)) {
+		return;
+	}
 	
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "mat") {
-				Logger::log("Adding cubemaps from %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				TiXmlDocument doc(resourceDir[i].fullPath.c_str());
-				doc.LoadFile();
-				if(doc.Error()) {
-					Logger::log("XML Error: %s\n", doc.ErrorDesc());
-				} else {
-					TiXmlElement *mElem = doc.RootElement()->FirstChildElement("cubemaps");
-					
-					if(mElem) {
-						TiXmlNode* pChild;					
-						for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-							Cubemap *newMat = CoreServices::getInstance()->getMaterialManager()->cubemapFromXMLNode(pChild);
-							//						newMat->setResourceName(newMat->getName());
-							if(newMat)
-								resources.push_back(newMat);
-						}
-					}
-				}
+	int rootDepth = reader->getDepth();
+	while(reader->nextChild(rootDepth)) {
+		if(reader->getName() == "cubemaps") {
+			int cubemapsDepth = reader->getDepth();
+			while(reader->nextChild(cubemapsDepth)) {
+				Cubemap *newMat = CoreServices::getInstance()->getMaterialManager()->cubemapFromXMLNode(reader);
+				//						newMat->setResourceName(newMat->getName());
+				if(newMat)
+					resources.push_back(newMat);
 			}
-		} else {
-			if(recursive)
-				parseCubemaps(dirPath+"/"+resourceDir[i].name, true);
+			break;
 		}
-	}	
+	}
 }
 
 void ResourceManager::addResource(Resource *resource) {
@@ -236,14 +269,25 @@ void ResourceManager::removeArchive(const String& path) {
 void ResourceManager::addDirResource(const String& dirPath, bool recursive) {
 	parseTextures(dirPath, recursive, "");
 	parsePrograms(dirPath, recursive);
-	parseShaders(dirPath, recursive);
-	parseCubemaps(dirPath, recursive);	
-	parseMaterials(dirPath, recursive);
+	
+	// material files are read once, in parallel, and then walked for shaders, cubemaps and materials in that order, since materials refer to both
+	std::vector<XMLReader*> materialFiles = readMaterialFiles(dirPath, recursive);
+	for(int i=0; i < materialFiles.size(); i++) {
+		parseShaders(materialFiles[i]);
+	}
+	for(int i=0; i < materialFiles.size(); i++) {
+		parseCubemaps(materialFiles[i]);
+	}
+	for(int i=0; i < materialFiles.size(); i++) {
+		parseMaterials(materialFiles[i]);
+		delete materialFiles[i];
+	}
+	
 	parseOthers(dirPath, recursive);	
 }
 
 Resource *ResourceManager::getResource(int resourceType, const String& resourceName) const {
-	Logger::log("requested %s\n", resourceName.c_str());
+	POLY_LOG_DEBUG("requested %s\n", resourceName.c_str());
 	for(int i =0; i < resources.size(); i++) {
 //		Logger::log("is it %s?\n", resources[i]->getResourceName().c_str());		
 		if(resources[i]->getResourceName() == resourceName && resources[i]->getResourceType() == resourceType) {
@@ -252,10 +296,10 @@ Resource *ResourceManager::getResource(int resourceType, const String& resourceN
 	}
 	
 	if(resourceType == Resource::RESOURCE_TEXTURE && resourceName != "default/default.png") {
-		Logger::log("Texture not found, using default\n");
+		POLY_LOG_LIMITED(Logger::LEVEL_WARNING, 10, "Texture %s not found, using default\n", resourceName.c_str());
 		return getResource(Resource::RESOURCE_TEXTURE, "default/default.png");
 	}	
-	Logger::log("return NULL\n");
+	POLY_LOG_DEBUG("resource %s not found\n", resourceName.c_str());
 	// need to add some sort of default resource for each type
 	return NULL;
 }
@@ -263,7 +307,7 @@ Resource *ResourceManager::getResource(int resourceType, const String& resourceN
 // Would it make more sense to pass back, like, something like an ObjectEntry here? Lua hates vectors.
 vector<Resource *> ResourceManager::getResources(int resourceType) {
 	vector<Resource *> result;
-	Logger::log("requested all of type %d\n", resourceType);
+	POLY_LOG_DEBUG("requested all of type %d\n", resourceType);
 	for(int i =0; i < resources.size(); i++) {
 		//		Logger::log("is it %s?\n", resources[i]->getResourceName().c_str());		
 		if(resources[i]->getResourceType() == resourceType) {
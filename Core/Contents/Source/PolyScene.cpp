@@ -23,16 +23,23 @@
 #include "PolyScene.h"
 #include "OSBasics.h"
 #include "PolyCamera.h"
+#include "PolyCore.h"
 #include "PolyCoreServices.h"
 #include "PolyLogger.h"
 #include "PolyMaterial.h"
 #include "PolyMesh.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 #include "PolyResource.h"
 #include "PolyResourceManager.h"
 #include "PolySceneLight.h"
 #include "PolySceneMesh.h"
 #include "PolySceneManager.h"
+#include "PolyTexture.h"
+#include "PolyJobPool.h"
+#include <algorithm>
+#include <map>
+#include <string.h>
 
 using std::vector;
 using namespace Polycode;
@@ -49,6 +56,7 @@ Scene::Scene() : EventDispatcher() {
 	ambientColor.setColor(0.0,0.0,0.0,1.0);
 	useClearColor = false;
 	ownsChildren = false;
+	sortRenderQueue = true;
 	CoreServices::getInstance()->getSceneManager()->addScene(this);	
 }
 
@@ -64,6 +72,7 @@ Scene::Scene(bool virtualScene) : EventDispatcher() {
 	ambientColor.setColor(0.0,0.0,0.0,1.0);	
 	useClearColor = false;
 	ownsChildren = false;
+	sortRenderQueue = true;
 	if (!isSceneVirtual) {
 		CoreServices::getInstance()->getSceneManager()->addScene(this);
 	}
@@ -103,6 +112,9 @@ Scene::~Scene() {
 			delete entities[i];
 		}
 	}
+	for(int i=0; i < sharedMeshes.size(); i++) {
+		delete sharedMeshes[i];
+	}
 	CoreServices::getInstance()->getSceneManager()->removeScene(this);	
 	delete defaultCamera;
 }
@@ -160,6 +172,7 @@ Camera *Scene::getDefaultCamera() {
 }
 
 void Scene::Render(Camera *targetCamera) {
+	POLY_PROFILE_ZONE("Scene::Render");
 	
 	if(!targetCamera && !activeCamera)
 		return;
@@ -245,13 +258,38 @@ void Scene::Render(Camera *targetCamera) {
 	}
 	
 	
+	Vector3 cameraPosition = targetCamera->getConcatenatedMatrix().getPosition();
+	
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	bool orthographic = targetCamera->getOrthoMode();
+	Number projectionScale;
+	if(orthographic) {
+		projectionScale = targetCamera->getOrthoSizeY() > 0 ? renderer->getYRes() / targetCamera->getOrthoSizeY() : 1.0;
+	} else {
+		projectionScale = renderer->getYRes() / (2.0 * tan(renderer->getFOV() * PI / 360.0));
+	}
+	// scene meshes pick their level of detail when they are drawn, at any depth of the hierarchy
+	renderer->setLODView(cameraPosition, projectionScale, orthographic);
+	
+	renderQueue.clear();
 	for(int i=0; i<entities.size();i++) {
+		if(!entities[i]->enabled)
+			continue;
 		if(entities[i]->getBBoxRadius() > 0) {
-			if(targetCamera->isSphereInFrustrum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
-				entities[i]->transformAndRender();
-		} else {
-			entities[i]->transformAndRender();		
+			if(!targetCamera->isSphereInFrustrum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
+				continue;
 		}
+		RenderQueueEntry entry;
+		entry.entity = entities[i];
+		entry.sortKey = sortRenderQueue ? getRenderSortKey(entities[i], cameraPosition, i) : 0;
+		renderQueue.push_back(entry);
+	}
+	
+	if(sortRenderQueue)
+		std::sort(renderQueue.begin(), renderQueue.end());
+	
+	for(int i=0; i < renderQueue.size(); i++) {
+		renderQueue[i].entity->transformAndRender();
 	}
 	
 	if(targetCamera->getOrthoMode()) {
@@ -260,6 +298,44 @@ void Scene::Render(Camera *targetCamera) {
 	
 }
 
+unsigned long long Scene::getRenderSortKey(SceneEntity *entity, const Vector3 &cameraPosition, unsigned int submissionIndex) {
+	
+	unsigned long long pass = RENDER_PASS_OPAQUE;
+	if(!entity->depthTest) {
+		pass = RENDER_PASS_OVERLAY;
+	} else if(!entity->depthWrite || entity->getCombinedColor().a < 1.0) {
+		pass = RENDER_PASS_BLENDED;
+	}
+	
+	// overlays keep the order they were added in
+	if(pass == RENDER_PASS_OVERLAY)
+		return (pass << 62) | submissionIndex;
+	
+	Material *material = entity->getRenderMaterial();
+	Shader *shader = NULL;
+	if(material && material->getNumShaders() > 0)
+		shader = material->getShader(0);
+	
+	// resource IDs wrapping past the field widths merely weakens the grouping
+	Texture *texture = entity->getRenderTexture();
+	unsigned long long blendKey = entity->blendingMode & 0x7;
+	unsigned long long shaderKey = shader ? (shader->getResourceID() & 0x3FF) : 0;
+	unsigned long long materialKey = material ? (material->getResourceID() & 0xFFF) : 0;
+	unsigned long long textureKey = texture ? (texture->getResourceID() & 0x1FFF) : 0;
+	
+	// the bit pattern of a positive float sorts like its value, so its top 24 bits make a compact depth key
+	Vector3 delta = entity->getPosition() - cameraPosition;
+	float distance = delta.x*delta.x + delta.y*delta.y + delta.z*delta.z;
+	unsigned int distanceBits;
+	memcpy(&distanceBits, &distance, sizeof(float));
+	unsigned long long depthKey = distanceBits >> 8;
+	
+	if(pass == RENDER_PASS_OPAQUE) {
+		return (pass << 62) | (blendKey << 59) | (shaderKey << 49) | (materialKey << 37) | (textureKey << 24) | depthKey;
+	} else {
+		return (pass << 62) | ((0xFFFFFF - depthKey) << 38) | (blendKey << 35) | (materialKey << 23) | (textureKey << 10);
+	}
+}
 
 void Scene::RenderDepthOnly(Camera *targetCamera) {
 	
@@ -313,22 +389,308 @@ SceneLight *Scene::getNearestLight(Vector3 pos) {
 }
 
 
+static const char SCENE_FILE_MAGIC[4] = {'P','S','C','N'};
+
+/**
+* A mesh block of a scene file and the Mesh it decodes to.
+*/
+class SceneMeshBlock {
+	public:
+		MeshFileHeader header;
+		const char *data;
+		Mesh *mesh;
+		bool decoded;
+};
+
+/**
+* Decodes a mesh block on the core's job pool. Decoding a mesh only builds its polygons and vertex arrays, nothing is uploaded to the renderer until the scene is drawn.
+*/
+class SceneMeshDecodeJob : public Job {
+	public:
+		SceneMeshDecodeJob(SceneMeshBlock *block) : block(block) {}
+		
+		void run() {
+			block->mesh = new Mesh(Mesh::TRI_MESH);
+			block->decoded = block->mesh->loadFromBuffer(block->header, block->data);
+		}
+		
+	protected:
+		SceneMeshBlock *block;
+};
+
+static bool sceneTableInBounds(unsigned int offset, unsigned int count, size_t recordSize, size_t size) {
+	if(offset > size)
+		return false;
+	return count <= (size - offset) / recordSize;
+}
+
 String Scene::readString(OSFILE *inFile) {
+	unsigned int length;
+	if(OSBasics::read(&length, sizeof(unsigned int), 1, inFile) != 1)
+		return "";
+	
+	// read in pieces so that the string never grows past what is actually in the file
+	String str;
 	char buffer[1024];
-	unsigned int namelen;
-	OSBasics::read(&namelen, sizeof(unsigned int), 1, inFile);
-	memset(buffer, 0, 1024);
-	OSBasics::read(buffer, 1, namelen, inFile);
-	return String(buffer);
+	while(length > 0) {
+		size_t chunkLength = length < sizeof(buffer) ? length : sizeof(buffer);
+		size_t numRead = OSBasics::read(buffer, 1, chunkLength, inFile);
+		str.contents.append(buffer, numRead);
+		if(numRead < chunkLength)
+			break;
+		length -= chunkLength;
+	}
+	return str;
 }
 
 void Scene::loadScene(const String& fileName) {
-	OSFILE *inFile = OSBasics::open(fileName.c_str(), "rb");
+	OSFILE *inFile = OSBasics::openMapped(fileName);
 	if(!inFile) {
-		Logger::log("Error opening scene file\n");
+		POLY_LOG_ERROR("Error opening scene file\n");
 		return;
 	}
 	
+	char magic[4];
+	if(OSBasics::read(magic, 1, 4, inFile) == 4 && memcmp(magic, SCENE_FILE_MAGIC, 4) == 0) {
+		bool success = false;
+		OSFileMapping *mapping = OSBasics::getMapping(inFile);
+		if(mapping) {
+			success = readSceneBuffer(mapping->data, mapping->size);
+		} else {
+			OSBasics::seek(inFile, 0, SEEK_END);
+			std::vector<char> buffer(OSBasics::tell(inFile));
+			OSBasics::seek(inFile, 0, SEEK_SET);
+			if(buffer.size() > 0 && OSBasics::read(&buffer[0], 1, buffer.size(), inFile) == buffer.size()) {
+				success = readSceneBuffer(&buffer[0], buffer.size());
+			}
+		}
+		if(!success) {
+			POLY_LOG_ERROR("Error reading scene file %s\n", fileName.c_str());
+		}
+	} else {
+		OSBasics::seek(inFile, 0, SEEK_SET);
+		readLegacyScene(inFile);
+	}
+	OSBasics::close(inFile);
+}
+
+bool Scene::readSceneBuffer(const char *data, size_t size) {
+	SceneFileHeader header;
+	if(size < sizeof(SceneFileHeader)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(SceneFileHeader));
+	if(header.version != SCENE_FILE_VERSION) {
+		Logger::log("Unsupported scene file version %d\n", header.version);
+		return false;
+	}
+	
+	if(!sceneTableInBounds(header.meshTableOffset, header.meshCount, sizeof(SceneFileMesh), size) ||
+		!sceneTableInBounds(header.objectTableOffset, header.objectCount, sizeof(SceneFileObject), size) ||
+		!sceneTableInBounds(header.propTableOffset, header.propCount, sizeof(SceneFileProp), size) ||
+		!sceneTableInBounds(header.stringTableOffset, header.stringCount, sizeof(SceneFileString), size)) {
+		return false;
+	}
+	size_t stringDataOffset = header.stringTableOffset + (header.stringCount * sizeof(SceneFileString));
+	if(header.stringDataSize > size - stringDataOffset) {
+		return false;
+	}
+	
+	std::vector<String> strings(header.stringCount);
+	for(unsigned int i=0; i < header.stringCount; i++) {
+		SceneFileString fileString;
+		memcpy(&fileString, data + header.stringTableOffset + (i * sizeof(SceneFileString)), sizeof(SceneFileString));
+		if(fileString.offset > header.stringDataSize || fileString.length > header.stringDataSize - fileString.offset) {
+			return false;
+		}
+		strings[i].contents.assign(data + stringDataOffset + fileString.offset, fileString.length);
+	}
+	
+	std::vector<SceneFileProp> props(header.propCount);
+	if(header.propCount > 0) {
+		memcpy(&props[0], data + header.propTableOffset, header.propCount * sizeof(SceneFileProp));
+	}
+	for(unsigned int i=0; i < header.propCount; i++) {
+		if(props[i].nameIndex >= header.stringCount || props[i].valueIndex >= header.stringCount) {
+			return false;
+		}
+	}
+	
+	// check every object before anything is created, so that a corrupt file doesn't leave a half loaded scene
+	std::vector<SceneFileObject> objects(header.objectCount);
+	if(header.objectCount > 0) {
+		memcpy(&objects[0], data + header.objectTableOffset, header.objectCount * sizeof(SceneFileObject));
+	}
+	std::vector<bool> flatNormals(header.objectCount, false);
+	for(unsigned int i=0; i < header.objectCount; i++) {
+		const SceneFileObject &object = objects[i];
+		if(object.firstProp > header.propCount || object.propCount > header.propCount - object.firstProp) {
+			return false;
+		}
+		if(object.type == ENTITY_MESH) {
+			if(object.meshIndex >= header.meshCount || object.materialIndex >= header.stringCount) {
+				return false;
+			}
+			for(unsigned int p=object.firstProp; p < object.firstProp + object.propCount; p++) {
+				if(strings[props[p].nameIndex] == "vertexnormals" && strings[props[p].valueIndex] == "false")
+					flatNormals[i] = true;
+			}
+		} else if(object.type == ENTITY_ENTITY) {
+			if(object.entityTypeIndex >= header.stringCount) {
+				return false;
+			}
+		}
+	}
+	
+	std::vector<SceneMeshBlock> blocks(header.meshCount);
+	for(unsigned int i=0; i < header.meshCount; i++) {
+		SceneFileMesh fileMesh;
+		memcpy(&fileMesh, data + header.meshTableOffset + (i * sizeof(SceneFileMesh)), sizeof(SceneFileMesh));
+		if(fileMesh.offset > size || fileMesh.size > size - fileMesh.offset || fileMesh.size < sizeof(MeshFileHeader)) {
+			return false;
+		}
+		memcpy(&blocks[i].header, data + fileMesh.offset, sizeof(MeshFileHeader));
+		if(blocks[i].header.dataSize > fileMesh.size - sizeof(MeshFileHeader)) {
+			return false;
+		}
+		blocks[i].data = data + fileMesh.offset + sizeof(MeshFileHeader);
+		blocks[i].mesh = NULL;
+		blocks[i].decoded = false;
+	}
+	
+	// objects that turn vertex normals off share their own decoded copy of a mesh, so the objects drawing it with vertex normals are not affected
+	std::vector<unsigned int> objectBlocks(header.objectCount, 0);
+	std::vector<int> flatBlocks(header.meshCount, -1);
+	for(unsigned int i=0; i < header.objectCount; i++) {
+		if(objects[i].type != ENTITY_MESH)
+			continue;
+		unsigned int meshIndex = objects[i].meshIndex;
+		objectBlocks[i] = meshIndex;
+		if(flatNormals[i]) {
+			if(flatBlocks[meshIndex] < 0) {
+				SceneMeshBlock flatBlock = blocks[meshIndex];
+				flatBlocks[meshIndex] = blocks.size();
+				blocks.push_back(flatBlock);
+			}
+			objectBlocks[i] = flatBlocks[meshIndex];
+		}
+	}
+	std::vector<unsigned int> meshUsers(blocks.size(), 0);
+	for(unsigned int i=0; i < header.objectCount; i++) {
+		if(objects[i].type == ENTITY_MESH)
+			meshUsers[objectBlocks[i]]++;
+	}
+	
+	// meshes nothing uses are not decoded at all
+	std::vector<Job*> jobs;
+	for(unsigned int i=0; i < blocks.size(); i++) {
+		if(meshUsers[i] > 0)
+			jobs.push_back(new SceneMeshDecodeJob(&blocks[i]));
+	}
+	CoreServices::getInstance()->getCore()->getJobPool()->runJobs(jobs);
+	
+	bool decoded = true;
+	for(unsigned int i=0; i < blocks.size(); i++) {
+		if(meshUsers[i] > 0)
+			decoded = decoded && blocks[i].decoded;
+	}
+	if(!decoded) {
+		for(unsigned int i=0; i < blocks.size(); i++) {
+			delete blocks[i].mesh;
+		}
+		return false;
+	}
+	
+	hasLightmaps = (header.flags & SCENE_FILE_HAS_LIGHTMAPS) != 0;
+	clearColor.setColor(header.clearColor[0], header.clearColor[1], header.clearColor[2], 1.0f);
+	ambientColor.setColor(header.ambientColor[0], header.ambientColor[1], header.ambientColor[2], 1.0f);
+	
+	for(unsigned int i=0; i < blocks.size(); i++) {
+		if(meshUsers[i] > 1)
+			sharedMeshes.push_back(blocks[i].mesh);
+	}
+	
+	// each material is looked up once, no matter how many objects use it
+	ResourceManager *resourceManager = CoreServices::getInstance()->getResourceManager();
+	std::vector<Material*> materials(header.stringCount, (Material*)NULL);
+	std::vector<bool> materialsFound(header.stringCount, false);
+	
+	Logger::log("Loading scene (%d objects, %d meshes)\n", header.objectCount, header.meshCount);
+	for(unsigned int i=0; i < header.objectCount; i++) {
+		const SceneFileObject &object = objects[i];
+		SceneEntity *newEntity = NULL;
+		
+		switch(object.type) {
+			case ENTITY_MESH: {
+				SceneMesh *newSceneMesh = new SceneMesh(blocks[objectBlocks[i]].mesh);
+				newSceneMesh->ownsMesh = (meshUsers[objectBlocks[i]] == 1);
+				newSceneMesh->setColor(object.color[0], object.color[1], object.color[2], object.color[3]);
+				newSceneMesh->lightmapIndex = object.lightmapIndex;
+				addEntity(newSceneMesh);
+				staticGeometry.push_back(newSceneMesh);
+				
+				if(!materialsFound[object.materialIndex]) {
+					materials[object.materialIndex] = (Material*) resourceManager->getResource(Resource::RESOURCE_MATERIAL, strings[object.materialIndex]);
+					materialsFound[object.materialIndex] = true;
+				}
+				if(materials[object.materialIndex] != NULL)
+					newSceneMesh->setMaterial(materials[object.materialIndex]);
+				newEntity = newSceneMesh;
+			}
+			break;
+			case ENTITY_ENTITY: {
+				SceneEntity *newCustomEntity = new SceneEntity();
+				newCustomEntity->custEntityType = strings[object.entityTypeIndex];
+				customEntities.push_back(newCustomEntity);
+				newEntity = newCustomEntity;
+			}
+			break;
+			case ENTITY_CAMERA:
+				newEntity = this->getDefaultCamera();
+			break;
+		}
+		
+		if(newEntity == NULL)
+			continue;
+		
+		for(unsigned int p=object.firstProp; p < object.firstProp + object.propCount; p++) {
+			EntityProp prop;
+			prop.propName = strings[props[p].nameIndex];
+			prop.propValue = strings[props[p].valueIndex];
+			newEntity->entityProps.push_back(prop);
+		}
+		
+		Number position[3], rotation[4];
+		for(int c=0; c < 3; c++) {
+			position[c] = object.position[c];
+		}
+		for(int c=0; c < 4; c++) {
+			rotation[c] = object.rotation[c];
+		}
+		finishLoadedEntity(newEntity, object.type, position, rotation);
+	}
+	
+	return true;
+}
+
+void Scene::finishLoadedEntity(SceneEntity *entity, unsigned int objectType, const Number *position, const Number *rotation) {
+	if(objectType == ENTITY_MESH) {
+		if(entity->getEntityProp("vertexnormals") == "false")
+			((SceneMesh*)entity)->getMesh()->useVertexNormals(false);
+		
+		if(entity->getEntityProp("collision") != "") {
+			if(entity->getEntityProp("collision")  == "mesh") {
+				loadCollisionChild(entity, false, 3);
+			}
+		}
+	}
+	
+	entity->setPosition(position[0], position[1], position[2]);
+	entity->setRotationQuat(rotation[0], rotation[1], rotation[2], rotation[3]);
+	entity->rebuildTransformMatrix();
+}
+
+void Scene::readLegacyScene(OSFILE *inFile) {
 	Number r,g,b,a;
 	
 	OSBasics::read(&r, sizeof(Number), 1, inFile);
@@ -342,8 +704,7 @@ void Scene::loadScene(const String& fileName) {
 	ambientColor.setColor(r,g,b,1.0f);
 	
 	
-	unsigned int numObjects, objectType,namelen;
-	char buffer[1024];
+	unsigned int numObjects, objectType;
 	char flag;
 	Number t[3],rq[4];
 	SceneEntity *newEntity;
@@ -363,14 +724,17 @@ void Scene::loadScene(const String& fileName) {
 		OSBasics::read(rq, sizeof(Number), 4, inFile);
 		newEntity = NULL;
 		
-		OSBasics::read(&objectType, sizeof(unsigned int), 1, inFile);
+		if(OSBasics::read(&objectType, sizeof(unsigned int), 1, inFile) != 1) {
+			POLY_LOG_ERROR("Unexpected end of scene file\n");
+			break;
+		}
 		
 		SceneMesh *newSceneMesh;
 		Mesh *newMesh;
 		Material *newMaterial;
 		
 		switch(objectType) {
-			case ENTITY_MESH:			
+			case ENTITY_MESH: {
 				
 				if(hasLightmaps) {
 					OSBasics::read(&lightmapIndex, sizeof(unsigned int), 1, inFile);			
@@ -379,18 +743,16 @@ void Scene::loadScene(const String& fileName) {
 				}
 				
 				
-				OSBasics::read(&namelen, sizeof(unsigned int), 1, inFile);
-				memset(buffer, 0, 1024);
-				OSBasics::read(buffer, 1, namelen, inFile);
+				String materialName = readString(inFile);
 				
-				Logger::log("adding mesh (texture: %s)\n", buffer);
+				POLY_LOG_DEBUG("adding mesh (texture: %s)\n", materialName.c_str());
 				
 				OSBasics::read(&r, sizeof(Number), 1, inFile);
 				OSBasics::read(&g, sizeof(Number), 1, inFile);
 				OSBasics::read(&b, sizeof(Number), 1, inFile);
 				OSBasics::read(&a, sizeof(Number), 1, inFile);
 				
-				newMaterial = (Material*) CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, buffer);
+				newMaterial = (Material*) CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, materialName);
 				newMesh = new Mesh(Mesh::TRI_MESH);
 				newMesh->loadFromFile(inFile);
 				newSceneMesh = new SceneMesh(newMesh);
@@ -403,9 +765,9 @@ void Scene::loadScene(const String& fileName) {
 				if(newMaterial != NULL)
 					newSceneMesh->setMaterial(newMaterial);
 				
-				break;
+			} break;
 			case ENTITY_ENTITY: {
-				Logger::log("loading entity\n");
+				POLY_LOG_DEBUG("loading entity\n");
 				String entityType = readString(inFile);					
 				SceneEntity *newCustomEntity = new SceneEntity();
 				newCustomEntity->custEntityType = entityType;					
@@ -485,25 +847,11 @@ void Scene::loadScene(const String& fileName) {
 				newEntity->entityProps.push_back(prop);
 			}						
 			
-			if(objectType == ENTITY_MESH) {
-				if(newEntity->getEntityProp("vertexnormals") == "false")
-					((SceneMesh*)newEntity)->getMesh()->useVertexNormals(false);
-				
-				if(newEntity->getEntityProp("collision") != "") {
-					if(newEntity->getEntityProp("collision")  == "mesh") {
-						loadCollisionChild(newEntity, false, 3);
-					}
-				}
-			}
-			
-			newEntity->setPosition(t[0], t[1], t[2]);
-			newEntity->setRotationQuat(rq[0], rq[1], rq[2], rq[3]);
-			newEntity->rebuildTransformMatrix();						
+			finishLoadedEntity(newEntity, objectType, t, rq);
 		}		
 	}
 	
 	if(!hasLightmaps) {
-		OSBasics::close(inFile);
 		return;
 	}
 	/*
@@ -526,7 +874,6 @@ void Scene::loadScene(const String& fileName) {
 	 
 	 packer->bindTextures();
 	 */
-	OSBasics::close(inFile);
 }
 
 vector<SceneEntity*> Scene::getCustomEntitiesByType(const String& type) const {
@@ -565,134 +912,158 @@ void Scene::writeEntityMatrix(SceneEntity *entity, OSFILE *outFile) {
 	
 }
 
+static unsigned int addSceneString(const String& str, std::vector<String> &strings, std::map<std::string, unsigned int> &stringIndices) {
+	std::map<std::string, unsigned int>::iterator it = stringIndices.find(str.contents);
+	if(it != stringIndices.end())
+		return it->second;
+	unsigned int index = strings.size();
+	stringIndices[str.contents] = index;
+	strings.push_back(str);
+	return index;
+}
+
+static void addSceneObjectProps(SceneEntity *entity, SceneFileObject &object, std::vector<SceneFileProp> &props, std::vector<String> &strings, std::map<std::string, unsigned int> &stringIndices) {
+	object.firstProp = props.size();
+	object.propCount = entity->entityProps.size();
+	for(int i=0; i < entity->entityProps.size(); i++) {
+		SceneFileProp prop;
+		prop.nameIndex = addSceneString(entity->entityProps[i].propName, strings, stringIndices);
+		prop.valueIndex = addSceneString(entity->entityProps[i].propValue, strings, stringIndices);
+		props.push_back(prop);
+	}
+}
+
+static void setSceneObjectMatrix(SceneEntity *entity, SceneFileObject &object) {
+	Vector3 pos = entity->getPosition();
+	object.position[0] = pos.x;
+	object.position[1] = pos.y;
+	object.position[2] = pos.z;
+	
+	Quaternion rotation = entity->getRotationQuat();
+	object.rotation[0] = rotation.w;
+	object.rotation[1] = rotation.x;
+	object.rotation[2] = rotation.y;
+	object.rotation[3] = rotation.z;
+}
+
 void Scene::saveScene(const String& fileName) {
 	OSFILE *outFile = OSBasics::open(fileName.c_str(), "wb");
 	if(!outFile) {
-		Logger::log("Error opening scene file for writing\n");
+		POLY_LOG_ERROR("Error opening scene file for writing\n");
 		return;
 	}
 	
-	// geometry
-	unsigned int totalObjects = staticGeometry.size() + lights.size() + collisionGeometry.size() + customEntities.size();
-	unsigned int objType;
-	char flag = 0;
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(SceneFileHeader));
+	memcpy(header.magic, SCENE_FILE_MAGIC, 4);
+	header.version = SCENE_FILE_VERSION;
 	if(hasLightmaps)
-		flag = 1;
-	OSBasics::write(&flag, 1, 1, outFile);
-	OSBasics::write(&totalObjects, sizeof(unsigned int), 1, outFile);
+		header.flags |= SCENE_FILE_HAS_LIGHTMAPS;
+	header.clearColor[0] = clearColor.r;
+	header.clearColor[1] = clearColor.g;
+	header.clearColor[2] = clearColor.b;
+	header.ambientColor[0] = ambientColor.r;
+	header.ambientColor[1] = ambientColor.g;
+	header.ambientColor[2] = ambientColor.b;
 	
-	unsigned int stLen;
+	// the header is written again with the table offsets once they are known
+	OSBasics::write(&header, sizeof(SceneFileHeader), 1, outFile);
+	unsigned int offset = sizeof(SceneFileHeader);
 	
-	for(int i=0; i <staticGeometry.size(); i++) {
-		SceneMesh *mesh = staticGeometry[i];
-		
-		writeEntityMatrix(mesh, outFile);
-		
-		objType = Scene::ENTITY_MESH;		
-		OSBasics::write(&objType, sizeof(unsigned int), 1, outFile);
-		
-		if(hasLightmaps) {
-			unsigned int lightmapIndex = mesh->lightmapIndex;
-			OSBasics::write(&lightmapIndex, sizeof(unsigned int), 1, outFile);			
-		}
-		
-		stLen = mesh->getMaterial()->getName().length();
-		OSBasics::write(&stLen, sizeof(unsigned int), 1, outFile);
-		OSBasics::write(mesh->getMaterial()->getName().c_str(), 1, stLen, outFile);
-		
-		mesh->getMesh()->saveToFile(outFile);		
-	}
+	std::vector<SceneFileMesh> meshes;
+	std::map<Mesh*, unsigned int> meshIndices;
+	std::vector<SceneFileObject> objects;
+	std::vector<SceneFileProp> props;
+	std::vector<String> strings;
+	std::map<std::string, unsigned int> stringIndices;
+	addSceneString("", strings, stringIndices);
 	
-	/*
-	for(int i=0; i < collisionGeometry.size(); i++) {
-		SceneMesh *mesh = collisionGeometry[i];
-		writeEntityMatrix(mesh, outFile);
-		objType = Scene::ENTITY_COLLMESH;
-		OSBasics::write(&objType, sizeof(unsigned int), 1, outFile);
-		
-		unsigned int collType = 1;
-		OSBasics::write(&collType, sizeof(unsigned int), 1, outFile);
-		
-		unsigned int numVertices = mesh->getMesh()->getNumVertices();
-		OSBasics::write(&numVertices, sizeof(unsigned int), 1, outFile);
-		Number pos[3];
-		for(int j=0; j < numVertices; j++) {
-			Vertex *vert = mesh->getMesh()->getVertex(j);
-			pos[0] = vert->x;
-			pos[1] = vert->y;
-			pos[2] = vert->z;			
-			OSBasics::write(pos, sizeof(Number),3, outFile);
-		}
+	const char padding[16] = {0};
+	
+	for(int i=0; i < staticGeometry.size(); i++) {
+		SceneMesh *sceneMesh = staticGeometry[i];
+		Mesh *mesh = sceneMesh->getMesh();
 		
-		unsigned int numFaces = mesh->getMesh()->getPolygonCount();
-		OSBasics::write(&numFaces, sizeof(unsigned int), 1, outFile);
-		unsigned int ind[3];
-		for(int j=0; j < numFaces; j++) {
-			Polygon *poly = mesh->getMesh()->getPolygon(j);
-			ind[0] = mesh->getMesh()->getVertexIndex(poly->getVertex(0));
-			ind[1] = mesh->getMesh()->getVertexIndex(poly->getVertex(1));
-			ind[2] = mesh->getMesh()->getVertexIndex(poly->getVertex(2));			
-			OSBasics::write(ind, sizeof(unsigned int),3, outFile);
+		std::map<Mesh*, unsigned int>::iterator it = meshIndices.find(mesh);
+		unsigned int meshIndex;
+		if(it != meshIndices.end()) {
+			meshIndex = it->second;
+		} else {
+			unsigned int alignedOffset = (offset + 15) & ~15;
+			OSBasics::write(padding, 1, alignedOffset - offset, outFile);
+			mesh->saveToFile(outFile);
+			
+			SceneFileMesh fileMesh;
+			fileMesh.offset = alignedOffset;
+			fileMesh.size = OSBasics::tell(outFile) - alignedOffset;
+			offset = alignedOffset + fileMesh.size;
+			
+			meshIndex = meshes.size();
+			meshIndices[mesh] = meshIndex;
+			meshes.push_back(fileMesh);
 		}
-	}
-	*/
-	/*
-	Number col[3],e,d;
-	for(int i=0; i < lights.size(); i++) {
-		
-		writeEntityMatrix(lights[i], outFile);
-		objType = Scene::ENTITY_LIGHT;		
-		OSBasics::write(&objType, sizeof(unsigned int), 1, outFile);
 		
-		col[0] = lights[i]->lightColor.r;
-		col[1] = lights[i]->lightColor.g;
-		col[2] = lights[i]->lightColor.b;
-		e = lights[i]->getIntensity();
-		d = lights[i]->getDistance();
-		
-		OSBasics::write(&e, sizeof(Number), 1, outFile);
-		OSBasics::write(&d, sizeof(Number), 1, outFile);
-		OSBasics::write(col, sizeof(Number), 3, outFile);
+		SceneFileObject object;
+		memset(&object, 0, sizeof(SceneFileObject));
+		object.type = ENTITY_MESH;
+		setSceneObjectMatrix(sceneMesh, object);
+		object.color[0] = sceneMesh->color.r;
+		object.color[1] = sceneMesh->color.g;
+		object.color[2] = sceneMesh->color.b;
+		object.color[3] = sceneMesh->color.a;
+		object.meshIndex = meshIndex;
+		if(sceneMesh->getMaterial())
+			object.materialIndex = addSceneString(sceneMesh->getMaterial()->getName(), strings, stringIndices);
+		object.lightmapIndex = sceneMesh->lightmapIndex;
+		addSceneObjectProps(sceneMesh, object, props, strings, stringIndices);
+		objects.push_back(object);
 	}
-	*/
+	
 	for(int i=0; i < customEntities.size(); i++) {
 		SceneEntity *custEnt = customEntities[i];
 		
-		writeEntityMatrix(custEnt, outFile);	
-		objType = Scene::ENTITY_ENTITY;
-		OSBasics::write(&objType, sizeof(unsigned int), 1, outFile);
-		
-		
-		writeString(custEnt->custEntityType, outFile);
-		unsigned int numProps = custEnt->entityProps.size();
-		OSBasics::write(&numProps, sizeof(unsigned int), 1, outFile);		
-		for(int j=0; j < numProps; j++) {
-			writeString(custEnt->entityProps[j].propName, outFile);
-			writeString(custEnt->entityProps[j].propValue, outFile);
-		}
+		SceneFileObject object;
+		memset(&object, 0, sizeof(SceneFileObject));
+		object.type = ENTITY_ENTITY;
+		setSceneObjectMatrix(custEnt, object);
+		object.entityTypeIndex = addSceneString(custEnt->custEntityType, strings, stringIndices);
+		addSceneObjectProps(custEnt, object, props, strings, stringIndices);
+		objects.push_back(object);
 	}
 	
-	if(!hasLightmaps) {
-		OSBasics::close(outFile);
-		return;
-	}
+	header.meshCount = meshes.size();
+	header.meshTableOffset = offset;
+	if(meshes.size() > 0)
+		OSBasics::write(&meshes[0], sizeof(SceneFileMesh), meshes.size(), outFile);
+	offset += meshes.size() * sizeof(SceneFileMesh);
 	
-	/*
-	 unsigned int lmsize;
-	 lmsize = packer->images.size();
-	 OSBasics::write(&lmsize, sizeof(unsigned int), 1, outFile);
-	 for(int i=0; i < packer->images.size(); i++) {
-	 lmsize = packer->images[i]->getWidth();
-	 OSBasics::write(&lmsize, sizeof(unsigned int), 1, outFile);
-	 lmsize = packer->images[i]->getHeight();
-	 OSBasics::write(&lmsize, sizeof(unsigned int), 1, outFile);
-	 
-	 lmsize = packer->images[i]->getWidth() * packer->images[i]->getHeight() * 4;
-	 OSBasics::write(&lmsize, sizeof(unsigned int), 1, outFile);
-	 OSBasics::write(packer->images[i]->getPixels(), 1, lmsize, outFile);
-	 }
-	 */
+	header.objectCount = objects.size();
+	header.objectTableOffset = offset;
+	if(objects.size() > 0)
+		OSBasics::write(&objects[0], sizeof(SceneFileObject), objects.size(), outFile);
+	offset += objects.size() * sizeof(SceneFileObject);
+	
+	header.propCount = props.size();
+	header.propTableOffset = offset;
+	if(props.size() > 0)
+		OSBasics::write(&props[0], sizeof(SceneFileProp), props.size(), outFile);
+	offset += props.size() * sizeof(SceneFileProp);
+	
+	header.stringCount = strings.size();
+	header.stringTableOffset = offset;
+	std::string stringData;
+	for(int i=0; i < strings.size(); i++) {
+		SceneFileString fileString;
+		fileString.offset = stringData.size();
+		fileString.length = strings[i].length();
+		stringData.append(strings[i].contents);
+		OSBasics::write(&fileString, sizeof(SceneFileString), 1, outFile);
+	}
+	header.stringDataSize = stringData.size();
+	OSBasics::write(stringData.data(), 1, stringData.size(), outFile);
 	
+	OSBasics::seek(outFile, 0, SEEK_SET);
+	OSBasics::write(&header, sizeof(SceneFileHeader), 1, outFile);
 	OSBasics::close(outFile);
 }
 
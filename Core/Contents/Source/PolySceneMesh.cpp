@@ -22,9 +22,12 @@
 
 #include "PolySceneMesh.h"
 #include "PolyCoreServices.h"
+#include "PolyCore.h"
 #include "PolyBone.h"
 #include "PolyMaterial.h"
+#include "PolyMemory.h"
 #include "PolyPolygon.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 #include "PolyMaterial.h"
 #include "PolyMesh.h"
@@ -35,12 +38,15 @@
 
 using namespace Polycode;
 
+Number SceneMesh::lodBias = 1.0;
+
 SceneMesh *SceneMesh::SceneMeshFromMesh(Mesh *mesh) {
 	return new SceneMesh(mesh);
 }
 
 SceneMesh::SceneMesh(const String& fileName) : SceneEntity(), texture(NULL), material(NULL), skeleton(NULL), localShaderOptions(NULL) {
 	mesh = new Mesh(fileName);
+	lodLevels = Mesh::loadLODs(fileName);
 	bBoxRadius = mesh->getRadius();
 	bBox = mesh->calculateBBox();
 	lightmapIndex=0;
@@ -50,6 +56,13 @@ SceneMesh::SceneMesh(const String& fileName) : SceneEntity(), texture(NULL), mat
 	ownsMesh = true;
 	ownsSkeleton = true;
 	lineWidth = 1.0;
+	currentLOD = 0;
+	forcedLOD = -1;
+	fadingLOD = -1;
+	lodFade = 0;
+	lodErrorThreshold = 1.0;
+	lodHysteresis = 0.25;
+	lodFadeTime = 0;
 }
 
 SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL), skeleton(NULL), localShaderOptions(NULL) {
@@ -63,7 +76,13 @@ SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL),
 	ownsMesh = true;
 	ownsSkeleton = true;	
 	lineWidth = 1.0;
-		
+	currentLOD = 0;
+	forcedLOD = -1;
+	fadingLOD = -1;
+	lodFade = 0;
+	lodErrorThreshold = 1.0;
+	lodHysteresis = 0.25;
+	lodFadeTime = 0;
 }
 
 SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL), skeleton(NULL), localShaderOptions(NULL) {
@@ -77,6 +96,13 @@ SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL), skeleton(NUL
 	ownsMesh = true;
 	ownsSkeleton = true;	
 	lineWidth = 1.0;	
+	currentLOD = 0;
+	forcedLOD = -1;
+	fadingLOD = -1;
+	lodFade = 0;
+	lodErrorThreshold = 1.0;
+	lodHysteresis = 0.25;
+	lodFadeTime = 0;
 }
 
 void SceneMesh::setMesh(Mesh *mesh) {
@@ -85,14 +111,112 @@ void SceneMesh::setMesh(Mesh *mesh) {
 	bBox = mesh->calculateBBox();
 	showVertexNormals = false;	
 	useVertexBuffer = false;	
+	// the levels belonged to the previous mesh
+	if(ownsMesh) {
+		for(int i=0; i < lodLevels.size(); i++) {
+			delete lodLevels[i].mesh;
+		}
+	}
+	lodLevels.clear();
+	currentLOD = 0;
+	fadingLOD = -1;
+}
+
+void SceneMesh::addLODLevel(Mesh *mesh, Number geometricError) {
+	MeshLOD lod;
+	lod.mesh = mesh;
+	lod.geometricError = geometricError;
+	lodLevels.push_back(lod);
+	if(skeleton)
+		bindSkeleton(mesh);
+	if(useVertexBuffer && !mesh->hasVertexBuffer())
+		CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(mesh);
+}
+
+int SceneMesh::getNumLODLevels() {
+	return lodLevels.size() + 1;
+}
+
+Mesh *SceneMesh::getLODMesh(int level) {
+	if(level <= 0 || level > lodLevels.size())
+		return mesh;
+	return lodLevels[level-1].mesh;
+}
+
+int SceneMesh::getCurrentLOD() {
+	return currentLOD;
+}
+
+void SceneMesh::setForcedLOD(int level) {
+	forcedLOD = level;
+}
+
+void SceneMesh::setLODBias(Number bias) {
+	lodBias = bias;
+}
+
+Number SceneMesh::getLODBias() {
+	return lodBias;
+}
+
+void SceneMesh::updateLOD(const Vector3 &cameraPosition, Number projectionScale, bool orthographic) {
+	if(lodLevels.size() == 0)
+		return;
+	
+	if(fadingLOD >= 0) {
+		lodFade += lodFadeTime > 0 ? CoreServices::getInstance()->getCore()->getElapsed() / lodFadeTime : 1.0;
+		if(lodFade >= 1.0)
+			fadingLOD = -1;
+	}
+	
+	int targetLOD = currentLOD;
+	if(forcedLOD >= 0) {
+		targetLOD = forcedLOD < getNumLODLevels() ? forcedLOD : getNumLODLevels() - 1;
+	} else {
+		Matrix4 matrix = getConcatenatedMatrix();
+		Number scale = matrix.rotateVector(Vector3(1,0,0)).length();
+		scale = std::max(scale, matrix.rotateVector(Vector3(0,1,0)).length());
+		scale = std::max(scale, matrix.rotateVector(Vector3(0,0,1)).length());
+		
+		// pixels a unit of error covers, measured at the near side of the bounding sphere
+		Number pixelsPerUnit = projectionScale * scale * lodBias;
+		if(!orthographic) {
+			Number distance = (matrix.getPosition() - cameraPosition).length() - (bBoxRadius * scale);
+			if(distance <= 0.0001) {
+				targetLOD = 0;
+				pixelsPerUnit = 0;
+			} else {
+				pixelsPerUnit /= distance;
+			}
+		}
+		
+		if(pixelsPerUnit > 0) {
+			while(targetLOD < lodLevels.size() && lodLevels[targetLOD].geometricError * pixelsPerUnit <= lodErrorThreshold * (1.0 - lodHysteresis))
+				targetLOD++;
+			while(targetLOD > 0 && lodLevels[targetLOD-1].geometricError * pixelsPerUnit > lodErrorThreshold * (1.0 + lodHysteresis))
+				targetLOD--;
+		}
+	}
+	
+	if(targetLOD != currentLOD) {
+		if(lodFadeTime > 0) {
+			fadingLOD = currentLOD;
+			lodFade = 0;
+		}
+		currentLOD = targetLOD;
+	}
 }
 
 
 SceneMesh::~SceneMesh() {
 	if(ownsSkeleton)
 		delete skeleton;
-	if(ownsMesh)
+	if(ownsMesh) {
 		delete mesh;	
+		for(int i=0; i < lodLevels.size(); i++) {
+			delete lodLevels[i].mesh;
+		}
+	}
 	delete localShaderOptions;
 }
 
@@ -160,8 +284,14 @@ void SceneMesh::loadSkeleton(const String& fileName) {
 
 void SceneMesh::setSkeleton(Skeleton *skeleton) {
 	this->skeleton = skeleton;
-	for(int i=0; i < mesh->getPolygonCount(); i++) {
-		Polygon *polygon = mesh->getPolygon(i);
+	for(int i=0; i < getNumLODLevels(); i++) {
+		bindSkeleton(getLODMesh(i));
+	}
+}
+
+void SceneMesh::bindSkeleton(Mesh *targetMesh) {
+	for(int i=0; i < targetMesh->getPolygonCount(); i++) {
+		Polygon *polygon = targetMesh->getPolygon(i);
 		unsigned int vCount = polygon->getVertexCount();
 		for(int j=0; j < vCount; j++) {
 			Vertex *vertex = polygon->getVertex(j);
@@ -181,9 +311,26 @@ Skeleton *SceneMesh::getSkeleton() {
 }
 
 void SceneMesh::renderMeshLocally() {
+	drawMeshLocally(getLODMesh(currentLOD));
+}
+
+void SceneMesh::drawMeshLocally(Mesh *mesh) {
+	POLY_PROFILE_ZONE("SceneMesh::renderMeshLocally");
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	
 	if(skeleton) {	
+		// bone matrices only change once per frame, so resolve them once per bone
+		// instead of walking the bone hierarchy for every vertex assignment
+		int numBones = skeleton->getNumBones();
+		FrameArena *frameArena = FrameArena::getFrameArena();
+		Matrix4 *restMatrices = frameArena->allocateArray<Matrix4>(numBones);
+		Matrix4 *finalMatrices = frameArena->allocateArray<Matrix4>(numBones);
+		for(int i=0; i < numBones; i++) {
+			Bone *bone = skeleton->getBone(i);
+			restMatrices[i] = bone->getRestMatrix();
+			finalMatrices[i] = bone->getFinalMatrix();
+		}
+		
 		for(int i=0; i < mesh->getPolygonCount(); i++) {
 			Polygon *polygon = mesh->getPolygon(i);			
 			unsigned int vCount = polygon->getVertexCount();			
@@ -206,10 +353,10 @@ void SceneMesh::renderMeshLocally() {
 					for(int b =0; b < vert->getNumBoneAssignments(); b++) {
 						BoneAssignment *bas = vert->getBoneAssignment(b);
 						Bone *bone = bas->bone;
-						if(bone) {
+						if(bone && bas->boneID < (unsigned int)numBones) {
 							
-							Matrix4 restMatrix = bone->getRestMatrix();
-							Matrix4 finalMatrix = bone->getFinalMatrix();
+							const Matrix4 &restMatrix = restMatrices[bas->boneID];
+							const Matrix4 &finalMatrix = finalMatrices[bas->boneID];
 							
 							Vector3 vec = restMatrix * aPos;
 							tPos += finalMatrix * vec * (bas->weight*mult);
@@ -251,12 +398,24 @@ void SceneMesh::renderMeshLocally() {
 
 void SceneMesh::cacheToVertexBuffer(bool cache) {
 
-	if(cache && !mesh->hasVertexBuffer()) {
-		CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(mesh);
+	if(cache) {
+		for(int i=0; i < getNumLODLevels(); i++) {
+			Mesh *lodMesh = getLODMesh(i);
+			if(!lodMesh->hasVertexBuffer())
+				CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(lodMesh);
+		}
 	}
 	useVertexBuffer = cache;
 }
 
+void SceneMesh::drawMesh(Mesh *targetMesh) {
+	if(useVertexBuffer) {
+		CoreServices::getInstance()->getRenderer()->drawVertexBuffer(targetMesh->getVertexBuffer(), targetMesh->useVertexColors);
+	} else {
+		drawMeshLocally(targetMesh);
+	}
+}
+
 void SceneMesh::Render() {
 	
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
@@ -273,10 +432,17 @@ void SceneMesh::Render() {
 			renderer->setTexture(NULL);
 	}
 	
-	if(useVertexBuffer) {
-		renderer->drawVertexBuffer(mesh->getVertexBuffer(), mesh->useVertexColors);
+	updateLOD(renderer->getLODCameraPosition(), renderer->getLODProjectionScale(), renderer->getLODOrthographic());
+	
+	if(fadingLOD >= 0) {
+		// the outgoing and incoming levels cover complementary pixels while they cross-fade
+		renderer->setDitherFade(1.0 - lodFade, false);
+		drawMesh(getLODMesh(fadingLOD));
+		renderer->setDitherFade(lodFade, true);
+		drawMesh(getLODMesh(currentLOD));
+		renderer->setDitherFade(1.0, false);
 	} else {
-		renderMeshLocally();
+		drawMesh(getLODMesh(currentLOD));
 	}
 	
 	if(material) 
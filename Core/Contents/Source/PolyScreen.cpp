@@ -27,9 +27,11 @@
 #include "PolyResourceManager.h"
 #include "PolyCore.h"
 #include "PolyMaterial.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 #include "PolyScreenEntity.h"
 #include "PolyScreenEvent.h"
+#include "PolyScreenSpriteBatcher.h"
 #include "PolyShader.h"
 #include "PolyTexture.h"
 
@@ -45,6 +47,7 @@ Screen::Screen() : EventDispatcher() {
 	useNormalizedCoordinates = false;
 	processTouchEventsAsMouse = false;
 	ownsChildren = false;
+	spriteBatcher = NULL;
 
 	rootEntity.processInputEvents = true;
 
@@ -59,6 +62,22 @@ Screen::~Screen() {
 		delete localShaderOptions[i];
 	}
 	delete originalSceneTexture;			
+	delete spriteBatcher;
+}
+
+void Screen::setSpriteBatching(bool val) {
+	if(val && !spriteBatcher) {
+		spriteBatcher = new ScreenSpriteBatcher();
+	} else if(!val) {
+		delete spriteBatcher;
+		spriteBatcher = NULL;
+	}
+}
+
+unsigned int Screen::getNumSpriteBatches() const {
+	if(!spriteBatcher)
+		return 0;
+	return spriteBatcher->getNumBatches();
 }
 
 void Screen::setNormalizedCoordinates(bool newVal, Number yCoordinateSize) {
@@ -201,11 +220,18 @@ void Screen::Update() {
 }
 
 void Screen::Render() {
+	POLY_PROFILE_ZONE("Screen::Render");
 	Update();
 	renderer->loadIdentity();
 	renderer->translate2D(offset.x, offset.y);
 
 	rootEntity.doUpdates();
 	rootEntity.updateEntityMatrix();
-	rootEntity.transformAndRender();	
+	if(spriteBatcher) {
+		spriteBatcher->begin(renderer);
+		rootEntity.transformAndBatch(spriteBatcher);
+		spriteBatcher->end();
+	} else {
+		rootEntity.transformAndRender();	
+	}
 }
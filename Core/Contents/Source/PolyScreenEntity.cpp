@@ -26,6 +26,8 @@
 #include "PolyPolygon.h"
 #include "PolyVertex.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatcher.h"
+#include "PolyProfiler.h"
 #include "PolyCoreServices.h"
 #include "PolyLogger.h"
 
@@ -692,12 +694,67 @@ Matrix4 ScreenEntity::buildPositionMatrix() {
 	return posMatrix;
 }
 
-void ScreenEntity::adjustMatrixForChildren() {
+Vector2 ScreenEntity::getChildrenOffset() const {
 	if(positionMode == POSITION_TOPLEFT) {
 		if(snapToPixels) {
-			renderer->translate2D(-floor(width/2.0f), -floor(height/2.0f));			
+			return Vector2(-floor(width/2.0f), -floor(height/2.0f));
 		} else {
-			renderer->translate2D(-width/2.0f, -height/2.0f);	
+			return Vector2(-width/2.0f, -height/2.0f);
 		}
 	}
+	return Vector2(0,0);
+}
+
+void ScreenEntity::adjustMatrixForChildren() {
+	if(positionMode == POSITION_TOPLEFT) {
+		Vector2 offset = getChildrenOffset();
+		renderer->translate2D(offset.x, offset.y);
+	}
+}
+
+void ScreenEntity::transformAndBatch(ScreenSpriteBatcher *batcher) {
+	if(!enabled)
+		return;
+	
+	// anything the batcher can't reproduce on the CPU goes through the normal path
+	if(!canBatch() || depthOnly || renderWireframe || billboardMode || ignoreParentMatrix) {
+		batcher->renderEntity(this);
+		return;
+	}
+	
+	POLY_PROFILE_COUNT(Profiler::COUNTER_ENTITIES_VISITED, 1);
+	
+	bool isScissorEnabled;
+	Polycode::Rectangle oldScissorBox;
+	
+	if(enableScissor) {
+		isScissorEnabled = batcher->isScissorEnabled();
+		oldScissorBox = batcher->getScissorBox();
+		batcher->setScissor(true, clipScissorBox(isScissorEnabled, oldScissorBox));
+	}
+	
+	batcher->pushMatrix();
+	batcher->multMatrix(transformMatrix);
+	batcher->setColor(getCombinedColor());
+	batcher->setRenderState(blendingMode, depthTest, depthWrite, alphaTest, backfaceCulled);
+	
+	if(visible) {
+		renderToBatch(batcher);
+	}
+	
+	if(visible || (!visible && !visibilityAffectsChildren)) {
+		if(positionMode == POSITION_TOPLEFT) {
+			Vector2 offset = getChildrenOffset();
+			batcher->translate2D(offset.x, offset.y);
+		}
+		for(int i=0; i < children.size(); i++) {
+			((ScreenEntity*)children[i])->transformAndBatch(batcher);
+		}
+	}
+	
+	batcher->popMatrix();
+	
+	if(enableScissor) {
+		batcher->setScissor(isScissorEnabled, oldScissorBox);
+	}
 }
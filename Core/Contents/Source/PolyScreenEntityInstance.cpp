@@ -288,13 +288,18 @@ bool ScreenEntityInstance::loadFromFile(const String& fileName) {
 
 	this->fileName = fileName;
 	Object loadObject;
-	if(!loadObject.loadFromBinary(fileName)) {
+	if(!loadObject.loadFromFile(fileName)) {
 		Logger::log("Error loading entity instance.\n");
+		rootEntity = NULL;
+		return false;
 	}	
 	ObjectEntry *root = loadObject.root["root"];
 	
 	if(root) {
 		rootEntity = loadObjectEntryIntoEntity(root);				
 		addChild(rootEntity);		
+	} else {
+		rootEntity = NULL;
 	}
+	return root != NULL;
 }
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "PolyPolygon.h"
 #include "PolyScreenImage.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatcher.h"
 
 using namespace Polycode;
 
@@ -96,6 +97,13 @@ void ScreenLabel::Render() {
 	ScreenShape::Render();
 }
 
+void ScreenLabel::renderToBatch(ScreenSpriteBatcher *batcher) {
+	if(positionAtBaseline) {
+		batcher->translate2D(0.0, -label->getBaselineAdjust() + label->getSize());
+	}
+	ScreenShape::renderToBatch(batcher);
+}
+
 void ScreenLabel::setText(const String& newText) {
 	label->setText(newText);	
 	updateTexture();
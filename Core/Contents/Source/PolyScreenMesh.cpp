@@ -25,6 +25,7 @@
 #include "PolyMaterialManager.h"
 #include "PolyMesh.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatcher.h"
 
 using namespace Polycode;
 
@@ -92,6 +93,14 @@ void ScreenMesh::Render() {
 	renderer->drawArrays(mesh->getMeshType());
 }
 
+bool ScreenMesh::canBatch() {
+	return ScreenSpriteBatcher::canBatchMesh(mesh);
+}
+
+void ScreenMesh::renderToBatch(ScreenSpriteBatcher *batcher) {
+	batcher->addMesh(mesh, texture);
+}
+
 void ScreenMesh::updateHitBox() {
 	Number xmin, ymin, xmax, ymax;
 	bool any = false;
@@ -208,6 +208,10 @@ void ScreenShape::setStrokeColor(Number r, Number g, Number b, Number a) {
 	strokeColor.setColor(r,g,b,a);
 }
 
+bool ScreenShape::canBatch() {
+	return !strokeEnabled && ScreenMesh::canBatch();
+}
+
 void ScreenShape::Render() {
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 
@@ -0,0 +1,295 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyScreenSpriteBatcher.h"
+#include "PolyEntity.h"
+#include "PolyMesh.h"
+#include "PolyPolygon.h"
+#include "PolyVertex.h"
+#include "PolyRenderer.h"
+#include "PolyProfiler.h"
+#include <stdlib.h>
+
+using namespace Polycode;
+
+ScreenSpriteBatcher::ScreenSpriteBatcher() {
+	renderer = NULL;
+	vertexArray = NULL;
+	colorArray = NULL;
+	texCoordArray = NULL;
+	numVertices = 0;
+	vertexCapacity = 0;
+	numBatchedMeshes = 0;
+	numBatches = 0;
+
+	texture = NULL;
+	blendingMode = Renderer::BLEND_MODE_NORMAL;
+	depthTest = false;
+	depthWrite = false;
+	alphaTest = false;
+	backfaceCulled = false;
+	scissorEnabled = false;
+	rendererScissorEnabled = false;
+}
+
+ScreenSpriteBatcher::~ScreenSpriteBatcher() {
+	RenderDataArray *arrays[3] = {vertexArray, colorArray, texCoordArray};
+	for(int i=0; i < 3; i++) {
+		if(arrays[i]) {
+			free(arrays[i]->arrayPtr);
+			delete arrays[i];
+		}
+	}
+}
+
+void ScreenSpriteBatcher::begin(Renderer *renderer) {
+	this->renderer = renderer;
+	if(!vertexArray) {
+		vertexArray = renderer->createRenderDataArray(RenderDataArray::VERTEX_DATA_ARRAY);
+		colorArray = renderer->createRenderDataArray(RenderDataArray::COLOR_DATA_ARRAY);
+		texCoordArray = renderer->createRenderDataArray(RenderDataArray::TEXCOORD_DATA_ARRAY);
+		reserveVertices(1024);
+	}
+
+	matrix.identity();
+	matrixStack.clear();
+	color = Color(1.0, 1.0, 1.0, 1.0);
+	scissorEnabled = rendererScissorEnabled = renderer->isScissorEnabled();
+	scissorBox = rendererScissorBox = renderer->getScissorBox();
+	numVertices = 0;
+	numBatchedMeshes = 0;
+	numBatches = 0;
+}
+
+void ScreenSpriteBatcher::end() {
+	flush();
+	applyScissor();
+	renderer->enableDepthWrite(true);
+}
+
+void ScreenSpriteBatcher::pushMatrix() {
+	matrixStack.push_back(matrix);
+}
+
+void ScreenSpriteBatcher::popMatrix() {
+	if(matrixStack.size() == 0)
+		return;
+	matrix = matrixStack[matrixStack.size()-1];
+	matrixStack.pop_back();
+}
+
+void ScreenSpriteBatcher::multMatrix(const Matrix4 &m) {
+	matrix = m * matrix;
+}
+
+void ScreenSpriteBatcher::translate2D(Number x, Number y) {
+	for(int i=0; i < 4; i++) {
+		matrix.m[3][i] += x * matrix.m[0][i] + y * matrix.m[1][i];
+	}
+}
+
+void ScreenSpriteBatcher::setColor(const Color &color) {
+	this->color = color;
+}
+
+void ScreenSpriteBatcher::setRenderState(int blendingMode, bool depthTest, bool depthWrite, bool alphaTest, bool backfaceCulled) {
+	this->blendingMode = blendingMode;
+	this->depthTest = depthTest;
+	this->depthWrite = depthWrite;
+	this->alphaTest = alphaTest;
+	this->backfaceCulled = backfaceCulled;
+}
+
+void ScreenSpriteBatcher::setScissor(bool enabled, const Polycode::Rectangle &box) {
+	scissorEnabled = enabled;
+	scissorBox = box;
+}
+
+bool ScreenSpriteBatcher::canBatchMesh(Mesh *mesh) {
+	switch(mesh->getMeshType()) {
+		case Mesh::QUAD_MESH:
+		case Mesh::TRI_MESH:
+		case Mesh::TRIFAN_MESH:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void ScreenSpriteBatcher::addMesh(Mesh *mesh, Texture *texture) {
+	if(numVertices > 0) {
+		bool sameScissor = (scissorEnabled == batchScissorEnabled);
+		if(sameScissor && scissorEnabled) {
+			sameScissor = (scissorBox.x == batchScissorBox.x && scissorBox.y == batchScissorBox.y && scissorBox.w == batchScissorBox.w && scissorBox.h == batchScissorBox.h);
+		}
+		if(!sameScissor || texture != batchTexture || blendingMode != batchBlendingMode || depthTest != batchDepthTest || depthWrite != batchDepthWrite || alphaTest != batchAlphaTest || backfaceCulled != batchBackfaceCulled) {
+			flush();
+		}
+	}
+	if(numVertices == 0) {
+		batchTexture = texture;
+		batchBlendingMode = blendingMode;
+		batchDepthTest = depthTest;
+		batchDepthWrite = depthWrite;
+		batchAlphaTest = alphaTest;
+		batchBackfaceCulled = backfaceCulled;
+		batchScissorEnabled = scissorEnabled;
+		batchScissorBox = scissorBox;
+	}
+
+	// the mesh is drawn as one primitive over all of its polygons' vertices, so index them the same way
+	std::vector<Vertex*> &vertices = meshVertices;
+	vertices.clear();
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			vertices.push_back(polygon->getVertex(j));
+		}
+	}
+
+	int count = vertices.size();
+	bool useVertexColors = mesh->useVertexColors;
+	switch(mesh->getMeshType()) {
+		case Mesh::TRI_MESH:
+			reserveVertices(numVertices + count);
+			for(int i=0; i+2 < count; i += 3) {
+				addVertex(vertices[i], useVertexColors);
+				addVertex(vertices[i+1], useVertexColors);
+				addVertex(vertices[i+2], useVertexColors);
+			}
+		break;
+		case Mesh::QUAD_MESH:
+			reserveVertices(numVertices + (count / 4) * 6);
+			for(int i=0; i+3 < count; i += 4) {
+				addVertex(vertices[i], useVertexColors);
+				addVertex(vertices[i+1], useVertexColors);
+				addVertex(vertices[i+2], useVertexColors);
+				addVertex(vertices[i], useVertexColors);
+				addVertex(vertices[i+2], useVertexColors);
+				addVertex(vertices[i+3], useVertexColors);
+			}
+		break;
+		case Mesh::TRIFAN_MESH:
+			reserveVertices(numVertices + (count > 2 ? (count - 2) * 3 : 0));
+			for(int i=1; i+1 < count; i++) {
+				addVertex(vertices[0], useVertexColors);
+				addVertex(vertices[i], useVertexColors);
+				addVertex(vertices[i+1], useVertexColors);
+			}
+		break;
+	}
+	numBatchedMeshes++;
+}
+
+void ScreenSpriteBatcher::addVertex(Vertex *vertex, bool useVertexColor) {
+	Vector3 position = matrix * Vector3(vertex->x, vertex->y, vertex->z);
+	float *vertexData = ((float*)vertexArray->arrayPtr) + (numVertices * 3);
+	vertexData[0] = position.x;
+	vertexData[1] = position.y;
+	vertexData[2] = position.z;
+
+	const Color &vertexColor = useVertexColor ? vertex->vertexColor : color;
+	float *colorData = ((float*)colorArray->arrayPtr) + (numVertices * 4);
+	colorData[0] = vertexColor.r;
+	colorData[1] = vertexColor.g;
+	colorData[2] = vertexColor.b;
+	colorData[3] = vertexColor.a;
+
+	Vector2 texCoord = vertex->getTexCoord();
+	float *texCoordData = ((float*)texCoordArray->arrayPtr) + (numVertices * 2);
+	texCoordData[0] = texCoord.x;
+	texCoordData[1] = texCoord.y;
+
+	numVertices++;
+}
+
+void ScreenSpriteBatcher::reserveVertices(int count) {
+	if(count <= vertexCapacity)
+		return;
+	while(vertexCapacity < count) {
+		vertexCapacity = vertexCapacity > 0 ? vertexCapacity * 2 : 1024;
+	}
+	vertexArray->arrayPtr = realloc(vertexArray->arrayPtr, sizeof(float) * 3 * vertexCapacity);
+	colorArray->arrayPtr = realloc(colorArray->arrayPtr, sizeof(float) * 4 * vertexCapacity);
+	texCoordArray->arrayPtr = realloc(texCoordArray->arrayPtr, sizeof(float) * 2 * vertexCapacity);
+}
+
+void ScreenSpriteBatcher::applyScissor() {
+	if(scissorEnabled != rendererScissorEnabled) {
+		renderer->enableScissor(scissorEnabled);
+		rendererScissorEnabled = scissorEnabled;
+	}
+	if(scissorEnabled && (scissorBox.x != rendererScissorBox.x || scissorBox.y != rendererScissorBox.y || scissorBox.w != rendererScissorBox.w || scissorBox.h != rendererScissorBox.h)) {
+		renderer->setScissorBox(scissorBox);
+		rendererScissorBox = scissorBox;
+	}
+}
+
+void ScreenSpriteBatcher::flush() {
+	if(numVertices == 0)
+		return;
+
+	POLY_PROFILE_ZONE("ScreenSpriteBatcher::flush");
+
+	// the scissor state of the batch, not the one set since, which belongs to the next batch
+	bool nextScissorEnabled = scissorEnabled;
+	Polycode::Rectangle nextScissorBox = scissorBox;
+	scissorEnabled = batchScissorEnabled;
+	scissorBox = batchScissorBox;
+	applyScissor();
+	scissorEnabled = nextScissorEnabled;
+	scissorBox = nextScissorBox;
+
+	renderer->setTexture(batchTexture);
+	renderer->setBlendingMode(batchBlendingMode);
+	renderer->enableDepthTest(batchDepthTest);
+	renderer->enableDepthWrite(batchDepthWrite);
+	renderer->enableAlphaTest(batchAlphaTest);
+	renderer->enableBackfaceCulling(batchBackfaceCulled);
+
+	vertexArray->count = numVertices;
+	colorArray->count = numVertices;
+	texCoordArray->count = numVertices;
+	renderer->pushRenderDataArray(colorArray);
+	renderer->pushRenderDataArray(vertexArray);
+	renderer->pushRenderDataArray(texCoordArray);
+	renderer->drawArrays(Mesh::TRI_MESH);
+	renderer->recordSpriteBatch(numBatchedMeshes);
+
+	numBatches++;
+	numVertices = 0;
+	numBatchedMeshes = 0;
+}
+
+void ScreenSpriteBatcher::renderEntity(Entity *entity) {
+	flush();
+	applyScissor();
+
+	renderer->pushMatrix();
+	renderer->multModelviewMatrix(matrix);
+	entity->transformAndRender();
+	renderer->popMatrix();
+
+	// the renderer's scissor state is what the entity restored it to, not necessarily what was applied last
+	rendererScissorEnabled = renderer->isScissorEnabled();
+	rendererScissorBox = renderer->getScissorBox();
+}
@@ -24,11 +24,18 @@
 #include "PolyBezierCurve.h"
 #include "PolyBone.h"
 #include "PolyLabel.h"
+#include "PolyLogger.h"
 #include "PolySceneLabel.h"
 #include "PolySceneLine.h"
-#include "PolyTween.h"
+#include "PolyQuaternionCurve.h"
+#include "PolyCoreServices.h"
+#include "PolyCore.h"
 #include "OSBasics.h"
+#include <math.h>
+#include <algorithm>
 
+using std::min;
+using std::max;
 using namespace Polycode;
 
 Skeleton::Skeleton(const String& fileName) : SceneEntity() {
@@ -73,7 +80,7 @@ void Skeleton::enableBoneLabels(const String& labelFont, Number size, Number sca
 }
 
 void Skeleton::playAnimationByIndex(int index, bool once) {
-	if(index > animations.size()-1)
+	if(index < 0 || index >= animations.size())
 		return;
 		
 	SkeletonAnimation *anim = animations[index];
@@ -83,11 +90,12 @@ void Skeleton::playAnimationByIndex(int index, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
-		currentAnimation->Stop();
+	for(int i=0; i < playingAnimations.size(); i++) {
+		playingAnimations[i]->Stop();
+	}
+	playingAnimations.clear();
 	
-	currentAnimation = anim;
-	anim->Play(once);	
+	startAnimation(anim, 1.0, 0.0, once);
 }
 
 void Skeleton::playAnimation(const String& animName, bool once) {
@@ -98,11 +106,69 @@ void Skeleton::playAnimation(const String& animName, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
-		currentAnimation->Stop();
-		
+	for(int i=0; i < playingAnimations.size(); i++) {
+		playingAnimations[i]->Stop();
+	}
+	playingAnimations.clear();
+	
+	startAnimation(anim, 1.0, 0.0, once);
+}
+
+void Skeleton::crossFadeAnimation(const String& animName, Number fadeTime, bool once) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	
+	for(int i=0; i < playingAnimations.size(); i++) {
+		if(playingAnimations[i] != anim)
+			playingAnimations[i]->fadeToWeight(0.0, fadeTime);
+	}
+	
+	startAnimation(anim, 1.0, fadeTime, once);
+}
+
+void Skeleton::blendAnimation(const String& animName, Number weight, Number fadeTime, bool once) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	startAnimation(anim, weight, fadeTime, once);
+}
+
+void Skeleton::stopAnimation(const String& animName, Number fadeTime) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	
+	if(fadeTime > 0.0) {
+		anim->fadeToWeight(0.0, fadeTime);
+		return;
+	}
+	
+	anim->Stop();
+	for(int i=0; i < playingAnimations.size(); i++) {
+		if(playingAnimations[i] == anim) {
+			playingAnimations.erase(playingAnimations.begin()+i);
+			break;
+		}
+	}
+	if(currentAnimation == anim)
+		currentAnimation = NULL;
+}
+
+void Skeleton::startAnimation(SkeletonAnimation *anim, Number weight, Number fadeTime, bool once) {
+	bool alreadyPlaying = false;
+	for(int i=0; i < playingAnimations.size(); i++) {
+		if(playingAnimations[i] == anim)
+			alreadyPlaying = true;
+	}
+	
+	if(!alreadyPlaying) {
+		anim->Play(once);
+		anim->fadeToWeight(0.0, 0.0);
+		playingAnimations.push_back(anim);
+	}
+	anim->fadeToWeight(weight, fadeTime);
 	currentAnimation = anim;
-	anim->Play(once);
 }
 
 SkeletonAnimation *Skeleton::getAnimation(const String& name) const {
@@ -113,15 +179,72 @@ SkeletonAnimation *Skeleton::getAnimation(const String& name) const {
 	return NULL;
 }
 
+int Skeleton::getBoneIndex(Bone *bone) const {
+	for(int i=0; i < bones.size(); i++) {
+		if(bones[i] == bone)
+			return i;
+	}
+	return -1;
+}
+
 void Skeleton::Update() {
+	if(playingAnimations.size() == 0)
+		return;
+	
+	Number elapsed = CoreServices::getInstance()->getCore()->getElapsed();
+	
+	blendedPose.clearForBlending();
+	Number totalWeight = 0.0;
+	
+	for(int i=0; i < playingAnimations.size(); i++) {
+		SkeletonAnimation *anim = playingAnimations[i];
+		anim->Update(elapsed);
+		if(!anim->isPlaying()) {
+			playingAnimations.erase(playingAnimations.begin()+i);
+			if(currentAnimation == anim)
+				currentAnimation = NULL;
+			i--;
+			continue;
+		}
+		
+		Number weight = anim->getWeight();
+		if(weight <= 0.0)
+			continue;
+		
+		anim->samplePose(anim->getTime(), &animationPose);
+		blendedPose.addWeightedPose(animationPose, weight);
+		totalWeight += weight;
+	}
+	
+	if(totalWeight < 1.0) {
+		blendedPose.addWeightedPose(bindPose, 1.0 - totalWeight);
+	}
+	blendedPose.normalizeBlend();
+	
+	applyPose(blendedPose);
+}
 
-	if(currentAnimation != NULL) {
-		currentAnimation->Update();
+void Skeleton::applyPose(const SkeletonPose &pose) {
+	if(pose.getNumBones() != bones.size())
+		return;
+	
+	for(int i=0; i < boneEvaluationOrder.size(); i++) {
+		int index = boneEvaluationOrder[i];
+		Bone *bone = bones[index];
+		
+		Matrix4 localMatrix = pose.getBoneMatrix(index);
+		bone->setBoneMatrix(localMatrix);
+		bone->setTransformByMatrixPure(localMatrix);
+		
+		if(bone->parentBoneId != -1)
+			boneModelMatrices[index] = localMatrix * boneModelMatrices[bone->parentBoneId];
+		else
+			boneModelMatrices[index] = localMatrix;
 	}
 }
 
 void Skeleton::loadSkeleton(const String& fileName) {
-	OSFILE *inFile = OSBasics::open(fileName.c_str(), "rb");
+	OSFILE *inFile = OSBasics::openMapped(fileName);
 	if(!inFile) {
 		return;
 	}
@@ -130,34 +253,43 @@ void Skeleton::loadSkeleton(const String& fileName) {
 	bonesEntity->visible = false;
 	addChild(bonesEntity);
 	
-	unsigned int numBones;
-	float t[3],rq[4],s[3];
+	// mapped files are parsed straight out of the mapping
+	const char *data = OSBasics::readInPlace(inFile, sizeof(unsigned int));
+	unsigned int numBones = data ? *(const unsigned int*)data : 0;
 	
-	OSBasics::read(&numBones, sizeof(unsigned int), 1, inFile);
-	unsigned int namelen;
-	char buffer[1024];
+	bindPose.setNumBones(numBones);
 	
-	Matrix4 mat;
-	unsigned int hasParent, boneID;
-	for(int i=0; i < numBones; i++) {
+	for(unsigned int i=0; i < numBones; i++) {
 		
-		OSBasics::read(&namelen, sizeof(unsigned int), 1, inFile);
-		memset(buffer, 0, 1024);
-		OSBasics::read(buffer, 1, namelen, inFile);
+		data = OSBasics::readInPlace(inFile, sizeof(unsigned int));
+		if(!data)
+			break;
+		unsigned int namelen = *(const unsigned int*)data;
+		data = OSBasics::readInPlace(inFile, namelen + sizeof(unsigned int));
+		if(!data)
+			break;
 		
-		Bone *newBone = new Bone(String(buffer));
+		String boneName;
+		boneName.contents.assign(data, strnlen(data, namelen));
+		Bone *newBone = new Bone(boneName);
 		
-		OSBasics::read(&hasParent, sizeof(unsigned int), 1, inFile);
+		unsigned int hasParent = *(const unsigned int*)(data + namelen);
 		if(hasParent == 1) {
-			OSBasics::read(&boneID, sizeof(unsigned int), 1, inFile);
-			newBone->parentBoneId = boneID;
+			data = OSBasics::readInPlace(inFile, sizeof(unsigned int));
+			newBone->parentBoneId = data ? *(const unsigned int*)data : -1;
 		} else {
 			newBone->parentBoneId = -1;
 		}
-
-		OSBasics::read(t, sizeof(float), 3, inFile);
-		OSBasics::read(s, sizeof(float), 3, inFile);
-		OSBasics::read(rq, sizeof(float), 4, inFile);
+		
+		// translation, scale and rotation of the bind pose, then of the rest pose
+		data = OSBasics::readInPlace(inFile, sizeof(float) * 20);
+		if(!data) {
+			delete newBone;
+			break;
+		}
+		const float *t = (const float*)data;
+		const float *s = t + 3;
+		const float *rq = t + 6;
 		
 		bones.push_back(newBone);
 		
@@ -168,10 +300,11 @@ void Skeleton::loadSkeleton(const String& fileName) {
 		
 		newBone->setBaseMatrix(newBone->getTransformMatrix());
 		newBone->setBoneMatrix(newBone->getTransformMatrix());
+		
+		bindPose.setBoneTransform(i, Vector3(t[0], t[1], t[2]), Quaternion(rq[0], rq[1], rq[2], rq[3]), Vector3(s[0], s[1], s[2]));
 
-		OSBasics::read(t, sizeof(float), 3, inFile);
-		OSBasics::read(s, sizeof(float), 3, inFile);
-		OSBasics::read(rq, sizeof(float), 4, inFile);
+		t += 10;
+		rq = t + 6;
 		
 		Quaternion q;
 		q.set(rq[0], rq[1], rq[2], rq[3]);
@@ -182,6 +315,17 @@ void Skeleton::loadSkeleton(const String& fileName) {
 		
 	}
 
+	// a truncated file leaves the bind pose and parent indices pointing past the bones that were read
+	if(bones.size() != numBones) {
+		Logger::log("Error loading skeleton %s: file is truncated\n", fileName.c_str());
+		for(int i=0; i < bones.size(); i++)
+			delete bones[i];
+		bones.clear();
+		bindPose.setNumBones(0);
+		OSBasics::close(inFile);
+		return;
+	}
+	
 	Bone *parentBone;
 //	SceneEntity *bProxy;
 	
@@ -205,6 +349,27 @@ void Skeleton::loadSkeleton(const String& fileName) {
 		}
 	//	bones[i]->visible = false;			
 	}
+	
+	// parents are evaluated before their children in the pose pass
+	std::vector<bool> boneAdded(bones.size(), false);
+	boneEvaluationOrder.clear();
+	while(boneEvaluationOrder.size() < bones.size()) {
+		int numAdded = boneEvaluationOrder.size();
+		for(int i=0; i < bones.size(); i++) {
+			if(boneAdded[i])
+				continue;
+			if(bones[i]->parentBoneId == -1 || boneAdded[bones[i]->parentBoneId]) {
+				boneEvaluationOrder.push_back(i);
+				boneAdded[i] = true;
+			}
+		}
+		if(numAdded == boneEvaluationOrder.size())
+			break;
+	}
+	boneModelMatrices.resize(bones.size());
+	// the poses Update() blends into have to match the skeleton, or applyPose() skips them
+	animationPose.setNumBones(bones.size());
+	blendedPose.setNumBones(bones.size());
 	/*
 	unsigned int numAnimations, activeBones,boneIndex,numPoints,numCurves, curveType;
 	OSBasics::read(&numAnimations, sizeof(unsigned int), 1, inFile);
@@ -281,35 +446,45 @@ void Skeleton::loadSkeleton(const String& fileName) {
 }
 
 void Skeleton::addAnimation(const String& name, const String& fileName) {
-	OSFILE *inFile = OSBasics::open(fileName.c_str(), "rb");
+	OSFILE *inFile = OSBasics::openMapped(fileName);
 	if(!inFile) {
 		return;
 	}
 	
-		unsigned int activeBones,boneIndex,numPoints,numCurves, curveType;	
-		float length;
-		OSBasics::read(&length, 1, sizeof(float), inFile);
+		// mapped files are parsed straight out of the mapping
+		const char *data = OSBasics::readInPlace(inFile, sizeof(float) + sizeof(unsigned int));
+		if(!data) {
+			OSBasics::close(inFile);
+			return;
+		}
+		float length = *(const float*)data;
+		unsigned int activeBones = *(const unsigned int*)(data + sizeof(float));
 		SkeletonAnimation *newAnimation = new SkeletonAnimation(name, length);
 		
-		OSBasics::read(&activeBones, sizeof(unsigned int), 1, inFile);
-		
 		//	Logger::log("activeBones: %d\n", activeBones);		
 		for(int j=0; j < activeBones; j++) {
-			OSBasics::read(&boneIndex, sizeof(unsigned int), 1, inFile);
+			data = OSBasics::readInPlace(inFile, sizeof(unsigned int) * 2);
+			if(!data || *(const unsigned int*)data >= bones.size())
+				break;
+			unsigned int boneIndex = *(const unsigned int*)data;
+			unsigned int numCurves = *(const unsigned int*)(data + sizeof(unsigned int));
 			BoneTrack *newTrack = new BoneTrack(bones[boneIndex], length);
 			
 			BezierCurve *curve;
-			float vec1[2]; //,vec2[2],vec3[2];
 			
-			OSBasics::read(&numCurves, sizeof(unsigned int), 1, inFile);
 			//			Logger::log("numCurves: %d\n", numCurves);					
 			for(int l=0; l < numCurves; l++) {
+				data = OSBasics::readInPlace(inFile, sizeof(unsigned int) * 2);
+				if(!data)
+					break;
+				unsigned int curveType = *(const unsigned int*)data;
+				unsigned int numPoints = *(const unsigned int*)(data + sizeof(unsigned int));
+				const float *points = (const float*)OSBasics::readInPlace(inFile, numPoints * sizeof(float) * 2);
+				if(!points)
+					break;
 				curve = new BezierCurve();
-				OSBasics::read(&curveType, sizeof(unsigned int), 1, inFile);
-				OSBasics::read(&numPoints, sizeof(unsigned int), 1, inFile);
 				for(int k=0; k < numPoints; k++) {					
-					OSBasics::read(vec1, sizeof(float), 2, inFile);					
-					curve->addControlPoint2d(vec1[1], vec1[0]);
+					curve->addControlPoint2d(points[(k*2)+1], points[k*2]);
 					//					curve->addControlPoint(vec1[1]-10, vec1[0], 0, vec1[1], vec1[0], 0, vec1[1]+10, vec1[0], 0);
 				}
 				switch(curveType) {
@@ -348,6 +523,7 @@ void Skeleton::addAnimation(const String& name, const String& fileName) {
 			
 			newAnimation->addBoneTrack(newTrack);
 		}
+		newAnimation->bake(this);
 		animations.push_back(newAnimation);
 	
 	
@@ -371,7 +547,6 @@ BoneTrack::BoneTrack(Bone *bone, Number length) {
 	LocX = NULL;			
 	LocY = NULL;
 	LocZ = NULL;
-	initialized = false;
 }
 
 BoneTrack::~BoneTrack() {
@@ -387,161 +562,373 @@ BoneTrack::~BoneTrack() {
 	delete LocZ;
 }
 
+SkeletonPose::SkeletonPose() {
+	numBones = 0;
+	blendWeight = 0.0;
+}
+
+SkeletonPose::~SkeletonPose() {
+
+}
+
+void SkeletonPose::setNumBones(unsigned int numBones) {
+	this->numBones = numBones;
+	rotationX.assign(numBones, 0.0f);
+	rotationY.assign(numBones, 0.0f);
+	rotationZ.assign(numBones, 0.0f);
+	rotationW.assign(numBones, 1.0f);
+	positionX.assign(numBones, 0.0f);
+	positionY.assign(numBones, 0.0f);
+	positionZ.assign(numBones, 0.0f);
+	scaleX.assign(numBones, 1.0f);
+	scaleY.assign(numBones, 1.0f);
+	scaleZ.assign(numBones, 1.0f);
+}
 
-void BoneTrack::Stop() {
-	if(initialized) {
-		for(int i=0; i < pathTweens.size(); i++) {
-			pathTweens[i]->Pause(true);
-		}	
-		quatTween->Pause(true);		
+unsigned int SkeletonPose::getNumBones() const {
+	return numBones;
+}
+
+void SkeletonPose::setBoneTransform(unsigned int index, const Vector3 &position, const Quaternion &rotation, const Vector3 &scale) {
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	rotationW[index] = rotation.w;
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+}
+
+Matrix4 SkeletonPose::getBoneMatrix(unsigned int index) const {
+	Quaternion q(rotationW[index], rotationX[index], rotationY[index], rotationZ[index]);
+	Matrix4 m = q.createMatrix();
+	
+	Number s[3] = {scaleX[index], scaleY[index], scaleZ[index]};
+	for(int i=0; i < 3; i++) {
+		m.m[i][0] *= s[i];
+		m.m[i][1] *= s[i];
+		m.m[i][2] *= s[i];
 	}
+	
+	m.m[3][0] = positionX[index];
+	m.m[3][1] = positionY[index];
+	m.m[3][2] = positionZ[index];
+	return m;
 }
 
-void BoneTrack::Play(bool once) {
+void SkeletonPose::clearForBlending() {
+	std::fill(rotationX.begin(), rotationX.end(), 0.0f);
+	std::fill(rotationY.begin(), rotationY.end(), 0.0f);
+	std::fill(rotationZ.begin(), rotationZ.end(), 0.0f);
+	std::fill(rotationW.begin(), rotationW.end(), 0.0f);
+	std::fill(positionX.begin(), positionX.end(), 0.0f);
+	std::fill(positionY.begin(), positionY.end(), 0.0f);
+	std::fill(positionZ.begin(), positionZ.end(), 0.0f);
+	std::fill(scaleX.begin(), scaleX.end(), 0.0f);
+	std::fill(scaleY.begin(), scaleY.end(), 0.0f);
+	std::fill(scaleZ.begin(), scaleZ.end(), 0.0f);
+	blendWeight = 0.0;
+}
 
-	if(!initialized ) {
-	// TODO: change it so that you can set the tweens to not manually restart so you can calculate the
-	// time per tween
+void SkeletonPose::addWeightedPose(const SkeletonPose &pose, Number weight) {
+	if(pose.numBones != numBones || numBones == 0)
+		return;
 	
-		Number durTime = length; //(LocX->getControlPoint(LocX->getNumControlPoints()-1)->p2.x);//25.0f;
-					
-	BezierPathTween *testTween;		
-	if(LocX) {
-		testTween = new BezierPathTween(&LocXVec, LocX, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
+	float w = weight;
+	for(unsigned int i=0; i < numBones; i++) {
+		float dot = rotationX[i]*pose.rotationX[i] + rotationY[i]*pose.rotationY[i] + rotationZ[i]*pose.rotationZ[i] + rotationW[i]*pose.rotationW[i];
+		float rw = dot < 0.0f ? -w : w;
+		rotationX[i] += pose.rotationX[i] * rw;
+		rotationY[i] += pose.rotationY[i] * rw;
+		rotationZ[i] += pose.rotationZ[i] * rw;
+		rotationW[i] += pose.rotationW[i] * rw;
 	}
-	if(LocY) {		
-		testTween = new BezierPathTween(&LocYVec, LocY, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
+	for(unsigned int i=0; i < numBones; i++) {
+		positionX[i] += pose.positionX[i] * w;
+		positionY[i] += pose.positionY[i] * w;
+		positionZ[i] += pose.positionZ[i] * w;
+		scaleX[i] += pose.scaleX[i] * w;
+		scaleY[i] += pose.scaleY[i] * w;
+		scaleZ[i] += pose.scaleZ[i] * w;
 	}
-		
-	if(LocZ) {
-		testTween = new BezierPathTween(&LocZVec, LocZ, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
-	}
-	testTween = new BezierPathTween(&ScaleXVec, scaleX, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-	testTween = new BezierPathTween(&ScaleYVec, scaleY, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-	testTween = new BezierPathTween(&ScaleZVec, scaleZ, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-		
-		
-	if(QuatW)
-		quatTween = new QuaternionTween(&boneQuat, QuatW, QuatX, QuatY, QuatZ, Tween::EASE_NONE, durTime, !once);
+	blendWeight += weight;
+}
 
-	initialized = true;
-	} else {
-		for(int i=0; i < pathTweens.size(); i++) {
-			pathTweens[i]->Reset();
-			pathTweens[i]->Pause(false);
-		}	
-		quatTween->Reset();
-		quatTween->Pause(false);
+void SkeletonPose::normalizeBlend() {
+	if(blendWeight <= 0.0) {
+		setNumBones(numBones);
+		return;
 	}
-/*
-	if(QuatW) {
-		testTween = new BezierPathTween(&QuatWVec, QuatW, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	
+	for(unsigned int i=0; i < numBones; i++) {
+		float len = sqrtf(rotationX[i]*rotationX[i] + rotationY[i]*rotationY[i] + rotationZ[i]*rotationZ[i] + rotationW[i]*rotationW[i]);
+		if(len > 0.0f) {
+			float inv = 1.0f / len;
+			rotationX[i] *= inv;
+			rotationY[i] *= inv;
+			rotationZ[i] *= inv;
+			rotationW[i] *= inv;
+		} else {
+			rotationW[i] = 1.0f;
+		}
 	}
 	
-	if(QuatX) {
-		testTween = new BezierPathTween(&QuatXVec, QuatX, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	float inv = 1.0f / blendWeight;
+	for(unsigned int i=0; i < numBones; i++) {
+		positionX[i] *= inv;
+		positionY[i] *= inv;
+		positionZ[i] *= inv;
+		scaleX[i] *= inv;
+		scaleY[i] *= inv;
+		scaleZ[i] *= inv;
 	}
+	blendWeight = 1.0;
+}
+
+static short quantizeQuaternionComponent(Number value) {
+	Number q = floor(value * 32767.0 + 0.5);
+	if(q > 32767.0)
+		q = 32767.0;
+	if(q < -32767.0)
+		q = -32767.0;
+	return (short)q;
+}
+
+SkeletonAnimation::SkeletonAnimation(const String& name, Number duration) {
+	this->name = name;
+	this->duration = duration;
+	time = 0.0;
+	speed = 1.0;
+	weight = 0.0;
+	targetWeight = 0.0;
+	fadeRate = 0.0;
+	playing = false;
+	playOnce = false;
+	frameRate = DEFAULT_FRAME_RATE;
+	numFrames = 0;
+	numBones = 0;
+}
+
+void SkeletonAnimation::bake(Skeleton *skeleton, Number frameRate) {
+	const SkeletonPose &bindPose = skeleton->getBindPose();
+	
+	this->frameRate = frameRate;
+	numBones = bindPose.getNumBones();
+	numFrames = 2;
+	if(duration > 0.0 && frameRate > 0.0)
+		numFrames = (unsigned int)ceil(duration * frameRate) + 1;
 	
-	if(QuatY) {
-		testTween = new BezierPathTween(&QuatYVec, QuatY, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	unsigned int numKeys = numFrames * numBones;
+	keyRotationX.resize(numKeys);
+	keyRotationY.resize(numKeys);
+	keyRotationZ.resize(numKeys);
+	keyRotationW.resize(numKeys);
+	keyPositionX.resize(numKeys);
+	keyPositionY.resize(numKeys);
+	keyPositionZ.resize(numKeys);
+	keyScaleX.resize(numKeys);
+	keyScaleY.resize(numKeys);
+	keyScaleZ.resize(numKeys);
+	
+	for(unsigned int f=0; f < numFrames; f++) {
+		for(unsigned int b=0; b < numBones; b++) {
+			unsigned int key = (f * numBones) + b;
+			keyRotationX[key] = quantizeQuaternionComponent(bindPose.rotationX[b]);
+			keyRotationY[key] = quantizeQuaternionComponent(bindPose.rotationY[b]);
+			keyRotationZ[key] = quantizeQuaternionComponent(bindPose.rotationZ[b]);
+			keyRotationW[key] = quantizeQuaternionComponent(bindPose.rotationW[b]);
+			keyPositionX[key] = bindPose.positionX[b];
+			keyPositionY[key] = bindPose.positionY[b];
+			keyPositionZ[key] = bindPose.positionZ[b];
+			keyScaleX[key] = bindPose.scaleX[b];
+			keyScaleY[key] = bindPose.scaleY[b];
+			keyScaleZ[key] = bindPose.scaleZ[b];
+		}
 	}
 	
-	if(QuatZ) {
-		testTween = new BezierPathTween(&QuatZVec, QuatZ, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	for(int i=0; i < boneTracks.size(); i++) {
+		BoneTrack *track = boneTracks[i];
+		int boneIndex = skeleton->getBoneIndex(track->getTargetBone());
+		if(boneIndex < 0)
+			continue;
+		
+		QuaternionCurve *quatCurve = NULL;
+		if(track->QuatW && track->QuatX && track->QuatY && track->QuatZ && track->QuatW->getNumControlPoints() > 0)
+			quatCurve = new QuaternionCurve(track->QuatW, track->QuatX, track->QuatY, track->QuatZ);
+		
+		Quaternion lastQuat;
+		for(unsigned int f=0; f < numFrames; f++) {
+			unsigned int key = (f * numBones) + boneIndex;
+			
+			Number t = 0.0;
+			if(duration > 0.0)
+				t = min((Number)f / frameRate, duration) / duration;
+			
+			if(quatCurve) {
+				// the quaternion curve cannot be evaluated at exactly the end of the last segment
+				Quaternion q = quatCurve->interpolate(min(t, 0.99999), true);
+				q.normalize();
+				if(f > 0 && lastQuat.Dot(q) < 0.0)
+					q = q * -1.0;
+				lastQuat = q;
+				keyRotationX[key] = quantizeQuaternionComponent(q.x);
+				keyRotationY[key] = quantizeQuaternionComponent(q.y);
+				keyRotationZ[key] = quantizeQuaternionComponent(q.z);
+				keyRotationW[key] = quantizeQuaternionComponent(q.w);
+			}
+			
+			if(track->LocX)
+				keyPositionX[key] = track->LocX->getPointAt(t).y;
+			if(track->LocY)
+				keyPositionY[key] = track->LocY->getPointAt(t).y;
+			if(track->LocZ)
+				keyPositionZ[key] = track->LocZ->getPointAt(t).y;
+			// animated bones have always been posed unscaled, the scale curves are not applied
+			keyScaleX[key] = 1.0;
+			keyScaleY[key] = 1.0;
+			keyScaleZ[key] = 1.0;
+		}
+		
+		delete quatCurve;
 	}
-*/
 }
 
-
-void BoneTrack::Update() {
-
-	if(!targetBone)
+void SkeletonAnimation::samplePose(Number time, SkeletonPose *pose) const {
+	if(pose->getNumBones() != numBones)
+		pose->setNumBones(numBones);
+	if(numBones == 0 || numFrames < 2)
 		return;
-
-	Matrix4 newMatrix;
-	newMatrix = boneQuat.createMatrix();
-
 	
-	Matrix4 scaleMatrix;
-	scaleMatrix.m[0][0] *= 1; //ScaleXVec.y;
-	scaleMatrix.m[1][1] *= 1; //ScaleYVec.y;
-	scaleMatrix.m[2][2] *= 1; //ScaleZVec.y;
+	Number frame = time * frameRate;
+	if(frame < 0.0)
+		frame = 0.0;
+	unsigned int f0 = (unsigned int)frame;
+	if(f0 > numFrames - 2)
+		f0 = numFrames - 2;
+	float alpha = frame - f0;
+	if(alpha > 1.0f)
+		alpha = 1.0f;
 	
-
-	Matrix4 posMatrix;
-
-	if(LocX)
-		posMatrix.m[3][0] = LocXVec.y;		
-	else
-		posMatrix.m[3][0] = targetBone->getBaseMatrix()[3][0];
-
-	if(LocY)
-		posMatrix.m[3][1] = LocYVec.y;		
-	else
-		posMatrix.m[3][1] = targetBone->getBaseMatrix()[3][1];
+	unsigned int k0 = f0 * numBones;
+	unsigned int k1 = k0 + numBones;
 	
-	if(LocZ)
-		posMatrix.m[3][2] = LocZVec.y;		
-	else
-		posMatrix.m[3][2] = targetBone->getBaseMatrix()[3][2];
+	const short *rx0 = &keyRotationX[k0], *rx1 = &keyRotationX[k1];
+	const short *ry0 = &keyRotationY[k0], *ry1 = &keyRotationY[k1];
+	const short *rz0 = &keyRotationZ[k0], *rz1 = &keyRotationZ[k1];
+	const short *rw0 = &keyRotationW[k0], *rw1 = &keyRotationW[k1];
+	float *outRX = &pose->rotationX[0];
+	float *outRY = &pose->rotationY[0];
+	float *outRZ = &pose->rotationZ[0];
+	float *outRW = &pose->rotationW[0];
 	
+	// keys are baked along the shortest path, so a normalized lerp is enough and the quantization scale cancels out
+	for(unsigned int b=0; b < numBones; b++) {
+		float x = rx0[b] + (rx1[b] - rx0[b]) * alpha;
+		float y = ry0[b] + (ry1[b] - ry0[b]) * alpha;
+		float z = rz0[b] + (rz1[b] - rz0[b]) * alpha;
+		float w = rw0[b] + (rw1[b] - rw0[b]) * alpha;
+		float len = sqrtf(x*x + y*y + z*z + w*w);
+		float inv = len > 0.0f ? 1.0f / len : 0.0f;
+		outRX[b] = x * inv;
+		outRY[b] = y * inv;
+		outRZ[b] = z * inv;
+		outRW[b] = len > 0.0f ? w * inv : 1.0f;
+	}
 	
-	newMatrix = scaleMatrix*newMatrix*posMatrix;	
+	const float *px0 = &keyPositionX[k0], *px1 = &keyPositionX[k1];
+	const float *py0 = &keyPositionY[k0], *py1 = &keyPositionY[k1];
+	const float *pz0 = &keyPositionZ[k0], *pz1 = &keyPositionZ[k1];
+	const float *sx0 = &keyScaleX[k0], *sx1 = &keyScaleX[k1];
+	const float *sy0 = &keyScaleY[k0], *sy1 = &keyScaleY[k1];
+	const float *sz0 = &keyScaleZ[k0], *sz1 = &keyScaleZ[k1];
+	float *outPX = &pose->positionX[0];
+	float *outPY = &pose->positionY[0];
+	float *outPZ = &pose->positionZ[0];
+	float *outSX = &pose->scaleX[0];
+	float *outSY = &pose->scaleY[0];
+	float *outSZ = &pose->scaleZ[0];
 	
-	targetBone->setBoneMatrix(newMatrix);
-	targetBone->setTransformByMatrixPure(newMatrix);		
+	for(unsigned int b=0; b < numBones; b++) {
+		outPX[b] = px0[b] + (px1[b] - px0[b]) * alpha;
+		outPY[b] = py0[b] + (py1[b] - py0[b]) * alpha;
+		outPZ[b] = pz0[b] + (pz1[b] - pz0[b]) * alpha;
+		outSX[b] = sx0[b] + (sx1[b] - sx0[b]) * alpha;
+		outSY[b] = sy0[b] + (sy1[b] - sy0[b]) * alpha;
+		outSZ[b] = sz0[b] + (sz1[b] - sz0[b]) * alpha;
+	}
+}
 
+void SkeletonAnimation::setSpeed(Number speed) {
+	this->speed = speed;
 }
 
-void BoneTrack::setSpeed(Number speed) {
-	for(int i=0; i < pathTweens.size(); i++) {
-		pathTweens[i]->setSpeed(speed);
-	}	
-	quatTween->setSpeed(speed);
+void SkeletonAnimation::fadeToWeight(Number weight, Number fadeTime) {
+	targetWeight = weight;
+	if(fadeTime <= 0.0) {
+		this->weight = weight;
+		fadeRate = 0.0;
+	} else {
+		fadeRate = fabs(targetWeight - this->weight) / fadeTime;
+	}
 }
 
+Number SkeletonAnimation::getWeight() const {
+	return weight;
+}
 
-SkeletonAnimation::SkeletonAnimation(const String& name, Number duration) {
-	this->name = name;
-	this->duration = duration;
+bool SkeletonAnimation::isPlaying() const {
+	return playing;
 }
 
-void SkeletonAnimation::setSpeed(Number speed) {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->setSpeed(speed);
-	}	
+Number SkeletonAnimation::getTime() const {
+	return time;
 }
 
-void SkeletonAnimation::Update() {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Update();
+Number SkeletonAnimation::getDuration() const {
+	return duration;
+}
+
+void SkeletonAnimation::Update(Number elapsed) {
+	if(!playing)
+		return;
+	
+	time += elapsed * speed;
+	if(time > duration) {
+		if(playOnce || duration <= 0.0)
+			time = duration;
+		else
+			time = fmod(time, duration);
 	}
+	
+	if(weight < targetWeight) {
+		weight = min(weight + fadeRate * elapsed, targetWeight);
+	} else if(weight > targetWeight) {
+		weight = max(weight - fadeRate * elapsed, targetWeight);
+	}
+	
+	if(weight <= 0.0 && targetWeight <= 0.0)
+		playing = false;
 }
 
 void SkeletonAnimation::Stop() {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Stop();
-	}
+	playing = false;
+	weight = 0.0;
+	targetWeight = 0.0;
 }
 
 void SkeletonAnimation::Play(bool once) {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Play(once);
-	}
+	time = 0.0;
+	playOnce = once;
+	playing = true;
 }
 
 SkeletonAnimation::~SkeletonAnimation() {
-
+	for(int i=0; i < boneTracks.size(); i++) {
+		delete boneTracks[i];
+	}
 }
 
 const String& SkeletonAnimation::getName() const {
@@ -21,6 +21,9 @@
 */
 
 #include "PolySound.h"
+#include "PolySoundStream.h"
+#include "PolySoundManager.h"
+#include "PolyCoreServices.h"
 #include <vorbis/vorbisfile.h>
 #include "PolyString.h"
 #include "PolyLogger.h"
@@ -28,6 +31,8 @@
 #include "OSBasics.h"
 #include <string>
 #include <vector>
+#include <stdlib.h>
+#include <math.h>
 
 using namespace std;
 using namespace Polycode;
@@ -52,30 +57,94 @@ long custom_tellfunc(void *datasource) {
 	return OSBasics::tell(file);
 }
 
-Sound::Sound(const String& fileName) : sampleLength(-1) {
+static SoundStreamer *getSoundStreamer() {
+	return CoreServices::getInstance()->getSoundManager()->getSoundStreamer();
+}
+
+Sound::Sound(const String& fileName, bool streaming) : sampleLength(-1) {
 	soundLoaded = false;		
+	this->streaming = streaming;
+	initProperties();
 	loadFile(fileName);
-	setIsPositional(false);
-	
-	setVolume(1.0);
-	setPitch(1.0);
 }
 
 Sound::Sound(const char *data, int size, int channels, int freq, int bps) : sampleLength(-1) {
-	ALuint buffer = loadBytes(data, size, freq, channels, bps);
-	
-	soundSource = GenSource(buffer);
-	setIsPositional(false);
+	soundLoaded = false;
+	streaming = false;
+	initProperties();
+	soundBuffer = loadBytes(data, size, freq, channels, bps);
+	updateBufferInfo();
+	soundManager = CoreServices::getInstance()->getSoundManager();
+	soundManager->registerSound(this);
 	soundLoaded = true;
-		
-	setVolume(1.0);
-	setPitch(1.0);
+}
+
+void Sound::initProperties() {
+	soundSource = 0;
+	soundBuffer = AL_NONE;
+	soundManager = NULL;
+	soundFrequency = 44100;
+	soundDuration = 0;
+	
+	volume = 1.0;
+	pitch = 1.0;
+	referenceDistance = 1.0;
+	maxDistance = 10000.0;
+	isPositional = false;
+	looping = false;
+	playing = false;
+	virtualTime = 0;
+	priority = 0;
+	positionDirty = false;
+	
+	streamDecoder = NULL;
+	streamData = NULL;
+	streamActive = false;
+	streamLooping = false;
+	streamQueueStart = 0;
+	streamPosition = 0;
+}
+
+void Sound::unload() {
+	if(soundManager) {
+		soundManager->unregisterSound(this);
+	}
+	releaseStream();
+	if(soundSource && !soundBuffer) {
+		// only streaming sounds own their source, pooled ones have returned it by now
+		alDeleteSources(1,&soundSource);
+	}
+	soundSource = 0;
+	if(soundBuffer) {
+		alDeleteBuffers(1, &soundBuffer);
+		soundBuffer = AL_NONE;
+	}
+	playing = false;
+	virtualTime = 0;
+	soundLoaded = false;
+}
+
+void Sound::updateBufferInfo() {
+	ALint sizeInBytes = 0;
+	ALint channels = 1;
+	ALint bits = 16;
+	ALint frequency = 44100;
+	alGetBufferi(soundBuffer, AL_SIZE, &sizeInBytes);
+	alGetBufferi(soundBuffer, AL_CHANNELS, &channels);
+	alGetBufferi(soundBuffer, AL_BITS, &bits);
+	alGetBufferi(soundBuffer, AL_FREQUENCY, &frequency);
+	
+	soundFrequency = frequency > 0 ? frequency : 44100;
+	if(channels > 0 && bits > 0)
+		soundDuration = (Number)(sizeInBytes * 8 / (channels * bits)) / (Number)soundFrequency;
+	else
+		soundDuration = 0;
 }
 
 void Sound::loadFile(String fileName) {
 
 	if(soundLoaded) {
-		alDeleteSources(1,&soundSource);	
+		unload();
 	}
 
 	String actualFilename = fileName;
@@ -95,26 +164,128 @@ void Sound::loadFile(String fileName) {
 		extension = "";
 	}
 	
-	ALuint buffer;
-	if(extension == "wav" || extension == "WAV") {
-		buffer = loadWAV(actualFilename);			
-	} else if(extension == "ogg" || extension == "OGG") {
-		buffer = loadOGG(actualFilename);			
-	}
-	
 	this->fileName = actualFilename;
 	
-	soundSource = GenSource(buffer);	
-	
-	setVolume(volume);
-	setPitch(pitch);
-	
-	setReferenceDistance(referenceDistance);
-	setMaxDistance(maxDistance);
+	if(streaming && loadStream(actualFilename)) {
+		applySourceProperties();
+	} else {
+		if(extension == "wav" || extension == "WAV") {
+			soundBuffer = loadWAV(actualFilename);			
+		} else if(extension == "ogg" || extension == "OGG") {
+			soundBuffer = loadOGG(actualFilename);			
+		}
+		updateBufferInfo();
+	}
 	
+	soundManager = CoreServices::getInstance()->getSoundManager();
+	soundManager->registerSound(this);
 	soundLoaded = true;
 }
 
+void Sound::applySourceProperties() {
+	alSourcef(soundSource, AL_GAIN, volume);
+	alSourcef(soundSource, AL_PITCH, pitch);
+	alSourcef(soundSource, AL_REFERENCE_DISTANCE, referenceDistance);
+	alSourcef(soundSource, AL_MAX_DISTANCE, maxDistance);
+	if(isPositional) {
+		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
+		applySourcePosition();
+	} else {
+		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_TRUE);	
+		alSource3f(soundSource,AL_POSITION, 0,0,0);
+		alSource3f(soundSource,AL_VELOCITY, 0,0,0);
+		alSource3f(soundSource,AL_DIRECTION, 0,0,0);				
+	}
+}
+
+void Sound::applySourcePosition() {
+	alSource3f(soundSource, AL_POSITION, soundPosition.x, soundPosition.y, soundPosition.z);
+	alSource3f(soundSource, AL_VELOCITY, soundVelocity.x, soundVelocity.y, soundVelocity.z);
+	alSource3f(soundSource, AL_DIRECTION, soundDirection.x, soundDirection.y, soundDirection.z);
+	positionDirty = false;
+}
+
+void Sound::assignVoice(ALuint voice) {
+	soundSource = voice;
+	alSourcei(soundSource, AL_BUFFER, soundBuffer);
+	alSourcei(soundSource, AL_LOOPING, looping ? AL_TRUE : AL_FALSE);
+	applySourceProperties();
+	if(playing) {
+		alSourcef(soundSource, AL_SEC_OFFSET, virtualTime);
+		alSourcePlay(soundSource);
+	}
+}
+
+ALuint Sound::releaseVoice() {
+	ALuint voice = soundSource;
+	if(!voice)
+		return 0;
+	if(playing) {
+		float offset = 0;
+		alGetSourcef(soundSource, AL_SEC_OFFSET, &offset);
+		virtualTime = offset;
+	}
+	alSourceStop(soundSource);
+	alSourcei(soundSource, AL_BUFFER, 0);
+	soundSource = 0;
+	return voice;
+}
+
+void Sound::detachSoundManager() {
+	soundManager = NULL;
+}
+
+void Sound::updateVirtualTime(Number elapsed) {
+	if(soundSource || !playing)
+		return;
+	virtualTime += elapsed * pitch;
+	if(virtualTime >= soundDuration) {
+		if(looping && soundDuration > 0) {
+			virtualTime = fmod(virtualTime, soundDuration);
+		} else {
+			playing = false;
+			virtualTime = 0;
+		}
+	}
+}
+
+bool Sound::updatePlaying() {
+	if(playing && soundSource && !streamDecoder) {
+		ALint state;
+		alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
+		if(state == AL_STOPPED) {
+			playing = false;
+			virtualTime = 0;
+		}
+	}
+	return playing;
+}
+
+Number Sound::getAudibility(const Vector3& listenerPosition) const {
+	if(!isPositional || maxDistance <= referenceDistance)
+		return volume;
+	
+	// matches AL_LINEAR_DISTANCE_CLAMPED, which the SoundManager sets up
+	Number distance = soundPosition.distance(listenerPosition);
+	if(distance < referenceDistance)
+		distance = referenceDistance;
+	if(distance > maxDistance)
+		distance = maxDistance;
+	return volume * (1.0 - ((distance - referenceDistance) / (maxDistance - referenceDistance)));
+}
+
+void Sound::setPriority(int priority) {
+	this->priority = priority;
+}
+
+int Sound::getPriority() const {
+	return priority;
+}
+
+bool Sound::hasVoice() const {
+	return soundSource != 0;
+}
+
 String Sound::getFileName() {
 	return fileName;
 }
@@ -128,8 +299,145 @@ Number Sound::getPitch() {
 }
 
 Sound::~Sound() {
-	Logger::log("destroying sound...\n");
-	alDeleteSources(1,&soundSource);
+	POLY_LOG_DEBUG("destroying sound...\n");
+	unload();
+}
+
+bool Sound::loadStream(const String& fileName) {
+	streamDecoder = SoundStreamDecoder::createDecoder(fileName);
+	if(!streamDecoder) {
+		soundError("Could not stream " + fileName + ", loading it into memory instead");
+		return false;
+	}
+	
+	if(streamDecoder->getChannels() == 1)
+		streamFormat = (streamDecoder->getBitsPerSample() == 8) ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+	else
+		streamFormat = (streamDecoder->getBitsPerSample() == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+	
+	sampleLength = streamDecoder->getSampleLength();
+	streamData = (char*)malloc(STREAM_BUFFER_SIZE);
+	streamActive = false;
+	streamQueueStart = 0;
+	streamPosition = 0;
+	
+	soundSource = GenSource();
+	alGenBuffers(NUM_STREAM_BUFFERS, streamBuffers);
+	checkALError("Generating stream buffers");
+	
+	getSoundStreamer()->addSound(this);
+	return true;
+}
+
+void Sound::releaseStream() {
+	if(!streamDecoder)
+		return;
+	
+	// the streamer is stopped along with the SoundManager
+	if(soundManager) {
+		soundManager->getSoundStreamer()->removeSound(this);
+	}
+	stopStream();
+	alDeleteBuffers(NUM_STREAM_BUFFERS, streamBuffers);
+	delete streamDecoder;
+	streamDecoder = NULL;
+	free(streamData);
+	streamData = NULL;
+}
+
+void Sound::startStream(long sample) {
+	stopStream();
+	streamDecoder->seek(sample);
+	streamQueueStart = sample;
+	for(int i=0; i < NUM_STREAM_BUFFERS; i++) {
+		if(!fillStreamBuffer(i))
+			break;
+		streamActive = true;
+	}
+	if(streamActive)
+		alSourcePlay(soundSource);
+}
+
+void Sound::stopStream() {
+	alSourceStop(soundSource);
+	// detaching the buffer from a stopped source empties its queue
+	alSourcei(soundSource, AL_BUFFER, 0);
+	streamActive = false;
+}
+
+bool Sound::fillStreamBuffer(int index) {
+	long size = 0;
+	bool rewound = false;
+	while(size < STREAM_BUFFER_SIZE) {
+		long bytes = streamDecoder->decode(streamData + size, STREAM_BUFFER_SIZE - size);
+		if(bytes > 0) {
+			size += bytes;
+			rewound = false;
+		} else {
+			// an empty decode right after rewinding means the file has no samples at all
+			if(!streamLooping || rewound)
+				break;
+			streamDecoder->seek(0);
+			rewound = true;
+		}
+	}
+	if(size == 0)
+		return false;
+	
+	alBufferData(streamBuffers[index], streamFormat, streamData, size, streamDecoder->getFrequency());
+	streamBufferSamples[index] = size / streamDecoder->getFrameSize();
+	alSourceQueueBuffers(soundSource, 1, &streamBuffers[index]);
+	return true;
+}
+
+void Sound::updateStream() {
+	if(!streamActive)
+		return;
+	
+	ALint processed = 0;
+	alGetSourcei(soundSource, AL_BUFFERS_PROCESSED, &processed);
+	for(int i=0; i < processed; i++) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(soundSource, 1, &buffer);
+		for(int j=0; j < NUM_STREAM_BUFFERS; j++) {
+			if(streamBuffers[j] == buffer) {
+				streamQueueStart += streamBufferSamples[j];
+				if(sampleLength > 0)
+					streamQueueStart %= sampleLength;
+				fillStreamBuffer(j);
+				break;
+			}
+		}
+	}
+	
+	ALint queued = 0;
+	alGetSourcei(soundSource, AL_BUFFERS_QUEUED, &queued);
+	if(queued == 0) {
+		streamActive = false;
+		streamPosition = 0;
+		return;
+	}
+	
+	// the source stops by itself if the queue ran dry before we refilled it
+	ALint state;
+	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
+	if(state != AL_PLAYING)
+		alSourcePlay(soundSource);
+}
+
+long Sound::getStreamSample() {
+	SoundStreamer *streamer = getSoundStreamer();
+	streamer->lock();
+	long sample = streamPosition;
+	if(streamActive) {
+		ALint offset = 0;
+		alGetSourcei(soundSource, AL_SAMPLE_OFFSET, &offset);
+		sample = streamQueueStart + offset;
+		if(sampleLength > 0)
+			sample %= sampleLength;
+	}
+	streamer->unlock();
+	return sample;
 }
 
 void Sound::soundCheck(bool result, const String& err) {
@@ -138,7 +446,7 @@ void Sound::soundCheck(bool result, const String& err) {
 }
 
 void Sound::soundError(const String& err) {
-	Logger::log("SOUND ERROR: %s\n", err.c_str());
+	POLY_LOG_LIMITED(Logger::LEVEL_ERROR, 10, "SOUND ERROR: %s\n", err.c_str());
 }
 
 unsigned long Sound::readByte32(const unsigned char buffer[4]) {
@@ -158,78 +466,118 @@ unsigned short Sound::readByte16(const unsigned char buffer[2]) {
 }
 
 void Sound::Play(bool loop) {
-	if(!loop) {
-		alSourcei(soundSource, AL_LOOPING, AL_FALSE);
-	} else {
-		alSourcei(soundSource, AL_LOOPING, AL_TRUE);		
+	if(streamDecoder) {
+		SoundStreamer *streamer = getSoundStreamer();
+		streamer->lock();
+		streamLooping = loop;
+		startStream(streamActive ? 0 : streamPosition);
+		streamer->unlock();
+		return;
+	}
+	
+	looping = loop;
+	playing = true;
+	virtualTime = 0;
+	if(!soundSource) {
+		// stays virtual if every voice is taken by a more audible sound
+		CoreServices::getInstance()->getSoundManager()->requestVoice(this);
+		return;
 	}
+	alSourcei(soundSource, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
 	alSourcePlay(soundSource);
 }
 
 bool Sound::isPlaying() {
-	ALenum state;
-	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
-	return (state == AL_PLAYING);
+	if(streamDecoder)
+		return streamActive;
+	return updatePlaying();
 }
 
 
 void Sound::setVolume(Number newVolume) {
 	this->volume = newVolume;
-	alSourcef(soundSource, AL_GAIN, newVolume);
+	if(soundSource)
+		alSourcef(soundSource, AL_GAIN, newVolume);
 }
 
 void Sound::setPitch(Number newPitch) {
 	this->pitch = newPitch;
-	alSourcef(soundSource, AL_PITCH, newPitch);
+	if(soundSource)
+		alSourcef(soundSource, AL_PITCH, newPitch);
 }
 
 void Sound::setSoundPosition(Vector3 position) {
-	if(isPositional)
-		alSource3f(soundSource,AL_POSITION, position.x, position.y, position.z);
+	if(isPositional) {
+		soundPosition = position;
+		positionDirty = true;
+	}
 }
 
 void Sound::setSoundVelocity(Vector3 velocity) {
-	if(isPositional)
-		alSource3f(soundSource,AL_VELOCITY, velocity.x, velocity.y, velocity.z);
+	if(isPositional) {
+		soundVelocity = velocity;
+		positionDirty = true;
+	}
 }
 
 void Sound::setSoundDirection(Vector3 direction) {
-	if(isPositional)
-		alSource3f(soundSource,AL_DIRECTION, direction.x, direction.y, direction.z);
+	if(isPositional) {
+		soundDirection = direction;
+		positionDirty = true;
+	}
+}
+
+void Sound::flushSourcePosition() {
+	if(positionDirty && soundSource)
+		applySourcePosition();
 }
 
 void Sound::setOffset(int off) {
+	if(streamDecoder) {
+		if(off < 0 || off > sampleLength)
+			return;
+		SoundStreamer *streamer = getSoundStreamer();
+		streamer->lock();
+		if(streamActive)
+			startStream(off);
+		else
+			streamPosition = off;
+		streamer->unlock();
+		return;
+	}
+	
+	if(!soundSource) {
+		virtualTime = (Number)off / soundFrequency;
+		return;
+	}
 	alSourcei(soundSource, AL_SAMPLE_OFFSET, off);
 }
 
 
 Number Sound::getPlaybackTime() {
+	if(streamDecoder)
+		return (Number)getStreamSample() / streamDecoder->getFrequency();
+	
+	if(!soundSource)
+		return playing ? virtualTime : 0;
+	
 	float result = 0.0;
 	alGetSourcef(soundSource, AL_SEC_OFFSET, &result);
 	return result;
 }
 
 Number Sound::getPlaybackDuration() {
-	ALint sizeInBytes;
-	ALint channels;
-	ALint bits;
-	ALint bufferID;
-	alGetSourcei(soundSource, AL_BUFFER, &bufferID);
-	
-	alGetBufferi(bufferID, AL_SIZE, &sizeInBytes);
-	alGetBufferi(bufferID, AL_CHANNELS, &channels);
-	alGetBufferi(bufferID, AL_BITS, &bits);
-
-	int lengthInSamples = sizeInBytes * 8 / (channels * bits);
-
-	ALint frequency;
-	alGetBufferi(bufferID, AL_FREQUENCY, &frequency);
-	Number durationInSeconds = (float)lengthInSamples / (float)frequency;
-	
-	return durationInSeconds;
+	if(streamDecoder)
+		return (Number)sampleLength / streamDecoder->getFrequency();
+	return soundDuration;
 }
 		
 int Sound::getOffset() {
+	if(streamDecoder)
+		return getStreamSample();
+	if(!soundSource)
+		return playing ? virtualTime * soundFrequency : 0;
+	
 	ALint off = -1;
 	alGetSourcei(soundSource, AL_SAMPLE_OFFSET, &off);
 	return off;
@@ -238,6 +586,14 @@ int Sound::getOffset() {
 void Sound::seekTo(Number time) {
 	if(time > getPlaybackDuration())
 		return;
+	if(streamDecoder) {
+		setOffset(time * streamDecoder->getFrequency());
+		return;
+	}
+	if(!soundSource) {
+		virtualTime = time;
+		return;
+	}
 	alSourcef(soundSource, AL_SEC_OFFSET, time);
 }
 
@@ -252,12 +608,14 @@ void Sound::setPositionalProperties(Number referenceDistance, Number maxDistance
 
 void Sound::setReferenceDistance(Number referenceDistance) {
 	this->referenceDistance = referenceDistance;
-	alSourcef(soundSource,AL_REFERENCE_DISTANCE, referenceDistance);
+	if(soundSource)
+		alSourcef(soundSource,AL_REFERENCE_DISTANCE, referenceDistance);
 }
 
 void Sound::setMaxDistance(Number maxDistance) {
 	this->maxDistance = maxDistance;
-	alSourcef(soundSource,AL_MAX_DISTANCE, maxDistance);	
+	if(soundSource)
+		alSourcef(soundSource,AL_MAX_DISTANCE, maxDistance);	
 }
 		
 Number Sound::getReferenceDistance() {
@@ -271,14 +629,8 @@ Number Sound::getMaxDistance() {
 
 void Sound::setIsPositional(bool isPositional) {
 	this->isPositional = isPositional;
-	if(isPositional) {
-		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
-	} else {
-		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_TRUE);	
-		alSource3f(soundSource,AL_POSITION, 0,0,0);
-		alSource3f(soundSource,AL_VELOCITY, 0,0,0);
-		alSource3f(soundSource,AL_DIRECTION, 0,0,0);				
-	}
+	if(soundSource)
+		applySourceProperties();
 }
 
 void Sound::checkALError(const String& operation) {
@@ -311,7 +663,19 @@ void Sound::checkALError(const String& operation) {
 }
 
 void Sound::Stop() {
-	alSourceStop(soundSource);
+	if(streamDecoder) {
+		SoundStreamer *streamer = getSoundStreamer();
+		streamer->lock();
+		stopStream();
+		streamPosition = 0;
+		streamer->unlock();
+		return;
+	}
+	
+	playing = false;
+	virtualTime = 0;
+	if(soundSource)
+		alSourceStop(soundSource);
 }
 
 ALuint Sound::GenSource() {
@@ -21,14 +21,47 @@
 */
 
 #include "PolySoundManager.h"
+#include "PolySound.h"
+#include "PolySoundStream.h"
+#include "PolyCoreServices.h"
+#include "PolyCore.h"
 #include "PolyLogger.h"
+#include "PolyProfiler.h"
+#include <algorithm>
 
 using namespace Polycode;
 
+class SoundVoiceRank {
+	public:
+		Sound *sound;
+		int priority;
+		Number audibility;
+};
+
+static bool compareVoiceRanks(const SoundVoiceRank &a, const SoundVoiceRank &b) {
+	if(a.priority != b.priority)
+		return a.priority > b.priority;
+	return a.audibility > b.audibility;
+}
+
 SoundManager::SoundManager() {
+	soundStreamer = NULL;
+	maxVoices = 0;
+	numVirtualSounds = 0;
+	listenerOrientation = Vector3(0.0, 0.0, -1.0);
+	listenerUp = Vector3(0.0, 1.0, 0.0);
+	listenerDirty = false;
 	initAL();
 }
 
+SoundStreamer *SoundManager::getSoundStreamer() {
+	if(!soundStreamer) {
+		soundStreamer = new SoundStreamer();
+		CoreServices::getInstance()->getCore()->createThread(soundStreamer);
+	}
+	return soundStreamer;
+}
+
 void SoundManager::initAL() {
 	alGetError();
 	if(alcGetCurrentContext() == 0) {
@@ -86,30 +119,176 @@ void SoundManager::initAL() {
 	alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
 //	alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
 	
+	setMaxVoices(DEFAULT_MAX_VOICES);
+	
 	Logger::log("OpenAL initialized...\n");
 }
 
+void SoundManager::setMaxVoices(int maxVoices) {
+	while(voices.size() < maxVoices) {
+		ALuint voice;
+		alGetError();
+		alGenSources(1, &voice);
+		if(alGetError() != AL_NO_ERROR) {
+			Logger::log("Could only create %d voices\n", (int)voices.size());
+			break;
+		}
+		voices.push_back(voice);
+		freeVoices.push_back(voice);
+	}
+	if(maxVoices > voices.size())
+		maxVoices = voices.size();
+	if(maxVoices < 0)
+		maxVoices = 0;
+	this->maxVoices = maxVoices;
+}
+
+int SoundManager::getMaxVoices() const {
+	return maxVoices;
+}
+
+int SoundManager::getNumVirtualSounds() const {
+	return numVirtualSounds;
+}
+
+void SoundManager::registerSound(Sound *sound) {
+	sounds.push_back(sound);
+}
+
+void SoundManager::unregisterSound(Sound *sound) {
+	for(int i=0; i < sounds.size(); i++) {
+		if(sounds[i] == sound) {
+			sounds.erase(sounds.begin()+i);
+			break;
+		}
+	}
+	for(int i=0; i < playingSounds.size(); i++) {
+		if(playingSounds[i] == sound) {
+			playingSounds.erase(playingSounds.begin()+i);
+			break;
+		}
+	}
+	if(sound->usesVoicePool() && sound->hasVoice()) {
+		freeVoices.push_back(sound->releaseVoice());
+	}
+}
+
+void SoundManager::requestVoice(Sound *sound) {
+	if(!sound->usesVoicePool() || sound->hasVoice())
+		return;
+	int usedVoices = voices.size() - freeVoices.size();
+	if(usedVoices < maxVoices && freeVoices.size() > 0) {
+		sound->assignVoice(freeVoices.back());
+		freeVoices.pop_back();
+	}
+}
+
+void SoundManager::Update(int elapsed) {
+	POLY_PROFILE_ZONE("SoundManager::Update");
+	
+	if(listenerDirty)
+		flushListener();
+	
+	Number elapsedSeconds = ((Number)elapsed) / 1000.0;
+	playingSounds.clear();
+	for(int i=0; i < sounds.size(); i++) {
+		Sound *sound = sounds[i];
+		if(!sound->usesVoicePool()) {
+			sound->flushSourcePosition();
+			continue;
+		}
+		sound->updateVirtualTime(elapsedSeconds);
+		if(sound->updatePlaying()) {
+			playingSounds.push_back(sound);
+		} else if(sound->hasVoice()) {
+			freeVoices.push_back(sound->releaseVoice());
+		}
+	}
+	
+	assignVoices();
+	
+	for(int i=0; i < playingSounds.size(); i++) {
+		playingSounds[i]->flushSourcePosition();
+	}
+}
+
+void SoundManager::assignVoices() {
+	std::vector<SoundVoiceRank> ranks(playingSounds.size());
+	for(int i=0; i < playingSounds.size(); i++) {
+		ranks[i].sound = playingSounds[i];
+		ranks[i].priority = playingSounds[i]->getPriority();
+		ranks[i].audibility = playingSounds[i]->getAudibility(listenerPosition);
+	}
+	std::sort(ranks.begin(), ranks.end(), compareVoiceRanks);
+	
+	// take voices away first, so the sounds that need one can have them
+	numVirtualSounds = 0;
+	for(int i=0; i < ranks.size(); i++) {
+		if(i < maxVoices && ranks[i].audibility > 0.0)
+			continue;
+		if(ranks[i].sound->hasVoice())
+			freeVoices.push_back(ranks[i].sound->releaseVoice());
+		numVirtualSounds++;
+	}
+	
+	for(int i=0; i < ranks.size() && i < maxVoices; i++) {
+		if(ranks[i].audibility <= 0.0 || ranks[i].sound->hasVoice())
+			continue;
+		if(freeVoices.size() == 0)
+			break;
+		ranks[i].sound->assignVoice(freeVoices.back());
+		freeVoices.pop_back();
+	}
+}
+
+void SoundManager::flushListener() {
+	alListener3f(AL_POSITION, listenerPosition.x, listenerPosition.y, listenerPosition.z);
+	
+	ALfloat ori[6];
+	ori[0] = listenerOrientation.x;
+	ori[1] = listenerOrientation.y;
+	ori[2] = listenerOrientation.z;
+	
+	ori[3] = listenerUp.x;
+	ori[4] = listenerUp.y;
+	ori[5] = listenerUp.z;	
+	alListenerfv(AL_ORIENTATION,ori);
+	
+	listenerDirty = false;
+}
+
 void SoundManager::setGlobalVolume(Number globalVolume) {
 	alListenerf(AL_GAIN, globalVolume);
 }
 
 void SoundManager::setListenerPosition(Vector3 position) {
-	alListener3f(AL_POSITION, position.x, position.y, position.z);
+	listenerPosition = position;
+	listenerDirty = true;
 }
 
 void SoundManager::setListenerOrientation(Vector3 orientation, Vector3 upVector) {
-	ALfloat ori[6];
-	ori[0] = orientation.x;
-	ori[1] = orientation.y;
-	ori[2] = orientation.z;
-	
-	ori[3] = upVector.x;
-	ori[4] = upVector.y;
-	ori[5] = upVector.z;	
-	alListenerfv(AL_ORIENTATION,ori);
+	listenerOrientation = orientation;
+	listenerUp = upVector;
+	listenerDirty = true;
 }
 
 SoundManager::~SoundManager() {
+	// The streamer thread is detached and can't be joined, so it is told to
+	// stop touching OpenAL before the context goes away, and never deleted.
+	if(soundStreamer) {
+		soundStreamer->lock();
+		soundStreamer->killThread();
+		soundStreamer->unlock();
+	}
+	for(int i=0; i < sounds.size(); i++) {
+		if(sounds[i]->usesVoicePool())
+			sounds[i]->releaseVoice();
+		sounds[i]->detachSoundManager();
+	}
+	sounds.clear();
+	if(voices.size() > 0) {
+		alDeleteSources(voices.size(), &voices[0]);
+	}
 	if (context != 0 ) {
 		alcSuspendContext(context);
 		alcMakeContextCurrent(0);
@@ -0,0 +1,283 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include "PolySoundStream.h"
+#include "PolySound.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <vorbis/vorbisfile.h>
+#include <string.h>
+
+#ifdef _WINDOWS
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+static size_t streamReadFunc(void *ptr, size_t size, size_t nmemb, void *datasource) {
+	return OSBasics::read(ptr, size, nmemb, (OSFILE*)datasource);
+}
+
+static int streamSeekFunc(void *datasource, ogg_int64_t offset, int whence) {
+	return OSBasics::seek((OSFILE*)datasource, offset, whence);
+}
+
+static int streamCloseFunc(void *datasource) {
+	return OSBasics::close((OSFILE*)datasource);
+}
+
+static long streamTellFunc(void *datasource) {
+	return OSBasics::tell((OSFILE*)datasource);
+}
+
+SoundStreamDecoder::SoundStreamDecoder() {
+	channels = 0;
+	frequency = 0;
+	bitsPerSample = 16;
+	sampleLength = 0;
+}
+
+SoundStreamDecoder::~SoundStreamDecoder() {
+}
+
+SoundStreamDecoder *SoundStreamDecoder::createDecoder(const String& fileName) {
+	String extension;
+	size_t found = fileName.rfind(".");
+	if(found != std::string::npos) {
+		extension = fileName.substr(found+1).toLowerCase();
+	}
+
+	SoundStreamDecoder *decoder = NULL;
+	if(extension == "ogg") {
+		decoder = new OGGStreamDecoder();
+	} else if(extension == "wav") {
+		decoder = new WAVStreamDecoder();
+	} else {
+		return NULL;
+	}
+
+	if(!decoder->open(fileName)) {
+		delete decoder;
+		return NULL;
+	}
+	return decoder;
+}
+
+OGGStreamDecoder::OGGStreamDecoder() : SoundStreamDecoder() {
+	oggFile = NULL;
+}
+
+OGGStreamDecoder::~OGGStreamDecoder() {
+	if(oggFile) {
+		ov_clear((OggVorbis_File*)oggFile);
+		delete (OggVorbis_File*)oggFile;
+	}
+}
+
+bool OGGStreamDecoder::open(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return false;
+
+	ov_callbacks callbacks;
+	callbacks.read_func = streamReadFunc;
+	callbacks.seek_func = streamSeekFunc;
+	callbacks.close_func = streamCloseFunc;
+	callbacks.tell_func = streamTellFunc;
+
+	OggVorbis_File *vorbisFile = new OggVorbis_File;
+	if(ov_open_callbacks((void*)file, vorbisFile, NULL, 0, callbacks) != 0) {
+		Logger::log("Error opening OGG stream %s\n", fileName.c_str());
+		OSBasics::close(file);
+		delete vorbisFile;
+		return false;
+	}
+	oggFile = vorbisFile;
+
+	vorbis_info *info = ov_info(vorbisFile, -1);
+	channels = info->channels;
+	frequency = info->rate;
+	bitsPerSample = 16;
+	sampleLength = (long)ov_pcm_total(vorbisFile, -1);
+	return channels == 1 || channels == 2;
+}
+
+long OGGStreamDecoder::decode(char *buffer, long size) {
+#if TAU_BIG_ENDIAN
+	int endian = 1;
+#else
+	int endian = 0;
+#endif
+	long decoded = 0;
+	while(decoded < size) {
+		int bitStream;
+		long bytes = ov_read((OggVorbis_File*)oggFile, buffer + decoded, size - decoded, endian, 2, 1, &bitStream);
+		if(bytes == OV_HOLE)
+			continue;
+		if(bytes <= 0)
+			break;
+		decoded += bytes;
+	}
+	return decoded;
+}
+
+bool OGGStreamDecoder::seek(long sample) {
+	return ov_pcm_seek((OggVorbis_File*)oggFile, sample) == 0;
+}
+
+WAVStreamDecoder::WAVStreamDecoder() : SoundStreamDecoder() {
+	file = NULL;
+	dataOffset = 0;
+	dataSize = 0;
+	dataPosition = 0;
+}
+
+WAVStreamDecoder::~WAVStreamDecoder() {
+	if(file)
+		OSBasics::close(file);
+}
+
+bool WAVStreamDecoder::open(const String& fileName) {
+	file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return false;
+
+	char magic[4];
+	unsigned char buffer32[4];
+	unsigned char buffer16[2];
+
+	bool valid = OSBasics::read(magic, 4, 1, file) == 1 && memcmp(magic, "RIFF", 4) == 0;
+	OSBasics::seek(file, 4, SEEK_CUR);
+	valid = valid && OSBasics::read(magic, 4, 1, file) == 1 && memcmp(magic, "WAVE", 4) == 0;
+
+	// walk the chunks until the data chunk, skipping any we don't know
+	bool haveFormat = false;
+	bool haveData = false;
+	while(valid && !haveData && OSBasics::read(magic, 4, 1, file) == 1 && OSBasics::read(buffer32, 4, 1, file) == 1) {
+		long chunkSize = Sound::readByte32(buffer32);
+		if(memcmp(magic, "fmt ", 4) == 0 && chunkSize >= 16) {
+			OSBasics::read(buffer16, 2, 1, file);
+			unsigned short audioFormat = Sound::readByte16(buffer16);
+			OSBasics::read(buffer16, 2, 1, file);
+			channels = Sound::readByte16(buffer16);
+			OSBasics::read(buffer32, 4, 1, file);
+			frequency = Sound::readByte32(buffer32);
+			OSBasics::seek(file, 6, SEEK_CUR);
+			OSBasics::read(buffer16, 2, 1, file);
+			bitsPerSample = Sound::readByte16(buffer16);
+			OSBasics::seek(file, chunkSize - 16 + (chunkSize & 1), SEEK_CUR);
+			valid = audioFormat == 1 && (channels == 1 || channels == 2) && (bitsPerSample == 8 || bitsPerSample == 16);
+			haveFormat = true;
+		} else if(memcmp(magic, "data", 4) == 0) {
+			dataOffset = OSBasics::tell(file);
+			dataSize = chunkSize;
+			haveData = true;
+		} else {
+			OSBasics::seek(file, chunkSize + (chunkSize & 1), SEEK_CUR);
+		}
+	}
+
+	if(!valid || !haveFormat || !haveData) {
+		Logger::log("Error opening WAV stream %s\n", fileName.c_str());
+		OSBasics::close(file);
+		file = NULL;
+		return false;
+	}
+
+	sampleLength = dataSize / getFrameSize();
+	dataPosition = 0;
+	return true;
+}
+
+long WAVStreamDecoder::decode(char *buffer, long size) {
+	long remaining = dataSize - dataPosition;
+	if(size > remaining)
+		size = remaining;
+	size -= size % getFrameSize();
+	if(size <= 0)
+		return 0;
+
+	long bytes = OSBasics::read(buffer, 1, size, file);
+	if(bytes < 0)
+		return 0;
+	dataPosition += bytes;
+	return bytes;
+}
+
+bool WAVStreamDecoder::seek(long sample) {
+	if(sample < 0 || sample > sampleLength)
+		return false;
+	dataPosition = sample * getFrameSize();
+	return OSBasics::seek(file, dataOffset + dataPosition, SEEK_SET) == 0;
+}
+
+SoundStreamer::SoundStreamer() : Threaded() {
+	streamMutex = CoreServices::getInstance()->getCore()->createMutex();
+}
+
+SoundStreamer::~SoundStreamer() {
+}
+
+void SoundStreamer::lock() {
+	CoreServices::getInstance()->getCore()->lockMutex(streamMutex);
+}
+
+void SoundStreamer::unlock() {
+	CoreServices::getInstance()->getCore()->unlockMutex(streamMutex);
+}
+
+void SoundStreamer::addSound(Sound *sound) {
+	lock();
+	sounds.push_back(sound);
+	unlock();
+}
+
+void SoundStreamer::removeSound(Sound *sound) {
+	lock();
+	for(int i=0; i < sounds.size(); i++) {
+		if(sounds[i] == sound) {
+			sounds.erase(sounds.begin()+i);
+			break;
+		}
+	}
+	unlock();
+}
+
+void SoundStreamer::updateThread() {
+	lock();
+	if(threadRunning) {
+		for(int i=0; i < sounds.size(); i++) {
+			sounds[i]->updateStream();
+		}
+	}
+	unlock();
+
+#ifdef _WINDOWS
+	Sleep(UPDATE_INTERVAL);
+#else
+	usleep(UPDATE_INTERVAL * 1000);
+#endif
+}
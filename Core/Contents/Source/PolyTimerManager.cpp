@@ -23,6 +23,7 @@
 #include "PolyTimerManager.h"
 #include "PolyCoreServices.h"
 #include "PolyCore.h"
+#include "PolyProfiler.h"
 #include "PolyTimer.h"
 
 using namespace Polycode;
@@ -48,6 +49,7 @@ void TimerManager::addTimer(Timer *timer) {
 }
 
 void TimerManager::Update() {
+	POLY_PROFILE_ZONE("TimerManager::Update");
 	int ticks = CoreServices::getInstance()->getCore()->getTicks();
 	for(int i=0;i<timers.size();i++) {
 		timers[i]->Update(ticks);
@@ -21,6 +21,7 @@
 */
 
 #include "PolyTweenManager.h"
+#include "PolyProfiler.h"
 #include "PolyTween.h"
 
 using namespace Polycode;
@@ -49,6 +50,7 @@ void TweenManager::removeTween(Tween *tween) {
 }
 
 void TweenManager::Update() {
+	POLY_PROFILE_ZONE("TweenManager::Update");
 	Tween *tween;
 	for(int i=0;i<tweens.size();i++) {
 		if(tweens[i]->isComplete()) {
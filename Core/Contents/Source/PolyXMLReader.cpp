@@ -0,0 +1,593 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyXMLReader.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyJobPool.h"
+#include "OSBasics.h"
+#include <string.h>
+#include <stdlib.h>
+
+using namespace Polycode;
+
+static bool isWhitespace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static void appendUTF8(std::string &str, unsigned int codepoint) {
+	if(codepoint < 0x80) {
+		str += (char)codepoint;
+	} else if(codepoint < 0x800) {
+		str += (char)(0xC0 | (codepoint >> 6));
+		str += (char)(0x80 | (codepoint & 0x3F));
+	} else if(codepoint < 0x10000) {
+		str += (char)(0xE0 | (codepoint >> 12));
+		str += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		str += (char)(0x80 | (codepoint & 0x3F));
+	} else {
+		str += (char)(0xF0 | (codepoint >> 18));
+		str += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+		str += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		str += (char)(0x80 | (codepoint & 0x3F));
+	}
+}
+
+bool XMLStringView::operator == (const char *str) const {
+	size_t strLength = strlen(str);
+	if(strLength != length)
+		return false;
+	return length == 0 || memcmp(data, str, length) == 0;
+}
+
+String XMLStringView::toString() const {
+	if(!hasReferences)
+		return String(data, length);
+
+	String result;
+	result.contents.reserve(length);
+	unsigned int i = 0;
+	while(i < length) {
+		if(data[i] != '&') {
+			result.contents += data[i];
+			i++;
+			continue;
+		}
+
+		unsigned int end = i + 1;
+		while(end < length && end < i + 12 && data[end] != ';') {
+			end++;
+		}
+		if(end >= length || data[end] != ';') {
+			result.contents += data[i];
+			i++;
+			continue;
+		}
+
+		const char *reference = data + i + 1;
+		unsigned int referenceLength = end - i - 1;
+		if(referenceLength == 2 && memcmp(reference, "lt", 2) == 0) {
+			result.contents += '<';
+		} else if(referenceLength == 2 && memcmp(reference, "gt", 2) == 0) {
+			result.contents += '>';
+		} else if(referenceLength == 3 && memcmp(reference, "amp", 3) == 0) {
+			result.contents += '&';
+		} else if(referenceLength == 4 && memcmp(reference, "quot", 4) == 0) {
+			result.contents += '"';
+		} else if(referenceLength == 4 && memcmp(reference, "apos", 4) == 0) {
+			result.contents += '\'';
+		} else if(referenceLength > 1 && reference[0] == '#') {
+			std::string number(reference + 1, referenceLength - 1);
+			unsigned int codepoint;
+			if(number[0] == 'x' || number[0] == 'X') {
+				codepoint = strtoul(number.c_str() + 1, NULL, 16);
+			} else {
+				codepoint = strtoul(number.c_str(), NULL, 10);
+			}
+			appendUTF8(result.contents, codepoint);
+		} else {
+			result.contents.append(data + i, end - i + 1);
+		}
+		i = end + 1;
+	}
+	return result;
+}
+
+int XMLStringView::toInt() const {
+	char buffer[64];
+	unsigned int copyLength = length < 63 ? length : 63;
+	memcpy(buffer, data, copyLength);
+	buffer[copyLength] = '\0';
+	return atoi(buffer);
+}
+
+Number XMLStringView::toNumber() const {
+	char buffer[64];
+	unsigned int copyLength = length < 63 ? length : 63;
+	memcpy(buffer, data, copyLength);
+	buffer[copyLength] = '\0';
+	return atof(buffer);
+}
+
+XMLReader::XMLReader(const char *data, size_t size) {
+	mapping = NULL;
+	init(data, size);
+}
+
+XMLReader::XMLReader() {
+	mapping = NULL;
+	init(NULL, 0);
+}
+
+XMLReader::~XMLReader() {
+	if(mapping) {
+		OSBasics::unmapFile(mapping);
+	}
+}
+
+bool XMLReader::openFile(const String& fileName) {
+	if(mapping) {
+		OSBasics::unmapFile(mapping);
+	}
+	this->fileName = fileName;
+	mapping = OSBasics::mapFile(fileName);
+	if(!mapping) {
+		init(NULL, 0);
+		errorDescription = "Could not open "+fileName;
+		return false;
+	}
+	init(mapping->data, mapping->size);
+	return true;
+}
+
+void XMLReader::init(const char *data, size_t size) {
+	this->data = data;
+	this->size = size;
+	position = 0;
+	depth = 0;
+	keepTokens = false;
+	tokenIndex = -1;
+	tokens.clear();
+	attributes.clear();
+	openElements.clear();
+	errorDescription = "";
+}
+
+const XMLToken *XMLReader::getToken() const {
+	if(tokenIndex < 0 || tokenIndex >= tokens.size())
+		return NULL;
+	return &tokens[tokenIndex];
+}
+
+int XMLReader::next() {
+	if(tokenIndex + 1 < (int)tokens.size()) {
+		tokenIndex++;
+		return tokens[tokenIndex].type;
+	}
+
+	if(tokens.size() > 0) {
+		int lastType = tokens[tokens.size()-1].type;
+		if(lastType == DOCUMENT_END || lastType == DOCUMENT_ERROR) {
+			tokenIndex = tokens.size()-1;
+			return lastType;
+		}
+	}
+
+	// when streaming, only the tokens of the current step are kept
+	if(!keepTokens) {
+		tokens.clear();
+		attributes.clear();
+		tokenIndex = -1;
+	}
+	parseToken();
+	tokenIndex++;
+	return tokens[tokenIndex].type;
+}
+
+bool XMLReader::nextChild(int parentDepth) {
+	while(true) {
+		int type = next();
+		if(type == ELEMENT_START && tokens[tokenIndex].depth == parentDepth+1)
+			return true;
+		if(type == ELEMENT_END && tokens[tokenIndex].depth <= parentDepth)
+			return false;
+		if(type == DOCUMENT_END || type == DOCUMENT_ERROR)
+			return false;
+	}
+}
+
+XMLStringView XMLReader::readText() {
+	XMLStringView text;
+	const XMLToken *token = getToken();
+	if(!token || token->type != ELEMENT_START)
+		return text;
+
+	int elementDepth = token->depth;
+	bool foundText = false;
+	while(true) {
+		int type = next();
+		if(type == TEXT && !foundText && tokens[tokenIndex].depth == elementDepth) {
+			text = tokens[tokenIndex].text;
+			foundText = true;
+		}
+		if(type == ELEMENT_END && tokens[tokenIndex].depth == elementDepth)
+			break;
+		if(type == DOCUMENT_END || type == DOCUMENT_ERROR)
+			break;
+	}
+	return text;
+}
+
+void XMLReader::skipElement() {
+	const XMLToken *token = getToken();
+	if(!token || token->type != ELEMENT_START)
+		return;
+
+	int elementDepth = token->depth;
+	while(true) {
+		int type = next();
+		if(type == ELEMENT_END && tokens[tokenIndex].depth == elementDepth)
+			break;
+		if(type == DOCUMENT_END || type == DOCUMENT_ERROR)
+			break;
+	}
+}
+
+void XMLReader::readAll() {
+	init(data, size);
+	keepTokens = true;
+	while(true) {
+		parseToken();
+		int lastType = tokens[tokens.size()-1].type;
+		if(lastType == DOCUMENT_END || lastType == DOCUMENT_ERROR)
+			break;
+	}
+}
+
+void XMLReader::rewind() {
+	if(keepTokens) {
+		tokenIndex = -1;
+	} else {
+		init(data, size);
+	}
+}
+
+int XMLReader::getType() const {
+	const XMLToken *token = getToken();
+	return token ? token->type : DOCUMENT_END;
+}
+
+int XMLReader::getDepth() const {
+	const XMLToken *token = getToken();
+	return token ? token->depth : 0;
+}
+
+XMLStringView XMLReader::getName() const {
+	const XMLToken *token = getToken();
+	return token ? token->name : XMLStringView();
+}
+
+XMLStringView XMLReader::getText() const {
+	const XMLToken *token = getToken();
+	return token ? token->text : XMLStringView();
+}
+
+XMLStringView XMLReader::getAttribute(const char *name) const {
+	const XMLToken *token = getToken();
+	if(!token)
+		return XMLStringView();
+	for(unsigned int i=token->firstAttribute; i < token->firstAttribute + token->numAttributes; i++) {
+		if(attributes[i].name == name)
+			return attributes[i].value;
+	}
+	return XMLStringView();
+}
+
+bool XMLReader::hasAttribute(const char *name) const {
+	const XMLToken *token = getToken();
+	if(!token)
+		return false;
+	for(unsigned int i=token->firstAttribute; i < token->firstAttribute + token->numAttributes; i++) {
+		if(attributes[i].name == name)
+			return true;
+	}
+	return false;
+}
+
+unsigned int XMLReader::getNumAttributes() const {
+	const XMLToken *token = getToken();
+	return token ? token->numAttributes : 0;
+}
+
+XMLStringView XMLReader::getAttributeName(unsigned int index) const {
+	const XMLToken *token = getToken();
+	if(!token || index >= token->numAttributes)
+		return XMLStringView();
+	return attributes[token->firstAttribute + index].name;
+}
+
+XMLStringView XMLReader::getAttributeValue(unsigned int index) const {
+	const XMLToken *token = getToken();
+	if(!token || index >= token->numAttributes)
+		return XMLStringView();
+	return attributes[token->firstAttribute + index].value;
+}
+
+void XMLReader::setError(const char *description) {
+	int line = 1;
+	for(size_t i=0; i < position && i < size; i++) {
+		if(data[i] == '\n')
+			line++;
+	}
+	errorDescription = String(description) + " on line " + String::IntToString(line);
+	if(fileName != "") {
+		errorDescription = errorDescription + " of " + fileName;
+	}
+
+	XMLToken token;
+	token.type = DOCUMENT_ERROR;
+	token.depth = depth;
+	token.firstAttribute = 0;
+	token.numAttributes = 0;
+	tokens.push_back(token);
+}
+
+bool XMLReader::startsWith(const char *str) const {
+	size_t strLength = strlen(str);
+	return size - position >= strLength && memcmp(data + position, str, strLength) == 0;
+}
+
+bool XMLReader::findSequence(const char *str, size_t *found) const {
+	size_t strLength = strlen(str);
+	for(size_t i=position; i + strLength <= size; i++) {
+		if(data[i] == str[0] && memcmp(data + i, str, strLength) == 0) {
+			*found = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void XMLReader::skipWhitespace() {
+	while(position < size && isWhitespace(data[position])) {
+		position++;
+	}
+}
+
+XMLStringView XMLReader::parseName() {
+	size_t start = position;
+	while(position < size) {
+		char c = data[position];
+		if(isWhitespace(c) || c == '/' || c == '>' || c == '=' || c == '<')
+			break;
+		position++;
+	}
+	return XMLStringView(data + start, position - start, false);
+}
+
+void XMLReader::parseToken() {
+	XMLToken token;
+	token.firstAttribute = attributes.size();
+	token.numAttributes = 0;
+
+	while(true) {
+		if(position >= size) {
+			if(openElements.size() > 0) {
+				setError("Unexpected end of document");
+				return;
+			}
+			token.type = DOCUMENT_END;
+			token.depth = 0;
+			tokens.push_back(token);
+			return;
+		}
+
+		if(data[position] != '<') {
+			size_t start = position;
+			bool hasReferences = false;
+			while(position < size && data[position] != '<') {
+				if(data[position] == '&')
+					hasReferences = true;
+				position++;
+			}
+			size_t end = position;
+			while(start < end && isWhitespace(data[start]))
+				start++;
+			while(end > start && isWhitespace(data[end-1]))
+				end--;
+			if(end > start && depth > 0) {
+				token.type = TEXT;
+				token.depth = depth;
+				token.text = XMLStringView(data + start, end - start, hasReferences);
+				tokens.push_back(token);
+				return;
+			}
+			continue;
+		}
+
+		size_t found;
+		if(startsWith("<!--")) {
+			if(!findSequence("-->", &found)) {
+				setError("Unterminated comment");
+				return;
+			}
+			position = found + 3;
+			continue;
+		}
+
+		if(startsWith("<![CDATA[")) {
+			size_t start = position + 9;
+			if(!findSequence("]]>", &found)) {
+				setError("Unterminated CDATA section");
+				return;
+			}
+			position = found + 3;
+			if(depth > 0) {
+				token.type = TEXT;
+				token.depth = depth;
+				token.text = XMLStringView(data + start, found - start, false);
+				tokens.push_back(token);
+				return;
+			}
+			continue;
+		}
+
+		if(startsWith("<?")) {
+			if(!findSequence("?>", &found)) {
+				setError("Unterminated processing instruction");
+				return;
+			}
+			position = found + 2;
+			continue;
+		}
+
+		if(startsWith("<!")) {
+			if(!findSequence(">", &found)) {
+				setError("Unterminated declaration");
+				return;
+			}
+			position = found + 1;
+			continue;
+		}
+
+		if(startsWith("</")) {
+			position += 2;
+			XMLStringView name = parseName();
+			skipWhitespace();
+			if(position >= size || data[position] != '>') {
+				setError("Expected > after closing tag");
+				return;
+			}
+			position++;
+
+			if(openElements.size() == 0 || openElements[openElements.size()-1].length != name.length || memcmp(openElements[openElements.size()-1].data, name.data, name.length) != 0) {
+				setError("Closing tag doesn't match the open element");
+				return;
+			}
+			openElements.pop_back();
+
+			token.type = ELEMENT_END;
+			token.depth = depth;
+			token.name = name;
+			tokens.push_back(token);
+			depth--;
+			return;
+		}
+
+		position++;
+		token.type = ELEMENT_START;
+		token.depth = depth + 1;
+		token.name = parseName();
+		if(token.name.length == 0) {
+			setError("Expected element name");
+			return;
+		}
+
+		bool selfClosing = false;
+		while(true) {
+			skipWhitespace();
+			if(position >= size) {
+				setError("Unterminated start tag");
+				return;
+			}
+			if(data[position] == '>') {
+				position++;
+				break;
+			}
+			if(data[position] == '/') {
+				if(position + 1 < size && data[position+1] == '>') {
+					position += 2;
+					selfClosing = true;
+					break;
+				}
+				setError("Expected > after /");
+				return;
+			}
+
+			XMLAttribute attribute;
+			attribute.name = parseName();
+			if(attribute.name.length == 0) {
+				setError("Expected attribute name");
+				return;
+			}
+			skipWhitespace();
+			if(position >= size || data[position] != '=') {
+				setError("Expected = after attribute name");
+				return;
+			}
+			position++;
+			skipWhitespace();
+			if(position >= size || (data[position] != '"' && data[position] != '\'')) {
+				setError("Expected quoted attribute value");
+				return;
+			}
+			char quote = data[position];
+			position++;
+			size_t start = position;
+			bool hasReferences = false;
+			while(position < size && data[position] != quote) {
+				if(data[position] == '&')
+					hasReferences = true;
+				position++;
+			}
+			if(position >= size) {
+				setError("Unterminated attribute value");
+				return;
+			}
+			attribute.value = XMLStringView(data + start, position - start, hasReferences);
+			position++;
+			attributes.push_back(attribute);
+			token.numAttributes++;
+		}
+
+		depth++;
+		tokens.push_back(token);
+		if(selfClosing) {
+			token.type = ELEMENT_END;
+			tokens.push_back(token);
+			depth--;
+		} else {
+			openElements.push_back(token.name);
+		}
+		return;
+	}
+}
+
+namespace Polycode {
+
+	class XMLReadJob : public Job {
+		public:
+			XMLReadJob(XMLReader *reader) : reader(reader) {}
+			void run() { reader->readAll(); }
+		protected:
+			XMLReader *reader;
+	};
+
+}
+
+void XMLFileParser::readAll(const std::vector<XMLReader*> &readers) {
+	std::vector<Job*> jobs;
+	for(int i=0; i < readers.size(); i++) {
+		jobs.push_back(new XMLReadJob(readers[i]));
+	}
+	CoreServices::getInstance()->getCore()->getJobPool()->runJobs(jobs);
+}
@@ -0,0 +1,294 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+#include <zlib.h>
+
+// Generates a synthetic asset set of about 500 MB, half meshes and half PNG
+// textures plus skeletons and animations, writes it as loose files and as a
+// .polyapp zip archive, and prints how long loading every asset takes from
+// each. Both runs read from a warm file cache, since the files were just
+// written. No window or GPU is needed.
+
+static const long ASSET_SET_SIZE = 500 * 1024 * 1024;
+static const int MESH_GRID_SIZE = 256;
+static const int TEXTURE_SIZE = 1024;
+static const int NUM_SKELETONS = 50;
+
+static std::vector<char> readWholeFile(const String& fileName) {
+	std::vector<char> data;
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return data;
+	OSBasics::seek(file, 0, SEEK_END);
+	data.resize(OSBasics::tell(file));
+	OSBasics::seek(file, 0, SEEK_SET);
+	if(data.size() > 0)
+		OSBasics::read(&data[0], 1, data.size(), file);
+	OSBasics::close(file);
+	return data;
+}
+
+static void writeWholeFile(const String& fileName, const std::vector<char> &data) {
+	OSFILE *file = OSBasics::open(fileName, "wb");
+	if(data.size() > 0)
+		OSBasics::write(&data[0], 1, data.size(), file);
+	OSBasics::close(file);
+}
+
+static void writeShort(OSFILE *file, unsigned short value) {
+	OSBasics::write(&value, sizeof(unsigned short), 1, file);
+}
+
+static void writeInt(OSFILE *file, unsigned int value) {
+	OSBasics::write(&value, sizeof(unsigned int), 1, file);
+}
+
+struct ZipEntry {
+	String name;
+	unsigned int crc;
+	unsigned int compressedSize;
+	unsigned int size;
+	unsigned int offset;
+};
+
+// Writes a zip archive of the given files with deflate compression, the way
+// .polyapp files are packaged.
+static void writeZipArchive(const String& archivePath, const String& folder, const String& entryFolder, const std::vector<String> &names) {
+	OSFILE *outFile = OSBasics::open(archivePath, "wb");
+	if(!outFile)
+		return;
+	std::vector<ZipEntry> entries;
+	std::vector<unsigned char> compressed;
+	
+	for(int i=0; i < names.size(); i++) {
+		std::vector<char> data = readWholeFile(folder + "/" + names[i]);
+		
+		z_stream stream;
+		memset(&stream, 0, sizeof(z_stream));
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		compressed.resize(deflateBound(&stream, data.size()));
+		stream.next_in = (Bytef*)(data.size() > 0 ? &data[0] : NULL);
+		stream.avail_in = data.size();
+		stream.next_out = &compressed[0];
+		stream.avail_out = compressed.size();
+		deflate(&stream, Z_FINISH);
+		
+		ZipEntry entry;
+		entry.name = entryFolder + "/" + names[i];
+		entry.crc = crc32(0, (const Bytef*)(data.size() > 0 ? &data[0] : NULL), data.size());
+		entry.compressedSize = stream.total_out;
+		entry.size = data.size();
+		entry.offset = OSBasics::tell(outFile);
+		deflateEnd(&stream);
+		
+		writeInt(outFile, 0x04034b50);
+		writeShort(outFile, 20);
+		writeShort(outFile, 0);
+		writeShort(outFile, Z_DEFLATED);
+		writeShort(outFile, 0);
+		writeShort(outFile, 0x21);
+		writeInt(outFile, entry.crc);
+		writeInt(outFile, entry.compressedSize);
+		writeInt(outFile, entry.size);
+		writeShort(outFile, entry.name.length());
+		writeShort(outFile, 0);
+		OSBasics::write(entry.name.c_str(), 1, entry.name.length(), outFile);
+		OSBasics::write(&compressed[0], 1, entry.compressedSize, outFile);
+		entries.push_back(entry);
+	}
+	
+	unsigned int directoryOffset = OSBasics::tell(outFile);
+	for(int i=0; i < entries.size(); i++) {
+		writeInt(outFile, 0x02014b50);
+		writeShort(outFile, 20);
+		writeShort(outFile, 20);
+		writeShort(outFile, 0);
+		writeShort(outFile, Z_DEFLATED);
+		writeShort(outFile, 0);
+		writeShort(outFile, 0x21);
+		writeInt(outFile, entries[i].crc);
+		writeInt(outFile, entries[i].compressedSize);
+		writeInt(outFile, entries[i].size);
+		writeShort(outFile, entries[i].name.length());
+		writeShort(outFile, 0);
+		writeShort(outFile, 0);
+		writeShort(outFile, 0);
+		writeShort(outFile, 0);
+		writeInt(outFile, 0);
+		writeInt(outFile, entries[i].offset);
+		OSBasics::write(entries[i].name.c_str(), 1, entries[i].name.length(), outFile);
+	}
+	unsigned int directorySize = OSBasics::tell(outFile) - directoryOffset;
+	
+	writeInt(outFile, 0x06054b50);
+	writeShort(outFile, 0);
+	writeShort(outFile, 0);
+	writeShort(outFile, entries.size());
+	writeShort(outFile, entries.size());
+	writeInt(outFile, directorySize);
+	writeInt(outFile, directoryOffset);
+	writeShort(outFile, 0);
+	OSBasics::close(outFile);
+}
+
+// True if the file is read from a mounted archive rather than from disk.
+static bool isArchiveFile(const String& path) {
+	OSFILE *file = OSBasics::open(path, "rb");
+	if(!file)
+		return false;
+	bool inArchive = (file->fileType == OSFILE::TYPE_ARCHIVE_FILE);
+	OSBasics::close(file);
+	return inArchive;
+}
+
+static bool hasExtension(const String& name, const String& extension) {
+	return name.length() > extension.length() && name.contents.compare(name.length() - extension.length(), extension.length(), extension.contents) == 0;
+}
+
+static void addGridVertex(Polygon *poly, Number x, Number y) {
+	Vertex *vertex = poly->addVertex(x, sin(x * 10.0), y, x, y);
+	Vector3 normal(-10.0 * cos(x * 10.0), 1.0, 0.0);
+	normal.Normalize();
+	vertex->setNormal(normal.x, normal.y, normal.z);
+}
+
+static Mesh *createGridMesh() {
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	Number step = 1.0 / MESH_GRID_SIZE;
+	for(int y=0; y < MESH_GRID_SIZE; y++) {
+		for(int x=0; x < MESH_GRID_SIZE; x++) {
+			Number x0 = x * step, x1 = (x+1) * step;
+			Number y0 = y * step, y1 = (y+1) * step;
+			
+			Polygon *poly = new Polygon();
+			addGridVertex(poly, x0, y0);
+			addGridVertex(poly, x1, y0);
+			addGridVertex(poly, x1, y1);
+			mesh->addPolygon(poly);
+			
+			poly = new Polygon();
+			addGridVertex(poly, x0, y0);
+			addGridVertex(poly, x1, y1);
+			addGridVertex(poly, x0, y1);
+			mesh->addPolygon(poly);
+		}
+	}
+	mesh->calculateTangents();
+	return mesh;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	String folder = core->getDefaultWorkingDirectory() + "/AssetLoadBenchmark";
+	String archivePath = core->getDefaultWorkingDirectory() + "/AssetLoadBenchmark.polyapp";
+	OSBasics::createFolder(folder);
+	
+	BenchmarkTimer timer;
+	
+	Mesh *mesh = createGridMesh();
+	mesh->saveToFile(folder + "/source.mesh");
+	delete mesh;
+	std::vector<char> meshData = readWholeFile(folder + "/source.mesh");
+	
+	Image *image = new Image(TEXTURE_SIZE, TEXTURE_SIZE);
+	for(int y=0; y < TEXTURE_SIZE; y++) {
+		for(int x=0; x < TEXTURE_SIZE; x++) {
+			image->setPixel(x, y, (Number)(rand() % 256) / 255.0, (Number)(rand() % 256) / 255.0, (Number)(rand() % 256) / 255.0, 1.0);
+		}
+	}
+	image->savePNG(folder + "/source.png");
+	delete image;
+	std::vector<char> textureData = readWholeFile(folder + "/source.png");
+	
+	std::vector<char> skeletonData = readWholeFile("Resources/ninja.skeleton");
+	std::vector<char> animationData = readWholeFile("Resources/run.anim");
+	if(meshData.size() == 0 || textureData.size() == 0 || skeletonData.size() == 0 || animationData.size() == 0) {
+		printf("Could not create the asset set\n");
+		return;
+	}
+	
+	long totalSize = 0;
+	for(int i=0; i < NUM_SKELETONS; i++) {
+		String name = "skeleton" + String::IntToString(i);
+		writeWholeFile(folder + "/" + name + ".skeleton", skeletonData);
+		writeWholeFile(folder + "/" + name + ".anim", animationData);
+		assetNames.push_back(name + ".skeleton");
+		totalSize += skeletonData.size() + animationData.size();
+	}
+	for(int i=0; totalSize < ASSET_SET_SIZE; i++) {
+		String name;
+		if(i % 2 == 0) {
+			name = "mesh" + String::IntToString(i) + ".mesh";
+			writeWholeFile(folder + "/" + name, meshData);
+			totalSize += meshData.size();
+		} else {
+			name = "texture" + String::IntToString(i) + ".png";
+			writeWholeFile(folder + "/" + name, textureData);
+			totalSize += textureData.size();
+		}
+		assetNames.push_back(name);
+	}
+	
+	std::vector<String> fileNames;
+	for(int i=0; i < assetNames.size(); i++) {
+		fileNames.push_back(assetNames[i]);
+		if(hasExtension(assetNames[i], ".skeleton"))
+			fileNames.push_back(assetNames[i].replace(".skeleton", ".anim"));
+	}
+	writeZipArchive(archivePath, folder, "AssetLoadBenchmarkArchive", fileNames);
+	
+	printf("Asset set: %d files, %ld MB loose, %ld MB archive, generated in %.1f s\n", (int)fileNames.size(), totalSize / (1024 * 1024), getFileSize(archivePath) / (1024 * 1024), timer.getElapsed() / 1000.0);
+	
+	printResult("Loose files", folder, totalSize);
+	
+	CoreServices::getInstance()->getResourceManager()->addArchive(archivePath);
+	if(isArchiveFile("AssetLoadBenchmarkArchive/" + assetNames[0])) {
+		printResult(".polyapp archive", "AssetLoadBenchmarkArchive", totalSize);
+	} else {
+		printf(".polyapp archive: could not mount %s\n", archivePath.c_str());
+	}
+	CoreServices::getInstance()->getResourceManager()->removeArchive(archivePath);
+	
+	// the asset set is large, so don't leave it behind
+	fileNames.push_back("source.mesh");
+	fileNames.push_back("source.png");
+	for(int i=0; i < fileNames.size(); i++) {
+		OSBasics::removeItem(folder + "/" + fileNames[i]);
+	}
+	OSBasics::removeItem(folder);
+	OSBasics::removeItem(archivePath);
+}
+
+void HelloPolycodeApp::printResult(const String& title, const String& folder, long totalSize) {
+	int failures;
+	Number time = loadAssets(folder, &failures);
+	if(failures > 0) {
+		printf("%s: %d of %d assets failed to load\n", title.c_str(), failures, (int)assetNames.size());
+	} else {
+		printf("%s: %.1f ms, %.1f MB/s\n", title.c_str(), time, (totalSize / (1024.0 * 1024.0)) / (time / 1000.0));
+	}
+}
+
+Number HelloPolycodeApp::loadAssets(const String& folder, int *failures) {
+	BenchmarkTimer timer;
+	*failures = 0;
+	for(int i=0; i < assetNames.size(); i++) {
+		String path = folder + "/" + assetNames[i];
+		if(hasExtension(path, ".mesh")) {
+			Mesh *mesh = new Mesh(path);
+			if(mesh->getPolygonCount() == 0)
+				(*failures)++;
+			delete mesh;
+		} else if(hasExtension(path, ".png")) {
+			Image *image = new Image(path);
+			if(!image->isLoaded())
+				(*failures)++;
+			delete image;
+		} else {
+			Skeleton *skeleton = new Skeleton(path);
+			skeleton->addAnimation("Run", path.replace(".skeleton", ".anim"));
+			if(skeleton->getNumBones() == 0 || !skeleton->getAnimation("Run"))
+				(*failures)++;
+			delete skeleton;
+		}
+	}
+	return timer.getElapsed();
+}
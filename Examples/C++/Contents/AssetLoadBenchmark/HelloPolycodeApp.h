@@ -0,0 +1,15 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	Number loadAssets(const String& folder, int *failures);
+	void printResult(const String& title, const String& folder, long totalSize);
+
+	std::vector<String> assetNames;
+};
@@ -0,0 +1,73 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Loads the same long track streamed and fully decoded, and prints how long
+// loading and seeking took and how much memory each needed. Streaming runs
+// first, since the process peak can only go up. To run without an audio
+// device, use OpenAL Soft's null backend: ALSOFT_DRIVERS=null
+
+static const char *TEST_FILE = "streaming_benchmark.wav";
+static const int TEST_FILE_SECONDS = 300;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	writeTestFile(TEST_FILE, TEST_FILE_SECONDS);
+	printf("peak memory before loading: %.1f MB\n", getPeakMemory());
+	runBenchmark(TEST_FILE, true);
+	runBenchmark(TEST_FILE, false);
+}
+
+void HelloPolycodeApp::writeTestFile(const String& fileName, int seconds) {
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file)
+		return;
+	
+	int frequency = 44100;
+	int channels = 2;
+	unsigned int dataSize = seconds * frequency * channels * 2;
+	unsigned int value;
+	unsigned short shortValue;
+	
+	fwrite("RIFF", 4, 1, file);
+	value = 36 + dataSize; fwrite(&value, 4, 1, file);
+	fwrite("WAVEfmt ", 8, 1, file);
+	value = 16; fwrite(&value, 4, 1, file);
+	shortValue = 1; fwrite(&shortValue, 2, 1, file);
+	shortValue = channels; fwrite(&shortValue, 2, 1, file);
+	value = frequency; fwrite(&value, 4, 1, file);
+	value = frequency * channels * 2; fwrite(&value, 4, 1, file);
+	shortValue = channels * 2; fwrite(&shortValue, 2, 1, file);
+	shortValue = 16; fwrite(&shortValue, 2, 1, file);
+	fwrite("data", 4, 1, file);
+	fwrite(&dataSize, 4, 1, file);
+	
+	short samples[2048];
+	for(int i=0; i < seconds * frequency; i += 1024) {
+		for(int j=0; j < 1024; j++) {
+			samples[j*2] = samples[j*2+1] = (short)(sin((i + j) * 440.0 * 2.0 * PI / frequency) * 8000);
+		}
+		fwrite(samples, sizeof(samples), 1, file);
+	}
+	fclose(file);
+}
+
+void HelloPolycodeApp::runBenchmark(const String& fileName, bool streaming) {
+	BenchmarkTimer timer;
+	Sound *sound = new Sound(fileName, streaming);
+	sound->Play(false);
+	Number loadTime = timer.getElapsed();
+	
+	timer.reset();
+	sound->seekTo(sound->getPlaybackDuration() / 2.0);
+	Number seekTime = timer.getElapsed();
+	
+	// let the streaming thread refill the queue for a second of real time
+	timer.reset();
+	Number seekPosition = sound->getPlaybackTime();
+	while(timer.getElapsed() < 1000.0) {
+		core->Update();
+	}
+	
+	printf("%s: load and play %.2f ms, seek %.2f ms, played %.2f s after seeking, still playing: %s, peak memory %.1f MB\n", streaming ? "streamed" : "decoded", loadTime, seekTime, sound->getPlaybackTime() - seekPosition, sound->isPlaying() ? "yes" : "no", getPeakMemory());
+	
+	delete sound;
+}
@@ -0,0 +1,14 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	void writeTestFile(const String& fileName, int seconds);
+	void runBenchmark(const String& fileName, bool streaming);
+
+};
@@ -0,0 +1,51 @@
+#include "BenchmarkApp.h"
+#ifndef _WINDOWS
+#include <sys/resource.h>
+#endif
+
+BenchmarkTimer::BenchmarkTimer() {
+	reset();
+}
+
+void BenchmarkTimer::reset() {
+	startTime = Profiler::getTime();
+}
+
+Number BenchmarkTimer::getElapsed() {
+	return (Number)(Profiler::getTime() - startTime) / 1000.0;
+}
+
+BenchmarkApp::BenchmarkApp(int xRes, int yRes) {
+	core = new HeadlessCore(xRes, yRes, 60);
+}
+
+BenchmarkApp::~BenchmarkApp() {
+}
+
+bool BenchmarkApp::Update() {
+	return false;
+}
+
+Number BenchmarkApp::getPeakMemory() {
+#ifdef _WINDOWS
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	#if defined(__APPLE__) && defined(__MACH__)
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+	#else
+	return usage.ru_maxrss / 1024.0;
+	#endif
+#endif
+}
+
+long BenchmarkApp::getFileSize(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return 0;
+	OSBasics::seek(file, 0, SEEK_END);
+	long size = OSBasics::tell(file);
+	OSBasics::close(file);
+	return size;
+}
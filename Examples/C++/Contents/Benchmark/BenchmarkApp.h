@@ -0,0 +1,38 @@
+#pragma once
+#include <Polycode.h>
+#include "PolycodeView.h"
+
+using namespace Polycode;
+
+// Shared by the benchmark examples. BenchmarkApp creates a HeadlessCore, so no
+// window or GPU is needed, and its Update() returns false, so a benchmark runs
+// and prints everything from its constructor and main() exits right after.
+
+class BenchmarkTimer {
+public:
+	BenchmarkTimer();
+	
+	void reset();
+	
+	// milliseconds since the timer was created or last reset
+	Number getElapsed();
+	
+protected:
+	unsigned long long startTime;
+};
+
+class BenchmarkApp : public EventHandler {
+public:
+	BenchmarkApp(int xRes, int yRes);
+	virtual ~BenchmarkApp();
+	
+	bool Update();
+	
+	// peak resident memory of the process in MB, 0 where it can't be read
+	static Number getPeakMemory();
+	
+	static long getFileSize(const String& fileName);
+	
+protected:
+	HeadlessCore *core;
+};
@@ -0,0 +1,89 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Runs a scene with skinned ninjas, particle emitters, a grid of textured
+// boxes and a label that changes every frame on a HeadlessCore. Prints the
+// CPU time per frame with the recording renderer acting as a null renderer
+// and with it recording the command stream, along with what was drawn per
+// frame. The clock advances by a fixed step, so every run draws the same
+// frames. No window or GPU is needed.
+
+static const int NUM_FRAMES = 600;
+static const int NUM_NINJAS = 20;
+static const int NUM_EMITTERS = 4;
+static const int BOX_GRID_SIZE = 20;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	CoreServices::getInstance()->getResourceManager()->addArchive("Resources/default.pak");
+	CoreServices::getInstance()->getResourceManager()->addDirResource("default", false);
+	CoreServices::getInstance()->getResourceManager()->addDirResource("Resources", false);
+	
+	scene = new Scene();
+	scene->getDefaultCamera()->setPosition(25,25,25);
+	scene->getDefaultCamera()->lookAt(Vector3(0,0,0));
+	
+	for(int i=0; i < NUM_NINJAS; i++) {
+		SceneMesh *mesh = new SceneMesh("Resources/ninja.mesh");
+		mesh->loadTexture("Resources/ninja.png");
+		mesh->setPosition((i % 5) * 4.0 - 8.0, 0, (i / 5) * 4.0 - 8.0);
+		scene->addEntity(mesh);
+		mesh->loadSkeleton("Resources/ninja.skeleton");
+		mesh->getSkeleton()->addAnimation("Run", "Resources/run.anim");
+		mesh->getSkeleton()->playAnimation("Run");
+	}
+	
+	for(int i=0; i < NUM_EMITTERS; i++) {
+		SceneParticleEmitter *emitter = new SceneParticleEmitter("TestParticle", 
+			Particle::BILLBOARD_PARTICLE, ParticleEmitter::CONTINUOUS_EMITTER, 4, 200,
+			Vector3(0.0,1.0,0.0), Vector3(0.0,0.0,0.0), Vector3(0.3, 0.0, 0.3),
+			Vector3(1.5,1.5,1.5));
+		emitter->setPosition(i * 3.0 - 4.5, 0, 0);
+		scene->addEntity(emitter);
+	}
+	
+	for(int i=0; i < BOX_GRID_SIZE * BOX_GRID_SIZE; i++) {
+		ScenePrimitive *box = new ScenePrimitive(ScenePrimitive::TYPE_BOX, 1.0, 1.0, 1.0);
+		box->loadTexture("Resources/green_texture.png");
+		box->setPosition((i % BOX_GRID_SIZE) * 2.0 - 19.0, -2.0, (i / BOX_GRID_SIZE) * 2.0 - 19.0);
+		scene->addEntity(box);
+	}
+	
+	screen = new Screen();
+	label = new ScreenLabel("", 16);
+	screen->addChild(label);
+	
+	runFrames(false);
+	runFrames(true);
+}
+
+void HelloPolycodeApp::runFrames(bool recording) {
+	RecordingRenderer *renderer = core->getRecordingRenderer();
+	renderer->setRecording(recording);
+	
+	// one warm up frame so textures are uploaded and arrays are at their working size
+	core->Update();
+	
+	unsigned int drawCalls = 0;
+	unsigned int verticesDrawn = 0;
+	unsigned int stateChanges = 0;
+	unsigned int textureBinds = 0;
+	unsigned int commands = 0;
+	
+	// the renderer's counters are reset at the start of every frame
+	BenchmarkTimer timer;
+	for(int i=0; i < NUM_FRAMES; i++) {
+		label->setText("Frame " + String::IntToString(i));
+		core->Update();
+		drawCalls += renderer->getDrawCallCount();
+		verticesDrawn += renderer->getVerticesDrawn();
+		stateChanges += renderer->getStateChangeCount();
+		textureBinds += renderer->getNumCommandsOfType(RenderCommand::COMMAND_BIND_TEXTURE);
+		commands += renderer->getNumCommands();
+	}
+	Number totalTime = timer.getElapsed();
+	
+	printf("recording %s: %.3f ms per frame, %d draw calls, %d vertices, %d state changes per frame\n", recording ? "on" : "off", totalTime / NUM_FRAMES, drawCalls / NUM_FRAMES, verticesDrawn / NUM_FRAMES, stateChanges / NUM_FRAMES);
+	if(recording) {
+		printf("  %d commands, %d texture binds per frame\n", commands / NUM_FRAMES, textureBinds / NUM_FRAMES);
+	}
+}
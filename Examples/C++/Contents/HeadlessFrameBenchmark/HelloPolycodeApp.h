@@ -0,0 +1,16 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	void runFrames(bool recording);
+
+	Scene *scene;
+	Screen *screen;
+	ScreenLabel *label;
+};
@@ -0,0 +1,100 @@
+#include "HelloPolycodeApp.h"
+#include "tinyxml.h"
+#include <stdio.h>
+
+// Writes 10000 materials into 20 material files and prints how long it takes
+// to parse them as TinyXML documents, the way the resource manager used to
+// (once for shaders, once for cubemaps and once for materials), next to
+// reading them with XMLReader on one thread and with XMLFileParser on the
+// core's job pool, and to loading the whole folder with addDirResource. No
+// window or GPU is needed.
+
+static const int NUM_FILES = 20;
+static const int MATERIALS_PER_FILE = 500;
+
+static int countElements(TiXmlNode *node) {
+	int count = 1;
+	for(TiXmlNode *child = node->FirstChild(); child != 0; child = child->NextSibling()) {
+		if(child->ToElement())
+			count += countElements(child);
+	}
+	return count;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	folderPath = core->getDefaultWorkingDirectory() + "/MaterialLoadBenchmarkMaterials";
+	core->createFolder(folderPath);
+	for(int i=0; i < NUM_FILES; i++) {
+		OSFILE *file = OSBasics::open(folderPath + "/materials" + String::IntToString(i) + ".mat", "w");
+		String header = "<?xml version=\"1.0\" ?>\n<polycode>\n\t<materials>\n";
+		OSBasics::write(header.c_str(), 1, header.length(), file);
+		for(int j=0; j < MATERIALS_PER_FILE; j++) {
+			String material = "\t\t<material name=\"Material" + String::IntToString(i * MATERIALS_PER_FILE + j) + "\" blendingMode=\"1\">\n"
+				"\t\t\t<shader type=\"fixed\">\n"
+				"\t\t\t\t<params>\n"
+				"\t\t\t\t\t<param name=\"diffuse_color\" type=\"Color\" value=\"1.0 0.5 0.25 1.0\"/>\n"
+				"\t\t\t\t\t<param name=\"specular_color\" type=\"Color\" value=\"1.0 1.0 1.0 1.0\"/>\n"
+				"\t\t\t\t\t<param name=\"shininess\" type=\"Number\" value=\"20.0\"/>\n"
+				"\t\t\t\t</params>\n"
+				"\t\t\t</shader>\n"
+				"\t\t</material>\n";
+			OSBasics::write(material.c_str(), 1, material.length(), file);
+		}
+		String footer = "\t</materials>\n</polycode>\n";
+		OSBasics::write(footer.c_str(), 1, footer.length(), file);
+		OSBasics::close(file);
+	}
+	
+	BenchmarkTimer timer;
+	int numElements = 0;
+	for(int i=0; i < NUM_FILES; i++) {
+		TiXmlDocument doc((folderPath + "/materials" + String::IntToString(i) + ".mat").c_str());
+		doc.LoadFile();
+		numElements += countElements(doc.RootElement());
+	}
+	Number domTime = timer.getElapsed();
+	printf("TinyXML: %d elements in %.1f ms, %.1f ms for the three passes\n", numElements, domTime, domTime * 3.0);
+	
+	std::vector<XMLReader*> readers = openFiles();
+	timer.reset();
+	numElements = 0;
+	for(int i=0; i < readers.size(); i++) {
+		readers[i]->readAll();
+		while(readers[i]->next() != XMLReader::DOCUMENT_END) {
+			if(readers[i]->getType() == XMLReader::ELEMENT_START)
+				numElements++;
+		}
+	}
+	printf("XMLReader: %d elements in %.1f ms\n", numElements, timer.getElapsed());
+	closeFiles(readers);
+	
+	// starts the job pool's threads so that the timing below doesn't include it
+	JobPool *jobPool = core->getJobPool();
+	
+	readers = openFiles();
+	timer.reset();
+	XMLFileParser::readAll(readers);
+	printf("XMLFileParser: %.1f ms with %d pool threads\n", timer.getElapsed(), jobPool->getNumThreads());
+	closeFiles(readers);
+	
+	timer.reset();
+	CoreServices::getInstance()->getResourceManager()->addDirResource(folderPath, false);
+	printf("addDirResource: %d materials in %.1f ms\n", (int)CoreServices::getInstance()->getResourceManager()->getResources(Resource::RESOURCE_MATERIAL).size(), timer.getElapsed());
+}
+
+std::vector<XMLReader*> HelloPolycodeApp::openFiles() {
+	std::vector<XMLReader*> readers;
+	for(int i=0; i < NUM_FILES; i++) {
+		XMLReader *reader = new XMLReader();
+		reader->openFile(folderPath + "/materials" + String::IntToString(i) + ".mat");
+		readers.push_back(reader);
+	}
+	return readers;
+}
+
+void HelloPolycodeApp::closeFiles(std::vector<XMLReader*> &readers) {
+	for(int i=0; i < readers.size(); i++) {
+		delete readers[i];
+	}
+	readers.clear();
+}
@@ -0,0 +1,15 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	std::vector<XMLReader*> openFiles();
+	void closeFiles(std::vector<XMLReader*> &readers);
+
+	String folderPath;
+};
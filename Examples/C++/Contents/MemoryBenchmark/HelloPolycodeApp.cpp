@@ -0,0 +1,109 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Loads a scene like the SkeletalAnimation and 3DParticles examples, with
+// skinned ninjas, particle emitters, a label that changes every frame and
+// mouse input, and runs the same frames with pooling disabled and enabled.
+// Calls to malloc are counted by wrapping malloc itself, so allocations the
+// pools do not know about are included. No window or GPU is needed.
+
+static const int NUM_FRAMES = 600;
+static const int NUM_NINJAS = 20;
+static const int NUM_EMITTERS = 4;
+
+static unsigned int mallocCalls = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	
+	void *malloc(size_t size) {
+		mallocCalls++;
+		return __libc_malloc(size);
+	}
+	
+	void *calloc(size_t count, size_t size) {
+		mallocCalls++;
+		return __libc_calloc(count, size);
+	}
+	
+	void *realloc(void *ptr, size_t size) {
+		mallocCalls++;
+		return __libc_realloc(ptr, size);
+	}
+}
+#endif
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	CoreServices::getInstance()->getResourceManager()->addArchive("Resources/default.pak");
+	CoreServices::getInstance()->getResourceManager()->addDirResource("default", false);
+	CoreServices::getInstance()->getResourceManager()->addDirResource("Resources", false);
+	
+	scene = new Scene();
+	scene->getDefaultCamera()->setPosition(25,25,25);
+	scene->getDefaultCamera()->lookAt(Vector3(0,0,0));
+	
+	for(int i=0; i < NUM_NINJAS; i++) {
+		SceneMesh *mesh = new SceneMesh("Resources/ninja.mesh");
+		mesh->loadTexture("Resources/ninja.png");
+		mesh->setPosition((i % 5) * 4.0 - 8.0, 0, (i / 5) * 4.0 - 8.0);
+		scene->addEntity(mesh);
+		mesh->loadSkeleton("Resources/ninja.skeleton");
+		mesh->getSkeleton()->addAnimation("Run", "Resources/run.anim");
+		mesh->getSkeleton()->playAnimation("Run");
+	}
+	
+	for(int i=0; i < NUM_EMITTERS; i++) {
+		SceneParticleEmitter *emitter = new SceneParticleEmitter("TestParticle", 
+			Particle::BILLBOARD_PARTICLE, ParticleEmitter::CONTINUOUS_EMITTER, 4, 200,
+			Vector3(0.0,1.0,0.0), Vector3(0.0,0.0,0.0), Vector3(0.3, 0.0, 0.3),
+			Vector3(1.5,1.5,1.5));
+		emitter->setPosition(i * 3.0 - 4.5, 0, 0);
+		scene->addEntity(emitter);
+	}
+	
+	screen = new Screen();
+	label = new ScreenLabel("", 16);
+	screen->addChild(label);
+	
+	core->getInput()->addEventListener(this, InputEvent::EVENT_MOUSEMOVE);
+	
+	runFrames(false);
+	runFrames(true);
+}
+
+void HelloPolycodeApp::handleEvent(Event *event) {
+	eventsHandled++;
+}
+
+void HelloPolycodeApp::runFrames(bool pooling) {
+	MemoryPool::setPoolingEnabled(pooling);
+	
+	// one warm up frame so the pools and arrays are at their working size
+	core->Update();
+	
+	MemoryPool::resetAllStats();
+	const MemoryStats &arenaStats = FrameArena::getFrameArena()->getStats();
+	unsigned int arenaAllocations = arenaStats.allocations;
+	eventsHandled = 0;
+	mallocCalls = 0;
+	BenchmarkTimer timer;
+	for(int i=0; i < NUM_FRAMES; i++) {
+		core->getInput()->setMousePosition(i % 640, i % 480, core->getTicks());
+		label->setText("Frame " + String::IntToString(i));
+		core->Update();
+	}
+	Number totalTime = timer.getElapsed();
+	unsigned int frameMallocCalls = mallocCalls;
+	
+	printf("pooling %s: %.2f ms per frame, %.1f malloc calls per frame, %d mouse events\n", pooling ? "on" : "off", totalTime / NUM_FRAMES, (Number)frameMallocCalls / NUM_FRAMES, eventsHandled);
+	
+	for(int i=0; i < MemoryPool::getNumPools(); i++) {
+		const MemoryStats &stats = MemoryPool::getPool(i)->getStats();
+		printf("  %s: %d allocations, %d system allocations, peak %d live\n", stats.tag.c_str(), stats.allocations, stats.systemAllocations, stats.peakLiveAllocations);
+	}
+	
+	printf("  FrameArena: %d allocations, peak %d bytes per frame\n", arenaStats.allocations - arenaAllocations, (int)FrameArena::getFrameArena()->getPeakBytesUsed());
+}
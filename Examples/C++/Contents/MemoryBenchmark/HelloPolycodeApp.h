@@ -0,0 +1,19 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+	void handleEvent(Event *event);
+    
+private:
+
+	void runFrames(bool pooling);
+
+	Scene *scene;
+	Screen *screen;
+	ScreenLabel *label;
+	unsigned int eventsHandled;
+};
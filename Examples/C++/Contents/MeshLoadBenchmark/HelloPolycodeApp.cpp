@@ -0,0 +1,188 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Builds a 512x512 quad grid, writes it in the old per-face-vertex mesh format
+// and in the indexed mesh format, and loads each one in its own child process
+// so the peak memory of every load can be read back separately. It also checks
+// that appending loads and flat normals on loaded meshes stay correct and that
+// a corrupt bone weight count is rejected. No window or GPU is needed.
+
+static const int GRID_SIZE = 512;
+
+static void saveLegacyMesh(Mesh *mesh, const String& fileName) {
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	unsigned int meshType = mesh->getMeshType();
+	OSBasics::write(&meshType, sizeof(unsigned int), 1, outFile);
+	unsigned int numFaces = mesh->getPolygonCount();
+	OSBasics::write(&numFaces, sizeof(unsigned int), 1, outFile);
+	
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *poly = mesh->getPolygon(i);
+		for(int j=0; j < poly->getVertexCount(); j++) {
+			Vertex *v = poly->getVertex(j);
+			Vector3_struct pos = {(float)v->x, (float)v->y, (float)v->z};
+			Vector3_struct nor = {(float)v->normal.x, (float)v->normal.y, (float)v->normal.z};
+			Vector4_struct col = {(float)v->vertexColor.r, (float)v->vertexColor.g, (float)v->vertexColor.b, (float)v->vertexColor.a};
+			Vector2_struct tex = {(float)v->getTexCoord().x, (float)v->getTexCoord().y};
+			OSBasics::write(&pos, sizeof(Vector3_struct), 1, outFile);
+			OSBasics::write(&nor, sizeof(Vector3_struct), 1, outFile);
+			OSBasics::write(&col, sizeof(Vector4_struct), 1, outFile);
+			OSBasics::write(&tex, sizeof(Vector2_struct), 1, outFile);
+			unsigned int numBoneWeights = 0;
+			OSBasics::write(&numBoneWeights, sizeof(unsigned int), 1, outFile);
+		}
+	}
+	OSBasics::close(outFile);
+}
+
+static Mesh *createGridMesh() {
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	Number step = 1.0 / GRID_SIZE;
+	for(int y=0; y < GRID_SIZE; y++) {
+		for(int x=0; x < GRID_SIZE; x++) {
+			Number x0 = x * step, x1 = (x+1) * step;
+			Number y0 = y * step, y1 = (y+1) * step;
+			
+			Polygon *poly = new Polygon();
+			poly->addVertex(x0, 0, y0, x0, y0);
+			poly->addVertex(x1, 0, y0, x1, y0);
+			poly->addVertex(x1, 0, y1, x1, y1);
+			mesh->addPolygon(poly);
+			
+			poly = new Polygon();
+			poly->addVertex(x0, 0, y0, x0, y0);
+			poly->addVertex(x1, 0, y1, x1, y1);
+			poly->addVertex(x0, 0, y1, x0, y1);
+			mesh->addPolygon(poly);
+		}
+	}
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *poly = mesh->getPolygon(i);
+		for(int j=0; j < poly->getVertexCount(); j++) {
+			poly->getVertex(j)->setNormal(0, 1, 0);
+		}
+	}
+	return mesh;
+}
+
+// Saves two triangles folded along a shared edge with smooth normals, so the
+// loader shares the edge vertices, then checks that flat normals computed on
+// the loaded mesh still match each triangle's own face.
+static bool flatNormalsPerFace(const String& fileName) {
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	Polygon *poly = new Polygon();
+	poly->addVertex(0, 0, 0, 0, 0);
+	poly->addVertex(1, 0, 0, 1, 0);
+	poly->addVertex(0, 0, 1, 0, 1);
+	mesh->addPolygon(poly);
+	poly = new Polygon();
+	poly->addVertex(1, 0, 0, 1, 0);
+	poly->addVertex(0, 0, 0, 0, 0);
+	poly->addVertex(0, 1, 0, 0, 1);
+	mesh->addPolygon(poly);
+	mesh->calculateNormals(true);
+	mesh->saveToFile(fileName);
+	delete mesh;
+	
+	mesh = new Mesh(fileName);
+	mesh->calculateNormals(false);
+	bool valid = mesh->getPolygonCount() == 2;
+	for(int i=0; valid && i < mesh->getPolygonCount(); i++) {
+		Polygon *face = mesh->getPolygon(i);
+		Vector3 faceNormal = face->getFaceNormal();
+		for(int j=0; j < face->getVertexCount(); j++) {
+			if((face->getVertex(j)->normal - faceNormal).length() > 0.001)
+				valid = false;
+		}
+	}
+	delete mesh;
+	return valid;
+}
+
+// Writes an old format triangle whose first vertex claims four billion bone
+// weights, which the loader has to reject instead of trying to read them.
+static bool corruptBoneWeightsRejected(const String& fileName) {
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	unsigned int header[2] = {Mesh::TRI_MESH, 1};
+	OSBasics::write(header, sizeof(unsigned int), 2, outFile);
+	char record[sizeof(Vector3_struct) * 2 + sizeof(Vector4_struct) + sizeof(Vector2_struct)];
+	memset(record, 0, sizeof(record));
+	OSBasics::write(record, sizeof(record), 1, outFile);
+	unsigned int numBoneWeights = 0xFFFFFFFF;
+	OSBasics::write(&numBoneWeights, sizeof(unsigned int), 1, outFile);
+	OSBasics::close(outFile);
+	
+	Mesh *mesh = new Mesh(fileName);
+	bool rejected = mesh->getPolygonCount() == 0;
+	delete mesh;
+	return rejected;
+}
+
+// Loads the file in a child process, which prints the load time. Returns the
+// child's peak resident size in KB, or -1 if it failed.
+static long loadInChild(const String& fileName) {
+	pid_t pid = fork();
+	if(pid == 0) {
+		if(fileName != "") {
+			BenchmarkTimer timer;
+			Mesh *mesh = new Mesh(fileName);
+			Number time = timer.getElapsed();
+			printf("  %d polygons in %.1f ms\n", mesh->getPolygonCount(), time);
+			fflush(stdout);
+		}
+		_exit(0);
+	}
+	
+	int status;
+	struct rusage usage;
+	if(pid < 0 || wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status))
+		return -1;
+	return usage.ru_maxrss;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	String legacyPath = core->getDefaultWorkingDirectory() + "/MeshLoadBenchmarkLegacy.mesh";
+	String indexedPath = core->getDefaultWorkingDirectory() + "/MeshLoadBenchmark.mesh";
+	
+	// the grid is built in a child too, so its freed memory does not hide
+	// the loads' allocations from the peak resident sizes below
+	pid_t pid = fork();
+	if(pid == 0) {
+		Mesh *mesh = createGridMesh();
+		saveLegacyMesh(mesh, legacyPath);
+		mesh->saveToFile(indexedPath);
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	printf("Old format: %ld KB, indexed format: %ld KB\n", getFileSize(legacyPath) / 1024, getFileSize(indexedPath) / 1024);
+	
+	long baseline = loadInChild("");
+	
+	printf("Old format load:\n");
+	fflush(stdout);
+	long legacyPeak = loadInChild(legacyPath);
+	printf("  peak memory: %ld KB\n", legacyPeak - baseline);
+	
+	printf("Indexed format load:\n");
+	fflush(stdout);
+	long indexedPeak = loadInChild(indexedPath);
+	printf("  peak memory: %ld KB\n", indexedPeak - baseline);
+	
+	// loading into a mesh that already has polygons has to leave the render
+	// arrays covering all of them
+	Mesh *appended = new Mesh(indexedPath);
+	appended->loadMesh(indexedPath);
+	RenderDataArray *vertexArray = appended->renderDataArrays[RenderDataArray::VERTEX_DATA_ARRAY];
+	bool arraysValid = appended->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] || vertexArray->count == appended->getPolygonCount() * 3;
+	printf("Appended load: %d polygons, render arrays %s\n", appended->getPolygonCount(), arraysValid ? "OK" : "FAILED");
+	delete appended;
+	
+	String foldedPath = core->getDefaultWorkingDirectory() + "/MeshLoadBenchmarkFolded.mesh";
+	printf("Flat normals on a loaded mesh: %s\n", flatNormalsPerFace(foldedPath) ? "OK" : "FAILED");
+	String corruptPath = core->getDefaultWorkingDirectory() + "/MeshLoadBenchmarkCorrupt.mesh";
+	printf("Corrupt bone weight count: %s\n", corruptBoneWeightsRejected(corruptPath) ? "rejected" : "FAILED");
+}
@@ -0,0 +1,102 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Writes a 50000 entity screen entity file as XML and in the binary object
+// format and prints how long each takes to load, how long looking up every
+// entity's fields takes once loaded, and how long building a
+// ScreenEntityInstance from the binary file takes. No window or GPU is needed.
+
+static const int NUM_ENTITIES = 50000;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	String xmlPath = core->getDefaultWorkingDirectory() + "/ObjectLoadBenchmark.xml";
+	String binaryPath = core->getDefaultWorkingDirectory() + "/ObjectLoadBenchmark.entity";
+	
+	Object saveObject;
+	createEntities(&saveObject);
+	
+	BenchmarkTimer timer;
+	saveObject.saveToXML(xmlPath);
+	printf("XML save: %.1f ms\n", timer.getElapsed());
+	
+	timer.reset();
+	saveObject.saveToBinary(binaryPath);
+	printf("Binary save: %.1f ms\n", timer.getElapsed());
+	
+	Object xmlObject;
+	timer.reset();
+	bool loaded = xmlObject.loadFromFile(xmlPath);
+	printf("XML load: %.1f ms%s\n", timer.getElapsed(), loaded ? "" : " (failed)");
+	
+	Object binaryObject;
+	timer.reset();
+	loaded = binaryObject.loadFromFile(binaryPath);
+	printf("Binary load: %.1f ms%s\n", timer.getElapsed(), loaded ? "" : " (failed)");
+	
+	printf("Field lookups: %.1f ms\n", lookupEntities(&binaryObject));
+	
+	timer.reset();
+	ScreenEntityInstance *instance = new ScreenEntityInstance(binaryPath);
+	printf("ScreenEntityInstance: %.1f ms, %d entities\n", timer.getElapsed(), instance->getRootEntity() ? (int)instance->getRootEntity()->getNumChildren() : 0);
+	delete instance;
+}
+
+void HelloPolycodeApp::createEntities(Object *object) {
+	object->root.name = "entity";
+	ObjectEntry *root = object->root.addChild("root");
+	root->addChild("type", "ScreenEntity");
+	root->addChild("colorR", 1.0);
+	root->addChild("colorG", 1.0);
+	root->addChild("colorB", 1.0);
+	root->addChild("colorA", 1.0);
+	root->addChild("blendMode", 0);
+	root->addChild("scaleX", 1.0);
+	root->addChild("scaleY", 1.0);
+	root->addChild("posX", 0.0);
+	root->addChild("posY", 0.0);
+	root->addChild("rotation", 0.0);
+	root->addChild("id", "");
+	root->addChild("tags", "");
+	
+	ObjectEntry *children = root->addChild("children");
+	for(int i=0; i < NUM_ENTITIES; i++) {
+		ObjectEntry *entry = children->addChild("child");
+		entry->addChild("type", "ScreenEntity");
+		entry->addChild("colorR", (Number)(i % 255) / 255.0);
+		entry->addChild("colorG", 0.5);
+		entry->addChild("colorB", 0.25);
+		entry->addChild("colorA", 1.0);
+		entry->addChild("blendMode", 1);
+		entry->addChild("scaleX", 1.0);
+		entry->addChild("scaleY", 1.0);
+		entry->addChild("posX", (Number)(i % 1000));
+		entry->addChild("posY", (Number)(i / 1000));
+		entry->addChild("rotation", (Number)(i % 360));
+		entry->addChild("id", "entity" + String::IntToString(i));
+		entry->addChild("tags", "a,b");
+		
+		ObjectEntry *shape = entry->addChild("ScreenShape");
+		shape->addChild("type", 1);
+		shape->addChild("width", 16.0);
+		shape->addChild("height", 16.0);
+		shape->addChild("strokeEnabled", false);
+	}
+}
+
+Number HelloPolycodeApp::lookupEntities(Object *object) {
+	const char *keys[] = {"type", "colorR", "colorG", "colorB", "colorA", "blendMode", "scaleX", "scaleY", "posX", "posY", "rotation", "id", "tags", "ScreenShape"};
+	BenchmarkTimer timer;
+	ObjectEntry *children = (*object->root["root"])["children"];
+	int found = 0;
+	for(int i=0; i < children->length; i++) {
+		ObjectEntry *entry = (*children)[i];
+		for(int k=0; k < 14; k++) {
+			if((*entry)[keys[k]])
+				found++;
+		}
+	}
+	Number lookupTime = timer.getElapsed();
+	if(found != children->length * 14)
+		printf("Missing fields: %d\n", children->length * 14 - found);
+	return lookupTime;
+}
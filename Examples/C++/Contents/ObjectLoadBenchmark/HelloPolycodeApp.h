@@ -0,0 +1,14 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	void createEntities(Object *object);
+	Number lookupEntities(Object *object);
+
+};
@@ -0,0 +1,142 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Builds a 10000 object scene that uses 100 different meshes, writes it in
+// the old scene format, where every object stores its own copy of its mesh,
+// and in the binary scene format, where objects share mesh blocks, and prints
+// how long loadScene() takes for each. It also checks that turning vertex
+// normals off on one object leaves the other objects sharing its mesh alone.
+// No window or GPU is needed.
+
+static const int NUM_OBJECTS = 10000;
+static const int NUM_MESHES = 100;
+
+void BenchmarkScene::addStaticMesh(SceneMesh *mesh) {
+	addEntity(mesh);
+	staticGeometry.push_back(mesh);
+}
+
+void BenchmarkScene::saveLegacyScene(const String& fileName) {
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	
+	Number colors[6] = {clearColor.r, clearColor.g, clearColor.b, ambientColor.r, ambientColor.g, ambientColor.b};
+	OSBasics::write(colors, sizeof(Number), 6, outFile);
+	char flag = 0;
+	OSBasics::write(&flag, 1, 1, outFile);
+	unsigned int numObjects = staticGeometry.size();
+	OSBasics::write(&numObjects, sizeof(unsigned int), 1, outFile);
+	
+	for(int i=0; i < staticGeometry.size(); i++) {
+		SceneMesh *mesh = staticGeometry[i];
+		writeEntityMatrix(mesh, outFile);
+		unsigned int objectType = ENTITY_MESH;
+		OSBasics::write(&objectType, sizeof(unsigned int), 1, outFile);
+		writeString("", outFile);
+		Number color[4] = {mesh->color.r, mesh->color.g, mesh->color.b, mesh->color.a};
+		OSBasics::write(color, sizeof(Number), 4, outFile);
+		mesh->getMesh()->saveToFile(outFile);
+		
+		unsigned int numProps = mesh->entityProps.size();
+		OSBasics::write(&numProps, sizeof(unsigned int), 1, outFile);
+		for(int j=0; j < numProps; j++) {
+			writeString(mesh->entityProps[j].propName, outFile);
+			writeString(mesh->entityProps[j].propValue, outFile);
+		}
+	}
+	OSBasics::close(outFile);
+}
+
+static Number loadSceneTime(const String& fileName, int *numObjects) {
+	Scene *scene = new Scene(true);
+	scene->ownsChildren = true;
+	BenchmarkTimer timer;
+	scene->loadScene(fileName);
+	Number time = timer.getElapsed();
+	*numObjects = scene->getNumStaticGeometry();
+	delete scene;
+	return time;
+}
+
+// Saves three objects sharing one mesh, the middle one with vertex normals
+// turned off, and checks which of the loaded objects use vertex normals.
+static bool flatNormalsPerObject(const String& fileName) {
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	mesh->createBox(1.0, 1.0, 1.0);
+	BenchmarkScene *scene = new BenchmarkScene();
+	scene->ownsChildren = true;
+	for(int i=0; i < 3; i++) {
+		SceneMesh *sceneMesh = new SceneMesh(mesh);
+		sceneMesh->ownsMesh = false;
+		if(i == 1) {
+			EntityProp prop;
+			prop.propName = "vertexnormals";
+			prop.propValue = "false";
+			sceneMesh->entityProps.push_back(prop);
+		}
+		scene->addStaticMesh(sceneMesh);
+	}
+	scene->saveScene(fileName);
+	delete scene;
+	delete mesh;
+	
+	Scene *loaded = new Scene(true);
+	loaded->ownsChildren = true;
+	loaded->loadScene(fileName);
+	bool valid = loaded->getNumStaticGeometry() == 3;
+	for(int i=0; valid && i < 3; i++) {
+		Mesh *loadedMesh = loaded->getStaticGeometry(i)->getMesh();
+		if(loadedMesh->getPolygonCount() == 0 || loadedMesh->getPolygon(0)->useVertexNormals != (i != 1))
+			valid = false;
+	}
+	delete loaded;
+	return valid;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	String legacyPath = core->getDefaultWorkingDirectory() + "/SceneLoadBenchmarkLegacy.scene";
+	String binaryPath = core->getDefaultWorkingDirectory() + "/SceneLoadBenchmark.scene";
+	
+	std::vector<Mesh*> meshes;
+	for(int i=0; i < NUM_MESHES; i++) {
+		Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+		if(i % 2 == 0) {
+			mesh->createSphere(0.5 + (i * 0.01), 8, 8);
+		} else {
+			mesh->createBox(1.0 + (i * 0.01), 1.0, 1.0);
+		}
+		meshes.push_back(mesh);
+	}
+	
+	BenchmarkScene *scene = new BenchmarkScene();
+	for(int i=0; i < NUM_OBJECTS; i++) {
+		SceneMesh *sceneMesh = new SceneMesh(meshes[i % NUM_MESHES]);
+		sceneMesh->ownsMesh = false;
+		sceneMesh->setPosition((i % 100) * 2.0, 0.0, (i / 100) * 2.0);
+		sceneMesh->setRotationQuat(1.0, 0.0, 0.0, 0.0);
+		sceneMesh->setColor(1.0, 1.0, 1.0, 1.0);
+		EntityProp prop;
+		prop.propName = "group";
+		prop.propValue = "group" + String::IntToString(i % 10);
+		sceneMesh->entityProps.push_back(prop);
+		scene->addStaticMesh(sceneMesh);
+	}
+	
+	scene->saveLegacyScene(legacyPath);
+	BenchmarkTimer timer;
+	scene->saveScene(binaryPath);
+	printf("Binary save: %.1f ms\n", timer.getElapsed());
+	printf("Old format: %ld KB, binary format: %ld KB\n", getFileSize(legacyPath) / 1024, getFileSize(binaryPath) / 1024);
+	
+	int numObjects;
+	Number legacyTime = loadSceneTime(legacyPath, &numObjects);
+	printf("Old format load: %d objects in %.1f ms\n", numObjects, legacyTime);
+	
+	// the first load starts the job pool threads, so load twice
+	Number binaryTime = loadSceneTime(binaryPath, &numObjects);
+	printf("Binary format load: %d objects in %.1f ms (first load)\n", numObjects, binaryTime);
+	binaryTime = loadSceneTime(binaryPath, &numObjects);
+	printf("Binary format load: %d objects in %.1f ms\n", numObjects, binaryTime);
+	
+	String flatPath = core->getDefaultWorkingDirectory() + "/SceneLoadBenchmarkFlat.scene";
+	printf("Vertex normals off on a shared mesh: %s\n", flatNormalsPerObject(flatPath) ? "OK" : "FAILED");
+}
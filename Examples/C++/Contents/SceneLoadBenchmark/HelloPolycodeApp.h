@@ -0,0 +1,22 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+/**
+* Scene that static geometry can be added to directly, the way loadScene() adds it.
+*/
+class BenchmarkScene : public Scene {
+public:
+	BenchmarkScene() : Scene(true) {}
+	
+	void addStaticMesh(SceneMesh *mesh);
+	void saveLegacyScene(const String& fileName);
+};
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+};
@@ -0,0 +1,61 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Draws a UI-like screen of a few thousand quads, grouped into panels that
+// share a texture, with and without sprite batching, and prints the draw
+// calls and batches per frame. No window or GPU is needed.
+
+static const int NUM_FRAMES = 300;
+static const int NUM_PANELS = 30;
+static const int QUADS_PER_PANEL = 100;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(1280, 720) {
+	screen = new Screen();
+	
+	Texture *textures[2];
+	for(int i=0; i < 2; i++) {
+		Image *image = new Image(64, 64);
+		image->fill(1.0, i, 1.0 - i, 1.0);
+		textures[i] = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(image, true, false);
+		delete image;
+	}
+	
+	for(int i=0; i < NUM_PANELS; i++) {
+		ScreenEntity *panel = new ScreenEntity();
+		panel->setPosition((i % 6) * 200, (i / 6) * 140);
+		// every few panels clip their contents, which starts a new batch
+		if(i % 5 == 0) {
+			panel->enableScissor = true;
+			panel->scissorBox = Polycode::Rectangle((i % 6) * 200, (i / 6) * 140, 190, 130);
+		}
+		screen->addChild(panel);
+		
+		for(int j=0; j < QUADS_PER_PANEL; j++) {
+			ScreenShape *quad = new ScreenShape(ScreenShape::SHAPE_RECT, 16, 10);
+			quad->setPosition((j % 10) * 18, (j / 10) * 12);
+			quad->setTexture(textures[i % 2]);
+			quad->setColor(1.0, 1.0, 1.0, 0.5 + (j % 2) * 0.5);
+			panel->addChild(quad);
+		}
+	}
+	
+	runFrames(false);
+	runFrames(true);
+}
+
+void HelloPolycodeApp::runFrames(bool batching) {
+	screen->setSpriteBatching(batching);
+	RecordingRenderer *renderer = core->getRecordingRenderer();
+	
+	BenchmarkTimer timer;
+	unsigned int drawCalls = 0;
+	unsigned int batches = 0;
+	for(int i=0; i < NUM_FRAMES; i++) {
+		core->Update();
+		drawCalls += renderer->getDrawCallCount();
+		batches += renderer->getSpriteBatchCount();
+	}
+	Number totalTime = timer.getElapsed();
+	
+	printf("batching %s: %.2f ms per frame, %d draw calls per frame, %d batches per frame, %d state changes in the last frame\n", batching ? "on" : "off", totalTime / NUM_FRAMES, drawCalls / NUM_FRAMES, batches / NUM_FRAMES, renderer->getStateChangeCount());
+}
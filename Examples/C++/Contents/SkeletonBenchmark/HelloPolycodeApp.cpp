@@ -0,0 +1,113 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Animates 100 copies of the ninja skeleton from the SkeletalAnimation
+// example and prints how many skeletons are updated per millisecond, first
+// playing one animation and then cross-fading between two. Before timing, it
+// checks that a playing animation actually moves the bones away from the bind
+// pose, and that a truncated skeleton file loads no bones. No window or GPU is
+// needed.
+
+static const int NUM_SKELETONS = 100;
+static const int NUM_FRAMES = 600;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	std::vector<Skeleton*> skeletons;
+	for(int i=0; i < NUM_SKELETONS; i++) {
+		Skeleton *skeleton = new Skeleton("Resources/ninja.skeleton");
+		skeleton->addAnimation("Run", "Resources/run.anim");
+		skeleton->addAnimation("RunFast", "Resources/run.anim");
+		skeleton->getAnimation("RunFast")->setSpeed(2.0);
+		skeletons.push_back(skeleton);
+	}
+	if(skeletons[0]->getNumBones() == 0 || !skeletons[0]->getAnimation("Run")) {
+		printf("Could not load Resources/ninja.skeleton and Resources/run.anim\n");
+		return;
+	}
+	
+	if(!truncatedSkeletonRejected(skeletons[0]->getNumBones())) {
+		printf("FAILED: a truncated skeleton file still loaded bones\n");
+		return;
+	}
+	printf("Truncated skeleton files are rejected\n");
+	
+	std::vector<Matrix4> bindMatrices;
+	for(int i=0; i < skeletons[0]->getNumBones(); i++) {
+		bindMatrices.push_back(skeletons[0]->getBone(i)->getBoneMatrix());
+	}
+	skeletons[0]->playAnimation("Run");
+	for(int i=0; i < 10; i++) {
+		core->Update();
+		skeletons[0]->Update();
+	}
+	if(!bonesMoved(skeletons[0], bindMatrices)) {
+		printf("FAILED: playing Run left every bone in the bind pose\n");
+		return;
+	}
+	printf("Playing Run moves the bones\n");
+	
+	for(int i=0; i < skeletons.size(); i++) {
+		skeletons[i]->playAnimation("Run");
+	}
+	Number time = runBenchmark(skeletons, NUM_FRAMES);
+	printf("One animation: %d skeletons of %d bones, %.3f ms per frame, %.1f skeletons per ms\n", NUM_SKELETONS, skeletons[0]->getNumBones(), time / NUM_FRAMES, (NUM_SKELETONS * NUM_FRAMES) / time);
+	
+	// cross-fades back and forth, so two animations are blended most of the time
+	for(int i=0; i < skeletons.size(); i++) {
+		skeletons[i]->crossFadeAnimation("RunFast", 5.0);
+	}
+	time = runBenchmark(skeletons, NUM_FRAMES);
+	printf("Cross-fade: %.3f ms per frame, %.1f skeletons per ms\n", time / NUM_FRAMES, (NUM_SKELETONS * NUM_FRAMES) / time);
+	
+	for(int i=0; i < skeletons.size(); i++) {
+		delete skeletons[i];
+	}
+}
+
+Number HelloPolycodeApp::runBenchmark(std::vector<Skeleton*> &skeletons, int numFrames) {
+	Number totalTime = 0;
+	for(int i=0; i < numFrames; i++) {
+		core->Update();
+		BenchmarkTimer timer;
+		for(int j=0; j < skeletons.size(); j++) {
+			skeletons[j]->Update();
+		}
+		totalTime += timer.getElapsed();
+	}
+	return totalTime;
+}
+
+bool HelloPolycodeApp::truncatedSkeletonRejected(int numBones) {
+	FILE *inFile = fopen("Resources/ninja.skeleton", "rb");
+	if(!inFile)
+		return false;
+	std::vector<char> data;
+	char buffer[4096];
+	size_t count;
+	while((count = fread(buffer, 1, sizeof(buffer), inFile)) > 0)
+		data.insert(data.end(), buffer, buffer + count);
+	fclose(inFile);
+	
+	// cut the file in the middle of the bone list
+	FILE *outFile = fopen("truncated.skeleton", "wb");
+	if(!outFile)
+		return false;
+	fwrite(&data[0], 1, data.size() / 2, outFile);
+	fclose(outFile);
+	
+	Skeleton *skeleton = new Skeleton("truncated.skeleton");
+	bool rejected = numBones > 1 && skeleton->getNumBones() == 0;
+	delete skeleton;
+	return rejected;
+}
+
+bool HelloPolycodeApp::bonesMoved(Skeleton *skeleton, const std::vector<Matrix4> &bindMatrices) {
+	for(int i=0; i < skeleton->getNumBones(); i++) {
+		Matrix4 boneMatrix = skeleton->getBone(i)->getBoneMatrix();
+		for(int j=0; j < 16; j++) {
+			if(fabs(boneMatrix.ml[j] - bindMatrices[i].ml[j]) > 0.001)
+				return true;
+		}
+	}
+	return false;
+}
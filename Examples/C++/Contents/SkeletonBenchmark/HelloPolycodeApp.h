@@ -0,0 +1,15 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	Number runBenchmark(std::vector<Skeleton*> &skeletons, int numFrames);
+	bool bonesMoved(Skeleton *skeleton, const std::vector<Matrix4> &bindMatrices);
+	bool truncatedSkeletonRejected(int numBones);
+
+};
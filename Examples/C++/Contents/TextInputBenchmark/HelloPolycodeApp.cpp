@@ -0,0 +1,116 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Loads a 100000 line Lua file into a highlighted multi-line UITextInput,
+// puts the caret in the middle of it and types, and prints the average time
+// from a key press to the end of the next frame. Also opens and closes a block
+// comment, which changes the highlighting of every line below it, and undoes
+// an edit in the middle of the file. Needs the default UI theme from the IDE
+// resources next to the binary. No window or GPU is needed.
+
+static const int NUM_LINES = 100000;
+static const int NUM_KEYSTROKES = 200;
+
+BlockCommentHighlighter::BlockCommentHighlighter() {
+	linesParsed = 0;
+}
+
+std::vector<SyntaxHighlightToken> BlockCommentHighlighter::parseText(String text) {
+	int endState;
+	return parseLine(text, 0, &endState);
+}
+
+std::vector<SyntaxHighlightToken> BlockCommentHighlighter::parseLine(String text, int startState, int *endState) {
+	linesParsed++;
+	std::vector<SyntaxHighlightToken> tokens;
+	int state = startState;
+	std::vector<String> words = text.split(" ");
+	for(int i=0; i < words.size(); i++) {
+		if(words[i] == "--[[")
+			state = 1;
+		SyntaxHighlightToken token(words[i] + " ", state);
+		token.color = state ? Color(0.0, 0.5, 0.0, 1.0) : Color(0.0, 0.0, 0.0, 1.0);
+		tokens.push_back(token);
+		if(words[i] == "]]")
+			state = 0;
+	}
+	*endState = state;
+	return tokens;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(1280, 720) {
+	CoreServices::getInstance()->getConfig()->loadConfig("Polycode", "UIThemes/default/theme.xml");
+	CoreServices::getInstance()->getResourceManager()->addArchive("UIThemes/default/");
+	screen = new Screen();
+	
+	String text;
+	for(int i=0; i < NUM_LINES; i++) {
+		text += "local value" + String::IntToString(i) + " = math.sin(" + String::IntToString(i) + ") * scale\n";
+	}
+	
+	BlockCommentHighlighter *highlighter = new BlockCommentHighlighter();
+	UITextInput *textInput = new UITextInput(true, 800, 700);
+	textInput->setSyntaxHighlighter(highlighter);
+	screen->addChild(textInput);
+	textInput->hasFocus = true;
+	
+	BenchmarkTimer timer;
+	textInput->setText(text);
+	core->Update();
+	Number loadTime = timer.getElapsed();
+	printf("Loaded %d lines in %.1f ms\n", NUM_LINES, loadTime);
+	
+	// puts the caret on the middle line and scrolls to it
+	textInput->findString("value" + String::IntToString(NUM_LINES / 2) + " ");
+	textInput->onKeyDown(KEY_LEFT, 0);
+	textInput->onKeyDown(KEY_UP, 0);
+	textInput->onKeyDown(KEY_DOWN, 0);
+	core->Update();
+	
+	highlighter->linesParsed = 0;
+	Number keyTime = typeCharacters(textInput, NUM_KEYSTROKES);
+	printf("Typing: %.3f ms per keystroke, %.1f lines highlighted per keystroke\n", keyTime, (Number)highlighter->linesParsed / NUM_KEYSTROKES);
+	
+	highlighter->linesParsed = 0;
+	timer.reset();
+	textInput->insertText("--[[ ");
+	core->Update();
+	textInput->insertText(" ]]");
+	core->Update();
+	Number commentTime = timer.getElapsed() / 2.0;
+	printf("Block comment: %.3f ms per edit, %d lines highlighted\n", commentTime, highlighter->linesParsed);
+	
+	highlighter->linesParsed = 0;
+	timer.reset();
+	for(int i=0; i < NUM_KEYSTROKES; i++) {
+		textInput->onKeyDown(KEY_BACKSPACE, 0);
+		core->Update();
+	}
+	Number backspaceTime = timer.getElapsed() / NUM_KEYSTROKES;
+	printf("Backspace: %.3f ms per keystroke\n", backspaceTime);
+	
+	timer.reset();
+	for(int i=0; i < NUM_KEYSTROKES; i++) {
+		textInput->onKeyDown(KEY_RETURN, 0);
+		core->Update();
+	}
+	Number returnTime = timer.getElapsed() / NUM_KEYSTROKES;
+	printf("Return: %.3f ms per keystroke\n", returnTime);
+	
+	highlighter->linesParsed = 0;
+	timer.reset();
+	textInput->Undo();
+	core->Update();
+	Number undoTime = timer.getElapsed();
+	printf("Undo: %.3f ms, %d lines highlighted\n", undoTime, highlighter->linesParsed);
+}
+
+Number HelloPolycodeApp::typeCharacters(UITextInput *textInput, int count) {
+	const char *characters = "print(value) ";
+	BenchmarkTimer timer;
+	for(int i=0; i < count; i++) {
+		textInput->onKeyDown(KEY_UNKNOWN, characters[i % 13]);
+		core->Update();
+	}
+	return timer.getElapsed() / count;
+}
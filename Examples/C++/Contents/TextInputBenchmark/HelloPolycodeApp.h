@@ -0,0 +1,25 @@
+#include <PolycodeUI.h>
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class BlockCommentHighlighter : public UITextInputSyntaxHighlighter {
+public:
+	BlockCommentHighlighter();
+	
+	std::vector<SyntaxHighlightToken> parseText(String text);
+	std::vector<SyntaxHighlightToken> parseLine(String text, int startState, int *endState);
+	
+	int linesParsed;
+};
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	Number typeCharacters(UITextInput *textInput, int count);
+
+	Screen *screen;
+};
@@ -0,0 +1,139 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+#include <time.h>
+#include <utime.h>
+
+// Writes 300 PNG textures and their cooked .ptex versions and prints how long
+// createTextureFromFile() takes for all of them at startup, decoding the PNGs
+// and loading the cooked files. The recording renderer doesn't upload to a
+// GPU, so gluBuild2DMipmaps isn't part of the PNG time. It also checks that a
+// .ptex older than its PNG is ignored and that odd sized textures survive
+// being cooked and loaded again. No window or GPU is needed.
+
+static const int NUM_TEXTURES = 300;
+static const int TEXTURE_SIZE = 256;
+
+static Image *createTestImage(int index) {
+	Image *image = new Image(TEXTURE_SIZE, TEXTURE_SIZE);
+	for(int y=0; y < TEXTURE_SIZE; y++) {
+		for(int x=0; x < TEXTURE_SIZE; x++) {
+			Number noise = (Number)(rand() % 32) / 255.0;
+			image->setPixel(x, y, (Number)x / TEXTURE_SIZE, (Number)y / TEXTURE_SIZE, (Number)(index % 10) / 10.0 + noise, 1.0);
+		}
+	}
+	return image;
+}
+
+// cooks an image, loads it again and checks the full size level against the
+// image and every smaller level against a 2x2 box filter of the one before
+static bool roundTripCookedTexture(const String& path, int width, int height, int type) {
+	unsigned int pixelSize = (type == Image::IMAGE_RGB) ? 3 : 4;
+	std::vector<char> data(width * height * pixelSize);
+	for(int i=0; i < data.size(); i++) {
+		data[i] = (char)(rand() % 256);
+	}
+	Image *image = new Image(&data[0], width, height, type);
+	const char *pixels = &data[0];
+	
+	CookedTexture cookedTexture;
+	bool ok = CookedTexture::cookImage(image, path, 0, false) && cookedTexture.loadFromFile(path);
+	ok = ok && cookedTexture.getType() == type && memcmp(cookedTexture.getLevelData(0), pixels, width * height * pixelSize) == 0;
+	delete image;
+	
+	for(unsigned int level=1; ok && level < cookedTexture.getNumLevels(); level++) {
+		const unsigned char *src = (const unsigned char*)cookedTexture.getLevelData(level-1);
+		const unsigned char *dst = (const unsigned char*)cookedTexture.getLevelData(level);
+		unsigned int srcWidth = cookedTexture.getLevelWidth(level-1);
+		unsigned int srcHeight = cookedTexture.getLevelHeight(level-1);
+		for(unsigned int y=0; ok && y < cookedTexture.getLevelHeight(level); y++) {
+			for(unsigned int x=0; ok && x < cookedTexture.getLevelWidth(level); x++) {
+				unsigned int x0 = std::min(x*2, srcWidth-1), x1 = std::min(x*2+1, srcWidth-1);
+				unsigned int y0 = std::min(y*2, srcHeight-1), y1 = std::min(y*2+1, srcHeight-1);
+				for(unsigned int c=0; c < pixelSize; c++) {
+					unsigned int sum = src[(y0*srcWidth+x0)*pixelSize+c] + src[(y0*srcWidth+x1)*pixelSize+c] + src[(y1*srcWidth+x0)*pixelSize+c] + src[(y1*srcWidth+x1)*pixelSize+c];
+					if(dst[(y*cookedTexture.getLevelWidth(level)+x)*pixelSize+c] != (sum + 2) >> 2)
+						ok = false;
+				}
+			}
+		}
+	}
+	
+	printf("Round trip %dx%d %s: %s\n", width, height, type == Image::IMAGE_RGB ? "RGB" : "RGBA", ok ? "ok" : "FAILED");
+	OSBasics::removeItem(path);
+	return ok;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();
+	
+	String folder = core->getDefaultWorkingDirectory() + "/TextureStartupBenchmark";
+	OSBasics::createFolder(folder);
+	
+	for(int i=0; i < NUM_TEXTURES; i++) {
+		String path = folder + "/texture" + String::IntToString(i) + ".png";
+		Image *image = createTestImage(i);
+		image->savePNG(path);
+		delete image;
+		image = new Image(path);
+		CookedTexture::cookImage(image, CookedTexture::getCookedPath(path), CookedTexture::hashFile(path), materialManager->premultiplyAlphaOnLoad);
+		delete image;
+		texturePaths.push_back(path);
+	}
+	
+	Number pngTime = loadTextures(false);
+	printf("PNG textures: %d in %.1f ms, %.2f ms each\n", NUM_TEXTURES, pngTime, pngTime / NUM_TEXTURES);
+	Number cookedTime = loadTextures(true);
+	printf("Cooked textures: %d in %.1f ms, %.2f ms each\n", NUM_TEXTURES, cookedTime, cookedTime / NUM_TEXTURES);
+	
+	// cook a different image, then make the cooked file older than the PNG,
+	// as if the PNG had been edited after cooking
+	String stalePath = folder + "/stale.png";
+	Image *image = new Image(TEXTURE_SIZE, TEXTURE_SIZE);
+	image->fill(0, 0, 1, 1);
+	image->savePNG(stalePath);
+	delete image;
+	image = new Image(stalePath);
+	CookedTexture::cookImage(image, CookedTexture::getCookedPath(stalePath), CookedTexture::hashFile(stalePath), materialManager->premultiplyAlphaOnLoad);
+	image->fill(1, 0, 0, 1);
+	image->savePNG(stalePath);
+	delete image;
+	struct utimbuf times;
+	times.actime = time(NULL) - 3600;
+	times.modtime = times.actime;
+	utime(CookedTexture::getCookedPath(stalePath).c_str(), &times);
+	
+	Texture *texture = materialManager->createTextureFromFile(stalePath);
+	unsigned char *pixel = (unsigned char*)texture->getTextureData();
+	printf("Stale cooked texture %s\n", (pixel[0] == 255 && pixel[2] == 0) ? "ignored" : "FAILED: loaded instead of the edited PNG");
+	materialManager->deleteTexture(texture);
+	
+	roundTripCookedTexture(folder + "/roundtrip.ptex", 33, 33, Image::IMAGE_RGBA);
+	roundTripCookedTexture(folder + "/roundtrip.ptex", 100, 50, Image::IMAGE_RGBA);
+	roundTripCookedTexture(folder + "/roundtrip.ptex", 640, 480, Image::IMAGE_RGB);
+	roundTripCookedTexture(folder + "/roundtrip.ptex", 6, 1, Image::IMAGE_RGBA);
+	roundTripCookedTexture(folder + "/roundtrip.ptex", 17, 9, Image::IMAGE_RGB);
+	
+	texturePaths.push_back(stalePath);
+	for(int i=0; i < texturePaths.size(); i++) {
+		OSBasics::removeItem(texturePaths[i]);
+		OSBasics::removeItem(CookedTexture::getCookedPath(texturePaths[i]));
+	}
+	OSBasics::removeItem(folder);
+}
+
+Number HelloPolycodeApp::loadTextures(bool useCookedTextures) {
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();
+	materialManager->useCookedTextures = useCookedTextures;
+	
+	std::vector<Texture*> textures;
+	BenchmarkTimer timer;
+	for(int i=0; i < texturePaths.size(); i++) {
+		textures.push_back(materialManager->createTextureFromFile(texturePaths[i]));
+	}
+	Number time = timer.getElapsed();
+	
+	for(int i=0; i < textures.size(); i++) {
+		materialManager->deleteTexture(textures[i]);
+	}
+	return time;
+}
@@ -0,0 +1,14 @@
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	Number loadTextures(bool useCookedTextures);
+
+	std::vector<String> texturePaths;
+};
@@ -0,0 +1,77 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Builds a project-browser-like tree of folders full of files, expands every
+// folder and scrolls from top to bottom, once with UITreeContainer and once
+// with UIVirtualTreeContainer, and prints how long building and scrolling
+// took. Needs the default UI theme from the IDE resources next to the binary.
+// No window or GPU is needed.
+
+static const int NUM_FRAMES = 300;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(1280, 720) {
+	CoreServices::getInstance()->getConfig()->loadConfig("Polycode", "UIThemes/default/theme.xml");
+	CoreServices::getInstance()->getResourceManager()->addArchive("UIThemes/default/");
+	screen = new Screen();
+	
+	// every UITree node creates its own entities and label texture, so it gets a tenth of the nodes
+	benchmarkTree(10, 1000);
+	benchmarkVirtualTree(100, 1000);
+}
+
+void HelloPolycodeApp::benchmarkTree(int numFolders, int filesPerFolder) {
+	BenchmarkTimer timer;
+	UITreeContainer *tree = new UITreeContainer("folder.png", "Project", 250, 700);
+	screen->addChild(tree);
+	for(int i=0; i < numFolders; i++) {
+		UITree *folder = tree->getRootNode()->addTreeChild("folder.png", "folder" + String::IntToString(i));
+		for(int j=0; j < filesPerFolder; j++) {
+			folder->addTreeChild("file.png", "file" + String::IntToString(j) + ".lua");
+		}
+		folder->toggleCollapsed();
+	}
+	tree->getRootNode()->toggleCollapsed();
+	Number buildTime = timer.getElapsed();
+	
+	Number contentHeight = tree->getRootNode()->getHeight();
+	timer.reset();
+	for(int i=0; i < NUM_FRAMES; i++) {
+		tree->scrollChild->setPositionY(-(contentHeight - 700) * i / NUM_FRAMES);
+		core->Update();
+	}
+	Number frameTime = timer.getElapsed() / NUM_FRAMES;
+	
+	printf("UITreeContainer, %d nodes: built in %.1f ms, %.3f ms per frame while scrolling\n", numFolders * (filesPerFolder + 1) + 1, buildTime, frameTime);
+	
+	screen->removeChild(tree);
+	delete tree;
+}
+
+void HelloPolycodeApp::benchmarkVirtualTree(int numFolders, int filesPerFolder) {
+	BenchmarkTimer timer;
+	UIVirtualTreeContainer *tree = new UIVirtualTreeContainer("folder.png", "Project", 250, 700);
+	screen->addChild(tree);
+	for(int i=0; i < numFolders; i++) {
+		UIVirtualTreeNode *folder = tree->getRootNode()->addTreeChild("folder.png", "folder" + String::IntToString(i));
+		for(int j=0; j < filesPerFolder; j++) {
+			folder->addTreeChild("file.png", "file" + String::IntToString(j) + ".lua");
+		}
+		folder->toggleCollapsed();
+	}
+	tree->getRootNode()->toggleCollapsed();
+	tree->refreshTree();
+	Number buildTime = timer.getElapsed();
+	
+	Number contentHeight = tree->getNumVisibleNodes() * CoreServices::getInstance()->getConfig()->getNumericValue("Polycode", "uiTreeCellHeight");
+	timer.reset();
+	for(int i=0; i < NUM_FRAMES; i++) {
+		tree->scrollChild->setPositionY(-(contentHeight - 700) * i / NUM_FRAMES);
+		core->Update();
+	}
+	Number frameTime = timer.getElapsed() / NUM_FRAMES;
+	
+	printf("UIVirtualTreeContainer, %d nodes: built in %.1f ms, %.3f ms per frame while scrolling, %d pooled rows\n", tree->getNumVisibleNodes(), buildTime, frameTime, tree->getNumRows());
+	
+	screen->removeChild(tree);
+	delete tree;
+}
@@ -0,0 +1,16 @@
+#include <PolycodeUI.h>
+#include "BenchmarkApp.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	void benchmarkTree(int numFolders, int filesPerFolder);
+	void benchmarkVirtualTree(int numFolders, int filesPerFolder);
+
+	Screen *screen;
+};
@@ -0,0 +1,77 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Plays hundreds of looping positional sounds scattered around a listener that
+// moves through them, and prints how long the sound manager took per frame and
+// how many of the sounds were heard. To run without an audio device, use
+// OpenAL Soft's null backend: ALSOFT_DRIVERS=null
+
+static const int SAMPLE_FREQUENCY = 22050;
+static const Number FIELD_SIZE = 400.0;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	printf("voices: %d\n", CoreServices::getInstance()->getSoundManager()->getMaxVoices());
+	runBenchmark(64, 600);
+	runBenchmark(256, 600);
+	runBenchmark(1024, 600);
+}
+
+void HelloPolycodeApp::runBenchmark(int numSounds, int numFrames) {
+	SoundManager *soundManager = CoreServices::getInstance()->getSoundManager();
+	
+	short samples[SAMPLE_FREQUENCY];
+	for(int i=0; i < SAMPLE_FREQUENCY; i++) {
+		samples[i] = (short)(sin(i * 220.0 * 2.0 * PI / SAMPLE_FREQUENCY) * 8000);
+	}
+	
+	srand(1);
+	std::vector<Sound*> sounds;
+	for(int i=0; i < numSounds; i++) {
+		Sound *sound = new Sound((const char*)samples, sizeof(samples), 1, SAMPLE_FREQUENCY, 16);
+		sound->setIsPositional(true);
+		sound->setPositionalProperties(5.0, 60.0);
+		sound->setSoundPosition(Vector3(RANDOM_NUMBER * FIELD_SIZE, 0.0, RANDOM_NUMBER * FIELD_SIZE));
+		// a few sounds that should always be heard, wherever they are
+		if(i % 100 == 0)
+			sound->setPriority(1);
+		sound->Play(true);
+		sounds.push_back(sound);
+	}
+	
+	bool profilerEnabled = Profiler::isEnabled();
+	Profiler::setEnabled(true);
+	
+	Number totalTime = 0.0;
+	Number worstTime = 0.0;
+	int totalVirtual = 0;
+	for(int i=0; i < numFrames; i++) {
+		Number t = ((Number)i) / numFrames;
+		soundManager->setListenerPosition(Vector3(t * FIELD_SIZE, 0.0, t * FIELD_SIZE));
+		
+		// keep every sound moving, as sound entities do
+		for(int j=0; j < sounds.size(); j++) {
+			sounds[j]->setSoundPosition(Vector3(RANDOM_NUMBER * FIELD_SIZE, 0.0, RANDOM_NUMBER * FIELD_SIZE));
+		}
+		
+		core->Update();
+		
+		const ProfilerFrameStats &stats = Profiler::getLastFrameStats();
+		for(int j=0; j < stats.zones.size(); j++) {
+			if(String(stats.zones[j].name) == "SoundManager::Update") {
+				totalTime += stats.zones[j].totalTime;
+				if(stats.zones[j].totalTime > worstTime)
+					worstTime = stats.zones[j].totalTime;
+			}
+		}
+		totalVirtual += soundManager->getNumVirtualSounds();
+	}
+	
+	Profiler::setEnabled(profilerEnabled);
+	
+	printf("%d sounds: sound manager %.3f ms per frame (worst %.3f ms), %.1f sounds virtual on average\n", numSounds, totalTime / numFrames, worstTime, ((Number)totalVirtual) / numFrames);
+	
+	for(int i=0; i < sounds.size(); i++) {
+		delete sounds[i];
+	}
+}
@@ -0,0 +1,69 @@
+-- Measures the cost of calling into the engine from Lua.
+-- Run it once per binding version and compare the calls per second.
+
+ITERATIONS = 200000
+
+screen = Screen()
+parent = ScreenEntity()
+entity = ScreenEntity()
+parent:addChild(entity)
+screen:addChild(parent)
+
+label = ScreenLabel("", 14)
+label:setPosition(10, 10)
+screen:addChild(label)
+
+results = ""
+
+function benchmark(name, func)
+	collectgarbage("collect")
+	local memoryBefore = collectgarbage("count")
+	local startTime = os.clock()
+	func()
+	local elapsed = os.clock() - startTime
+	local memoryAfter = collectgarbage("count")
+	local callsPerSecond = 0
+	if elapsed > 0 then
+		callsPerSecond = ITERATIONS / elapsed
+	end
+	local line = string.format("%-24s %12.0f calls/sec %10.1f KB garbage", name, callsPerSecond, memoryAfter - memoryBefore)
+	print(line)
+	results = results..line.."\n"
+end
+
+benchmark("setPosition", function()
+	for i=1,ITERATIONS do
+		entity:setPosition(i, i)
+	end
+end)
+
+benchmark("getPosition", function()
+	local x = 0
+	for i=1,ITERATIONS do
+		x = x + entity:getPosition().x
+	end
+end)
+
+benchmark("position.x", function()
+	local x = 0
+	for i=1,ITERATIONS do
+		x = x + entity.position.x
+	end
+end)
+
+benchmark("getParentEntity", function()
+	local p = nil
+	for i=1,ITERATIONS do
+		p = entity:getParentEntity()
+	end
+end)
+
+benchmark("Vector3()", function()
+	local v = nil
+	for i=1,ITERATIONS do
+		v = Vector3(i, i, i)
+		delete(v)
+	end
+end)
+
+label:setText("See the console for results")
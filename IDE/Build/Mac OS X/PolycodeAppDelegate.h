@@ -66,5 +66,6 @@ public:
 -(IBAction) openProject: (id) sender;
 -(IBAction) saveFile: (id) sender;
 -(IBAction) findText: (id) sender;
+-(IBAction) goToFile: (id) sender;
 
 @end
@@ -146,5 +146,9 @@
 	app->findText();
 }
 
+-(IBAction) goToFile: (id) sender {
+	app->goToFile();
+}
+
 
 @end
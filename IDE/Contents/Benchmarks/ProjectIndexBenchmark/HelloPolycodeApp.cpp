@@ -0,0 +1,88 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Builds the IDE project index for a generated project of 100000 files and
+// prints how long the walk takes compared to the recursive parseFolder walk the
+// project browser used to do, how quickly a new and a deleted file show up as
+// index changes, and how long fuzzy "go to file" searches take. The project is
+// only generated the first time. Build it with IDE/Build/Linux/Makefile. No
+// window or GPU is needed.
+
+static const int NUM_FOLDERS = 100;
+static const int NUM_SUBFOLDERS = 10;
+static const int NUM_FILES = 100;
+static const int NUM_SEARCHES = 20;
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(640, 480) {
+	String projectPath = core->getDefaultWorkingDirectory() + "/ProjectIndexBenchmarkProject";
+	if(!OSBasics::isFolder(projectPath)) {
+		core->createFolder(projectPath);
+		for(int i=0; i < NUM_FOLDERS; i++) {
+			String folderPath = projectPath + "/Folder" + String::IntToString(i);
+			core->createFolder(folderPath);
+			for(int j=0; j < NUM_SUBFOLDERS; j++) {
+				String subfolderPath = folderPath + "/Sub" + String::IntToString(j);
+				core->createFolder(subfolderPath);
+				for(int k=0; k < NUM_FILES; k++) {
+					OSFILE *file = OSBasics::open(subfolderPath + "/file" + String::IntToString(k) + ".lua", "w");
+					OSBasics::close(file);
+				}
+			}
+		}
+	}
+	
+	BenchmarkTimer timer;
+	int numEntries = walkFolder(projectPath);
+	printf("Recursive parseFolder walk: %d entries in %.1f ms\n", numEntries, timer.getElapsed());
+	
+	timer.reset();
+	PolycodeProjectIndex *index = new PolycodeProjectIndex(projectPath);
+	printf("Index walk: %d entries in %.1f ms, %s\n", index->getNumEntries(), timer.getElapsed(), index->isWatching() ? "watching for changes" : "no file watcher");
+	
+	String newFilePath = projectPath + "/Folder50/Sub5/added.lua";
+	OSFILE *file = OSBasics::open(newFilePath, "w");
+	OSBasics::close(file);
+	printf("New file picked up after %.3f ms\n", waitForChange(index));
+	
+	core->removeDiskItem(newFilePath);
+	printf("Deleted file picked up after %.3f ms\n", waitForChange(index));
+	
+	const char *queries[] = {"file42", "f50s5file7", "folder9/sub3/file99.lua", "notthere"};
+	for(int i=0; i < 4; i++) {
+		std::vector<ProjectSearchResult> results;
+		timer.reset();
+		for(int j=0; j < NUM_SEARCHES; j++) {
+			results = index->search(queries[i], 12);
+		}
+		Number searchTime = timer.getElapsed() / NUM_SEARCHES;
+		printf("Search \"%s\": %.2f ms, best match %s\n", queries[i], searchTime, results.size() > 0 ? results[0].fileEntry.fullPath.c_str() : "none");
+	}
+	
+	delete index;
+}
+
+int HelloPolycodeApp::walkFolder(const String &folderPath) {
+	vector<OSFileEntry> files = OSBasics::parseFolder(folderPath, false);
+	int numEntries = files.size();
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].type == OSFileEntry::TYPE_FOLDER) {
+			numEntries += walkFolder(files[i].fullPath);
+		}
+	}
+	return numEntries;
+}
+
+Number HelloPolycodeApp::waitForChange(PolycodeProjectIndex *index) {
+	BenchmarkTimer timer;
+	while(true) {
+		if(index->isWatching()) {
+			index->update();
+		} else {
+			index->rescan();
+		}
+		if(index->getChanges().size() > 0) {
+			break;
+		}
+	}
+	return timer.getElapsed();
+}
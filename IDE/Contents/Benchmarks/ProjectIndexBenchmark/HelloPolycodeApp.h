@@ -0,0 +1,15 @@
+#include "BenchmarkApp.h"
+#include "PolycodeProject.h"
+
+using namespace Polycode;
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	int walkFolder(const String &folderPath);
+	Number waitForChange(PolycodeProjectIndex *index);
+
+};
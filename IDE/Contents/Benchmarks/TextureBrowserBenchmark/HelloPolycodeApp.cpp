@@ -0,0 +1,81 @@
+#include "HelloPolycodeApp.h"
+#include <stdio.h>
+
+// Opens a folder of 200 large PNGs in the IDE asset browser list and prints
+// how long it takes until the list is interactive and until every visible
+// entry shows its thumbnail, first with a cold thumbnail cache and then with a
+// warm one, next to the time it takes to decode every image up front the way
+// the browser used to. The images are rewritten on every run, which changes
+// their modification times and so always starts from a cold cache. The folder
+// also holds a PNG that can't be decoded, whose entry has to stop waiting for
+// its thumbnail like the others. Build it with IDE/Build/Linux/Makefile,
+// which also links the default UI theme from the IDE resources next to the
+// binary. No window or GPU is needed.
+
+static const int NUM_IMAGES = 200;
+static const int IMAGE_SIZE = 1024;
+static const int VIEW_HEIGHT = 400;
+
+bool BenchmarkAssetList::visibleThumbnailsReady() {
+	Number viewTop = -getPosition().y;
+	for(int i=0; i < assetEntries.size(); i++) {
+		AssetEntry *entry = assetEntries[i];
+		if(entry->needsThumbnail && entry->getPosition().y < viewTop + viewHeight && entry->getPosition().y + 100 > viewTop) {
+			return false;
+		}
+	}
+	return true;
+}
+
+HelloPolycodeApp::HelloPolycodeApp(PolycodeView *view) : BenchmarkApp(1280, 720) {
+	CoreServices::getInstance()->getConfig()->loadConfig("Polycode", "UIThemes/default/theme.xml");
+	CoreServices::getInstance()->getResourceManager()->addArchive("UIThemes/default/");
+	screen = new Screen();
+	
+	String folderPath = core->getDefaultWorkingDirectory() + "/TextureBrowserBenchmarkImages";
+	core->createFolder(folderPath);
+	Image *image = new Image(IMAGE_SIZE, IMAGE_SIZE, Image::IMAGE_RGBA);
+	for(int i=0; i < NUM_IMAGES; i++) {
+		image->fill((Number)(i % 10) / 10.0, (Number)(i % 7) / 7.0, 0.5, 1.0);
+		image->savePNG(folderPath + "/image" + String::IntToString(i) + ".png");
+	}
+	delete image;
+	FILE *brokenFile = fopen((folderPath + "/broken.png").c_str(), "wb");
+	fputs("not a png", brokenFile);
+	fclose(brokenFile);
+	
+	BenchmarkTimer timer;
+	for(int i=0; i < NUM_IMAGES; i++) {
+		Image *fullImage = new Image(folderPath + "/image" + String::IntToString(i) + ".png");
+		delete fullImage;
+	}
+	printf("Decoding every image up front: %.1f ms\n", timer.getElapsed());
+	
+	std::vector<String> extensions;
+	extensions.push_back("png");
+	BenchmarkAssetList *assetList = new BenchmarkAssetList();
+	assetList->setExtensions(extensions);
+	assetList->setViewHeight(VIEW_HEIGHT);
+	screen->addChild(assetList);
+	
+	for(int pass=0; pass < 2; pass++) {
+		timer.reset();
+		assetList->showFolder(folderPath);
+		core->Update();
+		Number interactiveTime = timer.getElapsed();
+		Number readyTime = interactiveTime + waitForThumbnails(assetList);
+		printf("%s cache: interactive after %.1f ms, visible thumbnails after %.1f ms\n", pass == 0 ? "Cold" : "Warm", interactiveTime, readyTime);
+	}
+	
+	// scrolls to the middle of the folder, where nothing has been requested yet
+	assetList->setPositionY(-(Number)(NUM_IMAGES / 5 / 2) * 100);
+	printf("Scrolled: visible thumbnails after %.1f ms\n", waitForThumbnails(assetList));
+}
+
+Number HelloPolycodeApp::waitForThumbnails(BenchmarkAssetList *assetList) {
+	BenchmarkTimer timer;
+	do {
+		core->Update();
+	} while(!assetList->visibleThumbnailsReady());
+	return timer.getElapsed();
+}
@@ -0,0 +1,21 @@
+#include <PolycodeUI.h>
+#include "BenchmarkApp.h"
+#include "TextureBrowser.h"
+
+using namespace Polycode;
+
+class BenchmarkAssetList : public AssetList {
+public:
+	bool visibleThumbnailsReady();
+};
+
+class HelloPolycodeApp : public BenchmarkApp {
+public:
+ 	HelloPolycodeApp(PolycodeView *view);
+    
+private:
+
+	Number waitForThumbnails(BenchmarkAssetList *assetList);
+
+	Screen *screen;
+};
@@ -179,6 +179,7 @@ public:
 	AssetBrowser *assetBrowser;
 	
 	TextInputPopup *textInputPopup;
+	GoToFilePopup *goToFilePopup;
 	
 	ScreenEntity *welcomeEntity;	
 	PolycodeProjectBrowser *projectBrowser;
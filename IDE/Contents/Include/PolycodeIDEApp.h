@@ -72,6 +72,7 @@ public:
 	void closeProject();	
 	void saveFile();
 	void findText();
+	void goToFile();
 	void runProject();
 	void exportProject();	
 	
@@ -57,6 +57,138 @@ class ProjectData {
 		Number backgroundColorB;				
 };
 
+class ProjectFolderScanner;
+
+/**
+* Reads one folder of a walk on the core's job pool.
+*/
+class ProjectFolderScanJob : public Job {
+	public:
+		ProjectFolderScanJob(ProjectFolderScanner *scanner, const String &folderPath);
+		void run();
+		
+	protected:
+		ProjectFolderScanner *scanner;
+		String folderPath;
+};
+
+/**
+* Walks folder trees on the core's job pool. Every folder is read by its own job, and the thread that asked for the walk reads folders too while it waits.
+*/
+class ProjectFolderScanner {
+	public:
+		static ProjectFolderScanner *getInstance();
+		
+		/**
+		* Lists every file and folder under a folder, recursively. Returns once the whole tree has been read.
+		*/
+		std::vector<OSFileEntry> scanFolder(const String &folderPath);
+		
+		/**
+		* Lists one folder and reads its subfolders. They are read by new jobs in the same group, or right away if there is no group.
+		*/
+		void readFolder(const String &folderPath, JobGroup *group);
+		
+	protected:
+		ProjectFolderScanner();
+		
+		CoreMutex *mutex;
+		std::vector<OSFileEntry> results;
+};
+
+/**
+* A file or folder that was added to or removed from a project, reported by PolycodeProjectIndex::getChanges(). A rename shows up as a removal of the old path followed by an addition of the new one.
+*/
+class ProjectIndexChange {
+	public:
+		OSFileEntry entry;
+		int type;
+		
+		static const int ENTRY_ADDED = 0;
+		static const int ENTRY_REMOVED = 1;
+};
+
+class ProjectIndexEntry {
+	public:
+		OSFileEntry fileEntry;
+		
+		/**
+		* Path relative to the project folder, lowercased for matching.
+		*/
+		String searchPath;
+		
+		/**
+		* Offset of the file name in searchPath.
+		*/
+		int nameOffset;
+		
+		/**
+		* One bit per letter or digit group that appears in searchPath, to skip entries that can't match a query without looking at them.
+		*/
+		unsigned int characterMask;
+};
+
+class ProjectSearchResult {
+	public:
+		OSFileEntry fileEntry;
+		int score;
+};
+
+/**
+* Every file and folder of a project, kept up to date without walking the project again. The index is filled by a parallel walk when it's created and then follows the file system through inotify on Linux. Other platforms don't have a watcher yet and call rescan(), which compares a fresh walk with the index. Either way, the differences are queued as ProjectIndexChange entries for the project browser to apply to its tree.
+*/
+class PolycodeProjectIndex {
+	public:
+		PolycodeProjectIndex(const String &rootFolder);
+		~PolycodeProjectIndex();
+		
+		/**
+		* Walks the project again and queues the differences with the index. Only needed when there is no watcher.
+		*/
+		void rescan();
+		
+		/**
+		* Applies file system events that arrived since the last call. Doesn't block.
+		*/
+		void update();
+		
+		/**
+		* Returns and clears the changes queued since the last call.
+		*/
+		std::vector<ProjectIndexChange> getChanges();
+		
+		bool isWatching();
+		
+		/**
+		* Fuzzy file search. The query characters have to appear in the path relative to the project folder in order, and matches in the file name, at the start of words and in runs score higher.
+		* @param query Text to search for. Case insensitive.
+		* @param maxResults Largest number of results to return.
+		* @return Matching files, best match first.
+		*/
+		std::vector<ProjectSearchResult> search(const String &query, int maxResults);
+		
+		unsigned int getNumEntries() { return entries.size(); }
+		ProjectIndexEntry *getEntry(unsigned int index) { return &entries[index]; }
+		
+	protected:
+	
+		void addEntry(const OSFileEntry &fileEntry, bool queueChange);
+		void removeEntry(const String &fullPath, bool queueChange);
+		void addFolder(const String &folderPath, bool queueChanges);
+		
+		void addWatch(const String &folderPath);
+		void removeWatch(const String &folderPath);
+		
+		String rootFolder;
+		std::vector<ProjectIndexEntry> entries;
+		std::map<std::string, unsigned int> entryIndices;
+		std::vector<ProjectIndexChange> changes;
+		
+		int watchDescriptor;
+		std::map<int, String> watchedFolders;
+		std::map<std::string, int> folderWatches;
+};
+
 class PolycodeProject {
 	public:
 		PolycodeProject(String name, String path, String file);
@@ -68,6 +200,11 @@ class PolycodeProject {
 		String getProjectName() { return projectName; }
 		String getProjectFile() { return projectFile; }	
 		String getRootFolder() { return projectFolder; }	
+		
+		/**
+		* Returns the project's file index, walking the project the first time it's asked for.
+		*/
+		PolycodeProjectIndex *getIndex();
 	
 		ProjectData data;
 		
@@ -76,6 +213,8 @@ private:
 
 	Object configFile;
 	
+	PolycodeProjectIndex *index;
+	
 	String filPath;
 		
 	String projectFile;
@@ -58,20 +58,19 @@ public:
 	void addProject(PolycodeProject *project);
 	void removeProject(PolycodeProject *project);
 	
-	UITree *nodeHasName(UITree *node, String name);
-	bool listHasFileEntry(vector<OSFileEntry> files, OSFileEntry fileEntry);
-	
+	/**
+	* Applies the changes the project's index has picked up. Projects whose index has no file watcher are walked again first.
+	*/
 	void refreshProject(PolycodeProject *project);
 	
 	void handleEvent(Event *event);
 	
-	void parseFolderIntoNode(UITree *node, String spath, PolycodeProject *parentProject);
-	
-	
+	void Update();
 	
+
 	BrowserUserData *getSelectedData() { return selectedData; }
 	
-	UITreeContainer *treeContainer;
+	UIVirtualTreeContainer *treeContainer;
 			
 protected:
 
@@ -80,4 +79,10 @@ protected:
 		UIMenu *contextMenu;
 	
 		BrowserUserData *selectedData;
+		
+		void applyIndexChanges(PolycodeProject *project);
+		void addFileNode(const OSFileEntry &fileEntry, PolycodeProject *project);
+		void removeFileNode(const String &fullPath);
+		
+		std::map<std::string, UIVirtualTreeNode*> nodesByPath;
 };	
\ No newline at end of file
@@ -55,7 +55,8 @@ class PolycodeSyntaxHighlighter : public UITextInputSyntaxHighlighter {
 		bool contains(String part, std::vector<String> list);
 	
 		std::vector<SyntaxHighlightToken> parseText(String text);		
-		std::vector<SyntaxHighlightToken> parseLua(String text);
+		std::vector<SyntaxHighlightToken> parseLine(String text, int startState, int *endState);
+		std::vector<SyntaxHighlightToken> parseLua(String text, int startMode = 0, int *endMode = NULL);
 		
 		Color colorScheme[16];
 				
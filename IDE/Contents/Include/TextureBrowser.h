@@ -36,17 +36,104 @@ public:
 	int type;
 };
 
+class ThumbnailCache;
+
+/**
+* A thumbnail waiting to be generated, or generated and waiting to be picked up by the main thread.
+*/
+class ThumbnailRequest {
+	public:
+		String path;
+		String key;
+		String cachePath;
+		Image *image;
+};
+
+/**
+* Generates the most recently requested thumbnail on the core's job pool. One job is added per request.
+*/
+class ThumbnailJob : public Job {
+	public:
+		ThumbnailJob(ThumbnailCache *cache);
+		void run();
+		
+	protected:
+		ThumbnailCache *cache;
+};
+
+/**
+* Generates downscaled previews of image files on the core's job pool. Finished thumbnails are kept on disk, keyed by the source path, modification time and size, so a folder only has to be decoded in full the first time it is browsed.
+*/
+class ThumbnailCache {
+	public:
+		static ThumbnailCache *getInstance();
+		
+		/**
+		* Queues a thumbnail for an image file. Requests made last are generated first, so entries that just scrolled into view don't wait behind the rest of the folder.
+		* @return Key to pass to takeThumbnail(), or an empty string if the file doesn't exist.
+		*/
+		String requestThumbnail(const String &path);
+		
+		/**
+		* Takes the finished thumbnail for a key and hands its ownership to the caller.
+		* @param image Set to the thumbnail, or to NULL if the file could not be decoded.
+		* @return False if the thumbnail isn't finished yet.
+		*/
+		bool takeThumbnail(const String &key, Image **image);
+		
+		/**
+		* Drops queued requests and thumbnails nobody picked up. Thumbnails that are being generated are thrown away when they finish. Called when the browser shows another folder.
+		*/
+		void clear();
+		
+		ThumbnailRequest *takeRequest();
+		void generateThumbnail(ThumbnailRequest *request);
+		void finishRequest(ThumbnailRequest *request);
+		
+		static const int THUMBNAIL_SIZE = 64;
+		
+		/**
+		* Number of thumbnails kept on disk. The oldest ones are deleted when the cache is created.
+		*/
+		static const int MAX_DISK_THUMBNAILS = 4096;
+		
+	protected:
+		ThumbnailCache();
+		
+		void pruneDiskCache();
+		
+		Image *downscaleImage(Image *image);
+		
+		CoreMutex *mutex;
+		String cacheFolder;
+		
+		std::vector<ThumbnailRequest*> pendingRequests;
+		std::map<std::string, ThumbnailRequest*> activeRequests;
+		std::map<std::string, Image*> finishedThumbnails;
+};
+
 class AssetEntry : public UIElement {
 	public:
 		AssetEntry(String assetPath, String assetName, String extension);
 		~AssetEntry();
 		
+		/**
+		* Requests the thumbnail the first time it is called and uploads it once the cache has finished it.
+		*/
+		void updateThumbnail();
+		
 		ScreenShape *imageShape;
 		ScreenLabel *nameLabel;
 		
 		String assetPath;
 		
 		ScreenShape *selectShape;
+		
+		bool needsThumbnail;
+		
+	protected:
+		String thumbnailKey;
+		Texture *thumbnailTexture;
 };
 
 class AssetList : public UIElement {
@@ -63,8 +150,17 @@ class AssetList : public UIElement {
 		
 		void setExtensions(std::vector<String> extensions);
 		
+		/**
+		* Height of the scroll container the list is shown in. Only entries inside it request thumbnails.
+		*/
+		void setViewHeight(Number viewHeight);
+		
+		void Update();
+		
 	protected:
 	
+		Number viewHeight;
+
 		String currentFolderPath;
 		ScreenShape *bgShape;
 	
@@ -26,6 +26,7 @@
 #include "PolycodeUI.h"
 #include "Polycode.h"
 #include "OSBasics.h"
+#include "PolycodeProject.h"
 
 using namespace Polycode;
 
@@ -45,4 +46,36 @@ class TextInputPopup : public UIWindow {
 		UIButton *cancelButton;
 		UIButton *okButton;
 	
-};
\ No newline at end of file
+};
+
+class GoToFilePopup : public UIWindow {
+	public:
+		GoToFilePopup();
+		~GoToFilePopup();
+		
+		/**
+		* Clears the query and searches the given project's index as the user types.
+		*/
+		void setProject(PolycodeProject *project);
+		
+		/**
+		* File picked with return or a click. Valid when the popup dispatches UIEvent::OK_EVENT.
+		*/
+		OSFileEntry getSelectedFile();
+		
+		void handleEvent(Event *event);
+		
+		static const int NUM_RESULTS = 12;
+		
+	protected:
+	
+		void updateResults();
+		
+		PolycodeProject *project;
+		
+		UITextInput *textInput;
+		std::vector<ScreenLabel*> resultLabels;
+		std::vector<ProjectSearchResult> results;
+		
+		OSFileEntry selectedFile;
+};
@@ -584,6 +584,9 @@ PolycodeFrame::PolycodeFrame() : ScreenEntity() {
 	textInputPopup = new TextInputPopup();
 	textInputPopup->visible = false;
 	
+	goToFilePopup = new GoToFilePopup();
+	goToFilePopup->visible = false;
+	
 	
 	isDragging  = false;
 	dragLabel = new ScreenLabel("NONE", 11, "sans");
@@ -696,7 +699,7 @@ void PolycodeFrame::handleEvent(Event *event) {
 			case UITreeEvent::DRAG_START_EVENT:
 			{
 				UITreeEvent *treeEvent = (UITreeEvent*) event;
-				BrowserUserData *data = (BrowserUserData*)treeEvent->selection->getUserData();
+				BrowserUserData *data = (BrowserUserData*)treeEvent->node->getUserData();
 				draggedFile = data->fileEntry;
 				dragLabel->setText(data->fileEntry.name);
 				dragEntity->visible = true;
@@ -68,6 +68,7 @@ PolycodeIDEApp::PolycodeIDEApp(PolycodeView *view) : EventDispatcher() {
 	frame->console->backtraceWindow->addEventListener(this, BackTraceEvent::EVENT_BACKTRACE_SELECTED);
 
 	frame->textInputPopup->addEventListener(this, UIEvent::OK_EVENT);	
+	frame->goToFilePopup->addEventListener(this, UIEvent::OK_EVENT);
 	frame->newProjectWindow->addEventListener(this, UIEvent::OK_EVENT);
 	frame->exportProjectWindow->addEventListener(this, UIEvent::OK_EVENT);
 	frame->newFileWindow->addEventListener(this, UIEvent::OK_EVENT);	
@@ -219,6 +220,13 @@ void PolycodeIDEApp::findText() {
 	}
 }
 
+void PolycodeIDEApp::goToFile() {
+	if(projectManager->getActiveProject()) {
+		frame->goToFilePopup->setProject(projectManager->getActiveProject());
+		frame->showModal(frame->goToFilePopup);
+	}
+}
+
 void PolycodeIDEApp::saveFile() {
 	if(editorManager->getCurrentEditor()) {
 		editorManager->getCurrentEditor()->saveFile();
@@ -377,6 +385,13 @@ void PolycodeIDEApp::handleEvent(Event *event) {
 	}
 
 	
+	if(event->getDispatcher() == frame->goToFilePopup) {
+		if(event->getEventType() == "UIEvent" && event->getEventCode() == UIEvent::OK_EVENT) {
+			frame->hideModal();
+			openFile(frame->goToFilePopup->getSelectedFile());
+		}
+	}
+	
 	if(event->getDispatcher() == frame->textInputPopup) {
 		if(event->getEventType() == "UIEvent" && event->getEventCode() == UIEvent::OK_EVENT) {
 			core->moveDiskItem(projectManager->selectedFileEntry.fullPath, projectManager->selectedFileEntry.basePath + "/" + frame->textInputPopup->getValue());			
@@ -21,6 +21,379 @@
 */
 
 #include "PolycodeProject.h"
+#include <algorithm>
+#include <set>
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+ProjectFolderScanJob::ProjectFolderScanJob(ProjectFolderScanner *scanner, const String &folderPath) : Job() {
+	this->scanner = scanner;
+	this->folderPath = folderPath;
+}
+
+void ProjectFolderScanJob::run() {
+	scanner->readFolder(folderPath, getGroup());
+}
+
+ProjectFolderScanner *ProjectFolderScanner::getInstance() {
+	static ProjectFolderScanner *instance = new ProjectFolderScanner();
+	return instance;
+}
+
+ProjectFolderScanner::ProjectFolderScanner() {
+	mutex = CoreServices::getInstance()->getCore()->createMutex();
+}
+
+void ProjectFolderScanner::readFolder(const String &folderPath, JobGroup *group) {
+	vector<OSFileEntry> files = OSBasics::parseFolder(folderPath, false);
+	
+	// a folder is listed before it is read, so parents always come before their children in the results
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	results.insert(results.end(), files.begin(), files.end());
+	core->unlockMutex(mutex);
+	
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].type != OSFileEntry::TYPE_FOLDER) {
+			continue;
+		}
+		if(group) {
+			core->getJobPool()->addJob(new ProjectFolderScanJob(this, files[i].fullPath), group);
+		} else {
+			readFolder(files[i].fullPath, NULL);
+		}
+	}
+}
+
+std::vector<OSFileEntry> ProjectFolderScanner::scanFolder(const String &folderPath) {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	results.clear();
+	core->unlockMutex(mutex);
+	
+#ifdef _WINDOWS
+	// parseFolder changes the working directory on Windows, so folders are read one at a time there
+	readFolder(folderPath, NULL);
+#else
+	JobGroup group;
+	JobPool *jobPool = core->getJobPool();
+	jobPool->addJob(new ProjectFolderScanJob(this, folderPath), &group);
+	jobPool->wait(&group);
+#endif
+	
+	std::vector<OSFileEntry> files;
+	core->lockMutex(mutex);
+	files.swap(results);
+	core->unlockMutex(mutex);
+	return files;
+}
+
+static unsigned int getCharacterBit(char c) {
+	if(c >= 'a' && c <= 'z')
+		return 1 << (c - 'a');
+	if(c >= '0' && c <= '9')
+		return 1 << 26;
+	if(c == '_')
+		return 1 << 27;
+	if(c == '-')
+		return 1 << 28;
+	if(c == '.')
+		return 1 << 29;
+	return 0;
+}
+
+static bool isWordStart(const std::string &path, size_t position) {
+	if(position == 0)
+		return true;
+	char previous = path[position-1];
+	return previous == '/' || previous == '_' || previous == '-' || previous == '.' || previous == ' ';
+}
+
+// greedy subsequence match starting at startOffset, -1 if the query doesn't match
+static int scoreMatch(const std::string &path, size_t startOffset, size_t nameOffset, const std::string &query) {
+	int score = 0;
+	size_t searchFrom = startOffset;
+	size_t previous = std::string::npos;
+	for(size_t i=0; i < query.size(); i++) {
+		size_t found = path.find(query[i], searchFrom);
+		if(found == std::string::npos)
+			return -1;
+		if(previous != std::string::npos && found == previous+1)
+			score += 5;
+		if(isWordStart(path, found))
+			score += 10;
+		if(found >= nameOffset)
+			score += 3;
+		previous = found;
+		searchFrom = found+1;
+	}
+	return score;
+}
+
+static bool compareSearchResults(const std::pair<int, ProjectIndexEntry*> &a, const std::pair<int, ProjectIndexEntry*> &b) {
+	if(a.first != b.first)
+		return a.first > b.first;
+	return a.second->searchPath.length() < b.second->searchPath.length();
+}
+
+PolycodeProjectIndex::PolycodeProjectIndex(const String &rootFolder) {
+	this->rootFolder = rootFolder;
+	watchDescriptor = -1;
+	
+#ifdef __linux__
+	watchDescriptor = inotify_init();
+	if(watchDescriptor < 0) {
+		Logger::log("Error starting the project file watcher, refresh the project to pick up changes\n");
+	} else {
+		fcntl(watchDescriptor, F_SETFL, fcntl(watchDescriptor, F_GETFL) | O_NONBLOCK);
+		addWatch(rootFolder);
+	}
+#endif
+	
+	addFolder(rootFolder, false);
+}
+
+PolycodeProjectIndex::~PolycodeProjectIndex() {
+#ifdef __linux__
+	if(watchDescriptor >= 0) {
+		close(watchDescriptor);
+	}
+#endif
+}
+
+bool PolycodeProjectIndex::isWatching() {
+	return watchDescriptor >= 0;
+}
+
+void PolycodeProjectIndex::addFolder(const String &folderPath, bool queueChanges) {
+	std::vector<OSFileEntry> files = ProjectFolderScanner::getInstance()->scanFolder(folderPath);
+	for(int i=0; i < files.size(); i++) {
+		addEntry(files[i], queueChanges);
+	}
+}
+
+void PolycodeProjectIndex::addEntry(const OSFileEntry &fileEntry, bool queueChange) {
+	if(entryIndices.find(fileEntry.fullPath.contents) != entryIndices.end()) {
+		return;
+	}
+	
+	ProjectIndexEntry entry;
+	entry.fileEntry = fileEntry;
+	entry.searchPath = fileEntry.fullPath.substr(rootFolder.length()+1).toLowerCase();
+	entry.nameOffset = entry.searchPath.length() - fileEntry.name.length();
+	entry.characterMask = 0;
+	for(int i=0; i < entry.searchPath.length(); i++) {
+		entry.characterMask |= getCharacterBit(entry.searchPath.contents[i]);
+	}
+	
+	entryIndices[fileEntry.fullPath.contents] = entries.size();
+	entries.push_back(entry);
+	
+	if(fileEntry.type == OSFileEntry::TYPE_FOLDER) {
+		addWatch(fileEntry.fullPath);
+	}
+	
+	if(queueChange) {
+		ProjectIndexChange change;
+		change.entry = fileEntry;
+		change.type = ProjectIndexChange::ENTRY_ADDED;
+		changes.push_back(change);
+	}
+}
+
+void PolycodeProjectIndex::removeEntry(const String &fullPath, bool queueChange) {
+	std::map<std::string, unsigned int>::iterator it = entryIndices.find(fullPath.contents);
+	if(it == entryIndices.end()) {
+		return;
+	}
+	
+	OSFileEntry fileEntry = entries[it->second].fileEntry;
+	
+	// paths are sorted, so everything inside a folder follows it directly in the map
+	std::vector<std::string> removedPaths;
+	removedPaths.push_back(fullPath.contents);
+	if(fileEntry.type == OSFileEntry::TYPE_FOLDER) {
+		std::string prefix = fullPath.contents + "/";
+		for(std::map<std::string, unsigned int>::iterator child = entryIndices.lower_bound(prefix); child != entryIndices.end() && child->first.compare(0, prefix.size(), prefix) == 0; child++) {
+			removedPaths.push_back(child->first);
+		}
+	}
+	
+	for(int i=0; i < removedPaths.size(); i++) {
+		it = entryIndices.find(removedPaths[i]);
+		unsigned int index = it->second;
+		if(entries[index].fileEntry.type == OSFileEntry::TYPE_FOLDER) {
+			removeWatch(entries[index].fileEntry.fullPath);
+		}
+		entryIndices.erase(it);
+		
+		unsigned int lastIndex = entries.size()-1;
+		if(index != lastIndex) {
+			entries[index] = entries[lastIndex];
+			entryIndices[entries[index].fileEntry.fullPath.contents] = index;
+		}
+		entries.pop_back();
+	}
+	
+	if(queueChange) {
+		ProjectIndexChange change;
+		change.entry = fileEntry;
+		change.type = ProjectIndexChange::ENTRY_REMOVED;
+		changes.push_back(change);
+	}
+}
+
+void PolycodeProjectIndex::addWatch(const String &folderPath) {
+#ifdef __linux__
+	if(watchDescriptor < 0) {
+		return;
+	}
+	int folderWatch = inotify_add_watch(watchDescriptor, folderPath.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+	if(folderWatch < 0) {
+		Logger::log("Error watching %s, refresh the project to pick up changes in it\n", folderPath.c_str());
+		return;
+	}
+	watchedFolders[folderWatch] = folderPath;
+	folderWatches[folderPath.contents] = folderWatch;
+#endif
+}
+
+void PolycodeProjectIndex::removeWatch(const String &folderPath) {
+#ifdef __linux__
+	std::map<std::string, int>::iterator it = folderWatches.find(folderPath.contents);
+	if(it == folderWatches.end()) {
+		return;
+	}
+	inotify_rm_watch(watchDescriptor, it->second);
+	watchedFolders.erase(it->second);
+	folderWatches.erase(it);
+#endif
+}
+
+void PolycodeProjectIndex::update() {
+#ifdef __linux__
+	if(watchDescriptor < 0) {
+		return;
+	}
+	
+	bool overflowed = false;
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	while(true) {
+		ssize_t length = read(watchDescriptor, buffer, sizeof(buffer));
+		if(length <= 0) {
+			break;
+		}
+		
+		const struct inotify_event *event;
+		for(char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *) ptr;
+			if(event->mask & IN_Q_OVERFLOW) {
+				overflowed = true;
+				continue;
+			}
+			if(event->len == 0 || event->name[0] == '.') {
+				continue;
+			}
+			std::map<int, String>::iterator folder = watchedFolders.find(event->wd);
+			if(folder == watchedFolders.end()) {
+				continue;
+			}
+			
+			String folderPath = folder->second;
+			String name = event->name;
+			if(event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				removeEntry(folderPath + "/" + name, true);
+			}
+			if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+				if(event->mask & IN_ISDIR) {
+					// a folder moved in from elsewhere arrives with its contents, which don't get events of their own
+					addEntry(OSFileEntry(folderPath, name, OSFileEntry::TYPE_FOLDER), true);
+					addFolder(folderPath + "/" + name, true);
+				} else {
+					addEntry(OSFileEntry(folderPath, name, OSFileEntry::TYPE_FILE), true);
+				}
+			}
+		}
+	}
+	
+	if(overflowed) {
+		rescan();
+	}
+#endif
+}
+
+void PolycodeProjectIndex::rescan() {
+	std::vector<OSFileEntry> files = ProjectFolderScanner::getInstance()->scanFolder(rootFolder);
+	
+	std::set<std::string> currentPaths;
+	for(int i=0; i < files.size(); i++) {
+		currentPaths.insert(files[i].fullPath.contents);
+	}
+	
+	std::vector<String> removedPaths;
+	for(std::map<std::string, unsigned int>::iterator it = entryIndices.begin(); it != entryIndices.end(); it++) {
+		if(currentPaths.find(it->first) == currentPaths.end()) {
+			removedPaths.push_back(it->first);
+		}
+	}
+	for(int i=0; i < removedPaths.size(); i++) {
+		removeEntry(removedPaths[i], true);
+	}
+	
+	for(int i=0; i < files.size(); i++) {
+		addEntry(files[i], true);
+	}
+}
+
+std::vector<ProjectIndexChange> PolycodeProjectIndex::getChanges() {
+	std::vector<ProjectIndexChange> queuedChanges;
+	queuedChanges.swap(changes);
+	return queuedChanges;
+}
+
+std::vector<ProjectSearchResult> PolycodeProjectIndex::search(const String &query, int maxResults) {
+	std::string lowerQuery = query.toLowerCase().contents;
+	unsigned int queryMask = 0;
+	for(int i=0; i < lowerQuery.size(); i++) {
+		queryMask |= getCharacterBit(lowerQuery[i]);
+	}
+	
+	std::vector<std::pair<int, ProjectIndexEntry*> > matches;
+	for(int i=0; i < entries.size(); i++) {
+		ProjectIndexEntry *entry = &entries[i];
+		if(entry->fileEntry.type != OSFileEntry::TYPE_FILE || (entry->characterMask & queryMask) != queryMask) {
+			continue;
+		}
+		
+		// prefer matching inside the file name, which is what people usually type
+		int score = scoreMatch(entry->searchPath.contents, entry->nameOffset, entry->nameOffset, lowerQuery);
+		if(score >= 0) {
+			score += 20;
+		} else {
+			score = scoreMatch(entry->searchPath.contents, 0, entry->nameOffset, lowerQuery);
+			if(score < 0) {
+				continue;
+			}
+		}
+		matches.push_back(std::pair<int, ProjectIndexEntry*>(score, entry));
+	}
+	
+	int numResults = std::min((int)matches.size(), maxResults);
+	std::partial_sort(matches.begin(), matches.begin() + numResults, matches.end(), compareSearchResults);
+	
+	std::vector<ProjectSearchResult> results;
+	for(int i=0; i < numResults; i++) {
+		ProjectSearchResult result;
+		result.fileEntry = matches[i].second->fileEntry;
+		result.score = matches[i].first;
+		results.push_back(result);
+	}
+	return results;
+}
 
 PolycodeProject::PolycodeProject(String name, String path, String file) {
 	
@@ -29,11 +402,19 @@ PolycodeProject::PolycodeProject(String name, String path, String file) {
 	projectName = name;
 	projectFolder = path;
 	projectFile = file;
+	index = NULL;
 	
 	loadProjectFromFile();
 	
 }
 
+PolycodeProjectIndex *PolycodeProject::getIndex() {
+	if(!index) {
+		index = new PolycodeProjectIndex(projectFolder);
+	}
+	return index;
+}
+
 bool PolycodeProject::loadProjectFromFile() {
 
 	if(!configFile.loadFromXML(projectFile)) {
@@ -227,5 +608,5 @@ bool PolycodeProject::saveFile() {
 }
 
 PolycodeProject::~PolycodeProject() {
-	
+	delete index;
 }
@@ -21,6 +21,7 @@
 */
 
 #include "PolycodeProjectBrowser.h"
+#include <algorithm>
 
 extern UIGlobalMenu *globalMenu;
 
@@ -37,7 +38,7 @@ PolycodeProjectBrowser::PolycodeProjectBrowser() : UIElement() {
 	label->setPosition(10, 0);
 
 
-	treeContainer = new UITreeContainer("boxIcon.png", L"Projects", 200, 555);
+	treeContainer = new UIVirtualTreeContainer("boxIcon.png", L"Projects", 200, 555);
 	treeContainer->getRootNode()->toggleCollapsed();
 	treeContainer->getRootNode()->addEventListener(this, UITreeEvent::SELECTED_EVENT);
 	treeContainer->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
@@ -57,44 +58,131 @@ PolycodeProjectBrowser::~PolycodeProjectBrowser() {
 }
 
 void PolycodeProjectBrowser::refreshProject(PolycodeProject *project) {
-	
-	UITree *projectTree = treeContainer->getRootNode();
-	
-	for(int i=0; i < projectTree->getNumTreeChildren(); i++) {
-		UITree *projectChild = projectTree->getTreeChild(i);
-		BrowserUserData *userData = (BrowserUserData*)projectChild->getUserData();
-		if(userData->parentProject == project) {
-			parseFolderIntoNode(projectChild, project->getRootFolder(), project);		
-			return;
-		}
-	}	
-	
+	PolycodeProjectIndex *index = project->getIndex();
+	index->update();
+	if(!index->isWatching()) {
+		index->rescan();
+	}
+	applyIndexChanges(project);
 }
 
 void PolycodeProjectBrowser::removeProject(PolycodeProject *project) {
-	
-	UITree *projectTree = treeContainer->getRootNode();
-	
-	for(int i=0; i < projectTree->getNumTreeChildren(); i++) {
-		UITree *projectChild = projectTree->getTreeChild(i);
-		BrowserUserData *userData = (BrowserUserData*)projectChild->getUserData();
-		if(userData->parentProject == project) {
-			projectTree->removeTreeChild(projectChild);
-			return;
-		}
-	}
+	removeFileNode(project->getRootFolder());
+}
+
+static bool compareIndexEntries(ProjectIndexEntry *a, ProjectIndexEntry *b) {
+	return a->fileEntry.fullPath.contents < b->fileEntry.fullPath.contents;
 }
 
 void PolycodeProjectBrowser::addProject(PolycodeProject *project) {
-	UITree *projectTree = treeContainer->getRootNode()->addTreeChild("projectIcon.png", project->getProjectName(), (void*) project);
+	UIVirtualTreeNode *projectTree = treeContainer->getRootNode()->addTreeChild("projectIcon.png", project->getProjectName(), (void*) project);
 	projectTree->toggleCollapsed();
 	
 	BrowserUserData *data = new BrowserUserData();
 	data->type = 3;
 	data->parentProject = project;
 	projectTree->setUserData((void*) data)	;
+	nodesByPath[project->getRootFolder().contents] = projectTree;
+	
+	// sorting by path puts every folder before its contents
+	PolycodeProjectIndex *index = project->getIndex();
+	std::vector<ProjectIndexEntry*> sortedEntries;
+	for(int i=0; i < index->getNumEntries(); i++) {
+		sortedEntries.push_back(index->getEntry(i));
+	}
+	std::sort(sortedEntries.begin(), sortedEntries.end(), compareIndexEntries);
 	
-	parseFolderIntoNode(projectTree, project->getRootFolder(), project);	
+	for(int i=0; i < sortedEntries.size(); i++) {
+		addFileNode(sortedEntries[i]->fileEntry, project);
+	}
+	index->getChanges();
+}
+
+void PolycodeProjectBrowser::applyIndexChanges(PolycodeProject *project) {
+	std::vector<ProjectIndexChange> changes = project->getIndex()->getChanges();
+	for(int i=0; i < changes.size(); i++) {
+		if(changes[i].type == ProjectIndexChange::ENTRY_ADDED) {
+			addFileNode(changes[i].entry, project);
+		} else {
+			removeFileNode(changes[i].entry.fullPath);
+		}
+	}
+}
+
+void PolycodeProjectBrowser::addFileNode(const OSFileEntry &fileEntry, PolycodeProject *project) {
+	if(nodesByPath.find(fileEntry.fullPath.contents) != nodesByPath.end()) {
+		return;
+	}
+	std::map<std::string, UIVirtualTreeNode*>::iterator parent = nodesByPath.find(fileEntry.basePath.contents);
+	if(parent == nodesByPath.end()) {
+		return;
+	}
+	
+	// siblings are kept in name order, the same order addProject builds them in
+	UIVirtualTreeNode *parentNode = parent->second;
+	int low = 0;
+	int high = parentNode->getNumTreeChildren();
+	while(low < high) {
+		int mid = (low + high) / 2;
+		BrowserUserData *siblingData = (BrowserUserData*)parentNode->getTreeChild(mid)->getUserData();
+		if(siblingData->fileEntry.name.contents < fileEntry.name.contents) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	
+	BrowserUserData *data = new BrowserUserData();
+	data->fileEntry = fileEntry;
+	data->parentProject = project;
+	UIVirtualTreeNode *newChild;
+	if(fileEntry.type == OSFileEntry::TYPE_FOLDER) {
+		data->type = 2;
+		newChild = parentNode->insertTreeChild(low, "folder.png", fileEntry.name, (void*) data);
+	} else {
+		data->type = 1;
+		newChild = parentNode->insertTreeChild(low, "file.png", fileEntry.name, (void*) data);
+	}
+	nodesByPath[fileEntry.fullPath.contents] = newChild;
+}
+
+void PolycodeProjectBrowser::removeFileNode(const String &fullPath) {
+	std::map<std::string, UIVirtualTreeNode*>::iterator it = nodesByPath.find(fullPath.contents);
+	if(it == nodesByPath.end()) {
+		return;
+	}
+	UIVirtualTreeNode *node = it->second;
+	
+	// the node takes its children with it, so only the lookup entries and user data have to go
+	std::string prefix = fullPath.contents + "/";
+	std::map<std::string, UIVirtualTreeNode*>::iterator child = nodesByPath.lower_bound(prefix);
+	while(child != nodesByPath.end() && child->first.compare(0, prefix.size(), prefix) == 0) {
+		BrowserUserData *data = (BrowserUserData*)child->second->getUserData();
+		if(data == selectedData) {
+			selectedData = NULL;
+		}
+		delete data;
+		nodesByPath.erase(child++);
+	}
+	
+	BrowserUserData *data = (BrowserUserData*)node->getUserData();
+	if(data == selectedData) {
+		selectedData = NULL;
+	}
+	delete data;
+	nodesByPath.erase(it);
+	
+	node->getParent()->removeTreeChild(node);
+}
+
+void PolycodeProjectBrowser::Update() {
+	UIVirtualTreeNode *projectTree = treeContainer->getRootNode();
+	for(int i=0; i < projectTree->getNumTreeChildren(); i++) {
+		BrowserUserData *userData = (BrowserUserData*)projectTree->getTreeChild(i)->getUserData();
+		PolycodeProject *project = userData->parentProject;
+		project->getIndex()->update();
+		applyIndexChanges(project);
+	}
 }
 
 void PolycodeProjectBrowser::handleEvent(Event *event) {
@@ -141,63 +229,6 @@ void PolycodeProjectBrowser::handleEvent(Event *event) {
 	ScreenEntity::handleEvent(event);
 }
 
-UITree *PolycodeProjectBrowser::nodeHasName(UITree *node, String name) {
-	for(int i=0; i < node->getNumTreeChildren(); i++) {
-		UITree *projectChild = node->getTreeChild(i);
-		if(projectChild->getLabelText() == name) {
-			return projectChild;
-		}
-	}
-	return NULL;
-}
-
-bool PolycodeProjectBrowser::listHasFileEntry(vector<OSFileEntry> files, OSFileEntry fileEntry) {
-	for(int i=0; i < files.size(); i++) {
-		if(files[i].fullPath == fileEntry.fullPath && files[i].type == fileEntry.type) {
-			return true;
-		}
-	}
-	return false;
-}
-
-void PolycodeProjectBrowser::parseFolderIntoNode(UITree *node, String spath, PolycodeProject *parentProject) {
-	vector<OSFileEntry> files = OSBasics::parseFolder(spath, false);
-	
-	// check if files got deleted
-	for(int i=0; i < node->getNumTreeChildren(); i++) {
-		UITree *projectChild = node->getTreeChild(i);
-		if(!listHasFileEntry(files, ((BrowserUserData*)projectChild->getUserData())->fileEntry)) {
-			node->removeTreeChild(projectChild);
-		}
-	}	
-	
-	for(int i=0; i < files.size(); i++) {
-		OSFileEntry entry = files[i];
-		if(entry.type == OSFileEntry::TYPE_FOLDER) {
-			UITree *existing = nodeHasName(node, entry.name);
-			if(!existing) {		
-				BrowserUserData *data = new BrowserUserData();
-				data->fileEntry = entry;
-				UITree *newChild = node->addTreeChild("folder.png", entry.name, (void*) data);
-				data->type = 2;	
-				data->parentProject = parentProject;
-				parseFolderIntoNode(newChild, entry.fullPath, parentProject);				
-			} else {
-				parseFolderIntoNode(existing, entry.fullPath, parentProject);							
-			}
-		} else {
-			if(!nodeHasName(node, entry.name)) {
-				BrowserUserData *data = new BrowserUserData();
-				data->fileEntry = entry;
-				data->type = 1;
-				data->parentProject = parentProject;			
-				UITree *newChild = node->addTreeChild("file.png", entry.name, (void*) data);
-			}
-		}
-	}		
-	
-}
-
 void PolycodeProjectBrowser::Resize(Number width, Number height) {
 	headerBg->setShapeSize(width, 30);
 	treeContainer->Resize(width, height-30);
@@ -56,8 +56,12 @@ bool PolycodeSyntaxHighlighter::contains(String part, std::vector<String> list)
 std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseText(String text) {
 	return parseLua(text);
 }
+
+std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseLine(String text, int startState, int *endState) {
+	return parseLua(text, startState, endState);
+}
 	
-std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseLua(String text) {
+std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseLua(String text, int startMode, int *endMode) {
 	std::vector<SyntaxHighlightToken> tokens;
 	
 	text = text+"\n";
@@ -70,7 +74,8 @@ std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseLua(String tex
 	const int MODE_NUMBER = 5;
 	const int MODE_MEMBER = 6;
 						
-	int mode = MODE_GENERAL;
+	// only block comments and strings carry over to the next line
+	int mode = startMode;
 	
 	bool isComment = false;
 	
@@ -194,6 +199,9 @@ std::vector<SyntaxHighlightToken> PolycodeSyntaxHighlighter::parseLua(String tex
 //		printf("%s(%d)", tokens[i].text.c_str(), tokens[i].type);		
 	}
 	
+	if(endMode)
+		*endMode = mode;
+	
 	return tokens;
 }
 
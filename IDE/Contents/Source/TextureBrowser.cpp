@@ -21,10 +21,227 @@
  */
  
 #include "TextureBrowser.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+ThumbnailJob::ThumbnailJob(ThumbnailCache *cache) : Job() {
+	this->cache = cache;
+}
+
+void ThumbnailJob::run() {
+	// requests dropped by clear() leave their jobs with nothing to do
+	ThumbnailRequest *request = cache->takeRequest();
+	if(!request) {
+		return;
+	}
+	cache->generateThumbnail(request);
+	cache->finishRequest(request);
+}
+
+ThumbnailCache *ThumbnailCache::getInstance() {
+	static ThumbnailCache *instance = new ThumbnailCache();
+	return instance;
+}
+
+ThumbnailCache::ThumbnailCache() {
+	Core *core = CoreServices::getInstance()->getCore();
+	mutex = core->createMutex();
+	
+	core->createFolder(core->getUserHomeDirectory()+"/Library/Application Support/Polycode");
+	cacheFolder = core->getUserHomeDirectory()+"/Library/Application Support/Polycode/ThumbnailCache";
+	core->createFolder(cacheFolder);
+	pruneDiskCache();
+}
+
+static bool compareCacheFileTimes(const std::pair<long, String> &a, const std::pair<long, String> &b) {
+	return a.first < b.first;
+}
+
+void ThumbnailCache::pruneDiskCache() {
+	std::vector<OSFileEntry> files = OSBasics::parseFolder(cacheFolder, false);
+	std::vector<std::pair<long, String> > thumbnails;
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].type == OSFileEntry::TYPE_FILE && files[i].extension == "png") {
+			thumbnails.push_back(std::pair<long, String>(OSBasics::getModificationTime(files[i].fullPath), files[i].fullPath));
+		}
+	}
+	if(thumbnails.size() <= MAX_DISK_THUMBNAILS) {
+		return;
+	}
+	
+	// the oldest thumbnails go first, files still in use simply get theirs generated again
+	std::sort(thumbnails.begin(), thumbnails.end(), compareCacheFileTimes);
+	for(int i=0; i < thumbnails.size() - MAX_DISK_THUMBNAILS; i++) {
+		OSBasics::removeItem(thumbnails[i].second);
+	}
+}
+
+String ThumbnailCache::requestThumbnail(const String &path) {
+	struct stat fileInfo;
+	if(stat(path.c_str(), &fileInfo) != 0) {
+		return "";
+	}
+	
+	// FNV-1a of the path, modification time and size, so edited files get a new thumbnail
+	String keySource = path + "|" + String::IntToString(fileInfo.st_mtime) + "|" + String::IntToString(fileInfo.st_size);
+	unsigned long long hash = 14695981039346656037ULL;
+	for(int i=0; i < keySource.length(); i++) {
+		hash ^= (unsigned char)keySource.contents[i];
+		hash *= 1099511628211ULL;
+	}
+	char hashString[17];
+	sprintf(hashString, "%016llx", hash);
+	String key = hashString;
+	
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	if(activeRequests.find(key.contents) == activeRequests.end() && finishedThumbnails.find(key.contents) == finishedThumbnails.end()) {
+		ThumbnailRequest *request = new ThumbnailRequest();
+		request->path = path;
+		request->key = key;
+		request->cachePath = cacheFolder + "/" + key + ".png";
+		request->image = NULL;
+		pendingRequests.push_back(request);
+		activeRequests[key.contents] = request;
+		core->getJobPool()->addJob(new ThumbnailJob(this));
+	}
+	core->unlockMutex(mutex);
+	
+	return key;
+}
+
+bool ThumbnailCache::takeThumbnail(const String &key, Image **image) {
+	bool finished = false;
+	*image = NULL;
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	std::map<std::string, Image*>::iterator it = finishedThumbnails.find(key.contents);
+	if(it != finishedThumbnails.end()) {
+		*image = it->second;
+		finishedThumbnails.erase(it);
+		finished = true;
+	}
+	core->unlockMutex(mutex);
+	return finished;
+}
+
+void ThumbnailCache::clear() {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	for(int i=0; i < pendingRequests.size(); i++) {
+		delete pendingRequests[i];
+	}
+	pendingRequests.clear();
+	// requests a job is working on are deleted by finishRequest()
+	activeRequests.clear();
+	
+	for(std::map<std::string, Image*>::iterator it = finishedThumbnails.begin(); it != finishedThumbnails.end(); it++) {
+		delete it->second;
+	}
+	finishedThumbnails.clear();
+	core->unlockMutex(mutex);
+}
+
+ThumbnailRequest *ThumbnailCache::takeRequest() {
+	ThumbnailRequest *request = NULL;
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	if(pendingRequests.size() > 0) {
+		request = pendingRequests[pendingRequests.size()-1];
+		pendingRequests.pop_back();
+	}
+	core->unlockMutex(mutex);
+	return request;
+}
+
+void ThumbnailCache::generateThumbnail(ThumbnailRequest *request) {
+	struct stat fileInfo;
+	if(stat(request->cachePath.c_str(), &fileInfo) == 0) {
+		Image *cached = new Image();
+		if(cached->loadImage(request->cachePath)) {
+			request->image = cached;
+			return;
+		}
+		delete cached;
+	}
+	
+	Image *source = new Image(request->path);
+	if(source->isLoaded()) {
+		request->image = downscaleImage(source);
+		// write to a temporary file first so a browser opened meanwhile never reads half a thumbnail
+		String tempPath = request->cachePath + ".tmp";
+		if(request->image->savePNG(tempPath)) {
+			rename(tempPath.c_str(), request->cachePath.c_str());
+		}
+	}
+	delete source;
+}
+
+void ThumbnailCache::finishRequest(ThumbnailRequest *request) {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(mutex);
+	std::map<std::string, ThumbnailRequest*>::iterator it = activeRequests.find(request->key.contents);
+	if(it != activeRequests.end() && it->second == request) {
+		activeRequests.erase(it);
+		// files that could not be decoded finish with a NULL image, so their entries stop waiting
+		finishedThumbnails[request->key.contents] = request->image;
+	} else {
+		// cleared while it was being generated
+		delete request->image;
+	}
+	core->unlockMutex(mutex);
+	delete request;
+}
+
+Image *ThumbnailCache::downscaleImage(Image *image) {
+	int pixelSize = image->getType() == Image::IMAGE_RGB ? 3 : 4;
+	int sourceWidth = image->getWidth();
+	int sourceHeight = image->getHeight();
+	unsigned char *source = (unsigned char*)image->getPixels();
+	
+	Image *thumbnail = new Image(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Image::IMAGE_RGBA);
+	unsigned char *dest = (unsigned char*)thumbnail->getPixels();
+	
+	// box filter: every thumbnail pixel averages the source pixels it covers
+	for(int y=0; y < THUMBNAIL_SIZE; y++) {
+		int y0 = (y * sourceHeight) / THUMBNAIL_SIZE;
+		int y1 = ((y+1) * sourceHeight) / THUMBNAIL_SIZE;
+		if(y1 <= y0)
+			y1 = y0+1;
+		for(int x=0; x < THUMBNAIL_SIZE; x++) {
+			int x0 = (x * sourceWidth) / THUMBNAIL_SIZE;
+			int x1 = ((x+1) * sourceWidth) / THUMBNAIL_SIZE;
+			if(x1 <= x0)
+				x1 = x0+1;
+			
+			unsigned int sum[4] = {0, 0, 0, 0};
+			for(int sy=y0; sy < y1; sy++) {
+				unsigned char *row = source + ((sy * sourceWidth) + x0) * pixelSize;
+				for(int sx=x0; sx < x1; sx++) {
+					sum[0] += row[0];
+					sum[1] += row[1];
+					sum[2] += row[2];
+					sum[3] += pixelSize == 4 ? row[3] : 255;
+					row += pixelSize;
+				}
+			}
+			
+			unsigned int count = (y1-y0) * (x1-x0);
+			unsigned char *pixel = dest + ((y * THUMBNAIL_SIZE) + x) * 4;
+			for(int c=0; c < 4; c++) {
+				pixel[c] = sum[c] / count;
+			}
+		}
+	}
+	return thumbnail;
+}
 
 AssetEntry::AssetEntry(String assetPath, String assetName, String extension) : UIElement() {
 
 	this->assetPath = assetPath;
+	needsThumbnail = false;
+	thumbnailTexture = NULL;
 
 	if(assetName.length() > 20)
 		assetName = assetName.substr(0,20)+"...";
@@ -41,7 +258,9 @@ AssetEntry::AssetEntry(String assetPath, String assetName, String extension) : U
 	addChild(imageShape);
 	
 	if(extension == "png") {
-		imageShape->loadTexture(assetPath);
+		// grey placeholder until the thumbnail cache gets to this entry
+		imageShape->setColor(0.5, 0.5, 0.5, 0.5);
+		needsThumbnail = true;
 	}
 	
 	if(extension == "ogg" || extension == "wav") {
@@ -66,9 +285,40 @@ AssetEntry::~AssetEntry() {
 	delete imageShape;
 	delete nameLabel;
 	delete selectShape;
+	if(thumbnailTexture) {
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(thumbnailTexture);
+	}
+}
+
+void AssetEntry::updateThumbnail() {
+	if(!needsThumbnail) {
+		return;
+	}
+	
+	if(thumbnailKey == "") {
+		thumbnailKey = ThumbnailCache::getInstance()->requestThumbnail(assetPath);
+		if(thumbnailKey == "") {
+			needsThumbnail = false;
+			return;
+		}
+	}
+	
+	Image *thumbnail;
+	if(!ThumbnailCache::getInstance()->takeThumbnail(thumbnailKey, &thumbnail)) {
+		return;
+	}
+	needsThumbnail = false;
+	// files that fail to decode keep the grey placeholder
+	if(thumbnail) {
+		thumbnailTexture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(thumbnail, true, false);
+		imageShape->setTexture(thumbnailTexture);
+		imageShape->setColor(1.0, 1.0, 1.0, 1.0);
+		delete thumbnail;
+	}
 }
 
 AssetList::AssetList() : UIElement() {
+	viewHeight = 0;
 	
 	bgShape = new ScreenShape(ScreenShape::SHAPE_RECT, 100,100);
 	bgShape->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
@@ -105,6 +355,7 @@ void AssetList::showFolder(String folderPath) {
 		delete assetEntries[i];
 	}
 	assetEntries.clear();
+	ThumbnailCache::getInstance()->clear();
 	
 	currentEntry = NULL;
 	
@@ -145,6 +396,22 @@ void AssetList::showFolder(String folderPath) {
 	rebuildTransformMatrix();	
 }
 
+void AssetList::setViewHeight(Number viewHeight) {
+	this->viewHeight = viewHeight;
+}
+
+void AssetList::Update() {
+	// entries are laid out in rows of 100, so only the rows inside the scroll view (and one either side) ask for thumbnails
+	Number viewTop = -getPosition().y - 100;
+	Number viewBottom = -getPosition().y + viewHeight + 100;
+	for(int i=0; i < assetEntries.size(); i++) {
+		AssetEntry *entry = assetEntries[i];
+		if(entry->needsThumbnail && entry->getPosition().y < viewBottom && entry->getPosition().y + 100 > viewTop) {
+			entry->updateThumbnail();
+		}
+	}
+}
+
 void AssetList::handleEvent(Event *event) {
 	for(int i=0; i < assetEntries.size(); i++) {
 		if(event->getDispatcher() == assetEntries[i]->selectShape && event->getEventCode() == InputEvent::EVENT_MOUSEDOWN) {
@@ -184,6 +451,7 @@ AssetBrowser::AssetBrowser() : UIWindow(L"Asset Browser", 850, 500) {
 	assetList = new AssetList();
 	
 	listContainer = new UIScrollContainer(assetList, false, true, 640, 480-topPadding-padding-padding);
+	assetList->setViewHeight(480-topPadding-padding-padding);
 	listContainer->setPosition(220,topPadding+padding);		
 	addChild(listContainer);
 
@@ -69,4 +69,77 @@ void TextInputPopup::handleEvent(Event *event) {
 
 TextInputPopup::~TextInputPopup() {
 	
-}
\ No newline at end of file
+}
+
+GoToFilePopup::GoToFilePopup() : UIWindow(L"Go to File", 400, 60 + (NUM_RESULTS * 16)) {
+	project = NULL;
+	
+	textInput = new UITextInput(false, 400-(padding*3.0), 12);
+	textInput->addEventListener(this, UIEvent::CHANGE_EVENT);
+	textInput->addEventListener(this, Event::COMPLETE_EVENT);
+	addChild(textInput);
+	textInput->setPosition(padding, 35);
+	
+	for(int i=0; i < NUM_RESULTS; i++) {
+		ScreenLabel *label = new ScreenLabel("", 11);
+		label->setPosition(padding, 62 + (i * 16));
+		label->processInputEvents = true;
+		label->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
+		addChild(label);
+		resultLabels.push_back(label);
+	}
+	
+	closeOnEscape = true;
+}
+
+GoToFilePopup::~GoToFilePopup() {
+	
+}
+
+void GoToFilePopup::setProject(PolycodeProject *project) {
+	this->project = project;
+	textInput->setText("");
+	focusChild(textInput);
+	updateResults();
+}
+
+OSFileEntry GoToFilePopup::getSelectedFile() {
+	return selectedFile;
+}
+
+void GoToFilePopup::updateResults() {
+	results.clear();
+	if(project && textInput->getText() != "") {
+		results = project->getIndex()->search(textInput->getText(), NUM_RESULTS);
+	}
+	
+	for(int i=0; i < NUM_RESULTS; i++) {
+		if(i < results.size()) {
+			resultLabels[i]->setText(results[i].fileEntry.fullPath.replace(project->getRootFolder()+"/", ""));
+		} else {
+			resultLabels[i]->setText("");
+		}
+	}
+}
+
+void GoToFilePopup::handleEvent(Event *event) {
+	if(event->getDispatcher() == textInput) {
+		if(event->getEventType() == "UIEvent" && event->getEventCode() == UIEvent::CHANGE_EVENT) {
+			updateResults();
+		}
+		if(event->getEventCode() == Event::COMPLETE_EVENT && results.size() > 0) {
+			selectedFile = results[0].fileEntry;
+			dispatchEvent(new UIEvent(), UIEvent::OK_EVENT);
+		}
+	}
+	
+	if(event->getEventCode() == InputEvent::EVENT_MOUSEDOWN) {
+		for(int i=0; i < results.size(); i++) {
+			if(event->getDispatcher() == resultLabels[i]) {
+				selectedFile = results[i].fileEntry;
+				dispatchEvent(new UIEvent(), UIEvent::OK_EVENT);
+			}
+		}
+	}
+	UIWindow::handleEvent(event);
+}
@@ -24,6 +24,7 @@ THE SOFTWARE.
 #include "PolyPhysicsScreen.h"
 #include "PolyScreenEntity.h"
 #include "PolyPhysicsScreenEntity.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -486,6 +487,7 @@ void PhysicsScreen::handleEvent(Event *event) {
 }
 
 void PhysicsScreen::Update() {
+	POLY_PROFILE_ZONE("PhysicsScreen::Update");
 	for(int i=0; i<physicsChildren.size();i++) {
 		physicsChildren[i]->Update();
 	}
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "PolyCollisionScene.h"
 #include "PolyCollisionSceneEntity.h"
 #include "PolySceneEntity.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -45,6 +46,7 @@ void CollisionScene::initCollisionScene(Vector3 size) {
 }
 
 void CollisionScene::Update() {
+	POLY_PROFILE_ZONE("CollisionScene::Update");
 	
 	for(int i=0; i < collisionChildren.size(); i++) {
 		if(collisionChildren[i]->enabled)
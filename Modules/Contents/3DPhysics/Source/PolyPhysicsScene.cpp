@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include "PolyVector3.h"
 #include "PolyPhysicsSceneEntity.h"
 #include "PolyCore.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -142,6 +143,7 @@ void PhysicsScene::processWorldCollisions() {
 }
 
 void PhysicsScene::Update() {
+	POLY_PROFILE_ZONE("PhysicsScene::Update");
 	
 	for(int i=0; i < physicsChildren.size(); i++) {
 //		if(physicsChildren[i]->enabled)
@@ -40,7 +40,12 @@ class TUIOInputModule : public PolycodeModule, TuioListener {
 		
 	protected:
 	
+		void queueTouchEvent(TuioCursor *tcur, unsigned int type);
+	
 		CoreMutex *eventMutex;
 		TuioClient *tuioClient;
+		
+		// events are reused between updates so their touch vectors keep their storage
 		std::vector<TUIOEvent> events;
+		unsigned int numEvents;
 };
\ No newline at end of file
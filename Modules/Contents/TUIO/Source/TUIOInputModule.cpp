@@ -9,6 +9,7 @@ TUIOInputModule::TUIOInputModule(int port) : PolycodeModule(), TuioListener() {
 	tuioClient->connect();
 	
 	eventMutex = CoreServices::getInstance()->getCore()->createMutex();
+	numEvents = 0;
 	_requiresUpdate = true;
 
 }
@@ -30,80 +31,42 @@ void TUIOInputModule::removeTuioObject(TuioObject *tobj) {
 }
 
 void TUIOInputModule::addTuioCursor(TuioCursor *tcur) {
-	std::vector<TouchInfo> touches;	
-	std::list<TuioCursor*> cursorList = tuioClient->getTuioCursors();
-	tuioClient->lockCursorList();
-	for (std::list<TuioCursor*>::iterator iter = cursorList.begin(); iter!=cursorList.end(); iter++) {
-			TuioCursor *tuioCursor = (*iter);	
-			TouchInfo touch;	
-			touch.position.x = tuioCursor->getX();
-			touch.position.y = tuioCursor->getY();
-			touch.id= tuioCursor->getCursorID();
-			touches.push_back(touch);
-	}
-	tuioClient->unlockCursorList();	
-	TUIOEvent event;
-	event.type = InputEvent::EVENT_TOUCHES_BEGAN;
-	event.touches = touches;
-	
-	event.touch.position.x = tcur->getX();
-	event.touch.position.y = tcur->getY();
-	event.touch.id = tcur->getCursorID();
-	
-	CoreServices::getInstance()->getCore()->lockMutex(eventMutex);
-	events.push_back(event);					
-	CoreServices::getInstance()->getCore()->unlockMutex(eventMutex);
+	queueTouchEvent(tcur, InputEvent::EVENT_TOUCHES_BEGAN);
 }
 
 void TUIOInputModule::updateTuioCursor(TuioCursor *tcur) {
-	std::vector<TouchInfo> touches;	
-	std::list<TuioCursor*> cursorList = tuioClient->getTuioCursors();
-	tuioClient->lockCursorList();
-	for (std::list<TuioCursor*>::iterator iter = cursorList.begin(); iter!=cursorList.end(); iter++) {
-			TuioCursor *tuioCursor = (*iter);	
-			TouchInfo touch;	
-			touch.position.x = tuioCursor->getX();
-			touch.position.y = tuioCursor->getY();
-			touch.id= tuioCursor->getCursorID();			
-			touches.push_back(touch);
-	}
-	tuioClient->unlockCursorList();	
-	TUIOEvent event;
-	event.type = InputEvent::EVENT_TOUCHES_MOVED;
-	event.touches = touches;
-	
-	event.touch.position.x = tcur->getX();
-	event.touch.position.y = tcur->getY();
-	event.touch.id = tcur->getCursorID();
-		
-	CoreServices::getInstance()->getCore()->lockMutex(eventMutex);
-	events.push_back(event);					
-	CoreServices::getInstance()->getCore()->unlockMutex(eventMutex);
+	queueTouchEvent(tcur, InputEvent::EVENT_TOUCHES_MOVED);
 }
 
 void TUIOInputModule::removeTuioCursor(TuioCursor *tcur) {
-	std::vector<TouchInfo> touches;	
+	queueTouchEvent(tcur, InputEvent::EVENT_TOUCHES_ENDED);
+}
+
+void TUIOInputModule::queueTouchEvent(TuioCursor *tcur, unsigned int type) {
 	std::list<TuioCursor*> cursorList = tuioClient->getTuioCursors();
+	
+	CoreServices::getInstance()->getCore()->lockMutex(eventMutex);
+	if(numEvents == events.size())
+		events.push_back(TUIOEvent());
+	TUIOEvent &event = events[numEvents];
+	numEvents++;
+	
+	event.touches.clear();
 	tuioClient->lockCursorList();
 	for (std::list<TuioCursor*>::iterator iter = cursorList.begin(); iter!=cursorList.end(); iter++) {
 			TuioCursor *tuioCursor = (*iter);	
 			TouchInfo touch;	
 			touch.position.x = tuioCursor->getX();
 			touch.position.y = tuioCursor->getY();
-			touch.id= tuioCursor->getCursorID();			
-			touches.push_back(touch);
+			touch.id= tuioCursor->getCursorID();
+			event.touches.push_back(touch);
 	}
-	tuioClient->unlockCursorList();
-	TUIOEvent event;
-	event.type = InputEvent::EVENT_TOUCHES_ENDED;
-	event.touches = touches;
+	tuioClient->unlockCursorList();	
 	
+	event.type = type;
 	event.touch.position.x = tcur->getX();
 	event.touch.position.y = tcur->getY();
-	event.touch.id = tcur->getCursorID();	
-	
-	CoreServices::getInstance()->getCore()->lockMutex(eventMutex);
-	events.push_back(event);					
+	event.touch.id = tcur->getCursorID();
 	CoreServices::getInstance()->getCore()->unlockMutex(eventMutex);
 }
 
@@ -116,7 +79,7 @@ void TUIOInputModule::Update(Number elapsed) {
 
 	core->lockMutex(core->eventMutex);	
 	CoreServices::getInstance()->getCore()->lockMutex(eventMutex);
-	for(int i=0; i < events.size(); i++) {
+	for(int i=0; i < numEvents; i++) {
 		for(int j=0; j < events[i].touches.size(); j++) {
 			events[i].touches[j].position.x = events[i].touches[j].position.x * core->getXRes();
 			events[i].touches[j].position.y = events[i].touches[j].position.y * core->getYRes();			
@@ -136,7 +99,7 @@ void TUIOInputModule::Update(Number elapsed) {
 			break;			
 		}
 	}
-	events.clear();
+	numEvents = 0;
 	core->unlockMutex(core->eventMutex);	
 	CoreServices::getInstance()->getCore()->unlockMutex(eventMutex);	
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+#include <string>
+
+namespace Polycode {
+
+	/**
+	* A span of a UITextBuffer's storage.
+	*/
+	class _PolyExport UITextPiece {
+		public:
+			unsigned int start;
+			unsigned int length;
+	};
+	
+	/**
+	* Saved contents of a UITextBuffer, used for undo. States only hold the list of pieces, so saving one doesn't copy any text.
+	*/
+	class _PolyExport UITextBufferState {
+		public:
+			std::vector<UITextPiece> pieces;
+			unsigned int length;
+			unsigned int storageGeneration;
+	};
+
+	/**
+	* Piece table text buffer with a line index, used by UITextInput. Text is never moved or copied once it is in the buffer: every string that is set or inserted is appended to a single storage string, and the document is the list of pieces of that storage that make it up. Inserting or removing text only splits pieces and shifts the piece offsets and line starts after the edit, so an edit never copies document text, although it still takes time linear in the number of pieces and lines. Restoring a saved state rebuilds the whole line index. Positions are given as line and column, in bytes, like the rest of the text input code.
+	*/
+	class _PolyExport UITextBuffer {
+		public:
+			UITextBuffer();
+			~UITextBuffer();
+			
+			/**
+			* Replaces the whole text. If no saved state refers to the storage any more, the storage is dropped and only holds the new text.
+			*/
+			void setText(const String &text);
+			String getText();
+			
+			unsigned int getNumLines();
+			String getLine(unsigned int line);
+			unsigned int getLineLength(unsigned int line);
+			
+			/**
+			* Returns the text between two positions. Columns past the end of their line are clamped.
+			*/
+			String getText(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd);
+			
+			/**
+			* Inserts text, which can contain newlines, at a position.
+			*/
+			void insertText(unsigned int line, unsigned int column, const String &text);
+			
+			/**
+			* Removes the text between two positions.
+			*/
+			void removeText(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd);
+			
+			void saveState(UITextBufferState *state);
+			
+			/**
+			* Restores a saved state. States saved before the storage was last dropped are ignored.
+			* @return True if the state was restored.
+			*/
+			bool restoreState(const UITextBufferState &state);
+			
+			/**
+			* Tells the buffer that none of the states saved so far will be restored, so that the next setText() can drop the storage they refer to.
+			*/
+			void releaseStates();
+			
+			unsigned int getLength();
+			unsigned int getNumPieces();
+			
+		protected:
+		
+			unsigned int getOffset(unsigned int line, unsigned int column);
+			unsigned int splitPieceAt(unsigned int offset);
+			void updatePieceOffsets(unsigned int firstPiece);
+			void rebuildLineIndex();
+			std::string getRange(unsigned int offset, unsigned int length);
+			
+			std::string storage;
+			std::vector<UITextPiece> pieces;
+			std::vector<unsigned int> pieceOffsets;
+			std::vector<unsigned int> lineStarts;
+			unsigned int length;
+			
+			bool statesSaved;
+			unsigned int storageGeneration;
+	};
+}
@@ -35,6 +35,7 @@
 #include "PolyCore.h"
 #include <vector>
 #include "PolyUIScrollContainer.h"
+#include "PolyUITextBuffer.h"
 
 using namespace std;
 
@@ -44,7 +45,12 @@ namespace Polycode {
 
 	class UITextInputUndoState {
 		public:
-			String content;
+			UITextBufferState bufferState;
+			
+			/**
+			* Highlighter states of the lines that were up to date when the state was saved, so undoing doesn't parse the document again from the first line.
+			*/
+			vector<int> lineStates;
 			unsigned int lineOffset;
 			unsigned int caretPosition;
 			bool hasSelection;			
@@ -63,6 +69,14 @@ namespace Polycode {
 	class _PolyExport UITextInputSyntaxHighlighter {
 		public:		
 			virtual std::vector<SyntaxHighlightToken> parseText(String text) = 0;
+			
+			/**
+			* Tokenizes a single line. UITextInput highlights line by line and keeps the state each line starts in, so that an edit only re-tokenizes lines until the state after them matches what it was before. The default implementation calls parseText() and doesn't carry any state between lines.
+			* @param text Line to tokenize, without its newline.
+			* @param startState State at the start of the line. 0 for the first line.
+			* @param endState Set to the state at the start of the next line. States must not be negative.
+			*/
+			virtual std::vector<SyntaxHighlightToken> parseLine(String text, int startState, int *endState);
 	};
 
 	class _PolyExport FindMatch {
@@ -80,6 +94,9 @@ namespace Polycode {
 			void handleEvent(Event *event);
 			void Update();
 			
+			/**
+			* Replaces the text and clears the undo history.
+			*/
 			void setText(String text);
 			String getText();
 			void onLoseFocus();
@@ -134,7 +151,6 @@ namespace Polycode {
 			int caretSkipWordBack(int caretLine, int caretPosition);
 			int caretSkipWordForward(int caretLine, int caretPosition);
 		
-			void selectLineFromOffset();
 			void updateCaretPosition();
 			void setCaretToMouse(Number x, Number y);
 			void dragSelectionTo(Number x, Number y);		
@@ -142,14 +158,23 @@ namespace Polycode {
 			void selectWordAtCaret();
 		
 			void restructLines();
-			void removeLine(ScreenLabel *line);
+			
+			void insertTextAt(unsigned int line, unsigned int column, const String &text);
+			void removeTextRange(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd);
+			void linesEdited(unsigned int firstLine, int lineDelta);
+			
+			void resetLineStates();
+			void updateLineStates(unsigned int lastLine);
+			
+			void addLineLabel();
+			void createLineLabels();
+			int getFirstVisibleLine();
+			void renderLines();
+			Number getTextWidth(const String &text);
 		
 			ScreenShape *selectorRectTop;
 			ScreenShape *selectorRectMiddle;
 			ScreenShape *selectorRectBottom;		
-			int numLines;
-			
-			bool needFullRedraw;
 			
 			Number padding;
 			Number lineSpacing;
@@ -175,8 +200,6 @@ namespace Polycode {
 		
 			ScreenEntity *linesContainer;
 			
-			vector<ScreenLabel*> linesToDelete;	
-			
 			std::vector<FindMatch> findMatches;
 			int findIndex;
 			
@@ -199,8 +222,24 @@ namespace Polycode {
 			Number lineHeight;
 		
 			int lineOffset;
-			ScreenLabel *currentLine;		
-			vector<ScreenLabel*> lines;
+			
+			UITextBuffer buffer;
+			
+			/**
+			* Labels for the visible lines only. Line n is drawn by lineLabels[n % lineLabels.size()], and a label is only rasterized again when its text or highlighter state changes.
+			*/
+			vector<ScreenLabel*> lineLabels;
+			vector<int> lineLabelStates;
+			bool linesDirty;
+			int lastFirstVisibleLine;
+			
+			/**
+			* Highlighter state at the start of each line. The first validLineStates entries are up to date. After an edit, the entries from reusableStatesStart to reusableStatesEnd hold the states from before it, and are reused as soon as the state after the edit matches them again.
+			*/
+			vector<int> lineStates;
+			unsigned int validLineStates;
+			unsigned int reusableStatesStart;
+			unsigned int reusableStatesEnd;
 			
 	};
 }
\ No newline at end of file
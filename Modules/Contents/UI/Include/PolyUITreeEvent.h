@@ -28,9 +28,11 @@
 
 namespace Polycode {
 	class UITree;
+	class UIVirtualTreeNode;
 	class _PolyExport UITreeEvent : public Event {
 		public:
 			UITreeEvent(UITree *selection);
+			UITreeEvent(UIVirtualTreeNode *node);
 			UITreeEvent();
 			~UITreeEvent();
 		
@@ -40,6 +42,11 @@ namespace Polycode {
 			static const int DRAG_START_EVENT = 2003;
 			
 			UITree *selection;
+			
+			/**
+			* Node the event is about, for events dispatched by a UIVirtualTreeContainer.
+			*/
+			UIVirtualTreeNode *node;
 
 		protected:
 		
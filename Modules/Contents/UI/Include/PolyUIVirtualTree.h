@@ -0,0 +1,141 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyEventDispatcher.h"
+#include "PolyScreenLabel.h"
+#include "PolyScreenImage.h"
+#include "PolyScreenShape.h"
+#include "PolyScreenEntity.h"
+#include "PolyUITreeEvent.h"
+#include "PolyUIBox.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	class UIVirtualTreeContainer;
+
+	/**
+	* A node of a UIVirtualTreeContainer. Nodes only hold data and expansion state, they are shown by whichever row of the container happens to be bound to them, so a tree can have any number of nodes without creating entities or label textures for them.
+	*/
+	class _PolyExport UIVirtualTreeNode : public EventDispatcher {
+		public:
+			UIVirtualTreeNode(UIVirtualTreeContainer *container, UIVirtualTreeNode *parent, const String &icon, const String &text, void *userData);
+			~UIVirtualTreeNode();
+			
+			UIVirtualTreeNode *addTreeChild(String icon, String text, void *userData = NULL);
+			
+			/**
+			* Adds a child node before the child currently at index, so callers can keep the children in order.
+			*/
+			UIVirtualTreeNode *insertTreeChild(int index, String icon, String text, void *userData = NULL);
+			void removeTreeChild(UIVirtualTreeNode *child);
+			void clearTree();
+			
+			int getNumTreeChildren() { return treeChildren.size(); }
+			UIVirtualTreeNode *getTreeChild(int index) { return treeChildren[index]; }
+			UIVirtualTreeNode *getParent();
+			
+			void toggleCollapsed();
+			void setCollapsed(bool val);
+			bool isCollapsed();
+			
+			/**
+			* Selects the node. Selection, execution and refresh events are dispatched from the root node, like UITree does.
+			*/
+			void setSelected();
+			UIVirtualTreeNode *getSelectedNode();
+			
+			void *getUserData();
+			void setUserData(void *data);
+			
+			void setLabelText(const String &text);
+			String getLabelText();
+			
+			void setIcon(String iconFile);
+			String getIcon();
+			
+			/**
+			* Nesting level of the node, 0 for the root node.
+			*/
+			int getDepth();
+			
+			/**
+			* Index of the node in the list of expanded rows, or -1 if one of its parents is collapsed. Only valid after the container has refreshed.
+			*/
+			int visibleIndex;
+			
+		protected:
+		
+			UIVirtualTreeContainer *container;
+			UIVirtualTreeNode *parent;
+			vector<UIVirtualTreeNode*> treeChildren;
+			
+			String labelText;
+			String iconFile;
+			void *userData;
+			bool collapsed;
+			int depth;
+	};
+	
+	/**
+	* A row widget of a UIVirtualTreeContainer. The container keeps just enough rows to fill its height and rebinds them to different nodes as it scrolls.
+	*/
+	class _PolyExport UIVirtualTreeRow : public ScreenEntity {
+		public:
+			UIVirtualTreeRow(Number rowWidth);
+			~UIVirtualTreeRow();
+			
+			/**
+			* Shows a node in the row. The label is only rasterized again if its text changed.
+			*/
+			void bindNode(UIVirtualTreeNode *node, bool selected);
+			void unbindNode();
+			
+			void Resize(Number width);
+			
+			UIVirtualTreeNode *node;
+			
+			ScreenShape *bgBox;
+			ScreenImage *arrowIconImage;
+			
+			static const int INDENT_SIZE = 10;
+			
+		protected:
+		
+			Number rowWidth;
+			Number padding;
+			Number cellHeight;
+			Number cellPadding;
+			
+			UIBox *selection;
+			ScreenShape *iconImage;
+			ScreenLabel *textLabel;
+			
+			String labelText;
+			String iconFile;
+	};
+}
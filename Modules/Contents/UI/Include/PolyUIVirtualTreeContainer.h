@@ -0,0 +1,104 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyUIVirtualTree.h"
+#include "PolyUIBox.h"
+#include "PolyUIElement.h"
+#include "PolyUIScrollContainer.h"
+
+namespace Polycode {
+	
+	/**
+	* Tree view for large trees. Works like UITreeContainer, but the tree is a flat model of UIVirtualTreeNode objects and only a fixed pool of rows, enough to fill the visible area, is ever created. Scrolling rebinds rows to other nodes instead of creating entities, and mouse input only ever reaches the pooled rows.
+	*/
+	class _PolyExport UIVirtualTreeContainer : public UIElement {
+	public:
+		UIVirtualTreeContainer(String icon, String text, Number treeWidth, Number treeHeight);
+		~UIVirtualTreeContainer();
+		
+		void handleEvent(Event *event);
+		void Resize(Number width, Number height);
+		void Update();
+		
+		UIVirtualTreeNode *getRootNode();
+		UIVirtualTreeNode *getSelectedNode();
+		void setSelectedNode(UIVirtualTreeNode *node);
+		
+		/**
+		* Number of nodes whose parents are all expanded.
+		*/
+		int getNumVisibleNodes();
+		
+		/**
+		* Number of pooled row widgets.
+		*/
+		int getNumRows();
+		
+		/**
+		* Called by nodes when the expanded rows changed. The list of rows is rebuilt on the next update.
+		*/
+		void setNeedsRefresh();
+		
+		/**
+		* Called by nodes when their label or icon changed.
+		*/
+		void setNeedsRebind();
+		
+		/**
+		* Called by nodes before they are deleted.
+		*/
+		void nodeRemoved(UIVirtualTreeNode *node);
+		
+		/**
+		* Rebuilds the list of expanded rows and rebinds the pooled rows right away, instead of on the next update.
+		*/
+		void refreshTree();
+		
+		ScreenEntity *scrollChild;
+		
+	protected:
+	
+		void addVisibleNodes(UIVirtualTreeNode *node);
+		void resizeRowPool();
+		void bindRows();
+		
+		UIScrollContainer *mainContainer;
+		UIBox *bgBox;
+		
+		UIVirtualTreeNode *rootNode;
+		UIVirtualTreeNode *selectedNode;
+		
+		vector<UIVirtualTreeNode*> visibleNodes;
+		vector<UIVirtualTreeRow*> rows;
+		
+		bool needsRefresh;
+		bool needsRebind;
+		int firstRow;
+		
+		Number treeWidth;
+		Number treeHeight;
+		Number cellHeight;
+	};
+
+}
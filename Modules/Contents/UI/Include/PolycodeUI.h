@@ -33,10 +33,13 @@
 #include "PolyUIHSlider.h"
 #include "PolyUIImageButton.h"
 #include "PolyUIScrollContainer.h"
+#include "PolyUITextBuffer.h"
 #include "PolyUITextInput.h"
 #include "PolyUITree.h"
 #include "PolyUITreeContainer.h"
 #include "PolyUITreeEvent.h"
+#include "PolyUIVirtualTree.h"
+#include "PolyUIVirtualTreeContainer.h"
 #include "PolyUIVScrollBar.h"
 #include "PolyUIWindow.h"
 #include "PolyUIMenu.h"
\ No newline at end of file
@@ -0,0 +1,251 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include "PolyUITextBuffer.h"
+#include <algorithm>
+
+using namespace Polycode;
+
+UITextBuffer::UITextBuffer() {
+	length = 0;
+	statesSaved = false;
+	storageGeneration = 0;
+	lineStarts.push_back(0);
+}
+
+UITextBuffer::~UITextBuffer() {
+
+}
+
+void UITextBuffer::setText(const String &text) {
+	pieces.clear();
+	if(!statesSaved) {
+		storage.clear();
+		storageGeneration++;
+	}
+	length = text.length();
+	if(length > 0) {
+		UITextPiece piece;
+		piece.start = storage.size();
+		piece.length = length;
+		pieces.push_back(piece);
+		storage += text.getSTLString();
+	}
+	updatePieceOffsets(0);
+	rebuildLineIndex();
+}
+
+String UITextBuffer::getText() {
+	return String(getRange(0, length));
+}
+
+String UITextBuffer::getText(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd) {
+	unsigned int start = getOffset(lineStart, columnStart);
+	unsigned int end = getOffset(lineEnd, columnEnd);
+	if(end <= start)
+		return String("");
+	return String(getRange(start, end - start));
+}
+
+unsigned int UITextBuffer::getNumLines() {
+	return lineStarts.size();
+}
+
+String UITextBuffer::getLine(unsigned int line) {
+	if(line >= lineStarts.size())
+		return String("");
+	return String(getRange(lineStarts[line], getLineLength(line)));
+}
+
+unsigned int UITextBuffer::getLineLength(unsigned int line) {
+	if(line >= lineStarts.size())
+		return 0;
+	if(line + 1 < lineStarts.size())
+		return lineStarts[line+1] - 1 - lineStarts[line];
+	return length - lineStarts[line];
+}
+
+unsigned int UITextBuffer::getLength() {
+	return length;
+}
+
+unsigned int UITextBuffer::getNumPieces() {
+	return pieces.size();
+}
+
+unsigned int UITextBuffer::getOffset(unsigned int line, unsigned int column) {
+	if(line >= lineStarts.size())
+		return length;
+	unsigned int lineLength = getLineLength(line);
+	if(column > lineLength)
+		column = lineLength;
+	return lineStarts[line] + column;
+}
+
+void UITextBuffer::updatePieceOffsets(unsigned int firstPiece) {
+	pieceOffsets.resize(pieces.size());
+	for(unsigned int i = firstPiece; i < pieces.size(); i++) {
+		if(i == 0)
+			pieceOffsets[i] = 0;
+		else
+			pieceOffsets[i] = pieceOffsets[i-1] + pieces[i-1].length;
+	}
+}
+
+unsigned int UITextBuffer::splitPieceAt(unsigned int offset) {
+	if(offset >= length)
+		return pieces.size();
+	
+	unsigned int i = (std::upper_bound(pieceOffsets.begin(), pieceOffsets.end(), offset) - pieceOffsets.begin()) - 1;
+	if(pieceOffsets[i] == offset)
+		return i;
+	
+	unsigned int leftLength = offset - pieceOffsets[i];
+	UITextPiece right;
+	right.start = pieces[i].start + leftLength;
+	right.length = pieces[i].length - leftLength;
+	pieces[i].length = leftLength;
+	pieces.insert(pieces.begin() + i + 1, right);
+	pieceOffsets.insert(pieceOffsets.begin() + i + 1, offset);
+	return i + 1;
+}
+
+void UITextBuffer::rebuildLineIndex() {
+	lineStarts.clear();
+	lineStarts.push_back(0);
+	for(unsigned int i=0; i < pieces.size(); i++) {
+		const char *text = storage.data() + pieces[i].start;
+		for(unsigned int j=0; j < pieces[i].length; j++) {
+			if(text[j] == '\n')
+				lineStarts.push_back(pieceOffsets[i] + j + 1);
+		}
+	}
+}
+
+std::string UITextBuffer::getRange(unsigned int offset, unsigned int rangeLength) {
+	std::string result;
+	if(rangeLength == 0 || offset >= length)
+		return result;
+	result.reserve(rangeLength);
+	
+	unsigned int i = (std::upper_bound(pieceOffsets.begin(), pieceOffsets.end(), offset) - pieceOffsets.begin()) - 1;
+	unsigned int pieceOffset = offset - pieceOffsets[i];
+	while(rangeLength > 0 && i < pieces.size()) {
+		unsigned int count = std::min(rangeLength, pieces[i].length - pieceOffset);
+		result.append(storage, pieces[i].start + pieceOffset, count);
+		rangeLength -= count;
+		pieceOffset = 0;
+		i++;
+	}
+	return result;
+}
+
+void UITextBuffer::insertText(unsigned int line, unsigned int column, const String &text) {
+	unsigned int textLength = text.length();
+	if(textLength == 0)
+		return;
+	
+	unsigned int offset = getOffset(line, column);
+	unsigned int storageStart = storage.size();
+	storage += text.getSTLString();
+	
+	// typing extends the piece that was just added instead of adding a piece per character
+	bool extended = false;
+	if(offset > 0) {
+		unsigned int i = (std::upper_bound(pieceOffsets.begin(), pieceOffsets.end(), offset-1) - pieceOffsets.begin()) - 1;
+		if(pieceOffsets[i] + pieces[i].length == offset && pieces[i].start + pieces[i].length == storageStart) {
+			pieces[i].length += textLength;
+			updatePieceOffsets(i+1);
+			extended = true;
+		}
+	}
+	
+	if(!extended) {
+		unsigned int i = splitPieceAt(offset);
+		UITextPiece piece;
+		piece.start = storageStart;
+		piece.length = textLength;
+		pieces.insert(pieces.begin() + i, piece);
+		pieceOffsets.insert(pieceOffsets.begin() + i, offset);
+		updatePieceOffsets(i+1);
+	}
+	length += textLength;
+	
+	unsigned int offsetLine = (std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin()) - 1;
+	for(unsigned int i = offsetLine + 1; i < lineStarts.size(); i++) {
+		lineStarts[i] += textLength;
+	}
+	
+	std::vector<unsigned int> newLineStarts;
+	const std::string &textData = text.getSTLString();
+	for(unsigned int i=0; i < textLength; i++) {
+		if(textData[i] == '\n')
+			newLineStarts.push_back(offset + i + 1);
+	}
+	lineStarts.insert(lineStarts.begin() + offsetLine + 1, newLineStarts.begin(), newLineStarts.end());
+}
+
+void UITextBuffer::removeText(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd) {
+	unsigned int start = getOffset(lineStart, columnStart);
+	unsigned int end = getOffset(lineEnd, columnEnd);
+	if(end <= start)
+		return;
+	
+	unsigned int firstPiece = splitPieceAt(start);
+	unsigned int lastPiece = splitPieceAt(end);
+	pieces.erase(pieces.begin() + firstPiece, pieces.begin() + lastPiece);
+	pieceOffsets.erase(pieceOffsets.begin() + firstPiece, pieceOffsets.begin() + lastPiece);
+	updatePieceOffsets(firstPiece);
+	
+	unsigned int removedLength = end - start;
+	length -= removedLength;
+	
+	// lines that started inside the removed text are gone, the ones after it move back
+	std::vector<unsigned int>::iterator firstLine = std::upper_bound(lineStarts.begin(), lineStarts.end(), start);
+	std::vector<unsigned int>::iterator lastLine = std::upper_bound(lineStarts.begin(), lineStarts.end(), end);
+	unsigned int firstIndex = firstLine - lineStarts.begin();
+	lineStarts.erase(firstLine, lastLine);
+	for(unsigned int i = firstIndex; i < lineStarts.size(); i++) {
+		lineStarts[i] -= removedLength;
+	}
+}
+
+void UITextBuffer::saveState(UITextBufferState *state) {
+	state->pieces = pieces;
+	state->length = length;
+	state->storageGeneration = storageGeneration;
+	statesSaved = true;
+}
+
+bool UITextBuffer::restoreState(const UITextBufferState &state) {
+	if(state.storageGeneration != storageGeneration)
+		return false;
+	pieces = state.pieces;
+	length = state.length;
+	updatePieceOffsets(0);
+	rebuildLineIndex();
+	return true;
+}
+
+void UITextBuffer::releaseStates() {
+	statesSaved = false;
+}
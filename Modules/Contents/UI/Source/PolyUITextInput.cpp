@@ -44,12 +44,12 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : UIElemen
 	
 	settingText = false;
 	
-	currentLine = NULL;
+	lineOffset = 0;
+	findIndex = 0;
 	
-	needFullRedraw = false;
-	
-	lineOffset = -1;
-	numLines = 0;
+	linesDirty = true;
+	lastFirstVisibleLine = -1;
+	syntaxHighliter = NULL;
 	
 	this->positionMode = ScreenEntity::POSITION_TOPLEFT;
 	Config *conf = CoreServices::getInstance()->getConfig();	
@@ -130,11 +130,11 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : UIElemen
 	this->height = rectHeight;
 	setHitbox(width, rectHeight);
 	
-	updateCaretPosition();
-		
-	
 	scrollContainer = NULL;
 	
+	createLineLabels();
+	updateCaretPosition();
+	
 	if(multiLine) {
 		scrollContainer = new UIScrollContainer(linesContainer, false, true, 200, 200);
 		addChild(scrollContainer);
@@ -146,9 +146,13 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : UIElemen
 	undoStateIndex = 0;
 	maxRedoIndex = 0;
 	
-	syntaxHighliter = NULL;
-	
-	insertLine(true);		
+	resetLineStates();
+	restructLines();
+}
+
+std::vector<SyntaxHighlightToken> UITextInputSyntaxHighlighter::parseLine(String text, int startState, int *endState) {
+	*endState = 0;
+	return parseText(text);
 }
 
 void UITextInput::setNumberOnly(bool val) {
@@ -203,27 +207,27 @@ void UITextInput::setSelection(int lineStart, int lineEnd, int colStart, int col
 	clearSelection();	
 
 	
-	if(lineStart > lines.size()-1)
+	if(lineStart > (int)buffer.getNumLines()-1)
 		return;	
 
-	ScreenLabel *topLine = lines[lineStart];	
+	String topLine = buffer.getLine(lineStart);
 	
-	if(colStart+1 > topLine->getText().length()) {
-		colStart = topLine->getText().length();
+	if(colStart+1 > topLine.length()) {
+		colStart = topLine.length();
 	}
 		
 	Number fColEnd  = colEnd;
 	
-	if(colEnd > topLine->getText().length() || lineStart != lineEnd)
-		fColEnd = topLine->getText().length();
+	if(colEnd > topLine.length() || lineStart != lineEnd)
+		fColEnd = topLine.length();
 
 	Number topSize, topHeight, topX;
 	
 	selectorRectTop->visible = true;	
-	topSize = topLine->getLabel()->getTextWidthForString(topLine->getText().substr(colStart,fColEnd-colStart)) ; 
+	topSize = getTextWidth(topLine.substr(colStart,fColEnd-colStart)) ; 
 	topHeight = lineHeight+lineSpacing;
 	if(colStart >= 0) {
-		topX = topLine->getLabel()->getTextWidthForString(topLine->getText().substr(0,colStart));
+		topX = getTextWidth(topLine.substr(0,colStart));
 	} else {
 		topX = 0;
 	}
@@ -231,10 +235,10 @@ void UITextInput::setSelection(int lineStart, int lineEnd, int colStart, int col
 	selectorRectTop->setScale(topSize, topHeight);
 	selectorRectTop->setPosition(topX + padding + (topSize/2.0), padding + (lineStart * (lineHeight+lineSpacing)) + (topHeight/2.0));
 	
-	if(lineEnd > lineStart && lineEnd < lines.size()) {
-		ScreenLabel *bottomLine = lines[lineEnd];	
+	if(lineEnd > lineStart && lineEnd < buffer.getNumLines()) {
+		String bottomLine = buffer.getLine(lineEnd);
 		selectorRectBottom->visible = true;		
-		Number bottomSize = bottomLine->getLabel()->getTextWidthForString(bottomLine->getText().substr(0,colEnd)) ; 
+		Number bottomSize = getTextWidth(bottomLine.substr(0,colEnd)) ; 
 		if(bottomSize < 0)
 			bottomSize = this->width-padding;
 		Number bottomHeight = lineHeight+lineSpacing;
@@ -264,50 +268,8 @@ void UITextInput::setSelection(int lineStart, int lineEnd, int colStart, int col
 }
 
 void UITextInput::deleteSelection() {
-	if(selectionTop == selectionBottom) {
-		String ctext = lines[selectionTop]->getText();
-		String newText = ctext.substr(0, selectionL);
-		int rside = selectionR;
-		if(rside > ctext.length()-1)
-			rside = ctext.length() - 1;
-		newText += ctext.substr(rside,ctext.length() - selectionR); 
-		lines[selectionTop]->setText(newText);
-	} else {
-		
-		String ctext = lines[selectionTop]->getText();
-		String newText = ctext.substr(0, selectionL);
-		lines[selectionTop]->setText(newText);
-
-		ScreenLabel *bottomLine = lines[selectionBottom];
-		
-		// if whole lines to remove, do it
-		vector<ScreenLabel*> linesToRemove;
-		if(selectionBottom > selectionTop + 1) {
-			for(int i=selectionTop+1; i < selectionBottom; i++) {
-				linesToRemove.push_back(lines[i]);
-			}
-			for(int i=0; i < linesToRemove.size(); i++) {
-				removeLine(linesToRemove[i]);
-			}
-		}
-		
-		ctext = bottomLine->getText();
-		
-		int rside = selectionR;
-		if(rside > ctext.length()-1)
-			rside = ctext.length() - 1;
-		newText = ctext.substr(rside,ctext.length() - selectionR); 
-		
-				
-		lineOffset = selectionTop;
-		selectLineFromOffset();
-		caretPosition = currentLine->getText().length();
-		updateCaretPosition();
-		currentLine->setText(currentLine->getText() + newText);	
-		removeLine(bottomLine);				
-		
-		
-	}
+	removeTextRange(selectionTop, selectionL, selectionBottom, selectionR);
+	lineOffset = selectionTop;
 	clearSelection();
 	caretPosition = selectionL;
 	updateCaretPosition();
@@ -317,72 +279,175 @@ void UITextInput::deleteSelection() {
 void UITextInput::changedText() {
 	if(settingText)
 		return;
-		
-	if(syntaxHighliter && multiLine) {
 	
-		unsigned int startLine = (-linesContainer->getPosition().y) / (lineHeight+lineSpacing);				
-		unsigned int endLine = startLine + ((int)((height / (lineHeight+lineSpacing)))) + 1;					
-		
-		if(endLine > lines.size())
-			endLine = lines.size();
+	linesDirty = true;
+	dispatchEvent(new UIEvent(), UIEvent::CHANGE_EVENT);	
+}
+
+void UITextInput::insertTextAt(unsigned int line, unsigned int column, const String &text) {
+	int numLines = buffer.getNumLines();
+	buffer.insertText(line, column, text);
+	linesEdited(line, (int)buffer.getNumLines() - numLines);
+}
+
+void UITextInput::removeTextRange(unsigned int lineStart, unsigned int columnStart, unsigned int lineEnd, unsigned int columnEnd) {
+	int numLines = buffer.getNumLines();
+	buffer.removeText(lineStart, columnStart, lineEnd, columnEnd);
+	linesEdited(lineStart, (int)buffer.getNumLines() - numLines);
+}
+
+void UITextInput::linesEdited(unsigned int firstLine, int lineDelta) {
+	if(lineDelta > 0) {
+		lineStates.insert(lineStates.begin() + firstLine + 1, lineDelta, 0);
+	} else if(lineDelta < 0) {
+		lineStates.erase(lineStates.begin() + firstLine + 1, lineStates.begin() + firstLine + 1 - lineDelta);
+	}
 	
-		if(needFullRedraw) {
-			startLine = 0;
-			endLine = lines.size();
-			needFullRedraw = false;
+	if(firstLine < validLineStates) {
+		// the states after the edited lines are kept, they are still right if the edit doesn't change the state at its end
+		int editEnd = firstLine + 1 + (lineDelta > 0 ? lineDelta : 0);
+		int oldStatesEnd = (int)validLineStates + lineDelta;
+		if(oldStatesEnd > editEnd) {
+			reusableStatesStart = editEnd;
+			reusableStatesEnd = oldStatesEnd;
+		} else {
+			reusableStatesStart = 0;
+			reusableStatesEnd = 0;
+		}
+		validLineStates = firstLine + 1;
+	} else if(reusableStatesEnd > firstLine + 1) {
+		reusableStatesEnd = firstLine + 1;
+		if(reusableStatesEnd <= reusableStatesStart) {
+			reusableStatesStart = 0;
+			reusableStatesEnd = 0;
 		}
+	}
 	
-		String totalText = L"";
-		for(int i=startLine; i < endLine; i++) {
-				totalText += lines[i]->getText();					
-				if(i < lines.size()-1)
-					totalText += L"\n";
-		}	
-		
-		std::vector<SyntaxHighlightToken> tokens = syntaxHighliter->parseText(totalText);
-		
-		for(int i=startLine; i < endLine; i++) {
-			lines[i]->getLabel()->clearColors();
+	if(lineDelta != 0)
+		restructLines();
+	linesDirty = true;
+}
+
+void UITextInput::resetLineStates() {
+	lineStates.assign(buffer.getNumLines(), 0);
+	validLineStates = 1;
+	reusableStatesStart = 0;
+	reusableStatesEnd = 0;
+}
+
+void UITextInput::updateLineStates(unsigned int lastLine) {
+	if(lastLine >= lineStates.size())
+		lastLine = lineStates.size()-1;
+	
+	while(validLineStates <= lastLine) {
+		unsigned int line = validLineStates;
+		int endState;
+		syntaxHighliter->parseLine(buffer.getLine(line-1), lineStates[line-1], &endState);
+		if(line >= reusableStatesStart && line < reusableStatesEnd && lineStates[line] == endState) {
+			validLineStates = reusableStatesEnd;
+			reusableStatesStart = 0;
+			reusableStatesEnd = 0;
+		} else {
+			lineStates[line] = endState;
+			validLineStates++;
+		}
+	}
+}
+
+void UITextInput::addLineLabel() {
+	ScreenLabel *newLine = new ScreenLabel(L"", fontSize, fontName, Label::ANTIALIAS_FULL);
+	newLine->setColor(0,0,0,1);
+	newLine->visible = false;
+	linesContainer->addChild(newLine);
+	lineLabels.push_back(newLine);
+	lineLabelStates.push_back(-2);
+}
+
+void UITextInput::createLineLabels() {
+	if(lineLabels.size() == 0) {
+		addLineLabel();
+		lineHeight = lineLabels[0]->getHeight();
+	}
+	
+	unsigned int numLabels = 1;
+	if(multiLine)
+		numLabels = ((int)(height / (lineHeight+lineSpacing))) + 2;
+	
+	while(lineLabels.size() < numLabels) {
+		addLineLabel();
+	}
+	linesDirty = true;
+}
+
+int UITextInput::getFirstVisibleLine() {
+	if(!multiLine)
+		return 0;
+	int firstLine = (-linesContainer->getPosition().y - padding) / (lineHeight+lineSpacing);
+	if(firstLine < 0)
+		firstLine = 0;
+	return firstLine;
+}
+
+void UITextInput::renderLines() {
+	unsigned int firstLine = getFirstVisibleLine();
+	unsigned int numLines = buffer.getNumLines();
+	unsigned int numLabels = lineLabels.size();
+	
+	bool highlight = (syntaxHighliter && multiLine);
+	if(highlight && firstLine < numLines) {
+		updateLineStates(firstLine + numLabels - 1);
+	}
+	
+	for(unsigned int line = firstLine; line < firstLine + numLabels; line++) {
+		unsigned int index = line % numLabels;
+		ScreenLabel *label = lineLabels[index];
+		if(line >= numLines) {
+			label->visible = false;
+			continue;
 		}
 		
-		int lineIndex = startLine;
-		int rangeStart = 0;
-		int rangeEnd = 0;
-				
-		for(int i=0; i < tokens.size(); i++) {			
-			if(tokens[i].text == "\n") {
-				lineIndex++;
-				rangeStart = 0;
-				rangeEnd = 0;
-			} else {
-			
-				if(lineIndex < lines.size()) {
+		String text = buffer.getLine(line);
+		int state = highlight ? lineStates[line] : -1;
+		
+		if(lineLabelStates[index] != state || label->getText() != text) {
+			label->getLabel()->clearColors();
+			if(highlight) {
+				int endState;
+				std::vector<SyntaxHighlightToken> tokens = syntaxHighliter->parseLine(text, state, &endState);
+				int rangeStart = 0;
+				for(int i=0; i < tokens.size(); i++) {
+					if(tokens[i].text == "\n")
+						continue;
 					int textLength = tokens[i].text.length();
-					if(tokens[i].text.length() > 1) {
-						rangeEnd = rangeStart + textLength-1;
-						lines[lineIndex]->getLabel()->setColorForRange(tokens[i].color, rangeStart, rangeEnd);	
-						rangeStart = rangeStart + textLength; 
-					} else {
-						rangeEnd = rangeStart;
-						lines[lineIndex]->getLabel()->setColorForRange(tokens[i].color, rangeStart, rangeEnd);	
-						rangeStart++;
-					}				
+					if(textLength < 1)
+						textLength = 1;
+					label->getLabel()->setColorForRange(tokens[i].color, rangeStart, rangeStart + textLength - 1);
+					rangeStart += textLength;
 				}
+				label->setColor(1.0, 1.0, 1.0, 1.0);
+			} else {
+				label->setColor(0,0,0,1);
 			}
+			label->setText(text);
+			lineLabelStates[index] = state;
 		}
 		
-		for(int i=startLine; i < endLine; i++) {
-			lines[i]->setText(lines[i]->getText());
-			lines[i]->setColor(1.0, 1.0, 1.0, 1.0);
-		}
-		
+		label->setPosition(padding, padding + (line*(lineHeight+lineSpacing)), 0.0f);
+		label->visible = true;
 	}
+}
 
-	dispatchEvent(new UIEvent(), UIEvent::CHANGE_EVENT);	
+Number UITextInput::getTextWidth(const String &text) {
+	return lineLabels[0]->getLabel()->getTextWidthForString(text);
 }
 
 void UITextInput::setSyntaxHighlighter(UITextInputSyntaxHighlighter *syntaxHighliter) {
 	this->syntaxHighliter = syntaxHighliter;
+	resetLineStates();
+	for(int i=0; i < lineLabelStates.size(); i++) {
+		lineLabelStates[i] = -2;
+	}
+	linesDirty = true;
 }
 
 void UITextInput::Resize(Number width, Number height) {
@@ -399,80 +464,47 @@ void UITextInput::Resize(Number width, Number height) {
 	if(scrollContainer) {
 		scrollContainer->Resize(width, height);
 	}
+	
+	createLineLabels();
 }
 
 int UITextInput::insertLine(bool after) {
-	
-	numLines++;	
-	
-	ScreenLabel *newLine = new ScreenLabel(L"", fontSize, fontName, Label::ANTIALIAS_FULL);
-	newLine->setColor(0,0,0,1);
-	lineHeight = newLine->getHeight();
-	linesContainer->addChild(newLine);
-	
-	if(after) {	
-		
-		if(currentLine) {
-			String ctext = currentLine->getText();
-			String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-			ctext = ctext.substr(0,caretPosition);
-			currentLine->setText(ctext);
-			newLine->setText(text2);
-			caretPosition=0;
-		}
-		
-		currentLine = newLine;		
-		
-		vector<ScreenLabel*>::iterator it;
-		it = lines.begin();
-		
-		for(int i=0; i < lineOffset+1; i++) {
-			it++;
-		}
-		
-		lineOffset = lineOffset + 1;	
-		lines.insert(it,newLine);
-		
-		restructLines();
-	} else {	
-		// do we even need that? I don't think so.
-	}	
-		
+	if(after) {
+		insertTextAt(lineOffset, caretPosition, "\n");
+		lineOffset++;
+		caretPosition = 0;
+	}
 	changedText();
 	return 1;	
 }
 
 void UITextInput::restructLines() {
-
-	for(int i=0; i < lines.size(); i++) {
-		lines[i]->setPosition(padding,padding + (i*(lineHeight+lineSpacing)),0.0f);		
-	}
-	
 	if(scrollContainer) {
-		scrollContainer->setContentSize(width,  (((lines.size()) * ((lineHeight+lineSpacing)))) + padding);
+		scrollContainer->setContentSize(width,  (((buffer.getNumLines()) * ((lineHeight+lineSpacing)))) + padding);
 	}	
 	
 	if(multiLine) {
 		inputRect->setHitbox(width - scrollContainer->getVScrollWidth(), height);
 	}	
-	
+	linesDirty = true;
 }
 
 void UITextInput::setText(String text) {
-	if(!multiLine) {
-		currentLine->setText(text);
-		caretPosition = text.length();
-		clearSelection();				
-		updateCaretPosition();		
-	} else {
-		needFullRedraw = true;	
-		selectAll();
-		insertText(text);
-		clearSelection();
-	}
-		
-//	this->text = text;
-//	currentLine->setText(text);	
+	// the undo history belongs to the old text, dropping it lets the buffer drop the old text too
+	undoStateIndex = 0;
+	maxRedoIndex = 0;
+	buffer.releaseStates();
+	buffer.setText(text);
+	resetLineStates();
+	restructLines();
+	
+	lineOffset = buffer.getNumLines()-1;
+	caretPosition = buffer.getLineLength(lineOffset);
+	clearSelection();
+	updateCaretPosition();
+	
+	if(multiLine)
+		changedText();
 }
 
 void UITextInput::onLoseFocus() {
@@ -481,33 +513,18 @@ void UITextInput::onLoseFocus() {
 }
 
 String UITextInput::getText() {
-	
-	if(!multiLine) {
-		return currentLine->getText();
-	} else {
-		String totalText = L"";
-		for(int i=0; i < lines.size(); i++) {
-				totalText += lines[i]->getText();					
-				if(i < lines.size()-1)
-					totalText += L"\n";
-		}	
-		return totalText;
-	}
+	return buffer.getText();
 }
 
 void UITextInput::updateCaretPosition() {
+	String lineText = buffer.getLine(lineOffset);
+	if(caretPosition > lineText.length())
+		caretPosition = lineText.length();
+	
 	caretImagePosition = padding;
-	if(caretPosition == 0) {
-		caretImagePosition = padding;
-	} else if(caretPosition > currentLine->getText().length()) {
-		caretPosition = currentLine->getText().length();
-		String caretSubString = currentLine->getText().substr(0,caretPosition);
-		caretImagePosition = currentLine->getLabel()->getTextWidthForString(caretSubString);		
+	if(caretPosition > 0) {
+		caretImagePosition = getTextWidth(lineText.substr(0,caretPosition));
 		caretImagePosition = caretImagePosition + padding;		
-	} else {
-		String caretSubString = currentLine->getText().substr(0,caretPosition);
-		caretImagePosition = currentLine->getLabel()->getTextWidthForString(caretSubString);
-		caretImagePosition = caretImagePosition  + padding;		
 	}
 	blinkerRect->visible  = true;
 	blinkTimer->Reset();
@@ -517,24 +534,12 @@ void UITextInput::updateCaretPosition() {
 		
 	}
 	
-	if(multiLine && currentLine) {	
-	
-	
-		if(linesContainer->getPosition().y + currentLine->getPosition2D().y < 0.0) {
+	if(multiLine && scrollContainer) {	
+		Number lineY = padding + (lineOffset * (lineHeight+lineSpacing));
+		if(linesContainer->getPosition().y + lineY < 0.0) {
 			scrollContainer->scrollVertical(-(lineHeight+lineSpacing+padding)/(scrollContainer->getContentSize().y));
-
-		} else if(linesContainer->getPosition().y + currentLine->getPosition2D().y > scrollContainer->getHeight()) {
-		scrollContainer->scrollVertical((lineHeight+lineSpacing+padding)/(scrollContainer->getContentSize().y));
-
-		}
-	}
-}
-
-void UITextInput::selectLineFromOffset() {
-	for(int i=0; i < lines.size(); i++) {
-		if(i == lineOffset) {
-			currentLine = lines[i];					
-			return;
+		} else if(linesContainer->getPosition().y + lineY > scrollContainer->getHeight()) {
+			scrollContainer->scrollVertical((lineHeight+lineSpacing+padding)/(scrollContainer->getContentSize().y));
 		}
 	}
 }
@@ -543,16 +548,18 @@ void UITextInput::dragSelectionTo(Number x, Number y) {
 	x -= padding * 2.0;
 	y -= padding;
 	int lineOffset = y  / (lineHeight+lineSpacing);
-	if(lineOffset > lines.size()-1)
-		lineOffset = lines.size()-1;
+	if(lineOffset > (int)buffer.getNumLines()-1)
+		lineOffset = buffer.getNumLines()-1;
+	if(lineOffset < 0)
+		lineOffset = 0;
 	
-	ScreenLabel *selectToLine = lines[lineOffset];
+	String selectToLine = buffer.getLine(lineOffset);
 	
-	int len = selectToLine->getText().length();
-	Number slen;
-	int caretPosition = selectToLine->getLabel()->getTextWidthForString(selectToLine->getText().substr(0,len));
+	int len = selectToLine.length();
+	Number slen = 0;
+	int caretPosition = getTextWidth(selectToLine);
 	for(int i=0; i < len; i++) {
-		slen = selectToLine->getLabel()->getTextWidthForString(selectToLine->getText().substr(0,i));
+		slen = getTextWidth(selectToLine.substr(0,i));
 		if(slen > x) {
 			caretPosition = i;
 			break;
@@ -571,8 +578,9 @@ void UITextInput::dragSelectionTo(Number x, Number y) {
 }
 
 int UITextInput::caretSkipWordBack(int caretLine, int caretPosition) {
+	String lineText = buffer.getLine(caretLine);
 	for(int i=caretPosition; i > 0; i--) {
-		String bit = lines[caretLine]->getText().substr(i,1);
+		String bit = lineText.substr(i,1);
 		char chr = ((char*)bit.c_str())[0]; 		
 		if(((chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) && i < caretPosition-1) {
 			return i+1;
@@ -582,15 +590,16 @@ int UITextInput::caretSkipWordBack(int caretLine, int caretPosition) {
 }
 
 int UITextInput::caretSkipWordForward(int caretLine, int caretPosition) {
-	int len = lines[caretLine]->getText().length();
+	String lineText = buffer.getLine(caretLine);
+	int len = lineText.length();
 	for(int i=caretPosition; i < len; i++) {
-		String bit = lines[caretLine]->getText().substr(i,1);
+		String bit = lineText.substr(i,1);
 		char chr = ((char*)bit.c_str())[0]; 
 		if(((chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) && i > caretPosition) {
 			return i;
 		}
 	}
-	return lines[caretLine]->getText().length();	
+	return len;	
 }
 
 void UITextInput::selectWordAtCaret() {
@@ -605,10 +614,12 @@ void UITextInput::selectWordAtCaret() {
 }
 
 void UITextInput::replaceAll(String what, String withWhat) {
-	for(int i=0; i < lines.size(); i++) {
-		lines[i]->setText(lines[i]->getText().replace(what, withWhat));
-	}
-	needFullRedraw  = true;
+	buffer.setText(buffer.getText().replace(what, withWhat));
+	resetLineStates();
+	restructLines();
+	if(lineOffset > (int)buffer.getNumLines()-1)
+		lineOffset = buffer.getNumLines()-1;
+	updateCaretPosition();
 	changedText();
 }
 
@@ -617,10 +628,8 @@ void UITextInput::findString(String stringToFind, bool replace, String replaceSt
 	clearSelection();
 	findMatches.clear();
 	
-	for(int i=0; i < lines.size(); i++) {
-
-
-		String lineText = lines[i]->getText();
+	for(int i=0; i < buffer.getNumLines(); i++) {
+		String lineText = buffer.getLine(i);
 		
 		int offset = 0;				
 		int retVal = -1;
@@ -643,10 +652,8 @@ void UITextInput::findString(String stringToFind, bool replace, String replaceSt
 
 		if(replace) {
 			FindMatch match = findMatches[findIndex];
-			String oldText = lines[match.lineNumber]->getText();
-			String newText = oldText.substr(0,match.caretStart) + replaceString + oldText.substr(match.caretEnd);
-			
-			lines[match.lineNumber]->setText(newText);
+			removeTextRange(match.lineNumber, match.caretStart, match.lineNumber, match.caretEnd);
+			insertTextAt(match.lineNumber, match.caretStart, replaceString);
 			findMatches[findIndex].caretEnd = findMatches[findIndex].caretStart + replaceString.length();
 			changedText();			
 		}
@@ -683,7 +690,6 @@ void UITextInput::findCurrent() {
 
 	FindMatch match = findMatches[findIndex];
 
-	currentLine = lines[match.lineNumber];
 	caretPosition = match.caretStart;
 	lineOffset = match.lineNumber;
 	updateCaretPosition();
@@ -699,18 +705,20 @@ void UITextInput::setCaretToMouse(Number x, Number y) {
 	y -= padding;
 	//if(lines.size() > 1) {
 		lineOffset = y  / (lineHeight+lineSpacing);
-		if(lineOffset > lines.size()-1)
-			lineOffset = lines.size()-1;
-		selectLineFromOffset();	
+		if(lineOffset > (int)buffer.getNumLines()-1)
+			lineOffset = buffer.getNumLines()-1;
+		if(lineOffset < 0)
+			lineOffset = 0;
 	//}
 	
-	int len = currentLine->getText().length();
-	Number slen;
+	String lineText = buffer.getLine(lineOffset);
+	int len = lineText.length();
+	Number slen = 0;
 	
 	int newCaretPosition = -1;
 	for(int i=1; i < len; i++) {
-		slen = currentLine->getLabel()->getTextWidthForString(currentLine->getText().substr(0,i));
-		Number slen_prev = currentLine->getLabel()->getTextWidthForString(currentLine->getText().substr(0,i-1));		
+		slen = getTextWidth(lineText.substr(0,i));
+		Number slen_prev = getTextWidth(lineText.substr(0,i-1));		
 		if(x > slen_prev && x < slen) {
 			if(x < slen_prev + ((slen - slen_prev) /2.0)) {
 				newCaretPosition = i-1;
@@ -734,93 +742,41 @@ void UITextInput::setCaretToMouse(Number x, Number y) {
 	updateCaretPosition();	
 }
 
-void UITextInput::removeLine(ScreenLabel *line) {
-	for(int i=0;i<lines.size();i++) {
-		if(lines[i] == line) {
-			lines.erase(lines.begin()+i);
-		}
-	}
-	linesContainer->removeChild(line);
-	linesToDelete.push_back(line);
-	restructLines();
-	changedText();
-}
 
 void UITextInput::selectAll() {
-	setSelection(0, lines.size()-1, 0, lines[lines.size()-1]->getText().length());
+	unsigned int lastLine = buffer.getNumLines()-1;
+	setSelection(0, lastLine, 0, buffer.getLineLength(lastLine));
 }
 
 void UITextInput::insertText(String text) {	
-	vector<String> strings = text.split("\n");
 	settingText = true;
 
 	if(hasSelection)
 		deleteSelection();
 
-	if(strings.size() > 1) {
-		String ctext = currentLine->getText();		
-		String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-		ctext = ctext.substr(0,caretPosition);
-		ctext += strings[0];
-		currentLine->setText(ctext);		
-		caretPosition = ctext.length();
-		
-		for(int i=1; i < strings.size()-1; i++) {
-			insertLine(true);
-			ctext = strings[i];
-			currentLine->setText(ctext);
-			caretPosition = ctext.length();			
-		}
-		
-		insertLine(true);
-		ctext = strings[strings.size()-1] + text2;
-		caretPosition = ctext.length();
-		currentLine->setText(ctext);		
-		
+	int numLines = buffer.getNumLines();
+	insertTextAt(lineOffset, caretPosition, text);
+	int newLines = (int)buffer.getNumLines() - numLines;
+	
+	if(newLines > 0) {
+		lineOffset += newLines;
+		caretPosition = text.length() - (text.rfind("\n") + 1);
 	} else {
-		String ctext = currentLine->getText();		
-		String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-		ctext = ctext.substr(0,caretPosition);
-		ctext += text + text2;
 		caretPosition += text.length();
-		currentLine->setText(ctext);			
 	}
 	
 	settingText = false;	
 	
 	changedText();
 	updateCaretPosition();		
-	restructLines();	
 }
 
 String UITextInput::getLineText(unsigned int index) {
-	if(index < lines.size()) {
-		return lines[index]->getText();
-	} else {
-		return "";
-	}
-}       
+	return buffer.getLine(index);
+}
 
 String UITextInput::getSelectionText() {
-	String totalText = L"";
-	if(selectionTop == selectionBottom) {
-		totalText = lines[selectionTop]->getText().substr(selectionL, selectionR-selectionL);	
-		return totalText;
-	} else {
-		totalText += lines[selectionTop]->getText().substr(selectionL, lines[selectionTop]->getText().length()-selectionL);
-		totalText += L"\n";		
-	}
-	
-	if(selectionBottom > selectionTop+1) {
-		for(int i=selectionTop+1; i <= selectionBottom; i++) {
-			totalText += lines[i]->getText();			
-			totalText += L"\n";
-		}
-	}
-	
-	totalText += lines[selectionBottom]->getText().substr(0, selectionL);
-	
-	return totalText;
+	return buffer.getText(selectionTop, selectionL, selectionBottom, selectionR);
 }
 
 UIScrollContainer *UITextInput::getScrollContainer() {
@@ -829,7 +785,8 @@ UIScrollContainer *UITextInput::getScrollContainer() {
 
 void UITextInput::saveUndoState() {
 	UITextInputUndoState newState;
-	newState.content = getText();
+	buffer.saveState(&newState.bufferState);
+	newState.lineStates.assign(lineStates.begin(), lineStates.begin() + min((size_t)validLineStates, lineStates.size()));
 	newState.caretPosition = caretPosition;
 	newState.lineOffset = lineOffset;
 	newState.hasSelection = hasSelection;
@@ -853,8 +810,14 @@ void UITextInput::saveUndoState() {
 
 void UITextInput::setUndoState(UITextInputUndoState state) {
 	clearSelection();
-	setText(state.content);
-	currentLine = lines[state.lineOffset];
+	if(!buffer.restoreState(state.bufferState))
+		return;
+	resetLineStates();
+	if(state.lineStates.size() > 0 && state.lineStates.size() <= lineStates.size()) {
+		std::copy(state.lineStates.begin(), state.lineStates.end(), lineStates.begin());
+		validLineStates = state.lineStates.size();
+	}
+	restructLines();
 	caretPosition = state.caretPosition;
 	lineOffset = state.lineOffset;
 	updateCaretPosition();
@@ -862,6 +825,7 @@ void UITextInput::setUndoState(UITextInputUndoState state) {
 	if(state.hasSelection) {
 		setSelection(lineOffset, state.selectionLine, caretPosition, state.selectionCaretPosition);
 	}
+	changedText();
 }
 
 void UITextInput::Undo() {
@@ -994,16 +958,16 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 	}
 	
 	if(key == KEY_RIGHT) {
-		if(caretPosition < currentLine->getText().length()) {			
+		if(caretPosition < buffer.getLineLength(lineOffset)) {			
 			if(input->getKeyState(KEY_LSUPER) || input->getKeyState(KEY_RSUPER)) {
 				if(input->getKeyState(KEY_LSHIFT) || input->getKeyState(KEY_RSHIFT)) {
 					if(hasSelection) {
-						setSelection(this->lineOffset, selectionLine, this->caretPosition, lines[selectionLine]->getText().length());					
+						setSelection(this->lineOffset, selectionLine, this->caretPosition, buffer.getLineLength(selectionLine));					
 					} else {
-						setSelection(this->lineOffset, this->lineOffset, this->caretPosition, currentLine->getText().length());
+						setSelection(this->lineOffset, this->lineOffset, this->caretPosition, buffer.getLineLength(lineOffset));
 					}
 				} else {
-					caretPosition = currentLine->getText().length();
+					caretPosition = buffer.getLineLength(lineOffset);
 					clearSelection();
 				}				
 			} else if (input->getKeyState(KEY_LALT) || input->getKeyState(KEY_RALT)) {
@@ -1065,7 +1029,6 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 				clearSelection();				
 				if(lineOffset > 0) {
 					lineOffset--;
-					selectLineFromOffset();
 					updateCaretPosition();							
 				}
 			}
@@ -1078,17 +1041,16 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		if(multiLine) {
 			if(input->getKeyState(KEY_LSHIFT) || input->getKeyState(KEY_RSHIFT)) {			
 				if(hasSelection) {
-					if(selectionLine < lines.size()-1)
+					if(selectionLine < (int)buffer.getNumLines()-1)
 						setSelection(this->lineOffset, selectionLine+1, this->caretPosition, selectionCaretPosition);
 				} else {
-					if(this->lineOffset < lines.size()-1)					
+					if(this->lineOffset < (int)buffer.getNumLines()-1)					
 						setSelection(this->lineOffset, this->lineOffset+1, this->caretPosition, caretPosition);					
 				}				
 			} else {				
 				clearSelection();
-				if(lineOffset < lines.size()-1) {
+				if(lineOffset < (int)buffer.getNumLines()-1) {
 					lineOffset++;
-					selectLineFromOffset();
 					updateCaretPosition();										
 				}
 			}
@@ -1117,8 +1079,7 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		return;
 	}	
 	
-	String ctext = currentLine->getText();
-	
+	bool edited = false;
 	
 //	if(1) {
 	if((charCode > 31 && charCode < 127) || charCode > 127) {	
@@ -1126,11 +1087,10 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 			saveUndoState();
 			if(hasSelection)
 				deleteSelection();
-			ctext = currentLine->getText();		
-			String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-			ctext = ctext.substr(0,caretPosition);
-			ctext += charCode + text2;
-			caretPosition++;
+			String charString = String(charCode);
+			insertTextAt(lineOffset, caretPosition, charString);
+			caretPosition += charString.length();
+			edited = true;
 		}
 	}
 	
@@ -1138,11 +1098,9 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		saveUndoState();
 		if(hasSelection)
 			deleteSelection();		
-		ctext = currentLine->getText();				
-		String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-		ctext = ctext.substr(0,caretPosition);
-		ctext += (wchar_t)'\t' + text2;
+		insertTextAt(lineOffset, caretPosition, "\t");
 		caretPosition++;		
+		edited = true;
 	}
 	
 	if(key == KEY_BACKSPACE) {
@@ -1151,33 +1109,25 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 			deleteSelection();
 			return;
 		} else {
-		ctext = currentLine->getText();					
 		if(caretPosition > 0) {
 			saveUndoState();
-			if(ctext.length() > 0) {
-				String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-				ctext = ctext.substr(0,caretPosition-1);
-				ctext += text2;
-				caretPosition--;
-			}
+			removeTextRange(lineOffset, caretPosition-1, lineOffset, caretPosition);
+			caretPosition--;
+			edited = true;
 		} else {
 			if(lineOffset > 0) {
 				saveUndoState();			
-				ScreenLabel *lineToRemove = currentLine;
+				caretPosition = buffer.getLineLength(lineOffset-1);
+				removeTextRange(lineOffset-1, caretPosition, lineOffset, 0);
 				lineOffset--;
-				selectLineFromOffset();
-				caretPosition = currentLine->getText().length();
-				updateCaretPosition();
-				currentLine->setText(currentLine->getText() + ctext);	
-				removeLine(lineToRemove);				
-				return;
+				edited = true;
 			}
 		}
 		}
 	}
 	
-	currentLine->setText(ctext);	
-	changedText();
+	if(edited)
+		changedText();
 	updateCaretPosition();
 }
 
@@ -1188,21 +1138,23 @@ void UITextInput::Update() {
 		scissorBox.setRect(pos.x,pos.y, width, height);		
 	}
 
+	int firstLine = getFirstVisibleLine();
+	if(linesDirty || firstLine != lastFirstVisibleLine) {
+		renderLines();
+		linesDirty = false;
+		lastFirstVisibleLine = firstLine;
+	}
+
 	if(hasSelection) {
 		blinkerRect->visible = false;
 	}
-	blinkerRect->setPosition(caretImagePosition,currentLine->getPosition2D().y - 2);
+	blinkerRect->setPosition(caretImagePosition, padding + (lineOffset * (lineHeight+lineSpacing)) - 2);
 	if(hasFocus) {
 //		inputRect->setStrokeColor(1.0f, 1.0f, 1.0f, 0.25f);	
 	} else {
 		blinkerRect->visible = false;		
 //		inputRect->setStrokeColor(1.0f, 1.0f, 1.0f, 0.1f);
 	}
-	
-	for(int i=0; i < linesToDelete.size(); i++) {
-		delete linesToDelete[i];
-	}
-	linesToDelete.clear();
 }
 
 UITextInput::~UITextInput() {
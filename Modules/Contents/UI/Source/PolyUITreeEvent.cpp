@@ -27,11 +27,19 @@ using namespace Polycode;
 
 UITreeEvent::UITreeEvent(UITree *selection) {
 	this->selection = selection;
+	node = NULL;
 	eventType = "UITreeEvent";
 }
 
-UITreeEvent::UITreeEvent() {
+UITreeEvent::UITreeEvent(UIVirtualTreeNode *node) {
+	this->node = node;
+	selection = NULL;
+	eventType = "UITreeEvent";
+}
 
+UITreeEvent::UITreeEvent() {
+	selection = NULL;
+	node = NULL;
 }
 
 UITreeEvent::~UITreeEvent() {
@@ -0,0 +1,239 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+
+#include "PolyUIVirtualTree.h"
+#include "PolyUIVirtualTreeContainer.h"
+#include "PolyConfig.h"
+#include "PolyLabel.h"
+#include "PolyCoreServices.h"
+#include "PolyMaterialManager.h"
+#include "PolyTexture.h"
+
+using namespace Polycode;
+
+UIVirtualTreeNode::UIVirtualTreeNode(UIVirtualTreeContainer *container, UIVirtualTreeNode *parent, const String &icon, const String &text, void *userData) : EventDispatcher() {
+	this->container = container;
+	this->parent = parent;
+	this->userData = userData;
+	labelText = text;
+	iconFile = icon;
+	collapsed = true;
+	visibleIndex = -1;
+	depth = parent ? parent->getDepth() + 1 : 0;
+}
+
+UIVirtualTreeNode::~UIVirtualTreeNode() {
+	for(int i=0; i < treeChildren.size(); i++) {
+		delete treeChildren[i];
+	}
+}
+
+UIVirtualTreeNode *UIVirtualTreeNode::addTreeChild(String icon, String text, void *userData) {
+	return insertTreeChild(treeChildren.size(), icon, text, userData);
+}
+
+UIVirtualTreeNode *UIVirtualTreeNode::insertTreeChild(int index, String icon, String text, void *userData) {
+	UIVirtualTreeNode *newNode = new UIVirtualTreeNode(container, this, icon, text, userData);
+	treeChildren.insert(treeChildren.begin()+index, newNode);
+	if(collapsed)
+		container->setNeedsRebind();
+	else
+		container->setNeedsRefresh();
+	return newNode;
+}
+
+void UIVirtualTreeNode::removeTreeChild(UIVirtualTreeNode *child) {
+	for(int i=0; i < treeChildren.size(); i++) {
+		if(treeChildren[i] == child) {
+			container->nodeRemoved(child);
+			treeChildren.erase(treeChildren.begin()+i);
+			delete child;
+			container->setNeedsRefresh();
+			return;
+		}
+	}
+}
+
+void UIVirtualTreeNode::clearTree() {
+	for(int i=0; i < treeChildren.size(); i++) {
+		container->nodeRemoved(treeChildren[i]);
+		delete treeChildren[i];
+	}
+	treeChildren.clear();
+	container->setNeedsRefresh();
+}
+
+UIVirtualTreeNode *UIVirtualTreeNode::getParent() {
+	return parent;
+}
+
+void UIVirtualTreeNode::toggleCollapsed() {
+	setCollapsed(!collapsed);
+}
+
+void UIVirtualTreeNode::setCollapsed(bool val) {
+	if(collapsed == val)
+		return;
+	collapsed = val;
+	container->setNeedsRefresh();
+}
+
+bool UIVirtualTreeNode::isCollapsed() {
+	return collapsed;
+}
+
+void UIVirtualTreeNode::setSelected() {
+	container->setSelectedNode(this);
+}
+
+UIVirtualTreeNode *UIVirtualTreeNode::getSelectedNode() {
+	return container->getSelectedNode();
+}
+
+void *UIVirtualTreeNode::getUserData() {
+	return userData;
+}
+
+void UIVirtualTreeNode::setUserData(void *data) {
+	userData = data;
+}
+
+void UIVirtualTreeNode::setLabelText(const String &text) {
+	labelText = text;
+	container->setNeedsRebind();
+}
+
+String UIVirtualTreeNode::getLabelText() {
+	return labelText;
+}
+
+void UIVirtualTreeNode::setIcon(String iconFile) {
+	this->iconFile = iconFile;
+	container->setNeedsRebind();
+}
+
+String UIVirtualTreeNode::getIcon() {
+	return iconFile;
+}
+
+int UIVirtualTreeNode::getDepth() {
+	return depth;
+}
+
+UIVirtualTreeRow::UIVirtualTreeRow(Number rowWidth) : ScreenEntity() {
+	processInputEvents = true;
+	node = NULL;
+	this->rowWidth = rowWidth;
+	
+	Config *conf = CoreServices::getInstance()->getConfig();
+	
+	cellPadding = conf->getNumericValue("Polycode", "uiTreeCellPadding");
+	cellHeight = conf->getNumericValue("Polycode", "uiTreeCellHeight");
+	
+	bgBox = new ScreenShape(ScreenShape::SHAPE_RECT, rowWidth, cellHeight);
+	bgBox->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	bgBox->setColor(1, 1, 1, 0);
+	bgBox->processInputEvents = true;
+	addChild(bgBox);
+	
+	Number st = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinT");
+	Number sr = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinR");
+	Number sb = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinB");
+	Number sl = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinL");
+	
+	padding = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinPadding");
+	
+	selection = new UIBox(conf->getStringValue("Polycode", "uiTreeCellSelectorSkin"),
+						  st,sr,sb,sl,
+						  rowWidth+(padding*2), cellHeight+(padding*2));
+	selection->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	selection->setPosition(-padding,-padding);
+	selection->visible = false;
+	addChild(selection);
+	
+	arrowIconImage = new ScreenImage(conf->getStringValue("Polycode", "uiTreeArrowIconImage"));
+	arrowIconImage->processInputEvents = true;
+	addChild(arrowIconImage);
+	
+	iconImage = new ScreenShape(ScreenShape::SHAPE_RECT, 1, 1);
+	iconImage->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	addChild(iconImage);
+	
+	textLabel = new ScreenLabel("", conf->getNumericValue("Polycode", "uiDefaultFontSize"), conf->getStringValue("Polycode", "uiDefaultFontName"), Label::ANTIALIAS_FULL);
+	addChild(textLabel);
+	
+	width = rowWidth;
+	height = cellHeight;
+	setHitbox(width, height);
+	setPositionMode(ScreenEntity::POSITION_CENTER);
+	
+	ownsChildren = true;
+	unbindNode();
+}
+
+UIVirtualTreeRow::~UIVirtualTreeRow() {
+	
+}
+
+void UIVirtualTreeRow::bindNode(UIVirtualTreeNode *node, bool selected) {
+	this->node = node;
+	visible = true;
+	enabled = true;
+	
+	if(labelText != node->getLabelText()) {
+		labelText = node->getLabelText();
+		textLabel->setText(labelText);
+	}
+	
+	if(iconFile != node->getIcon()) {
+		iconFile = node->getIcon();
+		Texture *texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(iconFile);
+		iconImage->setTexture(texture);
+		if(texture)
+			iconImage->setShapeSize(texture->getWidth(), texture->getHeight());
+	}
+	
+	Number indent = node->getDepth() * INDENT_SIZE;
+	
+	arrowIconImage->visible = node->getNumTreeChildren() > 0;
+	arrowIconImage->setRotation(node->isCollapsed() ? 0 : 90);
+	arrowIconImage->setPosition(indent+cellPadding, (cellHeight-arrowIconImage->getHeight())/2.0f);
+	iconImage->setPosition(indent+arrowIconImage->getWidth()+(cellPadding*2), (cellHeight-iconImage->getHeight())/2.0f);
+	textLabel->setPosition(indent+arrowIconImage->getWidth()+iconImage->getWidth()+(cellPadding*3), (int)((cellHeight-(textLabel->getLabel()->getSize()))/2.0f) - 2);
+	
+	selection->visible = selected;
+}
+
+void UIVirtualTreeRow::unbindNode() {
+	node = NULL;
+	visible = false;
+	enabled = false;
+}
+
+void UIVirtualTreeRow::Resize(Number width) {
+	rowWidth = width;
+	selection->resizeBox(rowWidth+(padding*2), cellHeight+(padding*2));
+	bgBox->setShapeSize(rowWidth, cellHeight);
+	this->width = rowWidth;
+	setHitbox(rowWidth, cellHeight);
+}
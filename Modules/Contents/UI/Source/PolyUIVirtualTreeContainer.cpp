@@ -0,0 +1,264 @@
+/*
+ Copyright (C) 2012 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include "PolyUIVirtualTreeContainer.h"
+#include "PolyConfig.h"
+#include "PolyInputEvent.h"
+#include "PolyCoreServices.h"
+#include <math.h>
+
+using namespace Polycode;
+
+UIVirtualTreeContainer::UIVirtualTreeContainer(String icon, String text, Number treeWidth, Number treeHeight) : UIElement() {
+	
+	Config *conf = CoreServices::getInstance()->getConfig();
+	
+	Number st = conf->getNumericValue("Polycode", "uiTreeContainerSkinT");
+	Number sr = conf->getNumericValue("Polycode", "uiTreeContainerSkinR");
+	Number sb = conf->getNumericValue("Polycode", "uiTreeContainerSkinB");
+	Number sl = conf->getNumericValue("Polycode", "uiTreeContainerSkinL");	
+	
+	cellHeight = conf->getNumericValue("Polycode", "uiTreeCellHeight");
+	
+	bgBox = new UIBox(conf->getStringValue("Polycode", "uiTreeContainerSkin"),
+						  st,sr,sb,sl,
+						  treeWidth, treeHeight);
+	
+	addChild(bgBox);
+	bgBox->blockMouseInput = true;
+	blockMouseInput = true;
+	
+	scrollChild = new ScreenEntity();
+	scrollChild->processInputEvents = true;
+	
+	rootNode = new UIVirtualTreeNode(this, NULL, icon, text, NULL);
+	selectedNode = NULL;
+	firstRow = 0;
+	needsRefresh = true;
+	needsRebind = true;
+	this->treeWidth = treeWidth;
+	this->treeHeight = treeHeight;
+	
+	mainContainer = new UIScrollContainer(scrollChild, false, true, treeWidth-conf->getNumericValue("Polycode", "uiScrollDefaultSize"), treeHeight);
+	addChild(mainContainer);
+	
+	width = treeWidth;
+	height = treeHeight;
+	setHitbox(width, height);
+	
+	Resize(width, height);
+}
+
+UIVirtualTreeContainer::~UIVirtualTreeContainer() {
+	delete rootNode;
+}
+
+void UIVirtualTreeContainer::Resize(Number width, Number height) {
+	mainContainer->Resize(width,height);
+	bgBox->resizeBox(width, height);
+	mainContainer->setPositionY(0);
+	
+	treeWidth = width;
+	treeHeight = height;
+	for(int i=0; i < rows.size(); i++) {
+		rows[i]->Resize(width);
+	}
+	resizeRowPool();
+	refreshTree();
+	setHitbox(width, height);
+}
+
+void UIVirtualTreeContainer::resizeRowPool() {
+	// one extra row for the partially visible rows at the top and bottom
+	int numRows = (int)ceil(treeHeight / cellHeight) + 1;
+	
+	while(rows.size() < numRows) {
+		UIVirtualTreeRow *row = new UIVirtualTreeRow(treeWidth);
+		row->bgBox->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
+		row->bgBox->addEventListener(this, InputEvent::EVENT_DOUBLECLICK);
+		row->arrowIconImage->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
+		scrollChild->addChild(row);
+		rows.push_back(row);
+	}
+	
+	while(rows.size() > numRows) {
+		UIVirtualTreeRow *row = rows[rows.size()-1];
+		scrollChild->removeChild(row);
+		delete row;
+		rows.pop_back();
+	}
+	needsRebind = true;
+}
+
+void UIVirtualTreeContainer::addVisibleNodes(UIVirtualTreeNode *node) {
+	node->visibleIndex = visibleNodes.size();
+	visibleNodes.push_back(node);
+	if(!node->isCollapsed()) {
+		for(int i=0; i < node->getNumTreeChildren(); i++) {
+			addVisibleNodes(node->getTreeChild(i));
+		}
+	}
+}
+
+void UIVirtualTreeContainer::refreshTree() {
+	for(int i=0; i < visibleNodes.size(); i++) {
+		visibleNodes[i]->visibleIndex = -1;
+	}
+	visibleNodes.clear();
+	addVisibleNodes(rootNode);
+	
+	mainContainer->setContentSize(treeWidth, visibleNodes.size() * cellHeight);
+	needsRefresh = false;
+	bindRows();
+	dispatchEvent(new UITreeEvent(), UITreeEvent::NEED_REFRESH_EVENT);
+}
+
+void UIVirtualTreeContainer::bindRows() {
+	firstRow = (int)(-scrollChild->getPosition().y / cellHeight);
+	if(firstRow < 0)
+		firstRow = 0;
+	int lastRow = firstRow + rows.size();
+	if(lastRow > visibleNodes.size())
+		lastRow = visibleNodes.size();
+	
+	// rows that already show a node in the new range keep it, so scrolling by a row only rebinds one row
+	vector<bool> rowBound(rows.size(), false);
+	vector<bool> indexBound(rows.size(), false);
+	for(int i=0; i < rows.size(); i++) {
+		UIVirtualTreeNode *node = rows[i]->node;
+		if(!node)
+			continue;
+		int index = node->visibleIndex;
+		if(index >= firstRow && index < lastRow && visibleNodes[index] == node) {
+			rows[i]->bindNode(node, node == selectedNode);
+			rows[i]->setPosition(0, index * cellHeight);
+			rowBound[i] = true;
+			indexBound[index - firstRow] = true;
+		}
+	}
+	
+	int freeRow = 0;
+	for(int index = firstRow; index < lastRow; index++) {
+		if(indexBound[index - firstRow])
+			continue;
+		while(rowBound[freeRow])
+			freeRow++;
+		rows[freeRow]->bindNode(visibleNodes[index], visibleNodes[index] == selectedNode);
+		rows[freeRow]->setPosition(0, index * cellHeight);
+		rowBound[freeRow] = true;
+	}
+	
+	for(int i=0; i < rows.size(); i++) {
+		if(!rowBound[i])
+			rows[i]->unbindNode();
+	}
+	needsRebind = false;
+}
+
+void UIVirtualTreeContainer::Update() {
+	if(needsRefresh) {
+		refreshTree();
+	} else if(needsRebind || (int)(-scrollChild->getPosition().y / cellHeight) != firstRow) {
+		bindRows();
+	}
+}
+
+void UIVirtualTreeContainer::setNeedsRefresh() {
+	needsRefresh = true;
+}
+
+void UIVirtualTreeContainer::setNeedsRebind() {
+	needsRebind = true;
+}
+
+void UIVirtualTreeContainer::nodeRemoved(UIVirtualTreeNode *node) {
+	for(UIVirtualTreeNode *n = selectedNode; n; n = n->getParent()) {
+		if(n == node) {
+			selectedNode = NULL;
+			break;
+		}
+	}
+	
+	for(int i=0; i < rows.size(); i++) {
+		for(UIVirtualTreeNode *n = rows[i]->node; n; n = n->getParent()) {
+			if(n == node) {
+				rows[i]->unbindNode();
+				break;
+			}
+		}
+	}
+	
+	for(int i=0; i < visibleNodes.size(); i++) {
+		visibleNodes[i]->visibleIndex = -1;
+	}
+	visibleNodes.clear();
+	needsRefresh = true;
+}
+
+void UIVirtualTreeContainer::handleEvent(Event *event) {
+	for(int i=0; i < rows.size(); i++) {
+		UIVirtualTreeNode *node = rows[i]->node;
+		if(!node)
+			continue;
+		
+		if(event->getDispatcher() == rows[i]->arrowIconImage) {
+			node->toggleCollapsed();
+			return;
+		}
+		
+		if(event->getDispatcher() == rows[i]->bgBox) {
+			switch(event->getEventCode()) {
+				case InputEvent::EVENT_MOUSEDOWN:
+					setSelectedNode(node);
+				break;
+				case InputEvent::EVENT_DOUBLECLICK:
+					rootNode->dispatchEvent(new UITreeEvent(node), UITreeEvent::EXECUTED_EVENT);
+				break;
+			}
+			return;
+		}
+	}
+}
+
+UIVirtualTreeNode *UIVirtualTreeContainer::getRootNode() {
+	return rootNode;
+}
+
+UIVirtualTreeNode *UIVirtualTreeContainer::getSelectedNode() {
+	return selectedNode;
+}
+
+void UIVirtualTreeContainer::setSelectedNode(UIVirtualTreeNode *node) {
+	selectedNode = node;
+	needsRebind = true;
+	rootNode->dispatchEvent(new UITreeEvent(node), UITreeEvent::SELECTED_EVENT);
+}
+
+int UIVirtualTreeContainer::getNumVisibleNodes() {
+	if(needsRefresh)
+		refreshTree();
+	return visibleNodes.size();
+}
+
+int UIVirtualTreeContainer::getNumRows() {
+	return rows.size();
+}
@@ -24,6 +24,8 @@ THE SOFTWARE.
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <set>
 
 #include "Polycode.h"
 #include "PolycodeLUA.h"
@@ -97,7 +99,7 @@ public:
 	static const int EVENT_CLOSE = 4;
 };
 
-class PolycodePlayer : public EventDispatcher {
+class PolycodePlayer : public EventDispatcher, public CoreIdleHandler {
 	
 public:
 	
@@ -114,6 +116,22 @@ public:
 	void handleEvent(Event *event);
 	bool Update();
 	
+	/**
+	* Runs the Lua garbage collector in the idle time at the end of the frame, if scriptGCBudget is set.
+	*/
+	void handleIdle(unsigned int idleTime);
+	
+	/**
+	* Called by the script profiler's debug hook every scriptProfileInterval Lua instructions.
+	*/
+	void sampleScript(lua_State *L, lua_Debug *ar);
+	
+	/**
+	* Logs the Lua functions that took the most sampled time so far.
+	* @param count Maximum number of functions to log.
+	*/
+	void logScriptProfile(unsigned int count);
+	
 	virtual void createCore() = 0;
 	
 	Core *getCore() { return core; }	
@@ -135,9 +153,51 @@ public:
 	bool useDebugger;	
 	
 	bool crashed;
+	
+	/**
+	* Time in milliseconds the Lua garbage collector may use per frame. The collector only runs in the idle time left at the end of a frame, so collection no longer causes hitches in the middle of one. Defaults to 0, which leaves collection to Lua's own incremental collector. Read from the scriptGCBudget project setting.
+	*/
+	Number scriptGCBudget;
+	
+	/**
+	* If true, Lua callbacks are profiled and a sampling profiler records which Lua functions they spend their time in. The samples are written to scriptProfileFile as a Chrome trace, along with the engine's own zones, when the player exits. Read from the profileScripts project setting.
+	*/
+	bool profileScripts;
+	
+	/**
+	* Number of Lua instructions between two script profiler samples.
+	*/
+	int scriptProfileInterval;
+	
+	String scriptProfileFile;
+	
+	static const int SCRIPT_UPDATE = 0;
+	static const int SCRIPT_ON_KEY_DOWN = 1;
+	static const int SCRIPT_ON_KEY_UP = 2;
+	static const int SCRIPT_ON_MOUSE_DOWN = 3;
+	static const int SCRIPT_ON_MOUSE_UP = 4;
+	static const int SCRIPT_ON_MOUSE_MOVE = 5;
+	static const int NUM_SCRIPT_CALLBACKS = 6;
 		
 protected:
 
+	/**
+	* Pushes a script callback, ready for its arguments to be pushed and callScriptCallback() to be called. The callback is looked up in the script's globals on every call, so scripts can replace it at any time. Returns false, pushing nothing, if the script doesn't define the callback or has crashed.
+	*/
+	bool pushScriptCallback(int callback);
+	void callScriptCallback(int callback, int numArgs);
+	
+	void finishScriptSample();
+	
+	unsigned int scriptGCCycleMemory;
+	
+	bool samplingScript;
+	std::set<std::string> sampledFunctionNames;
+	std::map<const char*, unsigned long long> sampledFunctionTimes;
+	const char *lastSampleName;
+	unsigned long long lastSampleTime;
+	unsigned int lastSampleEvent;
+
 	int errH;
 
 	Timer *debuggerTimer;
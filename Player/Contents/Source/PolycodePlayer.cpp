@@ -22,6 +22,7 @@ THE SOFTWARE.
 
 #include "PolycodePlayer.h"
 #include <string>
+#include <algorithm>
 
 PolycodeRemoteDebuggerClient::PolycodeRemoteDebuggerClient() : EventDispatcher() {
 	client = new Client(6445, 1);
@@ -232,6 +233,11 @@ static void dumpstack (lua_State *L) {
 		return 0;
 	}
 	
+	static void scriptProfilerHook(lua_State *L, lua_Debug *ar) {
+		PolycodePlayer *player = (PolycodePlayer*)CoreServices::getInstance()->getCore()->getUserPointer();
+		player->sampleScript(L, ar);
+	}
+	
 	static int debugPrint(lua_State *L)
 	{
 		const char *msg = lua_tostring(L, 1);
@@ -437,7 +443,121 @@ static void dumpstack (lua_State *L) {
 				Logger::log("CRASH EXECUTING FILE\n");
 			}
 		}
+		
+		if(scriptGCBudget > 0) {
+			lua_gc(L, LUA_GCSTOP, 0);
+			scriptGCCycleMemory = lua_gc(L, LUA_GCCOUNT, 0);
+		}
+		
+		if(profileScripts) {
+			Profiler::setEnabled(true);
+			lua_sethook(L, scriptProfilerHook, LUA_MASKCOUNT, scriptProfileInterval);
+		}
+	}
+}
+
+static const char *scriptCallbackNames[PolycodePlayer::NUM_SCRIPT_CALLBACKS] = {"Update", "onKeyDown", "onKeyUp", "onMouseDown", "onMouseUp", "onMouseMove"};
+
+bool PolycodePlayer::pushScriptCallback(int callback) {
+	if(!L || crashed)
+		return false;
+	// looked up on every call, since scripts can reassign their callbacks at any time
+	lua_getfield(L, LUA_GLOBALSINDEX, scriptCallbackNames[callback]);
+	if(!lua_isfunction(L, -1)) {
+		lua_pop(L, 1);
+		return false;
+	}
+	return true;
+}
+
+void PolycodePlayer::callScriptCallback(int callback, int numArgs) {
+	POLY_PROFILE_ZONE(scriptCallbackNames[callback]);
+	if(profileScripts) {
+		samplingScript = true;
+		lastSampleName = NULL;
+		lastSampleTime = Profiler::getTime();
+	}
+	
+	lua_pcall(L, numArgs, 0, errH);
+	
+	if(profileScripts) {
+		finishScriptSample();
+		samplingScript = false;
+	}
+}
+
+void PolycodePlayer::sampleScript(lua_State *L, lua_Debug *ar) {
+	if(!samplingScript)
+		return;
+	
+	unsigned long long now = Profiler::getTime();
+	lua_getinfo(L, "Sn", ar);
+	String functionName = String(ar->name ? ar->name : "?") + " (" + String(ar->short_src) + ":" + String::IntToString(ar->linedefined) + ")";
+	const char *name = sampledFunctionNames.insert(std::string(functionName.c_str())).first->c_str();
+	
+	// consecutive samples in the same function are merged into one zone, so
+	// the trace doesn't fill the profiler's ring buffer with tiny events
+	if(name == lastSampleName) {
+		Profiler::extendZone(lastSampleEvent, now);
+	} else {
+		lastSampleEvent = Profiler::addZone(name, lastSampleTime, now);
+		lastSampleName = name;
 	}
+	sampledFunctionTimes[name] += now - lastSampleTime;
+	lastSampleTime = now;
+}
+
+void PolycodePlayer::finishScriptSample() {
+	if(!lastSampleName)
+		return;
+	unsigned long long now = Profiler::getTime();
+	Profiler::extendZone(lastSampleEvent, now);
+	sampledFunctionTimes[lastSampleName] += now - lastSampleTime;
+	lastSampleName = NULL;
+}
+
+static bool compareSampledTimes(const std::pair<const char*, unsigned long long> &a, const std::pair<const char*, unsigned long long> &b) {
+	return a.second > b.second;
+}
+
+void PolycodePlayer::logScriptProfile(unsigned int count) {
+	std::vector<std::pair<const char*, unsigned long long> > times(sampledFunctionTimes.begin(), sampledFunctionTimes.end());
+	std::sort(times.begin(), times.end(), compareSampledTimes);
+	
+	unsigned long long totalTime = 0;
+	for(int i=0; i < times.size(); i++) {
+		totalTime += times[i].second;
+	}
+	
+	Logger::log("Hottest Lua functions:\n");
+	for(int i=0; i < times.size() && i < count; i++) {
+		Logger::log("%8.2fms %5.1f%% %s\n", times[i].second / 1000.0, totalTime ? (times[i].second * 100.0) / totalTime : 0.0, times[i].first);
+	}
+}
+
+void PolycodePlayer::handleIdle(unsigned int idleTime) {
+	if(!L || scriptGCBudget <= 0)
+		return;
+	
+	POLY_PROFILE_ZONE("Lua GC");
+	Number budget = idleTime < scriptGCBudget ? idleTime : scriptGCBudget;
+	unsigned long long endTime = Profiler::getTime() + (unsigned long long)(budget * 1000.0);
+	
+	// If frames keep running over there is no idle time, so the collector
+	// could fall behind forever. Once the heap has doubled since the last
+	// cycle, finish the cycle regardless of the budget.
+	bool overdue = lua_gc(L, LUA_GCCOUNT, 0) > scriptGCCycleMemory * 2;
+	
+	// always take at least one step, so the collector makes progress every frame
+	do {
+		if(lua_gc(L, LUA_GCSTEP, 0)) {
+			scriptGCCycleMemory = lua_gc(L, LUA_GCCOUNT, 0);
+			break;
+		}
+	} while(overdue || Profiler::getTime() < endTime);
+	
+	// stepping restarts the automatic collector
+	lua_gc(L, LUA_GCSTOP, 0);
 }
 
 PolycodeDebugEvent::PolycodeDebugEvent() : Event() {
@@ -464,6 +584,15 @@ PolycodePlayer::PolycodePlayer(String fileName, bool knownArchive, bool useDebug
 	aaLevel = 6;
 	fullScreen = false;	
 	
+	scriptGCBudget = 0;
+	scriptGCCycleMemory = 0;
+	profileScripts = false;
+	scriptProfileInterval = 1000;
+	scriptProfileFile = "script_profile.json";
+	samplingScript = false;
+	lastSampleName = NULL;
+	lastSampleTime = 0;
+	lastSampleEvent = 0;
 }
 
 void PolycodePlayer::loadFile(const char *fileName) {
@@ -533,6 +662,18 @@ void PolycodePlayer::loadFile(const char *fileName) {
 		if(configFile.root["fullScreen"]) {
 			fullScreen = configFile.root["fullScreen"]->boolVal;
 		}		
+		if(configFile.root["scriptGCBudget"]) {
+			scriptGCBudget = configFile.root["scriptGCBudget"]->NumberVal;
+		}		
+		if(configFile.root["profileScripts"]) {
+			profileScripts = configFile.root["profileScripts"]->boolVal;
+		}		
+		if(configFile.root["scriptProfileInterval"]) {
+			scriptProfileInterval = configFile.root["scriptProfileInterval"]->intVal;
+		}		
+		if(configFile.root["scriptProfileFile"]) {
+			scriptProfileFile = configFile.root["scriptProfileFile"]->stringVal;
+		}		
 		if(configFile.root["backgroundColor"]) {
 			ObjectEntry *color = configFile.root["backgroundColor"];
 			if((*color)["red"] && (*color)["green"] && (*color)["blue"]) {
@@ -598,6 +739,7 @@ void PolycodePlayer::loadFile(const char *fileName) {
 	
 	}
 	createCore();
+	core->setIdleHandler(this);
 
 	core->getInput()->addEventListener(this, InputEvent::EVENT_KEYDOWN);
 	core->getInput()->addEventListener(this, InputEvent::EVENT_KEYUP);
@@ -680,6 +822,10 @@ void PolycodePlayer::runPlayer() {
 PolycodePlayer::~PolycodePlayer() {
 	this->removeAllHandlers();
 	delete remoteDebuggerClient;
+	if(profileScripts) {
+		logScriptProfile(20);
+		Profiler::exportChromeTrace(scriptProfileFile);
+	}
 	Logger::log("deleting core...\n");
 	delete core;
 	PolycodeDebugEvent *event = new PolycodeDebugEvent();			
@@ -745,51 +891,46 @@ void PolycodePlayer::handleEvent(Event *event) {
 		switch(event->getEventCode()) {
 			case InputEvent::EVENT_KEYDOWN:
 			{
-				if(L && !crashed) {
-					lua_getfield(L, LUA_GLOBALSINDEX, "onKeyDown");
+				if(pushScriptCallback(SCRIPT_ON_KEY_DOWN)) {
 					lua_pushinteger(L, inputEvent->keyCode());
-					lua_pcall(L, 1,0,errH);					
+					callScriptCallback(SCRIPT_ON_KEY_DOWN, 1);
 				}
 			}
 			break;
 			case InputEvent::EVENT_KEYUP:
 			{
-				if(L && !crashed) {
-					lua_getfield(L, LUA_GLOBALSINDEX, "onKeyUp");
+				if(pushScriptCallback(SCRIPT_ON_KEY_UP)) {
 					lua_pushinteger(L, inputEvent->keyCode());
-					lua_pcall(L, 1,0,errH);					
+					callScriptCallback(SCRIPT_ON_KEY_UP, 1);
 				}
 			}
 			break;
 			case InputEvent::EVENT_MOUSEDOWN:
 			{
-				if(L && !crashed) {
-					lua_getfield(L, LUA_GLOBALSINDEX, "onMouseDown");
+				if(pushScriptCallback(SCRIPT_ON_MOUSE_DOWN)) {
 					lua_pushinteger(L, inputEvent->mouseButton);
 					lua_pushnumber(L, inputEvent->mousePosition.x);
 					lua_pushnumber(L, inputEvent->mousePosition.y);					
-					lua_pcall(L, 3,0,errH);					
+					callScriptCallback(SCRIPT_ON_MOUSE_DOWN, 3);
 				}
 			}
 			break;	
 			case InputEvent::EVENT_MOUSEUP:
 			{
-				if(L && !crashed) {
-					lua_getfield(L, LUA_GLOBALSINDEX, "onMouseUp");
+				if(pushScriptCallback(SCRIPT_ON_MOUSE_UP)) {
 					lua_pushinteger(L, inputEvent->mouseButton);
 					lua_pushnumber(L, inputEvent->mousePosition.x);
 					lua_pushnumber(L, inputEvent->mousePosition.y);					
-					lua_pcall(L, 3,0,errH);					
+					callScriptCallback(SCRIPT_ON_MOUSE_UP, 3);
 				}
 			}
 			break;	
 			case InputEvent::EVENT_MOUSEMOVE:
 			{
-				if(L && !crashed) {
-					lua_getfield(L, LUA_GLOBALSINDEX, "onMouseMove");
+				if(pushScriptCallback(SCRIPT_ON_MOUSE_MOVE)) {
 					lua_pushnumber(L, inputEvent->mousePosition.x);
 					lua_pushnumber(L, inputEvent->mousePosition.y);					
-					lua_pcall(L, 2,0,errH);					
+					callScriptCallback(SCRIPT_ON_MOUSE_MOVE, 2);
 				}
 			}
 			break;																			
@@ -808,10 +949,9 @@ bool PolycodePlayer::Update() {
 			lua_pcall(L, 0,0,errH);		
 		}
 	
-		if(!crashed) {
-			lua_getfield(L, LUA_GLOBALSINDEX, "Update");
+		if(pushScriptCallback(SCRIPT_UPDATE)) {
 			lua_pushnumber(L, core->getElapsed());
-			lua_pcall(L, 1,0,errH);
+			callScriptCallback(SCRIPT_UPDATE, 1);
 		}
 	}
 	return core->Update();
@@ -5,6 +5,8 @@
 #include "PolyString.h"
 #include "PolyObject.h"
 #include "OSBasics.h"
+#include "PolyImage.h"
+#include "PolyCookedTexture.h"
 
 #ifdef _WINDOWS
 #include <time.h>
@@ -18,3 +20,46 @@ public:
 	String name;
 	String value;
 };
+
+/**
+* A file queued for packaging. Entries are prepared by worker threads, which hash them and compress them into the build cache, and then written to the archive in the order they were queued.
+*/
+class PackageEntry {
+public:
+	String filePath;
+	String pathInZip;
+	bool silent;
+
+	/**
+	* File whose modification time the entry is stamped with in the archive. Cooked textures use their source image's, so the engine doesn't take them for older than the image.
+	*/
+	String datePath;
+
+	/**
+	* False for formats that are already compressed, which are stored as they are.
+	*/
+	bool compress;
+
+	unsigned long long fileSize;
+	unsigned long long modifiedTime;
+	unsigned long long contentHash;
+	unsigned long crc;
+
+	/**
+	* True if the entry's compressed data came from the build cache.
+	*/
+	bool reused;
+	bool prepared;
+	volatile long done;
+};
+
+/**
+* What the last build knew about a file. If the size and modification time haven't changed, the file isn't read again.
+*/
+class ManifestEntry {
+public:
+	unsigned long long fileSize;
+	unsigned long long modifiedTime;
+	unsigned long long contentHash;
+	unsigned long crc;
+};
@@ -2,13 +2,17 @@
 #include "polybuild.h"
 #include "string.h"
 #include "zip.h"
+#include "PolyProfiler.h"
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef _WINDOWS
 	#include <windows.h>
 #else
 	#include <dirent.h>
-	#include <sys/types.h>
-	#include <sys/stat.h>
+	#include <pthread.h>
+	#include <unistd.h>
 #endif
 
 #include "physfs.h"
@@ -87,35 +91,110 @@ uLong filetime(
   return ret;
 }
 
-void addFileToZip(zipFile z, String filePath, String pathInZip, bool silent) {
-			if(!silent)
-				printf("Packaging %s as %s\n", filePath.c_str(), pathInZip.c_str());
-
-                	zip_fileinfo zi;
-                	zi.tmz_date.tm_sec = zi.tmz_date.tm_min = zi.tmz_date.tm_hour =
-			zi.tmz_date.tm_mday = zi.tmz_date.tm_mon = zi.tmz_date.tm_year = 0;
-			 zi.dosDate = 0;
-              	 	 zi.internal_fa = 0;
-             		   zi.external_fa = 0;
-             		   filetime(filePath.c_str(),&zi.tmz_date,&zi.dosDate);
-	
-			zipOpenNewFileInZip(z, pathInZip.c_str(), &zi, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 2);
+vector<PackageEntry*> packageEntries;
+std::map<std::string, ManifestEntry> buildManifest;
+volatile long nextPackageEntry = 0;
+
+static const int PACKAGE_CHUNK_SIZE = 1048576;
+
+String getCachePath() {
+	String cachePath = getArg("--cache");
+	if(cachePath == "")
+		cachePath = ".polybuild_cache";
+	return cachePath;
+}
+
+String getTextureCachePath() {
+	String cachePath = getArg("--textureCache");
+	if(cachePath == "")
+		cachePath = getCachePath();
+	return cachePath;
+}
+
+int getCompressionLevel() {
+	String level = getArg("--compressionLevel");
+	if(level == "")
+		return 2;
+	return atoi(level.c_str());
+}
+
+// the same content deflated at another level is a different blob
+String getEntryCachePath(PackageEntry *entry) {
+	char hashString[48];
+	sprintf(hashString, "%016llx-%d.z", entry->contentHash, getCompressionLevel());
+	return getCachePath() + "/entries/" + String(hashString);
+}
+
+// deflating these again costs time and saves nothing, and stored entries can be read straight out of the archive
+bool isCompressedFormat(const String& fileName) {
+	static const char *extensions[] = {"png", "jpg", "jpeg", "ogg", "mp3", "zip", "pak", NULL};
+	size_t dot = fileName.rfind(".");
+	if(dot == std::string::npos)
+		return false;
+	String extension = fileName.substr(dot + 1).toLowerCase();
+	for(int i=0; extensions[i]; i++) {
+		if(extension == extensions[i])
+			return true;
+	}
+	return false;
+}
 
-			FILE *f = fopen(filePath.c_str(), "rb");
-			fseek(f, 0, SEEK_END);
-			long fileSize = ftell(f);
-			fseek(f, 0, SEEK_SET);
-			char *buf = (char*) malloc(fileSize);
-			fread(buf, fileSize, 1, f);
-			zipWriteInFileInZip(z, buf, fileSize);
-			free(buf);
-			fclose(f);
+void addCookedTextureToZip(String filePath, String pathInZip, bool silent);
+
+void addFileToZip(String filePath, String pathInZip, bool silent) {
+	PackageEntry *entry = new PackageEntry();
+	entry->filePath = filePath;
+	entry->pathInZip = pathInZip;
+	entry->silent = silent;
+	entry->datePath = filePath;
+	entry->compress = !isCompressedFormat(pathInZip);
+	entry->fileSize = 0;
+	entry->modifiedTime = 0;
+	entry->contentHash = 0;
+	entry->crc = 0;
+	entry->reused = false;
+	entry->prepared = false;
+	entry->done = 0;
+	packageEntries.push_back(entry);
+
+	if(getArg("--cookTextures") != "false" && pathInZip.length() > 4 && pathInZip.substr(pathInZip.length()-4, 4).toLowerCase() == ".png") {
+		addCookedTextureToZip(filePath, pathInZip, silent);
+	}
+}
 
-			zipCloseFileInZip(z);
+// cooked textures are cached by the hash of their source, so unchanged textures are only cooked once
+void addCookedTextureToZip(String filePath, String pathInZip, bool silent) {
+	bool premultiply = getArg("--premultiplyTextures") == "true";
+
+	unsigned long long sourceHash = CookedTexture::hashFile(filePath);
+	if(sourceHash == 0)
+		return;
+
+	char hashString[32];
+	sprintf(hashString, "%016llx%s.ptex", sourceHash, premultiply ? "_p" : "");
+	String cachePath = getTextureCachePath();
+	String cookedPath = cachePath + "/" + String(hashString);
+
+	CookedTexture cached;
+	if(!cached.loadFromFile(cookedPath) || cached.getSourceHash() != sourceHash) {
+		OSBasics::createFolder(cachePath);
+		Image *image = new Image(filePath);
+		bool cooked = image->isLoaded() && CookedTexture::cookImage(image, cookedPath, sourceHash, premultiply);
+		delete image;
+		if(!cooked) {
+			printf("Unable to cook %s, packaging it uncooked\n", filePath.c_str());
+			return;
+		}
+		if(!silent)
+			printf("Cooked %s\n", filePath.c_str());
+	}
 
+	addFileToZip(cookedPath, CookedTexture::getCookedPath(pathInZip), silent);
+	// the cached file may predate a checkout that touched the image without changing it
+	packageEntries[packageEntries.size()-1]->datePath = filePath;
 }
 
-void addFolderToZip(zipFile z, String folderPath, String parentFolder, bool silent) {
+void addFolderToZip(String folderPath, String parentFolder, bool silent) {
 	std::vector<OSFileEntry> files = OSBasics::parseFolder(folderPath, false);
 	for(int i=0; i < files.size(); i++) {
 		if(files[i].type == OSFileEntry::TYPE_FILE) {
@@ -127,18 +206,307 @@ void addFolderToZip(zipFile z, String folderPath, String parentFolder, bool sile
 				pathInZip = parentFolder + "/" + files[i].name;
 			}
 
-			addFileToZip(z, files[i].fullPath, pathInZip, silent);
+			addFileToZip(files[i].fullPath, pathInZip, silent);
 
 		} else {
 			if(parentFolder == "") {
-				addFolderToZip(z, files[i].fullPath.c_str(), files[i].name, silent);
+				addFolderToZip(files[i].fullPath.c_str(), files[i].name, silent);
 			} else {
-				addFolderToZip(z, files[i].fullPath.c_str(), parentFolder + "/" + files[i].name, silent);
+				addFolderToZip(files[i].fullPath.c_str(), parentFolder + "/" + files[i].name, silent);
 			}
 		}
 	}
 }
 
+void loadBuildManifest() {
+	FILE *f = fopen((getCachePath() + "/manifest.txt").c_str(), "r");
+	if(!f)
+		return;
+
+	char line[4096];
+	while(fgets(line, sizeof(line), f)) {
+		ManifestEntry entry;
+		int pathStart = 0;
+		if(sscanf(line, "%llx %lx %llu %llu %n", &entry.contentHash, &entry.crc, &entry.fileSize, &entry.modifiedTime, &pathStart) < 4 || pathStart == 0)
+			continue;
+		String path = String(line + pathStart).replace("\n", "");
+		buildManifest[path.getSTLString()] = entry;
+	}
+	fclose(f);
+}
+
+void saveBuildManifest() {
+	for(int i=0; i < packageEntries.size(); i++) {
+		PackageEntry *entry = packageEntries[i];
+		if(!entry->prepared)
+			continue;
+		ManifestEntry manifestEntry;
+		manifestEntry.fileSize = entry->fileSize;
+		manifestEntry.modifiedTime = entry->modifiedTime;
+		manifestEntry.contentHash = entry->contentHash;
+		manifestEntry.crc = entry->crc;
+		buildManifest[entry->filePath.getSTLString()] = manifestEntry;
+	}
+
+	FILE *f = fopen((getCachePath() + "/manifest.txt").c_str(), "w");
+	if(!f)
+		return;
+	for(std::map<std::string, ManifestEntry>::iterator it = buildManifest.begin(); it != buildManifest.end(); it++) {
+		fprintf(f, "%016llx %08lx %llu %llu %s\n", it->second.contentHash, it->second.crc, it->second.fileSize, it->second.modifiedTime, it->first.c_str());
+	}
+	fclose(f);
+}
+
+bool fileExists(const String& path) {
+	struct stat s;
+	return stat(path.c_str(), &s) == 0;
+}
+
+// hashes and checksums the file a chunk at a time, so large files are never read whole
+bool hashPackageEntry(PackageEntry *entry, char *buffer) {
+	FILE *f = fopen(entry->filePath.c_str(), "rb");
+	if(!f)
+		return false;
+
+	unsigned long long hash = 14695981039346656037ULL;
+	uLong crc = crc32(0L, Z_NULL, 0);
+	size_t numRead;
+	while((numRead = fread(buffer, 1, PACKAGE_CHUNK_SIZE, f)) > 0) {
+		for(size_t i=0; i < numRead; i++) {
+			hash ^= (unsigned char)buffer[i];
+			hash *= 1099511628211ULL;
+		}
+		crc = crc32(crc, (const Bytef*)buffer, numRead);
+	}
+	fclose(f);
+
+	entry->contentHash = hash;
+	entry->crc = crc;
+	return true;
+}
+
+// deflates the file into the build cache as raw deflate data, ready to be copied into the archive
+bool compressPackageEntry(PackageEntry *entry, char *inBuffer, char *outBuffer, long workerIndex) {
+	String cachedPath = getEntryCachePath(entry);
+	String tempPath = cachedPath + "." + String::IntToString(workerIndex) + ".tmp";
+
+	FILE *in = fopen(entry->filePath.c_str(), "rb");
+	if(!in)
+		return false;
+	FILE *out = fopen(tempPath.c_str(), "wb");
+	if(!out) {
+		fclose(in);
+		return false;
+	}
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	deflateInit2(&stream, getCompressionLevel(), Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	bool ok = true;
+	int flush;
+	do {
+		size_t numRead = fread(inBuffer, 1, PACKAGE_CHUNK_SIZE, in);
+		flush = feof(in) || ferror(in) ? Z_FINISH : Z_NO_FLUSH;
+		stream.next_in = (Bytef*)inBuffer;
+		stream.avail_in = numRead;
+		do {
+			stream.next_out = (Bytef*)outBuffer;
+			stream.avail_out = PACKAGE_CHUNK_SIZE;
+			deflate(&stream, flush);
+			size_t numCompressed = PACKAGE_CHUNK_SIZE - stream.avail_out;
+			if(fwrite(outBuffer, 1, numCompressed, out) != numCompressed)
+				ok = false;
+		} while(stream.avail_out == 0);
+	} while(flush != Z_FINISH);
+
+	deflateEnd(&stream);
+	fclose(in);
+	fclose(out);
+
+	if(ok && rename(tempPath.c_str(), cachedPath.c_str()) != 0) {
+		// another worker compressed a file with the same contents first
+		ok = fileExists(cachedPath);
+	}
+	remove(tempPath.c_str());
+	return ok;
+}
+
+void preparePackageEntry(PackageEntry *entry, char *inBuffer, char *outBuffer, long workerIndex) {
+	struct stat s;
+	if(stat(entry->filePath.c_str(), &s) != 0) {
+		return;
+	}
+	entry->fileSize = s.st_size;
+	entry->modifiedTime = s.st_mtime;
+
+	std::map<std::string, ManifestEntry>::const_iterator it = buildManifest.find(entry->filePath.getSTLString());
+	if(it != buildManifest.end() && it->second.fileSize == entry->fileSize && it->second.modifiedTime == entry->modifiedTime) {
+		entry->contentHash = it->second.contentHash;
+		entry->crc = it->second.crc;
+	} else if(!hashPackageEntry(entry, inBuffer)) {
+		return;
+	}
+
+	if(!entry->compress || fileExists(getEntryCachePath(entry))) {
+		entry->reused = entry->compress;
+		entry->prepared = true;
+		return;
+	}
+	entry->prepared = compressPackageEntry(entry, inBuffer, outBuffer, workerIndex);
+}
+
+#ifdef _WINDOWS
+DWORD WINAPI packageWorker(LPVOID data) {
+#else
+void *packageWorker(void *data) {
+#endif
+	long workerIndex = (long)data;
+	char *inBuffer = (char*)malloc(PACKAGE_CHUNK_SIZE);
+	char *outBuffer = (char*)malloc(PACKAGE_CHUNK_SIZE);
+	while(true) {
+#ifdef _WINDOWS
+		long index = InterlockedIncrement(&nextPackageEntry) - 1;
+#else
+		long index = __sync_fetch_and_add(&nextPackageEntry, 1);
+#endif
+		if(index >= packageEntries.size())
+			break;
+		preparePackageEntry(packageEntries[index], inBuffer, outBuffer, workerIndex);
+#ifdef _WINDOWS
+		InterlockedExchange(&packageEntries[index]->done, 1);
+#else
+		__sync_lock_test_and_set(&packageEntries[index]->done, 1);
+#endif
+	}
+	free(inBuffer);
+	free(outBuffer);
+	return 0;
+}
+
+int getNumPackageWorkers() {
+	int numWorkers = atoi(getArg("--jobs").c_str());
+	if(numWorkers > 0)
+		return numWorkers;
+#ifdef _WINDOWS
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	numWorkers = systemInfo.dwNumberOfProcessors;
+#else
+	numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return numWorkers > 0 ? numWorkers : 1;
+}
+
+bool writePackageEntry(zipFile z, PackageEntry *entry, char *buffer) {
+	if(!entry->silent)
+		printf("Packaging %s as %s%s\n", entry->filePath.c_str(), entry->pathInZip.c_str(), entry->reused ? " (cached)" : "");
+
+	String sourcePath = entry->compress ? getEntryCachePath(entry) : entry->filePath;
+	FILE *f = fopen(sourcePath.c_str(), "rb");
+	if(!f)
+		return false;
+
+	zip_fileinfo zi;
+	zi.tmz_date.tm_sec = zi.tmz_date.tm_min = zi.tmz_date.tm_hour =
+	zi.tmz_date.tm_mday = zi.tmz_date.tm_mon = zi.tmz_date.tm_year = 0;
+	zi.dosDate = 0;
+	zi.internal_fa = 0;
+	zi.external_fa = 0;
+	filetime(entry->datePath.c_str(),&zi.tmz_date,&zi.dosDate);
+
+	int method = entry->compress ? Z_DEFLATED : 0;
+	int level = entry->compress ? getCompressionLevel() : 0;
+	zipOpenNewFileInZip2_64(z, entry->pathInZip.c_str(), &zi, NULL, 0, NULL, 0, NULL, method, level, 1, entry->fileSize >= 0xffffffff);
+
+	size_t numRead;
+	while((numRead = fread(buffer, 1, PACKAGE_CHUNK_SIZE, f)) > 0) {
+		zipWriteInFileInZip(z, buffer, numRead);
+	}
+	fclose(f);
+
+	zipCloseFileInZipRaw64(z, entry->fileSize, entry->crc);
+	return true;
+}
+
+// compresses the queued files on all cores and writes them in order as they become ready
+void writePackage(zipFile z) {
+	unsigned long long startTime = Profiler::getTime();
+
+	OSBasics::createFolder(getCachePath());
+	OSBasics::createFolder(getCachePath() + "/entries");
+	loadBuildManifest();
+
+	int numWorkers = getNumPackageWorkers();
+	nextPackageEntry = 0;
+#ifdef _WINDOWS
+	vector<HANDLE> workers;
+	for(long i=0; i < numWorkers; i++) {
+		DWORD threadID;
+		HANDLE thread = CreateThread(NULL, 0, packageWorker, (LPVOID)i, 0, &threadID);
+		if(thread)
+			workers.push_back(thread);
+	}
+#else
+	vector<pthread_t> workers;
+	for(long i=0; i < numWorkers; i++) {
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, packageWorker, (void*)i) == 0)
+			workers.push_back(thread);
+	}
+#endif
+	if(workers.size() == 0) {
+		packageWorker(0);
+	}
+
+	char *buffer = (char*)malloc(PACKAGE_CHUNK_SIZE);
+	int numCompressed = 0;
+	int numReused = 0;
+	int numStored = 0;
+	unsigned long long totalSize = 0;
+	for(int i=0; i < packageEntries.size(); i++) {
+		PackageEntry *entry = packageEntries[i];
+		while(!entry->done) {
+#ifdef _WINDOWS
+			Sleep(1);
+#else
+			usleep(1000);
+#endif
+		}
+		if(!entry->prepared || !writePackageEntry(z, entry, buffer)) {
+			printf("Unable to package %s\n", entry->filePath.c_str());
+			continue;
+		}
+		totalSize += entry->fileSize;
+		if(!entry->compress)
+			numStored++;
+		else if(entry->reused)
+			numReused++;
+		else
+			numCompressed++;
+	}
+	free(buffer);
+
+	for(int i=0; i < workers.size(); i++) {
+#ifdef _WINDOWS
+		WaitForSingleObject(workers[i], INFINITE);
+		CloseHandle(workers[i]);
+#else
+		pthread_join(workers[i], NULL);
+#endif
+	}
+
+	saveBuildManifest();
+
+	Number buildTime = (Number)(Profiler::getTime() - startTime) / 1000000.0;
+	printf("Packaged %d files (%.1f MB) in %.2f seconds using %d threads: %d compressed, %d from the build cache, %d stored uncompressed\n", (int)packageEntries.size(), totalSize / 1048576.0, buildTime, numWorkers, numCompressed, numReused, numStored);
+
+	for(int i=0; i < packageEntries.size(); i++) {
+		delete packageEntries[i];
+	}
+	packageEntries.clear();
+}
+
 #ifdef _WINDOWS
 void wtoc(char* Dest, TCHAR* Source, int SourceSize)
 {
@@ -211,6 +579,10 @@ int main(int argc, char **argv) {
 		return 1;		
 	}
 
+	if(getArg("--cookTextures") != "false") {
+		printf("Cooking textures into %s. Use --cookTextures=false to package PNG files only.\n", getTextureCachePath().c_str());
+	}
+
 	char dirPath[4099];
 #if defined(__APPLE__) && defined(__MACH__)
 	getcwd(dirPath, sizeof(dirPath));
@@ -319,8 +691,6 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	zipFile z = zipOpen(getArg("--out").c_str(), 0);
-	
 
 	Object runInfo;
 	runInfo.root.name = "PolycodeApp";
@@ -336,7 +706,7 @@ int main(int argc, char **argv) {
 	color->addChild("green", backgroundColorG);
 	color->addChild("blue", backgroundColorB);
 
-	addFileToZip(z, entryPoint, entryPoint, false);
+	addFileToZip(entryPoint, entryPoint, false);
 
 	if(configFile.root["modules"]) {
 #ifdef _WINDOWS
@@ -365,8 +735,8 @@ int main(int argc, char **argv) {
 				printf("Path:%s\n", moduleAPIPath.c_str());		
 
 
-				addFolderToZip(z, moduleAPIPath, "", false);
-				addFolderToZip(z, moduleLibPath, "__lib", false);
+				addFolderToZip(moduleAPIPath, "", false);
+				addFolderToZip(moduleLibPath, "__lib", false);
 
 				//String module = configFile.root["entryPoint"]->stringVal;
 			}
@@ -382,9 +752,9 @@ int main(int argc, char **argv) {
 				ObjectEntry *entryType = (*(*packed)[i])["type"];
 				if(entryPath && entryType) {
 					if(entryType->stringVal == "folder") {
-						addFolderToZip(z, entryPath->stringVal, entryPath->stringVal, false);
+						addFolderToZip(entryPath->stringVal, entryPath->stringVal, false);
 					} else {
-						addFileToZip(z, entryPath->stringVal, entryPath->stringVal, false);
+						addFileToZip(entryPath->stringVal, entryPath->stringVal, false);
 					}
 				}
 			}
@@ -394,10 +764,12 @@ int main(int argc, char **argv) {
 
 
 	runInfo.saveToXML("runinfo_tmp_zzzz.polyrun");
-	addFileToZip(z, "runinfo_tmp_zzzz.polyrun", "runinfo.polyrun", true);
+	addFileToZip("runinfo_tmp_zzzz.polyrun", "runinfo.polyrun", true);
 
-	//addFolderToZip(z, getArg("--project"), "");
+	//addFolderToZip(getArg("--project"), "");
 	
+	zipFile z = zipOpen64(getArg("--out").c_str(), 0);
+	writePackage(z);
 	zipClose(z, "");	
 
 	OSBasics::removeItem("runinfo_tmp_zzzz.polyrun");
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+/**
+* A vertex with every attribute the mesh file format stores. Bones are sorted by weight, strongest first, and unused slots have a weight of 0.
+*/
+class OptimizerVertex {
+	public:
+		float position[3];
+		float normal[3];
+		float color[4];
+		float texCoord[2];
+		float tangent[3];
+		unsigned int boneIDs[4];
+		float boneWeights[4];
+};
+
+/**
+* Optimization statistics for one level of detail.
+*/
+class OptimizerStats {
+	public:
+		unsigned int triangleCount;
+		unsigned int vertexCount;
+
+		/**
+		* Average cache miss ratio (transformed vertices per triangle) of the level before and after reordering, for a FIFO cache of MeshOptimizer::CACHE_SIZE entries.
+		*/
+		float acmrBefore;
+		float acmrAfter;
+
+		/**
+		* Largest distance between the simplified surface and the full detail one.
+		*/
+		float geometricError;
+};
+
+/**
+* Indexed triangle mesh optimizer used by polyimport. Triangles are welded into a shared vertex buffer, reordered for the post-transform vertex cache (Forsyth's algorithm) and then for overdraw, and can be simplified into lower levels of detail with quadric error metrics. Levels of detail share the vertex buffer and only differ in their indices.
+*/
+class MeshOptimizer {
+	public:
+		MeshOptimizer();
+
+		/**
+		* Adds a triangle. Call weldVertices() once all triangles are added.
+		*/
+		void addTriangle(const OptimizerVertex &v0, const OptimizerVertex &v1, const OptimizerVertex &v2);
+
+		/**
+		* Merges vertices whose attributes are equal and removes triangles that become degenerate. Positions within positionTolerance of an earlier vertex are moved onto it first, so vertices keep their original positions and vertices on either side of a hard edge or UV seam end up at exactly the same place.
+		* @param positionTolerance Positions closer than this are welded.
+		*/
+		void weldVertices(float positionTolerance);
+
+		/**
+		* Fills in tangents for meshes that don't have any, averaged over the triangles that share each vertex.
+		*/
+		void calculateTangents();
+
+		/**
+		* Simplifies the mesh until it has at most targetTriangleCount triangles or no edge can be collapsed without going over maxError. Vertices on open borders are kept. Vertices on seams, where vertices at the same position have different attributes, only collapse along the seam, all of their wedges together.
+		* @param indices Triangles to simplify. Must use this optimizer's vertices.
+		* @param targetTriangleCount Number of triangles to stop at.
+		* @param maxError Largest error a collapse is allowed to introduce.
+		* @param resultError Set to the largest error introduced.
+		* @return The simplified triangles.
+		*/
+		vector<unsigned int> simplify(const vector<unsigned int> &indices, unsigned int targetTriangleCount, float maxError, float *resultError) const;
+
+		/**
+		* Reorders triangles for the post-transform vertex cache.
+		*/
+		void optimizeVertexCache(vector<unsigned int> &indices) const;
+
+		/**
+		* Reorders clusters of cache-optimized triangles so that triangles facing away from the mesh center are drawn first, which reduces overdraw. The new order is only kept if its ACMR is at most threshold times the cache-optimized one.
+		*/
+		void optimizeOverdraw(vector<unsigned int> &indices, float threshold) const;
+
+		/**
+		* Returns the average cache miss ratio of the given triangles.
+		*/
+		float getACMR(const vector<unsigned int> &indices) const;
+
+		/**
+		* Returns the number of distinct vertices the given triangles use.
+		*/
+		unsigned int getUsedVertexCount(const vector<unsigned int> &indices) const;
+
+		/**
+		* Radius of the mesh's bounding sphere around its center.
+		*/
+		float getRadius() const;
+
+		vector<OptimizerVertex> vertices;
+		vector<unsigned int> indices;
+
+		static const int CACHE_SIZE = 16;
+		static const int FORSYTH_CACHE_SIZE = 32;
+
+	protected:
+
+		void getTriangleNormal(const unsigned int *triangle, float *normal, float *area) const;
+};
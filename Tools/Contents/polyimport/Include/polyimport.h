@@ -6,10 +6,50 @@
 #include <stdio.h>
 #include "PolyMesh.h"
 #include "PolyString.h"
+#include "MeshOptimizer.h"
 #include <vector>
+#include <algorithm>
+#include <stdarg.h>
+
+#ifdef _WINDOWS
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
 
 using std::vector;
 
+/**
+* A source file being converted. Jobs run in parallel, so each keeps its own state and collects its messages to be printed once all jobs are done.
+*/
+class ImportJob {
+	public:
+		ImportJob() {
+			scene = NULL;
+			hasWeights = false;
+			succeeded = false;
+		}
+
+		void log(const char *format, ...) {
+			char buffer[4096];
+			va_list argList;
+			va_start(argList, format);
+			vsnprintf(buffer, sizeof(buffer), format, argList);
+			va_end(argList);
+			output += buffer;
+		}
+
+	Polycode::String sourceFile;
+	Polycode::String outputFile;
+	Polycode::String output;
+
+	const struct aiScene *scene;
+	bool hasWeights;
+	bool succeeded;
+	vector<aiBone*> bones;
+};
+
 
 class IBone {
 	public:
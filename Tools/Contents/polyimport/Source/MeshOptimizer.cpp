@@ -0,0 +1,705 @@
+
+#include "MeshOptimizer.h"
+#include <map>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+class WeldKeyCompare {
+	public:
+		bool operator() (const OptimizerVertex &v1, const OptimizerVertex &v2) const { return memcmp(&v1, &v2, sizeof(OptimizerVertex)) < 0; }
+};
+
+class WeldCell {
+	public:
+		bool operator < (const WeldCell &c) const {
+			if(x != c.x) return x < c.x;
+			if(y != c.y) return y < c.y;
+			return z < c.z;
+		}
+
+		int x;
+		int y;
+		int z;
+};
+
+// symmetric 4x4 plane quadric, with the total area of the planes it was built from
+class Quadric {
+	public:
+		Quadric() {
+			memset(a, 0, sizeof(a));
+			weight = 0;
+		}
+
+		void addPlane(const float *normal, double d, double area) {
+			double nx = normal[0], ny = normal[1], nz = normal[2];
+			a[0] += area*nx*nx; a[1] += area*nx*ny; a[2] += area*nx*nz; a[3] += area*nx*d;
+			a[4] += area*ny*ny; a[5] += area*ny*nz; a[6] += area*ny*d;
+			a[7] += area*nz*nz; a[8] += area*nz*d;
+			a[9] += area*d*d;
+			weight += area;
+		}
+
+		void add(const Quadric &q) {
+			for(int i=0; i < 10; i++)
+				a[i] += q.a[i];
+			weight += q.weight;
+		}
+
+		// average squared distance from p to the planes
+		double evaluate(const float *p) const {
+			double x = p[0], y = p[1], z = p[2];
+			double e = a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+				+ a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+				+ a[7]*z*z + 2*a[8]*z
+				+ a[9];
+			if(weight > 0)
+				e /= weight;
+			return e > 0 ? e : 0;
+		}
+
+		double a[10];
+		double weight;
+};
+
+class CollapseCandidate {
+	public:
+		unsigned int from;
+		unsigned int to;
+		double cost;
+};
+
+class CollapseCandidateSorter {
+	public:
+		bool operator() (const CollapseCandidate &c1, const CollapseCandidate &c2) const { return c1.cost < c2.cost; }
+};
+
+class OverdrawCluster {
+	public:
+		unsigned int start;
+		unsigned int count;
+		float sortKey;
+};
+
+class OverdrawClusterSorter {
+	public:
+		bool operator() (const OverdrawCluster &c1, const OverdrawCluster &c2) const { return c1.sortKey > c2.sortKey; }
+};
+
+static void crossProduct(const float *a, const float *b, float *result) {
+	result[0] = a[1]*b[2] - a[2]*b[1];
+	result[1] = a[2]*b[0] - a[0]*b[2];
+	result[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static float normalize(float *v) {
+	float len = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+	if(len > 0) {
+		v[0] /= len;
+		v[1] /= len;
+		v[2] /= len;
+	}
+	return len;
+}
+
+static void faceNormal(const float *p0, const float *p1, const float *p2, float *normal) {
+	float e0[3] = {p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2]};
+	float e1[3] = {p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2]};
+	crossProduct(e0, e1, normal);
+}
+
+MeshOptimizer::MeshOptimizer() {
+}
+
+void MeshOptimizer::addTriangle(const OptimizerVertex &v0, const OptimizerVertex &v1, const OptimizerVertex &v2) {
+	unsigned int base = vertices.size();
+	vertices.push_back(v0);
+	vertices.push_back(v1);
+	vertices.push_back(v2);
+	indices.push_back(base);
+	indices.push_back(base+1);
+	indices.push_back(base+2);
+}
+
+void MeshOptimizer::weldVertices(float positionTolerance) {
+	// positions within the tolerance of an earlier one take that one's position, so vertices that only differ in
+	// other attributes end up at exactly the same place and the simplifier can tell seams from open borders
+	if(positionTolerance > 0) {
+		std::map<WeldCell, vector<unsigned int> > grid;
+		float toleranceSquared = positionTolerance * positionTolerance;
+		for(int i=0; i < vertices.size(); i++) {
+			float *position = vertices[i].position;
+			WeldCell cell;
+			cell.x = (int)floorf(position[0] / positionTolerance);
+			cell.y = (int)floorf(position[1] / positionTolerance);
+			cell.z = (int)floorf(position[2] / positionTolerance);
+
+			bool welded = false;
+			for(int n=0; n < 27 && !welded; n++) {
+				WeldCell neighbour;
+				neighbour.x = cell.x + (n % 3) - 1;
+				neighbour.y = cell.y + ((n / 3) % 3) - 1;
+				neighbour.z = cell.z + (n / 9) - 1;
+				std::map<WeldCell, vector<unsigned int> >::iterator it = grid.find(neighbour);
+				if(it == grid.end())
+					continue;
+				for(int j=0; j < it->second.size(); j++) {
+					const float *other = vertices[it->second[j]].position;
+					float d[3] = {position[0]-other[0], position[1]-other[1], position[2]-other[2]};
+					if(d[0]*d[0] + d[1]*d[1] + d[2]*d[2] <= toleranceSquared) {
+						memcpy(position, other, sizeof(float) * 3);
+						welded = true;
+						break;
+					}
+				}
+			}
+			if(!welded)
+				grid[cell].push_back(i);
+		}
+	}
+
+	std::map<OptimizerVertex, unsigned int, WeldKeyCompare> vertexMap;
+	vector<OptimizerVertex> weldedVertices;
+	vector<unsigned int> remap(vertices.size());
+
+	for(int i=0; i < vertices.size(); i++) {
+		std::map<OptimizerVertex, unsigned int, WeldKeyCompare>::iterator it = vertexMap.find(vertices[i]);
+		if(it != vertexMap.end()) {
+			remap[i] = it->second;
+		} else {
+			remap[i] = weldedVertices.size();
+			vertexMap[vertices[i]] = remap[i];
+			weldedVertices.push_back(vertices[i]);
+		}
+	}
+
+	vector<unsigned int> weldedIndices;
+	weldedIndices.reserve(indices.size());
+	for(int i=0; i+2 < indices.size(); i += 3) {
+		unsigned int a = remap[indices[i]];
+		unsigned int b = remap[indices[i+1]];
+		unsigned int c = remap[indices[i+2]];
+		if(a == b || b == c || a == c)
+			continue;
+		weldedIndices.push_back(a);
+		weldedIndices.push_back(b);
+		weldedIndices.push_back(c);
+	}
+
+	vertices = weldedVertices;
+	indices = weldedIndices;
+}
+
+void MeshOptimizer::calculateTangents() {
+	vector<float> accumulated(vertices.size() * 3, 0.0f);
+
+	for(int i=0; i+2 < indices.size(); i += 3) {
+		const OptimizerVertex &v0 = vertices[indices[i]];
+		const OptimizerVertex &v1 = vertices[indices[i+1]];
+		const OptimizerVertex &v2 = vertices[indices[i+2]];
+
+		float side0[3] = {v0.position[0]-v1.position[0], v0.position[1]-v1.position[1], v0.position[2]-v1.position[2]};
+		float side1[3] = {v2.position[0]-v0.position[0], v2.position[1]-v0.position[1], v2.position[2]-v0.position[2]};
+		float deltaV0 = v0.texCoord[1] - v1.texCoord[1];
+		float deltaV1 = v2.texCoord[1] - v0.texCoord[1];
+
+		float tangent[3];
+		for(int j=0; j < 3; j++)
+			tangent[j] = side0[j] * deltaV1 - side1[j] * deltaV0;
+
+		for(int k=0; k < 3; k++) {
+			for(int j=0; j < 3; j++)
+				accumulated[(indices[i+k]*3)+j] += tangent[j];
+		}
+	}
+
+	for(int i=0; i < vertices.size(); i++) {
+		float *t = vertices[i].tangent;
+		if(t[0] != 0 || t[1] != 0 || t[2] != 0)
+			continue;
+		const float *n = vertices[i].normal;
+		float *a = &accumulated[i*3];
+		float d = a[0]*n[0] + a[1]*n[1] + a[2]*n[2];
+		for(int j=0; j < 3; j++)
+			t[j] = a[j] - n[j] * d;
+		normalize(t);
+	}
+}
+
+void MeshOptimizer::getTriangleNormal(const unsigned int *triangle, float *normal, float *area) const {
+	faceNormal(vertices[triangle[0]].position, vertices[triangle[1]].position, vertices[triangle[2]].position, normal);
+	*area = normalize(normal) * 0.5f;
+}
+
+float MeshOptimizer::getACMR(const vector<unsigned int> &indices) const {
+	if(indices.size() < 3)
+		return 0;
+
+	// a vertex is in the FIFO cache if fewer than CACHE_SIZE vertices were loaded since it was
+	vector<unsigned int> loadTime(vertices.size(), 0);
+	unsigned int time = CACHE_SIZE + 1;
+	unsigned int misses = 0;
+	for(int i=0; i < indices.size(); i++) {
+		unsigned int v = indices[i];
+		if(time - loadTime[v] > CACHE_SIZE) {
+			loadTime[v] = time++;
+			misses++;
+		}
+	}
+	return (float)misses / (float)(indices.size() / 3);
+}
+
+unsigned int MeshOptimizer::getUsedVertexCount(const vector<unsigned int> &indices) const {
+	vector<bool> used(vertices.size(), false);
+	unsigned int count = 0;
+	for(int i=0; i < indices.size(); i++) {
+		if(!used[indices[i]]) {
+			used[indices[i]] = true;
+			count++;
+		}
+	}
+	return count;
+}
+
+float MeshOptimizer::getRadius() const {
+	if(vertices.size() == 0)
+		return 0;
+
+	float minPos[3], maxPos[3];
+	for(int j=0; j < 3; j++)
+		minPos[j] = maxPos[j] = vertices[0].position[j];
+	for(int i=1; i < vertices.size(); i++) {
+		for(int j=0; j < 3; j++) {
+			minPos[j] = std::min(minPos[j], vertices[i].position[j]);
+			maxPos[j] = std::max(maxPos[j], vertices[i].position[j]);
+		}
+	}
+
+	float radius = 0;
+	for(int i=0; i < vertices.size(); i++) {
+		float d = 0;
+		for(int j=0; j < 3; j++) {
+			float delta = vertices[i].position[j] - (minPos[j] + maxPos[j]) * 0.5f;
+			d += delta * delta;
+		}
+		radius = std::max(radius, d);
+	}
+	return sqrtf(radius);
+}
+
+// vertex scores from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static float forsythVertexScore(int cachePosition, unsigned int valence) {
+	if(valence == 0)
+		return -1.0f;
+
+	float score = 0;
+	if(cachePosition >= 0) {
+		if(cachePosition < 3) {
+			score = 0.75f;
+		} else {
+			float scale = 1.0f / (MeshOptimizer::FORSYTH_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, 1.5f);
+		}
+	}
+	return score + 2.0f * powf((float)valence, -0.5f);
+}
+
+void MeshOptimizer::optimizeVertexCache(vector<unsigned int> &indices) const {
+	unsigned int triangleCount = indices.size() / 3;
+	if(triangleCount == 0)
+		return;
+
+	unsigned int vertexCount = vertices.size();
+
+	// triangles that use each vertex, packed into one array
+	vector<unsigned int> valence(vertexCount, 0);
+	for(int i=0; i < triangleCount * 3; i++)
+		valence[indices[i]]++;
+	vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for(int i=0; i < vertexCount; i++)
+		adjacencyOffset[i+1] = adjacencyOffset[i] + valence[i];
+	vector<unsigned int> adjacency(triangleCount * 3);
+	vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for(int i=0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for(int i=0; i < vertexCount; i++)
+		vertexScore[i] = forsythVertexScore(-1, valence[i]);
+
+	vector<float> triangleScore(triangleCount);
+	for(int i=0; i < triangleCount; i++)
+		triangleScore[i] = vertexScore[indices[i*3]] + vertexScore[indices[i*3+1]] + vertexScore[indices[i*3+2]];
+
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+
+	vector<unsigned int> cache;
+	vector<unsigned int> newCache;
+	unsigned int nextUnemitted = 0;
+	int bestTriangle = -1;
+
+	for(int emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		if(bestTriangle < 0) {
+			while(emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		unsigned int *triangle = &indices[bestTriangle*3];
+		emitted[bestTriangle] = true;
+		result.push_back(triangle[0]);
+		result.push_back(triangle[1]);
+		result.push_back(triangle[2]);
+
+		newCache.clear();
+		for(int k=0; k < 3; k++) {
+			unsigned int v = triangle[k];
+			newCache.push_back(v);
+
+			// remove the triangle from the vertex's list of remaining triangles
+			unsigned int *begin = &adjacency[adjacencyOffset[v]];
+			for(int j=0; j < valence[v]; j++) {
+				if(begin[j] == bestTriangle) {
+					begin[j] = begin[valence[v]-1];
+					break;
+				}
+			}
+			valence[v]--;
+		}
+		for(int j=0; j < cache.size(); j++) {
+			unsigned int v = cache[j];
+			if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+		for(int j=0; j < cache.size(); j++)
+			cachePosition[cache[j]] = -1;
+
+		cache.clear();
+		for(int j=0; j < newCache.size(); j++) {
+			unsigned int v = newCache[j];
+			if(j < FORSYTH_CACHE_SIZE) {
+				cachePosition[v] = j;
+				cache.push_back(v);
+			}
+			vertexScore[v] = forsythVertexScore(cachePosition[v], valence[v]);
+		}
+
+		// only triangles around the cached vertices changed score, so the next triangle is picked among them
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for(int j=0; j < newCache.size(); j++) {
+			unsigned int v = newCache[j];
+			for(int a=0; a < valence[v]; a++) {
+				unsigned int t = adjacency[adjacencyOffset[v] + a];
+				float score = vertexScore[indices[t*3]] + vertexScore[indices[t*3+1]] + vertexScore[indices[t*3+2]];
+				triangleScore[t] = score;
+				if(score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	indices = result;
+}
+
+void MeshOptimizer::optimizeOverdraw(vector<unsigned int> &indices, float threshold) const {
+	unsigned int triangleCount = indices.size() / 3;
+	if(triangleCount < 2)
+		return;
+
+	// split the cache-optimized order into clusters where the cache starts over, so reordering them costs few extra misses
+	vector<OverdrawCluster> clusters;
+	vector<unsigned int> loadTime(vertices.size(), 0);
+	unsigned int time = CACHE_SIZE + 1;
+	for(int i=0; i < triangleCount; i++) {
+		int misses = 0;
+		for(int k=0; k < 3; k++) {
+			unsigned int v = indices[i*3+k];
+			if(time - loadTime[v] > CACHE_SIZE) {
+				loadTime[v] = time++;
+				misses++;
+			}
+		}
+		if(i == 0 || misses == 3) {
+			OverdrawCluster cluster;
+			cluster.start = i;
+			cluster.count = 0;
+			cluster.sortKey = 0;
+			clusters.push_back(cluster);
+		}
+		clusters.back().count++;
+	}
+	if(clusters.size() < 2)
+		return;
+
+	float meshCenter[3] = {0, 0, 0};
+	float meshArea = 0;
+	for(int i=0; i < triangleCount; i++) {
+		float normal[3], area;
+		getTriangleNormal(&indices[i*3], normal, &area);
+		for(int j=0; j < 3; j++)
+			meshCenter[j] += area * (vertices[indices[i*3]].position[j] + vertices[indices[i*3+1]].position[j] + vertices[indices[i*3+2]].position[j]) / 3.0f;
+		meshArea += area;
+	}
+	if(meshArea <= 0)
+		return;
+	for(int j=0; j < 3; j++)
+		meshCenter[j] /= meshArea;
+
+	// clusters that face away from the center are likely to occlude the rest of the mesh
+	for(int c=0; c < clusters.size(); c++) {
+		float center[3] = {0, 0, 0};
+		float clusterNormal[3] = {0, 0, 0};
+		float clusterArea = 0;
+		for(int i=clusters[c].start; i < clusters[c].start + clusters[c].count; i++) {
+			float normal[3], area;
+			getTriangleNormal(&indices[i*3], normal, &area);
+			for(int j=0; j < 3; j++) {
+				center[j] += area * (vertices[indices[i*3]].position[j] + vertices[indices[i*3+1]].position[j] + vertices[indices[i*3+2]].position[j]) / 3.0f;
+				clusterNormal[j] += area * normal[j];
+			}
+			clusterArea += area;
+		}
+		if(clusterArea > 0) {
+			for(int j=0; j < 3; j++)
+				center[j] /= clusterArea;
+		}
+		normalize(clusterNormal);
+		clusters[c].sortKey = (center[0]-meshCenter[0]) * clusterNormal[0] + (center[1]-meshCenter[1]) * clusterNormal[1] + (center[2]-meshCenter[2]) * clusterNormal[2];
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), OverdrawClusterSorter());
+
+	vector<unsigned int> result;
+	result.reserve(indices.size());
+	for(int c=0; c < clusters.size(); c++) {
+		result.insert(result.end(), indices.begin() + clusters[c].start*3, indices.begin() + (clusters[c].start + clusters[c].count)*3);
+	}
+
+	if(getACMR(result) <= getACMR(indices) * threshold)
+		indices = result;
+}
+
+vector<unsigned int> MeshOptimizer::simplify(const vector<unsigned int> &indices, unsigned int targetTriangleCount, float maxError, float *resultError) const {
+	vector<unsigned int> result = indices;
+	unsigned int vertexCount = vertices.size();
+	double maxCost = (double)maxError * (double)maxError;
+	double largestCost = 0;
+
+	// vertices at the same position, such as the wedges of an attribute seam, share a group and move together
+	vector<unsigned int> positionGroup(vertexCount);
+	unsigned int groupCount = 0;
+	{
+		std::map<vector<float>, unsigned int> positions;
+		for(int i=0; i < vertexCount; i++) {
+			vector<float> key(vertices[i].position, vertices[i].position + 3);
+			std::map<vector<float>, unsigned int>::iterator it = positions.find(key);
+			if(it == positions.end()) {
+				positions[key] = groupCount;
+				positionGroup[i] = groupCount++;
+			} else {
+				positionGroup[i] = it->second;
+			}
+		}
+	}
+	vector<unsigned int> groupOffset(groupCount + 1, 0);
+	for(int i=0; i < vertexCount; i++)
+		groupOffset[positionGroup[i]+1]++;
+	for(int i=0; i < groupCount; i++)
+		groupOffset[i+1] += groupOffset[i];
+	vector<unsigned int> groupMembers(vertexCount);
+	{
+		vector<unsigned int> fill(groupOffset.begin(), groupOffset.end() - 1);
+		for(int i=0; i < vertexCount; i++)
+			groupMembers[fill[positionGroup[i]]++] = i;
+	}
+
+	vector<Quadric> quadrics(groupCount);
+	for(int i=0; i+2 < result.size(); i += 3) {
+		float normal[3], area;
+		getTriangleNormal(&result[i], normal, &area);
+		const float *p = vertices[result[i]].position;
+		double d = -(normal[0]*p[0] + normal[1]*p[1] + normal[2]*p[2]);
+		for(int k=0; k < 3; k++)
+			quadrics[positionGroup[result[i+k]]].addPlane(normal, d, area);
+	}
+
+	// vertices on open borders stay where they are, so borders don't shrink. An edge shared by two triangles
+	// with different wedges at its ends is a seam, not a border.
+	vector<bool> locked(groupCount, false);
+	{
+		std::map<std::pair<unsigned int, unsigned int>, unsigned int> edgeCount;
+		for(int i=0; i+2 < result.size(); i += 3) {
+			for(int k=0; k < 3; k++) {
+				unsigned int a = positionGroup[result[i+k]];
+				unsigned int b = positionGroup[result[i+((k+1)%3)]];
+				edgeCount[std::make_pair(std::min(a, b), std::max(a, b))]++;
+			}
+		}
+		for(std::map<std::pair<unsigned int, unsigned int>, unsigned int>::iterator it = edgeCount.begin(); it != edgeCount.end(); it++) {
+			if(it->second == 1) {
+				locked[it->first.first] = true;
+				locked[it->first.second] = true;
+			}
+		}
+	}
+
+	vector<unsigned int> remap(vertexCount);
+	vector<bool> touched(vertexCount);
+	vector<unsigned int> valence(vertexCount);
+	vector<unsigned int> adjacencyOffset(vertexCount + 1);
+	vector<unsigned int> adjacency;
+	vector<CollapseCandidate> candidates;
+	vector<CollapseCandidate> wedgeCollapses;
+
+	// collapse edges in passes, cheapest first, never touching the same neighbourhood twice in one pass
+	while(result.size() / 3 > targetTriangleCount) {
+		unsigned int triangleCount = result.size() / 3;
+
+		std::fill(valence.begin(), valence.end(), 0);
+		for(int i=0; i < result.size(); i++)
+			valence[result[i]]++;
+		adjacencyOffset[0] = 0;
+		for(int i=0; i < vertexCount; i++)
+			adjacencyOffset[i+1] = adjacencyOffset[i] + valence[i];
+		adjacency.resize(result.size());
+		vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for(int i=0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = i / 3;
+
+		candidates.clear();
+		for(int i=0; i < result.size(); i += 3) {
+			for(int k=0; k < 3; k++) {
+				unsigned int a = result[i+k];
+				unsigned int b = result[i+((k+1)%3)];
+				unsigned int ga = positionGroup[a];
+				unsigned int gb = positionGroup[b];
+				if(ga == gb)
+					continue;
+				if(!locked[ga]) {
+					CollapseCandidate candidate;
+					candidate.from = a;
+					candidate.to = b;
+					candidate.cost = quadrics[ga].evaluate(vertices[b].position);
+					candidates.push_back(candidate);
+				}
+				if(!locked[gb]) {
+					CollapseCandidate candidate;
+					candidate.from = b;
+					candidate.to = a;
+					candidate.cost = quadrics[gb].evaluate(vertices[a].position);
+					candidates.push_back(candidate);
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), CollapseCandidateSorter());
+
+		for(int i=0; i < vertexCount; i++)
+			remap[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+
+		unsigned int removedTriangles = 0;
+		unsigned int trianglesToRemove = triangleCount - targetTriangleCount;
+
+		for(int c=0; c < candidates.size() && removedTriangles < trianglesToRemove; c++) {
+			const CollapseCandidate &candidate = candidates[c];
+			if(candidate.cost > maxCost)
+				break;
+			unsigned int fromGroup = positionGroup[candidate.from];
+			unsigned int toGroup = positionGroup[candidate.to];
+
+			// each wedge of the vertex collapses along the same edge on its side of the seam, so the seam stays
+			// closed. If one of them has no such edge, as at the corner of a hard edged box, the vertex stays.
+			wedgeCollapses.clear();
+			bool valid = true;
+			for(int w=groupOffset[fromGroup]; w < groupOffset[fromGroup+1] && valid; w++) {
+				unsigned int from = groupMembers[w];
+				if(valence[from] == 0)
+					continue;
+				CollapseCandidate wedgeCollapse;
+				wedgeCollapse.from = from;
+				wedgeCollapse.to = from;
+				for(int a=0; a < valence[from] && wedgeCollapse.to == from; a++) {
+					const unsigned int *triangle = &result[adjacency[adjacencyOffset[from] + a] * 3];
+					for(int k=0; k < 3; k++) {
+						if(positionGroup[triangle[k]] == toGroup)
+							wedgeCollapse.to = triangle[k];
+					}
+				}
+				if(wedgeCollapse.to == from || touched[from] || touched[wedgeCollapse.to])
+					valid = false;
+				wedgeCollapses.push_back(wedgeCollapse);
+			}
+			if(!valid)
+				continue;
+
+			// reject collapses that would flip a triangle
+			bool flips = false;
+			unsigned int collapsedTriangles = 0;
+			const float *target = vertices[candidate.to].position;
+			for(int w=0; w < wedgeCollapses.size() && !flips; w++) {
+				unsigned int from = wedgeCollapses[w].from;
+				for(int a=0; a < valence[from] && !flips; a++) {
+					const unsigned int *triangle = &result[adjacency[adjacencyOffset[from] + a] * 3];
+					if(triangle[0] == wedgeCollapses[w].to || triangle[1] == wedgeCollapses[w].to || triangle[2] == wedgeCollapses[w].to) {
+						collapsedTriangles++;
+						continue;
+					}
+					const float *p[3];
+					const float *q[3];
+					for(int k=0; k < 3; k++) {
+						p[k] = vertices[triangle[k]].position;
+						q[k] = triangle[k] == from ? target : p[k];
+					}
+					float before[3], after[3];
+					faceNormal(p[0], p[1], p[2], before);
+					faceNormal(q[0], q[1], q[2], after);
+					if(normalize(after) == 0 || before[0]*after[0] + before[1]*after[1] + before[2]*after[2] <= 0)
+						flips = true;
+				}
+			}
+			if(flips)
+				continue;
+
+			quadrics[toGroup].add(quadrics[fromGroup]);
+			for(int w=0; w < wedgeCollapses.size(); w++) {
+				unsigned int from = wedgeCollapses[w].from;
+				remap[from] = wedgeCollapses[w].to;
+				for(int a=0; a < valence[from]; a++) {
+					const unsigned int *triangle = &result[adjacency[adjacencyOffset[from] + a] * 3];
+					touched[triangle[0]] = true;
+					touched[triangle[1]] = true;
+					touched[triangle[2]] = true;
+				}
+			}
+			removedTriangles += collapsedTriangles;
+			largestCost = std::max(largestCost, candidate.cost);
+		}
+
+		if(removedTriangles == 0)
+			break;
+
+		vector<unsigned int> collapsed;
+		collapsed.reserve(result.size());
+		for(int i=0; i < result.size(); i += 3) {
+			unsigned int a = remap[result[i]];
+			unsigned int b = remap[result[i+1]];
+			unsigned int c = remap[result[i+2]];
+			if(a == b || b == c || a == c)
+				continue;
+			collapsed.push_back(a);
+			collapsed.push_back(b);
+			collapsed.push_back(c);
+		}
+		result = collapsed;
+	}
+
+	if(resultError)
+		*resultError = sqrt(largestCost);
+	return result;
+}
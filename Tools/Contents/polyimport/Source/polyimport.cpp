@@ -7,134 +7,254 @@
 
 using namespace Polycode;
 
-const struct aiScene* scene = NULL;
-bool hasWeights = false;
-vector<aiBone*> bones;
-unsigned int numBones = 0;
-
-unsigned int addBone(aiBone *bone) {
-	for(int i=0; i < bones.size(); i++) {
-		if(bones[i]->mName == bone->mName)
+vector<String> args;
+
+String getArg(String argName) {
+	for(int i=0; i < args.size(); i++) {
+		String arg = args[i];
+		if(arg.find(argName + "=") == 0)
+			return arg.substr(argName.length() + 1);
+	}
+	return "";
+}
+
+Number getNumberArg(String argName, Number defaultValue) {
+	String value = getArg(argName);
+	if(value == "")
+		return defaultValue;
+	return atof(value.c_str());
+}
+
+unsigned int addBone(ImportJob *job, aiBone *bone) {
+	for(int i=0; i < job->bones.size(); i++) {
+		if(job->bones[i]->mName == bone->mName)
 			return i;
 	}
-	bones.push_back(bone);
-	return bones.size()-1;
+	job->bones.push_back(bone);
+	return job->bones.size()-1;
 }
 
-void addToMesh(Polycode::Mesh *tmesh, const struct aiScene *sc, const struct aiNode* nd, bool swapZY) {
-	int i;
+void addToMesh(ImportJob *job, MeshOptimizer *optimizer, const struct aiNode* nd, bool swapZY) {
 	unsigned int n = 0, t;
-	// draw all meshes assigned to this node
 
 	for (; n < nd->mNumMeshes; ++n) {
-		const struct aiMesh* mesh = scene->mMeshes[nd->mMeshes[n]];
-		printf("Importing mesh:%s\n", mesh->mName.data);
-
-		//apply_material(sc->mMaterials[mesh->mMaterialIndex]);
+		const struct aiMesh* mesh = job->scene->mMeshes[nd->mMeshes[n]];
+		job->log("Importing mesh:%s\n", mesh->mName.data);
+
+		// gather the bone weights once per mesh instead of searching every bone for every vertex
+		vector<vector<std::pair<float, unsigned int> > > weights(mesh->mNumVertices);
+		for(unsigned int a = 0; a < mesh->mNumBones; a++) {
+			aiBone* bone = mesh->mBones[a];
+			unsigned int boneIndex = addBone(job, bone);
+			for(unsigned int b = 0; b < bone->mNumWeights; b++) {
+				if(bone->mWeights[b].mVertexId < mesh->mNumVertices) {
+					weights[bone->mWeights[b].mVertexId].push_back(std::make_pair(bone->mWeights[b].mWeight, boneIndex));
+					job->hasWeights = true;
+				}
+			}
+		}
 
 		for (t = 0; t < mesh->mNumFaces; ++t) {
 			const struct aiFace* face = &mesh->mFaces[t];
-			Polycode::Polygon *poly = new Polycode::Polygon();			
-	
-			for(i = 0; i < face->mNumIndices; i++) {
-				Vertex *vertex = new Vertex();
+			if(face->mNumIndices != 3)
+				continue;
+
+			OptimizerVertex faceVertices[3];
+			for(int i = 0; i < 3; i++) {
+				OptimizerVertex &vertex = faceVertices[i];
+				memset(&vertex, 0, sizeof(OptimizerVertex));
 
 				int index = face->mIndices[i];
-				if(mesh->mColors[0] != NULL) {
-					vertex->vertexColor.setColorRGBA(mesh->mColors[0][index].r, mesh->mColors[0][index].g, mesh->mColors[0][index].b, mesh->mColors[0][index].a);
+				if(swapZY) {
+					vertex.position[0] = mesh->mVertices[index].x;
+					vertex.position[1] = mesh->mVertices[index].z;
+					vertex.position[2] = -mesh->mVertices[index].y;
+				} else {
+					vertex.position[0] = mesh->mVertices[index].x;
+					vertex.position[1] = mesh->mVertices[index].y;
+					vertex.position[2] = mesh->mVertices[index].z;
 				}
 
 				if(mesh->mNormals != NULL)  {
-					if(swapZY)
-						vertex->setNormal(mesh->mNormals[index].x, mesh->mNormals[index].z, -mesh->mNormals[index].y);
-					else
-						vertex->setNormal(mesh->mNormals[index].x, mesh->mNormals[index].y, mesh->mNormals[index].z);
+					vertex.normal[0] = mesh->mNormals[index].x;
+					vertex.normal[1] = swapZY ? mesh->mNormals[index].z : mesh->mNormals[index].y;
+					vertex.normal[2] = swapZY ? -mesh->mNormals[index].y : mesh->mNormals[index].z;
+				}
+
+				if(mesh->mTangents != NULL)  {
+					vertex.tangent[0] = mesh->mTangents[index].x;
+					vertex.tangent[1] = swapZY ? mesh->mTangents[index].z : mesh->mTangents[index].y;
+					vertex.tangent[2] = swapZY ? -mesh->mTangents[index].y : mesh->mTangents[index].z;
+				}
+
+				if(mesh->mColors[0] != NULL) {
+					vertex.color[0] = mesh->mColors[0][index].r;
+					vertex.color[1] = mesh->mColors[0][index].g;
+					vertex.color[2] = mesh->mColors[0][index].b;
+					vertex.color[3] = mesh->mColors[0][index].a;
+				} else {
+					vertex.color[0] = vertex.color[1] = vertex.color[2] = vertex.color[3] = 1.0f;
 				}
 
 				if(mesh->HasTextureCoords(0))
 				{
-					vertex->setTexCoord(mesh->mTextureCoords[0][index].x, mesh->mTextureCoords[0][index].y);
+					vertex.texCoord[0] = mesh->mTextureCoords[0][index].x;
+					vertex.texCoord[1] = mesh->mTextureCoords[0][index].y;
 				}
 
-				for( unsigned int a = 0; a < mesh->mNumBones; a++) {
-					aiBone* bone = mesh->mBones[a];
-					unsigned int boneIndex = addBone(bone);
-
-					for( unsigned int b = 0; b < bone->mNumWeights; b++) {
-						if(bone->mWeights[b].mVertexId == index) {
-							vertex->addBoneAssignment(boneIndex, bone->mWeights[b].mWeight);
-							hasWeights = true;
-						}
-					}
+				vector<std::pair<float, unsigned int> > &vertexWeights = weights[index];
+				std::sort(vertexWeights.begin(), vertexWeights.end());
+				for(int b=0; b < 4 && b < vertexWeights.size(); b++) {
+					vertex.boneWeights[b] = vertexWeights[vertexWeights.size()-1-b].first;
+					vertex.boneIDs[b] = vertexWeights[vertexWeights.size()-1-b].second;
 				}
-	
-				if(swapZY)
-					vertex->set(mesh->mVertices[index].x, mesh->mVertices[index].z, -mesh->mVertices[index].y);
-				else
-					vertex->set(mesh->mVertices[index].x, mesh->mVertices[index].y, mesh->mVertices[index].z);
-				poly->addVertex(vertex);
 			}
-			tmesh->addPolygon(poly);
+			optimizer->addTriangle(faceVertices[0], faceVertices[1], faceVertices[2]);
 		}
 	}
 
 	// draw all children
 	for (n = 0; n < nd->mNumChildren; ++n) {
-		addToMesh(tmesh, sc, nd->mChildren[n], swapZY);
+		addToMesh(job, optimizer, nd->mChildren[n], swapZY);
+	}
+}
+
+Polycode::Mesh *createMesh(const MeshOptimizer &optimizer, const vector<unsigned int> &indices) {
+	Polycode::Mesh *mesh = new Polycode::Mesh(Mesh::TRI_MESH);
+	for(int i=0; i+2 < indices.size(); i += 3) {
+		Polycode::Polygon *poly = new Polycode::Polygon();
+		for(int k=0; k < 3; k++) {
+			const OptimizerVertex &v = optimizer.vertices[indices[i+k]];
+			Vertex *vertex = new Vertex(v.position[0], v.position[1], v.position[2]);
+			vertex->setNormal(v.normal[0], v.normal[1], v.normal[2]);
+			vertex->tangent.set(v.tangent[0], v.tangent[1], v.tangent[2]);
+			vertex->vertexColor.setColor(v.color[0], v.color[1], v.color[2], v.color[3]);
+			vertex->setTexCoord(v.texCoord[0], v.texCoord[1]);
+			for(int b=0; b < 4; b++) {
+				if(v.boneWeights[b] > 0)
+					vertex->addBoneAssignment(v.boneIDs[b], v.boneWeights[b]);
+			}
+			poly->addVertex(vertex);
+		}
+		mesh->addPolygon(poly);
 	}
+	return mesh;
 }
 
-int getBoneID(aiString name) {
-	for(int i=0; i  < bones.size(); i++) {
-		if(bones[i]->mName == name) {
+int getBoneID(ImportJob *job, aiString name) {
+	for(int i=0; i  < job->bones.size(); i++) {
+		if(job->bones[i]->mName == name) {
 			return i;
 		}
 	}
 	return 666;
 }
 
-void addToISkeleton(ISkeleton *skel, IBone *parent, const struct aiScene *sc, const struct aiNode* nd) {
+void addToISkeleton(ImportJob *job, ISkeleton *skel, IBone *parent, const struct aiNode* nd) {
 	IBone *bone = new IBone();
 	bone->parent = parent;
 	bone->name = nd->mName;
 	bone->t = nd->mTransformation;
 
-	for(int i=0; i < bones.size(); i++) {
-		if(bones[i]->mName == bone->name) {
-			bone->bindMatrix = bones[i]->mOffsetMatrix;
+	for(int i=0; i < job->bones.size(); i++) {
+		if(job->bones[i]->mName == bone->name) {
+			bone->bindMatrix = job->bones[i]->mOffsetMatrix;
 		}
 	}
 
 	for (int n = 0; n < nd->mNumChildren; ++n) {
-		addToISkeleton(skel, bone, sc, nd->mChildren[n]);
+		addToISkeleton(job, skel, bone, nd->mChildren[n]);
 	}
-	skel->addIBone(bone, getBoneID(bone->name));
+	skel->addIBone(bone, getBoneID(job, bone->name));
 }
 
-int exportToFile(const char *fileName, bool swapZY) {
+// welds, reorders and simplifies the imported triangles, then writes them with their levels of detail
+void writeOptimizedMesh(ImportJob *job, MeshOptimizer *optimizer, OSFILE *outFile) {
+	float radius = optimizer->getRadius();
+	optimizer->weldVertices(getNumberArg("--weldTolerance", 0.00001) * radius);
+	optimizer->calculateTangents();
+
+	bool optimize = getArg("--optimize") != "false";
+	int numLODs = optimize ? (int)getNumberArg("--lods", 3) : 0;
+	Number lodRatio = getNumberArg("--lodRatio", 0.5);
+	Number maxError = getNumberArg("--lodMaxError", 0.05) * radius;
+
+	vector<vector<unsigned int> > levels;
+	vector<float> levelErrors;
+	levels.push_back(optimizer->indices);
+	levelErrors.push_back(0);
+
+	unsigned int fullTriangleCount = optimizer->indices.size() / 3;
+	Number targetRatio = 1.0;
+	for(int i=0; i < numLODs; i++) {
+		targetRatio *= lodRatio;
+		float error = 0;
+		vector<unsigned int> lod = optimizer->simplify(optimizer->indices, fullTriangleCount * targetRatio, maxError, &error);
+		// stop once simplifying doesn't remove a meaningful number of triangles any more
+		if(lod.size() == 0 || lod.size() > levels.back().size() * 0.9)
+			break;
+		levels.push_back(lod);
+		levelErrors.push_back(error);
+	}
+
+	Polycode::Mesh *mesh = NULL;
+	vector<MeshLOD> lods;
+	for(int i=0; i < levels.size(); i++) {
+		float acmrBefore = optimizer->getACMR(levels[i]);
+		if(optimize) {
+			optimizer->optimizeVertexCache(levels[i]);
+			optimizer->optimizeOverdraw(levels[i], getNumberArg("--overdrawThreshold", 1.05));
+		}
+		job->log("LOD %d: %d triangles, %d vertices, ACMR %.3f -> %.3f, error %.5f\n", i, (int)levels[i].size() / 3, optimizer->getUsedVertexCount(levels[i]), acmrBefore, optimizer->getACMR(levels[i]), levelErrors[i]);
+
+		if(i == 0) {
+			mesh = createMesh(*optimizer, levels[i]);
+		} else {
+			MeshLOD lod;
+			lod.mesh = createMesh(*optimizer, levels[i]);
+			lod.geometricError = levelErrors[i];
+			lods.push_back(lod);
+		}
+	}
+
+	mesh->saveToFile(outFile, lods);
+
+	delete mesh;
+	for(int i=0; i < lods.size(); i++) {
+		delete lods[i].mesh;
+	}
+}
+
+int exportToFile(ImportJob *job, const char *fileName, bool swapZY) {
+	const struct aiScene *scene = job->scene;
 	String fileNameMesh = String(fileName)+".mesh";
 	OSFILE *outFile = OSBasics::open(fileNameMesh.c_str(), "wb");
-	Polycode::Mesh *mesh = new Polycode::Mesh(Mesh::TRI_MESH);
-	addToMesh(mesh, scene, scene->mRootNode, swapZY);
-	mesh->saveToFile(outFile);
+	if(!outFile) {
+		job->log("Unable to write %s\n", fileNameMesh.c_str());
+		return 0;
+	}
+	MeshOptimizer *optimizer = new MeshOptimizer();
+	addToMesh(job, optimizer, scene->mRootNode, swapZY);
+	writeOptimizedMesh(job, optimizer, outFile);
+	delete optimizer;
 	OSBasics::close(outFile);
 
-	if(hasWeights) {
-		printf("Mesh has weights, exporting skeleton...\n");
+	if(job->hasWeights) {
+		job->log("Mesh has weights, exporting skeleton...\n");
 		String fileNameSkel = String(fileName)+".skeleton";
 		ISkeleton *skeleton = new ISkeleton();
 	
 		for (int n = 0; n < scene->mRootNode->mNumChildren; ++n) {
 			if(scene->mRootNode->mChildren[n]->mNumChildren > 0) {
-				addToISkeleton(skeleton, NULL, scene, scene->mRootNode->mChildren[n]);
+				addToISkeleton(job, skeleton, NULL, scene->mRootNode->mChildren[n]);
 			}
 		}
 
 		if(scene->HasAnimations()) {
-			printf("Importing animations...\n");
+			job->log("Importing animations...\n");
 			for(int i=0; i < scene->mNumAnimations;i++) {
 				aiAnimation *a = scene->mAnimations[i];
-				printf("Importing '%s' (%d tracks)\n", a->mName.data, a->mNumChannels);
+				job->log("Importing '%s' (%d tracks)\n", a->mName.data, a->mNumChannels);
 			
 				IAnimation *anim = new IAnimation();
 				anim->tps = a->mTicksPerSecond;
@@ -155,42 +275,167 @@ int exportToFile(const char *fileName, bool swapZY) {
 				
 			}
 		} else {
-			printf("No animations in file...\n");
+			job->log("No animations in file...\n");
 		}
 
 		skeleton->saveToFile(fileName, swapZY);
 	} else {
-		printf("No weight data, skipping skeleton export...\n");
+		job->log("No weight data, skipping skeleton export...\n");
 	}
 
-
-	delete mesh;
 	return 1;
 }
 
+vector<ImportJob*> jobs;
+volatile long nextJob = 0;
+bool swapZY = false;
+
+#ifdef _WINDOWS
+HANDLE importMutex;
+#else
+pthread_mutex_t importMutex;
+#endif
+
+void runImportJob(ImportJob *job) {
+	job->log("Loading %s...\n", job->sourceFile.c_str());
+
+	// Assimp's C interface keeps its importers in shared state, so only the optimization and export run in parallel
+#ifdef _WINDOWS
+	WaitForSingleObject(importMutex, INFINITE);
+	job->scene = aiImportFile(job->sourceFile.c_str(), aiProcessPreset_TargetRealtime_Quality);
+	ReleaseMutex(importMutex);
+#else
+	pthread_mutex_lock(&importMutex);
+	job->scene = aiImportFile(job->sourceFile.c_str(), aiProcessPreset_TargetRealtime_Quality);
+	pthread_mutex_unlock(&importMutex);
+#endif
+
+	if(job->scene) {
+		job->succeeded = exportToFile(job, job->outputFile.c_str(), swapZY) == 1;
+	} else {
+		job->log("Error opening scene...\n");
+	}
+
+#ifdef _WINDOWS
+	WaitForSingleObject(importMutex, INFINITE);
+	aiReleaseImport(job->scene);
+	ReleaseMutex(importMutex);
+#else
+	pthread_mutex_lock(&importMutex);
+	aiReleaseImport(job->scene);
+	pthread_mutex_unlock(&importMutex);
+#endif
+	job->scene = NULL;
+}
+
+#ifdef _WINDOWS
+DWORD WINAPI importWorker(LPVOID data) {
+#else
+void *importWorker(void *data) {
+#endif
+	while(true) {
+#ifdef _WINDOWS
+		long index = InterlockedIncrement(&nextJob) - 1;
+#else
+		long index = __sync_fetch_and_add(&nextJob, 1);
+#endif
+		if(index >= jobs.size())
+			break;
+		runImportJob(jobs[index]);
+	}
+	return 0;
+}
+
 int main(int argc, char **argv) {
 
 	printf("Polycode import tool v0.8.2\n");
 
-	if(argc != 4) {
+	vector<String> files;
+	for(int i=1; i < argc; i++) {
+		String arg = argv[i];
+		if(arg.find("--") == 0)
+			args.push_back(arg);
+		else
+			files.push_back(arg);
+	}
+
+	if(files.size() < 3 || (files.size() - 3) % 2 != 0) {
 		printf("\n\nInvalid arguments!\n");
-		printf("usage: polyimport <source_file> <output_file> (Swap Z/Y:<true>/<false>) \n\n");
+		printf("usage: polyimport [options] <source_file> <output_file> (Swap Z/Y:<true>/<false>) [<source_file> <output_file> ...]\n\n");
+		printf("options:\n");
+		printf("  --optimize=false        Skip vertex cache and overdraw ordering and LOD generation\n");
+		printf("  --lods=N                Number of lower levels of detail to generate (default 3)\n");
+		printf("  --lodRatio=R            Triangle ratio between successive levels (default 0.5)\n");
+		printf("  --lodMaxError=E         Largest simplification error, relative to the mesh radius (default 0.05)\n");
+		printf("  --weldTolerance=T       Vertex welding distance, relative to the mesh radius (default 0.00001)\n");
+		printf("  --overdrawThreshold=T   Largest ACMR increase allowed to reduce overdraw (default 1.05)\n");
+		printf("  --jobs=N                Number of files to process at once (default: number of cores)\n\n");
 		return 0;
 	}
+
+	swapZY = files[2] == "true";
+	for(int i=0; i < files.size(); i += (i == 0 ? 3 : 2)) {
+		ImportJob *job = new ImportJob();
+		job->sourceFile = files[i];
+		job->outputFile = files[i+1];
+		jobs.push_back(job);
+	}
 	
 	PHYSFS_init(argv[0]);
 	struct aiLogStream stream;
 	stream = aiGetPredefinedLogStream(aiDefaultLogStream_STDOUT,NULL);
 	aiAttachLogStream(&stream);
 
-	printf("Loading %s...\n", argv[1]);
-	scene = aiImportFile(argv[1],aiProcessPreset_TargetRealtime_Quality);
-	if(scene) {
-		exportToFile(argv[2], strcmp(argv[3], "true") == 0);
-	} else {
-		printf("Error opening scene...\n");
+	int numWorkers = (int)getNumberArg("--jobs", 0);
+	if(numWorkers <= 0) {
+#ifdef _WINDOWS
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		numWorkers = systemInfo.dwNumberOfProcessors;
+#else
+		numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
 	}
-
-	aiReleaseImport(scene);
+	if(numWorkers > jobs.size())
+		numWorkers = jobs.size();
+
+	// the main thread works through the files too
+#ifdef _WINDOWS
+	importMutex = CreateMutex(NULL, FALSE, NULL);
+	vector<HANDLE> workers;
+	for(int i=0; i < numWorkers - 1; i++) {
+		DWORD threadID;
+		HANDLE thread = CreateThread(NULL, 0, importWorker, NULL, 0, &threadID);
+		if(thread)
+			workers.push_back(thread);
+	}
+	importWorker(0);
+	for(int i=0; i < workers.size(); i++) {
+		WaitForSingleObject(workers[i], INFINITE);
+		CloseHandle(workers[i]);
+	}
+#else
+	pthread_mutex_init(&importMutex, NULL);
+	vector<pthread_t> workers;
+	for(int i=0; i < numWorkers - 1; i++) {
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, importWorker, NULL) == 0)
+			workers.push_back(thread);
+	}
+	importWorker(0);
+	for(int i=0; i < workers.size(); i++) {
+		pthread_join(workers[i], NULL);
+	}
+#endif
+
+	int numSucceeded = 0;
+	for(int i=0; i < jobs.size(); i++) {
+		printf("%s", jobs[i]->output.c_str());
+		if(jobs[i]->succeeded)
+			numSucceeded++;
+		delete jobs[i];
+	}
+	if(jobs.size() > 1)
+		printf("Imported %d of %d files\n", numSucceeded, (int)jobs.size());
 	return 1;
 }